@@ -3,7 +3,8 @@
  * @example    rc_altitude
  *
  * This serves as an example of how to read the barometer and IMU together to
- * estimate altitude
+ * estimate altitude. The barometer is read by its background sampler in the
+ * gaps between IMU samples so the DMP callback never waits on the bus.
  *
  * @author     James Strawson
  * @date       3/14/2018
@@ -27,7 +28,7 @@
 #define	DT		(1.0/SAMPLE_RATE)
 #define ACCEL_LP_TC	20*DT	// fast LP filter for accel
 #define PRINT_HZ	10
-#define BMP_RATE_DIV	10	// optionally sample bmp less frequently than mpu
+#define BMP_RATE_HZ	20	// sample bmp less frequently than mpu
 
 static int running = 0;
 static rc_mpu_data_t mpu_data;
@@ -50,7 +51,11 @@ static void __dmp_handler(void)
 {
 	int i;
 	double accel_vec[3];
-	static int bmp_sample_counter = 0;
+	rc_bmp_sample_t sample;
+
+	// pick up the newest barometer reading, keep the last one if there
+	// isn't one yet
+	if(rc_bmp_sampler_get_latest(&sample)==0) bmp_data = sample.data;
 
 	// make copy of acceleration reading before rotating
 	for(i=0;i<3;i++) accel_vec[i]=mpu_data.accel[i];
@@ -72,14 +77,6 @@ static void __dmp_handler(void)
 	y.d[0] = bmp_data.alt_m;
 	if(rc_kalman_update_lin(&kf, u, y)) running=0;
 
-	// now check if we need to sample BMP this loop
-	bmp_sample_counter++;
-	if(bmp_sample_counter>=BMP_RATE_DIV){
-		// perform the i2c reads to the sensor, on bad read just try later
-		if(rc_bmp_read(&bmp_data)) return;
-		bmp_sample_counter=0;
-	}
-
 	return;
 }
 
@@ -88,6 +85,7 @@ static void __dmp_handler(void)
 int main(void)
 {
 	rc_mpu_config_t mpu_conf;
+	rc_bmp_sampler_config_t bmp_conf;
 	rc_matrix_t F = RC_MATRIX_INITIALIZER;
 	rc_matrix_t G = RC_MATRIX_INITIALIZER;
 	rc_matrix_t H = RC_MATRIX_INITIALIZER;
@@ -155,6 +153,9 @@ int main(void)
 	printf("initializing barometer\n");
 	if(rc_bmp_init(BMP_OVERSAMPLE_16, BMP_FILTER_16)) return -1;
 	if(rc_bmp_read(&bmp_data)) return -1;
+	bmp_conf = rc_bmp_sampler_default_config();
+	bmp_conf.rate_hz = BMP_RATE_HZ;
+	if(rc_bmp_sampler_start(bmp_conf)) return -1;
 
 	// init DMP
 	printf("initializing DMP\n");
@@ -193,8 +194,9 @@ int main(void)
 	}
 	printf("\n");
 
-	rc_mpu_power_off();
+	// stop the sampler first, it is subscribed to the mpu
 	rc_bmp_power_off();
+	rc_mpu_power_off();
 	return 0;
 }
 
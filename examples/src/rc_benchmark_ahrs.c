@@ -0,0 +1,164 @@
+/**
+ * @file rc_benchmark_ahrs.c
+ * @example    rc_benchmark_ahrs
+ *
+ * @brief      benchmarks the software AHRS filters used by
+ *             rc_mpu_initialize_ahrs()
+ *
+ *             Runs the Mahony and Madgwick filters in 6 axis (accel/gyro) and 9
+ *             axis (accel/gyro/mag) configurations on synthetic data of a
+ *             tumbling IMU and reports the CPU time per update and final
+ *             orientation error. At 1kHz the filter budget is 1ms per sample
+ *             so this shows how much of it is left for the user's callback.
+ *             Heading is unobservable without the magnetometer so expect the
+ *             6 axis error to grow with the number of updates.
+ *
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <stdlib.h> // for atoi
+#include <math.h>
+#include <rc/time.h>
+#include <rc/math.h>
+#include <rc/mpu.h> // for RAD_TO_DEG
+
+#define DEFAULT_UPDATES	1000000
+#define SAMPLES		1000	// length of synthetic data set, repeated
+#define DT		0.001f	// 1khz, the fastest rc_mpu_initialize_ahrs supports
+
+#define TIMER rc_nanos_thread_time()
+
+static float gyro[SAMPLES][3];
+static float accel[SAMPLES][3];
+static float mag[SAMPLES][3];
+
+
+static void __print_usage(void)
+{
+	printf("\n");
+	printf("-n {updates}  number of filter updates per test, default %d\n", DEFAULT_UPDATES);
+	printf("-h            print this help message\n");
+	printf("\n");
+}
+
+
+/**
+ * True orientation at sample i, one loop per SAMPLES so the data set can be
+ * repeated without a jump: a full turn in yaw while rocking in roll and pitch.
+ */
+static void __truth(int i, double q[4])
+{
+	double t = 2.0*M_PI*(double)(i%SAMPLES)/SAMPLES;
+	double tb[3];
+	tb[0] = 0.3*sin(t);
+	tb[1] = 0.2*cos(t);
+	tb[2] = t;
+	rc_quaternion_from_tb_array(tb, q);
+	return;
+}
+
+
+/**
+ * Fill the data arrays from the true trajectory. Gravity and a magnetic field
+ * are rotated into the body frame and the body rate is the one that carries
+ * the previous sample's orientation to this one.
+ */
+static void __make_data(void)
+{
+	int i, j;
+	double q[4], qc[4], qp[4], qpc[4], dq[4];
+	double g[3], m[3];
+	for(i=0;i<SAMPLES;i++){
+		__truth(i, q);
+		__truth(i+SAMPLES-1, qp);
+		rc_quaternion_conjugate_array(q, qc);
+		rc_quaternion_conjugate_array(qp, qpc);
+		g[0] = 0.0;	g[1] = 0.0;	g[2] = 9.81;
+		m[0] = 20.0;	m[1] = 0.0;	m[2] = -40.0;
+		rc_quaternion_rotate_vector_array(g, qc);
+		rc_quaternion_rotate_vector_array(m, qc);
+		// body rate w = 2*vec(conj(qp)*q)/dt for small steps. q and -q are
+		// the same attitude and yaw wraps through 2pi once per loop, so
+		// take the short way round or that step turns backwards
+		rc_quaternion_multiply_array(qpc, q, dq);
+		if(dq[0]<0.0) for(j=0;j<4;j++) dq[j] = -dq[j];
+		for(j=0;j<3;j++){
+			accel[i][j] = (float)g[j];
+			mag[i][j] = (float)m[j];
+			gyro[i][j] = (float)(2.0*dq[j+1]/(double)DT);
+		}
+	}
+	return;
+}
+
+
+static void __run(const char* name, rc_ahrs_t* a, int use_mag, int n)
+{
+	int i;
+	uint64_t t1, t2;
+	double q[4], qt[4], qc[4], err[4];
+
+	t1 = TIMER;
+	for(i=0;i<n;i++){
+		rc_ahrs_update(a, gyro[i%SAMPLES], accel[i%SAMPLES],
+				use_mag ? mag[i%SAMPLES] : NULL, DT);
+	}
+	t2 = TIMER;
+	// compare against the truth, which also keeps the loop from being
+	// optimized away
+	rc_ahrs_get_quaternion(a, q);
+	__truth(n-1, qt);
+	rc_quaternion_conjugate_array(qt, qc);
+	rc_quaternion_multiply_array(qc, q, err);
+	printf("%-16s %6.1f ns/update   final error %6.3f deg\n", name,
+		(double)(t2-t1)/n, 2.0*acos(fmin(fabs(err[0]),1.0))*RAD_TO_DEG);
+	return;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int c;
+	int n = DEFAULT_UPDATES;
+	rc_ahrs_t a = RC_AHRS_INITIALIZER;
+
+	// parse arguments
+	opterr = 0;
+	while ((c = getopt(argc, argv, "n:h")) != -1){
+		switch (c){
+		case 'n':
+			n = atoi(optarg);
+			if(n<1){
+				printf("number of updates must be >= 1\n");
+				return -1;
+			}
+			break;
+		case 'h':
+			__print_usage();
+			return 0;
+		default:
+			__print_usage();
+			return -1;
+		}
+	}
+
+	__make_data();
+	printf("\nrunning %d updates per test\n\n", n);
+
+	rc_ahrs_mahony_init(&a, 1.0f, 0.0f);
+	__run("mahony 6-axis", &a, 0, n);
+	rc_ahrs_mahony_init(&a, 1.0f, 0.0f);
+	__run("mahony 9-axis", &a, 1, n);
+	rc_ahrs_madgwick_init(&a, 0.1f);
+	__run("madgwick 6-axis", &a, 0, n);
+	rc_ahrs_madgwick_init(&a, 0.1f);
+	__run("madgwick 9-axis", &a, 1, n);
+	printf("\n");
+
+	return 0;
+}
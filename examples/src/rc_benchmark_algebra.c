@@ -57,6 +57,9 @@ int main(int argc, char *argv[])
 	rc_matrix_t P =  RC_MATRIX_INITIALIZER;
 	rc_matrix_t Q =  RC_MATRIX_INITIALIZER;
 	rc_matrix_t R =  RC_MATRIX_INITIALIZER;
+	rc_matrix_t X =  RC_MATRIX_INITIALIZER;
+	rc_algebra_lu_t lu = RC_ALGEBRA_LU_INITIALIZER;
+	rc_algebra_qr_t qr = RC_ALGEBRA_QR_INITIALIZER;
 
 	// make sure user gave an argument
 	if(argc>3){
@@ -178,6 +181,50 @@ int main(int argc, char *argv[])
 	diff = (int)((t2-t1-TIMER_DELAY)/(uint64_t)1000);
 	printf("%10dus Time to solve linear system\n", diff);
 
+	// same system with QR
+	t1 = TIMER;
+	rc_algebra_lin_system_solve_qr(A,b,&x);
+	t2 = TIMER;
+	diff = (int)((t2-t1-TIMER_DELAY)/(uint64_t)1000);
+	printf("%10dus Time to solve linear system with QR\n", diff);
+
+	// factor once and solve many, the solves reuse x and X so they don't
+	// allocate memory
+	t1 = TIMER;
+	rc_algebra_lu_factor(A,&lu);
+	t2 = TIMER;
+	diff = (int)((t2-t1-TIMER_DELAY)/(uint64_t)1000);
+	printf("%10dus Time to factor LU\n", diff);
+	t1 = TIMER;
+	rc_algebra_lu_solve(&lu,b,&x);
+	t2 = TIMER;
+	diff = (int)((t2-t1-TIMER_DELAY)/(uint64_t)1000);
+	printf("%10dus Time to solve with LU factorization\n", diff);
+	rc_matrix_alloc(&X,dim,dim);
+	t1 = TIMER;
+	rc_algebra_lu_solve_multi(&lu,B,&X);
+	t2 = TIMER;
+	diff = (int)((t2-t1-TIMER_DELAY)/(uint64_t)1000);
+	printf("%10dus Time to solve %d right hand sides with LU factorization\n", diff, dim);
+
+	t1 = TIMER;
+	rc_algebra_qr_factor(A,&qr);
+	t2 = TIMER;
+	diff = (int)((t2-t1-TIMER_DELAY)/(uint64_t)1000);
+	printf("%10dus Time to factor QR\n", diff);
+	t1 = TIMER;
+	rc_algebra_qr_solve(&qr,b,&x);
+	t2 = TIMER;
+	diff = (int)((t2-t1-TIMER_DELAY)/(uint64_t)1000);
+	printf("%10dus Time to solve with QR factorization\n", diff);
+	t1 = TIMER;
+	rc_algebra_qr_solve_multi(&qr,B,&X);
+	t2 = TIMER;
+	diff = (int)((t2-t1-TIMER_DELAY)/(uint64_t)1000);
+	printf("%10dus Time to solve %d right hand sides with QR factorization\n", diff, dim);
+	rc_algebra_lu_free(&lu);
+	rc_algebra_qr_free(&qr);
+
 	printf("DONE\n");
 	//rc_set_cpu_freq(FREQ_ONDEMAND);
 	return 0;
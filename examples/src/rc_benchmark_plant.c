@@ -0,0 +1,363 @@
+/**
+ * @file rc_benchmark_plant.c
+ * @example    rc_benchmark_plant
+ *
+ * @brief      closes control loops around the simulated plants in <rc/sim.h>
+ *
+ *             Balances the simulated eduMiP with the controllers and settings
+ *             from rc_balance_defs.h, then flies the simulated vertical
+ *             vehicle to a step in altitude using the barometer and
+ *             accelerometer Kalman filter from rc_altitude. Sensors and
+ *             actuators go through the real drivers so this exercises the
+ *             whole loop from DMP interrupt to motor pins. By default the
+ *             sample clock runs in lockstep with the control loops so many
+ *             simulated seconds pass per second, use -r to run at a fixed
+ *             rate instead.
+ *
+ *             rc_balance itself isn't run since it waits for buttons and a
+ *             person to pick it up, the controller below is its inner and
+ *             outer loop without the pick-up detection and steering.
+ *
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <stdlib.h> // for atof
+#include <math.h>
+#include <rc/time.h>
+#include <rc/math.h>
+#include <rc/mpu.h>
+#include <rc/bmp.h>
+#include <rc/motor.h>
+#include <rc/encoder_eqep.h>
+#include <rc/servo.h>
+#include <rc/sim.h>
+#include "rc_balance_defs.h"
+
+#define DEFAULT_SECONDS	10.0
+#define BAL_THETA0	0.1	// initial lean, rad
+#define ALT_RATE_HZ	200
+#define ALT_DT		(1.0/ALT_RATE_HZ)
+#define ALT_TARGET_M	2.0
+#define ALT_KP		0.2
+#define ALT_KI		0.05
+#define ALT_KD		0.15
+#define ALT_I_MAX	2.0	// m*s, anti-windup
+#define ALT_HOVER	0.5	// throttle the default vertical plant hovers at
+#define ACCEL_LP_TC	(20*ALT_DT)
+#define BARO_NOISE_PA	1.0
+#define ACCEL_NOISE_MS2	0.05
+#define BMP_RATE_DIV	10
+#define ESC_CHANNELS	4
+
+#define TIMER rc_nanos_since_boot()
+
+static rc_mpu_data_t mpu_data;
+static rc_bmp_data_t bmp_data;
+static rc_filter_t D1 = RC_FILTER_INITIALIZER;
+static rc_filter_t D2 = RC_FILTER_INITIALIZER;
+static rc_filter_t acc_lp = RC_FILTER_INITIALIZER;
+static rc_kalman_t kf = RC_KALMAN_INITIALIZER;
+static rc_vector_t u = RC_VECTOR_INITIALIZER;
+static rc_vector_t y = RC_VECTOR_INITIALIZER;
+static double alt_i;
+
+// statistics gathered in the callbacks
+static double err_sq_sum, err_max, est_sq_sum, est_max;
+static int samples;
+
+
+static void __print_usage(void)
+{
+	printf("\n");
+	printf("-s {seconds}  simulated seconds to run each plant, default %.0f\n", DEFAULT_SECONDS);
+	printf("-r {scale}    simulated seconds per real second, default 0 (lockstep)\n");
+	printf("-h            print this help message\n");
+	printf("\n");
+}
+
+
+/**
+ * rc_balance's state estimate and D1/D2 loops, called at SAMPLE_RATE_HZ
+ */
+static void __balance_controller(void)
+{
+	double theta, phi, wheel_l, wheel_r, theta_ref, duty;
+	rc_sim_balance_state_t s;
+
+	theta = mpu_data.dmp_TaitBryan[TB_PITCH_X] + BOARD_MOUNT_ANGLE;
+	wheel_r = (rc_encoder_eqep_read(ENCODER_CHANNEL_R) * 2.0 * M_PI) \
+				/(ENCODER_POLARITY_R * GEARBOX * ENCODER_RES);
+	wheel_l = (rc_encoder_eqep_read(ENCODER_CHANNEL_L) * 2.0 * M_PI) \
+				/(ENCODER_POLARITY_L * GEARBOX * ENCODER_RES);
+	phi = ((wheel_l+wheel_r)/2) + theta;
+
+	if(fabs(theta) > TIP_ANGLE){
+		rc_motor_set(0, 0.0);
+		return;
+	}
+	theta_ref = rc_filter_march(&D2, -phi);
+	duty = rc_filter_march(&D1, theta_ref-theta);
+	rc_motor_set(MOTOR_CHANNEL_L, MOTOR_POLARITY_L * duty);
+	rc_motor_set(MOTOR_CHANNEL_R, MOTOR_POLARITY_R * duty);
+
+	// the plant can't move while we are in the callback, compare the
+	// estimate with the truth
+	if(rc_sim_balance_get_state(&s)) return;
+	err_sq_sum += s.theta*s.theta;
+	if(fabs(s.theta)>err_max) err_max = fabs(s.theta);
+	est_sq_sum += (theta-s.theta)*(theta-s.theta);
+	if(fabs(theta-s.theta)>est_max) est_max = fabs(theta-s.theta);
+	samples++;
+	return;
+}
+
+
+static int __run_balance(double seconds)
+{
+	uint64_t t1, t2;
+	double D1_num[] = D1_NUM;
+	double D1_den[] = D1_DEN;
+	double D2_num[] = D2_NUM;
+	double D2_den[] = D2_DEN;
+	rc_sim_balance_state_t s;
+	rc_sim_balance_config_t plant_conf = rc_sim_balance_default_config();
+	rc_mpu_config_t mpu_conf = rc_mpu_default_config();
+
+	if(rc_filter_alloc_from_arrays(&D1, DT, D1_num, D1_NUM_LEN, D1_den, D1_DEN_LEN)) return -1;
+	D1.gain = D1_GAIN;
+	rc_filter_enable_saturation(&D1, -1.0, 1.0);
+	if(rc_filter_alloc_from_arrays(&D2, DT, D2_num, D2_NUM_LEN, D2_den, D2_DEN_LEN)) return -1;
+	D2.gain = D2_GAIN;
+	rc_filter_enable_saturation(&D2, -THETA_REF_MAX, THETA_REF_MAX);
+
+	if(rc_encoder_eqep_init()) return -1;
+	if(rc_motor_init()) return -1;
+
+	mpu_conf.dmp_sample_rate = SAMPLE_RATE_HZ;
+	mpu_conf.orient = ORIENTATION_Y_UP;
+	if(rc_mpu_initialize_dmp(&mpu_data, mpu_conf)) return -1;
+
+	err_sq_sum = err_max = est_sq_sum = est_max = 0.0;
+	samples = 0;
+	plant_conf.theta0 = BAL_THETA0;
+	if(rc_sim_balance_start(plant_conf)) return -1;
+	rc_mpu_set_dmp_callback(__balance_controller);
+
+	t1 = TIMER;
+	do{
+		rc_usleep(1000);
+		if(rc_sim_balance_get_state(&s)) return -1;
+	}while(s.time_s<seconds && !s.fallen);
+	t2 = TIMER;
+	rc_mpu_power_off();
+	rc_sim_plant_stop();
+
+	printf("balance         %8.1f sim s in %.2f s, %.1fx real time\n",
+		s.time_s, (double)(t2-t1)/1e9, s.time_s*1e9/(t2-t1));
+	if(s.fallen){
+		printf("balance         fell over\n");
+	}
+	else{
+		printf("balance         theta rms %.4f max %.4f rad, final x %.4f m\n",
+			sqrt(err_sq_sum/samples), err_max, s.x_m);
+		printf("balance         theta estimate error rms %.5f max %.5f rad\n",
+			sqrt(est_sq_sum/samples), est_max);
+	}
+
+	rc_motor_cleanup();
+	rc_encoder_eqep_cleanup();
+	rc_filter_free(&D1);
+	rc_filter_free(&D2);
+	return 0;
+}
+
+
+/**
+ * rc_altitude's estimator feeding an altitude PID, called at ALT_RATE_HZ
+ */
+static void __altitude_controller(void)
+{
+	int i;
+	double accel_vec[3], err, throttle;
+	static int bmp_sample_counter = 0;
+	rc_sim_vertical_state_t s;
+
+	for(i=0;i<3;i++) accel_vec[i]=mpu_data.accel[i];
+	rc_quaternion_rotate_vector_array(accel_vec, mpu_data.dmp_quat);
+	if(kf.step==0){
+		kf.x_est.d[0] = bmp_data.alt_m;
+		rc_filter_prefill_inputs(&acc_lp, accel_vec[2]-G_TO_MS2);
+		rc_filter_prefill_outputs(&acc_lp, accel_vec[2]-G_TO_MS2);
+	}
+	rc_filter_march(&acc_lp, accel_vec[2]-G_TO_MS2);
+	u.d[0] = acc_lp.newest_output;
+	y.d[0] = bmp_data.alt_m;
+	if(rc_kalman_update_lin(&kf, u, y)) return;
+
+	bmp_sample_counter++;
+	if(bmp_sample_counter>=BMP_RATE_DIV){
+		if(rc_bmp_read(&bmp_data)==0) bmp_sample_counter=0;
+	}
+
+	// PID with the derivative on the estimated velocity so the step in
+	// target doesn't kick it
+	err = ALT_TARGET_M-kf.x_est.d[0];
+	alt_i += err*ALT_DT;
+	rc_saturate_double(&alt_i, -ALT_I_MAX, ALT_I_MAX);
+	throttle = ALT_HOVER + ALT_KP*err + ALT_KI*alt_i - ALT_KD*kf.x_est.d[1];
+	rc_saturate_double(&throttle, 0.0, 1.0);
+	for(i=1;i<=ESC_CHANNELS;i++) rc_servo_send_esc_pulse_normalized(i, throttle);
+
+	if(rc_sim_vertical_get_state(&s)) return;
+	err_sq_sum += (ALT_TARGET_M-s.alt_m)*(ALT_TARGET_M-s.alt_m);
+	if(fabs(ALT_TARGET_M-s.alt_m)>err_max) err_max = fabs(ALT_TARGET_M-s.alt_m);
+	est_sq_sum += (kf.x_est.d[0]-s.alt_m)*(kf.x_est.d[0]-s.alt_m);
+	if(fabs(kf.x_est.d[0]-s.alt_m)>est_max) est_max = fabs(kf.x_est.d[0]-s.alt_m);
+	samples++;
+	return;
+}
+
+
+static int __run_vertical(double seconds)
+{
+	uint64_t t1, t2;
+	rc_matrix_t F = RC_MATRIX_INITIALIZER;
+	rc_matrix_t G = RC_MATRIX_INITIALIZER;
+	rc_matrix_t H = RC_MATRIX_INITIALIZER;
+	rc_matrix_t Q = RC_MATRIX_INITIALIZER;
+	rc_matrix_t R = RC_MATRIX_INITIALIZER;
+	rc_matrix_t Pi = RC_MATRIX_INITIALIZER;
+	rc_sim_vertical_state_t s;
+	rc_sim_vertical_config_t plant_conf = rc_sim_vertical_default_config();
+	rc_mpu_config_t mpu_conf = rc_mpu_default_config();
+
+	// same filter as rc_altitude, altitude, velocity and accel bias
+	rc_matrix_zeros(&F, 3, 3);
+	rc_matrix_zeros(&G, 3, 1);
+	rc_matrix_zeros(&H, 1, 3);
+	rc_matrix_zeros(&Q, 3, 3);
+	rc_matrix_zeros(&R, 1, 1);
+	rc_matrix_zeros(&Pi, 3, 3);
+	rc_vector_zeros(&u, 1);
+	rc_vector_zeros(&y, 1);
+	F.d[0][0] = 1.0;
+	F.d[0][1] = ALT_DT;
+	F.d[1][1] = 1.0;
+	F.d[1][2] = -ALT_DT;
+	F.d[2][2] = 1.0;
+	G.d[0][0] = 0.5*ALT_DT*ALT_DT;
+	G.d[1][0] = ALT_DT;
+	H.d[0][0] = 1.0;
+	Q.d[0][0] = 0.000000001;
+	Q.d[1][1] = 0.000000001;
+	Q.d[2][2] = 0.0001;
+	R.d[0][0] = 1000000.0;
+	Pi.d[0][0] = 1258.69;
+	Pi.d[0][1] = 158.6114;
+	Pi.d[0][2] = -9.9937;
+	Pi.d[1][0] = 158.6114;
+	Pi.d[1][1] = 29.9870;
+	Pi.d[1][2] = -2.5191;
+	Pi.d[2][0] = -9.9937;
+	Pi.d[2][1] = -2.5191;
+	Pi.d[2][2] = 0.3174;
+	if(rc_kalman_alloc_lin(&kf, F, G, H, Q, R, Pi)) return -1;
+	if(rc_filter_first_order_lowpass(&acc_lp, ALT_DT, ACCEL_LP_TC)) return -1;
+	alt_i = 0.0;
+
+	plant_conf.baro_noise_pa = BARO_NOISE_PA;
+	plant_conf.accel_noise_ms2 = ACCEL_NOISE_MS2;
+	if(rc_sim_vertical_start(plant_conf)) return -1;
+	if(rc_servo_init()) return -1;
+	if(rc_bmp_init(BMP_OVERSAMPLE_16, BMP_FILTER_OFF)) return -1;
+	if(rc_bmp_read(&bmp_data)) return -1;
+
+	mpu_conf.dmp_sample_rate = ALT_RATE_HZ;
+	mpu_conf.dmp_fetch_accel_gyro = 1;
+	if(rc_mpu_initialize_dmp(&mpu_data, mpu_conf)) return -1;
+
+	err_sq_sum = err_max = est_sq_sum = est_max = 0.0;
+	samples = 0;
+	rc_mpu_set_dmp_callback(__altitude_controller);
+
+	t1 = TIMER;
+	do{
+		rc_usleep(1000);
+		if(rc_sim_vertical_get_state(&s)) return -1;
+	}while(s.time_s<seconds);
+	t2 = TIMER;
+	rc_mpu_power_off();
+	rc_sim_plant_stop();
+
+	printf("vertical        %8.1f sim s in %.2f s, %.1fx real time\n",
+		s.time_s, (double)(t2-t1)/1e9, s.time_s*1e9/(t2-t1));
+	printf("vertical        final altitude %.3f m (target %.1f), error rms %.3f max %.3f m\n",
+		s.alt_m, ALT_TARGET_M, sqrt(err_sq_sum/samples), err_max);
+	printf("vertical        altitude estimate error rms %.3f max %.3f m\n",
+		sqrt(est_sq_sum/samples), est_max);
+
+	rc_servo_cleanup();
+	rc_bmp_power_off();
+	rc_kalman_free(&kf);
+	rc_filter_free(&acc_lp);
+	rc_matrix_free(&F);
+	rc_matrix_free(&G);
+	rc_matrix_free(&H);
+	rc_matrix_free(&Q);
+	rc_matrix_free(&R);
+	rc_matrix_free(&Pi);
+	rc_vector_free(&u);
+	rc_vector_free(&y);
+	return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int c;
+	double seconds = DEFAULT_SECONDS;
+	double scale = 0.0;
+
+	// parse arguments
+	opterr = 0;
+	while ((c = getopt(argc, argv, "s:r:h")) != -1){
+		switch (c){
+		case 's':
+			seconds = atof(optarg);
+			if(seconds<=0.0){
+				printf("seconds must be > 0\n");
+				return -1;
+			}
+			break;
+		case 'r':
+			scale = atof(optarg);
+			if(scale<0.0){
+				printf("scale must be >= 0\n");
+				return -1;
+			}
+			break;
+		case 'h':
+			__print_usage();
+			return 0;
+		default:
+			__print_usage();
+			return -1;
+		}
+	}
+
+	if(rc_sim_enable() || rc_sim_set_time_scale(scale)){
+		fprintf(stderr,"ERROR failed to enable simulation\n");
+		return -1;
+	}
+	printf("\n");
+	if(__run_balance(seconds)) fprintf(stderr,"ERROR balance run failed\n");
+	if(__run_vertical(seconds)) fprintf(stderr,"ERROR vertical run failed\n");
+	printf("\n");
+
+	return 0;
+}
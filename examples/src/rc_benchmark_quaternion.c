@@ -0,0 +1,190 @@
+/**
+ * @file rc_benchmark_quaternion.c
+ * @example    rc_benchmark_quaternion
+ *
+ * @brief      benchmarks the batch quaternion functions against calling the
+ *             single quaternion array functions in a loop
+ *
+ *             Multiplies, rotates vectors by, and converts to Tait-Bryan
+ *             angles a set of random unit quaternions, first one at a time with
+ *             the rc_quaternion_*_array functions as a log post-processing loop
+ *             would, then with the structure of arrays *_batch functions. The
+ *             results of both are compared to make sure they agree.
+ *
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <stdlib.h> // for atoi
+#include <math.h>
+#include <rc/time.h>
+#include <rc/math.h>
+
+#define DEFAULT_N	100000
+#define REPEATS		10
+
+#define TIMER rc_nanos_thread_time()
+
+
+static void __print_usage(void)
+{
+	printf("\n");
+	printf("-n {count}  number of quaternions, default %d\n", DEFAULT_N);
+	printf("-h          print this help message\n");
+	printf("\n");
+}
+
+
+static double __rand(void)
+{
+	return 2.0*(double)rand()/(double)RAND_MAX - 1.0;
+}
+
+
+static void __report(const char* name, uint64_t t_single, uint64_t t_batch, int n, double err)
+{
+	printf("%-16s %7.2f ns single  %7.2f ns batch  %5.1fx  max diff %.1e\n", name,
+		(double)t_single/((double)n*REPEATS), (double)t_batch/((double)n*REPEATS),
+		(double)t_single/(double)t_batch, err);
+	return;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int c, i, r;
+	int n = DEFAULT_N;
+	uint64_t t1, t2, t_single, t_batch;
+	double err;
+	double (*qa)[4], (*qb)[4], (*qc)[4], (*v)[3], (*tb)[3];
+	rc_quaternion_batch_t a = RC_QUATERNION_BATCH_INITIALIZER;
+	rc_quaternion_batch_t b = RC_QUATERNION_BATCH_INITIALIZER;
+	rc_quaternion_batch_t cb = RC_QUATERNION_BATCH_INITIALIZER;
+	rc_quaternion_vec_batch_t vb = RC_QUATERNION_VEC_BATCH_INITIALIZER;
+	rc_quaternion_vec_batch_t tbb = RC_QUATERNION_VEC_BATCH_INITIALIZER;
+
+	// parse arguments
+	opterr = 0;
+	while ((c = getopt(argc, argv, "n:h")) != -1){
+		switch (c){
+		case 'n':
+			n = atoi(optarg);
+			if(n<1){
+				printf("count must be >= 1\n");
+				return -1;
+			}
+			break;
+		case 'h':
+			__print_usage();
+			return 0;
+		default:
+			__print_usage();
+			return -1;
+		}
+	}
+
+	// random unit quaternions and vectors in both layouts
+	qa = malloc(n*sizeof(*qa));
+	qb = malloc(n*sizeof(*qb));
+	qc = malloc(n*sizeof(*qc));
+	v  = malloc(n*sizeof(*v));
+	tb = malloc(n*sizeof(*tb));
+	if(qa==NULL || qb==NULL || qc==NULL || v==NULL || tb==NULL){
+		printf("failed to allocate memory\n");
+		return -1;
+	}
+	rc_quaternion_batch_alloc(&a, n);
+	rc_quaternion_batch_alloc(&b, n);
+	rc_quaternion_vec_batch_alloc(&vb, n);
+	for(i=0;i<n;i++){
+		a.w[i] = __rand(); a.i[i] = __rand(); a.j[i] = __rand(); a.k[i] = __rand();
+		b.w[i] = __rand(); b.i[i] = __rand(); b.j[i] = __rand(); b.k[i] = __rand();
+	}
+	rc_quaternion_normalize_batch(&a);
+	rc_quaternion_normalize_batch(&b);
+	for(i=0;i<n;i++){
+		qa[i][0] = a.w[i]; qa[i][1] = a.i[i]; qa[i][2] = a.j[i]; qa[i][3] = a.k[i];
+		qb[i][0] = b.w[i]; qb[i][1] = b.i[i]; qb[i][2] = b.j[i]; qb[i][3] = b.k[i];
+	}
+	printf("\n%d quaternions, %d repeats, time per quaternion:\n\n", n, REPEATS);
+
+	// multiply
+	t1 = TIMER;
+	for(r=0;r<REPEATS;r++){
+		for(i=0;i<n;i++) rc_quaternion_multiply_array(qa[i], qb[i], qc[i]);
+	}
+	t2 = TIMER;
+	t_single = t2-t1;
+	t1 = TIMER;
+	for(r=0;r<REPEATS;r++) rc_quaternion_multiply_batch(a, b, &cb);
+	t2 = TIMER;
+	t_batch = t2-t1;
+	err = 0.0;
+	for(i=0;i<n;i++){
+		err = fmax(err, fabs(qc[i][0]-cb.w[i]));
+		err = fmax(err, fabs(qc[i][1]-cb.i[i]));
+		err = fmax(err, fabs(qc[i][2]-cb.j[i]));
+		err = fmax(err, fabs(qc[i][3]-cb.k[i]));
+	}
+	__report("multiply", t_single, t_batch, n, err);
+
+	// rotate vectors, each repeat rotates the previous result again
+	for(i=0;i<n;i++){
+		v[i][0] = vb.x[i] = __rand();
+		v[i][1] = vb.y[i] = __rand();
+		v[i][2] = vb.z[i] = __rand();
+	}
+	t1 = TIMER;
+	for(r=0;r<REPEATS;r++){
+		for(i=0;i<n;i++) rc_quaternion_rotate_vector_array(v[i], qa[i]);
+	}
+	t2 = TIMER;
+	t_single = t2-t1;
+	t1 = TIMER;
+	for(r=0;r<REPEATS;r++) rc_quaternion_rotate_vector_batch(&vb, a);
+	t2 = TIMER;
+	t_batch = t2-t1;
+	err = 0.0;
+	for(i=0;i<n;i++){
+		err = fmax(err, fabs(v[i][0]-vb.x[i]));
+		err = fmax(err, fabs(v[i][1]-vb.y[i]));
+		err = fmax(err, fabs(v[i][2]-vb.z[i]));
+	}
+	__report("rotate vector", t_single, t_batch, n, err);
+
+	// Tait-Bryan angles
+	t1 = TIMER;
+	for(r=0;r<REPEATS;r++){
+		for(i=0;i<n;i++) rc_quaternion_to_tb_array(qa[i], tb[i]);
+	}
+	t2 = TIMER;
+	t_single = t2-t1;
+	t1 = TIMER;
+	for(r=0;r<REPEATS;r++) rc_quaternion_to_tb_batch(a, &tbb);
+	t2 = TIMER;
+	t_batch = t2-t1;
+	err = 0.0;
+	for(i=0;i<n;i++){
+		err = fmax(err, fabs(tb[i][0]-tbb.x[i]));
+		err = fmax(err, fabs(tb[i][1]-tbb.y[i]));
+		err = fmax(err, fabs(tb[i][2]-tbb.z[i]));
+	}
+	__report("to tait-bryan", t_single, t_batch, n, err);
+	printf("\n");
+
+	free(qa);
+	free(qb);
+	free(qc);
+	free(v);
+	free(tb);
+	rc_quaternion_batch_free(&a);
+	rc_quaternion_batch_free(&b);
+	rc_quaternion_batch_free(&cb);
+	rc_quaternion_vec_batch_free(&vb);
+	rc_quaternion_vec_batch_free(&tbb);
+	return 0;
+}
@@ -0,0 +1,167 @@
+/**
+ * @file rc_benchmark_rls.c
+ * @example    rc_benchmark_rls
+ *
+ * @brief      benchmarks the recursive least squares estimator against
+ *             re-solving the batch problem with QR decomposition
+ *
+ *             Identifies the parameters of a random linear model from noisy
+ *             measurements, one measurement at a time. The batch approach
+ *             re-solves the whole growing system with
+ *             rc_algebra_lin_system_solve_qr() after every measurement, which
+ *             gets slower as data accumulates, while each rc_rls_update() costs
+ *             the same no matter how many measurements came before. Both
+ *             should arrive at the same parameters.
+ *
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <stdlib.h> // for atoi
+#include <math.h>
+#include <rc/time.h>
+#include <rc/math.h>
+
+#define DEFAULT_PARAMS	4
+#define DEFAULT_SAMPLES	200
+#define MAX_PARAMS	50
+#define MAX_SAMPLES	500	// re-solving grows with the 4th power of this
+#define NOISE		0.01
+
+#define TIMER rc_nanos_thread_time()
+
+
+static void __print_usage(void)
+{
+	printf("\n");
+	printf("-n {params}   number of parameters, default %d\n", DEFAULT_PARAMS);
+	printf("-m {samples}  number of measurements, default %d\n", DEFAULT_SAMPLES);
+	printf("-h            print this help message\n");
+	printf("\n");
+}
+
+
+static double __rand(void)
+{
+	return 2.0*(double)rand()/(double)RAND_MAX - 1.0;
+}
+
+
+static double __error(rc_vector_t est, rc_vector_t truth)
+{
+	int i;
+	double err = 0.0;
+	for(i=0;i<truth.len;i++) err = fmax(err, fabs(est.d[i]-truth.d[i]));
+	return err;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int c, i, j, k;
+	int n = DEFAULT_PARAMS;
+	int m = DEFAULT_SAMPLES;
+	uint64_t t1, t2, t_rls, t_qr;
+	rc_matrix_t A = RC_MATRIX_INITIALIZER;
+	rc_matrix_t Ak = RC_MATRIX_INITIALIZER;
+	rc_vector_t b = RC_VECTOR_INITIALIZER;
+	rc_vector_t bk = RC_VECTOR_INITIALIZER;
+	rc_vector_t x = RC_VECTOR_INITIALIZER;
+	rc_vector_t phi = RC_VECTOR_INITIALIZER;
+	rc_vector_t truth = RC_VECTOR_INITIALIZER;
+	rc_rls_t rls = RC_RLS_INITIALIZER;
+
+	// parse arguments
+	opterr = 0;
+	while ((c = getopt(argc, argv, "n:m:h")) != -1){
+		switch (c){
+		case 'n':
+			n = atoi(optarg);
+			if(n<1 || n>MAX_PARAMS){
+				printf("number of parameters must be between 1 and %d\n", MAX_PARAMS);
+				return -1;
+			}
+			break;
+		case 'm':
+			m = atoi(optarg);
+			if(m<1 || m>MAX_SAMPLES){
+				printf("number of measurements must be between 1 and %d\n", MAX_SAMPLES);
+				return -1;
+			}
+			break;
+		case 'h':
+			__print_usage();
+			return 0;
+		default:
+			__print_usage();
+			return -1;
+		}
+	}
+	if(m<n){
+		printf("need at least as many measurements as parameters\n");
+		return -1;
+	}
+
+	// random model and regressors
+	rc_vector_alloc(&truth, n);
+	rc_vector_alloc(&phi, n);
+	rc_matrix_alloc(&A, m, n);
+	rc_vector_alloc(&b, m);
+	for(j=0;j<n;j++) truth.d[j] = 10.0*__rand();
+	for(i=0;i<m;i++){
+		b.d[i] = NOISE*__rand();
+		for(j=0;j<n;j++){
+			A.d[i][j] = __rand();
+			b.d[i] += A.d[i][j]*truth.d[j];
+		}
+	}
+	printf("\n%d parameters, %d measurements\n\n", n, m);
+
+	// recursive, one update per measurement
+	rc_rls_alloc(&rls, n, 1.0, 1000.0);
+	t1 = TIMER;
+	for(i=0;i<m;i++){
+		for(j=0;j<n;j++) phi.d[j] = A.d[i][j];
+		rc_rls_update(&rls, phi, b.d[i]);
+	}
+	t2 = TIMER;
+	t_rls = t2-t1;
+
+	// batch, re-solved on everything seen so far after every measurement
+	// once there are enough rows to solve
+	t_qr = 0;
+	for(k=n;k<=m;k++){
+		t1 = TIMER;
+		rc_matrix_alloc(&Ak, k, n);
+		rc_vector_alloc(&bk, k);
+		for(i=0;i<k;i++){
+			for(j=0;j<n;j++) Ak.d[i][j] = A.d[i][j];
+			bk.d[i] = b.d[i];
+		}
+		rc_algebra_lin_system_solve_qr(Ak, bk, &x);
+		t2 = TIMER;
+		t_qr += t2-t1;
+	}
+
+	printf("rls update:              %10.1f us total  %8.2f us/measurement\n",
+		(double)t_rls/1000.0, (double)t_rls/1000.0/m);
+	printf("qr re-solve:             %10.1f us total  %8.2f us/measurement\n",
+		(double)t_qr/1000.0, (double)t_qr/1000.0/(m-n+1));
+	printf("final qr solve alone:    %10.1f us\n", (double)(t2-t1)/1000.0);
+	printf("\nmax parameter error  rls: %.6f  qr: %.6f  rls vs qr: %.2e\n\n",
+		__error(rls.theta, truth), __error(x, truth), __error(rls.theta, x));
+
+	rc_rls_free(&rls);
+	rc_matrix_free(&A);
+	rc_matrix_free(&Ak);
+	rc_vector_free(&b);
+	rc_vector_free(&bk);
+	rc_vector_free(&x);
+	rc_vector_free(&phi);
+	rc_vector_free(&truth);
+	return 0;
+}
@@ -0,0 +1,223 @@
+/**
+ * @file rc_benchmark_trig.c
+ * @example    rc_benchmark_trig
+ *
+ * @brief      benchmarks the fast polynomial trig functions against libm
+ *
+ *             Times each function in <rc/math/fast_trig.h> and its libm
+ *             counterpart over the same set of random inputs and reports the
+ *             largest difference between the two. Then does the same for the
+ *             quaternion/Tait-Bryan conversions with
+ *             rc_quaternion_set_fast_trig() off and on.
+ *
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <stdlib.h> // for atoi, malloc
+#include <math.h>
+#include <rc/time.h>
+#include <rc/math.h>
+
+#define DEFAULT_N	100000
+#define REPEATS		10
+
+#define TIMER rc_nanos_thread_time()
+
+// keeps the compiler from dropping the timed calls
+static volatile double sink;
+
+
+static void __print_usage(void)
+{
+	printf("\n");
+	printf("-n {count}  number of inputs, default %d\n", DEFAULT_N);
+	printf("-h          print this help message\n");
+	printf("\n");
+}
+
+
+static double __rand(void)
+{
+	return 2.0*(double)rand()/(double)RAND_MAX - 1.0;
+}
+
+
+static void __report(const char* name, uint64_t t_libm, uint64_t t_fast, int n, double err, double bound)
+{
+	printf("%-12s %7.2f ns libm  %7.2f ns fast  %5.1fx  max err %.1e  (bound %.0e)\n", name,
+		(double)t_libm/((double)n*REPEATS), (double)t_fast/((double)n*REPEATS),
+		(double)t_libm/(double)t_fast, err, bound);
+	return;
+}
+
+
+static void __unary(const char* name, double (*f_libm)(double), double (*f_fast)(double),
+			double* x, double* out, int n, double bound)
+{
+	int i, r;
+	uint64_t t1, t_libm, t_fast;
+	double sum, err = 0.0;
+
+	t1 = TIMER;
+	for(r=0;r<REPEATS;r++){
+		sum = 0.0;
+		for(i=0;i<n;i++) sum += f_libm(x[i]);
+		sink = sum;
+	}
+	t_libm = TIMER-t1;
+	t1 = TIMER;
+	for(r=0;r<REPEATS;r++){
+		sum = 0.0;
+		for(i=0;i<n;i++) sum += f_fast(x[i]);
+		sink = sum;
+	}
+	t_fast = TIMER-t1;
+	for(i=0;i<n;i++){
+		out[i] = f_fast(x[i]);
+		err = fmax(err, fabs(out[i]-f_libm(x[i])));
+	}
+	__report(name, t_libm, t_fast, n, err, bound);
+	return;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int c, i, j, r;
+	int n = DEFAULT_N;
+	uint64_t t1, t_libm, t_fast;
+	double sum, err;
+	double *x, *y, *out;
+	double (*q)[4], (*tb)[3], (*tb_fast)[3], (*q_fast)[4];
+
+	// parse arguments
+	opterr = 0;
+	while ((c = getopt(argc, argv, "n:h")) != -1){
+		switch (c){
+		case 'n':
+			n = atoi(optarg);
+			if(n<1){
+				printf("count must be >= 1\n");
+				return -1;
+			}
+			break;
+		case 'h':
+			__print_usage();
+			return 0;
+		default:
+			__print_usage();
+			return -1;
+		}
+	}
+
+	x = malloc(n*sizeof(double));
+	y = malloc(n*sizeof(double));
+	out = malloc(n*sizeof(double));
+	q = malloc(n*sizeof(*q));
+	q_fast = malloc(n*sizeof(*q_fast));
+	tb = malloc(n*sizeof(*tb));
+	tb_fast = malloc(n*sizeof(*tb_fast));
+	if(x==NULL || y==NULL || out==NULL || q==NULL || q_fast==NULL || tb==NULL || tb_fast==NULL){
+		fprintf(stderr, "failed to allocate memory\n");
+		return -1;
+	}
+	printf("\n%d inputs, %d repeats\n\n", n, REPEATS);
+
+	// single functions, each over the range it sees in attitude math
+	for(i=0;i<n;i++) x[i] = 100.0*__rand();
+	__unary("sin", sin, rc_fast_sin, x, out, n, RC_FAST_SIN_MAX_ERROR);
+	__unary("cos", cos, rc_fast_cos, x, out, n, RC_FAST_SIN_MAX_ERROR);
+	for(i=0;i<n;i++) x[i] = 10.0*__rand();
+	__unary("atan", atan, rc_fast_atan, x, out, n, RC_FAST_ATAN_MAX_ERROR);
+	for(i=0;i<n;i++) x[i] = __rand();
+	__unary("asin", asin, rc_fast_asin, x, out, n, RC_FAST_ATAN_MAX_ERROR);
+
+	// atan2 needs two inputs
+	for(i=0;i<n;i++) y[i] = __rand();
+	t1 = TIMER;
+	for(r=0;r<REPEATS;r++){
+		sum = 0.0;
+		for(i=0;i<n;i++) sum += atan2(y[i],x[i]);
+		sink = sum;
+	}
+	t_libm = TIMER-t1;
+	t1 = TIMER;
+	for(r=0;r<REPEATS;r++){
+		sum = 0.0;
+		for(i=0;i<n;i++) sum += rc_fast_atan2(y[i],x[i]);
+		sink = sum;
+	}
+	t_fast = TIMER-t1;
+	err = 0.0;
+	for(i=0;i<n;i++) err = fmax(err, fabs(rc_fast_atan2(y[i],x[i])-atan2(y[i],x[i])));
+	__report("atan2", t_libm, t_fast, n, err, RC_FAST_ATAN_MAX_ERROR);
+
+	// quaternion to Tait-Bryan and back with the mode off and on
+	for(i=0;i<n;i++){
+		for(j=0;j<4;j++) q[i][j] = __rand();
+		rc_normalize_quaternion_array(q[i]);
+	}
+	printf("\n");
+	rc_quaternion_set_fast_trig(0);
+	t1 = TIMER;
+	for(r=0;r<REPEATS;r++) for(i=0;i<n;i++) rc_quaternion_to_tb_array(q[i], tb[i]);
+	t_libm = TIMER-t1;
+	rc_quaternion_set_fast_trig(1);
+	t1 = TIMER;
+	for(r=0;r<REPEATS;r++) for(i=0;i<n;i++) rc_quaternion_to_tb_array(q[i], tb_fast[i]);
+	t_fast = TIMER-t1;
+	err = 0.0;
+	for(i=0;i<n;i++) for(j=0;j<3;j++) err = fmax(err, fabs(tb_fast[i][j]-tb[i][j]));
+	__report("to_tb", t_libm, t_fast, n, err, RC_FAST_ATAN_MAX_ERROR);
+
+	rc_quaternion_set_fast_trig(0);
+	t1 = TIMER;
+	for(r=0;r<REPEATS;r++) for(i=0;i<n;i++) rc_quaternion_from_tb_array(tb[i], q[i]);
+	t_libm = TIMER-t1;
+	rc_quaternion_set_fast_trig(1);
+	t1 = TIMER;
+	for(r=0;r<REPEATS;r++) for(i=0;i<n;i++) rc_quaternion_from_tb_array(tb[i], q_fast[i]);
+	t_fast = TIMER-t1;
+	rc_quaternion_set_fast_trig(0);
+	err = 0.0;
+	for(i=0;i<n;i++) for(j=0;j<4;j++) err = fmax(err, fabs(q_fast[i][j]-q[i][j]));
+	__report("from_tb", t_libm, t_fast, n, err, RC_FAST_SIN_MAX_ERROR);
+	printf("\n");
+
+	// the per-call variants must match the global mode without touching it
+	for(i=0;i<n;i++){
+		rc_quaternion_to_tb_array_fast(q[i], tb[i]);
+		rc_quaternion_from_tb_array_fast(tb[i], q_fast[i]);
+	}
+	rc_quaternion_set_fast_trig(1);
+	err = 0.0;
+	for(i=0;i<n;i++){
+		rc_quaternion_to_tb_array(q[i], tb_fast[i]);
+		rc_quaternion_from_tb_array(tb[i], q[i]);
+		for(j=0;j<3;j++) err = fmax(err, fabs(tb_fast[i][j]-tb[i][j]));
+		for(j=0;j<4;j++) err = fmax(err, fabs(q_fast[i][j]-q[i][j]));
+	}
+	rc_quaternion_set_fast_trig(0);
+	printf("per-call fast variants vs global mode: %s\n", err<1e-15 ? "match" : "MISMATCH");
+
+	// out of range inputs must come back as NAN instead of a garbage quadrant
+	rc_fast_sincos(NAN, &sum, &err);
+	printf("out of range inputs give NAN:        %s\n\n",
+		(isnan(sum) && isnan(err) && isnan(rc_fast_sin(1e300)) &&
+		isnan(rc_fast_wrap_pi(-INFINITY)) && isnan(rc_fast_wrap_pi(NAN)))
+		? "yes" : "NO");
+
+	free(x);
+	free(y);
+	free(out);
+	free(q);
+	free(q_fast);
+	free(tb);
+	free(tb_fast);
+	return 0;
+}
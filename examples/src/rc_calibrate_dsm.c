@@ -9,14 +9,28 @@
  * rc_bind_dsm example if you haven't already used a bind plug and standard
  * receiver to pair. The satellite receiver remembers which transmitter it is
  * paired to, not your BeagleBone.
+ *
+ * To calibrate an SBUS or CRSF receiver instead, give sbus or crsf as the only
+ * argument.
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <rc/dsm.h>
 
-int main()
+int main(int argc, char *argv[])
 {
-	printf("Please connect a DSM satellite receiver and make sure\n");
+	rc_input_protocol_t protocol = RC_INPUT_DSM;
+
+	if(argc==2 && strcmp(argv[1], "sbus")==0) protocol = RC_INPUT_SBUS;
+	else if(argc==2 && strcmp(argv[1], "crsf")==0) protocol = RC_INPUT_CRSF;
+	else if(argc!=1 && !(argc==2 && strcmp(argv[1], "dsm")==0)){
+		fprintf(stderr,"usage: rc_calibrate_dsm [dsm|sbus|crsf]\n");
+		return -1;
+	}
+	if(rc_dsm_set_protocol(protocol)) return -1;
+
+	printf("Please connect a DSM, SBUS or CRSF receiver and make sure\n");
 	printf("your transmitter is on and paired to the receiver.\n");
 	printf("\n");
 	printf("Press ENTER to continue or anything else to quit\n");
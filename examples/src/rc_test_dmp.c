@@ -35,6 +35,7 @@ static int show_temp  = 0;
 static int show_quat  = 0;
 static int show_tb = 0;
 static int orientation_menu = 0;
+static int fast_start = 0;
 static rc_mpu_data_t data;
 
 // local functions
@@ -63,6 +64,7 @@ static void __print_usage(void)
 	printf("-p {prio}	Set Interrupt Priority and FIFO scheduling policy (requires root)\n");
 	printf("-w		Print I2C bus warnings\n");
 	printf("-o		Show a menu to select IMU orientation\n");
+	printf("-f		Fast start, then print how long initialization took\n");
 	printf("-h		Print this help message\n\n");
 
 	return;
@@ -244,7 +246,7 @@ int main(int argc, char *argv[])
 
 	// parse arguments
 	opterr = 0;
-	while ((c=getopt(argc, argv, "sr:mbagrqTtcp:hwo"))!=-1 && argc>1){
+	while ((c=getopt(argc, argv, "sr:mbagrqTtcp:hwof"))!=-1 && argc>1){
 		switch (c){
 		case 's':
 			silent_mode = 1;
@@ -305,6 +307,10 @@ int main(int argc, char *argv[])
 		case 'o': // let user select imu orientation
 			orientation_menu=1;
 			break;
+		case 'f': // fast start and report init timing
+			fast_start=1;
+			conf.fast_start=1;
+			break;
 		case 'h': // show help option
 			__print_usage();
 			return -1;
@@ -336,6 +342,15 @@ int main(int argc, char *argv[])
 		printf("rc_mpu_initialize_failed\n");
 		return -1;
 	}
+	if(fast_start){
+		rc_mpu_init_timing_t t;
+		rc_mpu_get_init_timing(&t);
+		printf("init timing (ms): reset %.1f, sensors %.1f, mag %.1f, ", \
+			t.reset_ns/1e6, t.sensor_config_ns/1e6, t.mag_init_ns/1e6);
+		printf("firmware %.1f + verify %.1f, dmp %.1f, total %.1f\n", \
+			t.firmware_load_ns/1e6, t.firmware_verify_ns/1e6, \
+			t.dmp_config_ns/1e6, t.total_ns/1e6);
+	}
 	// write labels for what data will be printed and associate the interrupt
 	// function to print data immediately after the header.
 	__print_header();
@@ -10,11 +10,15 @@
  * If the values you read are not normalized between +-1, then you should run
  * the rc_calibrate_dsm example to save your particular transmitter's min and
  * max channel values.
+ *
+ * SBUS and CRSF receivers connected to the DSM port can be read with the -p
+ * option instead.
  */
 
 #include <stdio.h>
 #include <signal.h>
 #include <getopt.h>
+#include <string.h>
 #include <rc/dsm.h>
 #include <rc/time.h>
 
@@ -34,6 +38,7 @@ static void __print_usage(void)
 	printf("\n");
 	printf("-r	print raw channel values in microseconds\n");
 	printf("-n	print normalized channel values/s\n");
+	printf("-p {protocol}	receiver protocol: dsm (default), sbus or crsf\n");
 	printf("-h	print this help message\n");
 	printf("\n");
 }
@@ -71,11 +76,12 @@ static void __new_dsm_data_callback(void)
 int main(int argc, char *argv[])
 {
 	int c;
+	rc_input_protocol_t protocol = RC_INPUT_DSM;
 	print_mode = P_MODE_NONE;
 
 	// parse arguments
 	opterr = 0;
-	while ((c = getopt(argc, argv, "rnh")) != -1){
+	while ((c = getopt(argc, argv, "rnp:h")) != -1){
 		switch (c){
 		case 'r':
 			if(print_mode!=P_MODE_NONE){
@@ -93,6 +99,15 @@ int main(int argc, char *argv[])
 			}
 			print_mode = P_MODE_NORM;
 			break;
+		case 'p':
+			if(strcmp(optarg, "dsm")==0) protocol = RC_INPUT_DSM;
+			else if(strcmp(optarg, "sbus")==0) protocol = RC_INPUT_SBUS;
+			else if(strcmp(optarg, "crsf")==0) protocol = RC_INPUT_CRSF;
+			else{
+				fprintf(stderr,"invalid protocol\n");
+				__print_usage();
+				return -1;
+			}
 			break;
 		case 'h':
 			__print_usage();
@@ -111,6 +126,7 @@ int main(int argc, char *argv[])
 	}
 
 
+	if(rc_dsm_set_protocol(protocol)) return -1;
 	if(rc_dsm_init()) return -1;
 
 	printf("\n");
@@ -0,0 +1,227 @@
+/**
+ * @file rc_test_sim_bmp.c
+ * @example    rc_test_sim_bmp
+ *
+ * @brief      checks rc_bmp against the simulated BMP280
+ *
+ *             Enables the simulation from <rc/sim.h> so it runs on any Linux
+ *             machine, then times barometer reads and runs the background
+ *             barometer sampler alongside the DMP, checking the readings
+ *             against the pressure and temperature fed to the simulated
+ *             sensor. Prints PASSED or ERROR for each check and returns
+ *             nonzero if any failed.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <stdlib.h> // for atoi
+#include <unistd.h> // for dup()
+#include <math.h>
+#include <rc/time.h>
+#include <rc/bmp.h>
+#include <rc/mpu.h>
+#include <rc/sim.h>
+
+#define DEFAULT_READS	1000
+#define PRESSURE_PA	95000.0
+#define TEMP_C		20.0
+#define PRESSURE_TOL	5.0	// Pa
+#define TEMP_TOL	0.05	// C
+#define DMP_RATE	200
+#define SAMPLER_RATE	25
+#define SAMPLER_SECONDS	2
+#define RATE_TOL	0.2	// fraction the sampler rate may be off by
+#define MAX_AGE_PERIODS	3	// how many sampler periods old the latest sample may be
+#define LOG_LEN		4096
+
+#define TIMER rc_nanos_since_boot()
+
+static int failures = 0;
+static int saved_stderr;
+static FILE* captured = NULL;
+
+
+static void __print_usage(void)
+{
+	printf("\n");
+	printf("-n {reads}    number of barometer reads to time, default %d\n", DEFAULT_READS);
+	printf("-h            print this help message\n");
+	printf("\n");
+}
+
+
+/**
+ * prints the result of one check the same way rc_test_drivers does
+ */
+static void __check(int ok, const char* name)
+{
+	if(ok) printf("PASSED: %s\n", name);
+	else{
+		printf("ERROR:  %s\n", name);
+		failures++;
+	}
+	return;
+}
+
+
+/**
+ * sends stderr to a temporary file until __stderr_release() so the warnings
+ * about missing calibration files stay out of the output
+ */
+static void __stderr_capture(void)
+{
+	fflush(stderr);
+	captured = tmpfile();
+	if(captured==NULL) return;
+	saved_stderr = dup(STDERR_FILENO);
+	if(saved_stderr==-1 || dup2(fileno(captured), STDERR_FILENO)==-1){
+		fclose(captured);
+		captured = NULL;
+	}
+	return;
+}
+
+
+/**
+ * puts stderr back and copies out what was written to it meanwhile
+ */
+static void __stderr_release(char* buf, size_t len)
+{
+	size_t n;
+	buf[0] = 0;
+	if(captured==NULL) return;
+	fflush(stderr);
+	dup2(saved_stderr, STDERR_FILENO);
+	close(saved_stderr);
+	rewind(captured);
+	n = fread(buf, 1, len-1, captured);
+	buf[n] = 0;
+	fclose(captured);
+	captured = NULL;
+	return;
+}
+
+
+static int __test_read(int n)
+{
+	int i;
+	uint64_t t1, t2;
+	rc_bmp_data_t data;
+
+	if(rc_sim_bmp_set(PRESSURE_PA, TEMP_C)) return -1;
+	t1 = TIMER;
+	if(rc_bmp_init(BMP_OVERSAMPLE_1, BMP_FILTER_OFF)) return -1;
+	t2 = TIMER;
+	printf("bmp init        %8.1f us\n", (double)(t2-t1)/1000.0);
+
+	t1 = TIMER;
+	for(i=0;i<n;i++){
+		if(rc_bmp_read(&data)){
+			rc_bmp_power_off();
+			return -1;
+		}
+	}
+	t2 = TIMER;
+	printf("bmp read        %8.1f us/read  %.1fPa %.2fC (set %.1fPa %.2fC)\n",
+		(double)(t2-t1)/n/1000.0, data.pressure_pa, data.temp_c, PRESSURE_PA, TEMP_C);
+	__check(fabs(data.pressure_pa-PRESSURE_PA)<PRESSURE_TOL &&
+		fabs(data.temp_c-TEMP_C)<TEMP_TOL, "bmp read");
+	rc_bmp_power_off();
+	return 0;
+}
+
+
+/**
+ * the sampler should fit its reads in the gaps between IMU interrupts
+ */
+static int __test_sampler(void)
+{
+	char log[LOG_LEN];
+	int ret;
+	double rate, age_ms;
+	rc_bmp_sample_t sample;
+	rc_bmp_sampler_stats_t stats;
+	rc_bmp_sampler_config_t bmp_conf = rc_bmp_sampler_default_config();
+	rc_mpu_data_t data;
+	rc_mpu_config_t mpu_conf = rc_mpu_default_config();
+
+	if(rc_sim_bmp_set(PRESSURE_PA, TEMP_C)) return -1;
+	if(rc_bmp_init(BMP_OVERSAMPLE_4, BMP_FILTER_OFF)) return -1;
+	mpu_conf.dmp_sample_rate = DMP_RATE;
+	__stderr_capture();
+	ret = rc_mpu_initialize_dmp(&data, mpu_conf);
+	__stderr_release(log, sizeof(log));
+	if(ret){
+		fprintf(stderr, "%s", log);
+		rc_bmp_power_off();
+		return -1;
+	}
+	bmp_conf.rate_hz = SAMPLER_RATE;
+	if(rc_bmp_sampler_start(bmp_conf)){
+		rc_bmp_power_off();
+		rc_mpu_power_off();
+		return -1;
+	}
+	rc_usleep(SAMPLER_SECONDS*1000000);
+
+	ret = rc_bmp_sampler_get_latest(&sample);
+	rc_bmp_sampler_get_stats(&stats);
+	rate = (double)stats.reads/SAMPLER_SECONDS;
+	age_ms = (double)(TIMER-sample.timestamp_ns)/1000000.0;
+	rc_bmp_power_off();
+	rc_mpu_power_off();
+	if(ret) return -1;
+
+	printf("bmp sampler     %8.1f Hz (set %d)  %llu in IMU gaps, %llu not, %llu late\n",
+		rate, SAMPLER_RATE, (unsigned long long)stats.synced,
+		(unsigned long long)stats.unsynced, (unsigned long long)stats.late);
+	printf("bmp sampler     %8.1f us max read  latest %.1fPa %.1f ms old\n",
+		stats.max_read_ns/1000.0, sample.data.pressure_pa, age_ms);
+	__check(fabs(rate-SAMPLER_RATE)<RATE_TOL*SAMPLER_RATE, "bmp sampler rate");
+	__check(stats.synced>stats.unsynced, "bmp sampler reads in IMU gaps");
+	__check(fabs(sample.data.pressure_pa-PRESSURE_PA)<PRESSURE_TOL &&
+		age_ms<MAX_AGE_PERIODS*1000.0/SAMPLER_RATE, "bmp sampler latest");
+	return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int c;
+	int n = DEFAULT_READS;
+
+	// parse arguments
+	opterr = 0;
+	while ((c = getopt(argc, argv, "n:h")) != -1){
+		switch (c){
+		case 'n':
+			n = atoi(optarg);
+			if(n<1){
+				printf("number of reads must be >= 1\n");
+				return -1;
+			}
+			break;
+		case 'h':
+			__print_usage();
+			return 0;
+		default:
+			__print_usage();
+			return -1;
+		}
+	}
+
+	if(rc_sim_enable()){
+		fprintf(stderr,"ERROR failed to enable simulation\n");
+		return -1;
+	}
+	printf("\n");
+	// a test that can't get going counts as one failed check
+	if(__test_read(n)) __check(0, "bmp read setup");
+	if(__test_sampler()) __check(0, "bmp sampler setup");
+	printf("\n");
+	return failures ? -1 : 0;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file rc_test_sim_gpio.c
+ * @example    rc_test_sim_gpio
+ *
+ * @brief      checks gpio groups against the simulated gpio lines
+ *
+ *             Enables the simulation from <rc/sim.h> so it runs on any Linux
+ *             machine, then makes masked writes to a gpio group and single
+ *             pin calls on its pins, checking only the lines asked for
+ *             change. Prints PASSED or ERROR for each check and returns
+ *             nonzero if any failed.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <rc/gpio.h>
+#include <rc/sim.h>
+
+#define CHIP	3
+
+static int failures = 0;
+
+
+/**
+ * prints the result of one check the same way rc_test_drivers does
+ */
+static void __check(int ok, const char* name)
+{
+	if(ok) printf("PASSED: %s\n", name);
+	else{
+		printf("ERROR:  %s\n", name);
+		failures++;
+	}
+	return;
+}
+
+
+/**
+ * masked writes to a gpio group only change the lines asked for
+ */
+static int __test_group(void)
+{
+	const int pins[3] = {1, 2, 5};
+	rc_gpio_group_t group;
+	uint64_t values;
+	int l1, l2, l5, get;
+
+	if(rc_gpio_group_init(&group, CHIP, pins, 3, GPIOHANDLE_REQUEST_OUTPUT)) return -1;
+	if(rc_gpio_group_set_values(&group, 0x5, 0x1) ||
+	   rc_gpio_group_set_values(&group, 0x2, 0x2) ||
+	   rc_gpio_group_get_values(&group, &values)){
+		rc_gpio_group_cleanup(&group);
+		return -1;
+	}
+	l1 = rc_sim_gpio_get(CHIP, 1);
+	l2 = rc_sim_gpio_get(CHIP, 2);
+	l5 = rc_sim_gpio_get(CHIP, 5);
+	printf("gpio group      values 0x%llx (expect 0x3), lines %d%d%d (expect 110)\n",
+		(unsigned long long)values, l1, l2, l5);
+	__check(values==0x3 && l1==1 && l2==1 && l5==0, "gpio group masked writes");
+
+	// single pin calls still reach a grouped pin and leave its neighbours
+	if(rc_gpio_set_value(CHIP, 5, 1) || rc_gpio_set_value(CHIP, 1, 0)){
+		rc_gpio_group_cleanup(&group);
+		return -1;
+	}
+	l1 = rc_sim_gpio_get(CHIP, 1);
+	l2 = rc_sim_gpio_get(CHIP, 2);
+	l5 = rc_sim_gpio_get(CHIP, 5);
+	get = rc_gpio_get_value(CHIP, 5);
+	printf("gpio group pin  set 5 clear 1, lines %d%d%d (expect 011), get 5 %d\n",
+		l1, l2, l5, get);
+	__check(l1==0 && l2==1 && l5==1 && get==1, "gpio single pin calls on a group");
+	rc_gpio_group_cleanup(&group);
+	return 0;
+}
+
+
+int main()
+{
+	if(rc_sim_enable()){
+		fprintf(stderr,"ERROR failed to enable simulation\n");
+		return -1;
+	}
+	printf("\n");
+	// a test that can't get going counts as one failed check
+	if(__test_group()) __check(0, "gpio group setup");
+	printf("\n");
+	return failures ? -1 : 0;
+}
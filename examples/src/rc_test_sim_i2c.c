@@ -0,0 +1,229 @@
+/**
+ * @file rc_test_sim_i2c.c
+ * @example    rc_test_sim_i2c
+ *
+ * @brief      checks asynchronous I2C transactions against a simulated
+ *             register device
+ *
+ *             Enables the simulation from <rc/sim.h> so it runs on any Linux
+ *             machine, attaches a register device to I2C bus 1 and queues a
+ *             write, a run of reads the bus thread can merge and one read of
+ *             an address nothing answers at. The reads must return what was
+ *             written and only the read of the missing device may fail. The
+ *             errors rc_i2c prints for that read are caught and checked
+ *             rather than shown. Prints PASSED or ERROR for each check and
+ *             returns nonzero if any failed.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h> // for dup()
+#include <rc/time.h>
+#include <rc/i2c.h>
+#include <rc/bus_async.h>
+#include <rc/sim.h>
+
+#define I2C_REGS	128
+#define ASYNC_BUS	1
+#define ASYNC_ADDR	0x50
+#define ASYNC_MISSING	0x51	// nothing attached here, reads NACK
+#define ASYNC_READS	8
+#define NACK_ERROR	"I2C_RDWR transaction failed"
+#define LOG_LEN		4096
+
+#define TIMER rc_nanos_since_boot()
+
+static int failures = 0;
+static int saved_stderr;
+static FILE* captured = NULL;
+static uint8_t i2c_reg[I2C_REGS];
+static int i2c_ptr;
+
+
+/**
+ * prints the result of one check the same way rc_test_drivers does
+ */
+static void __check(int ok, const char* name)
+{
+	if(ok) printf("PASSED: %s\n", name);
+	else{
+		printf("ERROR:  %s\n", name);
+		failures++;
+	}
+	return;
+}
+
+
+/**
+ * sends stderr to a temporary file until __stderr_release() so the errors the
+ * test provokes can be checked instead of shown
+ */
+static void __stderr_capture(void)
+{
+	fflush(stderr);
+	captured = tmpfile();
+	if(captured==NULL) return;
+	saved_stderr = dup(STDERR_FILENO);
+	if(saved_stderr==-1 || dup2(fileno(captured), STDERR_FILENO)==-1){
+		fclose(captured);
+		captured = NULL;
+	}
+	return;
+}
+
+
+/**
+ * puts stderr back and copies out what was written to it meanwhile
+ */
+static void __stderr_release(char* buf, size_t len)
+{
+	size_t n;
+	buf[0] = 0;
+	if(captured==NULL) return;
+	fflush(stderr);
+	dup2(saved_stderr, STDERR_FILENO);
+	close(saved_stderr);
+	rewind(captured);
+	n = fread(buf, 1, len-1, captured);
+	buf[n] = 0;
+	fclose(captured);
+	captured = NULL;
+	return;
+}
+
+
+/**
+ * counts the lines of log that contain str and returns -1 if any other line
+ * is there
+ */
+static int __count_lines(const char* log, const char* str)
+{
+	const char* end;
+	int n = 0;
+	while(*log){
+		end = strchr(log, '\n');
+		if(end==NULL) end = log+strlen(log);
+		if(end>log){
+			if(strstr(log, str)==NULL || strstr(log, str)>end) return -1;
+			n++;
+		}
+		log = *end ? end+1 : end;
+	}
+	return n;
+}
+
+
+static int __i2c_device_write(__attribute__ ((unused)) void* ctx, const uint8_t* data, size_t len)
+{
+	size_t i;
+	if(len==0) return 0;
+	i2c_ptr = data[0] % I2C_REGS;
+	for(i=1;i<len;i++,i2c_ptr=(i2c_ptr+1)%I2C_REGS) i2c_reg[i2c_ptr] = data[i];
+	return 0;
+}
+
+
+static int __i2c_device_read(__attribute__ ((unused)) void* ctx, uint8_t* data, size_t len)
+{
+	size_t i;
+	for(i=0;i<len;i++,i2c_ptr=(i2c_ptr+1)%I2C_REGS) data[i] = i2c_reg[i2c_ptr];
+	return 0;
+}
+
+
+static int __test_bus_async(void)
+{
+	int i, ret, nacks, errors = 0;
+	uint64_t t1, t2;
+	uint8_t wr[2] = {0xA5, 0x5A};
+	uint8_t buf[ASYNC_READS][2], missing;
+	char log[LOG_LEN];
+	rc_bus_async_t w, r[ASYNC_READS], m;
+	rc_bus_async_stats_t stats;
+
+	if(rc_sim_i2c_attach(ASYNC_BUS, ASYNC_ADDR, __i2c_device_write, __i2c_device_read, NULL)) return -1;
+	if(rc_i2c_init(ASYNC_BUS, ASYNC_ADDR)){
+		rc_sim_i2c_detach(ASYNC_BUS, ASYNC_ADDR);
+		return -1;
+	}
+	for(i=0;i<I2C_REGS;i++) i2c_reg[i] = i;
+	if(rc_bus_async_start(RC_BUS_I2C, ASYNC_BUS, rc_bus_async_default_config())){
+		rc_i2c_close(ASYNC_BUS);
+		rc_sim_i2c_detach(ASYNC_BUS, ASYNC_ADDR);
+		return -1;
+	}
+
+	// a write, a run of background reads that can be merged, and one read
+	// of a device that isn't there which must fail on its own
+	memset(&w, 0, sizeof(w));
+	w.op = RC_BUS_ASYNC_I2C_WRITE;
+	w.priority = RC_BUS_ASYNC_NORMAL;
+	w.dev_addr = ASYNC_ADDR;
+	w.reg_addr = 0x20;
+	w.count = 2;
+	w.data = wr;
+	memset(r, 0, sizeof(r));
+	for(i=0;i<ASYNC_READS;i++){
+		r[i].op = RC_BUS_ASYNC_I2C_READ;
+		r[i].dev_addr = ASYNC_ADDR;
+		r[i].reg_addr = 0x20 + 2*i;
+		r[i].count = 2;
+		r[i].data = buf[i];
+	}
+	m = r[0];
+	m.dev_addr = ASYNC_MISSING;
+	m.data = &missing;
+	m.count = 1;
+
+	__stderr_capture();
+	t1 = TIMER;
+	ret = rc_bus_async_submit(RC_BUS_I2C, ASYNC_BUS, &w);
+	for(i=0;i<ASYNC_READS;i++) ret |= rc_bus_async_submit(RC_BUS_I2C, ASYNC_BUS, &r[i]);
+	ret |= rc_bus_async_submit(RC_BUS_I2C, ASYNC_BUS, &m);
+	t2 = TIMER;
+	if(ret==0){
+		if(rc_bus_async_wait(&w, 0)) errors++;
+		for(i=0;i<ASYNC_READS;i++) if(rc_bus_async_wait(&r[i], 0)) errors++;
+		if(rc_bus_async_wait(&m, 0)!=-1) errors++;
+		if(buf[0][0]!=wr[0] || buf[0][1]!=wr[1]) errors++;
+		for(i=1;i<ASYNC_READS;i++) if(buf[i][0]!=0x20+2*i) errors++;
+	}
+	rc_bus_async_get_stats(RC_BUS_I2C, ASYNC_BUS, &stats);
+	rc_bus_async_stop(RC_BUS_I2C, ASYNC_BUS);
+	__stderr_release(log, sizeof(log));
+	rc_i2c_close(ASYNC_BUS);
+	rc_sim_i2c_detach(ASYNC_BUS, ASYNC_ADDR);
+	if(ret){
+		fprintf(stderr, "%s", log);
+		return -1;
+	}
+
+	// the missing device NACKs, as part of a merged batch and again on its
+	// own, rc_i2c reports each of those and nothing else
+	nacks = __count_lines(log, NACK_ERROR);
+	printf("bus async       %8.1f us/submit  %d transactions in %llu calls, %d errors, %d NACKs reported\n",
+		(double)(t2-t1)/(ASYNC_READS+2)/1000.0, ASYNC_READS+2,
+		(unsigned long long)stats.calls, errors, nacks);
+	__check(errors==0, "bus async results");
+	__check(nacks>0, "bus async missing device reported");
+	if(nacks<0) fprintf(stderr, "%s", log);
+	return 0;
+}
+
+
+int main()
+{
+	if(rc_sim_enable()){
+		fprintf(stderr,"ERROR failed to enable simulation\n");
+		return -1;
+	}
+	printf("\n");
+	// a test that can't get going counts as one failed check
+	if(__test_bus_async()) __check(0, "bus async setup");
+	printf("\n");
+	return failures ? -1 : 0;
+}
@@ -0,0 +1,230 @@
+/**
+ * @file rc_test_sim_mpu.c
+ * @example    rc_test_sim_mpu
+ *
+ * @brief      checks rc_mpu against the simulated MPU-9250
+ *
+ *             Enables the simulation from <rc/sim.h> so it runs on any Linux
+ *             machine, then measures the DMP callback rate and checks the DMP
+ *             tilt against the orientation fed to the simulated sensor, runs
+ *             an inline subscriber that unsubscribes itself, times the fast
+ *             start, and reads the magnetometer through the MPU's i2c master
+ *             in DMP and AHRS mode. Prints PASSED or ERROR for each check and
+ *             returns nonzero if any failed.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h> // for dup()
+#include <math.h>
+#include <rc/time.h>
+#include <rc/math.h>
+#include <rc/mpu.h>
+#include <rc/sim.h>
+
+#define DMP_RATE	200
+#define DMP_SECONDS	2
+#define SUB_CALLS	20	// inline subscriber unsubscribes itself after this many
+#define RATE_TOL	0.2	// fraction the callback rate may be off by
+#define TILT_TOL	0.02	// rad the DMP tilt may be off by with the default noise
+#define MAG_TOL		0.5	// uT
+#define LOG_LEN		4096
+
+#define TIMER rc_nanos_since_boot()
+
+static int failures = 0;
+static int saved_stderr;
+static FILE* captured = NULL;
+static volatile int dmp_callbacks;
+static volatile int sub_id, sub_calls, sub_stats_read;
+
+
+/**
+ * prints the result of one check the same way rc_test_drivers does
+ */
+static void __check(int ok, const char* name)
+{
+	if(ok) printf("PASSED: %s\n", name);
+	else{
+		printf("ERROR:  %s\n", name);
+		failures++;
+	}
+	return;
+}
+
+
+/**
+ * sends stderr to a temporary file until __stderr_release() so the warnings
+ * about missing calibration files stay out of the output
+ */
+static void __stderr_capture(void)
+{
+	fflush(stderr);
+	captured = tmpfile();
+	if(captured==NULL) return;
+	saved_stderr = dup(STDERR_FILENO);
+	if(saved_stderr==-1 || dup2(fileno(captured), STDERR_FILENO)==-1){
+		fclose(captured);
+		captured = NULL;
+	}
+	return;
+}
+
+
+/**
+ * puts stderr back and copies out what was written to it meanwhile
+ */
+static void __stderr_release(char* buf, size_t len)
+{
+	size_t n;
+	buf[0] = 0;
+	if(captured==NULL) return;
+	fflush(stderr);
+	dup2(saved_stderr, STDERR_FILENO);
+	close(saved_stderr);
+	rewind(captured);
+	n = fread(buf, 1, len-1, captured);
+	buf[n] = 0;
+	fclose(captured);
+	captured = NULL;
+	return;
+}
+
+
+/**
+ * initializes the MPU with the calibration warnings silenced, anything printed
+ * is passed on if it fails
+ */
+static int __init_quiet(rc_mpu_data_t* data, rc_mpu_config_t conf, int ahrs)
+{
+	char log[LOG_LEN];
+	int ret;
+	__stderr_capture();
+	if(ahrs) ret = rc_mpu_initialize_ahrs(data, conf);
+	else ret = rc_mpu_initialize_dmp(data, conf);
+	__stderr_release(log, sizeof(log));
+	if(ret) fprintf(stderr, "%s", log);
+	return ret;
+}
+
+
+static void __dmp_callback(void)
+{
+	dmp_callbacks++;
+	return;
+}
+
+
+/**
+ * inline subscriber that checks its own stats and unsubscribes itself, both
+ * from inside the callback
+ */
+static void __subscriber(__attribute__ ((unused)) const rc_mpu_data_t* data, __attribute__ ((unused)) void* ctx)
+{
+	rc_mpu_subscriber_stats_t stats;
+	sub_calls++;
+	if(rc_mpu_get_subscriber_stats(sub_id, &stats)==0) sub_stats_read++;
+	if(sub_calls==SUB_CALLS) rc_mpu_unsubscribe(sub_id);
+	return;
+}
+
+
+static int __test_dmp(void)
+{
+	uint64_t t1, t2, slow_ns;
+	double tb[3] = {0.2, -0.1, 0.5};
+	double q[4], rate;
+	rc_mpu_data_t data;
+	rc_mpu_config_t conf = rc_mpu_default_config();
+
+	rc_quaternion_from_tb_array(tb, q);
+	if(rc_sim_mpu_set_motion(q, NULL, NULL)) return -1;
+
+	conf.dmp_sample_rate = DMP_RATE;
+	t1 = TIMER;
+	if(__init_quiet(&data, conf, 0)) return -1;
+	t2 = TIMER;
+	slow_ns = t2-t1;
+	printf("dmp init        %8.1f ms\n", (double)slow_ns/1000000.0);
+
+	rc_mpu_set_dmp_callback(__dmp_callback);
+	dmp_callbacks = 0;
+	sub_calls = 0;
+	sub_stats_read = 0;
+	sub_id = rc_mpu_subscribe(__subscriber, NULL, rc_mpu_subscriber_default_config());
+	if(sub_id<0){
+		rc_mpu_power_off();
+		return -1;
+	}
+	rc_usleep(DMP_SECONDS*1000000);
+	rate = (double)dmp_callbacks/DMP_SECONDS;
+	// the DMP only fuses gyro and accel so its heading starts from 0
+	printf("dmp callbacks   %8.1f Hz (set %d)  tb %.3f %.3f %.3f (set %.3f %.3f, heading from 0)\n",
+		rate, DMP_RATE, data.dmp_TaitBryan[TB_PITCH_X], data.dmp_TaitBryan[TB_ROLL_Y],
+		data.dmp_TaitBryan[TB_YAW_Z], tb[0], tb[1]);
+	__check(fabs(rate-DMP_RATE)<RATE_TOL*DMP_RATE, "dmp callback rate");
+	__check(fabs(data.dmp_TaitBryan[TB_PITCH_X]-tb[0])<TILT_TOL &&
+		fabs(data.dmp_TaitBryan[TB_ROLL_Y]-tb[1])<TILT_TOL, "dmp tilt");
+	printf("mpu subscriber  %8d calls (expect %d), stats read %d times from the callback\n",
+		sub_calls, SUB_CALLS, sub_stats_read);
+	__check(sub_calls==SUB_CALLS && sub_stats_read==SUB_CALLS, "mpu subscriber");
+	rc_mpu_power_off();
+
+	// fast start polls through the simulated reset instead of sleeping
+	conf.fast_start = 1;
+	t1 = TIMER;
+	if(__init_quiet(&data, conf, 0)) return -1;
+	t2 = TIMER;
+	printf("dmp fast init   %8.1f ms\n", (double)(t2-t1)/1000000.0);
+	__check(t2-t1<slow_ns, "dmp fast init");
+	rc_mpu_power_off();
+	return 0;
+}
+
+
+/**
+ * magnetometer sampled by the MPU's i2c master, read in the same burst as the
+ * DMP FIFO or the AHRS accel/gyro block
+ */
+static int __test_mag_i2c_master(int ahrs)
+{
+	int i, ok = 1;
+	double mag[3] = {20.0, -10.0, 40.0};
+	rc_mpu_data_t data;
+	rc_mpu_config_t conf = rc_mpu_default_config();
+
+	if(rc_sim_mpu_set_mag(mag)) return -1;
+	conf.dmp_sample_rate = DMP_RATE;
+	conf.ahrs_sample_rate = DMP_RATE;
+	conf.enable_magnetometer = 1;
+	conf.mag_use_i2c_master = 1;
+	memset(&data, 0, sizeof(data));
+	if(__init_quiet(&data, conf, ahrs)) return -1;
+	rc_usleep(500000);
+	printf("%s mag master %6.1f %6.1f %6.1f uT (set %.1f %.1f %.1f)\n", ahrs ? "ahrs" : "dmp ",
+		data.mag[0], data.mag[1], data.mag[2], mag[0], mag[1], mag[2]);
+	for(i=0;i<3;i++) if(fabs(data.mag[i]-mag[i])>MAG_TOL) ok = 0;
+	__check(ok, ahrs ? "ahrs mag i2c master" : "dmp mag i2c master");
+	rc_mpu_power_off();
+	return 0;
+}
+
+
+int main()
+{
+	if(rc_sim_enable()){
+		fprintf(stderr,"ERROR failed to enable simulation\n");
+		return -1;
+	}
+	printf("\n");
+	// a test that can't get going counts as one failed check
+	if(__test_dmp()) __check(0, "dmp setup");
+	if(__test_mag_i2c_master(0)) __check(0, "dmp mag i2c master setup");
+	if(__test_mag_i2c_master(1)) __check(0, "ahrs mag i2c master setup");
+	printf("\n");
+	return failures ? -1 : 0;
+}
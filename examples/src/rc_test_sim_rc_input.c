@@ -0,0 +1,327 @@
+/**
+ * @file rc_test_sim_rc_input.c
+ * @example    rc_test_sim_rc_input
+ *
+ * @brief      checks rc_dsm and the rc_input decoders against a simulated
+ *             receiver
+ *
+ *             Enables the simulation from <rc/sim.h> so it runs on any Linux
+ *             machine, then decodes a DSM stream and checks it recovers from
+ *             dropped bytes and line noise, decodes recorded SBUS and CRSF
+ *             streams and reads CRSF through the DSM service. Prints PASSED or
+ *             ERROR for each check and returns nonzero if any failed.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h> // for abs
+#include <unistd.h> // for dup()
+#include <rc/time.h>
+#include <rc/dsm.h>
+#include <rc/rc_input.h>
+#include <rc/sim.h>
+
+#define DSM_CHANNELS	8
+#define DSM_TIMEOUT_US	1000000
+#define DSM_UART_BUS	4	// where the simulated satellite sends
+#define DSM_DROP	3	// bytes left off one frame in the resync test
+#define RCIN_FRAMES	10	// frames in each recorded stream
+#define RCIN_PERIOD_US	4000	// CRSF frame period
+#define LINK_QUALITY	87	// sent through the DSM service
+#define LOG_LEN		4096
+
+#define TIMER rc_nanos_since_boot()
+
+static int failures = 0;
+static int saved_stderr;
+static FILE* captured = NULL;
+static int rcin_frames, rcin_bad, rcin_link_quality;
+
+
+/**
+ * prints the result of one check the same way rc_test_drivers does
+ */
+static void __check(int ok, const char* name)
+{
+	if(ok) printf("PASSED: %s\n", name);
+	else{
+		printf("ERROR:  %s\n", name);
+		failures++;
+	}
+	return;
+}
+
+
+/**
+ * sends stderr to a temporary file until __stderr_release() so the warning
+ * about a missing calibration file stays out of the output
+ */
+static void __stderr_capture(void)
+{
+	fflush(stderr);
+	captured = tmpfile();
+	if(captured==NULL) return;
+	saved_stderr = dup(STDERR_FILENO);
+	if(saved_stderr==-1 || dup2(fileno(captured), STDERR_FILENO)==-1){
+		fclose(captured);
+		captured = NULL;
+	}
+	return;
+}
+
+
+/**
+ * puts stderr back and copies out what was written to it meanwhile
+ */
+static void __stderr_release(char* buf, size_t len)
+{
+	size_t n;
+	buf[0] = 0;
+	if(captured==NULL) return;
+	fflush(stderr);
+	dup2(saved_stderr, STDERR_FILENO);
+	close(saved_stderr);
+	rewind(captured);
+	n = fread(buf, 1, len-1, captured);
+	buf[n] = 0;
+	fclose(captured);
+	captured = NULL;
+	return;
+}
+
+
+/**
+ * starts the DSM service with the calibration warning silenced, anything
+ * printed is passed on if it fails
+ */
+static int __dsm_init_quiet(void)
+{
+	char log[LOG_LEN];
+	int ret;
+	__stderr_capture();
+	ret = rc_dsm_init();
+	__stderr_release(log, sizeof(log));
+	if(ret) fprintf(stderr, "%s", log);
+	return ret;
+}
+
+
+static int __test_dsm(void)
+{
+	int i, errors = 0;
+	int pulse[DSM_CHANNELS];
+	uint8_t junk[5] = {0x00, 0x12, 0xFF, 0x34, 0x56};
+	uint64_t t1, t2;
+	rc_dsm_stats_t before, after;
+	rc_dsm_frame_t frame;
+
+	for(i=0;i<DSM_CHANNELS;i++) pulse[i] = 1100 + 100*i;
+	if(__dsm_init_quiet()) return -1;
+	if(rc_sim_dsm_set_channels(pulse, DSM_CHANNELS)){
+		rc_dsm_cleanup();
+		return -1;
+	}
+
+	t1 = TIMER;
+	do{
+		rc_usleep(1000);
+		t2 = TIMER;
+		if(t2-t1 > (uint64_t)DSM_TIMEOUT_US*1000){
+			fprintf(stderr,"ERROR timed out waiting for DSM data\n");
+			rc_sim_dsm_set_channels(NULL, 0);
+			rc_dsm_cleanup();
+			return -1;
+		}
+	}while(!rc_dsm_is_new_data() || rc_dsm_channels()<DSM_CHANNELS);
+	printf("dsm first data  %8.1f ms\n", (double)(t2-t1)/1000000.0);
+
+	// 2048 mode halves the resolution of the pulse width so allow 1us
+	if(rc_dsm_get_frame(&frame)){
+		rc_sim_dsm_set_channels(NULL, 0);
+		rc_dsm_cleanup();
+		return -1;
+	}
+	for(i=0;i<DSM_CHANNELS;i++){
+		if(abs(frame.raw[i]-pulse[i])>1) errors++;
+	}
+	printf("dsm channels    %8d of %d match  frame %llu  %.1f ms old  ch1 %.3f\n",
+		DSM_CHANNELS-errors, DSM_CHANNELS, (unsigned long long)frame.count,
+		(double)(rc_nanos_since_boot()-frame.timestamp_ns)/1000000.0,
+		frame.normalized[0]);
+	__check(errors==0, "dsm channels");
+
+	// a frame with bytes missing, then line noise between frames, each
+	// should cost no more than the frame it hits and the one after
+	rc_dsm_get_stats(&before);
+	rc_sim_dsm_drop_bytes(DSM_DROP);
+	rc_usleep(50000);
+	rc_sim_uart_send(DSM_UART_BUS, junk, sizeof(junk));
+	rc_usleep(100000);
+	rc_dsm_get_stats(&after);
+	errors = 0;
+	for(i=0;i<DSM_CHANNELS;i++){
+		if(abs(rc_dsm_ch_raw(i+1)-pulse[i])>1) errors++;
+	}
+	printf("dsm resync      %8d of %d match after, %llu broken, %llu lost, %llu bytes skipped, %.1f ms period\n",
+		DSM_CHANNELS-errors, DSM_CHANNELS,
+		(unsigned long long)(after.broken-before.broken),
+		(unsigned long long)(after.lost-before.lost),
+		(unsigned long long)(after.skipped-before.skipped),
+		(double)after.period_ns/1000000.0);
+	__check(errors==0 && after.broken>before.broken, "dsm resync");
+	rc_sim_dsm_set_channels(NULL, 0);
+	rc_dsm_cleanup();
+	return 0;
+}
+
+
+/**
+ * pulse widths sent in recorded frame n
+ */
+static void __rcin_pulses(int* raw, int n)
+{
+	int i;
+	for(i=0;i<RC_INPUT_MAX_CHANNELS;i++) raw[i] = 1000 + 60*i + n;
+	return;
+}
+
+
+static void __rcin_channels(const rc_input_channels_t* ch, __attribute__ ((unused)) void* ctx)
+{
+	int i, raw[RC_INPUT_MAX_CHANNELS];
+	__rcin_pulses(raw, rcin_frames);
+	for(i=0;i<RC_INPUT_MAX_CHANNELS;i++) if(ch->raw[i]!=raw[i]) rcin_bad++;
+	rcin_frames++;
+	return;
+}
+
+
+static void __rcin_link_stats(const rc_input_link_stats_t* s, __attribute__ ((unused)) void* ctx)
+{
+	rcin_link_quality = s->uplink_link_quality;
+	return;
+}
+
+
+/**
+ * Builds a stream of frames like a capture from a noisy line, with junk
+ * between frames and one frame corrupted, then feeds it to a decoder in
+ * uneven chunks. Every frame but the corrupted one should come out intact.
+ */
+static void __test_stream(rc_input_protocol_t protocol)
+{
+	uint8_t stream[RCIN_FRAMES*(RC_INPUT_MAX_FRAME+4)];
+	uint8_t junk[3] = {0x0F, 0xC8, 0x18};
+	int raw[RC_INPUT_MAX_CHANNELS];
+	int i, n, len = 0;
+	size_t pos, chunk;
+	rc_input_decoder_t dec;
+	rc_input_link_stats_t ls;
+	const char* name = protocol==RC_INPUT_SBUS ? "sbus" : "crsf";
+
+	memset(&ls, 0, sizeof(ls));
+	ls.uplink_rssi_1 = -60;
+	ls.uplink_link_quality = 98;
+	ls.uplink_tx_power_mw = 100;
+	for(i=0;i<RCIN_FRAMES;i++){
+		// the corrupted frame carries no new values, number the rest
+		// in the order they should come out
+		__rcin_pulses(raw, i<RCIN_FRAMES/2 ? i : i-1);
+		if(protocol==RC_INPUT_SBUS) n = rc_input_sbus_encode(stream+len, raw, RC_INPUT_MAX_CHANNELS, 0);
+		else n = rc_input_crsf_encode_channels(stream+len, raw, RC_INPUT_MAX_CHANNELS);
+		if(i==RCIN_FRAMES/2) stream[len+n-1] ^= 0x5A;
+		len += n;
+		if(i%3==0){
+			memcpy(stream+len, junk, sizeof(junk));
+			len += sizeof(junk);
+		}
+		if(protocol==RC_INPUT_CRSF && i==2) len += rc_input_crsf_encode_link_stats(stream+len, &ls);
+	}
+
+	rc_input_decoder_init(&dec, protocol);
+	dec.channels_callback = __rcin_channels;
+	dec.link_stats_callback = __rcin_link_stats;
+	rcin_frames = 0;
+	rcin_bad = 0;
+	rcin_link_quality = 0;
+	for(pos=0, chunk=1; pos<(size_t)len; pos+=chunk, chunk=chunk%7+5){
+		if(pos+chunk>(size_t)len) chunk = len-pos;
+		rc_input_decoder_feed(&dec, stream+pos, chunk, 0);
+	}
+	printf("%s stream     %8d of %d frames, %d bad values, %llu errors, %llu bytes skipped",
+		name, rcin_frames, RCIN_FRAMES-1, rcin_bad,
+		(unsigned long long)dec.stats.errors, (unsigned long long)dec.stats.skipped);
+	if(protocol==RC_INPUT_CRSF) printf(", link quality %d", rcin_link_quality);
+	printf("\n");
+	__check(rcin_frames==RCIN_FRAMES-1 && rcin_bad==0 && dec.stats.errors>0 &&
+		(protocol!=RC_INPUT_CRSF || rcin_link_quality==ls.uplink_link_quality),
+		protocol==RC_INPUT_SBUS ? "sbus stream" : "crsf stream");
+	return;
+}
+
+
+/**
+ * sends CRSF frames from a simulated receiver on the DSM port and reads them
+ * back through the DSM service
+ */
+static int __test_service(void)
+{
+	uint8_t frame[RC_INPUT_MAX_FRAME];
+	int raw[RC_INPUT_MAX_CHANNELS];
+	int i, n, errors = 0;
+	rc_dsm_frame_t f;
+	rc_input_link_stats_t ls;
+	uint64_t sent_ns = 0;
+
+	if(rc_dsm_set_protocol(RC_INPUT_CRSF)) return -1;
+	if(__dsm_init_quiet()){
+		rc_dsm_set_protocol(RC_INPUT_DSM);
+		return -1;
+	}
+	memset(&ls, 0, sizeof(ls));
+	ls.uplink_link_quality = LINK_QUALITY;
+	__rcin_pulses(raw, 0);
+	for(i=0;i<RCIN_FRAMES;i++){
+		n = rc_input_crsf_encode_channels(frame, raw, RC_INPUT_MAX_CHANNELS);
+		sent_ns = rc_nanos_since_boot();
+		rc_sim_uart_send(DSM_UART_BUS, frame, n);
+		if(i==RCIN_FRAMES/2){
+			n = rc_input_crsf_encode_link_stats(frame, &ls);
+			rc_sim_uart_send(DSM_UART_BUS, frame, n);
+		}
+		rc_usleep(RCIN_PERIOD_US);
+	}
+	memset(&f, 0, sizeof(f));
+	memset(&ls, 0, sizeof(ls));
+	if(rc_dsm_get_frame(&f) || rc_dsm_get_link_stats(&ls)) errors++;
+	for(i=0;i<RC_INPUT_MAX_CHANNELS;i++) if(f.raw[i]!=raw[i]) errors++;
+	printf("crsf service    %8llu frames, %d channels, %d errors, link quality %d, %.0f us from send to publish\n",
+		(unsigned long long)f.count, f.channels, errors, ls.uplink_link_quality,
+		(double)(int64_t)(f.timestamp_ns-sent_ns)/1000.0);
+	__check(errors==0 && f.count==RCIN_FRAMES && ls.uplink_link_quality==LINK_QUALITY,
+		"crsf through the dsm service");
+	rc_dsm_cleanup();
+	rc_dsm_set_protocol(RC_INPUT_DSM);
+	return 0;
+}
+
+
+int main()
+{
+	if(rc_sim_enable()){
+		fprintf(stderr,"ERROR failed to enable simulation\n");
+		return -1;
+	}
+	printf("\n");
+	// a test that can't get going counts as one failed check
+	if(__test_dsm()) __check(0, "dsm setup");
+	__test_stream(RC_INPUT_SBUS);
+	__test_stream(RC_INPUT_CRSF);
+	if(__test_service()) __check(0, "crsf service setup");
+	printf("\n");
+	return failures ? -1 : 0;
+}
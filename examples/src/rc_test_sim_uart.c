@@ -0,0 +1,219 @@
+/**
+ * @file rc_test_sim_uart.c
+ * @example    rc_test_sim_uart
+ *
+ * @brief      checks the UART service and low latency reads against a
+ *             simulated uart
+ *
+ *             Enables the simulation from <rc/sim.h> so it runs on any Linux
+ *             machine, then frames a noisy packet stream with the UART
+ *             service, with a callback that reads the stats and removes its
+ *             own bus, and times a low latency read split across two bursts.
+ *             Prints PASSED or ERROR for each check and returns nonzero if any
+ *             failed.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sched.h> // for SCHED_OTHER
+#include <rc/time.h>
+#include <rc/uart.h>
+#include <rc/uart_service.h>
+#include <rc/pthread.h>
+#include <rc/sim.h>
+
+#define UART_BUS	1
+#define UART_BAUD	115200
+#define UART_SYNC	0xA5
+#define UART_PACKETS	20
+#define UART_PAYLOAD	6
+#define UART_PACKET	(UART_PAYLOAD+3)	// sync, length, payload, checksum
+#define LL_LEN		16	// bytes in the low latency read, sent in two halves
+#define LL_GAP_US	5000	// delay before the second half
+
+#define TIMER rc_nanos_since_boot()
+
+static int failures = 0;
+static volatile int uart_frames, uart_bad_payload, uart_stats_read;
+static volatile uint64_t ll_sent_ns;
+
+
+/**
+ * prints the result of one check the same way rc_test_drivers does
+ */
+static void __check(int ok, const char* name)
+{
+	if(ok) printf("PASSED: %s\n", name);
+	else{
+		printf("ERROR:  %s\n", name);
+		failures++;
+	}
+	return;
+}
+
+
+/**
+ * packets are a sync byte, a payload length, the payload and a checksum
+ * which makes the bytes after the sync sum to zero
+ */
+static int __uart_check(const rc_uart_frame_t* frame, __attribute__ ((unused)) void* ctx)
+{
+	size_t i;
+	uint8_t sum = 0;
+	for(i=1;i<frame->total;i++) sum += rc_uart_frame_byte(frame, i);
+	return sum ? -1 : 0;
+}
+
+
+/**
+ * checks the payload, and since callbacks run without the service locks also
+ * reads the stats and finally removes its own bus from in here
+ */
+static void __uart_frame(int bus, const rc_uart_frame_t* frame, __attribute__ ((unused)) void* ctx)
+{
+	uint8_t buf[UART_PACKET];
+	rc_uart_service_stats_t stats;
+	int i;
+	rc_uart_frame_copy(frame, buf, sizeof(buf));
+	for(i=0;i<UART_PAYLOAD;i++) if(buf[2+i]!=(uint8_t)(uart_frames+i)) uart_bad_payload++;
+	uart_frames++;
+	if(rc_uart_service_get_stats(bus, &stats)==0) uart_stats_read++;
+	if(uart_frames==UART_PACKETS) rc_uart_service_remove(bus);
+	return;
+}
+
+
+static int __test_service(void)
+{
+	int i, j, stopped;
+	uint8_t pkt[UART_PACKET];
+	uint8_t junk[5] = {0x00, UART_SYNC, 0xFF, 0x13, UART_SYNC};
+	rc_uart_service_config_t conf = rc_uart_service_default_config();
+	rc_uart_service_stats_t stats;
+
+	if(rc_uart_init(UART_BUS, UART_BAUD, 0.1f, 0, 1, 0)) return -1;
+	if(rc_uart_service_start(SCHED_OTHER, 0)){
+		rc_uart_close(UART_BUS);
+		return -1;
+	}
+	conf.framer = RC_UART_FRAMER_LENGTH;
+	conf.ring_len = 64;	// small so packets wrap around the end
+	conf.max_len = 32;
+	conf.sync_en = 1;
+	conf.sync = UART_SYNC;
+	conf.len_offset = 1;
+	conf.len_extra = 3;
+	conf.callback = __uart_frame;
+	conf.check = __uart_check;
+	uart_frames = 0;
+	uart_bad_payload = 0;
+	uart_stats_read = 0;
+	if(rc_uart_service_add(UART_BUS, conf)){
+		rc_uart_service_stop();
+		rc_uart_close(UART_BUS);
+		return -1;
+	}
+
+	// line noise with false sync bytes, then packets with one corrupted
+	rc_sim_uart_send(UART_BUS, junk, sizeof(junk));
+	for(i=0;i<=UART_PACKETS;i++){
+		pkt[0] = UART_SYNC;
+		pkt[1] = UART_PAYLOAD;
+		pkt[UART_PACKET-1] = -UART_PAYLOAD;
+		for(j=0;j<UART_PAYLOAD;j++){
+			pkt[2+j] = (i==UART_PACKETS/2) ? 0 : (uint8_t)((i>UART_PACKETS/2 ? i-1 : i)+j);
+			pkt[UART_PACKET-1] -= pkt[2+j];
+		}
+		if(i==UART_PACKETS/2) pkt[3] ^= 0x40;
+		rc_sim_uart_send(UART_BUS, pkt, UART_PACKET);
+		rc_usleep(1000);
+	}
+	for(i=0;i<100 && uart_frames<UART_PACKETS;i++) rc_usleep(1000);
+	// the callback removed the bus after the last packet, so this one and
+	// a second remove go nowhere
+	rc_sim_uart_send(UART_BUS, pkt, UART_PACKET);
+	rc_usleep(10000);
+
+	rc_uart_service_get_stats(UART_BUS, &stats);
+	stopped = (uart_frames==UART_PACKETS && rc_uart_service_remove(UART_BUS)==-1);
+	printf("uart service    %8d of %d packets, %d bad payloads, %llu rejected, %llu bytes skipped\n",
+		uart_frames, UART_PACKETS, uart_bad_payload,
+		(unsigned long long)stats.rejected, (unsigned long long)stats.skipped);
+	__check(uart_frames==UART_PACKETS && uart_bad_payload==0, "uart service packets");
+	__check(stats.rejected>0, "uart service rejects the corrupted packet");
+	printf("uart callbacks  stats read %d times, %s after removing itself\n", uart_stats_read,
+		stopped ? "stopped" : "NOT stopped");
+	__check(uart_stats_read==UART_PACKETS && stopped, "uart service callbacks");
+	rc_uart_service_stop();
+	rc_uart_close(UART_BUS);
+	return 0;
+}
+
+
+/**
+ * sends the second half of the low latency test packet after a delay
+ */
+static void* __uart_ll_sender(void* ptr)
+{
+	const uint8_t* data = ptr;
+	rc_usleep(LL_GAP_US);
+	ll_sent_ns = rc_nanos_since_boot();
+	rc_sim_uart_send(UART_BUS, data+LL_LEN/2, LL_LEN/2);
+	return NULL;
+}
+
+
+static int __test_low_latency(void)
+{
+	int i, ret, match = 0;
+	uint8_t tx[LL_LEN], rx[LL_LEN];
+	uint64_t t1, rx_ns = 0;
+	pthread_t thread;
+
+	for(i=0;i<LL_LEN;i++) tx[i] = 0x30+i;
+	if(rc_uart_init(UART_BUS, UART_BAUD, 0.1f, 0, 1, 0)) return -1;
+	if(rc_uart_set_low_latency(UART_BUS, 1)){
+		rc_uart_close(UART_BUS);
+		return -1;
+	}
+
+	// the first half alone mustn't wake the read
+	rc_sim_uart_send(UART_BUS, tx, LL_LEN/2);
+	if(rc_pthread_create(&thread, __uart_ll_sender, tx, SCHED_OTHER, 0)){
+		rc_uart_close(UART_BUS);
+		return -1;
+	}
+	t1 = TIMER;
+	ret = rc_uart_read_bytes_stamped(UART_BUS, rx, LL_LEN, &rx_ns);
+	rc_pthread_timed_join(thread, NULL, 1.0f);
+	rc_uart_close(UART_BUS);
+	if(ret!=LL_LEN){
+		fprintf(stderr,"ERROR low latency uart read returned %d\n", ret);
+		return -1;
+	}
+	for(i=0;i<LL_LEN;i++) if(rx[i]==tx[i]) match++;
+	printf("uart low latency%8.1f us from last byte to wakeup, %d of %d bytes, waited %.1f ms\n",
+		(double)(int64_t)(rx_ns-ll_sent_ns)/1000.0, match, LL_LEN,
+		(double)(rx_ns-t1)/1000000.0);
+	__check(match==LL_LEN, "uart low latency data");
+	__check(rx_ns>=ll_sent_ns, "uart low latency waits for the whole read");
+	return 0;
+}
+
+
+int main()
+{
+	if(rc_sim_enable()){
+		fprintf(stderr,"ERROR failed to enable simulation\n");
+		return -1;
+	}
+	printf("\n");
+	// a test that can't get going counts as one failed check
+	if(__test_service()) __check(0, "uart service setup");
+	if(__test_low_latency()) __check(0, "uart low latency setup");
+	printf("\n");
+	return failures ? -1 : 0;
+}
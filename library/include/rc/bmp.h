@@ -14,6 +14,8 @@
 #ifndef RC_BMP_H
 #define RC_BMP_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -50,6 +52,16 @@ typedef enum rc_bmp_filter_t{
 }rc_bmp_filter_t;
 
 
+/**
+ * Setting given to rc_bmp_set_compensation to pick which of the datasheet's
+ * integer compensation formulas turns the raw readings into pressure.
+ */
+typedef enum rc_bmp_compensation_t{
+	BMP_COMPENSATION_64, ///< 64 bit, 1/256 Pa resolution, the default
+	BMP_COMPENSATION_32  ///< 32 bit, 1 Pa resolution (about 8cm), cheaper on 32 bit CPUs
+} rc_bmp_compensation_t;
+
+
 /**
  * struct to hold the data retreived during one read of the barometer.
  */
@@ -60,6 +72,44 @@ typedef struct rc_bmp_data_t{
 } rc_bmp_data_t;
 
 
+/**
+ * one reading taken by the background sampler, see rc_bmp_sampler_start()
+ */
+typedef struct rc_bmp_sample_t{
+	rc_bmp_data_t data;	///< the reading
+	uint64_t timestamp_ns;	///< rc_nanos_since_boot() when the data registers were read
+	uint64_t seq;		///< counts up from 1 with each sample, gaps mean samples were lost
+} rc_bmp_sample_t;
+
+
+/**
+ * configuration for the background sampler, see
+ * rc_bmp_sampler_default_config()
+ */
+typedef struct rc_bmp_sampler_config_t{
+	double rate_hz;		///< sample rate, default 25
+	int buffer_len;		///< number of samples kept in the history, default 64
+	int imu_sync;		///< 1 to read in the gaps between IMU samples, default 1
+	int max_wait_us;	///< longest to wait for an IMU gap before reading anyway, default 10000
+	int sched_policy;	///< scheduler policy for the sampler thread, default SCHED_OTHER
+	int priority;		///< scheduler priority for the sampler thread, default 0
+} rc_bmp_sampler_config_t;
+
+
+/**
+ * running totals kept by the background sampler
+ */
+typedef struct rc_bmp_sampler_stats_t{
+	uint64_t reads;		///< successful reads
+	uint64_t errors;	///< failed reads
+	uint64_t unchanged;	///< reads skipped because the barometer had no new measurement
+	uint64_t synced;	///< reads made in a gap right after an IMU sample
+	uint64_t unsynced;	///< reads made without waiting for a gap
+	uint64_t late;		///< periods missed because a read took too long
+	uint64_t max_read_ns;	///< longest read including waiting for an IMU gap and the bus
+} rc_bmp_sampler_stats_t;
+
+
 /**
  * @brief      powers on the barometer and initializes it with the given
  * oversample and filter settings.
@@ -89,6 +139,40 @@ int rc_bmp_init(rc_bmp_oversample_t oversample, rc_bmp_filter_t filter);
 int rc_bmp_set_sea_level_pressure_pa(double pa);
 
 
+/**
+ * @brief      Chooses the 32 or 64 bit pressure compensation used by
+ * rc_bmp_read and rc_bmp_read_new.
+ *
+ * The 32 bit version from the datasheet has a resolution of one pascal, about
+ * 8cm of altitude, and reads a few pascals higher than the 64 bit version
+ * (3Pa in the datasheet's example). That offset is nearly constant so it
+ * cancels out of altitude measured relative to a starting point. It needs no
+ * 64 bit multiplies or divides so it is the faster of the two on the
+ * BeagleBone's 32 bit ARM.
+ *
+ * @param[in]  comp  BMP_COMPENSATION_64 (default) or BMP_COMPENSATION_32
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_bmp_set_compensation(rc_bmp_compensation_t comp);
+
+
+/**
+ * @brief      Turns the table based altitude conversion on or off.
+ *
+ * Normally altitude is worked out with a call to pow(). With this on it is
+ * interpolated from a 513 entry table of pressure ratios instead. Between 25%
+ * and 115% of sea level pressure, about -1200m to 10000m, the result is within
+ * 4cm of the formula and within 5mm below 2000m. Outside that range it falls
+ * back on pow().
+ *
+ * @param[in]  en    1 to use the table, 0 to use pow() (default)
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_bmp_set_fast_altitude(int en);
+
+
 /**
  * @brief      Puts the barometer into a low power state, should be called at
  * the end of your program before close.
@@ -109,6 +193,104 @@ int rc_bmp_power_off(void);
 int rc_bmp_read(rc_bmp_data_t* data);
 
 
+/**
+ * @brief      Reads the barometer only if it has a measurement that hasn't
+ * been read yet.
+ *
+ * rc_bmp_read always returns data, even if the barometer hasn't finished a new
+ * measurement since the last read, so reading faster than the update rate of
+ * the oversample setting returns the same measurement twice. This function
+ * skips the bus transaction entirely if too little time has passed since the
+ * last new measurement for another to be ready. Otherwise it reads the status
+ * and data registers in one transaction and returns 1 without touching data
+ * if the reading hasn't changed or the chip is still loading its calibration.
+ *
+ * @param      data  pointer to data struct where new data will be written.
+ *
+ * @return     0 if data was filled with a new measurement, 1 if there was
+ * none, -1 on failure
+ */
+int rc_bmp_read_new(rc_bmp_data_t* data);
+
+
+/**
+ * @brief      Returns the default background sampler configuration.
+ *
+ * @return     default configuration
+ */
+rc_bmp_sampler_config_t rc_bmp_sampler_default_config(void);
+
+
+/**
+ * @brief      Starts a thread which reads the barometer in the background.
+ *
+ * Readings are taken at conf.rate_hz and kept with their timestamps in a ring
+ * buffer so control loops can pick up the newest one with
+ * rc_bmp_sampler_get_latest() without touching the I2C bus. Reads are made
+ * with rc_bmp_read_new() so the same measurement is never stored twice, pick
+ * an oversample in rc_bmp_init() whose update rate is at least the sample
+ * rate or some periods will go without a sample.
+ *
+ * With imu_sync on, the sampler subscribes to rc_mpu and when a read falls
+ * due while the IMU is running it waits for the next IMU sample to finish
+ * being read, then reads immediately so the barometer transaction lands in
+ * the quiet period before the following IMU interrupt. If no IMU sample
+ * arrives within max_wait_us, for instance because the IMU isn't running,
+ * it reads anyway. The subscription is made here so rc_mpu may be started
+ * before or after, but stop the sampler before rc_mpu_power_off() since that
+ * drops all subscribers.
+ *
+ * rc_bmp_init() must be called first. rc_bmp_power_off() stops the sampler.
+ *
+ * @param[in]  conf  configuration
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_bmp_sampler_start(rc_bmp_sampler_config_t conf);
+
+
+/**
+ * @brief      Stops the background sampler and frees its history.
+ *
+ * @return     0 on success, -1 if it wasn't running
+ */
+int rc_bmp_sampler_stop(void);
+
+
+/**
+ * @brief      Copies out the newest sample.
+ *
+ * Never blocks and never touches the bus so it's safe to call from the DMP
+ * callback or any other control loop.
+ *
+ * @param[out] sample  user's struct to copy the sample into
+ *
+ * @return     0 on success, 1 if no sample has been taken yet, -1 on failure
+ */
+int rc_bmp_sampler_get_latest(rc_bmp_sample_t* sample);
+
+
+/**
+ * @brief      Copies out up to n of the most recent samples, oldest first.
+ *
+ * @param[out] samples  user's array of at least n samples
+ * @param[in]  n        maximum number of samples to copy
+ *
+ * @return     number of samples copied, -1 on failure
+ */
+int rc_bmp_sampler_get_history(rc_bmp_sample_t* samples, int n);
+
+
+/**
+ * @brief      Copies out the sampler's running totals.
+ *
+ * @param[out] stats  user's struct to copy the totals into
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_bmp_sampler_get_stats(rc_bmp_sampler_stats_t* stats);
+
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,230 @@
+/**
+ * <rc/bus_async.h>
+ *
+ * @brief      Asynchronous I2C and SPI transactions serviced by a thread per
+ *             bus.
+ *
+ * Every other bus function in the library blocks the calling thread until the
+ * transfer is done, which can mean sleeping in the kernel while another
+ * thread finishes with the bus. With the functions here a thread fills in an
+ * rc_bus_async_t, submits it and carries on. A dedicated thread for that bus
+ * performs queued transactions in priority order and reports each one either
+ * through a callback or by marking it done for rc_bus_async_poll() and
+ * rc_bus_async_wait().
+ *
+ * Submitting never allocates memory or touches the bus, it takes a short
+ * priority inheriting lock to link the transaction into the queue, so it is
+ * safe from a real-time thread. The transaction struct and every buffer it
+ * points to belong to the bus thread from submission until it is marked done
+ * and must stay valid until then.
+ *
+ * Queued I2C register reads of the same priority are batched into one
+ * rc_i2c_read_multi() call, so several low rate devices polled in the
+ * background cost one system call. I2C transactions also claim the bus
+ * arbiter from rc_i2c_lock_bus_priority() at their own priority, so they
+ * share the bus fairly with threads using the blocking functions.
+ *
+ * The bus must be initialized as usual with rc_i2c_init() or one of the
+ * rc_spi_init functions before starting its thread.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ *
+ * @addtogroup Bus_Async
+ * @ingroup    IO
+ * @{
+ */
+
+#ifndef RC_BUS_ASYNC_H
+#define RC_BUS_ASYNC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <rc/spi.h>
+
+
+/**
+ * kind of bus a transaction thread serves
+ */
+typedef enum rc_bus_type_t{
+	RC_BUS_I2C,
+	RC_BUS_SPI
+} rc_bus_type_t;
+
+
+/**
+ * what a transaction does
+ */
+typedef enum rc_bus_async_op_t{
+	RC_BUS_ASYNC_I2C_READ,	///< read count bytes starting at reg_addr of dev_addr into data
+	RC_BUS_ASYNC_I2C_WRITE,	///< write count bytes from data starting at reg_addr of dev_addr
+	RC_BUS_ASYNC_SPI	///< send the n_xfers transfers in xfers to slave
+} rc_bus_async_op_t;
+
+
+/**
+ * Priority classes, a queued transaction is always started before any queued
+ * transaction of a lower class. On I2C buses these map to the arbiter
+ * priorities in rc_i2c_priority_t.
+ */
+typedef enum rc_bus_async_priority_t{
+	RC_BUS_ASYNC_LOW,
+	RC_BUS_ASYNC_NORMAL,
+	RC_BUS_ASYNC_HIGH
+} rc_bus_async_priority_t;
+
+#define RC_BUS_ASYNC_PRIORITY_LEVELS 3	///< number of priority classes
+
+
+typedef struct rc_bus_async_t rc_bus_async_t;
+
+/**
+ * Called from the bus thread when a transaction finishes, before it is marked
+ * done. Keep it short, the next transaction waits for it to return.
+ */
+typedef void (*rc_bus_async_callback_t)(rc_bus_async_t* t, void* ctx);
+
+
+/**
+ * One transaction. Zero it, fill in the fields for the op and submit it with
+ * rc_bus_async_submit(). The same struct may be submitted again once it is
+ * done.
+ */
+struct rc_bus_async_t{
+	rc_bus_async_op_t op;		///< what to do
+	rc_bus_async_priority_t priority;	///< priority class, default RC_BUS_ASYNC_LOW when zeroed
+	uint8_t dev_addr;		///< I2C slave address
+	uint8_t reg_addr;		///< I2C register address
+	uint16_t count;			///< I2C bytes to read or write
+	uint8_t* data;			///< I2C data buffer of at least count bytes
+	int slave;			///< SPI slave
+	const rc_spi_xfer_t* xfers;	///< SPI transfers, see rc_spi_transfer_multi()
+	int n_xfers;			///< number of SPI transfers
+	rc_bus_async_callback_t callback;	///< optional completion callback, may be NULL
+	void* ctx;			///< passed to the callback
+
+	int result;			///< set when done, -1 on failure, otherwise 0 or bytes transferred for SPI
+	uint64_t submit_ns;		///< rc_nanos_since_boot() at submission
+	uint64_t complete_ns;		///< rc_nanos_since_boot() when the transaction finished
+
+	// used by the bus thread, don't touch
+	int done;
+	void* engine;
+	rc_bus_async_t* next;
+};
+
+
+/**
+ * configuration of a bus thread, see rc_bus_async_default_config()
+ */
+typedef struct rc_bus_async_config_t{
+	int sched_policy;	///< scheduler policy of the bus thread, default SCHED_OTHER
+	int priority;		///< scheduler priority of the bus thread, default 0
+	int max_batch;		///< most I2C reads merged into one call, 1 to disable batching, default RC_I2C_MAX_MULTI_READS
+} rc_bus_async_config_t;
+
+
+/**
+ * running totals for one bus thread, every array is indexed by
+ * rc_bus_async_priority_t
+ */
+typedef struct rc_bus_async_stats_t{
+	uint64_t submitted[RC_BUS_ASYNC_PRIORITY_LEVELS];	///< transactions submitted
+	uint64_t completed[RC_BUS_ASYNC_PRIORITY_LEVELS];	///< transactions finished, failed ones included
+	uint64_t failed[RC_BUS_ASYNC_PRIORITY_LEVELS];		///< transactions finished with result -1
+	uint64_t latency_max_ns[RC_BUS_ASYNC_PRIORITY_LEVELS];	///< longest time from submission to completion
+	uint64_t calls;						///< I2C or SPI calls made, batched reads count once
+} rc_bus_async_stats_t;
+
+
+/**
+ * @brief      Returns the default bus thread configuration.
+ *
+ * @return     default configuration
+ */
+rc_bus_async_config_t rc_bus_async_default_config(void);
+
+
+/**
+ * @brief      Starts the transaction thread for one bus.
+ *
+ * @param[in]  type  RC_BUS_I2C or RC_BUS_SPI
+ * @param[in]  bus   bus number, already initialized
+ * @param[in]  conf  configuration
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_bus_async_start(rc_bus_type_t type, int bus, rc_bus_async_config_t conf);
+
+
+/**
+ * @brief      Stops the transaction thread for one bus.
+ *
+ * The transaction in progress is allowed to finish, anything still queued is
+ * completed with result -1 without touching the bus. Call this before closing
+ * the bus.
+ *
+ * @param[in]  type  RC_BUS_I2C or RC_BUS_SPI
+ * @param[in]  bus   bus number
+ *
+ * @return     0 on success, -1 if it wasn't running
+ */
+int rc_bus_async_stop(rc_bus_type_t type, int bus);
+
+
+/**
+ * @brief      Queues a transaction and returns without waiting for it.
+ *
+ * @param[in]  type  RC_BUS_I2C or RC_BUS_SPI
+ * @param[in]  bus   bus number
+ * @param      t     the transaction, must not already be queued
+ *
+ * @return     0 on success, -1 if the transaction is invalid or the bus thread
+ * isn't running
+ */
+int rc_bus_async_submit(rc_bus_type_t type, int bus, rc_bus_async_t* t);
+
+
+/**
+ * @brief      Checks whether a submitted transaction is done, never blocks.
+ *
+ * @param[in]  t     the transaction
+ *
+ * @return     1 if done, 0 if still queued or in progress
+ */
+int rc_bus_async_poll(const rc_bus_async_t* t);
+
+
+/**
+ * @brief      Waits for a submitted transaction to be done.
+ *
+ * @param      t           the transaction
+ * @param[in]  timeout_us  longest to wait, 0 to wait forever
+ *
+ * @return     t->result once done, -2 on timeout
+ */
+int rc_bus_async_wait(rc_bus_async_t* t, int timeout_us);
+
+
+/**
+ * @brief      Copies out the running totals of a bus thread.
+ *
+ * @param[in]  type   RC_BUS_I2C or RC_BUS_SPI
+ * @param[in]  bus    bus number
+ * @param[out] stats  user's struct to copy the totals into
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_bus_async_get_stats(rc_bus_type_t type, int bus, rc_bus_async_stats_t* stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RC_BUS_ASYNC_H
+
+/** @} end group Bus_Async */
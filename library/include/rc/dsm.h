@@ -16,6 +16,10 @@
  * plug as is traditionally used. The software has been tested with Orange brand
  * DSM2 receivers, as well as Spektrum and JR branded DSMX receivers.
  *
+ * The same background service can read SBUS and CRSF receivers on the DSM
+ * port instead, see rc_dsm_set_protocol() and <rc/rc_input.h>. Everything
+ * else here, including the calibration file, works the same for them.
+ *
  * See rc_balance, rc_test_dsm, rc_bind_dsm, rc_calibrate_dsm, and
  * rc_dsm_passthroguh examples.
  *
@@ -31,8 +35,64 @@ extern "C" {
 #endif
 
 #include <stdint.h> // for int64_t
+#include <rc/rc_input.h>
+
+#define RC_MAX_DSM_CHANNELS	RC_INPUT_MAX_CHANNELS	///< 9 for DSM, 16 for SBUS and CRSF
+
+
+/**
+ * One complete set of channels as published by the DSM background service,
+ * see rc_dsm_get_frame(). Channels are indexed from 0 here, so channel 1 is
+ * raw[0].
+ */
+typedef struct rc_dsm_frame_t{
+	int channels;				///< number of channels the transmitter sends
+	int raw[RC_MAX_DSM_CHANNELS];		///< pulse widths in microseconds, 0 for unused channels
+	double normalized[RC_MAX_DSM_CHANNELS];	///< raw scaled by the calibration, see rc_dsm_ch_normalized()
+	uint64_t count;				///< number of sets published since rc_dsm_init(), starting at 1
+	uint64_t timestamp_ns;			///< rc_nanos_since_boot() when the last frame of the set was received
+} rc_dsm_frame_t;
+
+
+/**
+ * Frame statistics of the DSM background service, see rc_dsm_get_stats().
+ *
+ * Frames are found by the quiet gap the receiver leaves between them, so a
+ * dropped or corrupted byte only costs the frame it hits. Those are counted in
+ * broken, and frames that never arrived at all show up in lost.
+ */
+typedef struct rc_dsm_stats_t{
+	uint64_t frames;	///< complete frames received
+	uint64_t broken;	///< frames thrown away because bytes were missing
+	uint64_t lost;		///< frames missing from the regular frame timing, broken ones included
+	uint64_t skipped;	///< bytes thrown away while waiting for the start of a frame
+	uint64_t period_ns;	///< measured time between frames, 0 until two have arrived
+} rc_dsm_stats_t;
+
+/**
+ * @brief      Chooses the receiver protocol read by rc_dsm_init() and
+ * rc_dsm_calibrate_routine().
+ *
+ * The default is RC_INPUT_DSM. SBUS runs the port at 100000 baud 8E2 and
+ * needs an inverter between the receiver and the board, CRSF runs it at 420000
+ * baud 8N1. For both, rc_dsm_resolution() reports 2048 and
+ * rc_dsm_channels() 16. An SBUS receiver's failsafe frames aren't passed on,
+ * the connection times out as if the transmitter were off.
+ *
+ * @param[in]  protocol  RC_INPUT_DSM, RC_INPUT_SBUS or RC_INPUT_CRSF
+ *
+ * @return     0 on success, -1 if invalid or the service is running
+ */
+int rc_dsm_set_protocol(rc_input_protocol_t protocol);
+
+
+/**
+ * @brief      Returns the protocol chosen with rc_dsm_set_protocol().
+ *
+ * @return     the protocol
+ */
+rc_input_protocol_t rc_dsm_protocol(void);
 
-#define RC_MAX_DSM_CHANNELS	9
 
 /**
  * @brief      Starts the DSM background service
@@ -55,12 +115,15 @@ int rc_dsm_cleanup(void);
  * @brief      Returns the pulse width in microseconds commanded by the
  * transmitter for a particular channel.
  *
- * The user can specify channels 1 through 9 but non-zero values will only be
+ * The user can specify channels 1 through 16 but non-zero values will only be
  * returned for channels the transmitter is actually using. The raw values in
  * microseconds typically range from 900-2100us for a standard radio with
  * default settings.
  *
- * @param[in]  ch    channel (1-9)
+ * Each call may see a newer set of channels than the last, use
+ * rc_dsm_get_frame() to read several channels from the same one.
+ *
+ * @param[in]  ch    channel (1-16)
  *
  * @return     pulse width in microseconds if data is being transmitted, 0 if
  * data is not being transmitted on that channel, -1 on error
@@ -77,7 +140,7 @@ int rc_dsm_ch_raw(int ch);
  * outside of the range from -1 to 1 are returned if the calibration is not
  * perfect.
  *
- * @param[in]  ch    channel (1-9)
+ * @param[in]  ch    channel (1-16)
  *
  * @return     normalized input from -1.0 to 1.0 if that channel has data, 0 if
  * that channel has no data, -1 on error.
@@ -85,6 +148,24 @@ int rc_dsm_ch_raw(int ch);
 double rc_dsm_ch_normalized(int ch);
 
 
+/**
+ * @brief      Copies out every channel of the latest complete set at once.
+ *
+ * All values come from the same set of frames, which a series of
+ * rc_dsm_ch_raw() or rc_dsm_ch_normalized() calls can't promise since the
+ * background service may publish a new set between them. The copy is taken
+ * without locking so it never holds up the background service and is safe
+ * from any number of threads. Unlike those functions this doesn't clear the
+ * flag behind rc_dsm_is_new_data(), compare count with the previous frame
+ * instead so several readers don't steal updates from each other.
+ *
+ * @param[out] frame  user's struct to copy the channels into
+ *
+ * @return     0 on success, 1 if no complete set has arrived yet, -1 on error
+ */
+int rc_dsm_get_frame(rc_dsm_frame_t* frame);
+
+
 /**
  * @brief      This is a check to see if new data is available.
  *
@@ -128,6 +209,9 @@ int rc_dsm_is_connection_active(void);
 /**
  * @brief      Measures time since the last DSM packet was received.
  *
+ * Counted from when the last byte of the frame completing the latest channel
+ * data arrived, not from when it was decoded.
+ *
  * @return     Returns the number of nanoseconds since the last dsm packet was
  * received. Return -1 on error or if no packet has ever been received.
  */
@@ -153,6 +237,26 @@ int rc_dsm_resolution(void);
 int rc_dsm_channels(void);
 
 
+/**
+ * @brief      Copies out the frame statistics since rc_dsm_init().
+ *
+ * @param[out] stats  user's struct to copy the statistics into
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_dsm_get_stats(rc_dsm_stats_t* stats);
+
+
+/**
+ * @brief      Copies out the latest link statistics of a CRSF receiver.
+ *
+ * @param[out] stats  user's struct to copy the statistics into
+ *
+ * @return     0 on success, 1 if none have arrived, -1 on error
+ */
+int rc_dsm_get_link_stats(rc_input_link_stats_t* stats);
+
+
 /**
  * @brief      Begins the binding routine and prints instructions to the screen
  * along the way.
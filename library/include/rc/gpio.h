@@ -62,7 +62,8 @@ int rc_gpio_init(int chip, int pin, int handle_flags);
 /**
  * @brief      Sets the value of a GPIO pin when in output mode
  *
- * must call rc_gpio_init with the OUTPUT flag first.
+ * must call rc_gpio_init with the OUTPUT flag first, or request the pin as part
+ * of an output group with rc_gpio_group_init().
  *
  * @param[in]  chip   The chip number, /dev/gpiochipX
  * @param[in]  pin    The pin ID
@@ -76,7 +77,7 @@ int rc_gpio_set_value(int chip, int pin, int value);
 /**
  * @brief      Reads the value of a GPIO pin when in input mode or output mode.
  *
- * Must call rc_gpio_init first.
+ * Must call rc_gpio_init or rc_gpio_group_init first.
  *
  * @param[in]  chip  The chip number, /dev/gpiochipX
  * @param[in]  pin   The pin ID
@@ -153,6 +154,86 @@ void rc_gpio_cleanup(int chip, int pin);
 
 
 
+#define RC_GPIO_GROUP_MAX_LINES	64	///< most lines one group can hold, same as the kernel
+
+
+/**
+ * Several lines of one gpio chip requested together so they can be written or
+ * read with a single system call, see rc_gpio_group_init(). Line i of the group
+ * is pins[i] on the chip and bit i in the value masks.
+ */
+typedef struct rc_gpio_group_t{
+	int chip;				///< the chip number, /dev/gpiochipX
+	int lines;				///< number of lines in the group
+	int pins[RC_GPIO_GROUP_MAX_LINES];	///< pin ID of each line
+	int handle_flags;			///< flags the lines were requested with
+	uint64_t values;			///< last values written, bit i for line i
+	int fd;					///< handle file descriptor, 0 when not requested
+} rc_gpio_group_t;
+
+
+/**
+ * @brief      Configures several pins of one chip as a group of inputs or
+ * outputs.
+ *
+ * The pins are requested from the character device driver together as one
+ * handle, so rc_gpio_group_set_values() can change any of them in a single
+ * ioctl instead of one per pin. Writes that need several lines to change
+ * together, like the two direction inputs of an H-bridge, then land at once
+ * instead of leaving the hardware in an in-between state.
+ *
+ * Takes the same handle flags as rc_gpio_init() which apply to every line.
+ * Outputs start low. The pins can't also be requested with rc_gpio_init(), but
+ * rc_gpio_set_value() and rc_gpio_get_value() keep working on them and go
+ * through the group, changing only that one line. The group struct must
+ * therefore stay in place until rc_gpio_group_cleanup().
+ *
+ * @param[out] group         user's group struct to set up
+ * @param[in]  chip          The chip number, /dev/gpiochipX
+ * @param[in]  pins          The pin IDs
+ * @param[in]  lines         number of pins, at most RC_GPIO_GROUP_MAX_LINES
+ * @param[in]  handle_flags  The handle flags
+ *
+ * @return     0 on success or -1 on failure.
+ */
+int rc_gpio_group_init(rc_gpio_group_t* group, int chip, const int* pins, int lines, int handle_flags);
+
+
+/**
+ * @brief      Sets some or all lines of an output group with one system call.
+ *
+ * Lines with their bit set in mask take the matching bit of values, the others
+ * keep the value last written to them.
+ *
+ * @param      group   The group
+ * @param[in]  mask    bit i set to change line i
+ * @param[in]  values  bit i is the new value of line i, 0 for off (inactive)
+ * or 1 for on (active)
+ *
+ * @return     0 on success or -1 on failure
+ */
+int rc_gpio_group_set_values(rc_gpio_group_t* group, uint64_t mask, uint64_t values);
+
+
+/**
+ * @brief      Reads every line of a group with one system call.
+ *
+ * @param      group   The group
+ * @param[out] values  bit i is set if line i is high (active)
+ *
+ * @return     0 on success or -1 on failure
+ */
+int rc_gpio_group_get_values(rc_gpio_group_t* group, uint64_t* values);
+
+
+/**
+ * @brief      Releases the lines of a group.
+ *
+ * @param      group  The group
+ */
+void rc_gpio_group_cleanup(rc_gpio_group_t* group);
+
+
 
 #ifdef __cplusplus
 }
@@ -38,6 +38,37 @@ extern "C" {
  */
 #define I2C_BUFFER_SIZE 128
 
+/**
+ * @brief      Priority of a thread claiming a bus, see
+ *             rc_i2c_lock_bus_priority().
+ */
+typedef enum rc_i2c_priority_t{
+	RC_I2C_PRIORITY_LOW,
+	RC_I2C_PRIORITY_NORMAL,
+	RC_I2C_PRIORITY_HIGH
+} rc_i2c_priority_t;
+
+/**
+ * @brief      Number of priority levels in rc_i2c_priority_t
+ */
+#define RC_I2C_PRIORITY_LEVELS 3
+
+/**
+ * @brief      Arbiter statistics for one bus, filled in by
+ *             rc_i2c_get_stats().
+ *
+ *             Every array is indexed by rc_i2c_priority_t. Only the outermost
+ *             claim of a thread is counted, nested claims by a thread that
+ *             already holds the bus never wait. Wait times include waiting for
+ *             other processes.
+ */
+typedef struct rc_i2c_stats_t{
+	uint64_t acquisitions[RC_I2C_PRIORITY_LEVELS];	///< number of times the bus was claimed
+	uint64_t contended[RC_I2C_PRIORITY_LEVELS];	///< number of claims that had to wait
+	uint64_t wait_total_ns[RC_I2C_PRIORITY_LEVELS];	///< total time spent waiting in nanoseconds
+	uint64_t wait_max_ns[RC_I2C_PRIORITY_LEVELS];	///< longest single wait in nanoseconds
+} rc_i2c_stats_t;
+
 /**
  * @brief      Initializes a bus and sets it to talk to a particular device
  *             address.
@@ -89,15 +120,34 @@ int rc_i2c_set_device_address(int bus, uint8_t devAddr);
  */
 int rc_i2c_read_byte(int bus, uint8_t regAddr, uint8_t *data);
 
+/**
+ * @brief      Reads a single byte like rc_i2c_read_byte() but without printing
+ * an error when the transaction fails.
+ *
+ *             Meant for polling a device that is expected to NACK for a
+ *             while, for example during a reset, where a failed read just
+ *             means try again. It still uses one combined I2C_RDWR
+ *             transaction and claims the bus like every other call.
+ *
+ * @param[in]  bus      The bus
+ * @param[in]  regAddr  The register address
+ * @param[out] data     The data pointer to write response to.
+ *
+ * @return     1 (bytes read) on success or -1 on failure
+ */
+int rc_i2c_read_byte_quiet(int bus, uint8_t regAddr, uint8_t *data);
+
 /**
  * @brief      Reads multiple bytes from a device register.
  *
  *             This sends the device address and register address to be read
  *             from before reading the response, works for most i2c devices.
+ *             Both halves go out in one I2C_RDWR system call joined by a
+ *             repeated START.
  *
  * @param[in]  bus      The bus
  * @param[in]  regAddr  The register address
- * @param[in]  count   number of bytes to read
+ * @param[in]  count   number of bytes to read, at most 65535
  * @param[out] data     The data pointer to write response to.
  *
  * @return     returns number of bytes read or -1 on failure
@@ -148,6 +198,60 @@ int rc_i2c_read_words(int bus, uint8_t regAddr, size_t count, uint16_t* data);
  */
 int rc_i2c_write_byte(int bus, uint8_t regAddr, uint8_t data);
 
+/**
+ * @brief      Maximum number of reads in one call to rc_i2c_read_multi(),
+ *             limited by the kernel's I2C_RDWR_IOCTL_MAX_MSGS of 42.
+ */
+#define RC_I2C_MAX_MULTI_READS 21
+
+/**
+ * @brief      Describes one register read for rc_i2c_read_multi().
+ */
+typedef struct rc_i2c_read_t{
+	uint8_t devAddr;	///< slave address of the device to read from
+	uint8_t regAddr;	///< first register to read
+	uint16_t count;		///< number of bytes to read
+	uint8_t* data;		///< buffer of at least count bytes to read into
+} rc_i2c_read_t;
+
+/**
+ * @brief      Reads registers from one or more devices on a bus in a single
+ *             system call.
+ *
+ *             All reads are submitted together with one I2C_RDWR ioctl so the
+ *             bus goes from one read to the next with a repeated START and
+ *             no STOP in between. Each read carries its own slave address so
+ *             devices at different addresses, such as the MPU9250 and its
+ *             AK8963 magnetometer in bypass mode, can be read without any
+ *             rc_i2c_set_device_address() calls, and the address set for the
+ *             other functions in this API is left alone.
+ *
+ * @param[in]  bus    The bus
+ * @param      reads  array of n reads, the data buffers are filled in
+ * @param[in]  n      number of reads, 1 to RC_I2C_MAX_MULTI_READS
+ *
+ * @return     0 on success or -1 on failure
+ */
+int rc_i2c_read_multi(int bus, rc_i2c_read_t* reads, int n);
+
+/**
+ * @brief      Writes registers of a device at a given address in a single
+ *             system call.
+ *
+ *             Like rc_i2c_read_multi() the slave address travels with the
+ *             message, so the address set for the other functions in this API
+ *             is left alone.
+ *
+ * @param[in]  bus      The bus
+ * @param[in]  devAddr  slave address of the device to write to
+ * @param[in]  regAddr  The register address to write to
+ * @param[in]  count    The number of bytes to write, at most I2C_BUFFER_SIZE-1
+ * @param[in]  data     pointer to user's data to be writen
+ *
+ * @return     0 on success or -1 on failure
+ */
+int rc_i2c_write_to(int bus, uint8_t devAddr, uint8_t regAddr, size_t count, const uint8_t* data);
+
 /**
  * @brief      Writes multiple bytes to a specified register address.
  *
@@ -232,53 +336,95 @@ int rc_i2c_send_bytes(int bus, size_t count, uint8_t* data);
 int rc_i2c_send_byte(int bus, uint8_t data);
 
 /**
- * @brief      Locks the bus so other threads in the process know the bus is in
- *             use.
- *
- *             Locking a bus is similar to locking a mutex, it is a way for
- *             threads to communicate within one process when sharing a bus.
- *             This, however, is not a hard lock in the sense that it does not
- *             block and does not stop any of the other functions in this API
- *             from being called. It only serves as a flag that can be checked
- *             between threads if the user chooses to do so. This is encouraged
- *             in multithraded applications to prevent timing-sensitive i2c
- *             communication from being interrupted but is not enforced.
- *
- *             All read/write functions in this API will lock the bus during the
- *             transaction and return the lockstate to what it was at the
- *             beginning of the transaction. Ideally the user should lock the
- *             bus themselves before a sequence of transactions and unlock it
- *             afterwards.
+ * @brief      Claims the bus for the calling thread at normal priority,
+ *             blocking until it is available.
+ *
+ *             Each bus has an arbiter which queues threads that want the bus
+ *             and hands it to the highest priority waiter whenever it is
+ *             released, see rc_i2c_lock_bus_priority(). The outermost claim
+ *             also takes an exclusive flock() on the bus file descriptor, so
+ *             other processes using this library wait their turn too. Priority
+ *             only orders threads within one process.
+ *
+ *             All read/write functions in this API claim the bus at normal
+ *             priority for the duration of the transaction. Claims are nested,
+ *             so a thread that already holds the bus can call them freely. To
+ *             keep a sequence of transactions, or a rc_i2c_set_device_address()
+ *             followed by transactions, from being interleaved with another
+ *             thread, lock the bus before the sequence and unlock it after.
  *
  * @param[in]  bus   The bus ID
  *
- * @return     Returns the lock state (0 or 1) when this function is called, or -1 on
- *             error.
+ * @return     Returns 1 if the bus was held by any thread when this function
+ *             was called, 0 if it was free, or -1 on error.
  */
 int rc_i2c_lock_bus(int bus);
 
 /**
- * @brief      Unlocks a bus to indicate to other threads in the process that
- *             the bus is now free.
+ * @brief      Same as rc_i2c_lock_bus() but with a priority.
+ *
+ *             Whenever the bus is released, a waiting thread of higher priority
+ *             always gets it before any waiting thread of lower priority. A
+ *             transaction in progress is never interrupted, so a high priority
+ *             thread such as the IMU interrupt handler waits for at most the
+ *             one transaction, or locked sequence, already on the bus. Use
+ *             RC_I2C_PRIORITY_LOW for slow, latency tolerant devices such as
+ *             the barometer.
  *
- *             see rc_i2c_lock_bus for further description.
+ * @param[in]  bus       The bus ID
+ * @param[in]  priority  The priority
+ *
+ * @return     Returns 1 if the bus was held by any thread when this function
+ *             was called, 0 if it was free, or -1 on error.
+ */
+int rc_i2c_lock_bus_priority(int bus, rc_i2c_priority_t priority);
+
+/**
+ * @brief      Releases one claim on the bus made by the calling thread with
+ *             rc_i2c_lock_bus() or rc_i2c_lock_bus_priority().
+ *
+ *             The bus is handed to the next waiting thread once the calling
+ *             thread has released as many claims as it made. Calling this from
+ *             a thread that does not hold the bus does nothing.
  *
  * @param[in]  bus   The bus ID
  *
- * @return     Returns the lock state (0 or 1) when this function is called, or -1 on
- *             error.
+ * @return     Returns 1 if the calling thread held the bus, 0 if it did not,
+ *             or -1 on error.
  */
 int rc_i2c_unlock_bus(int bus);
 
 /**
  * @brief      Fetches the current lock state of the bus.
  *
+ *             Only reflects threads in this process. There is no need to check
+ *             this before locking, rc_i2c_lock_bus() waits when necessary.
+ *
  * @param[in]  bus   The bus ID
  *
  * @return     Returns 0 if unlocked, 1 if locked, or -1 on error.
  */
 int rc_i2c_get_lock(int bus);
 
+/**
+ * @brief      Copies the arbiter statistics of a bus.
+ *
+ * @param[in]  bus    The bus ID
+ * @param[out] stats  The statistics
+ *
+ * @return     0 on success or -1 on failure
+ */
+int rc_i2c_get_stats(int bus, rc_i2c_stats_t* stats);
+
+/**
+ * @brief      Zeros the arbiter statistics of a bus.
+ *
+ * @param[in]  bus   The bus ID
+ *
+ * @return     0 on success or -1 on failure
+ */
+int rc_i2c_reset_stats(int bus);
+
 /**
  * @brief      Gets file descriptor.
  *
@@ -14,7 +14,9 @@
 #ifndef RC_MATH_H
 #define RC_MATH_H
 
+#include <rc/math/ahrs.h>
 #include <rc/math/algebra.h>
+#include <rc/math/fast_trig.h>
 #include <rc/math/filter.h>
 #include <rc/math/kalman.h>
 #include <rc/math/matrix.h>
@@ -22,6 +24,7 @@
 #include <rc/math/polynomial.h>
 #include <rc/math/quaternion.h>
 #include <rc/math/ring_buffer.h>
+#include <rc/math/rls.h>
 #include <rc/math/vector.h>
 
 #endif // RC_MATH_H
@@ -0,0 +1,161 @@
+/**
+ * <rc/math/ahrs.h>
+ *
+ * @brief      Attitude and heading reference filters for raw IMU data.
+ *
+ * Implements the Mahony (nonlinear complementary filter on SO(3)) and Madgwick
+ * (gradient descent) orientation filters. Both integrate gyroscope rates and
+ * correct drift with the accelerometer and, optionally, the magnetometer. They
+ * are intended to run at the sensor's native sample rate so all math is done
+ * in single precision floats and no memory is allocated.
+ *
+ * The quaternion is stored in the order [Wijk] like the rest of the library and
+ * rotates vectors from the sensor frame into a Z-up earth frame, so it can be
+ * passed straight to rc_quaternion_to_tb_array().
+ *
+ * See the rc_benchmark_ahrs example for timing.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ *
+ * @addtogroup AHRS
+ * @ingroup    Math
+ * @{
+ */
+
+#ifndef RC_AHRS_H
+#define RC_AHRS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @brief      Which orientation filter an rc_ahrs_t runs.
+ */
+typedef enum rc_ahrs_type_t{
+	RC_AHRS_MAHONY,
+	RC_AHRS_MADGWICK
+} rc_ahrs_type_t;
+
+/**
+ * @brief      Struct containing the configuration and state of an AHRS filter.
+ *
+ * Contains no dynamically allocated memory so it may be copied freely. The user
+ * can read the quaternion directly from this struct.
+ */
+typedef struct rc_ahrs_t{
+	/** @name configuration */
+	///@{
+	rc_ahrs_type_t type;	///< RC_AHRS_MAHONY or RC_AHRS_MADGWICK
+	float beta;		///< Madgwick gradient descent gain
+	float kp;		///< Mahony proportional gain
+	float ki;		///< Mahony integral gain
+	///@}
+
+	/** @name state */
+	///@{
+	float q[4];		///< orientation quaternion [Wijk]
+	float integral[3];	///< Mahony integral feedback (rad/s)
+	uint64_t step;		///< updates since last reset
+	int initialized;	///< initialization flag
+	///@}
+} rc_ahrs_t;
+
+#define RC_AHRS_INITIALIZER {\
+	.type		= RC_AHRS_MAHONY,\
+	.beta		= 0.0f,\
+	.kp		= 0.0f,\
+	.ki		= 0.0f,\
+	.q		= {1.0f, 0.0f, 0.0f, 0.0f},\
+	.integral	= {0.0f, 0.0f, 0.0f},\
+	.step		= 0,\
+	.initialized	= 0}
+
+/**
+ * @brief      Returns an rc_ahrs_t struct with identity orientation and no
+ * configuration.
+ *
+ * @return     empty rc_ahrs_t struct
+ */
+rc_ahrs_t rc_ahrs_empty(void);
+
+/**
+ * @brief      Configures an AHRS filter to use the Mahony algorithm.
+ *
+ * Typical values are kp=1.0 and ki=0.0 for a well calibrated gyro. A small ki
+ * such as 0.05 lets the filter estimate and remove a slowly changing gyro bias.
+ *
+ * @param      a     pointer to user's rc_ahrs_t struct
+ * @param[in]  kp    proportional gain
+ * @param[in]  ki    integral gain
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_ahrs_mahony_init(rc_ahrs_t* a, float kp, float ki);
+
+/**
+ * @brief      Configures an AHRS filter to use the Madgwick algorithm.
+ *
+ * beta is the gyroscope measurement error in rad/s, 0.1 is a good starting
+ * point. Larger values converge faster but pass more accelerometer noise.
+ *
+ * @param      a     pointer to user's rc_ahrs_t struct
+ * @param[in]  beta  gradient descent gain
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_ahrs_madgwick_init(rc_ahrs_t* a, float beta);
+
+/**
+ * @brief      Resets the orientation to identity and clears the integral
+ * term, keeping the configuration.
+ *
+ * The next call to rc_ahrs_update() will align the quaternion to the
+ * accelerometer (and magnetometer if given) in one step instead of converging
+ * slowly from identity.
+ *
+ * @param      a     pointer to user's rc_ahrs_t struct
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_ahrs_reset(rc_ahrs_t* a);
+
+/**
+ * @brief      Marches the filter forward one timestep.
+ *
+ * The accelerometer and magnetometer only need to be proportional to the true
+ * vectors as they are normalized internally, so any units are fine. If either
+ * reads all zeros it is ignored for this step.
+ *
+ * @param      a      pointer to user's rc_ahrs_t struct
+ * @param[in]  gyro   angular rate in rad/s
+ * @param[in]  accel  accelerometer reading
+ * @param[in]  mag    magnetometer reading, or NULL for a 6-axis update
+ * @param[in]  dt     timestep in seconds
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_ahrs_update(rc_ahrs_t* a, const float gyro[3], const float accel[3], const float mag[3], float dt);
+
+/**
+ * @brief      Copies the current orientation out in double precision for use
+ * with the rc_quaternion functions.
+ *
+ * @param      a     pointer to user's rc_ahrs_t struct
+ * @param[out] q     quaternion [Wijk]
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_ahrs_get_quaternion(rc_ahrs_t* a, double q[4]);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RC_AHRS_H
+
+/** @} end ingroup math*/
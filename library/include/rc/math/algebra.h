@@ -15,6 +15,7 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
 #include <rc/math/matrix.h>
 
 /**
@@ -76,7 +77,9 @@ int rc_algebra_invert_matrix_inplace(rc_matrix_t* A);
  * @brief      Solves Ax=b for given matrix A and vector b.
  *
  * Places the result in vector x. existing contents of x are freed and new
- * memory is allocated if necessary.
+ * memory is allocated if necessary. This factors A on every call, use
+ * rc_algebra_lu_factor() and rc_algebra_lu_solve() to solve repeatedly with
+ * the same A.
  *
  * @param[in]  A     matrix A
  * @param[in]  b     column vector b
@@ -99,7 +102,8 @@ int rc_algebra_lin_system_solve(rc_matrix_t A, rc_vector_t b, rc_vector_t* x);
  * with unusually small or large floating point values.
  *
  * This only effects the operation of rc_algebra_invert_matrix,
- * rc_algebra_invert_matrix_inplace, and rc_algebra_lin_system_solve.
+ * rc_algebra_invert_matrix_inplace, rc_algebra_lin_system_solve,
+ * rc_algebra_lu_factor, and rc_algebra_qr_factor.
  *
  * @param[in]  tol   The zero-tolerance
  */
@@ -109,7 +113,9 @@ void rc_algebra_set_zero_tolerance(double tol);
  * @brief      Finds a least-squares solution to the system Ax=b for non-square
  * A using QR decomposition method.
  *
- * Places the solution in x.
+ * Places the solution in x. This factors A on every call, use
+ * rc_algebra_qr_factor() and rc_algebra_qr_solve() to solve repeatedly with
+ * the same A.
  *
  * @param[in]  A     matrix A
  * @param[in]  b     column vector b
@@ -119,6 +125,177 @@ void rc_algebra_set_zero_tolerance(double tol);
  */
 int rc_algebra_lin_system_solve_qr(rc_matrix_t A, rc_vector_t b, rc_vector_t* x);
 
+
+/**
+ * @brief      LU factorization of a square matrix with partial pivoting, kept
+ * for solving against many right hand sides, see rc_algebra_lu_factor().
+ *
+ * L (unit diagonal, not stored) and U share one matrix, and row i of PA is
+ * row perm[i] of A.
+ */
+typedef struct rc_algebra_lu_t{
+	rc_matrix_t LU;		///< L below the diagonal, U on and above
+	int* perm;		///< row permutation, length n
+	int n;			///< dimension of the factored matrix
+	int initialized;	///< set to 1 once factored
+} rc_algebra_lu_t;
+
+#define RC_ALGEBRA_LU_INITIALIZER {\
+	.LU = RC_MATRIX_INITIALIZER,\
+	.perm = NULL,\
+	.n = 0,\
+	.initialized = 0}
+
+/**
+ * @brief      QR factorization of a tall or square matrix kept for solving
+ * against many right hand sides, see rc_algebra_qr_factor().
+ *
+ * Q is never formed. Instead the Householder vectors are stored compactly in
+ * and below the diagonal of QR with R above it, and the diagonal of R kept
+ * separately, so applying Q' costs O(mn) instead of O(m^2).
+ */
+typedef struct rc_algebra_qr_t{
+	rc_matrix_t QR;		///< Householder vectors on and below the diagonal, R above
+	rc_vector_t Rdiag;	///< diagonal of R
+	rc_vector_t work;	///< workspace of length rows used by rc_algebra_qr_solve()
+	rc_matrix_t work_multi;	///< workspace used by rc_algebra_qr_solve_multi()
+	int rows;		///< rows of the factored matrix
+	int cols;		///< columns of the factored matrix
+	int initialized;	///< set to 1 once factored
+} rc_algebra_qr_t;
+
+#define RC_ALGEBRA_QR_INITIALIZER {\
+	.QR = RC_MATRIX_INITIALIZER,\
+	.Rdiag = RC_VECTOR_INITIALIZER,\
+	.work = RC_VECTOR_INITIALIZER,\
+	.work_multi = RC_MATRIX_INITIALIZER,\
+	.rows = 0,\
+	.cols = 0,\
+	.initialized = 0}
+
+/**
+ * @brief      Returns an empty rc_algebra_lu_t, use this before the first
+ * call to rc_algebra_lu_factor().
+ *
+ * @return     empty rc_algebra_lu_t
+ */
+rc_algebra_lu_t rc_algebra_lu_empty(void);
+
+/**
+ * @brief      Factors square matrix A once so it can be solved against many
+ * right hand sides.
+ *
+ * Memory from a previous factorization of the same size is reused. Fails if
+ * A is singular to within the zero tolerance, see
+ * rc_algebra_set_zero_tolerance(). On failure lu is freed and left empty.
+ *
+ * @param[in]  A     square matrix to factor, left untouched
+ * @param      lu    pointer to user's rc_algebra_lu_t
+ *
+ * @return     Returns 0 on success or -1 on failure.
+ */
+int rc_algebra_lu_factor(rc_matrix_t A, rc_algebra_lu_t* lu);
+
+/**
+ * @brief      Solves Ax=b with a factorization from rc_algebra_lu_factor().
+ *
+ * Costs O(n^2). Does not allocate memory when x is already of length n.
+ *
+ * @param      lu    pointer to factored rc_algebra_lu_t
+ * @param[in]  b     column vector b
+ * @param[out] x     solution column vector
+ *
+ * @return     Returns 0 on success or -1 on failure.
+ */
+int rc_algebra_lu_solve(rc_algebra_lu_t* lu, rc_vector_t b, rc_vector_t* x);
+
+/**
+ * @brief      Solves AX=B for every column of B with a factorization from
+ * rc_algebra_lu_factor().
+ *
+ * Does not allocate memory when X is already of the same size as B.
+ *
+ * @param      lu    pointer to factored rc_algebra_lu_t
+ * @param[in]  B     matrix whose columns are right hand sides
+ * @param[out] X     matrix whose columns are the solutions
+ *
+ * @return     Returns 0 on success or -1 on failure.
+ */
+int rc_algebra_lu_solve_multi(rc_algebra_lu_t* lu, rc_matrix_t B, rc_matrix_t* X);
+
+/**
+ * @brief      Frees the memory of an rc_algebra_lu_t and returns it to the
+ * empty state.
+ *
+ * @param      lu    pointer to user's rc_algebra_lu_t
+ *
+ * @return     Returns 0 on success or -1 on failure.
+ */
+int rc_algebra_lu_free(rc_algebra_lu_t* lu);
+
+/**
+ * @brief      Returns an empty rc_algebra_qr_t, use this before the first
+ * call to rc_algebra_qr_factor().
+ *
+ * @return     empty rc_algebra_qr_t
+ */
+rc_algebra_qr_t rc_algebra_qr_empty(void);
+
+/**
+ * @brief      Factors matrix A with Householder reflections once so it can be
+ * solved in the least squares sense against many right hand sides.
+ *
+ * A must have at least as many rows as columns and full column rank to within
+ * the zero tolerance. Memory from a previous factorization of the same size is
+ * reused. On failure qr is freed and left empty.
+ *
+ * @param[in]  A     matrix to factor, left untouched
+ * @param      qr    pointer to user's rc_algebra_qr_t
+ *
+ * @return     Returns 0 on success or -1 on failure.
+ */
+int rc_algebra_qr_factor(rc_matrix_t A, rc_algebra_qr_t* qr);
+
+/**
+ * @brief      Finds the least squares solution to Ax=b with a factorization
+ * from rc_algebra_qr_factor().
+ *
+ * Costs O(mn) for an m by n matrix. Does not allocate memory when x is already
+ * of length n. x may be the same vector as b.
+ *
+ * @param      qr    pointer to factored rc_algebra_qr_t
+ * @param[in]  b     column vector b of length m
+ * @param[out] x     solution column vector
+ *
+ * @return     Returns 0 on success or -1 on failure.
+ */
+int rc_algebra_qr_solve(rc_algebra_qr_t* qr, rc_vector_t b, rc_vector_t* x);
+
+/**
+ * @brief      Finds the least squares solution to AX=B for every column of B
+ * with a factorization from rc_algebra_qr_factor().
+ *
+ * Does not allocate memory when X is already n by the number of columns of B
+ * and the previous call had the same number of right hand sides.
+ *
+ * @param      qr    pointer to factored rc_algebra_qr_t
+ * @param[in]  B     matrix whose columns are right hand sides
+ * @param[out] X     matrix whose columns are the solutions
+ *
+ * @return     Returns 0 on success or -1 on failure.
+ */
+int rc_algebra_qr_solve_multi(rc_algebra_qr_t* qr, rc_matrix_t B, rc_matrix_t* X);
+
+/**
+ * @brief      Frees the memory of an rc_algebra_qr_t and returns it to the
+ * empty state.
+ *
+ * @param      qr    pointer to user's rc_algebra_qr_t
+ *
+ * @return     Returns 0 on success or -1 on failure.
+ */
+int rc_algebra_qr_free(rc_algebra_qr_t* qr);
+
 /**
  * @brief      Fits an ellipsoid to a set of points in 3D space.
  *
@@ -145,6 +322,91 @@ int rc_algebra_lin_system_solve_qr(rc_matrix_t A, rc_vector_t b, rc_vector_t* x)
 int rc_algebra_fit_ellipsoid(rc_matrix_t points, rc_vector_t* center, rc_vector_t* lengths);
 
 
+/**
+ * @brief      State of a streaming ellipsoid fit, see
+ * rc_ellipsoid_fit_add_point().
+ *
+ * Only the normal equations of the least squares problem solved by
+ * rc_algebra_fit_ellipsoid() are stored so memory use and the cost of adding a
+ * point are constant no matter how many points are fit. Contains no
+ * dynamically allocated memory.
+ */
+typedef struct rc_ellipsoid_fit_t{
+	double ata[6][6];	///< accumulated A'A, only the upper triangle is used
+	double atb[6];		///< accumulated A'b
+	double forget;		///< forgetting factor applied to old points, 1.0 for none
+	double weight;		///< effective number of points after forgetting
+	uint64_t n;		///< number of points added since last reset
+	int initialized;	///< set to 1 by rc_ellipsoid_fit_init()
+} rc_ellipsoid_fit_t;
+
+#define RC_ELLIPSOID_FIT_INITIALIZER {\
+	.ata = {{0.0}},\
+	.atb = {0.0},\
+	.forget = 1.0,\
+	.weight = 0.0,\
+	.n = 0,\
+	.initialized = 0}
+
+/**
+ * @brief      Returns an rc_ellipsoid_fit_t with no points and not yet
+ * initialized.
+ *
+ * @return     empty rc_ellipsoid_fit_t
+ */
+rc_ellipsoid_fit_t rc_ellipsoid_fit_empty(void);
+
+/**
+ * @brief      Prepares a streaming ellipsoid fit.
+ *
+ * With forget=1.0 every point counts equally and the result matches
+ * rc_algebra_fit_ellipsoid() on the same points. With forget slightly less
+ * than 1 older points are exponentially discounted so the fit tracks a slowly
+ * changing ellipsoid, remembering roughly the last 1/(1-forget) points.
+ *
+ * @param      e       pointer to user's rc_ellipsoid_fit_t
+ * @param[in]  forget  forgetting factor, 0 < forget <= 1
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_ellipsoid_fit_init(rc_ellipsoid_fit_t* e, double forget);
+
+/**
+ * @brief      Discards all points, keeping the forgetting factor.
+ *
+ * @param      e     pointer to user's rc_ellipsoid_fit_t
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_ellipsoid_fit_reset(rc_ellipsoid_fit_t* e);
+
+/**
+ * @brief      Adds one point to the fit in constant time.
+ *
+ * @param      e     pointer to user's rc_ellipsoid_fit_t
+ * @param[in]  p     x,y,z coordinates of the point
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_ellipsoid_fit_add_point(rc_ellipsoid_fit_t* e, const double p[3]);
+
+/**
+ * @brief      Solves for the ellipsoid best fitting the points added so far.
+ *
+ * Same model and outputs as rc_algebra_fit_ellipsoid(). Fails without
+ * printing if the points don't yet cover enough directions to define an
+ * ellipsoid, so it is safe to call repeatedly while points are still being
+ * collected.
+ *
+ * @param      e        pointer to user's rc_ellipsoid_fit_t
+ * @param[out] center   center of ellipsoid
+ * @param[out] lengths  lengths along principle axis
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_ellipsoid_fit_solve(rc_ellipsoid_fit_t* e, double center[3], double lengths[3]);
+
+
 #ifdef  __cplusplus
 }
 #endif
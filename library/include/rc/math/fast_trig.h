@@ -0,0 +1,138 @@
+/**
+ * <rc/math/fast_trig.h>
+ *
+ * @brief      Polynomial approximations of the trig functions used for
+ * attitude math, with bounded error.
+ *
+ * libm computes atan2, asin, sin and cos to the last bit, which costs hundreds
+ * of cycles per call on the AM335x. Attitude conversions only need a small
+ * fraction of a degree, so these functions trade accuracy for speed with a
+ * documented worst case error. They use only multiply, add, divide and sqrt,
+ * which the VFP does in hardware, and never call into libm.
+ *
+ * Each function is standalone. rc_quaternion_set_fast_trig() switches the
+ * quaternion/Tait-Bryan conversions over to them for the whole process, while
+ * rc_quaternion_to_tb_array_fast() and rc_quaternion_from_tb_array_fast() use
+ * them for a single call. The mpu config option fast_trig uses the latter for
+ * the DMP and magnetometer fusion of that one instance, so it doesn't change
+ * the conversions seen by the rest of the program.
+ *
+ * See the rc_benchmark_trig example for measured error and speed against
+ * libm.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ *
+ * @addtogroup Fast_Trig
+ * @ingroup    Math
+ * @{
+ */
+
+#ifndef RC_MATH_FAST_TRIG_H
+#define RC_MATH_FAST_TRIG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Worst case absolute error in radians of rc_fast_atan(), rc_fast_atan2() and
+ * rc_fast_asin().
+ */
+#define RC_FAST_ATAN_MAX_ERROR	1e-7
+
+/**
+ * Worst case absolute error of rc_fast_sin(), rc_fast_cos() and
+ * rc_fast_sincos() for inputs of magnitude up to 1e4 radians. Range reduction
+ * loses accuracy beyond that.
+ */
+#define RC_FAST_SIN_MAX_ERROR	1e-6
+
+/**
+ * Largest input magnitude in radians accepted by rc_fast_sin(), rc_fast_cos(),
+ * rc_fast_sincos() and rc_fast_wrap_pi(). They return NAN for anything larger,
+ * for infinities and for NAN.
+ */
+#define RC_FAST_TRIG_MAX_INPUT	1e9
+
+/**
+ * @brief      Arctangent.
+ *
+ * @param[in]  x     any value
+ *
+ * @return     atan(x) between -pi/2 and pi/2, within RC_FAST_ATAN_MAX_ERROR
+ */
+double rc_fast_atan(double x);
+
+/**
+ * @brief      Four quadrant arctangent, drop-in replacement for atan2(y,x).
+ *
+ * Returns 0 when both inputs are 0.
+ *
+ * @param[in]  y     y coordinate
+ * @param[in]  x     x coordinate
+ *
+ * @return     angle between -pi and pi, within RC_FAST_ATAN_MAX_ERROR
+ */
+double rc_fast_atan2(double y, double x);
+
+/**
+ * @brief      Arcsine.
+ *
+ * Unlike asin(), inputs slightly outside of [-1,1] from rounding error are
+ * clamped instead of returning NAN.
+ *
+ * @param[in]  x     value between -1 and 1
+ *
+ * @return     asin(x) between -pi/2 and pi/2, within RC_FAST_ATAN_MAX_ERROR
+ */
+double rc_fast_asin(double x);
+
+/**
+ * @brief      Sine.
+ *
+ * @param[in]  x     angle in radians
+ *
+ * @return     sin(x) within RC_FAST_SIN_MAX_ERROR
+ */
+double rc_fast_sin(double x);
+
+/**
+ * @brief      Cosine.
+ *
+ * @param[in]  x     angle in radians
+ *
+ * @return     cos(x) within RC_FAST_SIN_MAX_ERROR
+ */
+double rc_fast_cos(double x);
+
+/**
+ * @brief      Sine and cosine of the same angle, sharing the range reduction.
+ *
+ * @param[in]  x     angle in radians
+ * @param[out] s     sin(x) within RC_FAST_SIN_MAX_ERROR
+ * @param[out] c     cos(x) within RC_FAST_SIN_MAX_ERROR
+ */
+void rc_fast_sincos(double x, double* s, double* c);
+
+/**
+ * @brief      Wraps an angle to the range -pi to pi.
+ *
+ * Same result as fmod() by 2pi followed by a single correction, without the
+ * libm call. Exact to within rounding of the subtraction.
+ *
+ * @param[in]  x     angle in radians
+ *
+ * @return     equivalent angle between -pi and pi, or NAN when x is beyond
+ * RC_FAST_TRIG_MAX_INPUT
+ */
+double rc_fast_wrap_pi(double x);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RC_MATH_FAST_TRIG_H
+
+/** @} end group math*/
@@ -26,6 +26,7 @@ extern "C" {
 
 #include <rc/math/vector.h>
 #include <rc/math/matrix.h>
+#include <rc/math/fast_trig.h>
 
 /**
  * @brief      Returns the length of a quaternion vector by finding its 2-norm.
@@ -65,6 +66,22 @@ int   rc_normalize_quaternion(rc_vector_t* q);
  */
 int   rc_normalize_quaternion_array(double q[4]);
 
+/**
+ * @brief      Switches the Tait-Bryan conversions between libm and the fast
+ * polynomial trig functions in <rc/math/fast_trig.h>.
+ *
+ * Off by default. When enabled, rc_quaternion_to_tb(),
+ * rc_quaternion_to_tb_array(), rc_quaternion_to_tb_batch(),
+ * rc_quaternion_from_tb() and rc_quaternion_from_tb_array() use
+ * rc_fast_atan2(), rc_fast_asin() and rc_fast_sincos() instead. Angles are then
+ * within RC_FAST_ATAN_MAX_ERROR and quaternion elements within
+ * RC_FAST_SIN_MAX_ERROR of the libm results. This setting is process-wide,
+ * like rc_algebra_set_zero_tolerance().
+ *
+ * @param[in]  enable  1 to use the fast functions, 0 to return to libm
+ */
+void rc_quaternion_set_fast_trig(int enable);
+
 /**
  * @brief      Calculates 321 Tait Bryan angles in array order XYZ with
  * operation order 321(yaw-Z, pitch-Y, roll-x).
@@ -91,6 +108,21 @@ int   rc_quaternion_to_tb(rc_vector_t q, rc_vector_t* tb);
  */
 int  rc_quaternion_to_tb_array(double q[4], double tb[3]);
 
+/**
+ * @brief      Same as rc_quaternion_to_tb_array() but always uses the fast
+ * polynomial trig functions, regardless of rc_quaternion_set_fast_trig().
+ *
+ * For code that wants the fast conversion for itself without switching it on
+ * for the whole process. Angles are within RC_FAST_ATAN_MAX_ERROR of the libm
+ * results.
+ *
+ * @param[in]  q     The quarternion in form of an array of lenth 4
+ * @param[out] tb    Output tait-bryan angles
+ *
+ * @return     Returns 0 on success or -1 on failure
+ */
+int  rc_quaternion_to_tb_array_fast(double q[4], double tb[3]);
+
 /**
  * @brief      Calculates quaternion vector q from tait-bryan angles tb.
  *
@@ -119,6 +151,19 @@ int   rc_quaternion_from_tb(rc_vector_t tb, rc_vector_t* q);
  */
 int  rc_quaternion_from_tb_array(double tb[3], double q[4]);
 
+/**
+ * @brief      Same as rc_quaternion_from_tb_array() but always uses the fast
+ * polynomial trig functions, regardless of rc_quaternion_set_fast_trig().
+ *
+ * Quaternion elements are within RC_FAST_SIN_MAX_ERROR of the libm results.
+ *
+ * @param[in]  tb    input tait-bryan angles
+ * @param[out] q     output quaternion
+ *
+ * @return     Returns 0 on success or -1 on failure
+ */
+int  rc_quaternion_from_tb_array_fast(double tb[3], double q[4]);
+
 /**
  * @brief      Calculates conjugate of quaternion q.
  *
@@ -284,6 +329,165 @@ int  rc_quaternion_rotate_vector_array(double v[3], double q[4]);
 int   rc_quaternion_to_rotation_matrix(rc_vector_t q, rc_matrix_t* m);
 
 
+/**
+ * @brief      N quaternions stored as structure of arrays.
+ *
+ * Each component lives in its own contiguous array so the batch functions
+ * below can process several quaternions per instruction on CPUs with double
+ * precision SIMD, and check their arguments once per call instead of once per
+ * quaternion. Allocate with rc_quaternion_batch_alloc().
+ */
+typedef struct rc_quaternion_batch_t{
+	int n;			///< number of quaternions
+	double* w;		///< real parts
+	double* i;		///< i components
+	double* j;		///< j components
+	double* k;		///< k components
+	int initialized;	///< set to 1 once memory has been allocated
+} rc_quaternion_batch_t;
+
+#define RC_QUATERNION_BATCH_INITIALIZER {\
+	.n = 0,\
+	.w = NULL,\
+	.i = NULL,\
+	.j = NULL,\
+	.k = NULL,\
+	.initialized = 0}
+
+/**
+ * @brief      N 3D vectors stored as structure of arrays, the companion of
+ * rc_quaternion_batch_t.
+ */
+typedef struct rc_quaternion_vec_batch_t{
+	int n;			///< number of vectors
+	double* x;		///< x components
+	double* y;		///< y components
+	double* z;		///< z components
+	int initialized;	///< set to 1 once memory has been allocated
+} rc_quaternion_vec_batch_t;
+
+#define RC_QUATERNION_VEC_BATCH_INITIALIZER {\
+	.n = 0,\
+	.x = NULL,\
+	.y = NULL,\
+	.z = NULL,\
+	.initialized = 0}
+
+/**
+ * @brief      Returns an rc_quaternion_batch_t with no memory allocated.
+ *
+ * @return     empty rc_quaternion_batch_t
+ */
+rc_quaternion_batch_t rc_quaternion_batch_empty(void);
+
+/**
+ * @brief      Allocates aligned memory for n quaternions.
+ *
+ * Does nothing if b already holds n quaternions, otherwise existing memory is
+ * freed first. The contents are not initialized.
+ *
+ * @param      b     pointer to user's rc_quaternion_batch_t
+ * @param[in]  n     number of quaternions
+ *
+ * @return     Returns 0 on success or -1 on failure.
+ */
+int rc_quaternion_batch_alloc(rc_quaternion_batch_t* b, int n);
+
+/**
+ * @brief      Frees the memory of an rc_quaternion_batch_t and returns it to
+ * the empty state.
+ *
+ * @param      b     pointer to user's rc_quaternion_batch_t
+ *
+ * @return     Returns 0 on success or -1 on failure.
+ */
+int rc_quaternion_batch_free(rc_quaternion_batch_t* b);
+
+/**
+ * @brief      Returns an rc_quaternion_vec_batch_t with no memory allocated.
+ *
+ * @return     empty rc_quaternion_vec_batch_t
+ */
+rc_quaternion_vec_batch_t rc_quaternion_vec_batch_empty(void);
+
+/**
+ * @brief      Allocates aligned memory for n vectors.
+ *
+ * Does nothing if v already holds n vectors, otherwise existing memory is
+ * freed first. The contents are not initialized.
+ *
+ * @param      v     pointer to user's rc_quaternion_vec_batch_t
+ * @param[in]  n     number of vectors
+ *
+ * @return     Returns 0 on success or -1 on failure.
+ */
+int rc_quaternion_vec_batch_alloc(rc_quaternion_vec_batch_t* v, int n);
+
+/**
+ * @brief      Frees the memory of an rc_quaternion_vec_batch_t and returns it
+ * to the empty state.
+ *
+ * @param      v     pointer to user's rc_quaternion_vec_batch_t
+ *
+ * @return     Returns 0 on success or -1 on failure.
+ */
+int rc_quaternion_vec_batch_free(rc_quaternion_vec_batch_t* v);
+
+/**
+ * @brief      Normalizes every quaternion in a batch in place.
+ *
+ * Quaternions of zero length are set to zero rather than reported as errors.
+ *
+ * @param      q     pointer to batch of quaternions
+ *
+ * @return     Returns 0 on success or -1 on failure.
+ */
+int rc_quaternion_normalize_batch(rc_quaternion_batch_t* q);
+
+/**
+ * @brief      Multiplies c[n] = a[n]*b[n] for every quaternion in the batches.
+ *
+ * c is allocated if it is not already the same size as a and b. c must not
+ * be the same batch as a or b.
+ *
+ * @param[in]  a     left batch
+ * @param[in]  b     right batch
+ * @param[out] c     result batch
+ *
+ * @return     Returns 0 on success or -1 on failure.
+ */
+int rc_quaternion_multiply_batch(rc_quaternion_batch_t a, rc_quaternion_batch_t b, rc_quaternion_batch_t* c);
+
+/**
+ * @brief      Rotates v[n] in place by q[n] for every vector in the batch,
+ * equivalent to rc_quaternion_rotate_vector_array() on each.
+ *
+ * Uses the identity v' = v + 2w(u x v) + 2u x (u x v) with u the imaginary
+ * part of q, which is cheaper than two quaternion multiplications but assumes
+ * every q is normalized.
+ *
+ * @param      v     pointer to batch of vectors to be rotated
+ * @param[in]  q     batch of unit rotation quaternions
+ *
+ * @return     Returns 0 on success or -1 on failure.
+ */
+int rc_quaternion_rotate_vector_batch(rc_quaternion_vec_batch_t* v, rc_quaternion_batch_t q);
+
+/**
+ * @brief      Converts every quaternion in a batch to Tait-Bryan angles,
+ * equivalent to rc_quaternion_to_tb_array() on each.
+ *
+ * tb is allocated if it is not already the same size as q. The x, y, and z
+ * arrays of tb receive roll, pitch, and yaw respectively.
+ *
+ * @param[in]  q     batch of normalized quaternions
+ * @param[out] tb    batch of Tait-Bryan angles in radians
+ *
+ * @return     Returns 0 on success or -1 on failure.
+ */
+int rc_quaternion_to_tb_batch(rc_quaternion_batch_t q, rc_quaternion_vec_batch_t* tb);
+
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,191 @@
+/**
+ * <rc/math/rls.h>
+ *
+ * @brief      Recursive least squares estimator
+ *
+ * Estimates the parameters theta of a linear-in-the-parameters model
+ * y = phi^T * theta one measurement at a time. Each update costs O(n^2) for n
+ * parameters and uses workspace allocated once by rc_rls_alloc(), so it is
+ * suitable for online identification inside a control loop, for example motor
+ * constants from duty cycle and encoder velocity or battery internal
+ * resistance from voltage and current.
+ *
+ * Without forgetting (lambda=1) the estimate converges to the same answer as
+ * rc_algebra_lin_system_solve_qr() on all the measurements stacked together.
+ * With lambda slightly less than 1, old measurements are exponentially
+ * discounted so the estimate can follow slowly changing parameters. Forgetting
+ * is capped so that P never grows past its starting size, see rc_rls_update().
+ * That means delta also limits how fast the estimate can track a change, so
+ * when tracking is too slow raise delta rather than lowering lambda.
+ *
+ * Basic loop structure:
+ *
+ * ```C
+ * rc_rls_t rls = rc_rls_empty();
+ * rc_vector_t phi = rc_vector_empty();
+ * rc_vector_alloc(&phi, 2);
+ * rc_rls_alloc(&rls, 2, 0.99, 1000.0);
+ * while(running){
+ *      measure sensors, fill in regressor phi and measurement y;
+ *      rc_rls_update(&rls, phi, y);
+ *      use rls.theta;
+ * }
+ * rc_rls_free(&rls);
+ * ```
+ *
+ * See the rc_benchmark_rls example for timing against the batch solution.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ *
+ * @addtogroup RLS
+ * @ingroup    Math
+ * @{
+ */
+
+#ifndef RC_RLS_H
+#define RC_RLS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <rc/math/vector.h>
+#include <rc/math/matrix.h>
+
+/**
+ * @brief      Struct containing the state of a recursive least squares
+ * estimator.
+ */
+typedef struct rc_rls_t{
+	/** @name configuration */
+	///@{
+	int n;			///< number of parameters
+	double lambda;		///< forgetting factor, 0 < lambda <= 1
+	double delta;		///< initial covariance P = delta*I
+	///@}
+
+	/** @name state */
+	///@{
+	rc_vector_t theta;	///< parameter estimate, read this after each update
+	rc_matrix_t P;		///< scaled inverse of the regressor correlation matrix
+	double error;		///< prediction error y - phi^T*theta of the last update, before correction
+	uint64_t step;		///< number of updates since last reset
+	///@}
+
+	/** @name workspace */
+	///@{
+	rc_vector_t Pphi;	///< P*phi, used by rc_rls_update()
+	///@}
+
+	int initialized;	///< set to 1 once allocated with rc_rls_alloc()
+} rc_rls_t;
+
+#define RC_RLS_INITIALIZER {\
+	.n = 0,\
+	.lambda = 1.0,\
+	.delta = 0.0,\
+	.theta = RC_VECTOR_INITIALIZER,\
+	.P = RC_MATRIX_INITIALIZER,\
+	.error = 0.0,\
+	.step = 0,\
+	.Pphi = RC_VECTOR_INITIALIZER,\
+	.initialized = 0}
+
+/**
+ * @brief      Critical function for initializing rc_rls_t structs.
+ *
+ * Serves the same purpose as rc_kalman_empty() and should be used on any
+ * rc_rls_t before it is passed to rc_rls_alloc().
+ *
+ * @return     Empty zero-filled rc_rls_t struct
+ */
+rc_rls_t rc_rls_empty(void);
+
+/**
+ * @brief      Allocates memory for an estimator of n parameters and resets it.
+ *
+ * delta sets the initial covariance and so how far the first few updates are
+ * allowed to move theta from zero. Use a large value such as 1000 when
+ * nothing is known about the parameters. Since forgetting stops once trace(P)
+ * reaches n*delta, delta also bounds how quickly the estimate can track
+ * changing parameters when lambda<1. On failure rls is left empty.
+ *
+ * @param      rls     pointer to user's rc_rls_t struct
+ * @param[in]  n       number of parameters
+ * @param[in]  lambda  forgetting factor, 0 < lambda <= 1
+ * @param[in]  delta   initial covariance, > 0
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_rls_alloc(rc_rls_t* rls, int n, double lambda, double delta);
+
+/**
+ * @brief      Frees the memory allocated by rc_rls_alloc() and returns the
+ * struct to the same state as rc_rls_empty().
+ *
+ * @param      rls   pointer to user's rc_rls_t struct
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_rls_free(rc_rls_t* rls);
+
+/**
+ * @brief      Sets theta to zero and P to delta*I, keeping the configuration.
+ *
+ * @param      rls   pointer to user's rc_rls_t struct
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_rls_reset(rc_rls_t* rls);
+
+/**
+ * @brief      Incorporates one measurement into the estimate.
+ *
+ * - e = y - phi^T*theta
+ * - k = P*phi / (lambda + phi^T*P*phi)
+ * - theta = theta + k*e
+ * - P = (P - k*phi^T*P) / lambda
+ *
+ * P is kept exactly symmetric. When lambda<1 and phi stops carrying new
+ * information, P would otherwise grow without bound, so the division by
+ * lambda is only applied while the trace of P stays at or below its initial
+ * value n*delta. Once the trace reaches that limit the update behaves as if
+ * lambda were 1 until new information shrinks P again. For tracking this means
+ * the gain never exceeds what the initial covariance allows: with plenty of
+ * excitation the discounting works as normal, but after a long quiet stretch
+ * the estimator has already used up its forgetting and the first measurements
+ * after a parameter jump are weighted no more heavily than right after
+ * rc_rls_reset(). Call rc_rls_reset() when a jump is known to have happened.
+ *
+ * Costs O(n^2) and allocates no memory.
+ *
+ * @param      rls   pointer to user's rc_rls_t struct
+ * @param[in]  phi   regressor vector of length n
+ * @param[in]  y     measurement
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_rls_update(rc_rls_t* rls, rc_vector_t phi, double y);
+
+/**
+ * @brief      Predicts the measurement for a regressor with the current
+ * estimate.
+ *
+ * @param      rls   pointer to user's rc_rls_t struct
+ * @param[in]  phi   regressor vector of length n
+ * @param[out] y     predicted measurement phi^T*theta
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_rls_predict(rc_rls_t* rls, rc_vector_t phi, double* y);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RC_RLS_H
+
+/** @} end group math*/
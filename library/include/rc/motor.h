@@ -94,6 +94,10 @@ int rc_motor_standby(int standby_en);
  * @brief      Sets the bidirectional duty cycle (power) to a single motor or
  * all motors if 0 is provided as a channel.
  *
+ * The H-bridge direction pins on each gpio chip are written together, so when
+ * setting all channels every direction changes in one write per chip before
+ * the duty cycles are updated.
+ *
  * @param[in]  ch    The motor channel (1-4) or 0 for all channels.
  * @param[in]  duty  Duty cycle, -1.0 for full reverse, 1.0 for full forward
  *
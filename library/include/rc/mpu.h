@@ -24,6 +24,16 @@
  * the BeagleBone triggering the buffer read followed by the execution of a
  * function of your choosing set with the rc_mpu_set_dmp_callback() function.
  *
+ * ##AHRS Mode
+ *
+ * An alternative to DMP mode started with rc_mpu_initialize_ahrs(). The DMP
+ * firmware is not loaded, instead the data-ready interrupt triggers a burst
+ * read of the raw accel, gyro and temperature registers at up to 1kHz and a
+ * software Mahony or Madgwick filter (see <rc/math/ahrs.h>) computes the
+ * orientation. The same dmp_quat, dmp_TaitBryan, fused_quat and
+ * fused_TaitBryan fields are filled in and all the DMP mode callback and
+ * blocking functions work unchanged.
+ *
  * @author     James Strawson
  * @date       1/19/2018
  *
@@ -40,9 +50,11 @@ extern "C" {
 
 #include <stdint.h>
 #include <pthread.h>
+#include <rc/math/ahrs.h>
 
 #define RC_MPU_DEFAULT_I2C_ADDR	0x68 ///< default i2c address if AD0 is left low
 #define RC_MPU_ALT_I2C_ADDR	0x69 ///< alternate i2c address if AD0 pin pulled high
+#define RC_MPU_MAX_SUBSCRIBERS	8    ///< maximum simultaneous subscribers per MPU
 
 
 // defines for index location within TaitBryan and quaternion vectors
@@ -160,6 +172,7 @@ typedef struct rc_mpu_config_t{
 	int i2c_bus;			///< which bus to use, default 2 on Robotics Cape and BB Blue
 	uint8_t i2c_addr;		///< default is 0x68, pull pin ad0 high to make it 0x69
 	int show_warnings;		///< set to 1 to print i2c_bus warnings for debug
+	int fast_start;			///< set to 1 to poll status registers instead of fixed sleeps and burst upload the DMP firmware during initialization, default 0 (off)
 	///@}
 
 	/** @name accelerometer, gyroscope, and magnetometer configuration */
@@ -169,6 +182,10 @@ typedef struct rc_mpu_config_t{
 	rc_mpu_accel_dlpf_t accel_dlpf;	///< internal low pass filter cutoff, default ACCEL_DLPF_184
 	rc_mpu_gyro_dlpf_t gyro_dlpf;	///< internal low pass filter cutoff, default GYRO_DLPF_184
 	int enable_magnetometer;	///< magnetometer use is optional, set to 1 to enable, default 0 (off)
+	int mag_use_i2c_master;		///< set to 1 to have the MPU's internal i2c master sample the magnetometer into EXT_SENS_DATA instead of using bypass mode, in DMP and AHRS mode it is then read in the same transaction as the sample, default 0 (off)
+	int mag_online_cal;		///< set to 1 to keep fitting the magnetometer calibration in the background, see rc_mpu_get_online_calibration(), default 0 (off)
+	int accel_online_cal;		///< set to 1 to keep fitting the accelerometer calibration from samples taken while still, needs dmp_fetch_accel_gyro in DMP mode, default 0 (off)
+	int fast_trig;			///< set to 1 in DMP or AHRS mode to compute Tait-Bryan angles and compass heading with the polynomial approximations in <rc/math/fast_trig.h>, only affects this instance and not rc_quaternion_set_fast_trig(), default 0 (off)
 	///@}
 
 	/** @name DMP settings, only used with DMP mode */
@@ -185,6 +202,15 @@ typedef struct rc_mpu_config_t{
 	int tap_threshold;		///< threshold impulse for triggering a tap in units of mg/ms
 	///@}
 
+	/** @name AHRS settings, only used with AHRS mode */
+	///@{
+	rc_ahrs_type_t ahrs_type;	///< software orientation filter, default RC_AHRS_MAHONY
+	int ahrs_sample_rate;		///< raw sample and filter rate in hertz, a divisor of 1000 from 4 to 1000, default 500
+	double ahrs_kp;			///< Mahony proportional gain, default 1.0
+	double ahrs_ki;			///< Mahony integral gain, default 0.0
+	double ahrs_beta;		///< Madgwick gain, default 0.1
+	///@}
+
 } rc_mpu_config_t;
 
 
@@ -232,6 +258,86 @@ typedef struct rc_mpu_data_t{
 } rc_mpu_data_t;
 
 
+/**
+ * @brief      time spent in each phase of the last initialization
+ *
+ * Filled in by rc_mpu_initialize_dmp() and rc_mpu_initialize_ahrs(), read it
+ * back with rc_mpu_get_init_timing(). Phases which don't apply to the mode
+ * used, such as the firmware upload in AHRS mode, are left at 0.
+ */
+typedef struct rc_mpu_init_timing_t{
+	uint64_t reset_ns;		///< device reset and WHO_AM_I check
+	uint64_t sensor_config_ns;	///< calibration, full scale ranges, filters, and sample rate
+	uint64_t mag_init_ns;		///< magnetometer setup and starting heading
+	uint64_t firmware_load_ns;	///< writing the DMP firmware
+	uint64_t firmware_verify_ns;	///< reading the DMP firmware back
+	uint64_t dmp_config_ns;		///< DMP features, rates, and interrupt setup
+	uint64_t total_ns;		///< total time in the initialize function
+} rc_mpu_init_timing_t;
+
+
+/**
+ * @brief      function called with each new sample by rc_mpu_subscribe()
+ *
+ * data points to a copy of the sample that stays valid until the function
+ * returns. ctx is the pointer given to rc_mpu_subscribe().
+ */
+typedef void (*rc_mpu_subscriber_func_t)(const rc_mpu_data_t* data, void* ctx);
+
+/**
+ * @brief      how a subscriber receives samples, see rc_mpu_subscribe()
+ */
+typedef struct rc_mpu_subscriber_config_t{
+	int queue_len;		///< 0 to run inline on the interrupt thread, otherwise number of samples buffered for the subscriber's own thread, default 0
+	int sched_policy;	///< scheduler policy for the subscriber thread, default SCHED_OTHER
+	int priority;		///< scheduler priority for the subscriber thread, default 0
+	uint64_t budget_ns;	///< callbacks taking longer than this count as an overrun, 0 to disable, default 0
+} rc_mpu_subscriber_config_t;
+
+/**
+ * @brief      delivery statistics for one subscriber
+ */
+typedef struct rc_mpu_subscriber_stats_t{
+	uint64_t calls;		///< samples delivered to the callback
+	uint64_t dropped;	///< oldest samples discarded because the queue was full
+	uint64_t overruns;	///< callbacks that took longer than budget_ns
+	uint64_t last_ns;	///< duration of the most recent callback
+	uint64_t max_ns;	///< longest callback duration
+	uint64_t total_ns;	///< sum of all callback durations, divide by calls for the mean
+	int max_queue_depth;	///< most samples ever waiting in the queue
+} rc_mpu_subscriber_stats_t;
+
+
+/**
+ * @brief      result of the background calibration fits
+ *
+ * Filled in by rc_mpu_get_online_calibration(). The values are in the same
+ * form as those written by rc_mpu_calibrate_mag_routine() and
+ * rc_mpu_calibrate_accel_routine().
+ */
+typedef struct rc_mpu_online_cal_t{
+	int mag_valid;			///< 1 if the magnetometer fit has converged to a plausible result
+	double mag_offsets[3];		///< hard iron offsets (uT)
+	double mag_scales[3];		///< soft iron scale factors
+	uint64_t mag_points;		///< points accepted into the magnetometer fit
+	int accel_valid;		///< 1 if the accelerometer fit has converged to a plausible result
+	double accel_center[3];		///< accelerometer offsets (G)
+	double accel_lengths[3];	///< accelerometer scale (G)
+	uint64_t accel_points;		///< points accepted into the accelerometer fit
+} rc_mpu_online_cal_t;
+
+
+/**
+ * @brief      Opaque handle to one MPU and its interrupt thread.
+ *
+ * Every function in this header without an rc_mpu_t argument operates on a
+ * single default instance. To run more than one IMU at a time, such as a
+ * second external IMU on another bus, create an instance for each with
+ * rc_mpu_instance_create() and use the rc_mpu_instance_* functions.
+ */
+typedef struct rc_mpu_t rc_mpu_t;
+
+
 /** @name common functions */
 ///@{
 
@@ -263,6 +369,18 @@ int rc_mpu_set_config_to_default(rc_mpu_config_t* conf);
  * @return     0 on success or -1 on failure.
  */
 int rc_mpu_power_off(void);
+
+/**
+ * @brief      Reports how long each phase of the last call to
+ * rc_mpu_initialize_dmp() or rc_mpu_initialize_ahrs() took.
+ *
+ * Useful for checking the effect of the fast_start config option.
+ *
+ * @param[out] timing  user's struct to copy the timing into
+ *
+ * @return     0 on success or -1 on failure.
+ */
+int rc_mpu_get_init_timing(rc_mpu_init_timing_t* timing);
 ///@} end common functions
 
 
@@ -339,6 +457,10 @@ int rc_mpu_read_temp(rc_mpu_data_t* data);
  * been set in the user's rc_mpu_config_t when it was passed to
  * rc_mpu_initialize()
  *
+ * If mag_use_i2c_master was set in the config then the magnetometer is sampled
+ * automatically by the MPU's internal i2c master and this reads the latest
+ * sample out of the EXT_SENS_DATA registers without switching i2c address.
+ *
  * @param      data  Pointer to user's data struct where new data will be
  * written
  *
@@ -388,6 +510,24 @@ int rc_mpu_set_dmp_callback(void (*func)(void));
 int rc_mpu_block_until_dmp_data(void);
 
 
+/**
+ * @brief      Copies the most recent DMP sample into the user's struct
+ *
+ * Every time the interrupt thread finishes reading a sample it publishes a copy
+ * through a seqlock. This function retries until it gets a copy that was not
+ * being written at the same time so the quaternion, Tait-Bryan angles and
+ * raw data are always from the same sample. The interrupt thread never waits
+ * on callers of this function so it is safe to use from any thread at any
+ * rate, unlike reading the struct passed to rc_mpu_initialize_dmp() directly.
+ *
+ * @param[out] out   user's struct to copy the latest sample into
+ *
+ * @return     0 on success, 1 if no sample has been published yet, or -1 on
+ * error.
+ */
+int rc_mpu_get_latest(rc_mpu_data_t* out);
+
+
 /**
  * @brief      calculates number of nanoseconds since the last DMP interrupt
  *
@@ -426,6 +566,101 @@ int64_t rc_mpu_nanos_since_last_tap(void);
 ///@} end interrupt-driven DMP mode functions
 
 
+/** @name interrupt-driven AHRS mode functions */
+///@{
+
+/**
+ * @brief      Initializes the MPU in AHRS mode, see rc_test_dmp example
+ *
+ * Like rc_mpu_initialize_dmp() but the orientation is computed on the
+ * BeagleBone from raw data sampled at ahrs_sample_rate instead of by the DMP.
+ * This skips the DMP firmware upload so initialization is much faster, and
+ * allows sample rates up to 1kHz. The accel, gyro, dmp_quat and dmp_TaitBryan
+ * fields are updated every sample. If the magnetometer is enabled it is read
+ * every mag_sample_rate_div samples and a second filter fills in fused_quat,
+ * fused_TaitBryan and compass_heading. Tap detection is not available.
+ *
+ * The sample rate comes from dividing the MPU's 1kHz internal rate, so
+ * ahrs_sample_rate must divide 1000 evenly. gyro_dlpf can't be GYRO_DLPF_OFF
+ * or GYRO_DLPF_250 since the gyro then runs faster and ignores the divider.
+ *
+ * Use rc_mpu_set_dmp_callback(), rc_mpu_block_until_dmp_data(),
+ * rc_mpu_get_latest() and rc_mpu_power_off() exactly as in DMP mode.
+ *
+ * @param      data  Pointer to user's data struct where new data will be
+ * written
+ * @param[in]  conf  User's configuration struct
+ *
+ * @return     0 on success or -1 on failure.
+ */
+int rc_mpu_initialize_ahrs(rc_mpu_data_t* data, rc_mpu_config_t conf);
+///@} end interrupt-driven AHRS mode functions
+
+
+
+/** @name sample subscriber functions */
+///@{
+
+/**
+ * @brief      Returns an rc_mpu_subscriber_config_t for an inline subscriber
+ * with overrun detection disabled.
+ *
+ * @return     default subscriber config
+ */
+rc_mpu_subscriber_config_t rc_mpu_subscriber_default_config(void);
+
+/**
+ * @brief      Registers a function to receive every new DMP or AHRS sample.
+ *
+ * Unlike rc_mpu_set_dmp_callback() any number of subscribers up to
+ * RC_MPU_MAX_SUBSCRIBERS may be registered at once, and they persist across
+ * rc_mpu_initialize_dmp() calls until unsubscribed or rc_mpu_power_off().
+ *
+ * With queue_len 0 the function runs inline on the interrupt thread right
+ * after the sample is read. This is meant for the one real-time consumer such
+ * as a feedback controller, anything it does delays the next read.
+ *
+ * With queue_len > 0 a thread is started for the subscriber with the given
+ * scheduler policy and priority. The interrupt thread only copies the sample
+ * into the subscriber's queue so a slow logger or telemetry link can never
+ * hold up the IMU. If the queue is full the oldest sample is dropped.
+ *
+ * Inline functions are called without any lock held, so they may call
+ * rc_mpu_subscribe(), rc_mpu_unsubscribe() including on themselves, and
+ * rc_mpu_get_subscriber_stats(). An rc_mpu_unsubscribe() from another thread
+ * waits for a running inline function to return. A queued subscriber must not
+ * unsubscribe itself since that joins its own thread, and no subscriber may
+ * call rc_mpu_power_off() since that joins the interrupt thread.
+ *
+ * @param[in]  func  function to call with each sample
+ * @param[in]  ctx   user pointer passed back to func
+ * @param[in]  conf  delivery configuration
+ *
+ * @return     subscriber id >= 0 on success or -1 on failure.
+ */
+int rc_mpu_subscribe(rc_mpu_subscriber_func_t func, void* ctx, rc_mpu_subscriber_config_t conf);
+
+/**
+ * @brief      Removes a subscriber, stopping its thread if it had one.
+ *
+ * @param[in]  id    id returned by rc_mpu_subscribe()
+ *
+ * @return     0 on success or -1 on failure.
+ */
+int rc_mpu_unsubscribe(int id);
+
+/**
+ * @brief      Copies out the delivery statistics for a subscriber.
+ *
+ * @param[in]  id     id returned by rc_mpu_subscribe()
+ * @param[out] stats  user's struct to copy the statistics into
+ *
+ * @return     0 on success or -1 on failure.
+ */
+int rc_mpu_get_subscriber_stats(int id, rc_mpu_subscriber_stats_t* stats);
+///@} end sample subscriber functions
+
+
 
 /** @name calibration functions */
 ///@{
@@ -509,8 +744,122 @@ int rc_mpu_is_accel_calibrated(void);
 
 
 
+/**
+ * @brief      Solves the background calibration fits for their current
+ * result.
+ *
+ * When mag_online_cal or accel_online_cal are set in the config, every
+ * sample read while the MPU is running is considered for a streaming
+ * ellipsoid fit which uses constant memory and time per sample. Points are
+ * only accepted once they are some distance from the last accepted point so
+ * sitting still doesn't swamp the fit, and accelerometer points are only
+ * taken while the gyro reads close to zero. Older points are slowly forgotten
+ * so the result follows changes such as a new payload near the magnetometer.
+ *
+ * A fit is only marked valid once the points cover enough directions and the
+ * result passes the same sanity checks as the interactive calibration
+ * routines, so keep calling this while the vehicle moves around normally.
+ *
+ * @param[out] cal   user's struct to write the results into
+ *
+ * @return     0 on success or -1 on failure.
+ */
+int rc_mpu_get_online_calibration(rc_mpu_online_cal_t* cal);
+
+/**
+ * @brief      Saves the valid parts of the background calibration to disk.
+ *
+ * A valid magnetometer calibration is also applied immediately to the running
+ * MPU. The accelerometer calibration takes effect the next time the MPU is
+ * initialized since its offsets live in hardware registers.
+ *
+ * @return     0 on success, 1 if neither fit is valid yet, or -1 on failure.
+ */
+int rc_mpu_save_online_calibration(void);
 ///@} end calibration functions
 
+
+
+/** @name multiple instance functions */
+///@{
+
+/**
+ * @brief      Allocates a new MPU instance
+ *
+ * Each instance keeps its own config, bus, address, interrupt pin, interrupt
+ * thread, and calibration. The MPU on the default bus and address uses the
+ * normal calibration files while any other uses files tagged with its bus and
+ * address, e.g. /var/lib/robotcontrol/gyro_1_69.cal. Those are written by
+ * the calibration routines above when given the same bus and address.
+ *
+ * Two instances on the same i2c bus share the bus with no arbitration beyond
+ * rc_i2c_lock_bus so putting each IMU on its own bus is recommended.
+ *
+ * @return     pointer to the new instance, or NULL on failure
+ */
+rc_mpu_t* rc_mpu_instance_create(void);
+
+/**
+ * @brief      Powers off the MPU if still running and frees the instance
+ *
+ * @param      mpu   instance from rc_mpu_instance_create()
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_mpu_instance_destroy(rc_mpu_t* mpu);
+
+/**
+ * @brief      Returns the instance used by the functions without an rc_mpu_t
+ * argument so existing code can be mixed with the instance API.
+ *
+ * @return     pointer to the default instance, never NULL
+ */
+rc_mpu_t* rc_mpu_default_instance(void);
+
+/** @brief instance version of rc_mpu_initialize() */
+int rc_mpu_instance_initialize(rc_mpu_t* mpu, rc_mpu_data_t* data, rc_mpu_config_t conf);
+/** @brief instance version of rc_mpu_read_accel() */
+int rc_mpu_instance_read_accel(rc_mpu_t* mpu, rc_mpu_data_t* data);
+/** @brief instance version of rc_mpu_read_gyro() */
+int rc_mpu_instance_read_gyro(rc_mpu_t* mpu, rc_mpu_data_t* data);
+/** @brief instance version of rc_mpu_read_mag() */
+int rc_mpu_instance_read_mag(rc_mpu_t* mpu, rc_mpu_data_t* data);
+/** @brief instance version of rc_mpu_read_temp() */
+int rc_mpu_instance_read_temp(rc_mpu_t* mpu, rc_mpu_data_t* data);
+/** @brief instance version of rc_mpu_power_off() */
+int rc_mpu_instance_power_off(rc_mpu_t* mpu);
+/** @brief instance version of rc_mpu_get_init_timing() */
+int rc_mpu_instance_get_init_timing(rc_mpu_t* mpu, rc_mpu_init_timing_t* timing);
+/** @brief instance version of rc_mpu_initialize_dmp() */
+int rc_mpu_instance_initialize_dmp(rc_mpu_t* mpu, rc_mpu_data_t* data, rc_mpu_config_t conf);
+/** @brief instance version of rc_mpu_initialize_ahrs() */
+int rc_mpu_instance_initialize_ahrs(rc_mpu_t* mpu, rc_mpu_data_t* data, rc_mpu_config_t conf);
+/** @brief instance version of rc_mpu_set_dmp_callback() */
+int rc_mpu_instance_set_dmp_callback(rc_mpu_t* mpu, void (*func)(void));
+/** @brief instance version of rc_mpu_block_until_dmp_data() */
+int rc_mpu_instance_block_until_dmp_data(rc_mpu_t* mpu);
+/** @brief instance version of rc_mpu_nanos_since_last_dmp_interrupt() */
+int64_t rc_mpu_instance_nanos_since_last_dmp_interrupt(rc_mpu_t* mpu);
+/** @brief instance version of rc_mpu_get_latest() */
+int rc_mpu_instance_get_latest(rc_mpu_t* mpu, rc_mpu_data_t* out);
+/** @brief instance version of rc_mpu_set_tap_callback() */
+int rc_mpu_instance_set_tap_callback(rc_mpu_t* mpu, void (*func)(int direction, int counter));
+/** @brief instance version of rc_mpu_block_until_tap() */
+int rc_mpu_instance_block_until_tap(rc_mpu_t* mpu);
+/** @brief instance version of rc_mpu_nanos_since_last_tap() */
+int64_t rc_mpu_instance_nanos_since_last_tap(rc_mpu_t* mpu);
+/** @brief instance version of rc_mpu_get_online_calibration() */
+int rc_mpu_instance_get_online_calibration(rc_mpu_t* mpu, rc_mpu_online_cal_t* cal);
+/** @brief instance version of rc_mpu_save_online_calibration() */
+int rc_mpu_instance_save_online_calibration(rc_mpu_t* mpu);
+/** @brief instance version of rc_mpu_subscribe() */
+int rc_mpu_instance_subscribe(rc_mpu_t* mpu, rc_mpu_subscriber_func_t func, void* ctx, rc_mpu_subscriber_config_t conf);
+/** @brief instance version of rc_mpu_unsubscribe() */
+int rc_mpu_instance_unsubscribe(rc_mpu_t* mpu, int id);
+/** @brief instance version of rc_mpu_get_subscriber_stats() */
+int rc_mpu_instance_get_subscriber_stats(rc_mpu_t* mpu, int id, rc_mpu_subscriber_stats_t* stats);
+///@} end multiple instance functions
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,220 @@
+/**
+ * <rc/rc_input.h>
+ *
+ * @brief      Byte stream decoders for RC receiver protocols other than DSM.
+ *
+ * Spektrum DSM satellites were long the only receivers the library could
+ * read. SBUS and CRSF receivers are common alternatives with lower latency:
+ *
+ * - SBUS sends 16 channels of 11 bits every 7 or 14ms at 100000 baud with
+ *   even parity and 2 stop bits. The signal is inverted, on boards whose UART
+ *   can't invert its input an external inverter is needed.
+ * - CRSF sends 16 channels of 11 bits every 4 to 6ms at 420000 baud, 8N1, and
+ *   interleaves link statistics such as RSSI, link quality and SNR.
+ *
+ * The DSM background service in <rc/dsm.h> runs these decoders when a protocol
+ * is chosen with rc_dsm_set_protocol(), so calibration, normalization,
+ * callbacks and connection loss work the same for every receiver.
+ *
+ * The decoders themselves never touch hardware. Feed them bytes from any
+ * source, a UART or a recorded capture, and they call back with each decoded
+ * frame. Framing is recovered within one frame after lost or corrupted bytes:
+ * SBUS frames are found by their header and footer bytes and the quiet gap
+ * between frames, CRSF frames by their address, length and CRC.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ *
+ * @addtogroup RC_Input
+ * @ingroup    IO
+ * @{
+ */
+
+#ifndef RC_INPUT_H
+#define RC_INPUT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define RC_INPUT_MAX_CHANNELS	16	///< most channels any protocol carries
+#define RC_INPUT_MAX_FRAME	64	///< longest frame of any protocol in bytes
+
+
+/**
+ * receiver protocols
+ */
+typedef enum rc_input_protocol_t{
+	RC_INPUT_DSM,	///< Spektrum DSM2/DSMX satellite, 115200 baud, decoded by rc_dsm itself
+	RC_INPUT_SBUS,	///< Futaba SBUS, 100000 baud 8E2 inverted
+	RC_INPUT_CRSF	///< TBS Crossfire and ExpressLRS CRSF, 420000 baud 8N1
+} rc_input_protocol_t;
+
+
+/**
+ * one decoded set of channels
+ */
+typedef struct rc_input_channels_t{
+	int channels;				///< number of channels in the frame
+	int raw[RC_INPUT_MAX_CHANNELS];		///< pulse widths in microseconds, 988 to 2012 at full travel
+	int failsafe;				///< SBUS: 1 if the receiver lost the transmitter and is sending its failsafe values
+	int frame_lost;				///< SBUS: 1 if the receiver missed the frame before this one
+	uint64_t timestamp_ns;			///< timestamp given with the bytes that completed the frame
+} rc_input_channels_t;
+
+
+/**
+ * CRSF link statistics sent by the receiver, about every 200ms
+ */
+typedef struct rc_input_link_stats_t{
+	int uplink_rssi_1;		///< RSSI of antenna 1 in dBm
+	int uplink_rssi_2;		///< RSSI of antenna 2 in dBm
+	int uplink_link_quality;	///< percentage of packets received
+	int uplink_snr;			///< signal to noise ratio in dB
+	int active_antenna;		///< antenna in use, 0 or 1
+	int rf_mode;			///< packet rate mode, meaning depends on the transmitter
+	int uplink_tx_power_mw;		///< transmitter power in mW
+	int downlink_rssi;		///< RSSI at the transmitter in dBm
+	int downlink_link_quality;	///< percentage of telemetry packets received
+	int downlink_snr;		///< telemetry signal to noise ratio in dB
+	uint64_t timestamp_ns;		///< timestamp given with the bytes that completed the frame
+} rc_input_link_stats_t;
+
+
+/**
+ * called with each decoded set of channels
+ */
+typedef void (*rc_input_channels_callback_t)(const rc_input_channels_t* ch, void* ctx);
+
+/**
+ * called with each CRSF link statistics frame
+ */
+typedef void (*rc_input_link_stats_callback_t)(const rc_input_link_stats_t* stats, void* ctx);
+
+
+/**
+ * running totals of one decoder
+ */
+typedef struct rc_input_decoder_stats_t{
+	uint64_t frames;	///< good frames of any type
+	uint64_t errors;	///< frames thrown away for a bad footer, CRC or a gap in the middle
+	uint64_t skipped;	///< bytes thrown away while looking for the start of a frame
+} rc_input_decoder_stats_t;
+
+
+/**
+ * State of one decoder. Set it up with rc_input_decoder_init(), then fill in
+ * the callbacks. Only stats may be read by the user.
+ */
+typedef struct rc_input_decoder_t{
+	rc_input_channels_callback_t channels_callback;	///< optional, called with each set of channels
+	rc_input_link_stats_callback_t link_stats_callback;	///< optional, called with CRSF link statistics
+	void* ctx;				///< passed to the callbacks
+	rc_input_decoder_stats_t stats;		///< running totals
+
+	// used by the decoder, don't touch
+	rc_input_protocol_t protocol;
+	uint8_t buf[RC_INPUT_MAX_FRAME];
+	size_t len;
+	uint64_t last_ns;
+} rc_input_decoder_t;
+
+
+/**
+ * @brief      Sets up a decoder for SBUS or CRSF and clears its callbacks and
+ * totals.
+ *
+ * @param      dec       the decoder
+ * @param[in]  protocol  RC_INPUT_SBUS or RC_INPUT_CRSF
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_input_decoder_init(rc_input_decoder_t* dec, rc_input_protocol_t protocol);
+
+
+/**
+ * @brief      Feeds received bytes to a decoder, calling back with every frame
+ * they complete.
+ *
+ * Pass the time the bytes were received, for example from
+ * rc_uart_read_bytes_stamped(). SBUS uses it to notice a frame cut short by
+ * lost bytes: if more than 2ms passed since the previous bytes while part way
+ * through a frame, that frame is dropped and this data starts a new one. Pass
+ * 0 when feeding a recording without timestamps to rely on the header and
+ * footer alone.
+ *
+ * @param      dec    the decoder
+ * @param[in]  data   received bytes
+ * @param[in]  len    number of bytes
+ * @param[in]  rx_ns  when the bytes were received, or 0
+ *
+ * @return     number of frames completed, -1 on error
+ */
+int rc_input_decoder_feed(rc_input_decoder_t* dec, const uint8_t* data, size_t len, uint64_t rx_ns);
+
+
+/**
+ * @brief      Number of bytes that would complete the frame being received.
+ *
+ * Reading exactly this many bytes, for example with a UART in low latency mode,
+ * wakes the reader once per frame right as it completes. While looking for the
+ * start of a frame this is small so the gap before it can be timed.
+ *
+ * @param[in]  dec   the decoder
+ *
+ * @return     bytes to read next, at least 1
+ */
+size_t rc_input_decoder_wanted(const rc_input_decoder_t* dec);
+
+
+/**
+ * @brief      Builds an SBUS frame, for simulating a receiver or making test
+ * data.
+ *
+ * @param[out] frame     25 byte buffer
+ * @param[in]  raw       pulse widths in microseconds
+ * @param[in]  channels  number of values in raw, at most 16, the rest are sent
+ * centered
+ * @param[in]  failsafe  1 to set the failsafe flag
+ *
+ * @return     frame length in bytes, -1 on error
+ */
+int rc_input_sbus_encode(uint8_t* frame, const int* raw, int channels, int failsafe);
+
+
+/**
+ * @brief      Builds a CRSF RC channels frame addressed to the flight
+ * controller.
+ *
+ * @param[out] frame     26 byte buffer
+ * @param[in]  raw       pulse widths in microseconds
+ * @param[in]  channels  number of values in raw, at most 16, the rest are sent
+ * centered
+ *
+ * @return     frame length in bytes, -1 on error
+ */
+int rc_input_crsf_encode_channels(uint8_t* frame, const int* raw, int channels);
+
+
+/**
+ * @brief      Builds a CRSF link statistics frame addressed to the flight
+ * controller.
+ *
+ * @param[out] frame  14 byte buffer
+ * @param[in]  stats  statistics to send, the timestamp is ignored
+ *
+ * @return     frame length in bytes, -1 on error
+ */
+int rc_input_crsf_encode_link_stats(uint8_t* frame, const rc_input_link_stats_t* stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RC_INPUT_H
+
+/** @} end group RC_Input */
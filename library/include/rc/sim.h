@@ -0,0 +1,565 @@
+/**
+ * <rc/sim.h>
+ *
+ * @brief      In-process simulated hardware backend for running the library
+ *             without a BeagleBone.
+ *
+ * Once enabled, the I2C, SPI, GPIO, UART and PWM drivers stop talking to
+ * /dev/i2c-*, /dev/spidev*, /dev/gpiochip*, /dev/ttyO* and /sys/class/pwm and
+ * route every transfer to simulated devices in this process instead. Each
+ * driver picks its hardware or simulated backend once in its init function,
+ * so the transfers themselves never check which one is in use. All the
+ * code above the io layer (rc_mpu, rc_bmp, rc_dsm, rc_motor...) runs
+ * unmodified, so its hot paths can be profiled, timed and regression tested on
+ * any Linux machine.
+ *
+ * rc_sim_enable() wires up the devices of a BeagleBone Blue:
+ *
+ * - MPU-9250 register model with DMP memory, FIFO and an AK8963 behind the
+ *   bypass mux on i2c bus 2, interrupt on gpio3.21
+ * - BMP280 on i2c bus 2
+ * - DSM satellite byte stream on uart 4, see rc_sim_dsm_set_channels()
+ * - gpio lines that remember their value and generate edge events
+ * - pwm sinks that record the duty cycle of each channel
+ * - counters behind rc_encoder_eqep and rc_encoder_pru, and a record of the
+ *   last pulse rc_servo sent on each channel
+ *
+ * rc_model() reports MODEL_BB_BLUE and rc_pinmux_set() does nothing while the
+ * simulation is enabled. Setting the environment variable RC_SIM to anything
+ * other than 0 enables it the first time any driver checks, which allows
+ * existing programs to run simulated without being recompiled.
+ *
+ * More devices can be added with rc_sim_i2c_attach() and rc_sim_spi_attach().
+ * The simulated MPU reads its motion through the bias and noise set with
+ * rc_sim_mpu_set_noise(), and the simulated DMP fuses those readings with a
+ * 6-axis filter, so its orientation is an estimate with the errors that brings
+ * rather than a copy of the truth.
+ *
+ * To close the loop, start one of the plants with rc_sim_balance_start() or
+ * rc_sim_vertical_start(). It is stepped by the simulated IMU's sample clock
+ * so it only moves while rc_mpu is taking interrupts, in DMP mode for the
+ * orientation to come out in the body frame. rc_sim_set_time_scale() runs
+ * that clock faster than real time or in lockstep with the program.
+ *
+ * See the rc_test_sim_* examples, one per driver, and rc_benchmark_plant.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ *
+ * @addtogroup Sim
+ * @ingroup    IO
+ * @{
+ */
+
+#ifndef RC_SIM_H
+#define RC_SIM_H
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief      Receives bytes the library wrote to a simulated I2C device.
+ *
+ * The first byte is normally the register address, exactly as it would
+ * appear on the wire after the address byte.
+ *
+ * @param      ctx   pointer given to rc_sim_i2c_attach()
+ * @param[in]  data  bytes written
+ * @param[in]  len   number of bytes
+ *
+ * @return     0 to ACK, -1 to NACK
+ */
+typedef int (*rc_sim_i2c_write_func_t)(void* ctx, const uint8_t* data, size_t len);
+
+/**
+ * @brief      Supplies bytes the library reads from a simulated I2C device.
+ *
+ * @param      ctx   pointer given to rc_sim_i2c_attach()
+ * @param[out] data  buffer to fill
+ * @param[in]  len   number of bytes requested
+ *
+ * @return     0 to ACK, -1 to NACK
+ */
+typedef int (*rc_sim_i2c_read_func_t)(void* ctx, uint8_t* data, size_t len);
+
+/**
+ * @brief      Performs one full duplex transfer on a simulated SPI slave.
+ *
+ * Called once per select of the slave. The transfers of an
+ * rc_spi_transfer_multi() message that the slave stays selected for arrive
+ * joined into one call.
+ *
+ * @param      ctx   pointer given to rc_sim_spi_attach()
+ * @param[in]  tx    bytes clocked out, NULL for rc_spi_read()
+ * @param[out] rx    bytes clocked in, NULL for rc_spi_write()
+ * @param[in]  len   number of bytes
+ *
+ * @return     0 on success, -1 on failure
+ */
+typedef int (*rc_sim_spi_transfer_func_t)(void* ctx, const uint8_t* tx, uint8_t* rx, size_t len);
+
+/**
+ * @brief      Switches all io drivers to the simulated backend and attaches
+ *             the default BeagleBone Blue devices.
+ *
+ * Must be called before any driver is initialized. Drivers are only switched
+ * over once every default device attached, so on failure the hardware backend
+ * stays in use and calling this again picks up where it left off. Calling it
+ * again after it succeeded does nothing.
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_sim_enable(void);
+
+/**
+ * @brief      Checks whether the simulated backend is in use.
+ *
+ * This is what each io driver checks in its init function. If the RC_SIM
+ * environment variable asks for the simulation but rc_sim_enable() fails, the
+ * error is printed once and the drivers refuse to initialize rather than
+ * falling back to the real hardware.
+ *
+ * @return     1 if enabled, 0 if not, -1 if RC_SIM is set but the simulation
+ * could not be enabled
+ */
+int rc_sim_is_enabled(void);
+
+/**
+ * @brief      Places a simulated device on an I2C bus.
+ *
+ * @param[in]  bus    i2c bus
+ * @param[in]  addr   7 bit device address
+ * @param[in]  write  called for every write message to addr
+ * @param[in]  read   called for every read message from addr
+ * @param      ctx    passed back to write and read
+ *
+ * @return     0 on success, -1 if the address is taken or the bus is full
+ */
+int rc_sim_i2c_attach(int bus, uint8_t addr, rc_sim_i2c_write_func_t write, rc_sim_i2c_read_func_t read, void* ctx);
+
+/**
+ * @brief      Removes a simulated device from an I2C bus. It NACKs from then
+ *             on.
+ *
+ * @param[in]  bus   i2c bus
+ * @param[in]  addr  7 bit device address
+ *
+ * @return     0 on success, -1 if nothing was attached there
+ */
+int rc_sim_i2c_detach(int bus, uint8_t addr);
+
+/**
+ * @brief      Places a simulated device on an SPI slave select.
+ *
+ * @param[in]  bus       spi bus
+ * @param[in]  slave     slave select
+ * @param[in]  transfer  called for every transfer on that slave
+ * @param      ctx       passed back to transfer
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_sim_spi_attach(int bus, int slave, rc_sim_spi_transfer_func_t transfer, void* ctx);
+
+/**
+ * @brief      Removes a simulated device from an SPI slave select.
+ *
+ * @param[in]  bus    spi bus
+ * @param[in]  slave  slave select
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_sim_spi_detach(int bus, int slave);
+
+/**
+ * @brief      Drives a simulated gpio line from the outside, like a button or
+ *             a sensor's interrupt pin would.
+ *
+ * If the library requested edge events on the line with
+ * rc_gpio_init_event() and the change matches the requested edge, an event is
+ * queued for rc_gpio_poll() time stamped with rc_nanos_since_boot().
+ *
+ * @param[in]  chip   gpio chip
+ * @param[in]  pin    line
+ * @param[in]  value  0 or 1
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_sim_gpio_set(int chip, int pin, int value);
+
+/**
+ * @brief      Reads the current level of a simulated gpio line, for example
+ *             one the library drives as an output.
+ *
+ * @param[in]  chip  gpio chip
+ * @param[in]  pin   line
+ *
+ * @return     0 or 1, -1 on failure
+ */
+int rc_sim_gpio_get(int chip, int pin);
+
+/**
+ * @brief      Reads the duty cycle last written to a simulated pwm channel.
+ *
+ * @param[in]  ss    subsystem 0,1,2
+ * @param[in]  ch    channel 'A' or 'B'
+ *
+ * @return     duty cycle between 0.0 and 1.0, -1.0 on failure
+ */
+double rc_sim_pwm_get_duty(int ss, char ch);
+
+/**
+ * @brief      Reads the duty cycle last written to a simulated pwm channel in
+ *             nanoseconds.
+ *
+ * @param[in]  ss    subsystem 0,1,2
+ * @param[in]  ch    channel 'A' or 'B'
+ *
+ * @return     duty in nanoseconds, -1 on failure
+ */
+int rc_sim_pwm_get_duty_ns(int ss, char ch);
+
+/**
+ * @brief      Sends bytes to the library as if they arrived on a uart's RX
+ *             line.
+ *
+ * Each simulated uart is a pseudo terminal so termios, select and the read
+ * timeouts in rc_uart behave as they do on hardware. Bytes sent before the
+ * library calls rc_uart_init() on the bus are flushed by it.
+ *
+ * @param[in]  bus    uart bus
+ * @param[in]  data   bytes to send
+ * @param[in]  bytes  number of bytes
+ *
+ * @return     number of bytes sent, -1 on failure
+ */
+int rc_sim_uart_send(int bus, const uint8_t* data, size_t bytes);
+
+/**
+ * @brief      Reads back bytes the library wrote to a uart's TX line without
+ *             blocking.
+ *
+ * @param[in]  bus    uart bus
+ * @param[out] data   buffer to fill
+ * @param[in]  bytes  size of buffer
+ *
+ * @return     number of bytes read which may be 0, -1 on failure
+ */
+int rc_sim_uart_receive(int bus, uint8_t* data, size_t bytes);
+
+/**
+ * @brief      Sets the motion the simulated MPU-9250 measures.
+ *
+ * All vectors are in the sensor frame, the same frame as the raw readings in
+ * rc_mpu_data_t. The readings have the bias and noise set with
+ * rc_sim_mpu_set_noise() added and values beyond the configured full scale
+ * range saturate like the real sensor.
+ *
+ * The simulated DMP never sees the orientation, it fuses the gyro and
+ * accelerometer readings like the chip does. Its tilt therefore follows the
+ * given motion as closely as the noise allows and its heading starts at zero
+ * when the DMP is enabled, then drifts with the gyro bias. The orientation is
+ * only used for the accelerometer when accel is NULL, it then reads gravity as
+ * seen by a sensor held still in that orientation.
+ *
+ * @param[in]  quat   orientation quaternion w x y z, NULL to leave unchanged
+ * @param[in]  accel  specific force in m/s^2, NULL to leave unchanged or to
+ *                    take it from quat
+ * @param[in]  gyro   angular rate in degrees per second, NULL to leave
+ *                    unchanged
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_sim_mpu_set_motion(const double quat[4], const double accel[3], const double gyro[3]);
+
+/**
+ * @brief      Sets the magnetic field the simulated AK8963 measures.
+ *
+ * @param[in]  mag   field in uT, in the same frame as rc_mpu_data_t mag
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_sim_mpu_set_mag(const double mag[3]);
+
+/**
+ * Errors the simulated MPU-9250 adds to the true motion, in the sensor frame.
+ * The noise is white and gaussian, drawn fresh every sample.
+ */
+typedef struct rc_sim_mpu_noise_t{
+	double gyro_bias[3];	///< constant gyro offset in deg/s
+	double gyro_noise;	///< standard deviation of gyro noise in deg/s
+	double accel_bias[3];	///< constant accelerometer offset in m/s^2
+	double accel_noise;	///< standard deviation of accelerometer noise in m/s^2
+	uint64_t seed;		///< noise seed, the same seed gives the same readings
+} rc_sim_mpu_noise_t;
+
+/**
+ * @brief      Bias and noise of a calibrated MPU-9250 at the default DLPF
+ *             setting, which the simulation starts with.
+ *
+ * @return     default noise model
+ */
+rc_sim_mpu_noise_t rc_sim_mpu_default_noise(void);
+
+/**
+ * @brief      Sets the bias and noise of the simulated MPU-9250.
+ *
+ * Set everything to zero for readings that match rc_sim_mpu_set_motion()
+ * exactly. The DMP still filters them so its orientation only converges to
+ * the truth.
+ *
+ * @param[in]  noise  noise model
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_sim_mpu_set_noise(rc_sim_mpu_noise_t noise);
+
+/**
+ * @brief      Sets the pressure and temperature the simulated BMP280
+ *             measures.
+ *
+ * The raw readings are found by inverting the datasheet compensation
+ * formulas against the simulated chip's calibration, so rc_bmp_read()
+ * returns these values to within the sensor resolution.
+ *
+ * @param[in]  pressure_pa  pressure in pascals, 30000 to 110000
+ * @param[in]  temp_c       temperature in degrees C, -40 to 85
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_sim_bmp_set(double pressure_pa, double temp_c);
+
+/**
+ * @brief      Starts, updates or stops the simulated DSM satellite.
+ *
+ * Frames go out on uart 4 like a satellite receiver sends them. With 6 or
+ * more channels they use 2048 resolution every 11ms, split over two frames
+ * when there are more than 7 channels. With fewer channels they use 1024
+ * resolution every 22ms. rc_dsm detects which one it is from the channel ids
+ * so a real receiver would also need 6 channels to be read as 2048.
+ *
+ * @param[in]  pulse_us  pulse width of each channel in microseconds, 989 to
+ *                       2012
+ * @param[in]  channels  number of channels, 2 to 9, 0 stops sending
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_sim_dsm_set_channels(const int* pulse_us, int channels);
+
+/**
+ * @brief      Drops bytes from the end of the next simulated DSM frame, as a
+ * noisy line would.
+ *
+ * @param[in]  bytes  number of bytes to leave out, 1 to 15
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_sim_dsm_drop_bytes(int bytes);
+
+/**
+ * @brief      Sets the count of a simulated encoder.
+ *
+ * @param[in]  ch    channel 1-3 for the eQEP encoders, 4 for the PRU one
+ * @param[in]  pos   new count
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_sim_encoder_set(int ch, int pos);
+
+/**
+ * @brief      Reads the count of a simulated encoder.
+ *
+ * @param[in]  ch    channel 1-4
+ *
+ * @return     the count, or -1 on failure
+ */
+int rc_sim_encoder_get(int ch);
+
+/**
+ * @brief      Reads the last pulse width rc_servo sent on a channel.
+ *
+ * @param[in]  ch    servo channel 1-8
+ *
+ * @return     pulse width in microseconds, 0 if none sent yet, -1 on failure
+ */
+int rc_sim_servo_get_pulse_us(int ch);
+
+/**
+ * @brief      Sets how fast the simulated sample clocks run.
+ *
+ * The IMU sample clock, and with it any running plant, advances one sample
+ * period per sample no matter how long that takes on the wall clock. A scale
+ * of 1.0, the default, is real time, 10.0 is ten times faster. A scale of 0
+ * runs in lockstep: each sample is taken as soon as rc_mpu has finished with
+ * the previous one, including the user's callback, so runs are as fast as the
+ * program allows and repeatable. Other threads in the program, such as ones
+ * paced with rc_usleep(), still run in real time.
+ *
+ * @param[in]  scale  simulated seconds per real second, 0 for lockstep
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_sim_set_time_scale(double scale);
+
+/**
+ * Physical parameters and wiring of the simulated balance bot. SI units, all
+ * angles in radians. rc_sim_balance_default_config() describes the eduMiP
+ * wired the way rc_balance_defs.h expects.
+ */
+typedef struct rc_sim_balance_config_t{
+	double body_mass;	///< kg, everything but the wheels
+	double body_inertia;	///< kg*m^2 about the center of mass, pitch axis
+	double com_height;	///< m from the axle to the center of mass
+	double wheel_mass;	///< kg, each wheel
+	double wheel_inertia;	///< kg*m^2, each wheel about the axle
+	double wheel_radius;	///< m
+	double track_width;	///< m, same definition as TRACK_WIDTH_M in rc_balance
+	double yaw_inertia;	///< kg*m^2 of the body about the vertical
+	double stall_torque;	///< N*m at the wheel at nominal_v, after the gearbox
+	double free_speed;	///< rad/s of the wheel at nominal_v, after the gearbox
+	double battery_v;	///< battery voltage
+	double nominal_v;	///< voltage stall_torque and free_speed are given at
+	double counts_per_rev;	///< encoder counts per wheel revolution
+	double mount_angle;	///< IMU pitch reads theta minus this, like BOARD_MOUNT_ANGLE
+	double fall_angle;	///< tilt at which the body hits the ground
+	double theta0;		///< initial tilt, positive leans forward
+	int motor_l;		///< rc_motor channel of the left wheel
+	int motor_r;		///< rc_motor channel of the right wheel
+	int motor_polarity_l;	///< 1 if positive duty drives the left wheel forward, else -1
+	int motor_polarity_r;	///< 1 if positive duty drives the right wheel forward, else -1
+	int encoder_l;		///< encoder channel of the left wheel
+	int encoder_r;		///< encoder channel of the right wheel
+	int encoder_polarity_l;	///< 1 if the left count rises going forward, else -1
+	int encoder_polarity_r;	///< 1 if the right count rises going forward, else -1
+} rc_sim_balance_config_t;
+
+/**
+ * True state of the simulated balance bot, the same quantities rc_balance
+ * estimates.
+ */
+typedef struct rc_sim_balance_state_t{
+	double time_s;		///< simulated time since the plant started
+	double theta;		///< body tilt from vertical, positive leans forward
+	double theta_dot;
+	double phi;		///< mean wheel angle from the start
+	double phi_dot;
+	double x_m;		///< distance travelled, phi*wheel_radius
+	double gamma;		///< heading from the difference between the wheels
+	double gamma_dot;
+	int fallen;		///< 1 once the body has hit the ground
+} rc_sim_balance_state_t;
+
+/**
+ * Parameters of the simulated vertical vehicle. Thrust comes from the mean
+ * of the ESC pulses sent with rc_servo on a range of channels.
+ */
+typedef struct rc_sim_vertical_config_t{
+	double mass_kg;
+	double max_thrust_n;	///< total thrust at full throttle
+	double motor_tau_s;	///< time constant of the thrust response
+	double drag;		///< N per (m/s)^2
+	int first_channel;	///< first servo channel carrying an ESC
+	int channels;		///< number of ESC channels
+	int esc_min_us;		///< zero throttle pulse width
+	int esc_max_us;		///< full throttle pulse width
+	double ground_pressure_pa; ///< pressure at altitude 0
+	double temp_c;		///< air temperature the barometer reads
+	double baro_noise_pa;	///< standard deviation of barometer noise
+	double accel_noise_ms2;	///< standard deviation of vertical accelerometer noise
+	uint64_t seed;		///< noise seed, the same seed gives the same run
+} rc_sim_vertical_config_t;
+
+/**
+ * True state of the simulated vertical vehicle.
+ */
+typedef struct rc_sim_vertical_state_t{
+	double time_s;		///< simulated time since the plant started
+	double alt_m;		///< altitude above the ground
+	double vel_ms;		///< vertical velocity, up positive
+	double accel_ms2;	///< vertical acceleration, up positive
+	double thrust_n;	///< thrust the motors are producing
+	int landed;		///< 1 while resting on the ground
+} rc_sim_vertical_state_t;
+
+/**
+ * @brief      Configuration of the eduMiP as rc_balance drives it.
+ *
+ * @return     default configuration
+ */
+rc_sim_balance_config_t rc_sim_balance_default_config(void);
+
+/**
+ * @brief      Starts the balance bot plant in place of any running one.
+ *
+ * Each IMU sample the motor torques are worked out from the H-bridge pins and
+ * pwm duty rc_motor_set() left, including standby, brake and free spin, the
+ * bot is integrated forward and the IMU orientation, gyro and encoders are
+ * updated. The IMU reports the body frame directly, as the real DMP does once
+ * rc_mpu has set its orientation, with the pitch about X.
+ *
+ * @param[in]  conf  configuration
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_sim_balance_start(rc_sim_balance_config_t conf);
+
+/**
+ * @brief      Reads the true state of the balance bot.
+ *
+ * @param[out] state  filled in on success
+ *
+ * @return     0 on success, -1 on failure or if it isn't running
+ */
+int rc_sim_balance_get_state(rc_sim_balance_state_t* state);
+
+/**
+ * @brief      Configuration of a 1kg quadrotor hovering at half throttle on
+ *             servo channels 1-4, with no noise beyond what the simulated
+ *             MPU adds.
+ *
+ * @return     default configuration
+ */
+rc_sim_vertical_config_t rc_sim_vertical_default_config(void);
+
+/**
+ * @brief      Starts the vertical vehicle plant in place of any running one.
+ *
+ * The vehicle starts on the ground and stays level. Each IMU sample the
+ * vertical acceleration goes to the accelerometer Z axis and the altitude to
+ * the barometer, through the same formula rc_bmp uses to turn pressure into
+ * altitude.
+ *
+ * @param[in]  conf  configuration
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_sim_vertical_start(rc_sim_vertical_config_t conf);
+
+/**
+ * @brief      Reads the true state of the vertical vehicle.
+ *
+ * @param[out] state  filled in on success
+ *
+ * @return     0 on success, -1 on failure or if it isn't running
+ */
+int rc_sim_vertical_get_state(rc_sim_vertical_state_t* state);
+
+/**
+ * @brief      Stops whichever plant is running, the sensors keep their last
+ *             values.
+ *
+ * @return     0
+ */
+int rc_sim_plant_stop(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RC_SIM_H
+
+/** @} end group Sim*/
@@ -70,6 +70,22 @@ extern "C" {
 #define RC_BLUE_SS1_GPIO	0,29 ///< BeagleBone Blue SPI1 SS1 gpio 0_29 pin H18
 #define RC_BLUE_SS2_GPIO	0,7  ///< BeagleBone Blue SPI1 SS2 gpio 0_7 pin H18
 
+#define RC_SPI_MAX_XFERS	16		///< most transfers rc_spi_transfer_multi() takes at once
+
+
+/**
+ * One transfer in a message sent with rc_spi_transfer_multi(). Zero
+ * everything you don't need, a zeroed speed and delay take the defaults.
+ */
+typedef struct rc_spi_xfer_t{
+	const uint8_t* tx;	///< bytes to send, NULL to clock out zeros
+	uint8_t* rx;		///< where to put the bytes received, NULL to discard them
+	size_t len;		///< number of bytes, at least 1
+	int speed_hz;		///< clock for this transfer, 0 for the speed given at init
+	uint16_t delay_us;	///< pause after this transfer before the next one or deselecting
+	int cs_change;		///< 1 to deselect the slave between this transfer and the next
+} rc_spi_xfer_t;
+
 
 /**
  * @brief      Initializes an SPI bus
@@ -197,6 +213,39 @@ int rc_spi_write(int bus, int slave, uint8_t* data, size_t bytes);
 int rc_spi_read(int bus, int slave, uint8_t* data, size_t bytes);
 
 
+
+/**
+ * @brief      Sends several transfers to one slave with a single system call.
+ *
+ * The slave stays selected from the first transfer to the last unless a
+ * transfer sets cs_change, so a register address followed by a burst read
+ * into a separate buffer goes out as one message without copying. For
+ * example, to read 14 bytes starting at register 0x3B:
+ *
+ * ```C
+ * uint8_t reg = 0x3B | 0x80;
+ * uint8_t buf[14];
+ * rc_spi_xfer_t x[2] = {{&reg, NULL, 1, 0, 0, 0}, {NULL, buf, 14, 0, 0, 0}};
+ * rc_spi_transfer_multi(RC_BB_SPI1_SS1, x, 2);
+ * ```
+ *
+ * Manual slaves are selected and deselected here, there is no need to call
+ * rc_spi_manual_select(). Since the driver can't toggle a GPIO pin itself, a
+ * manual slave message with cs_change set is split into one system call per
+ * group of transfers between deselects. cs_change on the last transfer is
+ * ignored, the slave is always deselected at the end. The Linux driver limits
+ * a message to 4096 bytes in total by default.
+ *
+ * @param[in]  bus    SPI bus to use
+ * @param[in]  slave  slave id
+ * @param[in]  xfers  array of n transfers, sent in order
+ * @param[in]  n      number of transfers, 1 to RC_SPI_MAX_XFERS
+ *
+ * @return     total number of bytes transferred or -1 on failure
+ */
+int rc_spi_transfer_multi(int bus, int slave, const rc_spi_xfer_t* xfers, int n);
+
+
 #ifdef __cplusplus
 }
 #endif
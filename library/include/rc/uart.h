@@ -36,15 +36,17 @@ extern "C" {
  * your own reading/writing with standard linux methods.
  *
  * @param[in]  bus           The bus number /dev/ttyO{bus}
- * @param[in]  baudrate      must be one of the standard speeds in the UART
- * spec. 115200 and 57600 are most common.
+ * @param[in]  baudrate      115200 and 57600 are most common. Rates other
+ * than the standard ones, such as 100000 for SBUS or 420000 for CRSF, are set
+ * with the kernel's BOTHER option and come out as close as the UART clock
+ * divider allows.
  * @param[in]  timeout       timeout is in seconds and must be >=0.1
  * @param[in]  canonical_en  0 for non-canonical mode (raw data), non-zero for
  * canonical mode where only one line ending in '\n' is read at a time.
  * @param[in]  stop_bits     number of stop bits, 1 or 2, usually 1 for most
  * sensors
- * @param[in]  parity_en     0 to disable parity, nonzero to enable. usually
- * disabled for most sensors.
+ * @param[in]  parity_en     0 to disable parity, nonzero to enable even
+ * parity. usually disabled for most sensors.
  *
  * @return     0 on success, -1 on failure
  */
@@ -94,6 +96,32 @@ int rc_uart_flush(int bus);
  */
 int rc_uart_write(int bus, uint8_t* data, size_t bytes);
 
+/**
+ * @brief      Switches a bus to low latency reception, or back.
+ *
+ * Normally rc_uart_init() sets the tty to wait until 128 bytes arrive or the
+ * line has been quiet for the timeout before read() returns, and the serial
+ * driver itself batches received bytes before passing them on. Both add
+ * delay between a byte arriving and the program seeing it.
+ *
+ * In low latency mode the serial driver is told to pass bytes on immediately
+ * with the ASYNC_LOW_LATENCY flag where it supports it. The inter-byte timer is
+ * turned off and VMIN set to 1 once here, so the reader wakes as soon as bytes
+ * arrive and rc_uart_read_bytes() keeps waiting until it has all it asked for.
+ * The tty settings are not touched again per read, so mixing reads of
+ * different lengths, like the DSM 1 byte sync and 15 byte remainder, costs no
+ * extra tcsetattr calls. The overall timeout given to rc_uart_init() still
+ * applies.
+ *
+ * Call after rc_uart_init(), which always starts a bus in normal mode.
+ *
+ * @param[in]  bus   The bus number /dev/ttyO{bus}
+ * @param[in]  en    1 to enable, 0 to go back to normal mode
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_uart_set_low_latency(int bus, int en);
+
 /**
  * @brief      reads bytes from the UART bus
  *
@@ -111,6 +139,26 @@ int rc_uart_write(int bus, uint8_t* data, size_t bytes);
  */
 int rc_uart_read_bytes(int bus, uint8_t* buf, size_t bytes);
 
+/**
+ * @brief      Same as rc_uart_read_bytes() but also reports when the data
+ * arrived.
+ *
+ * The timestamp is rc_nanos_since_boot() taken as the wait for the last
+ * chunk of data returned, before it is read out of the driver. In low latency
+ * mode that is within scheduling latency of the last byte arriving. Subtract
+ * 10 bit times per byte, bytes*10/baudrate seconds with 1 stop bit and no
+ * parity, to estimate when the first byte started.
+ *
+ * @param[in]  bus    The bus number /dev/ttyO{bus}
+ * @param[out] buf    data pointer
+ * @param[in]  bytes  number of bytes to read
+ * @param[out] rx_ns  set to the receive timestamp, left alone if nothing was
+ * read
+ *
+ * @return     Returns number of bytes actually read or -1 on error.
+ */
+int rc_uart_read_bytes_stamped(int bus, uint8_t* buf, size_t bytes, uint64_t* rx_ns);
+
 /**
  * @brief      reads a line of characters ending in newline '\n'
  *
@@ -0,0 +1,247 @@
+/**
+ * <rc/uart_service.h>
+ *
+ * @brief      Event driven reception on any number of UART buses from one
+ *             thread.
+ *
+ * rc_uart_read_bytes() and rc_uart_read_line() block the calling thread, so
+ * every device talking on a UART such as a GPS, telemetry radio or DSM
+ * receiver needs its own thread. Instead, add each bus to the service and one
+ * epoll thread reads whatever arrives on any of them into a per bus ring
+ * buffer.
+ *
+ * Each bus has a framer which cuts the byte stream into frames: fixed length
+ * packets, packets ending with a delimiter byte, or packets carrying their own
+ * length in a header. Complete frames are handed to a callback as slices
+ * pointing straight into the ring, there is no copying. A frame that wraps
+ * around the end of the ring arrives as two slices, rc_uart_frame_copy() puts
+ * it back together when that's more convenient.
+ *
+ * Each frame carries the time the service thread was woken for the bytes that
+ * completed it. For the lowest delay between the last byte arriving and that
+ * wakeup, call rc_uart_set_low_latency() before adding the bus.
+ *
+ * With RC_UART_FRAMER_NONE nothing is framed and another thread takes raw
+ * bytes out with rc_uart_service_read(). The ring is single producer, single
+ * consumer so copying out of it never blocks the service thread.
+ *
+ * Callbacks run without any of the service's locks held, so they may call
+ * rc_uart_service_get_stats(), rc_uart_service_add() or
+ * rc_uart_service_remove(), including removing their own bus. Only
+ * rc_uart_service_stop() can't be called from a callback.
+ *
+ * While a bus is in the service it is switched to non-blocking, don't use
+ * rc_uart_read_bytes() or rc_uart_read_line() on it. rc_uart_write() works as
+ * usual.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ *
+ * @addtogroup UART_Service
+ * @ingroup    IO
+ * @{
+ */
+
+#ifndef RC_UART_SERVICE_H
+#define RC_UART_SERVICE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * how the byte stream of a bus is cut into frames
+ */
+typedef enum rc_uart_framer_type_t{
+	RC_UART_FRAMER_NONE,		///< no framing, read raw bytes with rc_uart_service_read()
+	RC_UART_FRAMER_FIXED,		///< every frame is max_len bytes
+	RC_UART_FRAMER_DELIMITER,	///< frames end with the delimiter byte, which isn't included
+	RC_UART_FRAMER_LENGTH		///< frames have a length field in their header
+} rc_uart_framer_type_t;
+
+
+/**
+ * A complete frame. The slices point into the bus's ring buffer and are only
+ * valid until the callback returns.
+ */
+typedef struct rc_uart_frame_t{
+	const uint8_t* data[2];	///< first and second piece, the second is empty unless the frame wraps
+	size_t len[2];		///< length of each piece
+	size_t total;		///< length of the frame, len[0]+len[1]
+	uint64_t timestamp_ns;	///< rc_nanos_since_boot() when the read that completed the frame was woken
+} rc_uart_frame_t;
+
+
+/**
+ * called from the service thread with each complete frame, with no locks
+ * held
+ */
+typedef void (*rc_uart_frame_callback_t)(int bus, const rc_uart_frame_t* frame, void* ctx);
+
+
+/**
+ * Optional check run on each candidate frame, for example a checksum. Return
+ * 0 to accept it. For fixed length and length prefixed framers a rejected
+ * frame is taken as lost sync so one byte is skipped and framing tried again
+ * from the next, for delimited frames it is dropped.
+ */
+typedef int (*rc_uart_frame_check_t)(const rc_uart_frame_t* frame, void* ctx);
+
+
+/**
+ * Configuration of one bus in the service, see
+ * rc_uart_service_default_config(). The fields from sync_en down only matter
+ * to the framers that mention them.
+ */
+typedef struct rc_uart_service_config_t{
+	rc_uart_framer_type_t framer;	///< how to cut frames, default RC_UART_FRAMER_NONE
+	size_t ring_len;		///< ring buffer size in bytes, rounded up to a power of 2, default 4096
+	size_t max_len;			///< FIXED: frame length. Others: longest frame, default 256
+	uint8_t delimiter;		///< DELIMITER: byte ending each frame, default '\n'
+	int sync_en;			///< FIXED and LENGTH: 1 if frames start with the sync byte, default 0
+	uint8_t sync;			///< FIXED and LENGTH: first byte of every frame
+	size_t len_offset;		///< LENGTH: offset of the length field from the start of the frame
+	int len_bytes;			///< LENGTH: size of the length field, 1 or 2 little endian, default 1
+	size_t len_extra;		///< LENGTH: bytes in the frame not counted by the length field
+	rc_uart_frame_callback_t callback;	///< called with each frame, required unless framer is NONE
+	rc_uart_frame_check_t check;	///< optional frame check, may be NULL
+	void* ctx;			///< passed to the callback and check
+} rc_uart_service_config_t;
+
+
+/**
+ * running totals for one bus
+ */
+typedef struct rc_uart_service_stats_t{
+	uint64_t bytes;		///< bytes received
+	uint64_t frames;	///< frames passed to the callback
+	uint64_t rejected;	///< candidate frames refused by the check or with an impossible length
+	uint64_t skipped;	///< bytes thrown away while looking for a frame
+	uint64_t overrun;	///< bytes lost because the ring was full
+} rc_uart_service_stats_t;
+
+
+/**
+ * @brief      Returns the default bus configuration.
+ *
+ * @return     default configuration
+ */
+rc_uart_service_config_t rc_uart_service_default_config(void);
+
+
+/**
+ * @brief      Starts the service thread.
+ *
+ * @param[in]  sched_policy  scheduler policy, SCHED_OTHER, SCHED_FIFO or SCHED_RR
+ * @param[in]  priority      scheduler priority
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_uart_service_start(int sched_policy, int priority);
+
+
+/**
+ * @brief      Removes every bus and stops the service thread.
+ *
+ * Can't be called from a frame callback, since it waits for the service
+ * thread to exit.
+ *
+ * @return     0 on success, -1 if it wasn't running or called from a callback
+ */
+int rc_uart_service_stop(void);
+
+
+/**
+ * @brief      Adds a bus to the service.
+ *
+ * The bus must already be set up with rc_uart_init(). Received bytes go to
+ * the framer from this point on.
+ *
+ * @param[in]  bus   uart bus
+ * @param[in]  conf  configuration
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_uart_service_add(int bus, rc_uart_service_config_t conf);
+
+
+/**
+ * @brief      Takes a bus out of the service and puts it back in blocking
+ * mode.
+ *
+ * Bytes still in the ring are discarded. If the service thread is working on
+ * the bus or another thread is in rc_uart_service_read() on it, this waits
+ * for them to finish before freeing the ring. Called from a callback of the
+ * bus being removed, no more frames are delivered after that callback returns
+ * and the ring is freed then.
+ *
+ * @param[in]  bus   uart bus
+ *
+ * @return     0 on success, -1 if the bus wasn't in the service
+ */
+int rc_uart_service_remove(int bus);
+
+
+/**
+ * @brief      Takes up to max bytes out of the ring of a bus added with
+ * RC_UART_FRAMER_NONE. Never waits for data, returns what is already there.
+ *
+ * Only one thread at a time may read a bus.
+ *
+ * @param[in]  bus   uart bus
+ * @param[out] buf   user's buffer
+ * @param[in]  max   size of buf
+ *
+ * @return     number of bytes copied, possibly 0, or -1 on failure
+ */
+int rc_uart_service_read(int bus, uint8_t* buf, size_t max);
+
+
+/**
+ * @brief      Copies out the running totals of a bus.
+ *
+ * The totals are updated each time the service thread finishes with a batch of
+ * bytes, so a callback sees them as they were before that batch.
+ *
+ * @param[in]  bus    uart bus
+ * @param[out] stats  user's struct to copy the totals into
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_uart_service_get_stats(int bus, rc_uart_service_stats_t* stats);
+
+
+/**
+ * @brief      Copies a frame into one contiguous buffer.
+ *
+ * @param[in]  frame  the frame
+ * @param[out] buf    user's buffer
+ * @param[in]  max    size of buf
+ *
+ * @return     bytes copied, less than frame->total if buf is too small
+ */
+size_t rc_uart_frame_copy(const rc_uart_frame_t* frame, uint8_t* buf, size_t max);
+
+
+/**
+ * @brief      Reads one byte of a frame without copying it out.
+ *
+ * @param[in]  frame  the frame
+ * @param[in]  i      index of the byte, less than frame->total
+ *
+ * @return     the byte
+ */
+uint8_t rc_uart_frame_byte(const rc_uart_frame_t* frame, size_t i);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RC_UART_SERVICE_H
+
+/** @} end group UART_Service */
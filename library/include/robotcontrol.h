@@ -21,6 +21,7 @@
 
 #include <rc/adc.h>
 #include <rc/bmp.h>
+#include <rc/bus_async.h>
 #include <rc/button.h>
 #include <rc/cpu.h>
 #include <rc/deprecated.h>
@@ -45,11 +46,14 @@
 #include <rc/pru.h>
 #include <rc/pthread.h>
 #include <rc/pwm.h>
+#include <rc/rc_input.h>
 #include <rc/servo.h>
+#include <rc/sim.h>
 #include <rc/spi.h>
 #include <rc/start_stop.h>
 #include <rc/time.h>
 #include <rc/uart.h>
+#include <rc/uart_service.h>
 #include <rc/version.h>
 
 #endif // ROBOTCONTROL_H
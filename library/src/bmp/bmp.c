@@ -6,14 +6,31 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <unistd.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
 #include <rc/i2c.h>
 #include <rc/bmp.h>
+#include <rc/mpu.h>
+#include <rc/pthread.h>
 #include <rc/time.h>
 #include "bmp_defs.h"
 
+#define unlikely(x)	__builtin_expect (!!(x), 0)
+
 #define BMP_BUS 2
+#define SAMPLER_MAX_RATE_HZ	200.0
+#define IMU_STALE_NS		100000000 // IMU counts as stopped after this long without a sample
+#define BURST_LEN		10	// status register through the last data register
+#define BURST_DATA		(BMP280_PRESSURE_MSB-BMP280_STATUS_REG)
+#define SKIP_FRACTION		0.9	// of the typical measurement period
+#define ALT_TABLE_LEN		512	// intervals in the altitude table
+#define ALT_TABLE_MIN		0.25	// pressure ratio at the ends of the table
+#define ALT_TABLE_MAX		1.15
 
 // local struct for calibration data
 typedef struct bmp280_cal_t{
@@ -32,9 +49,96 @@ typedef struct bmp280_cal_t{
 	double sea_level_pa;
 }bmp280_cal_t;
 
+// background sampler state
+typedef struct bmp_sampler_t{
+	int running;
+	pthread_t thread;
+	rc_bmp_sampler_config_t conf;
+	int sub_id;			///< rc_mpu subscriber id, -1 if not subscribed
+	pthread_mutex_t gap_mutex;
+	pthread_cond_t gap_cond;	///< signalled after every IMU sample
+	uint64_t gap_seq;		///< IMU samples seen, protected by gap_mutex
+	pthread_mutex_t buf_mutex;	///< protects buf, head, count and stats
+	rc_bmp_sample_t* buf;
+	int head;			///< index the next sample goes in
+	int count;
+	rc_bmp_sampler_stats_t stats;
+	uint32_t published_seq;		///< odd while latest is being written
+	rc_bmp_sample_t latest;
+} bmp_sampler_t;
+
 // global variables
 static bmp280_cal_t rc_bmp280_cal;
 static int rc_bmp280_init_flag = 0;
+static rc_bmp_compensation_t compensation = BMP_COMPENSATION_64;
+static int fast_altitude = 0;
+static double alt_table[ALT_TABLE_LEN+1];
+static int alt_table_ready = 0;
+
+// last raw reading, for telling whether the chip has a new measurement
+static pthread_mutex_t raw_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int have_raw = 0;
+static uint8_t last_raw[6];
+static uint64_t last_change_ns;
+static uint64_t meas_period_ns;
+static bmp_sampler_t sampler = {
+	.sub_id = -1,
+	.gap_mutex = PTHREAD_MUTEX_INITIALIZER,
+	.buf_mutex = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/**
+ * altitude at evenly spaced ratios of pressure to sea level pressure, the
+ * ratio is all the formula depends on so the table never needs rebuilding
+ */
+static void __build_alt_table(void)
+{
+	int i;
+	double x;
+	if(alt_table_ready) return;
+	for(i=0;i<=ALT_TABLE_LEN;i++){
+		x = ALT_TABLE_MIN + (ALT_TABLE_MAX-ALT_TABLE_MIN)*i/ALT_TABLE_LEN;
+		alt_table[i] = 44330.0*(1.0 - pow(x, 0.1903));
+	}
+	alt_table_ready = 1;
+	return;
+}
+
+
+/**
+ * linear interpolation in the altitude table, falls back to pow outside it
+ */
+static double __altitude_fast(double ratio)
+{
+	double f;
+	int i;
+	f = (ratio-ALT_TABLE_MIN)*(ALT_TABLE_LEN/(ALT_TABLE_MAX-ALT_TABLE_MIN));
+	if(unlikely(!(f>=0.0 && f<ALT_TABLE_LEN))) return 44330.0*(1.0 - pow(ratio, 0.1903));
+	i = (int)f;
+	f -= i;
+	return alt_table[i] + f*(alt_table[i+1]-alt_table[i]);
+}
+
+
+/**
+ * records a raw reading
+ *
+ * @return     1 if it differs from the last one, 0 if not
+ */
+static int __remember_raw(const uint8_t raw[6], uint64_t now)
+{
+	int changed;
+	pthread_mutex_lock(&raw_mutex);
+	changed = !have_raw || memcmp(raw, last_raw, 6);
+	if(changed){
+		memcpy(last_raw, raw, 6);
+		last_change_ns = now;
+		have_raw = 1;
+	}
+	pthread_mutex_unlock(&raw_mutex);
+	return changed;
+}
+
 
 int rc_bmp_init(rc_bmp_oversample_t oversample, rc_bmp_filter_t filter)
 {
@@ -42,23 +146,20 @@ int rc_bmp_init(rc_bmp_oversample_t oversample, rc_bmp_filter_t filter)
 	uint8_t c;
 	int i;
 
-	// make sure the bus is not currently in use by another thread
-	// do not proceed to prevent interfering with that process
-	if(rc_i2c_get_lock(BMP_BUS)){
-		fprintf(stderr,"WARNING in rc_bmp_init, i2c bus claimed by another thread\n");
-		fprintf(stderr,"Continuing anyway.\n");
-	}
-
 	// initialize the bus
 	if(rc_i2c_init(BMP_BUS, BMP280_ADDR)<0){
 		fprintf(stderr,"ERROR: in rc_bmp_init failed to initialize i2c bus\n");
 		return -1;
 	}
 
-	// claiming the bus does no guarantee other code will not interfere
-	// with this process, but best to claim it so other code can check
-	// like we did above
-	rc_i2c_lock_bus(BMP_BUS);
+	// claim the bus at low priority so the IMU can go first, and set the
+	// address again since another thread may have changed it since init
+	rc_i2c_lock_bus_priority(BMP_BUS, RC_I2C_PRIORITY_LOW);
+	if(rc_i2c_set_device_address(BMP_BUS, BMP280_ADDR)<0){
+		fprintf(stderr,"ERROR: in rc_bmp_init failed to set the i2c device address\n");
+		rc_i2c_unlock_bus(BMP_BUS);
+		return -1;
+	}
 
 	// reset the barometer
 	if(rc_i2c_write_byte(BMP_BUS, BMP280_RESET_REG, BMP280_RESET_WORD)<0){
@@ -103,12 +204,15 @@ int rc_bmp_init(rc_bmp_oversample_t oversample, rc_bmp_filter_t filter)
 	}
 
 	// keep checking the status register untill the NVM calibration is ready
-	// after a short wait
+	// after a short wait, letting go of the bus while sleeping
+	rc_i2c_unlock_bus(BMP_BUS);
 	i = 0;
 	c = BMP280_IM_UPDATE_STATUS;
 	do{
 		rc_usleep(20000);
-		if(rc_i2c_read_byte(BMP_BUS, BMP280_STATUS_REG	, &c)<0){
+		rc_i2c_lock_bus_priority(BMP_BUS, RC_I2C_PRIORITY_LOW);
+		if(rc_i2c_set_device_address(BMP_BUS, BMP280_ADDR)<0 ||
+			rc_i2c_read_byte(BMP_BUS, BMP280_STATUS_REG	, &c)<0){
 			fprintf(stderr,"ERROR: in rc_bmp_init can't read status byte from barometer\n");
 			rc_i2c_unlock_bus(BMP_BUS);
 			return -1;
@@ -119,6 +223,7 @@ int rc_bmp_init(rc_bmp_oversample_t oversample, rc_bmp_filter_t filter)
 			return -1;
 		}
 		i++;
+		if(c&BMP280_IM_UPDATE_STATUS) rc_i2c_unlock_bus(BMP_BUS);
 	}while(c&BMP280_IM_UPDATE_STATUS);
 
 	// retrieve the factory NVM calibration data all in one go
@@ -145,6 +250,14 @@ int rc_bmp_init(rc_bmp_oversample_t oversample, rc_bmp_filter_t filter)
 	// use default pressure for now unless user sets it otherwise
 	rc_bmp280_cal.sea_level_pa = DEFAULT_SEA_LEVEL_PA;
 
+	// typical measurement time from section 9 of the datasheet with 1x
+	// temperature oversampling, plus the 0.5ms standby
+	meas_period_ns = (uint64_t)((1.0 + 2.0 + 2.0*(1<<((oversample>>2)-1)) + 0.5 + 0.5)*1000000.0);
+	pthread_mutex_lock(&raw_mutex);
+	have_raw = 0;
+	pthread_mutex_unlock(&raw_mutex);
+	__build_alt_table();
+
 	// release control of the bus
 	rc_i2c_unlock_bus(BMP_BUS);
 
@@ -158,13 +271,10 @@ int rc_bmp_init(rc_bmp_oversample_t oversample, rc_bmp_filter_t filter)
 
 int rc_bmp_power_off(void)
 {
-	// make sure the bus is not currently in use by another thread
-	// do not proceed to prevent interfering with that process
-	if(rc_i2c_get_lock(BMP_BUS)){
-		fprintf(stderr,"WARNING: in rc_bmp_power_off i2c bus claimed by another thread\n");
-		fprintf(stderr,"Continuing anyway.\n");
-	}
-	// set the i2c address
+	if(sampler.running) rc_bmp_sampler_stop();
+
+	// claim the bus at low priority and set the i2c address
+	rc_i2c_lock_bus_priority(BMP_BUS, RC_I2C_PRIORITY_LOW);
 	if(rc_i2c_set_device_address(BMP_BUS, BMP280_ADDR)<0){
 		fprintf(stderr,"ERROR: in rc_bmp_power_off failed to set the i2c device address\n");
 		rc_i2c_unlock_bus(BMP_BUS);
@@ -184,44 +294,90 @@ int rc_bmp_power_off(void)
 }
 
 
-int rc_bmp_read(rc_bmp_data_t* data)
+/**
+ * reads count bytes starting at reg at low priority so IMU reads go first,
+ * addressed directly so there is no need to switch the bus device address
+ * back and forth with the IMU
+ */
+static int __read_regs(uint8_t reg, int count, uint8_t* buf)
 {
-	int64_t var1, var2, var3, var4, t_fine, T, p;
-	uint8_t raw[6];
-	int32_t adc_P, adc_T;
+	rc_i2c_read_t read;
+	int ret;
+
+	rc_i2c_lock_bus_priority(BMP_BUS, RC_I2C_PRIORITY_LOW);
+	read.devAddr = BMP280_ADDR;
+	read.regAddr = reg;
+	read.count = count;
+	read.data = buf;
+	ret = rc_i2c_read_multi(BMP_BUS, &read, 1);
+	rc_i2c_unlock_bus(BMP_BUS);
+	return ret<0 ? -1 : 0;
+}
 
-	// sanity checks
-	if(rc_bmp280_init_flag==0){
-		fprintf(stderr,"ERROR in rc_bmp_read, call rc_bmp_init first\n");
-		return -1;
-	}
-	if(data==NULL){
-		fprintf(stderr, "ERROR in rc_bmp_read, received NULL pointer\n");
-		return -1;
-	}
-	// check claim bus state to avoid stepping on IMU reads
-	if(rc_i2c_get_lock(BMP_BUS)){
-		fprintf(stderr,"WARNING: in rc_bmp_read, i2c bus is claimed by another thread, aborting\n");
-		return -1;
-	}
 
-	// claim bus for ourselves and set the device address
-	rc_i2c_lock_bus(BMP_BUS);
-	if(rc_i2c_set_device_address(BMP_BUS, BMP280_ADDR)<0){
-		fprintf(stderr,"ERROR: in rc_bmp_read, failed to set the i2c device address\n");
-		rc_i2c_unlock_bus(BMP_BUS);
-		return -1;
-	}
+/**
+ * datasheet 32 bit integer pressure compensation, returns pressure in Pa
+ */
+static uint32_t __pressure_32(int32_t adc_P, int32_t t_fine)
+{
+	int32_t var1, var2;
+	uint32_t p;
+
+	var1 = (t_fine>>1) - (int32_t)64000;
+	var2 = (((var1>>2) * (var1>>2)) >> 11) * ((int32_t)rc_bmp280_cal.dig_P6);
+	var2 = var2 + ((var1*((int32_t)rc_bmp280_cal.dig_P5))<<1);
+	var2 = (var2>>2) + (((int32_t)rc_bmp280_cal.dig_P4)<<16);
+	var1 = (((rc_bmp280_cal.dig_P3 * (((var1>>2) * (var1>>2)) >> 13)) >> 3) +
+		((((int32_t)rc_bmp280_cal.dig_P2) * var1)>>1))>>18;
+	var1 = ((((32768+var1))*((int32_t)rc_bmp280_cal.dig_P1))>>15);
+	if(var1==0) return 0;
+	p = (((uint32_t)(((int32_t)1048576)-adc_P)-(var2>>12)))*3125;
+	if(p<0x80000000) p = (p<<1) / ((uint32_t)var1);
+	else p = (p / (uint32_t)var1) * 2;
+	var1 = (((int32_t)rc_bmp280_cal.dig_P9) * ((int32_t)(((p>>3) * (p>>3))>>13)))>>12;
+	var2 = (((int32_t)(p>>2)) * ((int32_t)rc_bmp280_cal.dig_P8))>>13;
+	return (uint32_t)((int32_t)p + ((var1 + var2 + rc_bmp280_cal.dig_P7) >> 4));
+}
 
-	// if new data is ready, read it in
-	if(rc_i2c_read_bytes(BMP_BUS,BMP280_PRESSURE_MSB,6,raw)<0){
-		fprintf(stderr,"ERROR: in rc_bmp_read, failed to read barometer data registers\n");
-		rc_i2c_unlock_bus(BMP_BUS);
-		return -1;
-	}
-	rc_i2c_unlock_bus(BMP_BUS);
 
-	// run the numbers, thanks to Bosch for putting this code in their datasheet
+/**
+ * datasheet 64 bit integer pressure compensation, returns pressure in Pa in
+ * Q24.8
+ */
+static int64_t __pressure_64(int32_t adc_P, int32_t t_fine)
+{
+	int64_t var3, var4, p;
+
+	var3 = ((int64_t)t_fine) - 128000;
+	var4 = var3 * var3 * (int64_t)rc_bmp280_cal.dig_P6;
+	var4 = var4 + ((var3*(int64_t)rc_bmp280_cal.dig_P5)<<17);
+	var4 = var4 + (((int64_t)rc_bmp280_cal.dig_P4)<<35);
+	var3 = ((var3 * var3 * (int64_t)rc_bmp280_cal.dig_P3)>>8) +
+		   ((var3 * (int64_t)rc_bmp280_cal.dig_P2)<<12);
+	var3 = (((((int64_t)1)<<47)+var3))*((int64_t)rc_bmp280_cal.dig_P1)>>33;
+
+	// avoid exception caused by division by zero
+	if(var3==0) return 0;
+
+	p = 1048576 - adc_P;
+	p = (((p<<31) - var4)*3125) / var3;
+	var3 = (((int64_t)rc_bmp280_cal.dig_P9) * (p >> 13) * (p >> 13)) >> 25;
+	var4 = (((int64_t)rc_bmp280_cal.dig_P8) * p) >> 19;
+
+	return ((p + var3 + var4) >> 8) + (((int64_t)rc_bmp280_cal.dig_P7) << 4);
+}
+
+
+/**
+ * fills in data from the 6 raw data registers, thanks to Bosch for putting
+ * this code in their datasheet
+ */
+static int __compensate(const uint8_t raw[6], rc_bmp_data_t* data)
+{
+	int32_t var1, var2, t_fine, T, adc_P, adc_T;
+	int64_t p64;
+	uint32_t p32;
+
 	adc_P = (raw[0] << 12)|
 			(raw[1] << 4)|(raw[2] >> 4);
 	adc_T = (raw[3] << 12)|
@@ -238,30 +394,104 @@ int rc_bmp_read(rc_bmp_data_t* data)
 	T  = (t_fine * 5 + 128) >> 8;
 	data->temp_c =  T/100.0;
 
-	var3 = ((int64_t)t_fine) - 128000;
-	var4 = var3 * var3 * (int64_t)rc_bmp280_cal.dig_P6;
-	var4 = var4 + ((var3*(int64_t)rc_bmp280_cal.dig_P5)<<17);
-	var4 = var4 + (((int64_t)rc_bmp280_cal.dig_P4)<<35);
-	var3 = ((var3 * var3 * (int64_t)rc_bmp280_cal.dig_P3)>>8) +
-		   ((var3 * (int64_t)rc_bmp280_cal.dig_P2)<<12);
-	var3 = (((((int64_t)1)<<47)+var3))*((int64_t)rc_bmp280_cal.dig_P1)>>33;
+	if(compensation==BMP_COMPENSATION_32){
+		p32 = __pressure_32(adc_P, t_fine);
+		if(p32==0){
+			fprintf(stderr,"ERROR in rc_bmp_read, invalid data read\n");
+			return -1;
+		}
+		data->pressure_pa = p32;
+	}
+	else{
+		p64 = __pressure_64(adc_P, t_fine);
+		if(p64==0){
+			fprintf(stderr,"ERROR in rc_bmp_read, invalid data read\n");
+			return -1;
+		}
+		data->pressure_pa = p64/256.0;
+	}
 
-	// avoid exception caused by division by zero
-	if(var3==0){
-		fprintf(stderr,"ERROR in rc_bmp_read, invalid data read\n");
+	if(fast_altitude) data->alt_m = __altitude_fast(data->pressure_pa/rc_bmp280_cal.sea_level_pa);
+	else data->alt_m = 44330.0*(1.0 - pow((data->pressure_pa/rc_bmp280_cal.sea_level_pa), 0.1903));
+	return 0;
+}
+
+
+int rc_bmp_read(rc_bmp_data_t* data)
+{
+	uint8_t raw[6];
+
+	// sanity checks
+	if(rc_bmp280_init_flag==0){
+		fprintf(stderr,"ERROR in rc_bmp_read, call rc_bmp_init first\n");
+		return -1;
+	}
+	if(data==NULL){
+		fprintf(stderr, "ERROR in rc_bmp_read, received NULL pointer\n");
+		return -1;
+	}
+	if(__read_regs(BMP280_PRESSURE_MSB, 6, raw)){
+		fprintf(stderr,"ERROR: in rc_bmp_read, failed to read barometer data registers\n");
 		return -1;
 	}
+	__remember_raw(raw, rc_nanos_since_boot());
+	return __compensate(raw, data);
+}
 
-	p = 1048576 - adc_P;
-	p = (((p<<31) - var4)*3125) / var3;
-	var3 = (((int64_t)rc_bmp280_cal.dig_P9) * (p >> 13) * (p >> 13)) >> 25;
-	var4 = (((int64_t)rc_bmp280_cal.dig_P8) * p) >> 19;
 
-	p = ((p + var3 + var4) >> 8) + (((int64_t)rc_bmp280_cal.dig_P7) << 4);
-	data->pressure_pa = p/256.0;
+int rc_bmp_read_new(rc_bmp_data_t* data)
+{
+	uint8_t buf[BURST_LEN];
+	uint64_t now;
+
+	// sanity checks
+	if(rc_bmp280_init_flag==0){
+		fprintf(stderr,"ERROR in rc_bmp_read_new, call rc_bmp_init first\n");
+		return -1;
+	}
+	if(data==NULL){
+		fprintf(stderr, "ERROR in rc_bmp_read_new, received NULL pointer\n");
+		return -1;
+	}
 
-	data->alt_m = 44330.0*(1.0 - pow((data->pressure_pa/rc_bmp280_cal.sea_level_pa), 0.1903));
+	// the chip can't have finished another measurement yet, don't bother
+	// the bus
+	now = rc_nanos_since_boot();
+	pthread_mutex_lock(&raw_mutex);
+	if(have_raw && now-last_change_ns < meas_period_ns*SKIP_FRACTION){
+		pthread_mutex_unlock(&raw_mutex);
+		return 1;
+	}
+	pthread_mutex_unlock(&raw_mutex);
 
+	// status, control, config, a reserved byte and the 6 data registers in
+	// one transaction
+	if(__read_regs(BMP280_STATUS_REG, BURST_LEN, buf)){
+		fprintf(stderr,"ERROR: in rc_bmp_read_new, failed to read barometer registers\n");
+		return -1;
+	}
+	// data isn't valid while the calibration is being copied after a reset
+	if(buf[0]&BMP280_IM_UPDATE_STATUS) return 1;
+	if(!__remember_raw(&buf[BURST_DATA], now)) return 1;
+	return __compensate(&buf[BURST_DATA], data);
+}
+
+
+int rc_bmp_set_compensation(rc_bmp_compensation_t comp)
+{
+	if(comp!=BMP_COMPENSATION_32 && comp!=BMP_COMPENSATION_64){
+		fprintf(stderr,"ERROR in rc_bmp_set_compensation, invalid argument\n");
+		return -1;
+	}
+	compensation = comp;
+	return 0;
+}
+
+
+int rc_bmp_set_fast_altitude(int en)
+{
+	__build_alt_table();
+	fast_altitude = en ? 1 : 0;
 	return 0;
 }
 
@@ -283,3 +513,292 @@ int rc_bmp_set_sea_level_pressure_pa(double pa)
 }
 
 
+
+
+rc_bmp_sampler_config_t rc_bmp_sampler_default_config(void)
+{
+	rc_bmp_sampler_config_t conf;
+	conf.rate_hz = 25.0;
+	conf.buffer_len = 64;
+	conf.imu_sync = 1;
+	conf.max_wait_us = 10000;
+	conf.sched_policy = SCHED_OTHER;
+	conf.priority = 0;
+	return conf;
+}
+
+
+/**
+ * rc_mpu subscriber, runs inline on the IMU interrupt thread right after the
+ * sample has been read and the bus released
+ */
+static void __imu_sample_done(__attribute__ ((unused)) const rc_mpu_data_t* data,
+				__attribute__ ((unused)) void* ctx)
+{
+	pthread_mutex_lock(&sampler.gap_mutex);
+	sampler.gap_seq++;
+	pthread_cond_signal(&sampler.gap_cond);
+	pthread_mutex_unlock(&sampler.gap_mutex);
+	return;
+}
+
+
+/**
+ * waits for the IMU to finish its next sample
+ *
+ * @return     1 if it did, 0 on timeout or when stopping
+ */
+static int __wait_for_gap(void)
+{
+	struct timespec deadline;
+	uint64_t seen, ns;
+	int ret;
+
+	ns = rc_nanos_since_boot() + (uint64_t)sampler.conf.max_wait_us*1000;
+	deadline.tv_sec = ns/1000000000;
+	deadline.tv_nsec = ns%1000000000;
+	pthread_mutex_lock(&sampler.gap_mutex);
+	seen = sampler.gap_seq;
+	while(sampler.gap_seq==seen && sampler.running){
+		if(pthread_cond_timedwait(&sampler.gap_cond, &sampler.gap_mutex, &deadline)) break;
+	}
+	ret = sampler.gap_seq!=seen;
+	pthread_mutex_unlock(&sampler.gap_mutex);
+	return ret;
+}
+
+
+static void __push_sample(const rc_bmp_data_t* data, uint64_t timestamp_ns)
+{
+	rc_bmp_sample_t* s;
+
+	pthread_mutex_lock(&sampler.buf_mutex);
+	s = &sampler.buf[sampler.head];
+	s->data = *data;
+	s->timestamp_ns = timestamp_ns;
+	s->seq = sampler.stats.reads+1;
+	sampler.head = (sampler.head+1)%sampler.conf.buffer_len;
+	if(sampler.count<sampler.conf.buffer_len) sampler.count++;
+	sampler.stats.reads++;
+
+	// publish a consistent copy for readers which mustn't block
+	__atomic_store_n(&sampler.published_seq, sampler.published_seq+1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	sampler.latest = *s;
+	__atomic_store_n(&sampler.published_seq, sampler.published_seq+1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&sampler.buf_mutex);
+	return;
+}
+
+
+static void* __sampler_thread(__attribute__ ((unused)) void* ptr)
+{
+	struct timespec next;
+	uint64_t period_ns, next_ns, t_start, t_end, missed;
+	int64_t since;
+	int synced, ret;
+	rc_bmp_data_t data;
+
+	period_ns = (uint64_t)(1000000000.0/sampler.conf.rate_hz);
+	next_ns = rc_nanos_since_boot();
+	while(sampler.running){
+		// if the IMU is running, hold off until it has just finished a
+		// sample so the bus is quiet until its next interrupt
+		t_start = rc_nanos_since_boot();
+		synced = 0;
+		if(sampler.conf.imu_sync){
+			since = rc_mpu_nanos_since_last_dmp_interrupt();
+			if(since>=0 && since<IMU_STALE_NS) synced = __wait_for_gap();
+		}
+		if(!sampler.running) break;
+
+		ret = rc_bmp_read_new(&data);
+		t_end = rc_nanos_since_boot();
+		if(ret==0) __push_sample(&data, t_end);
+
+		pthread_mutex_lock(&sampler.buf_mutex);
+		if(ret==1) sampler.stats.unchanged++;
+		else if(ret<0) sampler.stats.errors++;
+		if(synced) sampler.stats.synced++;
+		else sampler.stats.unsynced++;
+		if(t_end-t_start>sampler.stats.max_read_ns) sampler.stats.max_read_ns = t_end-t_start;
+		pthread_mutex_unlock(&sampler.buf_mutex);
+
+		// next deadline, if we overran skip the periods we missed rather
+		// than bursting reads to catch up
+		next_ns += period_ns;
+		if(next_ns<=t_end){
+			missed = (t_end-next_ns)/period_ns + 1;
+			next_ns += missed*period_ns;
+			pthread_mutex_lock(&sampler.buf_mutex);
+			sampler.stats.late += missed;
+			pthread_mutex_unlock(&sampler.buf_mutex);
+		}
+		next.tv_sec = next_ns/1000000000;
+		next.tv_nsec = next_ns%1000000000;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+	}
+	return NULL;
+}
+
+
+int rc_bmp_sampler_start(rc_bmp_sampler_config_t conf)
+{
+	pthread_condattr_t attr;
+
+	// sanity checks
+	if(rc_bmp280_init_flag==0){
+		fprintf(stderr,"ERROR in rc_bmp_sampler_start, call rc_bmp_init first\n");
+		return -1;
+	}
+	if(sampler.running){
+		fprintf(stderr,"ERROR in rc_bmp_sampler_start, sampler already running\n");
+		return -1;
+	}
+	if(conf.rate_hz<=0.0 || conf.rate_hz>SAMPLER_MAX_RATE_HZ){
+		fprintf(stderr,"ERROR in rc_bmp_sampler_start, rate_hz must be between 0 and %.0f\n", SAMPLER_MAX_RATE_HZ);
+		return -1;
+	}
+	if(conf.buffer_len<1){
+		fprintf(stderr,"ERROR in rc_bmp_sampler_start, buffer_len must be >= 1\n");
+		return -1;
+	}
+	if(conf.max_wait_us<0){
+		fprintf(stderr,"ERROR in rc_bmp_sampler_start, max_wait_us must be >= 0\n");
+		return -1;
+	}
+
+	sampler.buf = malloc(conf.buffer_len*sizeof(rc_bmp_sample_t));
+	if(sampler.buf==NULL){
+		perror("ERROR in rc_bmp_sampler_start, failed to allocate memory for history");
+		return -1;
+	}
+	sampler.conf = conf;
+	sampler.head = 0;
+	sampler.count = 0;
+	memset(&sampler.stats, 0, sizeof(sampler.stats));
+	__atomic_store_n(&sampler.published_seq, 0, __ATOMIC_RELEASE);
+
+	// gap deadlines are on the same clock as rc_nanos_since_boot
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&sampler.gap_cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	sampler.sub_id = -1;
+	if(conf.imu_sync){
+		sampler.sub_id = rc_mpu_subscribe(__imu_sample_done, NULL, rc_mpu_subscriber_default_config());
+		if(sampler.sub_id<0){
+			fprintf(stderr,"ERROR in rc_bmp_sampler_start, failed to subscribe to rc_mpu\n");
+			pthread_cond_destroy(&sampler.gap_cond);
+			free(sampler.buf);
+			sampler.buf = NULL;
+			return -1;
+		}
+	}
+
+	sampler.running = 1;
+	if(rc_pthread_create(&sampler.thread, __sampler_thread, NULL, conf.sched_policy, conf.priority)<0){
+		fprintf(stderr,"ERROR in rc_bmp_sampler_start, failed to start thread\n");
+		sampler.running = 0;
+		if(sampler.sub_id>=0) rc_mpu_unsubscribe(sampler.sub_id);
+		sampler.sub_id = -1;
+		pthread_cond_destroy(&sampler.gap_cond);
+		free(sampler.buf);
+		sampler.buf = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+
+int rc_bmp_sampler_stop(void)
+{
+	if(!sampler.running){
+		fprintf(stderr,"ERROR in rc_bmp_sampler_stop, sampler not running\n");
+		return -1;
+	}
+	pthread_mutex_lock(&sampler.gap_mutex);
+	sampler.running = 0;
+	pthread_cond_signal(&sampler.gap_cond);
+	pthread_mutex_unlock(&sampler.gap_mutex);
+	if(rc_pthread_timed_join(sampler.thread, NULL, 1.0)==1){
+		fprintf(stderr,"WARNING in rc_bmp_sampler_stop, thread exit timeout\n");
+	}
+	if(sampler.sub_id>=0) rc_mpu_unsubscribe(sampler.sub_id);
+	sampler.sub_id = -1;
+	pthread_cond_destroy(&sampler.gap_cond);
+
+	pthread_mutex_lock(&sampler.buf_mutex);
+	free(sampler.buf);
+	sampler.buf = NULL;
+	sampler.count = 0;
+	pthread_mutex_unlock(&sampler.buf_mutex);
+	return 0;
+}
+
+
+int rc_bmp_sampler_get_latest(rc_bmp_sample_t* sample)
+{
+	uint32_t seq1, seq2 = 0;
+
+	if(sample==NULL){
+		fprintf(stderr,"ERROR in rc_bmp_sampler_get_latest, received NULL pointer\n");
+		return -1;
+	}
+	if(!sampler.running){
+		fprintf(stderr,"ERROR in rc_bmp_sampler_get_latest, sampler not running\n");
+		return -1;
+	}
+	do{
+		seq1 = __atomic_load_n(&sampler.published_seq, __ATOMIC_ACQUIRE);
+		if(seq1==0) return 1; // nothing published yet
+		if(seq1&1) continue;  // writer in progress
+		*sample = sampler.latest;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		seq2 = __atomic_load_n(&sampler.published_seq, __ATOMIC_RELAXED);
+	}while((seq1&1) || seq1!=seq2);
+	return 0;
+}
+
+
+int rc_bmp_sampler_get_history(rc_bmp_sample_t* samples, int n)
+{
+	int i, start;
+
+	if(samples==NULL){
+		fprintf(stderr,"ERROR in rc_bmp_sampler_get_history, received NULL pointer\n");
+		return -1;
+	}
+	if(n<0){
+		fprintf(stderr,"ERROR in rc_bmp_sampler_get_history, n must be >= 0\n");
+		return -1;
+	}
+	pthread_mutex_lock(&sampler.buf_mutex);
+	if(sampler.buf==NULL){
+		pthread_mutex_unlock(&sampler.buf_mutex);
+		fprintf(stderr,"ERROR in rc_bmp_sampler_get_history, sampler not running\n");
+		return -1;
+	}
+	if(n>sampler.count) n = sampler.count;
+	start = sampler.head - n;
+	if(start<0) start += sampler.conf.buffer_len;
+	for(i=0;i<n;i++){
+		samples[i] = sampler.buf[(start+i)%sampler.conf.buffer_len];
+	}
+	pthread_mutex_unlock(&sampler.buf_mutex);
+	return n;
+}
+
+
+int rc_bmp_sampler_get_stats(rc_bmp_sampler_stats_t* stats)
+{
+	if(stats==NULL){
+		fprintf(stderr,"ERROR in rc_bmp_sampler_get_stats, received NULL pointer\n");
+		return -1;
+	}
+	pthread_mutex_lock(&sampler.buf_mutex);
+	*stats = sampler.stats;
+	pthread_mutex_unlock(&sampler.buf_mutex);
+	return 0;
+}
@@ -12,6 +12,7 @@
 #include <sys/types.h>
 #include <errno.h>
 #include <math.h>
+#include <pthread.h>
 #include <rc/pthread.h>
 #include <rc/pinmux.h>
 #include <rc/time.h>
@@ -44,6 +45,11 @@
 #define DSM_PACKET_SIZE	16
 #define UART_TIMEOUT_S	0.2
 #define CONNECTION_LOST_TIMEOUT_NS 300000000
+#define DSM_GAP_NS	3000000	// quiet time before a frame, see __read_frame()
+#define DETECTION_FRAMES	4
+#define DSM_MAX_CHANNELS	9	// most channels a DSM receiver sends
+#define SBUS_BAUD_RATE	100000
+#define CRSF_BAUD_RATE	420000
 
 static int running;
 static int channels[RC_MAX_DSM_CHANNELS];
@@ -63,6 +69,15 @@ static void (*new_data_callback)();
 static void (*disconnect_callback)();
 static int active_flag=0;
 static int init_flag=0;
+static uint64_t last_byte_ns; // receive time of the last byte read
+static uint64_t last_frame_ns; // receive time of the last good frame
+static rc_dsm_stats_t stats;
+static rc_dsm_frame_t published; // seqlock protected copy of the latest channels
+static uint32_t published_seq; // odd while published is being written
+static rc_input_protocol_t protocol = RC_INPUT_DSM;
+static rc_input_link_stats_t link_stats; // latest CRSF link statistics, protected by stats_mutex
+static int link_stats_valid;
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 
 /**
@@ -124,6 +139,299 @@ static int __continue_or_quit(void)
 	return ret;
 }
 
+/**
+ * counts a good frame and any missing between it and the last one, the
+ * shortest interval seen so far is taken as the frame period
+ */
+static void __count_frame(uint64_t rx_ns)
+{
+	uint64_t dt;
+	pthread_mutex_lock(&stats_mutex);
+	stats.frames++;
+	if(last_frame_ns!=0){
+		dt = rx_ns-last_frame_ns;
+		if(stats.period_ns==0 || dt<stats.period_ns) stats.period_ns = dt;
+		else if(dt > stats.period_ns+stats.period_ns/2){
+			stats.lost += (dt+stats.period_ns/2)/stats.period_ns - 1;
+		}
+	}
+	pthread_mutex_unlock(&stats_mutex);
+	last_frame_ns = rx_ns;
+	return;
+}
+
+
+/**
+ * Resets what the parser threads share at start. Bytes already waiting may be
+ * the middle of a frame so they're flushed and the first gap is treated as
+ * starting now.
+ */
+static void __start_thread(void)
+{
+	new_dsm_flag=0;
+	pthread_mutex_lock(&stats_mutex);
+	memset(&stats,0,sizeof(stats));
+	link_stats_valid = 0;
+	pthread_mutex_unlock(&stats_mutex);
+	last_frame_ns = 0;
+	rc_uart_flush(DSM_UART_BUS);
+	last_byte_ns = rc_nanos_since_boot();
+	init_flag=1;
+	return;
+}
+
+
+/**
+ * Reads one complete DSM frame from the uart.
+ *
+ * Receivers send each 16 byte frame as one burst taking about 1.4ms and
+ * start a new one every 11 or 22ms, so the line is quiet for at least 9ms
+ * between frames. A byte is only taken as the start of a frame if it follows
+ * such a gap. A dropped or extra byte therefore only costs the frame it hit,
+ * the framing is right again from the next gap instead of staying shifted.
+ * In low latency mode the wait for the rest of the frame ends exactly when its
+ * last byte arrives.
+ *
+ * @param[out] buf    DSM_PACKET_SIZE bytes
+ * @param[out] rx_ns  rc_nanos_since_boot() when the last byte was received
+ *
+ * @return     0 with a frame in buf, -1 on timeout or shutdown
+ */
+static int __read_frame(uint8_t* buf, uint64_t* rx_ns)
+{
+	uint64_t start_ns, end_ns;
+	int ret;
+
+	while(running){
+		ret = rc_uart_read_bytes_stamped(DSM_UART_BUS, buf, 1, &start_ns);
+		if(ret!=1) return -1;
+		if(start_ns-last_byte_ns < DSM_GAP_NS){
+			// tail of a frame we didn't catch the start of
+			last_byte_ns = start_ns;
+			pthread_mutex_lock(&stats_mutex);
+			stats.skipped++;
+			pthread_mutex_unlock(&stats_mutex);
+			continue;
+		}
+		ret = rc_uart_read_bytes_stamped(DSM_UART_BUS, buf+1, DSM_PACKET_SIZE-1, &end_ns);
+		if(ret!=DSM_PACKET_SIZE-1){
+			// timed out part way through
+			last_byte_ns = rc_nanos_since_boot();
+			pthread_mutex_lock(&stats_mutex);
+			stats.broken++;
+			if(ret>0) stats.skipped += ret+1;
+			pthread_mutex_unlock(&stats_mutex);
+			return -1;
+		}
+		last_byte_ns = end_ns;
+		// a gap in the middle means bytes went missing and the end
+		// belongs to the next frame, the rest of which is skipped above
+		if(end_ns-start_ns >= DSM_GAP_NS){
+			#ifdef DEBUG
+			fprintf(stderr,"WARNING: broken DSM frame, resynchronising\n");
+			#endif
+			pthread_mutex_lock(&stats_mutex);
+			stats.broken++;
+			stats.skipped += DSM_PACKET_SIZE;
+			pthread_mutex_unlock(&stats_mutex);
+			continue;
+		}
+
+		__count_frame(end_ns);
+		*rx_ns = end_ns;
+		return 0;
+	}
+	return -1;
+}
+
+
+/**
+ * scales a raw channel value to -1 to 1 with the calibration
+ */
+static double __normalize(int i, int raw)
+{
+	// return 0 if there was a weird condition
+	if(fabs(range_up[i]) < TOL || fabs(range_down[i]) < TOL || raw==0) return 0.0;
+	if(raw==centers[i]) return 0.0;
+	if(raw>centers[i]) return (raw-centers[i])/range_up[i];
+	return (raw-centers[i])/range_down[i];
+}
+
+
+/**
+ * Writer side of the seqlock around published. Only the parser thread calls
+ * this, after a complete set of channels has been copied into channels[].
+ * Normalizing happens here once per frame instead of on every read.
+ */
+static void __publish(uint64_t rx_ns)
+{
+	rc_dsm_frame_t f;
+	int i;
+
+	memset(&f, 0, sizeof(f));
+	f.channels = num_channels;
+	for(i=0;i<num_channels;i++){
+		f.raw[i] = channels[i];
+		f.normalized[i] = __normalize(i, channels[i]);
+	}
+	f.count = published.count+1;
+	f.timestamp_ns = rx_ns;
+
+	__atomic_store_n(&published_seq, published_seq+1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	published = f;
+	__atomic_store_n(&published_seq, published_seq+1, __ATOMIC_RELEASE);
+	return;
+}
+
+
+/**
+ * publishes the complete set of channels now in channels[] and lets the user
+ * know, the same for every protocol
+ */
+static void __commit(uint64_t rx_ns)
+{
+	__publish(rx_ns);
+	new_dsm_flag=1;
+	active_flag=1;
+	last_time = rx_ns;
+	// run the dsm ready function.
+	// this is null unless user changed it
+	if(new_data_callback!=NULL) new_data_callback();
+	return;
+}
+
+
+/**
+ * Reader side of the seqlock, never blocks the parser thread.
+ *
+ * @return     0 on success, 1 if nothing has been published yet
+ */
+static int __snapshot(rc_dsm_frame_t* f)
+{
+	uint32_t seq1, seq2 = 0;
+	do{
+		seq1 = __atomic_load_n(&published_seq, __ATOMIC_ACQUIRE);
+		if(seq1==0) return 1; // nothing published yet
+		if(seq1&1) continue;  // writer in progress
+		*f = published;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		seq2 = __atomic_load_n(&published_seq, __ATOMIC_RELAXED);
+	}while((seq1&1) || seq1!=seq2);
+	return 0;
+}
+
+
+/**
+ * Decodes the channel words of one frame into new_values, once every channel
+ * has arrived the set is published along with the receive time of the frame
+ * that completed it. Radios with more than 7 channels split them across two
+ * frames so that may take a second one.
+ *
+ * @param[in]  buf         the frame
+ * @param[in]  rx_ns       receive time of the frame
+ * @param      new_values  channel values collected so far
+ */
+static void __decode_frame(const uint8_t* buf, uint64_t rx_ns, int* new_values)
+{
+	int i, is_complete;
+	unsigned char ch_id;
+	int16_t value;
+
+	// orange R110X sends this packet repeatedly without signal, discard it.
+	if(buf[1]==0xA2 && buf[3]==0xA2 && buf[5]==0xA2 && buf[7]==0xA2 && buf[9]==0xA2 && buf[11]==0xA2){
+		return;
+	}
+
+	// raw debug mode spits out all ones and zeros
+	#ifdef DEBUG
+	for(i=0; i<(DSM_PACKET_SIZE/2); i++){
+		fprintf(stderr,__byte_to_binary(buf[2*i]));
+		fprintf(stderr," ");
+		fprintf(stderr,__byte_to_binary(buf[(2*i)+1]));
+		fprintf(stderr,"   ");
+	}
+	fprintf(stderr,"\n");
+	#endif
+
+	// packet is 16 bytes, 8 words long
+	// first word doesn't have channel data, so iterate through last 7 words
+	for(i=1;i<=7;i++){
+		// unused words are 0xFF
+		// skip if one of them
+		if(buf[2*i]!=0xFF || buf[(2*i)+1]!=0xFF){
+			// grab channel id from first byte
+			// and value from both bytes
+			if(resolution == 1024){
+				// 0x7c is 0b01111100
+				ch_id = (buf[i*2]&0x7C)>>2;
+				// grab value from least 11 bytes
+				value = ((buf[i*2]&0x03)<<8) + buf[(2*i)+1];
+				value += 989; // shift range so 1500 is neutral
+			}
+			else{
+				// 0x78 is 0b01111000
+				ch_id = (buf[i*2]&0x78)>>3;
+				// grab value from least 11 bytes
+				// 0x07 is 0b00000111
+				value = ((buf[i*2]&0x07)<<8) + buf[(2*i)+1];
+				// extra bit of precision means scale is off by factor of
+				// two, also add 989 to center channels around 1500
+				value = (value/2) + 989;
+			}
+
+			#ifdef DEBUG
+			fprintf(stderr,"%d %d  ",ch_id,value);
+			#endif
+
+			if(ch_id>=num_channels){
+				#ifdef DEBUG
+				fprintf(stderr,"WARNING in DSM background service, received bad channel id\n");
+				#endif
+				return;
+			}
+			// record new value
+			new_values[ch_id] = value;
+		}
+	}
+
+	// check if a complete set of channel data has been received
+	// for 7 or less channels, everything should have come in one packet
+	// for 8 channels and up, will take two otherwise wait for another packet with more data
+	is_complete = 1;
+	for(i=0;i<num_channels;i++){
+		if (new_values[i]==0){
+			is_complete=0;
+			if(num_channels>7){
+				#ifdef DEBUG
+				fprintf(stderr,"waiting for rest of data in next packet\n");
+				#endif
+				break;
+			}
+			else{
+				#ifdef DEBUG
+				fprintf(stderr,"missing channel data in packet\n");
+				#endif
+				for(i=0;i<num_channels;i++){
+					new_values[i]=0;// put local values array back to 0
+				}
+			}
+		}
+	}
+	if(is_complete){
+		#ifdef DEBUG
+		fprintf(stderr,"all data complete now\n");
+		#endif
+		for(i=0;i<num_channels;i++){
+			channels[i]=new_values[i];
+			new_values[i]=0;// put local values array back to 0
+		}
+		__commit(rx_ns);
+	}
+	return;
+}
+
+
 /**
  * This is a local function that is started as a background thread by
  * rc_initialize_dsm(). This monitors the serial port and interprets data for
@@ -131,24 +439,26 @@ static int __continue_or_quit(void)
  * channels split data across multiple packets. Thus, new data is not committed
  * until a full set of channel data is received.
  *
+ * The frames used to detect the resolution and channels are kept and decoded
+ * once that's done, so the first channel data is published as soon as
+ * detection finishes.
+ *
  * @param[in]  <unnamed>  { parameter_description }
  *
  * @return     { description_of_the_return_value }
  */
 static void* __parser_func(__attribute__ ((unused)) void* ptr){
-	uint8_t buf[DSM_PACKET_SIZE];
-	int i, ret;
+	uint8_t buf[DETECTION_FRAMES][DSM_PACKET_SIZE];
+	uint64_t rx_ns[DETECTION_FRAMES];
+	int i, n;
 	int new_values[RC_MAX_DSM_CHANNELS]; // hold new values before committing
-	int detection_packets_left; // use first 4 packets just for detection
 	unsigned char ch_id;
-	int16_t value;
-	int is_complete;
 	unsigned char max_channel_id_1024 = 0; // max channel assuming 1024 decoding
 	unsigned char max_channel_id_2048 = 0; // max channel assuming 2048 decoding
-	char channels_detected_1024[RC_MAX_DSM_CHANNELS];
-	char channels_detected_2048[RC_MAX_DSM_CHANNELS];
-	new_dsm_flag=0;
-	init_flag=1;
+	char channels_detected_1024[DSM_MAX_CHANNELS];
+	char channels_detected_2048[DSM_MAX_CHANNELS];
+	memset(new_values,0,sizeof(new_values));
+	__start_thread();
 
 	/********************************************************************
 	* First packets that come in are read just to detect resolution and channels
@@ -156,26 +466,17 @@ static void* __parser_func(__attribute__ ((unused)) void* ptr){
 	* to break 1024 mode then swap to 2048
 	*****************************************************************/
 DETECTION_START:
-	rc_uart_flush(DSM_UART_BUS); // flush first
-	detection_packets_left = 4;
+	n = 0;
 	max_channel_id_1024 = 0;
 	max_channel_id_2048 = 0;
-	memset(channels_detected_1024,0,RC_MAX_DSM_CHANNELS);
-	memset(channels_detected_2048,0,RC_MAX_DSM_CHANNELS);
-	while(detection_packets_left>0 && running){
+	memset(channels_detected_1024,0,DSM_MAX_CHANNELS);
+	memset(channels_detected_2048,0,DSM_MAX_CHANNELS);
+	while(n<DETECTION_FRAMES && running){
 
-		memset(buf,0,DSM_PACKET_SIZE);
-		ret = rc_uart_read_bytes(DSM_UART_BUS, buf, DSM_PACKET_SIZE);
-		if(ret!=DSM_PACKET_SIZE){
-			#ifdef DEBUG
-				printf("WARNING: read the wrong number of bytes: %d\n", ret);
-			#endif
-			rc_uart_flush(DSM_UART_BUS); // flush
-			continue;
-		}
+		if(__read_frame(buf[n], &rx_ns[n])) continue;
 
 		// orange R110X sends this packet repeatedly without signal, discard it.
-		if(buf[1]==0xA2 && buf[3]==0xA2 && buf[5]==0xA2 && buf[7]==0xA2 && buf[9]==0xA2 && buf[11]==0xA2){
+		if(buf[n][1]==0xA2 && buf[n][3]==0xA2 && buf[n][5]==0xA2 && buf[n][7]==0xA2 && buf[n][9]==0xA2 && buf[n][11]==0xA2){
 			continue;
 		}
 
@@ -188,14 +489,14 @@ DETECTION_START:
 		#endif
 		for(i=1;i<8;i++){
 			// last few words in buffer are often all 1's, ignore those
-			if((buf[2*i]!=0xFF) || (buf[(2*i)+1]!=0xFF)){
+			if((buf[n][2*i]!=0xFF) || (buf[n][(2*i)+1]!=0xFF)){
 				// grab channel id from first byte assuming 1024 mode
 				// 0x7C is 0b01111100
-				ch_id = (buf[i*2]&0x7C)>>2;
+				ch_id = (buf[n][i*2]&0x7C)>>2;
 				if(ch_id>max_channel_id_1024){
 					max_channel_id_1024 = ch_id;
 				}
-				if(ch_id<RC_MAX_DSM_CHANNELS){
+				if(ch_id<DSM_MAX_CHANNELS){
 					channels_detected_1024[ch_id] = 1;
 				}
 				#ifdef DEBUG
@@ -210,14 +511,14 @@ DETECTION_START:
 
 		for(i=1;i<8;i++){
 			// last few words in buffer are often all 1's, ignore those
-			if((buf[2*i]!=0xFF) || (buf[(2*i)+1]!=0xFF)){
+			if((buf[n][2*i]!=0xFF) || (buf[n][(2*i)+1]!=0xFF)){
 				// now grab assuming 2048 mode
 				// 0x78 is 0b01111000
-				ch_id = (buf[i*2]&0x78)>>3;
+				ch_id = (buf[n][i*2]&0x78)>>3;
 				if(ch_id>max_channel_id_2048){
 					 max_channel_id_2048 = ch_id;
 				}
-				if(ch_id<RC_MAX_DSM_CHANNELS){
+				if(ch_id<DSM_MAX_CHANNELS){
 					channels_detected_2048[ch_id] = 1;
 				}
 				#ifdef DEBUG
@@ -226,20 +527,11 @@ DETECTION_START:
 			}
 		}
 
-		// raw debug mode spits out all ones and zeros
 		#ifdef DEBUG
-		printf("ret=%d : ", ret);
-		for(i=0; i<(DSM_PACKET_SIZE/2); i++){
-			printf(__byte_to_binary(buf[2*i]));
-			printf(" ");
-			printf(__byte_to_binary(buf[(2*i)+1]));
-			printf("   ");
-		}
 		printf("\n");
 		#endif
 
-
-		detection_packets_left --;
+		n++;
 	}
 
 	// do an exit check here since there is a jump above this code
@@ -248,12 +540,12 @@ DETECTION_START:
 /***************************************************************************
 * now determine which mode from detection data
 ***************************************************************************/
-	if(max_channel_id_1024 >= RC_MAX_DSM_CHANNELS){
+	if(max_channel_id_1024 >= DSM_MAX_CHANNELS){
 		// probbaly 2048 if 1024 was invalid
 		resolution = 2048;
 
 		// still do some checks
-		if(max_channel_id_2048 >= RC_MAX_DSM_CHANNELS){
+		if(max_channel_id_2048 >= DSM_MAX_CHANNELS){
 			#ifdef DEBUG
 			fprintf(stderr,"WARNING: too many DSM channels detected, trying again\n");
 			#endif
@@ -275,7 +567,7 @@ DETECTION_START:
 		resolution = 1024;
 
 		// still do some checks
-		if(max_channel_id_1024 >= RC_MAX_DSM_CHANNELS){
+		if(max_channel_id_1024 >= DSM_MAX_CHANNELS){
 			fprintf(stderr,"WARNING: too many DSM channels detected, trying again\n");
 			goto DETECTION_START;
 		}
@@ -292,10 +584,12 @@ DETECTION_START:
 	// make sure nothing fishy happened
 	if(num_channels<2) goto DETECTION_START;
 
+	// the detection frames carry channel data too
+	for(i=0;i<DETECTION_FRAMES;i++) __decode_frame(buf[i], rx_ns[i], new_values);
+
 /***************************************************************************
 * normal operation loop
 ***************************************************************************/
-START_NORMAL_LOOP:
 	while(running){
 
 		// check for timeouts
@@ -304,127 +598,102 @@ START_NORMAL_LOOP:
 			if(disconnect_callback!=NULL) disconnect_callback();
 		}
 
-		memset(buf,0,DSM_PACKET_SIZE);
-		rc_uart_flush(DSM_UART_BUS); // flush
-		ret = rc_uart_read_bytes(DSM_UART_BUS, buf, DSM_PACKET_SIZE);
-		if(ret!=DSM_PACKET_SIZE){
-			#ifdef DEBUG
-				fprintf(stderr,"WARNING: read the wrong number of bytes: %d\n", ret);
-			#endif
-			rc_uart_flush(DSM_UART_BUS); // flush
-			continue;
-		}
+		if(__read_frame(buf[0], &rx_ns[0])) continue;
+		__decode_frame(buf[0], rx_ns[0], new_values);
+	}
+	return NULL;
+}
 
-		// orange R110X sends this packet repeatedly without signal, discard it.
-		if(buf[1]==0xA2 && buf[3]==0xA2 && buf[5]==0xA2 && buf[7]==0xA2 && buf[9]==0xA2 && buf[11]==0xA2){
-			continue;
-		}
+static void __on_channels(const rc_input_channels_t* ch, __attribute__ ((unused)) void* ctx)
+{
+	int i;
+	__count_frame(ch->timestamp_ns);
+	// failsafe values are made up by the receiver, let the connection
+	// time out instead of passing them on as if they came from the user
+	if(ch->failsafe) return;
+	num_channels = ch->channels;
+	for(i=0;i<num_channels;i++) channels[i] = ch->raw[i];
+	__commit(ch->timestamp_ns);
+	return;
+}
 
-		// raw debug mode spits out all ones and zeros
-		#ifdef DEBUG
-		fprintf(stderr,"ret=%d : ", ret);
-		for(i=0; i<(DSM_PACKET_SIZE/2); i++){
-			fprintf(stderr,__byte_to_binary(buf[2*i]));
-			fprintf(stderr," ");
-			fprintf(stderr,__byte_to_binary(buf[(2*i)+1]));
-			fprintf(stderr,"   ");
-		}
-		fprintf(stderr,"\n");
-		#endif
 
-		// okay, must have a full packet now
-		// packet is 16 bytes, 8 words long
-		// first word doesn't have channel data, so iterate through last 7 words
-		for(i=1;i<=7;i++){
-			// unused words are 0xFF
-			// skip if one of them
-			if(buf[2*i]!=0xFF || buf[(2*i)+1]!=0xFF){
-				// grab channel id from first byte
-				// and value from both bytes
-				if(resolution == 1024){
-					// 0x7c is 0b01111100
-					ch_id = (buf[i*2]&0x7C)>>2;
-					// grab value from least 11 bytes
-					value = ((buf[i*2]&0x03)<<8) + buf[(2*i)+1];
-					value += 989; // shift range so 1500 is neutral
-				}
-				else if(resolution == 2048){
-					// 0x78 is 0b01111000
-					ch_id = (buf[i*2]&0x78)>>3;
-					// grab value from least 11 bytes
-					// 0x07 is 0b00000111
-					value = ((buf[i*2]&0x07)<<8) + buf[(2*i)+1];
-					// extra bit of precision means scale is off by factor of
-					// two, also add 989 to center channels around 1500
-					value = (value/2) + 989;
-				}
-				else{
-					fprintf(stderr,"ERROR: dsm resolution incorrect\n");
-					return NULL;
-				}
+static void __on_link_stats(const rc_input_link_stats_t* s, __attribute__ ((unused)) void* ctx)
+{
+	pthread_mutex_lock(&stats_mutex);
+	link_stats = *s;
+	link_stats_valid = 1;
+	pthread_mutex_unlock(&stats_mutex);
+	return;
+}
 
-				#ifdef DEBUG
-				fprintf(stderr,"%d %d  ",ch_id,value);
-				#endif
 
-				if(ch_id>=num_channels){
-					#ifdef DEBUG
-					fprintf(stderr,"WARNING in DSM background service, received bad channel id\n");
-					#endif
+/**
+ * Background thread for SBUS and CRSF receivers, the counterpart of
+ * __parser_func() for DSM. Reads exactly what the decoder needs to complete
+ * the frame under way so it wakes once per frame as the last byte arrives.
+ *
+ * @return     NULL
+ */
+static void* __decoder_func(__attribute__ ((unused)) void* ptr)
+{
+	rc_input_decoder_t dec;
+	uint8_t buf[RC_INPUT_MAX_FRAME];
+	uint64_t rx_ns = 0;
+	int ret;
 
-					goto START_NORMAL_LOOP;
-				}
-				// record new value
-				new_values[ch_id] = value;
-			}
-		}
+	rc_input_decoder_init(&dec, protocol);
+	dec.channels_callback = __on_channels;
+	dec.link_stats_callback = __on_link_stats;
+	resolution = 2048; // both send 11 bit channels
+	__start_thread();
 
-		// check if a complete set of channel data has been received
-		// for 7 or less channels, everything should have come in one packet
-		// for 8 channels and up, will take two otherwise wait for another packet with more data
-		is_complete = 1;
-		for(i=0;i<num_channels;i++){
-			if (new_values[i]==0){
-				is_complete=0;
-				if(num_channels>7){
-					#ifdef DEBUG
-					fprintf(stderr,"waiting for rest of data in next packet\n");
-					#endif
-					break;
-				}
-				else{
-					#ifdef DEBUG
-					fprintf(stderr,"missing channel data in packet\n");
-					#endif
-					for(i=0;i<num_channels;i++){
-						new_values[i]=0;// put local values array back to 0
-					}
-				}
-			}
-		}
-		if(is_complete){
-			#ifdef DEBUG
-			fprintf(stderr,"all data complete now\n");
-			#endif
-			new_dsm_flag=1;
-			active_flag=1;
-			last_time = rc_nanos_since_boot();
-			for(i=0;i<num_channels;i++){
-				channels[i]=new_values[i];
-				new_values[i]=0;// put local values array back to 0
-			}
-			// run the dsm ready function.
-			// this is null unless user changed it
-			if(new_data_callback!=NULL) new_data_callback();
+	while(running){
+		// check for timeouts
+		if(active_flag!=0 && rc_dsm_nanos_since_last_packet()>CONNECTION_LOST_TIMEOUT_NS){
+			active_flag=0;
+			if(disconnect_callback!=NULL) disconnect_callback();
 		}
 
-		#ifdef DEBUG
-		printf("\n");
-		#endif
+		ret = rc_uart_read_bytes_stamped(DSM_UART_BUS, buf, rc_input_decoder_wanted(&dec), &rx_ns);
+		if(ret<=0) continue;
+		rc_input_decoder_feed(&dec, buf, ret, rx_ns);
+		pthread_mutex_lock(&stats_mutex);
+		stats.broken = dec.stats.errors;
+		stats.skipped = dec.stats.skipped;
+		pthread_mutex_unlock(&stats_mutex);
 	}
 	return NULL;
 }
 
+
+/**
+ * opens the uart with the settings of the protocol in use
+ *
+ * @return     0 on success, -1 on failure
+ */
+static int __open_uart(float timeout_s)
+{
+	int ret;
+	// disable canonical (0), 1 stop bit (1), disable parity (0)
+	// SBUS is 2 stop bits and even parity
+	switch(protocol){
+	case RC_INPUT_SBUS:
+		ret = rc_uart_init(DSM_UART_BUS, SBUS_BAUD_RATE, timeout_s, 0, 2, 1);
+		break;
+	case RC_INPUT_CRSF:
+		ret = rc_uart_init(DSM_UART_BUS, CRSF_BAUD_RATE, timeout_s, 0, 1, 0);
+		break;
+	default:
+		ret = rc_uart_init(DSM_UART_BUS, DSM_BAUD_RATE, timeout_s, 0, 1, 0);
+		break;
+	}
+	if(ret) return -1;
+	// wake the parser as soon as a whole frame is in
+	return rc_uart_set_low_latency(DSM_UART_BUS, 1);
+}
+
+
 /**
  * this is started as a background thread by rc_dsm_calibrate_routine(). Only
  * used during calibration to monitor data as it comes in.
@@ -484,7 +753,7 @@ static void* __calibration_listen_func(__attribute__ ((unused)) void *ptr)
 
 int rc_dsm_init(void)
 {
-	int i;
+	int i, ret;
 	//if calibration file exists, load it and start spektrum thread
 	FILE* fd;
 
@@ -503,7 +772,18 @@ int rc_dsm_init(void)
 	}
 	else{
 		for(i=0;i<RC_MAX_DSM_CHANNELS;i++){
-			if(fscanf(fd,"%d %d %d", &mins[i],&maxes[i],&centers[i])!=3){
+			ret = fscanf(fd,"%d %d %d", &mins[i],&maxes[i],&centers[i]);
+			// files written before SBUS and CRSF support only have the
+			// first 9 channels, the rest keep the defaults
+			if(ret==EOF && i>=DSM_MAX_CHANNELS){
+				for(;i<RC_MAX_DSM_CHANNELS;i++){
+					mins[i]=DEFAULT_MIN;
+					maxes[i]=DEFAULT_MAX;
+					centers[i]=DEFAULT_CENTER;
+				}
+				break;
+			}
+			if(ret!=3){
 				fprintf(stderr, "ERROR in rc_dsm_init reading calibration data\n");
 				fprintf(stderr, "Malformed calibration file, deleting and using defaults\n");
 				//fclose(fd);
@@ -550,18 +830,20 @@ int rc_dsm_init(void)
 	running = 1; // lets uarts 4 thread know it can run
 	num_channels = 0;
 	last_time = 0;
+	__atomic_store_n(&published_seq, 0, __ATOMIC_RELEASE);
+	memset(&published, 0, sizeof(published));
 	active_flag = 0;
 	new_data_callback=NULL;
 	disconnect_callback=NULL;
 	new_dsm_flag=0;
 
-	// 0.2s timeout, disable canonical (0), 1 stop bit (1), disable parity (0)
-	if(rc_uart_init(DSM_UART_BUS, DSM_BAUD_RATE, UART_TIMEOUT_S, 0, 1, 0)){
+	// 0.2s timeout
+	if(__open_uart(UART_TIMEOUT_S)){
 		fprintf(stderr,"ERROR in rc_dsm_init, failed to init uart bus\n");
 		return -1;
 	}
 
-	if(rc_pthread_create(&parse_thread, __parser_func, NULL, SCHED_OTHER, 0)){
+	if(rc_pthread_create(&parse_thread, protocol==RC_INPUT_DSM ? __parser_func : __decoder_func, NULL, SCHED_OTHER, 0)){
 		fprintf(stderr,"ERROR in rc_dsm_init, failed to start thread\n");
 		return -1;
 	}
@@ -605,6 +887,7 @@ int rc_dsm_cleanup(void)
 
 int rc_dsm_ch_raw(int ch)
 {
+	rc_dsm_frame_t f;
 	if(init_flag==0){
 		fprintf(stderr,"ERROR in rc_dsm_ch_raw, call rc_dsm_init first\n");
 		return -1;
@@ -614,12 +897,14 @@ int rc_dsm_ch_raw(int ch)
 		return -1;
 	}
 	new_dsm_flag = 0;
-	return channels[ch-1];
+	if(__snapshot(&f)) return 0;
+	return f.raw[ch-1];
 }
 
 
 double rc_dsm_ch_normalized(int ch)
 {
+	rc_dsm_frame_t f;
 	if(init_flag==0){
 		fprintf(stderr,"ERROR in rc_dsm_ch_normalized, call rc_dsm_init first\n");
 		return -1.0;
@@ -628,15 +913,24 @@ double rc_dsm_ch_normalized(int ch)
 		fprintf(stderr,"ERROR in rc_dsm_ch_raw channel must be between 1 & %d",RC_MAX_DSM_CHANNELS);
 		return -1.0;
 	}
-	// return 0 if there was a weird condition
-	if(fabs(range_up[ch-1]) < TOL || fabs(range_down[ch-1]) < TOL || channels[ch-1]==0) return 0.0f;
-
 	// mark data as read
 	new_dsm_flag = 0;
+	if(__snapshot(&f)) return 0.0;
+	return f.normalized[ch-1];
+}
+
 
-	if(channels[ch-1]==centers[ch-1]) return 0.0;
-	if(channels[ch-1]>centers[ch-1]) return (channels[ch-1]-centers[ch-1])/range_up[ch-1];
-	return (channels[ch-1]-centers[ch-1])/range_down[ch-1];
+int rc_dsm_get_frame(rc_dsm_frame_t* frame)
+{
+	if(init_flag==0){
+		fprintf(stderr,"ERROR in rc_dsm_get_frame, call rc_dsm_init first\n");
+		return -1;
+	}
+	if(frame==NULL){
+		fprintf(stderr,"ERROR in rc_dsm_get_frame, received NULL pointer\n");
+		return -1;
+	}
+	return __snapshot(frame);
 }
 
 
@@ -713,6 +1007,63 @@ int rc_dsm_channels(void)
 
 
 
+int rc_dsm_get_stats(rc_dsm_stats_t* out)
+{
+	if(init_flag==0){
+		fprintf(stderr,"ERROR in rc_dsm_get_stats, call rc_dsm_init first\n");
+		return -1;
+	}
+	if(out==NULL){
+		fprintf(stderr,"ERROR in rc_dsm_get_stats, received NULL pointer\n");
+		return -1;
+	}
+	pthread_mutex_lock(&stats_mutex);
+	*out = stats;
+	pthread_mutex_unlock(&stats_mutex);
+	return 0;
+}
+
+
+int rc_dsm_set_protocol(rc_input_protocol_t p)
+{
+	if(running){
+		fprintf(stderr,"ERROR in rc_dsm_set_protocol, call rc_dsm_cleanup first\n");
+		return -1;
+	}
+	if(p!=RC_INPUT_DSM && p!=RC_INPUT_SBUS && p!=RC_INPUT_CRSF){
+		fprintf(stderr,"ERROR in rc_dsm_set_protocol, invalid protocol\n");
+		return -1;
+	}
+	protocol = p;
+	return 0;
+}
+
+
+rc_input_protocol_t rc_dsm_protocol(void)
+{
+	return protocol;
+}
+
+
+int rc_dsm_get_link_stats(rc_input_link_stats_t* out)
+{
+	int ret = 0;
+	if(init_flag==0){
+		fprintf(stderr,"ERROR in rc_dsm_get_link_stats, call rc_dsm_init first\n");
+		return -1;
+	}
+	if(out==NULL){
+		fprintf(stderr,"ERROR in rc_dsm_get_link_stats, received NULL pointer\n");
+		return -1;
+	}
+	pthread_mutex_lock(&stats_mutex);
+	if(link_stats_valid) *out = link_stats;
+	else ret = 1;
+	pthread_mutex_unlock(&stats_mutex);
+	return ret;
+}
+
+
 int rc_dsm_bind_routine(void)
 {
 	int value, delay, i;
@@ -858,6 +1209,8 @@ int rc_dsm_calibrate_routine(void)
 	running = 1; // lets uarts 4 thread know it can run
 	num_channels = 0;
 	last_time = 0;
+	__atomic_store_n(&published_seq, 0, __ATOMIC_RELEASE);
+	memset(&published, 0, sizeof(published));
 	active_flag = 0;
 	new_data_callback=NULL;
 	disconnect_callback=NULL;
@@ -870,13 +1223,13 @@ int rc_dsm_calibrate_routine(void)
 		return -1;
 	}
 
-	// 0.5s timeout disable canonical (0), 1 stop bit (1), disable parity (0)
-	if(rc_uart_init(DSM_UART_BUS, DSM_BAUD_RATE, 0.5, 0, 1, 0)){
+	// 0.5s timeout
+	if(__open_uart(0.5)){
 		fprintf(stderr,"ERROR in rc_dsm_calibrate_routine, failed to init uart bus\n");
 		return -1;
 	}
 
-	pthread_create(&parse_thread, NULL, __parser_func, (void*) NULL);
+	pthread_create(&parse_thread, NULL, protocol==RC_INPUT_DSM ? __parser_func : __decoder_func, (void*) NULL);
 
 	// wait for thread to start
 	i=0;
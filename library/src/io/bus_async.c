@@ -0,0 +1,412 @@
+/**
+ * @file bus_async.c
+ *
+ * @brief      Queue of I2C and SPI transactions serviced by one thread per bus
+ *
+ * Each bus has a singly linked queue per priority class threaded through the
+ * caller's rc_bus_async_t structs so submitting never allocates. The bus
+ * thread always takes from the highest non-empty class and merges I2C reads
+ * queued back to back in that class into one rc_i2c_read_multi() call.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <rc/i2c.h>
+#include <rc/spi.h>
+#include <rc/time.h>
+#include <rc/pthread.h>
+#include <rc/bus_async.h>
+
+// preposessor macros
+#define unlikely(x)	__builtin_expect (!!(x), 0)
+
+#define BUS_TYPES	2
+#define MAX_BUS		5	// covers I2C_MAX_BUS and the spi driver's limit
+
+
+typedef struct engine_t{
+	pthread_mutex_t mutex;		///< priority inheriting, protects everything below
+	pthread_cond_t work_cond;	///< signalled on submission and stop
+	pthread_cond_t done_cond;	///< broadcast whenever a transaction is done
+	int running;
+	pthread_t thread;
+	rc_bus_type_t type;
+	int bus;
+	rc_bus_async_config_t conf;
+	rc_bus_async_t* head[RC_BUS_ASYNC_PRIORITY_LEVELS];
+	rc_bus_async_t* tail[RC_BUS_ASYNC_PRIORITY_LEVELS];
+	rc_bus_async_stats_t stats;
+} engine_t;
+
+static engine_t engines[BUS_TYPES][MAX_BUS+1];
+static pthread_once_t engines_once = PTHREAD_ONCE_INIT;
+
+
+static void __engines_init(void)
+{
+	int i, j;
+	pthread_mutexattr_t mattr;
+	pthread_condattr_t cattr;
+
+	// a real-time submitter must never wait behind a preempted bus thread
+	pthread_mutexattr_init(&mattr);
+	pthread_mutexattr_setprotocol(&mattr, PTHREAD_PRIO_INHERIT);
+	pthread_condattr_init(&cattr);
+	pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+	for(i=0;i<BUS_TYPES;i++){
+		for(j=0;j<=MAX_BUS;j++){
+			pthread_mutex_init(&engines[i][j].mutex, &mattr);
+			pthread_cond_init(&engines[i][j].work_cond, &cattr);
+			pthread_cond_init(&engines[i][j].done_cond, &cattr);
+			engines[i][j].type = i;
+			engines[i][j].bus = j;
+		}
+	}
+	pthread_condattr_destroy(&cattr);
+	pthread_mutexattr_destroy(&mattr);
+	return;
+}
+
+
+static engine_t* __engine(rc_bus_type_t type, int bus, const char* func)
+{
+	if(unlikely((type!=RC_BUS_I2C && type!=RC_BUS_SPI) || bus<0 || bus>MAX_BUS)){
+		fprintf(stderr,"ERROR in %s, invalid bus type or bus must be between 0 & %d\n", func, MAX_BUS);
+		return NULL;
+	}
+	pthread_once(&engines_once, __engines_init);
+	return &engines[type][bus];
+}
+
+
+/**
+ * takes the next transaction off the highest priority queue, and for an I2C
+ * read any reads queued right behind it in the same class. Call with the
+ * mutex held.
+ *
+ * @return     number of transactions put in batch
+ */
+static int __dequeue(engine_t* e, rc_bus_async_t** batch)
+{
+	int p, n = 0;
+	rc_bus_async_t* t;
+
+	for(p=RC_BUS_ASYNC_PRIORITY_LEVELS-1;p>=0;p--) if(e->head[p]) break;
+	if(p<0) return 0;
+	do{
+		t = e->head[p];
+		e->head[p] = t->next;
+		if(e->head[p]==NULL) e->tail[p] = NULL;
+		t->next = NULL;
+		batch[n++] = t;
+	}while(batch[0]->op==RC_BUS_ASYNC_I2C_READ && n<e->conf.max_batch &&
+		e->head[p]!=NULL && e->head[p]->op==RC_BUS_ASYNC_I2C_READ);
+	return n;
+}
+
+
+/**
+ * performs a dequeued batch, filling in each result. Called without the mutex
+ * since this is where the thread sleeps on the bus.
+ *
+ * @return     number of bus calls made
+ */
+static int __perform(engine_t* e, rc_bus_async_t** batch, int n)
+{
+	int i, calls = 0;
+	rc_bus_async_t* t = batch[0];
+	rc_i2c_read_t reads[RC_I2C_MAX_MULTI_READS];
+	rc_i2c_priority_t prio = (rc_i2c_priority_t)t->priority;
+
+	switch(t->op){
+	case RC_BUS_ASYNC_I2C_READ:
+		for(i=0;i<n;i++){
+			reads[i].devAddr = batch[i]->dev_addr;
+			reads[i].regAddr = batch[i]->reg_addr;
+			reads[i].count = batch[i]->count;
+			reads[i].data = batch[i]->data;
+		}
+		// the arbiter claim sets the priority, read_multi nests inside it
+		rc_i2c_lock_bus_priority(e->bus, prio);
+		calls++;
+		if(rc_i2c_read_multi(e->bus, reads, n)==0){
+			for(i=0;i<n;i++) batch[i]->result = 0;
+		}
+		// one device that NACKs shouldn't fail the rest of the batch
+		else if(n>1){
+			for(i=0;i<n;i++){
+				calls++;
+				batch[i]->result = rc_i2c_read_multi(e->bus, &reads[i], 1) ? -1 : 0;
+			}
+		}
+		else t->result = -1;
+		rc_i2c_unlock_bus(e->bus);
+		break;
+	case RC_BUS_ASYNC_I2C_WRITE:
+		rc_i2c_lock_bus_priority(e->bus, prio);
+		calls++;
+		t->result = rc_i2c_write_to(e->bus, t->dev_addr, t->reg_addr, t->count, t->data) ? -1 : 0;
+		rc_i2c_unlock_bus(e->bus);
+		break;
+	case RC_BUS_ASYNC_SPI:
+		calls++;
+		t->result = rc_spi_transfer_multi(e->bus, t->slave, t->xfers, t->n_xfers);
+		break;
+	}
+	return calls;
+}
+
+
+/**
+ * runs callbacks and marks a batch done, called without the mutex and
+ * returns with it held
+ */
+static void __complete(engine_t* e, rc_bus_async_t** batch, int n, int calls)
+{
+	int i, p;
+	uint64_t now = rc_nanos_since_boot();
+
+	for(i=0;i<n;i++){
+		batch[i]->complete_ns = now;
+		if(batch[i]->callback) batch[i]->callback(batch[i], batch[i]->ctx);
+	}
+	pthread_mutex_lock(&e->mutex);
+	e->stats.calls += calls;
+	for(i=0;i<n;i++){
+		p = batch[i]->priority;
+		e->stats.completed[p]++;
+		if(batch[i]->result==-1) e->stats.failed[p]++;
+		if(now-batch[i]->submit_ns > e->stats.latency_max_ns[p]){
+			e->stats.latency_max_ns[p] = now-batch[i]->submit_ns;
+		}
+		// the owner may reuse or free the struct as soon as it sees this
+		__atomic_store_n(&batch[i]->done, 1, __ATOMIC_RELEASE);
+	}
+	pthread_cond_broadcast(&e->done_cond);
+	return;
+}
+
+
+static void* __bus_thread(void* ptr)
+{
+	engine_t* e = (engine_t*)ptr;
+	rc_bus_async_t* batch[RC_I2C_MAX_MULTI_READS];
+	int i, calls, n = 0;
+
+	pthread_mutex_lock(&e->mutex);
+	while(1){
+		while(e->running && (n=__dequeue(e, batch))==0){
+			pthread_cond_wait(&e->work_cond, &e->mutex);
+		}
+		if(!e->running) break;
+		pthread_mutex_unlock(&e->mutex);
+		calls = __perform(e, batch, n);
+		__complete(e, batch, n, calls);
+	}
+
+	// fail whatever is left without touching the bus
+	while((n=__dequeue(e, batch))>0){
+		pthread_mutex_unlock(&e->mutex);
+		for(i=0;i<n;i++) batch[i]->result = -1;
+		__complete(e, batch, n, 0);
+	}
+	pthread_mutex_unlock(&e->mutex);
+	return NULL;
+}
+
+
+rc_bus_async_config_t rc_bus_async_default_config(void)
+{
+	rc_bus_async_config_t conf;
+	conf.sched_policy = SCHED_OTHER;
+	conf.priority = 0;
+	conf.max_batch = RC_I2C_MAX_MULTI_READS;
+	return conf;
+}
+
+
+int rc_bus_async_start(rc_bus_type_t type, int bus, rc_bus_async_config_t conf)
+{
+	engine_t* e = __engine(type, bus, "rc_bus_async_start");
+
+	// sanity checks
+	if(e==NULL) return -1;
+	if(conf.max_batch<1 || conf.max_batch>RC_I2C_MAX_MULTI_READS){
+		fprintf(stderr,"ERROR in rc_bus_async_start, max_batch must be between 1 & %d\n", RC_I2C_MAX_MULTI_READS);
+		return -1;
+	}
+	pthread_mutex_lock(&e->mutex);
+	if(e->running){
+		pthread_mutex_unlock(&e->mutex);
+		fprintf(stderr,"ERROR in rc_bus_async_start, bus thread already running\n");
+		return -1;
+	}
+	e->conf = conf;
+	memset(e->head, 0, sizeof(e->head));
+	memset(e->tail, 0, sizeof(e->tail));
+	memset(&e->stats, 0, sizeof(e->stats));
+	e->running = 1;
+	pthread_mutex_unlock(&e->mutex);
+
+	if(rc_pthread_create(&e->thread, __bus_thread, e, conf.sched_policy, conf.priority)<0){
+		fprintf(stderr,"ERROR in rc_bus_async_start, failed to start thread\n");
+		pthread_mutex_lock(&e->mutex);
+		e->running = 0;
+		pthread_mutex_unlock(&e->mutex);
+		return -1;
+	}
+	return 0;
+}
+
+
+int rc_bus_async_stop(rc_bus_type_t type, int bus)
+{
+	engine_t* e = __engine(type, bus, "rc_bus_async_stop");
+
+	if(e==NULL) return -1;
+	pthread_mutex_lock(&e->mutex);
+	if(!e->running){
+		pthread_mutex_unlock(&e->mutex);
+		return -1;
+	}
+	e->running = 0;
+	pthread_cond_signal(&e->work_cond);
+	pthread_mutex_unlock(&e->mutex);
+	pthread_join(e->thread, NULL);
+	return 0;
+}
+
+
+int rc_bus_async_submit(rc_bus_type_t type, int bus, rc_bus_async_t* t)
+{
+	engine_t* e = __engine(type, bus, "rc_bus_async_submit");
+	int p;
+
+	// sanity checks
+	if(unlikely(e==NULL)) return -1;
+	if(unlikely(t==NULL)){
+		fprintf(stderr,"ERROR in rc_bus_async_submit, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(t->priority<RC_BUS_ASYNC_LOW || t->priority>RC_BUS_ASYNC_HIGH)){
+		fprintf(stderr,"ERROR in rc_bus_async_submit, invalid priority\n");
+		return -1;
+	}
+	switch(t->op){
+	case RC_BUS_ASYNC_I2C_READ:
+	case RC_BUS_ASYNC_I2C_WRITE:
+		if(unlikely(type!=RC_BUS_I2C)){
+			fprintf(stderr,"ERROR in rc_bus_async_submit, I2C transaction submitted to an SPI bus\n");
+			return -1;
+		}
+		if(unlikely(t->data==NULL || t->count==0)){
+			fprintf(stderr,"ERROR in rc_bus_async_submit, I2C transaction has no data buffer or zero count\n");
+			return -1;
+		}
+		if(unlikely(t->op==RC_BUS_ASYNC_I2C_WRITE && t->count>=I2C_BUFFER_SIZE)){
+			fprintf(stderr,"ERROR in rc_bus_async_submit, I2C write count must be less than %d\n", I2C_BUFFER_SIZE);
+			return -1;
+		}
+		break;
+	case RC_BUS_ASYNC_SPI:
+		if(unlikely(type!=RC_BUS_SPI)){
+			fprintf(stderr,"ERROR in rc_bus_async_submit, SPI transaction submitted to an I2C bus\n");
+			return -1;
+		}
+		if(unlikely(t->xfers==NULL || t->n_xfers<1 || t->n_xfers>RC_SPI_MAX_XFERS)){
+			fprintf(stderr,"ERROR in rc_bus_async_submit, SPI transaction needs 1 to %d transfers\n", RC_SPI_MAX_XFERS);
+			return -1;
+		}
+		break;
+	default:
+		fprintf(stderr,"ERROR in rc_bus_async_submit, invalid op\n");
+		return -1;
+	}
+	if(unlikely(t->engine!=NULL && !__atomic_load_n(&t->done, __ATOMIC_ACQUIRE))){
+		fprintf(stderr,"ERROR in rc_bus_async_submit, transaction already queued\n");
+		return -1;
+	}
+
+	p = t->priority;
+	pthread_mutex_lock(&e->mutex);
+	if(unlikely(!e->running)){
+		pthread_mutex_unlock(&e->mutex);
+		fprintf(stderr,"ERROR in rc_bus_async_submit, bus thread not running\n");
+		return -1;
+	}
+	t->done = 0;
+	t->result = 0;
+	t->engine = e;
+	t->next = NULL;
+	t->submit_ns = rc_nanos_since_boot();
+	t->complete_ns = 0;
+	if(e->tail[p]) e->tail[p]->next = t;
+	else e->head[p] = t;
+	e->tail[p] = t;
+	e->stats.submitted[p]++;
+	pthread_cond_signal(&e->work_cond);
+	pthread_mutex_unlock(&e->mutex);
+	return 0;
+}
+
+
+int rc_bus_async_poll(const rc_bus_async_t* t)
+{
+	if(unlikely(t==NULL)) return 0;
+	return __atomic_load_n(&t->done, __ATOMIC_ACQUIRE) ? 1 : 0;
+}
+
+
+int rc_bus_async_wait(rc_bus_async_t* t, int timeout_us)
+{
+	engine_t* e;
+	struct timespec deadline;
+	uint64_t ns;
+	int ret = 0;
+
+	if(unlikely(t==NULL || t->engine==NULL)){
+		fprintf(stderr,"ERROR in rc_bus_async_wait, transaction was never submitted\n");
+		return -1;
+	}
+	if(__atomic_load_n(&t->done, __ATOMIC_ACQUIRE)) return t->result;
+
+	e = (engine_t*)t->engine;
+	if(timeout_us>0){
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		ns = (uint64_t)deadline.tv_sec*1000000000ULL + deadline.tv_nsec + (uint64_t)timeout_us*1000;
+		deadline.tv_sec = ns/1000000000ULL;
+		deadline.tv_nsec = ns%1000000000ULL;
+	}
+	pthread_mutex_lock(&e->mutex);
+	while(!t->done && ret!=ETIMEDOUT){
+		if(timeout_us>0) ret = pthread_cond_timedwait(&e->done_cond, &e->mutex, &deadline);
+		else pthread_cond_wait(&e->done_cond, &e->mutex);
+	}
+	pthread_mutex_unlock(&e->mutex);
+	if(!__atomic_load_n(&t->done, __ATOMIC_ACQUIRE)) return -2;
+	return t->result;
+}
+
+
+int rc_bus_async_get_stats(rc_bus_type_t type, int bus, rc_bus_async_stats_t* stats)
+{
+	engine_t* e = __engine(type, bus, "rc_bus_async_get_stats");
+
+	if(e==NULL) return -1;
+	if(stats==NULL){
+		fprintf(stderr,"ERROR in rc_bus_async_get_stats, received NULL pointer\n");
+		return -1;
+	}
+	pthread_mutex_lock(&e->mutex);
+	*stats = e->stats;
+	pthread_mutex_unlock(&e->mutex);
+	return 0;
+}
@@ -14,6 +14,7 @@
 
 #include <rc/model.h>
 #include <rc/encoder_eqep.h>
+#include "../sim/sim_common.h"
 
 // preposessor macros
 #define unlikely(x)	__builtin_expect (!!(x), 0)
@@ -27,13 +28,16 @@
 
 static int fd[3]; //store file descriptors for 3 position files
 static int init_flag = 0; // boolean to check if mem mapped
+static const rc_encoder_ops_t* ops; // hardware or simulated, picked by rc_encoder_eqep_init
 
 
 
-int rc_encoder_eqep_init(void)
+/**
+ * enables the 3 eQEP subsystems and zeroes their counters
+ */
+static int __hw_init(void)
 {
 	int temp_fd;
-	if(init_flag) return 0;
 
 	// enable 3 subsystems
 	// subsystem 0
@@ -109,19 +113,75 @@ int rc_encoder_eqep_init(void)
 		return -1;
 	}
 	fd[2]=temp_fd;
+	return 0;
+}
+
+
+static void __hw_cleanup(void)
+{
+	int i;
+	for(i=0;i<3;i++){
+		close(fd[i]);
+	}
+	return;
+}
+
+
+static int __hw_read(int ch)
+{
+	char buf[12];
+
+	// seek to beginning of file and read
+	if(unlikely(lseek(fd[ch-1],0,SEEK_SET)<0)){
+		perror("ERROR: in rc_encoder_eqep_read, failed to seek to beginning of fd");
+		return -1;
+	}
+	if(unlikely(read(fd[ch-1], buf, sizeof(buf))==-1)){
+		perror("ERROR in rc_encoder_eqep_read, can't read position fd");
+		return -1;
+	}
+	return atoi(buf);
+}
 
 
+static int __hw_write(int ch, int pos)
+{
+	char buf[12];
 
+	if(unlikely(lseek(fd[ch-1],0,SEEK_SET)<0)){
+		perror("ERROR: in rc_encoder_eqep_write, failed to seek to beginning of fd");
+		return -1;
+	}
+	sprintf(buf,"%d",pos);
+	if(unlikely(write(fd[ch-1], buf, sizeof(buf))==-1)){
+		perror("ERROR in rc_encoder_eqep_write, can't write position fd");
+		return -1;
+	}
+	return 0;
+}
+
+
+static const rc_encoder_ops_t hw_ops = {
+	.init		= __hw_init,
+	.cleanup	= __hw_cleanup,
+	.read		= __hw_read,
+	.write		= __hw_write,
+};
+
+
+int rc_encoder_eqep_init(void)
+{
+	if(init_flag) return 0;
+	ops = __sim_pick_ops(&hw_ops, &__sim_encoder_eqep_ops);
+	if(unlikely(ops==NULL)) return -1;
+	if(ops->init()) return -1;
 	init_flag = 1;
 	return 0;
 }
 
 int rc_encoder_eqep_cleanup(void)
 {
-	int i;
-	for(i=0;i<3;i++){
-		close(fd[i]);
-	}
+	if(init_flag) ops->cleanup();
 	init_flag = 0;
 	return 0;
 }
@@ -129,8 +189,6 @@ int rc_encoder_eqep_cleanup(void)
 
 int rc_encoder_eqep_read(int ch)
 {
-	char buf[12];
-
 	//sanity checks
 	if(unlikely(!init_flag)){
 		fprintf(stderr,"ERROR in rc_encoder_eqep_read, please initialize with rc_encoder_eqep_init() first\n");
@@ -144,23 +202,13 @@ int rc_encoder_eqep_read(int ch)
 		fprintf(stderr,"ERROR: in rc_encoder_eqep_read, encoder channel must be between 1 & 3 inclusive\n");
 		return -1;
 	}
-	// seek to beginning of file and read
-	if(unlikely(lseek(fd[ch-1],0,SEEK_SET)<0)){
-		perror("ERROR: in rc_encoder_eqep_read, failed to seek to beginning of fd");
-		return -1;
-	}
-	if(unlikely(read(fd[ch-1], buf, sizeof(buf))==-1)){
-		perror("ERROR in rc_encoder_eqep_read, can't read position fd");
-		return -1;
-	}
-	return atoi(buf);
+	return ops->read(ch);
 }
 
 
 
 int rc_encoder_eqep_write(int ch, int pos)
 {
-	char buf[12];
 	//sanity checks
 	if(unlikely(!init_flag)){
 		fprintf(stderr,"ERROR in rc_encoder_eqep_write, please initialize with rc_encoder_eqep_init() first\n");
@@ -174,16 +222,5 @@ int rc_encoder_eqep_write(int ch, int pos)
 		fprintf(stderr,"ERROR: in rc_encoder_eqep_write, encoder channel must be between 1 & 3 inclusive\n");
 		return -1;
 	}
-	if(unlikely(lseek(fd[ch-1],0,SEEK_SET)<0)){
-		perror("ERROR: in rc_encoder_eqep_write, failed to seek to beginning of fd");
-		return -1;
-	}
-	sprintf(buf,"%d",pos);
-	if(unlikely(write(fd[ch-1], buf, sizeof(buf))==-1)){
-		perror("ERROR in rc_encoder_eqep_write, can't write position fd");
-		return -1;
-	}
-	return 0;
+	return ops->write(ch, pos);
 }
-
-
@@ -22,6 +22,7 @@
 #endif
 
 #include <rc/gpio.h>
+#include "../sim/sim_common.h"
 
 // preposessor macros
 #define unlikely(x)	__builtin_expect (!!(x), 0)
@@ -35,6 +36,11 @@
 static int chip_fd[CHIPS_MAX];
 static int handle_fd[CHIPS_MAX][GPIOHANDLES_MAX];
 static int event_fd[CHIPS_MAX][GPIOHANDLES_MAX];
+// group each pin belongs to, if any, and its line in that group so the single
+// pin functions can still reach pins that were requested as part of a group
+static rc_gpio_group_t* pin_group[CHIPS_MAX][GPIOHANDLES_MAX];
+static int pin_group_line[CHIPS_MAX][GPIOHANDLES_MAX];
+static const rc_gpio_ops_t* ops; // hardware or simulated, picked when lines are requested
 
 
 
@@ -55,21 +61,14 @@ static int __open_gpiochip(int chip)
 }
 
 
-int rc_gpio_init(int chip, int pin, int handle_flags)
+/**
+ * requests one line from the chip and returns the handle file descriptor
+ */
+static int __hw_request(int chip, int pin, int handle_flags)
 {
 	int ret;
 	struct gpiohandle_request req;
 
-	// sanity checks
-	if(chip<0 || chip>=CHIPS_MAX){
-		fprintf(stderr,"ERROR in rc_gpio_init, chip out of bounds\n");
-		return -1;
-	}
-	if(pin<0 || pin>=GPIOHANDLES_MAX){
-		fprintf(stderr,"ERROR in rc_gpio_init, pin out of bounds\n");
-		return -1;
-	}
-
 	// open chip if not opened already
 	if(chip_fd[chip]==0){
 		if(unlikely(__open_gpiochip(chip))) return -1;
@@ -90,16 +89,219 @@ int rc_gpio_init(int chip, int pin, int handle_flags)
 		fprintf(stderr,"ERROR in rc_gpio_init, ioctl gave NULL fd\n");
 		return -1;
 	}
-	handle_fd[chip][pin]=req.fd;
+	return req.fd;
+}
+
+
+/**
+ * requests one line for edge events and returns the event file descriptor
+ */
+static int __hw_request_event(int chip, int pin, int handle_flags, int event_flags)
+{
+	int ret;
+	struct gpioevent_request req;
+
+	// open chip if not opened already
+	if(chip_fd[chip]==0){
+		if(unlikely(__open_gpiochip(chip))) return -1;
+	}
+
+	req.lineoffset = pin;
+	req.eventflags = event_flags;
+	req.handleflags = handle_flags;
+	ret=ioctl(chip_fd[chip], GPIO_GET_LINEEVENT_IOCTL, &req);
+	if(unlikely(ret==-1)){
+		perror("ERROR in rc_gpio_init_event");
+		return -1;
+	}
+	return req.fd;
+}
+
+
+static int __hw_set_value(__attribute__ ((unused)) int chip, __attribute__ ((unused)) int pin, int fd, int value)
+{
+	int ret;
+	struct gpiohandle_data data;
+
+	if(value) data.values[0]=1;
+	else data.values[0]=0;
+
+	ret = ioctl(fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data);
+	if(unlikely(ret==-1)){
+		perror("ERROR in rc_gpio_set_value");
+		return -1;
+	}
 	return 0;
 }
 
 
-int rc_gpio_set_value(int chip, int pin, int value)
+static int __hw_get_value(__attribute__ ((unused)) int chip, __attribute__ ((unused)) int pin, int fd)
 {
 	int ret;
 	struct gpiohandle_data data;
 
+	ret = ioctl(fd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data);
+	if(unlikely(ret==-1)){
+		perror("ERROR in rc_gpio_get_value");
+		return -1;
+	}
+	return data.values[0];
+}
+
+
+static int __hw_wait_event(__attribute__ ((unused)) int chip, __attribute__ ((unused)) int pin, int fd, int timeout_ms)
+{
+	struct pollfd poll_fds[1];
+
+	poll_fds[0].fd = fd;
+	poll_fds[0].events = POLLIN | POLLPRI;
+	poll_fds[0].revents = 0;
+	return poll(poll_fds, 1, timeout_ms);
+}
+
+
+// the kernel lets go of a line when its descriptor is closed
+static void __hw_release(__attribute__ ((unused)) int chip, __attribute__ ((unused)) int pin)
+{
+	return;
+}
+
+
+/**
+ * requests all the lines of a group as one handle, outputs default low, and
+ * returns the handle file descriptor
+ */
+static int __hw_request_lines(rc_gpio_group_t* group)
+{
+	int i, ret;
+	struct gpiohandle_request req;
+
+	// open chip if not opened already
+	if(chip_fd[group->chip]==0){
+		if(unlikely(__open_gpiochip(group->chip))) return -1;
+	}
+
+	memset(&req,0,sizeof(req));
+	for(i=0;i<group->lines;i++) req.lineoffsets[i] = group->pins[i];
+	req.lines = group->lines;
+	req.flags = group->handle_flags;
+	ret = ioctl(chip_fd[group->chip], GPIO_GET_LINEHANDLE_IOCTL, &req);
+	if(unlikely(ret==-1)){
+		perror("ERROR in rc_gpio_group_init");
+		return -1;
+	}
+	if(req.fd==0){
+		fprintf(stderr,"ERROR in rc_gpio_group_init, ioctl gave NULL fd\n");
+		return -1;
+	}
+	return req.fd;
+}
+
+
+static int __hw_set_lines(rc_gpio_group_t* group, uint64_t values)
+{
+	int i, ret;
+	struct gpiohandle_data data;
+
+	for(i=0;i<group->lines;i++) data.values[i] = (values>>i)&1;
+	ret = ioctl(group->fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data);
+	if(unlikely(ret==-1)){
+		perror("ERROR in rc_gpio_group_set_values");
+		return -1;
+	}
+	return 0;
+}
+
+
+static int __hw_get_lines(rc_gpio_group_t* group, uint64_t* values)
+{
+	int i, ret;
+	struct gpiohandle_data data;
+
+	ret = ioctl(group->fd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data);
+	if(unlikely(ret==-1)){
+		perror("ERROR in rc_gpio_group_get_values");
+		return -1;
+	}
+	*values = 0;
+	for(i=0;i<group->lines;i++){
+		if(data.values[i]) *values |= 1ULL<<i;
+	}
+	return 0;
+}
+
+
+static const rc_gpio_ops_t hw_ops = {
+	.request	= __hw_request,
+	.request_event	= __hw_request_event,
+	.set_value	= __hw_set_value,
+	.get_value	= __hw_get_value,
+	.wait_event	= __hw_wait_event,
+	.release	= __hw_release,
+	.request_lines	= __hw_request_lines,
+	.set_lines	= __hw_set_lines,
+	.get_lines	= __hw_get_lines,
+};
+
+
+/**
+ * picks the hardware or simulated backend, called by each function that
+ * requests lines
+ */
+static int __pick_ops(void)
+{
+	const rc_gpio_ops_t* picked = __sim_pick_ops(&hw_ops, &__sim_gpio_ops);
+	if(unlikely(picked==NULL)) return -1;
+	ops = picked;
+	return 0;
+}
+
+
+/**
+ * points every pin of a group at owner, the group itself once requested or
+ * NULL when it is released
+ */
+static void __claim_group_pins(rc_gpio_group_t* group, rc_gpio_group_t* owner)
+{
+	int i;
+	for(i=0;i<group->lines;i++){
+		pin_group[group->chip][group->pins[i]] = owner;
+		pin_group_line[group->chip][group->pins[i]] = i;
+	}
+	return;
+}
+
+
+int rc_gpio_init(int chip, int pin, int handle_flags)
+{
+	int ret;
+
+	// sanity checks
+	if(chip<0 || chip>=CHIPS_MAX){
+		fprintf(stderr,"ERROR in rc_gpio_init, chip out of bounds\n");
+		return -1;
+	}
+	if(pin<0 || pin>=GPIOHANDLES_MAX){
+		fprintf(stderr,"ERROR in rc_gpio_init, pin out of bounds\n");
+		return -1;
+	}
+	if(unlikely(pin_group[chip][pin]!=NULL)){
+		fprintf(stderr,"ERROR in rc_gpio_init, chip %d pin %d already belongs to a gpio group\n", chip, pin);
+		return -1;
+	}
+
+	if(unlikely(__pick_ops())) return -1;
+	ret = ops->request(chip, pin, handle_flags);
+	if(ret==-1) return -1;
+	handle_fd[chip][pin]=ret;
+	return 0;
+}
+
+
+int rc_gpio_set_value(int chip, int pin, int value)
+{
+	int line;
+
 	// sanity checks
 	// sanity checks
 	if(chip<0 || chip>=CHIPS_MAX){
@@ -110,28 +312,23 @@ int rc_gpio_set_value(int chip, int pin, int value)
 		fprintf(stderr,"ERROR in rc_gpio_set_value, pin out of bounds\n");
 		return -1;
 	}
+	if(pin_group[chip][pin]!=NULL){
+		line = pin_group_line[chip][pin];
+		return rc_gpio_group_set_values(pin_group[chip][pin], 1ULL<<line, value ? 1ULL<<line : 0);
+	}
 	if(unlikely(handle_fd[chip][pin]==0)){
 		fprintf(stderr,"ERROR, pin %d not initialized yet\n",pin);
 		return -1;
 	}
 
-	if(value) data.values[0]=1;
-	else data.values[0]=0;
-
-	ret = ioctl(handle_fd[chip][pin], GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data);
-	if(unlikely(ret==-1)){
-		perror("ERROR in rc_gpio_set_value");
-		return -1;
-	}
-
-	return 0;
+	return ops->set_value(chip, pin, handle_fd[chip][pin], value);
 }
 
 
 int rc_gpio_get_value(int chip, int pin)
 {
-	int ret;
-	struct gpiohandle_data data;
+	int line;
+	uint64_t values;
 
 	// sanity checks
 	if(chip<0 || chip>=CHIPS_MAX){
@@ -142,18 +339,17 @@ int rc_gpio_get_value(int chip, int pin)
 		fprintf(stderr,"ERROR in rc_gpio_get_value, pin out of bounds\n");
 		return -1;
 	}
+	if(pin_group[chip][pin]!=NULL){
+		line = pin_group_line[chip][pin];
+		if(unlikely(rc_gpio_group_get_values(pin_group[chip][pin], &values))) return -1;
+		return (int)((values>>line)&1);
+	}
 	if(unlikely(handle_fd[chip][pin]==0)){
 		fprintf(stderr,"ERROR in rc_gpio_get_value chip %d pin %d not initialized yet\n",chip, pin);
 		return -1;
 	}
 
-	ret = ioctl(handle_fd[chip][pin], GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data);
-	if(unlikely(ret==-1)){
-		perror("ERROR in rc_gpio_get_value");
-		return -1;
-	}
-
-	return data.values[0];
+	return ops->get_value(chip, pin, handle_fd[chip][pin]);
 }
 
 
@@ -161,7 +357,6 @@ int rc_gpio_get_value(int chip, int pin)
 int rc_gpio_init_event(int chip, int pin, int handle_flags, int event_flags)
 {
 	int ret;
-	struct gpioevent_request req;
 
 	// sanity checks
 	if(chip<0 || chip>=CHIPS_MAX){
@@ -177,23 +372,12 @@ int rc_gpio_init_event(int chip, int pin, int handle_flags, int event_flags)
 		return -1;
 	}
 
-	// open chip if not opened already
-	if(chip_fd[chip]==0){
-		if(unlikely(__open_gpiochip(chip))) return -1;
-	}
-
-	req.lineoffset = pin;
-	req.eventflags = event_flags;
-	req.handleflags = handle_flags;
-	ret=ioctl(chip_fd[chip], GPIO_GET_LINEEVENT_IOCTL, &req);
-	if(unlikely(ret==-1)){
-		perror("ERROR in rc_gpio_init_event");
-		return -1;
-	}
-
-	event_fd[chip][pin]=req.fd;
-	handle_fd[chip][pin]=req.fd; // put same fd in handle array so reads also work
-	return req.fd;
+	if(unlikely(__pick_ops())) return -1;
+	ret = ops->request_event(chip, pin, handle_flags, event_flags);
+	if(ret==-1) return -1;
+	event_fd[chip][pin]=ret;
+	handle_fd[chip][pin]=ret; // put same fd in handle array so reads also work
+	return ret;
 }
 
 
@@ -201,7 +385,6 @@ int rc_gpio_poll(int chip, int pin, int timeout_ms, uint64_t* event_time_ns)
 {
 	int ret;
 	struct gpioevent_data event;
-	struct pollfd poll_fds[1];
 
 	// sanity checks
 	if(chip<0 || chip>=CHIPS_MAX){
@@ -213,13 +396,13 @@ int rc_gpio_poll(int chip, int pin, int timeout_ms, uint64_t* event_time_ns)
 		return -1;
 	}
 
-	// configure the pollfd
-	poll_fds[0].fd = event_fd[chip][pin];
-	poll_fds[0].events = POLLIN | POLLPRI;
-	poll_fds[0].revents = 0;
+	if(unlikely(event_fd[chip][pin]==0)){
+		fprintf(stderr,"ERROR in rc_gpio_poll, chip %d pin %d not initialized for events yet\n", chip, pin);
+		return RC_GPIOEVENT_ERROR;
+	}
 
 	// now poll
-	ret = poll(poll_fds, 1, timeout_ms);
+	ret = ops->wait_event(chip, pin, event_fd[chip][pin], timeout_ms);
 	if(unlikely(ret==-1)){
 		perror("ERROR in rc_gpio_poll calling poll");
 		return RC_GPIOEVENT_ERROR;
@@ -260,7 +443,10 @@ void rc_gpio_cleanup(int chip, int pin)
 		fprintf(stderr,"ERROR in rc_gpio_cleanup, pin out of bounds\n");
 		return;
 	}
+	// group pins are released with rc_gpio_group_cleanup
+	if(pin_group[chip][pin]!=NULL) return;
 	if(handle_fd[chip][pin]!=0){
+		ops->release(chip, pin);
 		close(handle_fd[chip][pin]);
 		handle_fd[chip][pin]=0;
 	}
@@ -270,3 +456,98 @@ void rc_gpio_cleanup(int chip, int pin)
 	}
 	return;
 }
+
+
+int rc_gpio_group_init(rc_gpio_group_t* group, int chip, const int* pins, int lines, int handle_flags)
+{
+	int i, ret;
+
+	// sanity checks
+	if(unlikely(group==NULL || pins==NULL)){
+		fprintf(stderr,"ERROR in rc_gpio_group_init, received NULL pointer\n");
+		return -1;
+	}
+	if(chip<0 || chip>=CHIPS_MAX){
+		fprintf(stderr,"ERROR in rc_gpio_group_init, chip out of bounds\n");
+		return -1;
+	}
+	if(lines<1 || lines>RC_GPIO_GROUP_MAX_LINES || lines>GPIOHANDLES_MAX){
+		fprintf(stderr,"ERROR in rc_gpio_group_init, lines must be between 1 & %d\n", RC_GPIO_GROUP_MAX_LINES);
+		return -1;
+	}
+	for(i=0;i<lines;i++){
+		if(pins[i]<0 || pins[i]>=GPIOHANDLES_MAX){
+			fprintf(stderr,"ERROR in rc_gpio_group_init, pin out of bounds\n");
+			return -1;
+		}
+	}
+
+	memset(group,0,sizeof(rc_gpio_group_t));
+	group->chip = chip;
+	group->lines = lines;
+	group->handle_flags = handle_flags;
+	memcpy(group->pins, pins, lines*sizeof(int));
+
+	if(unlikely(__pick_ops())) return -1;
+	ret = ops->request_lines(group);
+	if(ret==-1) return -1;
+	group->fd = ret;
+	__claim_group_pins(group, group);
+	return 0;
+}
+
+
+int rc_gpio_group_set_values(rc_gpio_group_t* group, uint64_t mask, uint64_t values)
+{
+	uint64_t new_values;
+
+	// sanity checks
+	if(unlikely(group==NULL)){
+		fprintf(stderr,"ERROR in rc_gpio_group_set_values, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(group->fd==0)){
+		fprintf(stderr,"ERROR in rc_gpio_group_set_values, group not initialized yet\n");
+		return -1;
+	}
+	if(unlikely(!(group->handle_flags&GPIOHANDLE_REQUEST_OUTPUT))){
+		fprintf(stderr,"ERROR in rc_gpio_group_set_values, group not requested as OUTPUT\n");
+		return -1;
+	}
+
+	// the handle ioctl always writes every line, fill in the unmasked ones
+	// with what they were last set to
+	new_values = (group->values & ~mask) | (values & mask);
+	if(group->lines<64) new_values &= (1ULL<<group->lines)-1;
+
+	if(unlikely(ops->set_lines(group, new_values))) return -1;
+	group->values = new_values;
+	return 0;
+}
+
+
+int rc_gpio_group_get_values(rc_gpio_group_t* group, uint64_t* values)
+{
+
+	// sanity checks
+	if(unlikely(group==NULL || values==NULL)){
+		fprintf(stderr,"ERROR in rc_gpio_group_get_values, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(group->fd==0)){
+		fprintf(stderr,"ERROR in rc_gpio_group_get_values, group not initialized yet\n");
+		return -1;
+	}
+
+	return ops->get_lines(group, values);
+}
+
+
+void rc_gpio_group_cleanup(rc_gpio_group_t* group)
+{
+	if(group==NULL || group->fd==0) return;
+	__claim_group_pins(group, NULL);
+	close(group->fd);
+	group->fd = 0;
+	return;
+}
@@ -7,12 +7,19 @@
 #include <stdint.h> // for uint8_t types etc
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h> // for memset
 #include <fcntl.h>
 #include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
 #include <sys/ioctl.h>
+#include <sys/file.h> // for flock
+#include <linux/i2c.h> // for struct i2c_msg
 #include <linux/i2c-dev.h> //for IOCTL defs
 
 #include <rc/i2c.h>
+#include <rc/time.h>
+#include "../sim/sim_common.h"
 
 // preposessor macros
 #define unlikely(x)	__builtin_expect (!!(x), 0)
@@ -28,10 +35,19 @@ typedef struct rc_i2c_state_t {
 	uint8_t devAddr;
 	int fd;
 	int initialized;
-	int lock;
+	const rc_i2c_ops_t* ops;	///< hardware or simulated, picked by rc_i2c_init
+	/* arbiter */
+	pthread_mutex_t mutex;		///< protects everything below
+	pthread_cond_t cond;		///< broadcast whenever the bus is released
+	pthread_t owner;		///< thread holding the bus, valid while depth>0
+	int depth;			///< nested acquisitions by the owner
+	int flocked;			///< 1 if the owner also holds the flock on fd
+	int waiting[RC_I2C_PRIORITY_LEVELS];	///< queued threads per priority
+	rc_i2c_stats_t stats;
 } rc_i2c_state_t;
 
 static rc_i2c_state_t i2c[I2C_MAX_BUS+1];
+static pthread_once_t arbiter_once = PTHREAD_ONCE_INIT;
 
 
 // local function
@@ -45,6 +61,215 @@ static int __check_bus_range(int bus)
 }
 
 
+static void __arbiter_init(void)
+{
+	int i;
+	for(i=0;i<=I2C_MAX_BUS;i++){
+		pthread_mutex_init(&i2c[i].mutex, NULL);
+		pthread_cond_init(&i2c[i].cond, NULL);
+	}
+	return;
+}
+
+
+static int __higher_waiting(int bus, int priority)
+{
+	int i;
+	for(i=priority+1;i<RC_I2C_PRIORITY_LEVELS;i++){
+		if(i2c[bus].waiting[i]) return 1;
+	}
+	return 0;
+}
+
+
+/**
+ * Claims the bus for the calling thread, blocking behind the current owner
+ * and any queued threads of higher priority. Nested calls from the owner just
+ * count up. The outermost claim also takes an exclusive flock on the bus file
+ * descriptor which every process opens separately, so this serializes with
+ * other processes using this library too.
+ *
+ * @return     1 if the bus was already held by any thread when called, 0 if
+ * it was free, -1 on error
+ */
+static int __acquire(int bus, rc_i2c_priority_t priority)
+{
+	int was_held, contended = 0;
+	uint64_t start, wait;
+	rc_i2c_state_t* b = &i2c[bus];
+
+	pthread_once(&arbiter_once, __arbiter_init);
+	pthread_mutex_lock(&b->mutex);
+	was_held = b->depth>0;
+	if(was_held && pthread_equal(b->owner, pthread_self())){
+		b->depth++;
+		pthread_mutex_unlock(&b->mutex);
+		return 1;
+	}
+
+	start = rc_nanos_since_boot();
+	if(was_held || __higher_waiting(bus, priority)){
+		contended = 1;
+		b->waiting[priority]++;
+		while(b->depth>0 || __higher_waiting(bus, priority)){
+			pthread_cond_wait(&b->cond, &b->mutex);
+		}
+		b->waiting[priority]--;
+	}
+	b->owner = pthread_self();
+	b->depth = 1;
+	b->flocked = 0;
+	pthread_mutex_unlock(&b->mutex);
+
+	// other processes, no need to hold the mutex since we own the bus now
+	if(b->initialized && b->ops->shared){
+		if(flock(b->fd, LOCK_EX|LOCK_NB)==-1){
+			contended = 1;
+			while(flock(b->fd, LOCK_EX)==-1){
+				if(errno==EINTR) continue;
+				perror("ERROR in rc_i2c arbiter, flock failed");
+				pthread_mutex_lock(&b->mutex);
+				b->depth = 0;
+				pthread_cond_broadcast(&b->cond);
+				pthread_mutex_unlock(&b->mutex);
+				return -1;
+			}
+		}
+		b->flocked = 1;
+	}
+	wait = rc_nanos_since_boot()-start;
+
+	pthread_mutex_lock(&b->mutex);
+	b->stats.acquisitions[priority]++;
+	if(contended){
+		b->stats.contended[priority]++;
+		b->stats.wait_total_ns[priority] += wait;
+		if(wait>b->stats.wait_max_ns[priority]) b->stats.wait_max_ns[priority] = wait;
+	}
+	pthread_mutex_unlock(&b->mutex);
+	return was_held;
+}
+
+
+/**
+ * Undoes one __acquire() by the calling thread and hands the bus to the
+ * next thread once the outermost claim is released.
+ *
+ * @return     1 if the calling thread held the bus, 0 if it did not
+ */
+static int __release(int bus)
+{
+	rc_i2c_state_t* b = &i2c[bus];
+
+	pthread_once(&arbiter_once, __arbiter_init);
+	pthread_mutex_lock(&b->mutex);
+	if(b->depth==0 || !pthread_equal(b->owner, pthread_self())){
+		pthread_mutex_unlock(&b->mutex);
+		return 0;
+	}
+	b->depth--;
+	if(b->depth==0){
+		if(b->flocked) flock(b->fd, LOCK_UN);
+		b->flocked = 0;
+		pthread_cond_broadcast(&b->cond);
+	}
+	pthread_mutex_unlock(&b->mutex);
+	return 1;
+}
+
+
+/**
+ * Fills in a pair of messages that write the register address and then read
+ * count bytes back after a repeated START, as one combined transaction.
+ */
+static void __fill_read_msgs(struct i2c_msg msgs[2], uint8_t devAddr, uint8_t* regAddr, uint16_t count, uint8_t* data)
+{
+	msgs[0].addr = devAddr;
+	msgs[0].flags = 0;
+	msgs[0].len = 1;
+	msgs[0].buf = regAddr;
+	msgs[1].addr = devAddr;
+	msgs[1].flags = I2C_M_RD;
+	msgs[1].len = count;
+	msgs[1].buf = data;
+	return;
+}
+
+
+static int __hw_open(int bus)
+{
+	char str[16];
+	snprintf(str, sizeof(str), "/dev/i2c-%d", bus);
+	return open(str, O_RDWR);
+}
+
+
+static int __hw_set_slave(int fd, uint8_t devAddr)
+{
+	return ioctl(fd, I2C_SLAVE, devAddr);
+}
+
+
+static int __hw_rdwr(__attribute__ ((unused)) int bus, int fd, struct i2c_msg* msgs, int nmsgs)
+{
+	struct i2c_rdwr_ioctl_data xfer;
+	xfer.msgs = msgs;
+	xfer.nmsgs = nmsgs;
+	if(unlikely(ioctl(fd, I2C_RDWR, &xfer)!=nmsgs)) return -1;
+	return 0;
+}
+
+
+// the slave address was already set on fd by __hw_set_slave
+static int __hw_write(__attribute__ ((unused)) int bus, int fd, __attribute__ ((unused)) uint8_t addr, uint8_t* data, size_t count)
+{
+	return write(fd, data, count);
+}
+
+
+// every process opens /dev/i2c-X separately so the arbiter flocks it
+static const rc_i2c_ops_t hw_ops = {
+	.shared		= 1,
+	.open		= __hw_open,
+	.set_slave	= __hw_set_slave,
+	.rdwr		= __hw_rdwr,
+	.write		= __hw_write,
+};
+
+
+/**
+ * Submits nmsgs messages as one combined transaction. The bus must already be
+ * claimed.
+ *
+ * @return     0 on success, -1 on failure
+ */
+static int __rdwr(int bus, struct i2c_msg* msgs, int nmsgs)
+{
+	return i2c[bus].ops->rdwr(bus, i2c[bus].fd, msgs, nmsgs);
+}
+
+
+/**
+ * Writes to the device at the current slave address. The bus must already be
+ * claimed.
+ *
+ * @return     number of bytes written or -1 on failure, like write()
+ */
+static int __write(int bus, uint8_t* data, size_t count)
+{
+	return i2c[bus].ops->write(bus, i2c[bus].fd, i2c[bus].devAddr, data, count);
+}
+
+
+/**
+ * Points the file descriptor at a new slave address.
+ */
+static int __set_slave(int bus, uint8_t devAddr)
+{
+	return i2c[bus].ops->set_slave(i2c[bus].fd, devAddr);
+}
+
+
 int rc_i2c_init(int bus, uint8_t devAddr)
 {
 	// sanity check
@@ -55,28 +280,37 @@ int rc_i2c_init(int bus, uint8_t devAddr)
 		return rc_i2c_set_device_address(bus, devAddr);
 	}
 
-	// lock the bus during this operation
-	i2c[bus].lock = 1;
-	i2c[bus].initialized = 0;
+	// lock the bus during this operation, another thread may have finished
+	// initializing it while we waited
+	if(unlikely(__acquire(bus, RC_I2C_PRIORITY_NORMAL)==-1)) return -1;
+	if(i2c[bus].initialized){
+		__release(bus);
+		return rc_i2c_set_device_address(bus, devAddr);
+	}
 
-	// open file descriptor
-	char str[16];
-	sprintf(str,"/dev/i2c-%d",bus);
-	i2c[bus].fd = open(str, O_RDWR);
+	// pick the backend and open file descriptor
+	i2c[bus].ops = __sim_pick_ops(&hw_ops, &__sim_i2c_ops);
+	if(unlikely(i2c[bus].ops==NULL)){
+		__release(bus);
+		return -1;
+	}
+	i2c[bus].fd = i2c[bus].ops->open(bus);
 	if(i2c[bus].fd==-1){
 		fprintf(stderr,"ERROR: in rc_i2c_init, failed to open /dev/i2c\n");
+		__release(bus);
 		return -1;
 	}
 
 	// set device adress
-	if(unlikely(ioctl(i2c[bus].fd, I2C_SLAVE, devAddr)<0)){
+	if(unlikely(__set_slave(bus, devAddr)<0)){
 		fprintf(stderr,"ERROR: in rc_i2c_init, ioctl slave address change failed\n");
+		close(i2c[bus].fd);
+		__release(bus);
 		return -1;
 	}
 	i2c[bus].devAddr = devAddr;
-	// return the lock state to previous state.
-	i2c[bus].lock = 0;
 	i2c[bus].initialized = 1;
+	__release(bus);
 	return 0;
 }
 
@@ -84,10 +318,14 @@ int rc_i2c_init(int bus, uint8_t devAddr)
 int rc_i2c_close(int bus)
 {
 	if(unlikely(__check_bus_range(bus))) return -1;
+	// wait for any transaction in progress to finish
+	if(unlikely(__acquire(bus, RC_I2C_PRIORITY_NORMAL)==-1)) return -1;
+	i2c[bus].initialized = 0;
+	if(i2c[bus].flocked) flock(i2c[bus].fd, LOCK_UN);
+	i2c[bus].flocked = 0;
 	close(i2c[bus].fd);
 	i2c[bus].devAddr = 0;
-	i2c[bus].initialized = 0;
-	i2c[bus].lock=0;
+	__release(bus);
 	return 0;
 }
 
@@ -105,12 +343,15 @@ int rc_i2c_set_device_address(int bus, uint8_t devAddr)
 	if(i2c[bus].devAddr == devAddr){
 		return 0;
 	}
-	// if not, change it with ioctl
-	if(unlikely(ioctl(i2c[bus].fd, I2C_SLAVE, devAddr)<0)){
+	// if not, change it with ioctl, never in the middle of a transaction
+	if(unlikely(__acquire(bus, RC_I2C_PRIORITY_NORMAL)==-1)) return -1;
+	if(unlikely(__set_slave(bus, devAddr)<0)){
 		fprintf(stderr,"ERROR: in rc_i2c_set_device_address, ioctl slave address change failed\n");
+		__release(bus);
 		return -1;
 	}
 	i2c[bus].devAddr = devAddr;
+	__release(bus);
 	return 0;
 }
 
@@ -123,7 +364,7 @@ int rc_i2c_read_byte(int bus, uint8_t regAddr, uint8_t *data)
 
 int rc_i2c_read_bytes(int bus, uint8_t regAddr, size_t count, uint8_t *data)
 {
-	int ret, old_lock;
+	struct i2c_msg msgs[2];
 
 	// sanity check
 	if(unlikely(__check_bus_range(bus))) return -1;
@@ -132,31 +373,48 @@ int rc_i2c_read_bytes(int bus, uint8_t regAddr, size_t count, uint8_t *data)
 		return -1;
 	}
 
-	// lock the bus during this operation, preserving old state to return to
-	old_lock = i2c[bus].lock;
-	i2c[bus].lock = 1;
-
-	// write register to device
-	ret = write(i2c[bus].fd, &regAddr, 1);
-	if(unlikely(ret!=1)){
-		fprintf(stderr,"ERROR: in rc_i2c_read_bytes, failed to write to bus\n");
-		i2c[bus].lock = old_lock;
+	if(unlikely(count==0 || count>UINT16_MAX)){
+		fprintf(stderr,"ERROR: in rc_i2c_read_bytes, count must be between 1 and %d\n", UINT16_MAX);
 		return -1;
 	}
 
-	// then read the response
-	ret = read(i2c[bus].fd, data, count);
-	if(unlikely((size_t)ret!=count)){
-		fprintf(stderr,"ERROR: in rc_i2c_read_bytes, received %d bytes from device, expected %d\n", ret, (int)count);
-		i2c[bus].lock = old_lock;
+	// claim the bus during this operation
+	if(unlikely(__acquire(bus, RC_I2C_PRIORITY_NORMAL)==-1)) return -1;
+
+	// write the register address then read the response after a repeated
+	// START, all in one system call
+	__fill_read_msgs(msgs, i2c[bus].devAddr, &regAddr, (uint16_t)count, data);
+	if(unlikely(__rdwr(bus, msgs, 2))){
+		fprintf(stderr,"ERROR: in rc_i2c_read_bytes, I2C_RDWR transaction failed\n");
+		__release(bus);
 		return -1;
 	}
 
-	// return the lock state to previous state.
-	i2c[bus].lock = old_lock;
-	return ret;
+	__release(bus);
+	return (int)count;
+}
+
+
+int rc_i2c_read_byte_quiet(int bus, uint8_t regAddr, uint8_t *data)
+{
+	struct i2c_msg msgs[2];
+	int ret;
 
+	// sanity check
+	if(unlikely(__check_bus_range(bus))) return -1;
+	if(unlikely(i2c[bus].initialized==0)){
+		fprintf(stderr,"ERROR: in rc_i2c_read_byte_quiet, bus not initialized yet\n");
+		return -1;
+	}
 
+	// same combined transaction as rc_i2c_read_bytes, just no message when
+	// the device doesn't answer
+	if(unlikely(__acquire(bus, RC_I2C_PRIORITY_NORMAL)==-1)) return -1;
+	__fill_read_msgs(msgs, i2c[bus].devAddr, &regAddr, 1, data);
+	ret = __rdwr(bus, msgs, 2);
+	__release(bus);
+	if(ret) return -1;
+	return 1;
 }
 
 
@@ -168,9 +426,9 @@ int rc_i2c_read_word(int bus, uint8_t regAddr, uint16_t *data)
 
 int rc_i2c_read_words(int bus, uint8_t regAddr, size_t count, uint16_t *data)
 {
-	int ret, old_lock;
+	struct i2c_msg msgs[2];
 	size_t i;
-	char buf[count*2];
+	uint8_t buf[count*2];
 
 	// sanity check
 	if(unlikely(__check_bus_range(bus))) return -1;
@@ -179,23 +437,20 @@ int rc_i2c_read_words(int bus, uint8_t regAddr, size_t count, uint16_t *data)
 		return -1;
 	}
 
-	// lock the bus during this operation
-	old_lock = i2c[bus].lock;
-	i2c[bus].lock = 1;
-
-	// write register to device
-	ret = write(i2c[bus].fd, &regAddr, 1);
-	if(unlikely(ret!=1)){
-		fprintf(stderr,"ERROR: in rc_i2c_read_words, failed to write to bus\n");
-		i2c[bus].lock = old_lock;
+	if(unlikely(count==0 || count*2>UINT16_MAX)){
+		fprintf(stderr,"ERROR: in rc_i2c_read_words, count must be between 1 and %d\n", UINT16_MAX/2);
 		return -1;
 	}
 
-	// then read the response
-	ret = read(i2c[bus].fd, buf, count*2);
-	if(ret!=(signed)(count*2)){
-		fprintf(stderr,"ERROR: in rc_i2c_read_words, received %d bytes, expected %zu\n", ret, count*2);
-		i2c[bus].lock = old_lock;
+	// claim the bus during this operation
+	if(unlikely(__acquire(bus, RC_I2C_PRIORITY_NORMAL)==-1)) return -1;
+
+	// write the register address then read the response after a repeated
+	// START, all in one system call
+	__fill_read_msgs(msgs, i2c[bus].devAddr, &regAddr, (uint16_t)(count*2), buf);
+	if(unlikely(__rdwr(bus, msgs, 2))){
+		fprintf(stderr,"ERROR: in rc_i2c_read_words, I2C_RDWR transaction failed\n");
+		__release(bus);
 		return -1;
 	}
 
@@ -204,8 +459,7 @@ int rc_i2c_read_words(int bus, uint8_t regAddr, size_t count, uint16_t *data)
 		data[i] = (((uint16_t)buf[i*2])<<8 | buf[(i*2)+1]);
 	}
 
-	// return the lock state to previous state.
-	i2c[bus].lock = old_lock;
+	__release(bus);
 	return 0;
 }
 
@@ -213,9 +467,89 @@ int rc_i2c_read_words(int bus, uint8_t regAddr, size_t count, uint16_t *data)
 
 
 
+int rc_i2c_read_multi(int bus, rc_i2c_read_t* reads, int n)
+{
+	struct i2c_msg msgs[2*RC_I2C_MAX_MULTI_READS];
+	int i;
+
+	// sanity check
+	if(unlikely(__check_bus_range(bus))) return -1;
+	if(unlikely(i2c[bus].initialized==0)){
+		fprintf(stderr,"ERROR: in rc_i2c_read_multi, bus not initialized yet\n");
+		return -1;
+	}
+	if(unlikely(reads==NULL)){
+		fprintf(stderr,"ERROR: in rc_i2c_read_multi, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(n<1 || n>RC_I2C_MAX_MULTI_READS)){
+		fprintf(stderr,"ERROR: in rc_i2c_read_multi, n must be between 1 and %d\n", RC_I2C_MAX_MULTI_READS);
+		return -1;
+	}
+	for(i=0;i<n;i++){
+		if(unlikely(reads[i].data==NULL || reads[i].count==0)){
+			fprintf(stderr,"ERROR: in rc_i2c_read_multi, read %d has no data buffer or zero count\n", i);
+			return -1;
+		}
+		// each message carries its own address so I2C_SLAVE is left alone
+		__fill_read_msgs(&msgs[2*i], reads[i].devAddr, &reads[i].regAddr, reads[i].count, reads[i].data);
+	}
+
+	// claim the bus during this operation
+	if(unlikely(__acquire(bus, RC_I2C_PRIORITY_NORMAL)==-1)) return -1;
+	if(unlikely(__rdwr(bus, msgs, 2*n))){
+		fprintf(stderr,"ERROR: in rc_i2c_read_multi, I2C_RDWR transaction failed\n");
+		__release(bus);
+		return -1;
+	}
+	__release(bus);
+	return 0;
+}
+
+
+int rc_i2c_write_to(int bus, uint8_t devAddr, uint8_t regAddr, size_t count, const uint8_t* data)
+{
+	struct i2c_msg msg;
+	uint8_t writeData[I2C_BUFFER_SIZE];
+
+	// sanity check
+	if(unlikely(__check_bus_range(bus))) return -1;
+	if(unlikely(i2c[bus].initialized==0)){
+		fprintf(stderr,"ERROR: in rc_i2c_write_to, bus not initialized yet\n");
+		return -1;
+	}
+	if(unlikely(count>=I2C_BUFFER_SIZE)){
+		fprintf(stderr,"ERROR: in rc_i2c_write_to, count must be less than %d\n", I2C_BUFFER_SIZE);
+		return -1;
+	}
+	if(unlikely(count>0 && data==NULL)){
+		fprintf(stderr,"ERROR: in rc_i2c_write_to, received NULL pointer\n");
+		return -1;
+	}
+
+	// register address then data as one addressed message
+	writeData[0] = regAddr;
+	if(count) memcpy(&writeData[1], data, count);
+	msg.addr = devAddr;
+	msg.flags = 0;
+	msg.len = count+1;
+	msg.buf = writeData;
+
+	// claim the bus during this operation
+	if(unlikely(__acquire(bus, RC_I2C_PRIORITY_NORMAL)==-1)) return -1;
+	if(unlikely(__rdwr(bus, &msg, 1))){
+		fprintf(stderr,"ERROR: in rc_i2c_write_to, I2C_RDWR transaction failed\n");
+		__release(bus);
+		return -1;
+	}
+	__release(bus);
+	return 0;
+}
+
+
 int rc_i2c_write_bytes(int bus, uint8_t regAddr, size_t count, uint8_t* data)
 {
-	int ret, old_lock;
+	int ret;
 	size_t i;
 	uint8_t writeData[count+1];
 
@@ -226,31 +560,29 @@ int rc_i2c_write_bytes(int bus, uint8_t regAddr, size_t count, uint8_t* data)
 		return -1;
 	}
 
-	// lock the bus during this operation
-	old_lock = i2c[bus].lock;
-	i2c[bus].lock = 1;
+	// claim the bus during this operation
+	if(unlikely(__acquire(bus, RC_I2C_PRIORITY_NORMAL)==-1)) return -1;
 
 	// assemble array to send, starting with the register address
 	writeData[0] = regAddr;
 	for(i=0; i<count; i++) writeData[i+1]=data[i];
 
 	// send the bytes
-	ret = write(i2c[bus].fd, writeData, count+1);
+	ret = __write(bus, writeData, count+1);
 	// write should have returned the correct # bytes written
 	if(unlikely(ret!=(signed)(count+1))){
 		fprintf(stderr,"ERROR in rc_i2c_write_bytes, bus wrote %d bytes, expected %zu\n", ret, count+1);
-		i2c[bus].lock = old_lock;
+		__release(bus);
 		return -1;
 	}
-	// return the lock state to previous state.
-	i2c[bus].lock = old_lock;
+	__release(bus);
 	return 0;
 }
 
 
 int rc_i2c_write_byte(int bus, uint8_t regAddr, uint8_t data)
 {
-	int ret, old_lock;
+	int ret;
 	uint8_t writeData[2];
 
 	// sanity check
@@ -260,32 +592,30 @@ int rc_i2c_write_byte(int bus, uint8_t regAddr, uint8_t data)
 		return -1;
 	}
 
-	// lock the bus during this operation
-	old_lock = i2c[bus].lock;
-	i2c[bus].lock = 1;
+	// claim the bus during this operation
+	if(unlikely(__acquire(bus, RC_I2C_PRIORITY_NORMAL)==-1)) return -1;
 
 	// assemble array to send, starting with the register address
 	writeData[0] = regAddr;
 	writeData[1] = data;
 
 	// send the bytes
-	ret = write(i2c[bus].fd, writeData, 2);
+	ret = __write(bus, writeData, 2);
 
 	// write should have returned the correct # bytes written
 	if(unlikely(ret!=2)){
 		fprintf(stderr,"ERROR: in rc_i2c_write_byte, system write returned %d, expected 2\n", ret);
-		i2c[bus].lock = old_lock;
+		__release(bus);
 		return -1;
 	}
-	// return the lock state to previous state.
-	i2c[bus].lock = old_lock;
+	__release(bus);
 	return 0;
 }
 
 
 int rc_i2c_write_words(int bus, uint8_t regAddr, size_t count, uint16_t* data)
 {
-	int ret,old_lock;
+	int ret;
 	size_t i;
 	uint8_t writeData[(count*2)+1];
 
@@ -296,9 +626,8 @@ int rc_i2c_write_words(int bus, uint8_t regAddr, size_t count, uint16_t* data)
 		return -1;
 	}
 
-	// lock the bus during this operation
-	old_lock = i2c[bus].lock;
-	i2c[bus].lock = 1;
+	// claim the bus during this operation
+	if(unlikely(__acquire(bus, RC_I2C_PRIORITY_NORMAL)==-1)) return -1;
 
 	// assemble bytes to send
 	writeData[0] = regAddr;
@@ -307,21 +636,20 @@ int rc_i2c_write_words(int bus, uint8_t regAddr, size_t count, uint16_t* data)
 		writeData[(i*2)+2] = (uint8_t)(data[i] & 0xFF);
 	}
 
-	ret = write(i2c[bus].fd, writeData, (count*2)+1);
+	ret = __write(bus, writeData, (count*2)+1);
 	if(unlikely(ret!=(signed)(count*2)+1)){
 		fprintf(stderr,"ERROR: in rc_i2c_write_words, system write returned %d, expected %zu\n", ret, (count*2)+1);
-		i2c[bus].lock = old_lock;
+		__release(bus);
 		return -1;
 	}
-	// return the lock state to previous state.
-	i2c[bus].lock = old_lock;
+	__release(bus);
 	return 0;
 }
 
 
 int rc_i2c_write_word(int bus, uint8_t regAddr, uint16_t data)
 {
-	int ret,old_lock;
+	int ret;
 	uint8_t writeData[3];
 
 	// sanity check
@@ -331,23 +659,21 @@ int rc_i2c_write_word(int bus, uint8_t regAddr, uint16_t data)
 		return -1;
 	}
 
-	// lock the bus during this operation
-	old_lock = i2c[bus].lock;
-	i2c[bus].lock = 1;
+	// claim the bus during this operation
+	if(unlikely(__acquire(bus, RC_I2C_PRIORITY_NORMAL)==-1)) return -1;
 
 	// assemble bytes to send from data casted as uint8_t*
 	writeData[0] = regAddr;
 	writeData[1] = (uint8_t)(data >> 8);
 	writeData[2] = (uint8_t)(data & 0xFF);
 
-	ret = write(i2c[bus].fd, writeData, 3);
+	ret = __write(bus, writeData, 3);
 	if(unlikely(ret!=3)){
 		fprintf(stderr,"ERROR: in rc_i2c_write_word, system write returned %d, expected 3\n", ret);
-		i2c[bus].lock = old_lock;
+		__release(bus);
 		return -1;
 	}
-	// return the lock state to previous state.
-	i2c[bus].lock = old_lock;
+	__release(bus);
 	return 0;
 }
 
@@ -369,21 +695,19 @@ int rc_i2c_send_bytes(int bus, size_t count, uint8_t* data)
 		return -1;
 	}
 
-	// lock the bus during this operation
-	int old_lock= i2c[bus].lock;
-	i2c[bus].lock = 1;
+	// claim the bus during this operation
+	if(unlikely(__acquire(bus, RC_I2C_PRIORITY_NORMAL)==-1)) return -1;
 
 	// send the bytes
-	ret = write(i2c[bus].fd, data, count);
+	ret = __write(bus, data, count);
 	// write should have returned the correct # bytes written
 	if(ret!=(signed)count){
 		fprintf(stderr,"ERROR: in rc_i2c_send_bytes, system write returned %d, expected %zu\n", ret, count);
-		i2c[bus].lock = old_lock;
+		__release(bus);
 		return -1;
 	}
 
-	// return the lock state to previous state.
-	i2c[bus].lock = old_lock;
+	__release(bus);
 
 	return 0;
 }
@@ -394,27 +718,64 @@ int rc_i2c_send_bytes(int bus, size_t count, uint8_t* data)
 
 
 int rc_i2c_lock_bus(int bus)
+{
+	return rc_i2c_lock_bus_priority(bus, RC_I2C_PRIORITY_NORMAL);
+}
+
+
+int rc_i2c_lock_bus_priority(int bus, rc_i2c_priority_t priority)
 {
 	if(unlikely(__check_bus_range(bus))) return -1;
-	int ret=i2c[bus].lock;
-	i2c[bus].lock=1;
-	return ret;
+	if(unlikely(priority<RC_I2C_PRIORITY_LOW || priority>RC_I2C_PRIORITY_HIGH)){
+		fprintf(stderr,"ERROR: in rc_i2c_lock_bus_priority, invalid priority\n");
+		return -1;
+	}
+	return __acquire(bus, priority);
 }
 
 
 int rc_i2c_unlock_bus(int bus)
 {
 	if(unlikely(__check_bus_range(bus))) return -1;
-	int ret=i2c[bus].lock;
-	i2c[bus].lock=0;
-	return ret;
+	return __release(bus);
 }
 
 
 int rc_i2c_get_lock(int bus)
 {
+	int ret;
 	if(unlikely(__check_bus_range(bus))) return -1;
-	return i2c[bus].lock;
+	pthread_once(&arbiter_once, __arbiter_init);
+	pthread_mutex_lock(&i2c[bus].mutex);
+	ret = i2c[bus].depth>0;
+	pthread_mutex_unlock(&i2c[bus].mutex);
+	return ret;
+}
+
+
+int rc_i2c_get_stats(int bus, rc_i2c_stats_t* stats)
+{
+	if(unlikely(__check_bus_range(bus))) return -1;
+	if(unlikely(stats==NULL)){
+		fprintf(stderr,"ERROR: in rc_i2c_get_stats, received NULL pointer\n");
+		return -1;
+	}
+	pthread_once(&arbiter_once, __arbiter_init);
+	pthread_mutex_lock(&i2c[bus].mutex);
+	*stats = i2c[bus].stats;
+	pthread_mutex_unlock(&i2c[bus].mutex);
+	return 0;
+}
+
+
+int rc_i2c_reset_stats(int bus)
+{
+	if(unlikely(__check_bus_range(bus))) return -1;
+	pthread_once(&arbiter_once, __arbiter_init);
+	pthread_mutex_lock(&i2c[bus].mutex);
+	memset(&i2c[bus].stats, 0, sizeof(rc_i2c_stats_t));
+	pthread_mutex_unlock(&i2c[bus].mutex);
+	return 0;
 }
 
 
@@ -15,6 +15,7 @@
 #include <glob.h>
 #include <rc/pwm.h>
 #include <rc/time.h>
+#include "../sim/sim_common.h"
 
 #define MIN_HZ 1
 #define MAX_HZ 1000000000
@@ -34,6 +35,7 @@ static int dutyA_fd[3];			// pointers to duty cycle file descriptor
 static int dutyB_fd[3];			// pointers to duty cycle file descriptor
 static unsigned int period_ns[3];	// one period per subsystem
 static int init_flag[3] = {0,0,0};
+static const rc_pwm_ops_t* ops; // hardware or simulated, picked by rc_pwm_init
 
 // The ti pwm driver has gone through several revisions and it presents devices
 // in the file system differently every version. For example, subsytem 2 channel A
@@ -192,7 +194,11 @@ static int __unexport_channels(int ss)
 }
 
 
-int rc_pwm_init(int ss, int frequency)
+/**
+ * exports and sets up both channels of a subsystem through sysfs, duty starts
+ * at 0
+ */
+static int __hw_init(int ss, unsigned int period)
 {
 	int periodA_fd; // pointers to frequency file descriptor
 	int periodB_fd;
@@ -203,16 +209,6 @@ int rc_pwm_init(int ss, int frequency)
 	char buf[MAXBUF];
 	int len;
 
-	// sanity checks
-	if(ss<0 || ss>2){
-		fprintf(stderr,"ERROR in rc_pwm_init, PWM subsystem must be 0 1 or 2\n");
-		return -1;
-	}
-	if(frequency<MIN_HZ || frequency>MAX_HZ){
-		fprintf(stderr,"ERROR in rc_pwm_init, frequency must be between %dHz and %dHz\n", MIN_HZ, MAX_HZ);
-		return -1;
-	}
-
 	// unexport then export channels first
 	if(__unexport_channels(ss)==-1) return -1;
 	if(__export_channels(ss)==-1) return -1;
@@ -304,8 +300,7 @@ int rc_pwm_init(int ss, int frequency)
 	}
 
 	// set the period in nanoseconds
-	period_ns[ss] = 1000000000/frequency;
-	len = snprintf(buf, sizeof(buf), "%d", period_ns[ss]);
+	len = snprintf(buf, sizeof(buf), "%d", period);
 	if(unlikely(write(periodA_fd, buf, len)==-1)){
 		perror("ERROR in rc_pwm_init, failed to write to channel A period fd");
 		return -1;
@@ -353,26 +348,19 @@ int rc_pwm_init(int ss, int frequency)
 	close(polarityA_fd);
 	close(polarityB_fd);
 
-	// everything successful
-	init_flag[ss] = 1;
 	return 0;
 }
 
-int rc_pwm_cleanup(int ss)
+
+/**
+ * sets duty to 0, disables both channels of a subsystem and unexports them
+ */
+static int __hw_cleanup(int ss)
 {
 	int enableA_fd;
 	int enableB_fd;
 	char buf[MAXBUF];
 
-	// sanity check
-	if(unlikely(ss<0 || ss>2)){
-		fprintf(stderr,"ERROR in rc_pwm_close, subsystem must be between 0 and 2\n");
-		return -1;
-	}
-	if(init_flag[ss]==0){
-		return 0;
-	}
-
 	// now open enable FDs
 	if(mode==0)	snprintf(buf, sizeof(buf), SYS_DIR "/pwmchip%d/pwm0/enable", ss*2); // mode 0
 	else		snprintf(buf, sizeof(buf), SYS_DIR "/pwm-%d:0/enable", ssindex[ss]); // mode 1
@@ -419,33 +407,18 @@ int rc_pwm_cleanup(int ss)
 	// has been closed
 	__unexport_channels(ss);
 
-	init_flag[ss] = 0;
 	return 0;
-
 }
 
 
-int rc_pwm_set_duty(int ss, char ch, double duty)
+/**
+ * writes the duty of one channel to its sysfs file
+ */
+static int __hw_set_duty_ns(int ss, char ch, unsigned int duty_ns)
 {
-	int len, ret, duty_ns;
+	int len, ret;
 	char buf[MAXBUF];
 
-	// sanity checks
-	if(unlikely(ss<0 || ss>2)){
-		fprintf(stderr,"ERROR in rc_pwm_set_duty, PWM subsystem must be between 0 and 2\n");
-		return -1;
-	}
-	if(unlikely(init_flag[ss]==0)){
-		fprintf(stderr, "ERROR in rc_pwm_set_duty, subsystem %d not initialized yet\n", ss);
-		return -1;
-	}
-	if(unlikely(duty > 1.0 || duty<0.0)){
-		fprintf(stderr,"ERROR in rc_pwm_set_duty, duty must be between 0.0f & 1.0f\n");
-		return -1;
-	}
-
-	// set the duty
-	duty_ns = duty*period_ns[ss];
 	len = snprintf(buf, sizeof(buf), "%d", duty_ns);
 	switch(ch){
 	case 'A':
@@ -468,43 +441,92 @@ int rc_pwm_set_duty(int ss, char ch, double duty)
 }
 
 
-int rc_pwm_set_duty_ns(int ss, char ch, unsigned int duty_ns)
+static const rc_pwm_ops_t hw_ops = {
+	.init		= __hw_init,
+	.cleanup	= __hw_cleanup,
+	.set_duty_ns	= __hw_set_duty_ns,
+};
+
+
+int rc_pwm_init(int ss, int frequency)
 {
-	int len, ret;
-	char buf[MAXBUF];
+	// sanity checks
+	if(ss<0 || ss>2){
+		fprintf(stderr,"ERROR in rc_pwm_init, PWM subsystem must be 0 1 or 2\n");
+		return -1;
+	}
+	if(frequency<MIN_HZ || frequency>MAX_HZ){
+		fprintf(stderr,"ERROR in rc_pwm_init, frequency must be between %dHz and %dHz\n", MIN_HZ, MAX_HZ);
+		return -1;
+	}
+
+	ops = __sim_pick_ops(&hw_ops, &__sim_pwm_ops);
+	if(unlikely(ops==NULL)) return -1;
+	period_ns[ss] = 1000000000/frequency;
+	if(unlikely(ops->init(ss, period_ns[ss]))) return -1;
+
+	// everything successful
+	init_flag[ss] = 1;
+	return 0;
+}
+
+int rc_pwm_cleanup(int ss)
+{
+	// sanity check
+	if(unlikely(ss<0 || ss>2)){
+		fprintf(stderr,"ERROR in rc_pwm_close, subsystem must be between 0 and 2\n");
+		return -1;
+	}
+	if(init_flag[ss]==0){
+		return 0;
+	}
+	if(unlikely(ops->cleanup(ss))) return -1;
+	init_flag[ss] = 0;
+	return 0;
+
+}
+
+
+int rc_pwm_set_duty(int ss, char ch, double duty)
+{
+	int duty_ns;
 
 	// sanity checks
 	if(unlikely(ss<0 || ss>2)){
-		fprintf(stderr,"ERROR in rc_pwm_set_duty_ns, PWM subsystem must be between 0 and 2\n");
+		fprintf(stderr,"ERROR in rc_pwm_set_duty, PWM subsystem must be between 0 and 2\n");
 		return -1;
 	}
 	if(unlikely(init_flag[ss]==0)){
-		fprintf(stderr, "ERROR in rc_pwm_set_duty_ns, subsystem %d not initialized yet\n", ss);
+		fprintf(stderr, "ERROR in rc_pwm_set_duty, subsystem %d not initialized yet\n", ss);
 		return -1;
 	}
-	if(unlikely(duty_ns>period_ns[ss])){
-		fprintf(stderr,"ERROR in rc_pwm_set_duty_ns, duty must be between 0 & %d for current frequency\n", period_ns[ss]);
+	if(unlikely(duty > 1.0 || duty<0.0)){
+		fprintf(stderr,"ERROR in rc_pwm_set_duty, duty must be between 0.0f & 1.0f\n");
 		return -1;
 	}
 
 	// set the duty
-	len = snprintf(buf, sizeof(buf), "%d", duty_ns);
-	switch(ch){
-	case 'A':
-		ret=write(dutyA_fd[ss], buf, len);
-		break;
-	case 'B':
-		ret=write(dutyB_fd[ss], buf, len);
-		break;
-	default:
-		fprintf(stderr,"ERROR in rc_pwm_set_duty_ns, pwm channel must be 'A' or 'B'\n");
+	duty_ns = duty*period_ns[ss];
+	return ops->set_duty_ns(ss, ch, duty_ns);
+}
+
+
+int rc_pwm_set_duty_ns(int ss, char ch, unsigned int duty_ns)
+{
+	// sanity checks
+	if(unlikely(ss<0 || ss>2)){
+		fprintf(stderr,"ERROR in rc_pwm_set_duty_ns, PWM subsystem must be between 0 and 2\n");
 		return -1;
 	}
-
-	// make sure write worked
-	if(unlikely(ret==-1)){
-		perror("ERROR in rc_pwm_set_duty_ns, failed to write to duty_cycle fd");
+	if(unlikely(init_flag[ss]==0)){
+		fprintf(stderr, "ERROR in rc_pwm_set_duty_ns, subsystem %d not initialized yet\n", ss);
 		return -1;
 	}
-	return 0;
+	if(unlikely(duty_ns>period_ns[ss])){
+		fprintf(stderr,"ERROR in rc_pwm_set_duty_ns, duty must be between 0 & %d for current frequency\n", period_ns[ss]);
+		return -1;
+	}
+
+	// set the duty
+	return ops->set_duty_ns(ss, ch, duty_ns);
 }
@@ -18,6 +18,7 @@
 #include <rc/gpio.h>
 #include <rc/pinmux.h>
 #include <rc/spi.h>
+#include "../sim/sim_common.h"
 
 #define MAX_BUS 5 // reasonable max spi bus should cover most platforms
 
@@ -45,12 +46,11 @@ static rc_spi_state_t state[MAX_BUS+1];
 // simple opening of an FD for particular bus and slave. Tries to handle the
 // case where old BeagleBone kernels enumerate spi1 as spidev2.
 // returns the opened file descriptor
-static int __open_fd(int bus, int slave)
+static int __hw_open(int bus, int slave)
 {
 	char buf[32];
 	int ret;
 
-
 	snprintf(buf,sizeof(buf), SPI_BASE_PATH "%d.%d",bus, slave);
 	// open file descriptor
 	ret=open(buf, O_RDWR);
@@ -72,6 +72,55 @@ static int __open_fd(int bus, int slave)
 }
 
 
+static int __hw_config(int fd, unsigned long request, void* arg)
+{
+	return ioctl(fd, request, arg);
+}
+
+
+static int __hw_message(__attribute__ ((unused)) int bus, __attribute__ ((unused)) int slave, int fd, struct spi_ioc_transfer* xfer, int n)
+{
+	return ioctl(fd, SPI_IOC_MESSAGE(n), xfer);
+}
+
+
+static const rc_spi_ops_t hw_ops = {
+	.open		= __hw_open,
+	.config		= __hw_config,
+	.message	= __hw_message,
+};
+
+// hardware or simulated, picked when a bus is initialized
+static const rc_spi_ops_t* ops = &hw_ops;
+
+
+// picks the backend and opens the bus, returns the file descriptor
+static int __open_fd(int bus, int slave)
+{
+	ops = __sim_pick_ops(&hw_ops, &__sim_spi_ops);
+	if(ops==NULL){
+		ops = &hw_ops;
+		return -1;
+	}
+	return ops->open(bus, slave);
+}
+
+
+// bus configuration ioctls
+static int __config(int fd, unsigned long request, void* arg)
+{
+	return ops->config(fd, request, arg);
+}
+
+
+// sends n transfers as one message, returns the number of bytes transferred
+// like the ioctl
+static int __message(int bus, int slave, struct spi_ioc_transfer* xfer, int n)
+{
+	return ops->message(bus, slave, state[bus].fd[slave], xfer, n);
+}
+
+
 int rc_spi_init_auto_slave(int bus, int slave, int bus_mode, int speed_hz)
 {
 	int bits = RC_SPI_BITS_PER_WORD;
@@ -116,17 +165,17 @@ int rc_spi_init_auto_slave(int bus, int slave, int bus_mode, int speed_hz)
 	if(fd==-1) return -1;
 
 	// set settings
-	if(ioctl(fd, SPI_IOC_WR_MODE, &bus_mode)==-1){
+	if(__config(fd, SPI_IOC_WR_MODE, &bus_mode)==-1){
 		perror("ERROR in rc_spi_init_auto_slave setting spi mode");
 		close(fd);
 		return -1;
 	}
-	if(ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits)==-1){
+	if(__config(fd, SPI_IOC_WR_BITS_PER_WORD, &bits)==-1){
 		perror("ERROR in rc_spi_init_auto_slave setting bits per word");
 		close(fd);
 		return -1;
 	}
-	if(ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed_hz)==-1){
+	if(__config(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed_hz)==-1){
 		perror("ERROR in rc_spi_init_auto_slave setting max speed hz");
 		close(fd);
 		return -1;
@@ -212,17 +261,17 @@ int rc_spi_init_manual_slave(int bus, int slave, int bus_mode, int speed_hz, int
 		if(fd==-1) return -1;
 
 		// set settings
-		if(ioctl(fd, SPI_IOC_WR_MODE, &bus_mode)==-1){
+		if(__config(fd, SPI_IOC_WR_MODE, &bus_mode)==-1){
 			perror("ERROR in rc_spi_init_manual_slave setting spi mode");
 			close(fd);
 			return -1;
 		}
-		if(ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits)==-1){
+		if(__config(fd, SPI_IOC_WR_BITS_PER_WORD, &bits)==-1){
 			perror("ERROR in rc_spi_init_manual_slave setting bits per word");
 			close(fd);
 			return -1;
 		}
-		if(ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed_hz)==-1){
+		if(__config(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed_hz)==-1){
 			perror("ERROR in rc_spi_init_manual_slave setting max speed hz");
 			close(fd);
 			return -1;
@@ -400,7 +449,7 @@ int rc_spi_transfer(int bus, int slave, uint8_t* tx_data, size_t tx_bytes, uint8
 	xfer.cs_change = 1;
 
 	// do ioctl transfer
-	ret=ioctl(state[bus].fd[slave], SPI_IOC_MESSAGE(1), &xfer);
+	ret=__message(bus, slave, &xfer, 1);
 	if(ret==-1){
 		perror("ERROR in rc_spi_transfer");
 		return -1;
@@ -442,7 +491,7 @@ int rc_spi_write(int bus, int slave, uint8_t* data, size_t bytes)
 	xfer.cs_change = 1;
 
 	// send
-	ret=ioctl(state[bus].fd[slave], SPI_IOC_MESSAGE(1), &xfer);
+	ret=__message(bus, slave, &xfer, 1);
 	if(ret==-1){
 		perror("ERROR in rc_spi_write");
 		return -1;
@@ -484,7 +533,7 @@ int rc_spi_read(int bus, int slave, uint8_t* data, size_t bytes)
 	xfer.cs_change = 1;
 
 	// read
-	ret=ioctl(state[bus].fd[slave], SPI_IOC_MESSAGE(1), &xfer);
+	ret=__message(bus, slave, &xfer, 1);
 	if(ret==-1){
 		perror("ERROR in rc_spi_read");
 		return -1;
@@ -493,3 +542,85 @@ int rc_spi_read(int bus, int slave, uint8_t* data, size_t bytes)
 }
 
 
+int rc_spi_transfer_multi(int bus, int slave, const rc_spi_xfer_t* xfers, int n)
+{
+	int i, start, ret, total;
+	struct spi_ioc_transfer xfer[RC_SPI_MAX_XFERS];
+
+	// sanity checks
+	if(bus<0 || bus>MAX_BUS){
+		fprintf(stderr,"ERROR in rc_spi_transfer_multi, bus must be between 0 and %d\n", MAX_BUS);
+		return -1;
+	}
+	if(slave<0 || slave>=N_SS){
+		fprintf(stderr,"ERROR in rc_spi_transfer_multi, slave must be between 0 and %d\n", N_SS-1);
+		return -1;
+	}
+	if(state[bus].init[slave]==0){
+		fprintf(stderr,"ERROR in rc_spi_transfer_multi, need to initialize first\n");
+		return -1;
+	}
+	if(xfers==NULL){
+		fprintf(stderr,"ERROR in rc_spi_transfer_multi, received NULL pointer\n");
+		return -1;
+	}
+	if(n<1 || n>RC_SPI_MAX_XFERS){
+		fprintf(stderr,"ERROR in rc_spi_transfer_multi, n must be between 1 and %d\n", RC_SPI_MAX_XFERS);
+		return -1;
+	}
+
+	// fill in send structs
+	memset(xfer, 0, sizeof(xfer)); // zero-initialize per docs
+	for(i=0;i<n;i++){
+		if(xfers[i].len<1){
+			fprintf(stderr,"ERROR in rc_spi_transfer_multi, len of transfer %d must be >=1\n", i);
+			return -1;
+		}
+		if(xfers[i].speed_hz!=0 && (xfers[i].speed_hz>RC_SPI_MAX_SPEED || xfers[i].speed_hz<RC_SPI_MIN_SPEED)){
+			fprintf(stderr,"ERROR in rc_spi_transfer_multi, speed_hz must be 0 or between %d & %d\n", RC_SPI_MIN_SPEED, RC_SPI_MAX_SPEED);
+			return -1;
+		}
+		xfer[i].tx_buf = (unsigned long) xfers[i].tx;
+		xfer[i].rx_buf = (unsigned long) xfers[i].rx;
+		xfer[i].len = xfers[i].len;
+		xfer[i].speed_hz = xfers[i].speed_hz ? xfers[i].speed_hz : state[bus].speed[slave];
+		xfer[i].delay_usecs = xfers[i].delay_us;
+		xfer[i].bits_per_word = RC_SPI_BITS_PER_WORD;
+		// on the last transfer the driver reads cs_change as leave the
+		// slave selected after the message, which we never want
+		xfer[i].cs_change = (i<n-1 && xfers[i].cs_change) ? 1 : 0;
+	}
+
+	// automatic slaves are selected by the driver, one system call does it
+	if(state[bus].ss_mode[slave]!=SS_MODE_MANUAL){
+		ret=__message(bus, slave, xfer, n);
+		if(ret==-1){
+			perror("ERROR in rc_spi_transfer_multi");
+			return -1;
+		}
+		return ret;
+	}
+
+	// manual slaves need the gpio toggled wherever cs_change is set, so
+	// send each run of transfers between deselects as its own message
+	total = 0;
+	start = 0;
+	for(i=0;i<n;i++){
+		if(i<n-1 && xfer[i].cs_change==0) continue;
+		xfer[i].cs_change = 0;
+		if(rc_gpio_set_value(state[bus].chip[slave], state[bus].pin[slave], 0)==-1){
+			fprintf(stderr,"ERROR in rc_spi_transfer_multi writing to gpio pin\n");
+			return -1;
+		}
+		ret=__message(bus, slave, &xfer[start], i-start+1);
+		if(ret==-1) perror("ERROR in rc_spi_transfer_multi");
+		if(rc_gpio_set_value(state[bus].chip[slave], state[bus].pin[slave], 1)==-1){
+			fprintf(stderr,"ERROR in rc_spi_transfer_multi writing to gpio pin\n");
+			return -1;
+		}
+		if(ret==-1) return -1;
+		total += ret;
+		start = i+1;
+	}
+	return total;
+}
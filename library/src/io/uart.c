@@ -17,8 +17,12 @@
 #include <string.h>
 #include <sys/ioctl.h>
 #include <math.h>
+#include <linux/serial.h> // for ASYNC_LOW_LATENCY
 
 #include <rc/uart.h>
+#include <rc/time.h>
+#include "../sim/sim_common.h"
+#include "uart_baud.h"
 
 #define MAX_BUS		16
 #define STRING_BUF	64
@@ -32,12 +36,28 @@ static float rc_uart_bus_timeout_s[MAX_BUS+1]; // user-requested timeout in seco
 static int   rc_uart_shutdown_flag[MAX_BUS+1];
 
 
+static int __hw_path(int bus, char* path, size_t len)
+{
+	snprintf(path, len, "/dev/ttyO%d", bus);
+	return 0;
+}
+
+
+// a simulated bus is the slave side of a pseudo terminal that behaves the same
+// as a real tty from there on, so only the path differs
+static const rc_uart_ops_t hw_ops = {
+	.path		= __hw_path,
+};
+
+
 int rc_uart_init(int bus, int baudrate, float timeout_s, int canonical_en, int stop_bits, int parity_en)
 {
+	const rc_uart_ops_t* ops;
 	int tmpfd, tenths;
 	char buf[STRING_BUF];
 	struct termios config;
 	speed_t speed; //baudrate
+	int other = 0; // 1 if baudrate has no Bxxx constant
 
 	// sanity checks
 	if(bus<0 || bus>MAX_BUS){
@@ -108,15 +128,23 @@ int rc_uart_init(int bus, int baudrate, float timeout_s, int canonical_en, int s
 		speed=B50;
 		break;
 	default:
-		fprintf(stderr,"ERROR: int rc_uart_init, invalid baudrate. Please use a standard baudrate\n");
-		return -1;
+		// anything else such as 100000 for SBUS or 420000 for CRSF is
+		// set with BOTHER once the standard settings are in place
+		if(baudrate<=0){
+			fprintf(stderr,"ERROR: int rc_uart_init, invalid baudrate\n");
+			return -1;
+		}
+		speed=B38400;
+		other=1;
+		break;
 	}
 
 	// close the bus in case it was already open
 	rc_uart_close(bus);
 
 	// open file descriptor for blocking reads
-	snprintf(buf,sizeof(buf),"/dev/ttyO%d",bus);
+	ops = __sim_pick_ops(&hw_ops, &__sim_uart_ops);
+	if(ops==NULL || ops->path(bus, buf, sizeof(buf))) return -1;
 	tmpfd = open(buf, O_RDWR | O_NOCTTY | O_NDELAY);
 	if(tmpfd==-1){
 		perror("ERROR: int rc_uart_init while opening file descriptor");
@@ -181,6 +209,10 @@ int rc_uart_init(int bus, int baudrate, float timeout_s, int canonical_en, int s
 		close(rc_uart_fd[bus]);
 		return -1;
 	}
+	if(other && __uart_set_baud_other(tmpfd, baudrate)){
+		close(tmpfd);
+		return -1;
+	}
 	if(tcflush(tmpfd,TCIOFLUSH)==-1){
 		perror("ERROR: in rc_uart_init calling tcflush");
 		close(tmpfd);
@@ -206,6 +238,59 @@ int rc_uart_init(int bus, int baudrate, float timeout_s, int canonical_en, int s
 }
 
 
+int rc_uart_set_low_latency(int bus, int en)
+{
+	struct serial_struct serial;
+	struct termios config;
+
+	// sanity checks
+	if(bus<0 || bus>MAX_BUS){
+		fprintf(stderr,"ERROR: in rc_uart_set_low_latency, bus must be between 0 & %d\n", MAX_BUS);
+		return -1;
+	}
+	if(rc_uart_fd[bus]==0){
+		fprintf(stderr,"ERROR: in rc_uart_set_low_latency, uart%d must be initialized first\n", bus);
+		return -1;
+	}
+
+	// ask the serial driver not to hold on to received bytes, drivers
+	// without a serial_struct such as a pseudo terminal have nothing to set
+	if(ioctl(rc_uart_fd[bus], TIOCGSERIAL, &serial)==0){
+		if(en) serial.flags |= ASYNC_LOW_LATENCY;
+		else serial.flags &= ~ASYNC_LOW_LATENCY;
+		if(ioctl(rc_uart_fd[bus], TIOCSSERIAL, &serial)==-1){
+			perror("ERROR: in rc_uart_set_low_latency calling TIOCSSERIAL");
+			return -1;
+		}
+	}
+	else if(errno!=ENOTTY && errno!=EINVAL){
+		perror("ERROR: in rc_uart_set_low_latency calling TIOCGSERIAL");
+		return -1;
+	}
+
+	// no inter-byte timer and a fixed VMIN of 1 so termios never has to change
+	// again while reading, rc_uart_read_bytes loops until it has everything.
+	// Going back restores what rc_uart_init set.
+	if(tcgetattr(rc_uart_fd[bus], &config)==-1){
+		perror("ERROR: in rc_uart_set_low_latency calling tcgetattr");
+		return -1;
+	}
+	if(en){
+		config.c_cc[VMIN] = 1;
+		config.c_cc[VTIME] = 0;
+	}
+	else{
+		config.c_cc[VMIN] = MAX_READ_LEN;
+		config.c_cc[VTIME] = (rc_uart_bus_timeout_s[bus]*10)+1;
+	}
+	if(tcsetattr(rc_uart_fd[bus], TCSANOW, &config)==-1){
+		perror("ERROR: in rc_uart_set_low_latency calling tcsetattr");
+		return -1;
+	}
+	return 0;
+}
+
+
 int rc_uart_close(int bus)
 {
 	// sanity checks
@@ -281,8 +366,15 @@ int rc_uart_write(int bus, uint8_t* data, size_t bytes)
 
 
 int rc_uart_read_bytes(int bus, uint8_t* buf, size_t bytes)
+{
+	return rc_uart_read_bytes_stamped(bus, buf, bytes, NULL);
+}
+
+
+int rc_uart_read_bytes_stamped(int bus, uint8_t* buf, size_t bytes, uint64_t* rx_ns)
 {
 	int bytes_to_read, ret;
+	uint64_t stamp;
 	// sanity checks
 	if(bus<0 || bus>MAX_BUS){
 		fprintf(stderr,"ERROR: uart bus must be between 0 & %d\n", MAX_BUS);
@@ -331,6 +423,7 @@ int rc_uart_read_bytes(int bus, uint8_t* buf, size_t bytes)
 		FD_ZERO(&set); /* clear the set */
 		FD_SET(rc_uart_fd[bus], &set); /* add our file descriptor to the set */
 		ret = select(rc_uart_fd[bus] + 1, &set, NULL, NULL, &timeout);
+		stamp = rc_nanos_since_boot();
 		if(ret == -1){
 			// select returned and error. EINTR means interrupted by SIGINT
 			// aka ctrl-c. Don't print anything as this happens normally
@@ -363,6 +456,7 @@ int rc_uart_read_bytes(int bus, uint8_t* buf, size_t bytes)
 				// success, actually read something
 				bytes_read += ret;
 				bytes_left -= ret;
+				if(rx_ns!=NULL) *rx_ns = stamp;
 			}
 		}
 	}
@@ -0,0 +1,36 @@
+/**
+ * @file uart_baud.c
+ *
+ * @brief      Non-standard baudrates through TCSETS2
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <asm/termbits.h>
+
+#include "uart_baud.h"
+
+
+int __uart_set_baud_other(int fd, int baudrate)
+{
+	struct termios2 config;
+
+	if(ioctl(fd, TCGETS2, &config)==-1){
+		perror("ERROR in rc_uart_init calling TCGETS2");
+		return -1;
+	}
+	config.c_cflag &= ~CBAUD;
+	config.c_cflag |= BOTHER;
+	config.c_cflag &= ~(CBAUD<<IBSHIFT);
+	config.c_cflag |= BOTHER<<IBSHIFT;
+	config.c_ispeed = baudrate;
+	config.c_ospeed = baudrate;
+	if(ioctl(fd, TCSETS2, &config)==-1){
+		perror("ERROR in rc_uart_init calling TCSETS2");
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,27 @@
+/**
+ * @file uart_baud.h
+ *
+ * @brief      Setting baudrates termios has no Bxxx constant for.
+ *
+ * Kept apart from uart.c because the kernel's termios2 definitions clash with
+ * glibc's <termios.h>.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#ifndef RC_UART_BAUD_H
+#define RC_UART_BAUD_H
+
+/**
+ * @brief      Sets any baudrate on an open tty with BOTHER, leaving every
+ * other setting as it is.
+ *
+ * @param[in]  fd        tty file descriptor
+ * @param[in]  baudrate  baudrate in bits per second
+ *
+ * @return     0 on success, -1 on failure
+ */
+int __uart_set_baud_other(int fd, int baudrate);
+
+#endif // RC_UART_BAUD_H
@@ -0,0 +1,625 @@
+/**
+ * @file uart_service.c
+ *
+ * @brief      One epoll thread receiving on every UART bus added to it
+ *
+ * Each bus has a power of 2 ring indexed by free running head and tail
+ * counters. The service thread is the only writer of head and, for framed
+ * buses, also the only consumer. Raw buses are consumed by the user through
+ * rc_uart_service_read(), which only writes tail, so the ring contents need no
+ * lock.
+ *
+ * The service mutex guards which buses are in the service and the published
+ * stats. It is only held for bookkeeping, never across epoll_wait(), a read
+ * or a callback, so callbacks may call any rc_uart_service function. While
+ * the thread works on a bus it marks it busy, and a reader copying out of a
+ * raw ring counts itself in readers. rc_uart_service_remove() waits on cond
+ * until both are clear before freeing the ring. Called from a callback on the
+ * bus it is removing, it can't wait for itself so it leaves the free to the
+ * service thread through release instead.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+
+#include <rc/uart.h>
+#include <rc/pthread.h>
+#include <rc/time.h>
+#include <rc/uart_service.h>
+
+// preposessor macros
+#define unlikely(x)	__builtin_expect (!!(x), 0)
+
+#define MAX_BUS		16	// same as uart.c
+#define MAX_EVENTS	8
+#define WAKE_ID		(MAX_BUS+1)	// epoll data of the stop eventfd
+#define MIN_RING_LEN	64
+#define DEFAULT_RING	4096
+#define DEFAULT_MAX_LEN	256
+#define SCRATCH_LEN	128	// bytes read at a time to throw away when a ring is full
+
+
+typedef struct svc_bus_t{
+	int active;
+	int fd;
+	int flags;		///< fcntl flags before joining, restored on removal
+	rc_uart_service_config_t conf;
+	uint8_t* ring;
+	size_t size;		///< power of 2
+	size_t head;		///< bytes ever written, only the service thread writes it
+	size_t tail;		///< bytes ever consumed, only the consumer writes it
+	size_t scan;		///< DELIMITER: bytes past tail already searched
+	int discard;		///< DELIMITER: dropping an overlong frame until its delimiter
+	uint64_t rx_ns;		///< when the latest bytes were received
+	rc_uart_service_stats_t stats;	///< running totals, only touched by the service thread
+	rc_uart_service_stats_t shown;	///< copy of stats for rc_uart_service_get_stats, under the mutex
+	int busy;		///< the service thread is working on the ring
+	int readers;		///< rc_uart_service_read calls copying out of the ring
+	int release;		///< removed from its own callback, free once no longer busy
+} svc_bus_t;
+
+static svc_bus_t buses[MAX_BUS+1];
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;	// a bus stopped being busy or read
+static pthread_t thread;
+static int running = 0;
+static int epfd = -1;
+static int wakefd = -1;
+
+
+static inline uint8_t __byte(const svc_bus_t* b, size_t off)
+{
+	return b->ring[(b->tail+off) & (b->size-1)];
+}
+
+
+/**
+ * describes len bytes starting at the tail as up to two slices of the ring
+ */
+static void __slice(const svc_bus_t* b, size_t len, rc_uart_frame_t* frame)
+{
+	size_t start = b->tail & (b->size-1);
+	size_t first = b->size-start;
+	if(first>len) first = len;
+	frame->data[0] = b->ring+start;
+	frame->len[0] = first;
+	frame->data[1] = b->ring;
+	frame->len[1] = len-first;
+	frame->total = len;
+	frame->timestamp_ns = b->rx_ns;
+	return;
+}
+
+
+static inline void __consume(svc_bus_t* b, size_t n)
+{
+	__atomic_store_n(&b->tail, b->tail+n, __ATOMIC_RELEASE);
+	return;
+}
+
+
+/**
+ * drops bytes up to the next sync byte
+ *
+ * @return     bytes left in the ring, the first being sync if any
+ */
+static size_t __find_sync(svc_bus_t* b, size_t avail)
+{
+	size_t i = 0;
+	while(i<avail && __byte(b, i)!=b->conf.sync) i++;
+	if(i){
+		__consume(b, i);
+		b->stats.skipped += i;
+	}
+	return avail-i;
+}
+
+
+/**
+ * hands a candidate frame of len bytes at the tail to the check and then the
+ * callback
+ *
+ * @return     0 if delivered, -1 if the check refused it
+ */
+static int __deliver(int bus, svc_bus_t* b, size_t len)
+{
+	rc_uart_frame_t frame;
+	__slice(b, len, &frame);
+	if(b->conf.check && b->conf.check(&frame, b->conf.ctx)){
+		b->stats.rejected++;
+		return -1;
+	}
+	b->conf.callback(bus, &frame, b->conf.ctx);
+	b->stats.frames++;
+	return 0;
+}
+
+
+/**
+ * cuts as many frames as possible out of the ring of a framed bus
+ */
+static void __frame(int bus, svc_bus_t* b)
+{
+	size_t avail, i, hdr, len;
+
+	while(1){
+		avail = b->head - b->tail;
+		switch(b->conf.framer){
+		case RC_UART_FRAMER_FIXED:
+			if(b->conf.sync_en) avail = __find_sync(b, avail);
+			if(avail<b->conf.max_len) return;
+			if(__deliver(bus, b, b->conf.max_len)){
+				// lost sync, try again one byte on
+				__consume(b, 1);
+				b->stats.skipped++;
+			}
+			else __consume(b, b->conf.max_len);
+			break;
+
+		case RC_UART_FRAMER_DELIMITER:
+			for(i=b->scan;i<avail;i++) if(__byte(b, i)==b->conf.delimiter) break;
+			if(i==avail){
+				// too long to be a frame, drop what's here and
+				// everything else up to the next delimiter
+				if(avail>b->conf.max_len){
+					if(!b->discard) b->stats.rejected++;
+					b->discard = 1;
+					b->stats.skipped += avail;
+					__consume(b, avail);
+					avail = 0;
+				}
+				b->scan = avail;
+				return;
+			}
+			if(b->discard) b->stats.skipped += i+1;
+			else if(i>b->conf.max_len) b->stats.rejected++;
+			else __deliver(bus, b, i);
+			__consume(b, i+1);
+			b->scan = 0;
+			b->discard = 0;
+			break;
+
+		case RC_UART_FRAMER_LENGTH:
+			if(b->conf.sync_en) avail = __find_sync(b, avail);
+			hdr = b->conf.len_offset + b->conf.len_bytes;
+			if(avail<hdr) return;
+			len = __byte(b, b->conf.len_offset);
+			if(b->conf.len_bytes==2) len |= (size_t)__byte(b, b->conf.len_offset+1)<<8;
+			len += b->conf.len_extra;
+			if(len<hdr || len>b->conf.max_len){
+				b->stats.rejected++;
+				__consume(b, 1);
+				b->stats.skipped++;
+				break;
+			}
+			if(avail<len) return;
+			if(__deliver(bus, b, len)){
+				__consume(b, 1);
+				b->stats.skipped++;
+			}
+			else __consume(b, len);
+			break;
+
+		default:
+			return;
+		}
+	}
+}
+
+
+/**
+ * reads everything waiting on a bus straight into the free part of its ring
+ *
+ * @return     0 normally, -1 if the bus hung up
+ */
+static int __receive(svc_bus_t* b)
+{
+	struct iovec iov[2];
+	uint8_t scratch[SCRATCH_LEN];
+	size_t head, tail, space, pos;
+	ssize_t ret;
+
+	head = b->head;
+	tail = __atomic_load_n(&b->tail, __ATOMIC_ACQUIRE);
+	space = b->size - (head-tail);
+
+	// a raw bus nobody is emptying, keep the oldest bytes
+	if(space==0){
+		ret = read(b->fd, scratch, sizeof(scratch));
+		if(ret>0) b->stats.overrun += ret;
+		return ret==0 ? -1 : 0;
+	}
+
+	pos = head & (b->size-1);
+	iov[0].iov_base = b->ring+pos;
+	iov[0].iov_len = b->size-pos;
+	if(iov[0].iov_len>space) iov[0].iov_len = space;
+	iov[1].iov_base = b->ring;
+	iov[1].iov_len = space-iov[0].iov_len;
+	b->rx_ns = rc_nanos_since_boot();
+	ret = readv(b->fd, iov, iov[1].iov_len ? 2 : 1);
+	if(ret<0){
+		if(errno!=EAGAIN && errno!=EINTR) perror("ERROR in rc_uart_service reading bus");
+		return 0;
+	}
+	if(ret==0) return -1;
+	b->stats.bytes += ret;
+	__atomic_store_n(&b->head, head+ret, __ATOMIC_RELEASE);
+	return 0;
+}
+
+
+/**
+ * takes a bus out of epoll, puts its fd back how it was and frees its ring.
+ * Call with the mutex held and the bus neither busy nor being read.
+ */
+static void __drop_bus(svc_bus_t* b)
+{
+	epoll_ctl(epfd, EPOLL_CTL_DEL, b->fd, NULL);
+	fcntl(b->fd, F_SETFL, b->flags);
+	b->active = 0;
+	b->release = 0;
+	free(b->ring);
+	b->ring = NULL;
+	return;
+}
+
+
+/**
+ * takes a bus out of the service, waiting for the service thread and any
+ * readers to finish with its ring first. Call with the mutex held.
+ */
+static void __remove_bus(svc_bus_t* b)
+{
+	b->active = 0;
+	// a callback removing its own bus, the service thread frees it once
+	// the callback returns
+	if(b->busy && pthread_equal(pthread_self(), thread)){
+		b->release = 1;
+		return;
+	}
+	while(b->busy || b->readers) pthread_cond_wait(&cond, &mutex);
+	__drop_bus(b);
+	return;
+}
+
+
+static void* __service_thread(__attribute__ ((unused)) void* ptr)
+{
+	struct epoll_event ev[MAX_EVENTS];
+	uint64_t val;
+	int i, n, id;
+	svc_bus_t* b;
+
+	while(1){
+		n = epoll_wait(epfd, ev, MAX_EVENTS, -1);
+		if(n<0){
+			if(errno==EINTR) continue;
+			perror("ERROR in rc_uart_service calling epoll_wait");
+			break;
+		}
+		for(i=0;i<n;i++){
+			id = ev[i].data.u32;
+			if(id==WAKE_ID){
+				if(read(wakefd, &val, sizeof(val))<0){}
+				continue;
+			}
+			b = &buses[id];
+			// claim the bus so it can't be freed while the mutex is
+			// released for the read and the callbacks
+			pthread_mutex_lock(&mutex);
+			if(!running){
+				pthread_mutex_unlock(&mutex);
+				return NULL;
+			}
+			if(!b->active){
+				pthread_mutex_unlock(&mutex);
+				continue;
+			}
+			b->busy = 1;
+			pthread_mutex_unlock(&mutex);
+
+			if(__receive(b)){
+				fprintf(stderr,"WARNING in rc_uart_service, uart%d hung up, no longer watching it\n", id);
+				epoll_ctl(epfd, EPOLL_CTL_DEL, b->fd, NULL);
+			}
+			if(b->conf.framer!=RC_UART_FRAMER_NONE) __frame(id, b);
+
+			pthread_mutex_lock(&mutex);
+			b->shown = b->stats;
+			b->busy = 0;
+			if(b->release) __drop_bus(b);
+			pthread_cond_broadcast(&cond);
+			pthread_mutex_unlock(&mutex);
+		}
+		pthread_mutex_lock(&mutex);
+		if(!running){
+			pthread_mutex_unlock(&mutex);
+			break;
+		}
+		pthread_mutex_unlock(&mutex);
+	}
+	return NULL;
+}
+
+
+rc_uart_service_config_t rc_uart_service_default_config(void)
+{
+	rc_uart_service_config_t conf;
+	memset(&conf, 0, sizeof(conf));
+	conf.framer = RC_UART_FRAMER_NONE;
+	conf.ring_len = DEFAULT_RING;
+	conf.max_len = DEFAULT_MAX_LEN;
+	conf.delimiter = '\n';
+	conf.len_bytes = 1;
+	return conf;
+}
+
+
+int rc_uart_service_start(int sched_policy, int priority)
+{
+	struct epoll_event ev;
+
+	pthread_mutex_lock(&mutex);
+	if(running){
+		pthread_mutex_unlock(&mutex);
+		fprintf(stderr,"ERROR in rc_uart_service_start, already running\n");
+		return -1;
+	}
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(epfd==-1 || wakefd==-1){
+		perror("ERROR in rc_uart_service_start");
+		goto fail;
+	}
+	ev.events = EPOLLIN;
+	ev.data.u32 = WAKE_ID;
+	if(epoll_ctl(epfd, EPOLL_CTL_ADD, wakefd, &ev)==-1){
+		perror("ERROR in rc_uart_service_start calling epoll_ctl");
+		goto fail;
+	}
+	running = 1;
+	if(rc_pthread_create(&thread, __service_thread, NULL, sched_policy, priority)<0){
+		fprintf(stderr,"ERROR in rc_uart_service_start, failed to start thread\n");
+		running = 0;
+		goto fail;
+	}
+	pthread_mutex_unlock(&mutex);
+	return 0;
+
+fail:
+	if(epfd!=-1) close(epfd);
+	if(wakefd!=-1) close(wakefd);
+	epfd = -1;
+	wakefd = -1;
+	pthread_mutex_unlock(&mutex);
+	return -1;
+}
+
+
+int rc_uart_service_stop(void)
+{
+	uint64_t val = 1;
+	int i;
+
+	pthread_mutex_lock(&mutex);
+	if(!running){
+		pthread_mutex_unlock(&mutex);
+		return -1;
+	}
+	if(pthread_equal(pthread_self(), thread)){
+		pthread_mutex_unlock(&mutex);
+		fprintf(stderr,"ERROR in rc_uart_service_stop, can't stop the service from a frame callback\n");
+		return -1;
+	}
+	running = 0;
+	if(write(wakefd, &val, sizeof(val))<0){
+		perror("ERROR in rc_uart_service_stop waking thread");
+	}
+	pthread_mutex_unlock(&mutex);
+	pthread_join(thread, NULL);
+
+	pthread_mutex_lock(&mutex);
+	for(i=0;i<=MAX_BUS;i++) if(buses[i].active || buses[i].release) __remove_bus(&buses[i]);
+	close(epfd);
+	close(wakefd);
+	epfd = -1;
+	wakefd = -1;
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+
+int rc_uart_service_add(int bus, rc_uart_service_config_t conf)
+{
+	struct epoll_event ev;
+	svc_bus_t* b;
+	size_t size;
+	uint8_t* ring;
+	int fd, flags;
+
+	// sanity checks
+	if(bus<0 || bus>MAX_BUS){
+		fprintf(stderr,"ERROR in rc_uart_service_add, bus must be between 0 & %d\n", MAX_BUS);
+		return -1;
+	}
+	if(conf.framer<RC_UART_FRAMER_NONE || conf.framer>RC_UART_FRAMER_LENGTH){
+		fprintf(stderr,"ERROR in rc_uart_service_add, invalid framer\n");
+		return -1;
+	}
+	if(conf.framer!=RC_UART_FRAMER_NONE && conf.callback==NULL){
+		fprintf(stderr,"ERROR in rc_uart_service_add, framed buses need a callback\n");
+		return -1;
+	}
+	if(conf.framer==RC_UART_FRAMER_LENGTH && (conf.len_bytes<1 || conf.len_bytes>2)){
+		fprintf(stderr,"ERROR in rc_uart_service_add, len_bytes must be 1 or 2\n");
+		return -1;
+	}
+	size = MIN_RING_LEN;
+	while(size<conf.ring_len) size <<= 1;
+	if(conf.max_len<1 || conf.max_len>=size){
+		fprintf(stderr,"ERROR in rc_uart_service_add, max_len must be between 1 and the ring length\n");
+		return -1;
+	}
+	if(conf.framer==RC_UART_FRAMER_LENGTH && conf.len_offset+conf.len_bytes>conf.max_len){
+		fprintf(stderr,"ERROR in rc_uart_service_add, length field must lie within max_len\n");
+		return -1;
+	}
+	fd = rc_uart_get_fd(bus);
+	if(fd==-1) return -1;
+
+	ring = malloc(size);
+	if(ring==NULL){
+		perror("ERROR in rc_uart_service_add, failed to allocate ring");
+		return -1;
+	}
+
+	pthread_mutex_lock(&mutex);
+	b = &buses[bus];
+	if(!running){
+		fprintf(stderr,"ERROR in rc_uart_service_add, call rc_uart_service_start first\n");
+		goto fail;
+	}
+	if(b->active || b->ring!=NULL){
+		fprintf(stderr,"ERROR in rc_uart_service_add, uart%d already added\n", bus);
+		goto fail;
+	}
+	// reads must never block the thread serving every other bus
+	flags = fcntl(fd, F_GETFL);
+	if(flags==-1 || fcntl(fd, F_SETFL, flags|O_NONBLOCK)==-1){
+		perror("ERROR in rc_uart_service_add calling fcntl");
+		goto fail;
+	}
+	memset(b, 0, sizeof(*b));
+	b->fd = fd;
+	b->flags = flags;
+	b->conf = conf;
+	b->ring = ring;
+	b->size = size;
+	ev.events = EPOLLIN;
+	ev.data.u32 = bus;
+	if(epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev)==-1){
+		perror("ERROR in rc_uart_service_add calling epoll_ctl");
+		fcntl(fd, F_SETFL, flags);
+		b->ring = NULL;
+		goto fail;
+	}
+	b->active = 1;
+	pthread_mutex_unlock(&mutex);
+	return 0;
+
+fail:
+	pthread_mutex_unlock(&mutex);
+	free(ring);
+	return -1;
+}
+
+
+int rc_uart_service_remove(int bus)
+{
+	// sanity checks
+	if(bus<0 || bus>MAX_BUS){
+		fprintf(stderr,"ERROR in rc_uart_service_remove, bus must be between 0 & %d\n", MAX_BUS);
+		return -1;
+	}
+	pthread_mutex_lock(&mutex);
+	if(!buses[bus].active){
+		pthread_mutex_unlock(&mutex);
+		return -1;
+	}
+	__remove_bus(&buses[bus]);
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+
+int rc_uart_service_read(int bus, uint8_t* buf, size_t max)
+{
+	svc_bus_t* b;
+	size_t head, tail, n, pos, first;
+
+	// sanity checks
+	if(unlikely(bus<0 || bus>MAX_BUS)){
+		fprintf(stderr,"ERROR in rc_uart_service_read, bus must be between 0 & %d\n", MAX_BUS);
+		return -1;
+	}
+	if(unlikely(buf==NULL)){
+		fprintf(stderr,"ERROR in rc_uart_service_read, received NULL pointer\n");
+		return -1;
+	}
+	// count ourselves in so the ring can't be freed while copying out of it
+	b = &buses[bus];
+	pthread_mutex_lock(&mutex);
+	if(unlikely(!b->active || b->conf.framer!=RC_UART_FRAMER_NONE)){
+		pthread_mutex_unlock(&mutex);
+		fprintf(stderr,"ERROR in rc_uart_service_read, uart%d not added with RC_UART_FRAMER_NONE\n", bus);
+		return -1;
+	}
+	b->readers++;
+	pthread_mutex_unlock(&mutex);
+
+	tail = b->tail;
+	head = __atomic_load_n(&b->head, __ATOMIC_ACQUIRE);
+	n = head-tail;
+	if(n>max) n = max;
+	pos = tail & (b->size-1);
+	first = b->size-pos;
+	if(first>n) first = n;
+	memcpy(buf, b->ring+pos, first);
+	memcpy(buf+first, b->ring, n-first);
+	__consume(b, n);
+
+	pthread_mutex_lock(&mutex);
+	b->readers--;
+	if(b->readers==0) pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&mutex);
+	return n;
+}
+
+
+int rc_uart_service_get_stats(int bus, rc_uart_service_stats_t* stats)
+{
+	// sanity checks
+	if(bus<0 || bus>MAX_BUS){
+		fprintf(stderr,"ERROR in rc_uart_service_get_stats, bus must be between 0 & %d\n", MAX_BUS);
+		return -1;
+	}
+	if(stats==NULL){
+		fprintf(stderr,"ERROR in rc_uart_service_get_stats, received NULL pointer\n");
+		return -1;
+	}
+	pthread_mutex_lock(&mutex);
+	*stats = buses[bus].shown;
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+
+size_t rc_uart_frame_copy(const rc_uart_frame_t* frame, uint8_t* buf, size_t max)
+{
+	size_t a, b;
+	if(frame==NULL || buf==NULL) return 0;
+	a = frame->len[0]<max ? frame->len[0] : max;
+	b = frame->len[1]<max-a ? frame->len[1] : max-a;
+	memcpy(buf, frame->data[0], a);
+	memcpy(buf+a, frame->data[1], b);
+	return a+b;
+}
+
+
+uint8_t rc_uart_frame_byte(const rc_uart_frame_t* frame, size_t i)
+{
+	return i<frame->len[0] ? frame->data[0][i] : frame->data[1][i-frame->len[0]];
+}
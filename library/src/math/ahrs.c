@@ -0,0 +1,310 @@
+/**
+ * @file ahrs.c
+ *
+ * @brief      Mahony and Madgwick orientation filters in single precision.
+ *
+ * Both filters share the same quaternion integration and initial alignment,
+ * only the correction term differs. Everything is written out longhand in
+ * floats rather than using the rc_vector/rc_quaternion functions so an update
+ * never touches the heap and stays cheap enough to run at 1khz.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <math.h>
+
+#include <rc/math/ahrs.h>
+#include <rc/math/quaternion.h>
+#include "algebra_common.h"
+
+
+/**
+ * Normalizes a 3-vector in place.
+ *
+ * @return     0 on success, -1 if the vector is all zeros
+ */
+static int __normalize3(float v[3])
+{
+	float n = v[0]*v[0] + v[1]*v[1] + v[2]*v[2];
+	if(n <= 0.0f) return -1;
+	n = 1.0f/sqrtf(n);
+	v[0] *= n;
+	v[1] *= n;
+	v[2] *= n;
+	return 0;
+}
+
+
+static void __normalize4(float q[4])
+{
+	float n = 1.0f/sqrtf(q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3]);
+	q[0] *= n;
+	q[1] *= n;
+	q[2] *= n;
+	q[3] *= n;
+}
+
+
+/**
+ * Sets the quaternion directly from the direction of gravity and, if given,
+ * the magnetic field so the filter starts at the right attitude.
+ */
+static void __align(rc_ahrs_t* a, const float acc[3], const float mag[3])
+{
+	double tb[3], q[4];
+	float sr, cr, sp, cp, lx, ly;
+	tb[0] = (double)atan2f(acc[1], acc[2]);
+	tb[1] = (double)atan2f(-acc[0], sqrtf(acc[1]*acc[1] + acc[2]*acc[2]));
+	tb[2] = 0.0;
+	if(mag!=NULL){
+		// rotate mag into the level frame and find the heading that puts
+		// magnetic north along X
+		sr = sinf((float)tb[0]);
+		cr = cosf((float)tb[0]);
+		sp = sinf((float)tb[1]);
+		cp = cosf((float)tb[1]);
+		lx = mag[0]*cp + (mag[1]*sr + mag[2]*cr)*sp;
+		ly = mag[1]*cr - mag[2]*sr;
+		tb[2] = (double)atan2f(-ly, lx);
+	}
+	rc_quaternion_from_tb_array(tb, q);
+	a->q[0] = (float)q[0];
+	a->q[1] = (float)q[1];
+	a->q[2] = (float)q[2];
+	a->q[3] = (float)q[3];
+}
+
+
+/**
+ * Mahony correction: cross product of measured and estimated reference
+ * directions fed back through a PI controller onto the gyro rates.
+ */
+static void __mahony_correct(rc_ahrs_t* a, float g[3], const float acc[3], const float mag[3], float dt)
+{
+	float* q = a->q;
+	float vx, vy, vz, wx, wy, wz, hx, hy, hz, bx, bz;
+	float ex, ey, ez;
+
+	// estimated direction of gravity in the sensor frame
+	vx = 2.0f*(q[1]*q[3] - q[0]*q[2]);
+	vy = 2.0f*(q[0]*q[1] + q[2]*q[3]);
+	vz = q[0]*q[0] - q[1]*q[1] - q[2]*q[2] + q[3]*q[3];
+	ex = acc[1]*vz - acc[2]*vy;
+	ey = acc[2]*vx - acc[0]*vz;
+	ez = acc[0]*vy - acc[1]*vx;
+
+	if(mag!=NULL){
+		// earth frame field, flattened onto the x-z plane
+		hx = 2.0f*(mag[0]*(0.5f - q[2]*q[2] - q[3]*q[3]) + mag[1]*(q[1]*q[2] - q[0]*q[3]) + mag[2]*(q[1]*q[3] + q[0]*q[2]));
+		hy = 2.0f*(mag[0]*(q[1]*q[2] + q[0]*q[3]) + mag[1]*(0.5f - q[1]*q[1] - q[3]*q[3]) + mag[2]*(q[2]*q[3] - q[0]*q[1]));
+		hz = 2.0f*(mag[0]*(q[1]*q[3] - q[0]*q[2]) + mag[1]*(q[2]*q[3] + q[0]*q[1]) + mag[2]*(0.5f - q[1]*q[1] - q[2]*q[2]));
+		bx = sqrtf(hx*hx + hy*hy);
+		bz = hz;
+		// estimated direction of the field in the sensor frame
+		wx = 2.0f*(bx*(0.5f - q[2]*q[2] - q[3]*q[3]) + bz*(q[1]*q[3] - q[0]*q[2]));
+		wy = 2.0f*(bx*(q[1]*q[2] - q[0]*q[3]) + bz*(q[0]*q[1] + q[2]*q[3]));
+		wz = 2.0f*(bx*(q[0]*q[2] + q[1]*q[3]) + bz*(0.5f - q[1]*q[1] - q[2]*q[2]));
+		ex += mag[1]*wz - mag[2]*wy;
+		ey += mag[2]*wx - mag[0]*wz;
+		ez += mag[0]*wy - mag[1]*wx;
+	}
+
+	if(a->ki > 0.0f){
+		a->integral[0] += a->ki*ex*dt;
+		a->integral[1] += a->ki*ey*dt;
+		a->integral[2] += a->ki*ez*dt;
+		g[0] += a->integral[0];
+		g[1] += a->integral[1];
+		g[2] += a->integral[2];
+	}
+	g[0] += a->kp*ex;
+	g[1] += a->kp*ey;
+	g[2] += a->kp*ez;
+}
+
+
+/**
+ * Madgwick correction: one normalized gradient descent step on the error
+ * between measured and predicted reference directions, s = J'f.
+ */
+static void __madgwick_step(rc_ahrs_t* a, float s[4], const float acc[3], const float mag[3])
+{
+	float* q = a->q;
+	float f1, f2, f3, hx, hy, hz, bx, bz;
+
+	// gravity objective, reference (0,0,1) in the earth frame
+	f1 = 2.0f*(q[1]*q[3] - q[0]*q[2]) - acc[0];
+	f2 = 2.0f*(q[0]*q[1] + q[2]*q[3]) - acc[1];
+	f3 = 1.0f - 2.0f*(q[1]*q[1] + q[2]*q[2]) - acc[2];
+	s[0] = -2.0f*q[2]*f1 + 2.0f*q[1]*f2;
+	s[1] =  2.0f*q[3]*f1 + 2.0f*q[0]*f2 - 4.0f*q[1]*f3;
+	s[2] = -2.0f*q[0]*f1 + 2.0f*q[3]*f2 - 4.0f*q[2]*f3;
+	s[3] =  2.0f*q[1]*f1 + 2.0f*q[2]*f2;
+
+	if(mag!=NULL){
+		// magnetic objective, reference (bx,0,bz) from the current estimate
+		hx = 2.0f*(mag[0]*(0.5f - q[2]*q[2] - q[3]*q[3]) + mag[1]*(q[1]*q[2] - q[0]*q[3]) + mag[2]*(q[1]*q[3] + q[0]*q[2]));
+		hy = 2.0f*(mag[0]*(q[1]*q[2] + q[0]*q[3]) + mag[1]*(0.5f - q[1]*q[1] - q[3]*q[3]) + mag[2]*(q[2]*q[3] - q[0]*q[1]));
+		hz = 2.0f*(mag[0]*(q[1]*q[3] - q[0]*q[2]) + mag[1]*(q[2]*q[3] + q[0]*q[1]) + mag[2]*(0.5f - q[1]*q[1] - q[2]*q[2]));
+		bx = sqrtf(hx*hx + hy*hy);
+		bz = hz;
+		f1 = 2.0f*bx*(0.5f - q[2]*q[2] - q[3]*q[3]) + 2.0f*bz*(q[1]*q[3] - q[0]*q[2]) - mag[0];
+		f2 = 2.0f*bx*(q[1]*q[2] - q[0]*q[3]) + 2.0f*bz*(q[0]*q[1] + q[2]*q[3]) - mag[1];
+		f3 = 2.0f*bx*(q[0]*q[2] + q[1]*q[3]) + 2.0f*bz*(0.5f - q[1]*q[1] - q[2]*q[2]) - mag[2];
+		s[0] += -2.0f*bz*q[2]*f1 + (-2.0f*bx*q[3] + 2.0f*bz*q[1])*f2 + 2.0f*bx*q[2]*f3;
+		s[1] +=  2.0f*bz*q[3]*f1 + ( 2.0f*bx*q[2] + 2.0f*bz*q[0])*f2 + (2.0f*bx*q[3] - 4.0f*bz*q[1])*f3;
+		s[2] += (-4.0f*bx*q[2] - 2.0f*bz*q[0])*f1 + (2.0f*bx*q[1] + 2.0f*bz*q[3])*f2 + (2.0f*bx*q[0] - 4.0f*bz*q[2])*f3;
+		s[3] += (-4.0f*bx*q[3] + 2.0f*bz*q[1])*f1 + (-2.0f*bx*q[0] + 2.0f*bz*q[2])*f2 + 2.0f*bx*q[1]*f3;
+	}
+}
+
+
+rc_ahrs_t rc_ahrs_empty(void)
+{
+	rc_ahrs_t out = RC_AHRS_INITIALIZER;
+	return out;
+}
+
+
+int rc_ahrs_mahony_init(rc_ahrs_t* a, float kp, float ki)
+{
+	if(unlikely(a==NULL)){
+		fprintf(stderr,"ERROR in rc_ahrs_mahony_init, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(kp<0.0f || ki<0.0f)){
+		fprintf(stderr,"ERROR in rc_ahrs_mahony_init, gains must be >= 0\n");
+		return -1;
+	}
+	*a = rc_ahrs_empty();
+	a->type = RC_AHRS_MAHONY;
+	a->kp = kp;
+	a->ki = ki;
+	a->initialized = 1;
+	return 0;
+}
+
+
+int rc_ahrs_madgwick_init(rc_ahrs_t* a, float beta)
+{
+	if(unlikely(a==NULL)){
+		fprintf(stderr,"ERROR in rc_ahrs_madgwick_init, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(beta<0.0f)){
+		fprintf(stderr,"ERROR in rc_ahrs_madgwick_init, beta must be >= 0\n");
+		return -1;
+	}
+	*a = rc_ahrs_empty();
+	a->type = RC_AHRS_MADGWICK;
+	a->beta = beta;
+	a->initialized = 1;
+	return 0;
+}
+
+
+int rc_ahrs_reset(rc_ahrs_t* a)
+{
+	if(unlikely(a==NULL)){
+		fprintf(stderr,"ERROR in rc_ahrs_reset, received NULL pointer\n");
+		return -1;
+	}
+	a->q[0] = 1.0f;
+	a->q[1] = 0.0f;
+	a->q[2] = 0.0f;
+	a->q[3] = 0.0f;
+	a->integral[0] = 0.0f;
+	a->integral[1] = 0.0f;
+	a->integral[2] = 0.0f;
+	a->step = 0;
+	return 0;
+}
+
+
+int rc_ahrs_update(rc_ahrs_t* a, const float gyro[3], const float accel[3], const float mag[3], float dt)
+{
+	float g[3], acc[3], m[3], s[4], qd[4], n;
+	float* q;
+	const float* mp = NULL;
+	int acc_ok;
+
+	if(unlikely(a==NULL || gyro==NULL || accel==NULL)){
+		fprintf(stderr,"ERROR in rc_ahrs_update, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!a->initialized)){
+		fprintf(stderr,"ERROR in rc_ahrs_update, filter uninitialized\n");
+		return -1;
+	}
+	if(unlikely(dt<=0.0f)){
+		fprintf(stderr,"ERROR in rc_ahrs_update, dt must be positive\n");
+		return -1;
+	}
+	q = a->q;
+	g[0] = gyro[0];
+	g[1] = gyro[1];
+	g[2] = gyro[2];
+	acc[0] = accel[0];
+	acc[1] = accel[1];
+	acc[2] = accel[2];
+	acc_ok = (__normalize3(acc)==0);
+	if(mag!=NULL && acc_ok){
+		m[0] = mag[0];
+		m[1] = mag[1];
+		m[2] = mag[2];
+		if(__normalize3(m)==0) mp = m;
+	}
+
+	// snap to the measured attitude on the first step
+	if(a->step==0 && acc_ok){
+		__align(a, acc, mp);
+		a->step++;
+		return 0;
+	}
+
+	if(acc_ok && a->type==RC_AHRS_MAHONY){
+		__mahony_correct(a, g, acc, mp, dt);
+	}
+
+	// rate of change of quaternion from gyroscope, qdot = 0.5 q*(0,g)
+	qd[0] = 0.5f*(-q[1]*g[0] - q[2]*g[1] - q[3]*g[2]);
+	qd[1] = 0.5f*( q[0]*g[0] + q[2]*g[2] - q[3]*g[1]);
+	qd[2] = 0.5f*( q[0]*g[1] - q[1]*g[2] + q[3]*g[0]);
+	qd[3] = 0.5f*( q[0]*g[2] + q[1]*g[1] - q[2]*g[0]);
+
+	if(acc_ok && a->type==RC_AHRS_MADGWICK){
+		__madgwick_step(a, s, acc, mp);
+		n = s[0]*s[0] + s[1]*s[1] + s[2]*s[2] + s[3]*s[3];
+		if(n > 0.0f){
+			n = a->beta/sqrtf(n);
+			qd[0] -= n*s[0];
+			qd[1] -= n*s[1];
+			qd[2] -= n*s[2];
+			qd[3] -= n*s[3];
+		}
+	}
+
+	q[0] += qd[0]*dt;
+	q[1] += qd[1]*dt;
+	q[2] += qd[2]*dt;
+	q[3] += qd[3]*dt;
+	__normalize4(q);
+	a->step++;
+	return 0;
+}
+
+
+int rc_ahrs_get_quaternion(rc_ahrs_t* a, double q[4])
+{
+	if(unlikely(a==NULL || q==NULL)){
+		fprintf(stderr,"ERROR in rc_ahrs_get_quaternion, received NULL pointer\n");
+		return -1;
+	}
+	q[0] = (double)a->q[0];
+	q[1] = (double)a->q[1];
+	q[2] = (double)a->q[2];
+	q[3] = (double)a->q[3];
+	return 0;
+}
@@ -441,49 +441,439 @@ void rc_algebra_set_zero_tolerance(double tol){
 
 int rc_algebra_lin_system_solve_qr(rc_matrix_t A, rc_vector_t b, rc_vector_t* x)
 {
-	int i,k;
-	rc_vector_t temp = RC_VECTOR_INITIALIZER;
-	rc_matrix_t Q = RC_MATRIX_INITIALIZER;
-	rc_matrix_t R = RC_MATRIX_INITIALIZER;
+	rc_algebra_qr_t qr = RC_ALGEBRA_QR_INITIALIZER;
 	if(unlikely(!A.initialized || !b.initialized)){
 		fprintf(stderr,"ERROR in rc_algebra_lin_system_solve_qr, matrix or vector uninitialized\n");
 		return -1;
 	}
-	// do QR decomposition
-	if(unlikely(rc_algebra_qr_decomp(A,&Q,&R))){
+	// factor compactly rather than with rc_algebra_qr_decomp so the full
+	// m by m Q is never formed
+	if(unlikely(rc_algebra_qr_factor(A,&qr))){
 		fprintf(stderr,"ERROR in rc_algebra_lin_system_solve_qr, failed to perform QR decomp\n");
 		return -1;
 	}
-	// Ax=b
-	// QRx=b
-	// Rx=Q'b	because Q'Q=I
-	// RX=(b'Q)'	to avoid transposing q
-	// multiply through right hand side. No difference between row and col
-	// vector so avoid transposing Q by left instead of right multiplying
-	if(unlikely(rc_matrix_row_vec_times_matrix(b,Q,&temp))){
-		fprintf(stderr,"ERROR in rc_algebra_lin_system_solve_qr, failed to multiply vec by matrix\n");
-		rc_matrix_free(&Q);
-		rc_matrix_free(&R);
-		return -1;
-	}
-	// allocate memory for the output x
-	if(unlikely(rc_vector_alloc(x,R.cols))){
-		fprintf(stderr,"ERROR in rc_algebra_lin_system_solve_qr, failed to alloc vector\n");
-		rc_matrix_free(&Q);
-		rc_matrix_free(&R);
-		rc_vector_free(&temp);
-		return -1;
-	}
-	// solve for x knowing R is upper triangular
-	for(k=R.cols-1;k>=0;k--){
-		x->d[k]=temp.d[k];
-		for(i=k+1;i<R.cols;i++)	x->d[k]-=R.d[k][i]*x->d[i];
-		x->d[k] = x->d[k]/R.d[k][k];
-	}
-	// free memory and return
-	rc_matrix_free(&Q);
-	rc_matrix_free(&R);
-	rc_vector_free(&temp);
+	if(unlikely(rc_algebra_qr_solve(&qr,b,x))){
+		rc_algebra_qr_free(&qr);
+		return -1;
+	}
+	rc_algebra_qr_free(&qr);
+	return 0;
+}
+
+
+rc_algebra_lu_t rc_algebra_lu_empty(void)
+{
+	rc_algebra_lu_t lu = RC_ALGEBRA_LU_INITIALIZER;
+	return lu;
+}
+
+
+int rc_algebra_lu_factor(rc_matrix_t A, rc_algebra_lu_t* lu)
+{
+	int i,j,k,m,n,itmp;
+	double max, f, tmp;
+	double** d;
+	// sanity checks
+	if(unlikely(lu==NULL)){
+		fprintf(stderr,"ERROR in rc_algebra_lu_factor, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!A.initialized)){
+		fprintf(stderr,"ERROR in rc_algebra_lu_factor, matrix uninitialized\n");
+		return -1;
+	}
+	if(unlikely(A.rows!=A.cols)){
+		fprintf(stderr,"ERROR in rc_algebra_lu_factor, matrix must be square\n");
+		return -1;
+	}
+	n = A.rows;
+	// reuse memory from a previous factorization of the same size
+	if(lu->n!=n || lu->perm==NULL){
+		rc_algebra_lu_free(lu);
+		lu->perm = (int*)malloc(n*sizeof(int));
+		if(unlikely(lu->perm==NULL)){
+			perror("ERROR in rc_algebra_lu_factor");
+			return -1;
+		}
+		lu->n = n;
+	}
+	if(unlikely(rc_matrix_alloc(&lu->LU,n,n))){
+		fprintf(stderr,"ERROR in rc_algebra_lu_factor, failed to alloc matrix\n");
+		rc_algebra_lu_free(lu);
+		return -1;
+	}
+	lu->initialized = 0;
+	d = lu->LU.d;
+	for(i=0;i<n;i++){
+		memcpy(d[i],A.d[i],n*sizeof(double));
+		lu->perm[i] = i;
+	}
+	// Doolittle elimination with partial pivoting
+	for(k=0;k<n;k++){
+		max = fabs(d[k][k]);
+		m = k;
+		for(i=k+1;i<n;i++){
+			if(fabs(d[i][k])>max){
+				max = fabs(d[i][k]);
+				m = i;
+			}
+		}
+		if(unlikely(max<zero_tolerance)){
+			fprintf(stderr,"ERROR in rc_algebra_lu_factor, matrix not full rank\n");
+			rc_algebra_lu_free(lu);
+			return -1;
+		}
+		// swap row contents, the row pointers must stay in order for
+		// rc_matrix_free
+		if(m!=k){
+			for(j=0;j<n;j++){
+				tmp = d[k][j];
+				d[k][j] = d[m][j];
+				d[m][j] = tmp;
+			}
+			itmp = lu->perm[k];
+			lu->perm[k] = lu->perm[m];
+			lu->perm[m] = itmp;
+		}
+		for(i=k+1;i<n;i++){
+			f = d[i][k]/d[k][k];
+			d[i][k] = f;
+			for(j=k+1;j<n;j++) d[i][j] -= f*d[k][j];
+		}
+	}
+	lu->initialized = 1;
+	return 0;
+}
+
+
+/**
+ * Forward and back substitution of one right hand side. in is read with the
+ * factorization's row permutation and must not alias out.
+ */
+static void __lu_substitute(rc_algebra_lu_t* lu, const double* in, double* out)
+{
+	int i,j,n;
+	double acc;
+	double** d = lu->LU.d;
+	n = lu->n;
+	// Ly = Pb
+	for(i=0;i<n;i++){
+		acc = in[lu->perm[i]];
+		for(j=0;j<i;j++) acc -= d[i][j]*out[j];
+		out[i] = acc;
+	}
+	// Ux = y
+	for(i=n-1;i>=0;i--){
+		acc = out[i];
+		for(j=i+1;j<n;j++) acc -= d[i][j]*out[j];
+		out[i] = acc/d[i][i];
+	}
+	return;
+}
+
+
+int rc_algebra_lu_solve(rc_algebra_lu_t* lu, rc_vector_t b, rc_vector_t* x)
+{
+	// sanity checks
+	if(unlikely(lu==NULL || x==NULL)){
+		fprintf(stderr,"ERROR in rc_algebra_lu_solve, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!lu->initialized || !b.initialized)){
+		fprintf(stderr,"ERROR in rc_algebra_lu_solve, factorization or vector uninitialized\n");
+		return -1;
+	}
+	if(unlikely(b.len!=lu->n)){
+		fprintf(stderr,"ERROR in rc_algebra_lu_solve, dimension mismatch\n");
+		return -1;
+	}
+	if(unlikely(x->d==b.d)){
+		fprintf(stderr,"ERROR in rc_algebra_lu_solve, x and b must not be the same vector\n");
+		return -1;
+	}
+	if(unlikely(rc_vector_alloc(x,lu->n))){
+		fprintf(stderr,"ERROR in rc_algebra_lu_solve, failed to alloc vector\n");
+		return -1;
+	}
+	__lu_substitute(lu, b.d, x->d);
+	return 0;
+}
+
+
+int rc_algebra_lu_solve_multi(rc_algebra_lu_t* lu, rc_matrix_t B, rc_matrix_t* X)
+{
+	int i,j,c,k,n;
+	double f;
+	double* row;
+	double** d;
+	// sanity checks
+	if(unlikely(lu==NULL || X==NULL)){
+		fprintf(stderr,"ERROR in rc_algebra_lu_solve_multi, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!lu->initialized || !B.initialized)){
+		fprintf(stderr,"ERROR in rc_algebra_lu_solve_multi, factorization or matrix uninitialized\n");
+		return -1;
+	}
+	if(unlikely(B.rows!=lu->n)){
+		fprintf(stderr,"ERROR in rc_algebra_lu_solve_multi, dimension mismatch\n");
+		return -1;
+	}
+	if(unlikely(X->d==B.d)){
+		fprintf(stderr,"ERROR in rc_algebra_lu_solve_multi, X and B must not be the same matrix\n");
+		return -1;
+	}
+	if(unlikely(rc_matrix_alloc(X,lu->n,B.cols))){
+		fprintf(stderr,"ERROR in rc_algebra_lu_solve_multi, failed to alloc matrix\n");
+		return -1;
+	}
+	// substitute whole rows at a time so the inner loops run along
+	// contiguous memory for all right hand sides at once
+	n = lu->n;
+	k = B.cols;
+	d = lu->LU.d;
+	// LY = PB
+	for(i=0;i<n;i++){
+		row = X->d[i];
+		memcpy(row, B.d[lu->perm[i]], k*sizeof(double));
+		for(j=0;j<i;j++){
+			f = d[i][j];
+			for(c=0;c<k;c++) row[c] -= f*X->d[j][c];
+		}
+	}
+	// UX = Y
+	for(i=n-1;i>=0;i--){
+		row = X->d[i];
+		for(j=i+1;j<n;j++){
+			f = d[i][j];
+			for(c=0;c<k;c++) row[c] -= f*X->d[j][c];
+		}
+		f = 1.0/d[i][i];
+		for(c=0;c<k;c++) row[c] *= f;
+	}
+	return 0;
+}
+
+
+int rc_algebra_lu_free(rc_algebra_lu_t* lu)
+{
+	rc_algebra_lu_t new = RC_ALGEBRA_LU_INITIALIZER;
+	if(unlikely(lu==NULL)){
+		fprintf(stderr,"ERROR in rc_algebra_lu_free, received NULL pointer\n");
+		return -1;
+	}
+	rc_matrix_free(&lu->LU);
+	free(lu->perm);
+	*lu = new;
+	return 0;
+}
+
+
+rc_algebra_qr_t rc_algebra_qr_empty(void)
+{
+	rc_algebra_qr_t qr = RC_ALGEBRA_QR_INITIALIZER;
+	return qr;
+}
+
+
+int rc_algebra_qr_factor(rc_matrix_t A, rc_algebra_qr_t* qr)
+{
+	int i,j,k,m,n;
+	double nrm, s;
+	double** d;
+	// sanity checks
+	if(unlikely(qr==NULL)){
+		fprintf(stderr,"ERROR in rc_algebra_qr_factor, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!A.initialized)){
+		fprintf(stderr,"ERROR in rc_algebra_qr_factor, matrix uninitialized\n");
+		return -1;
+	}
+	if(unlikely(A.rows<A.cols)){
+		fprintf(stderr,"ERROR in rc_algebra_qr_factor, matrix must have at least as many rows as columns\n");
+		return -1;
+	}
+	m = A.rows;
+	n = A.cols;
+	qr->initialized = 0;
+	if(unlikely(rc_matrix_duplicate(A,&qr->QR) || rc_vector_alloc(&qr->Rdiag,n) || \
+						rc_vector_alloc(&qr->work,m))){
+		fprintf(stderr,"ERROR in rc_algebra_qr_factor, failed to alloc memory\n");
+		rc_algebra_qr_free(qr);
+		return -1;
+	}
+	qr->rows = m;
+	qr->cols = n;
+	d = qr->QR.d;
+	for(k=0;k<n;k++){
+		// norm of the k-th column below the diagonal
+		nrm = 0.0;
+		for(i=k;i<m;i++) nrm = hypot(nrm,d[i][k]);
+		if(unlikely(nrm<zero_tolerance)){
+			fprintf(stderr,"ERROR in rc_algebra_qr_factor, matrix not full rank\n");
+			rc_algebra_qr_free(qr);
+			return -1;
+		}
+		// form the k-th Householder vector in place, choosing the sign
+		// that avoids cancellation
+		if(d[k][k]<0.0) nrm = -nrm;
+		for(i=k;i<m;i++) d[i][k] /= nrm;
+		d[k][k] += 1.0;
+		// apply the reflection to the remaining columns
+		for(j=k+1;j<n;j++){
+			s = 0.0;
+			for(i=k;i<m;i++) s += d[i][k]*d[i][j];
+			s = -s/d[k][k];
+			for(i=k;i<m;i++) d[i][j] += s*d[i][k];
+		}
+		qr->Rdiag.d[k] = -nrm;
+	}
+	qr->initialized = 1;
+	return 0;
+}
+
+
+/**
+ * Least squares solution of one right hand side. Q' is applied to the copy of
+ * the right hand side already in the workspace, then R is back substituted.
+ */
+static void __qr_substitute(rc_algebra_qr_t* qr, double* out)
+{
+	int i,k,m,n;
+	double s;
+	double** d = qr->QR.d;
+	double* w = qr->work.d;
+	m = qr->rows;
+	n = qr->cols;
+	// w = Q'b
+	for(k=0;k<n;k++){
+		s = 0.0;
+		for(i=k;i<m;i++) s += d[i][k]*w[i];
+		s = -s/d[k][k];
+		for(i=k;i<m;i++) w[i] += s*d[i][k];
+	}
+	// Rx = w
+	for(k=n-1;k>=0;k--){
+		s = w[k];
+		for(i=k+1;i<n;i++) s -= d[k][i]*out[i];
+		out[k] = s/qr->Rdiag.d[k];
+	}
+	return;
+}
+
+
+int rc_algebra_qr_solve(rc_algebra_qr_t* qr, rc_vector_t b, rc_vector_t* x)
+{
+	// sanity checks
+	if(unlikely(qr==NULL || x==NULL)){
+		fprintf(stderr,"ERROR in rc_algebra_qr_solve, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!qr->initialized || !b.initialized)){
+		fprintf(stderr,"ERROR in rc_algebra_qr_solve, factorization or vector uninitialized\n");
+		return -1;
+	}
+	if(unlikely(b.len!=qr->rows)){
+		fprintf(stderr,"ERROR in rc_algebra_qr_solve, dimension mismatch\n");
+		return -1;
+	}
+	// copy b into the workspace before x is allocated, x may alias b and
+	// reallocating it would free b's memory
+	memcpy(qr->work.d, b.d, qr->rows*sizeof(double));
+	if(unlikely(rc_vector_alloc(x,qr->cols))){
+		fprintf(stderr,"ERROR in rc_algebra_qr_solve, failed to alloc vector\n");
+		return -1;
+	}
+	__qr_substitute(qr, x->d);
+	return 0;
+}
+
+
+int rc_algebra_qr_solve_multi(rc_algebra_qr_t* qr, rc_matrix_t B, rc_matrix_t* X)
+{
+	int i,j,c,k,m,n;
+	double f;
+	double* s;
+	double* row;
+	double** d;
+	double** W;
+	// sanity checks
+	if(unlikely(qr==NULL || X==NULL)){
+		fprintf(stderr,"ERROR in rc_algebra_qr_solve_multi, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!qr->initialized || !B.initialized)){
+		fprintf(stderr,"ERROR in rc_algebra_qr_solve_multi, factorization or matrix uninitialized\n");
+		return -1;
+	}
+	if(unlikely(B.rows!=qr->rows)){
+		fprintf(stderr,"ERROR in rc_algebra_qr_solve_multi, dimension mismatch\n");
+		return -1;
+	}
+	if(unlikely(X->d==B.d)){
+		fprintf(stderr,"ERROR in rc_algebra_qr_solve_multi, X and B must not be the same matrix\n");
+		return -1;
+	}
+	if(unlikely(rc_matrix_alloc(X,qr->cols,B.cols))){
+		fprintf(stderr,"ERROR in rc_algebra_qr_solve_multi, failed to alloc matrix\n");
+		return -1;
+	}
+	// workspace holds a copy of B plus one extra row to accumulate the
+	// projections of every right hand side onto the current reflection
+	m = qr->rows;
+	n = qr->cols;
+	k = B.cols;
+	if(unlikely(rc_matrix_alloc(&qr->work_multi,m+1,k))){
+		fprintf(stderr,"ERROR in rc_algebra_qr_solve_multi, failed to alloc workspace\n");
+		return -1;
+	}
+	W = qr->work_multi.d;
+	s = W[m];
+	memcpy(W[0], B.d[0], m*k*sizeof(double));
+	d = qr->QR.d;
+	// W = Q'B, whole rows at a time so the inner loops run along contiguous
+	// memory for all right hand sides at once
+	for(j=0;j<n;j++){
+		for(c=0;c<k;c++) s[c] = 0.0;
+		for(i=j;i<m;i++){
+			f = d[i][j];
+			for(c=0;c<k;c++) s[c] += f*W[i][c];
+		}
+		f = -1.0/d[j][j];
+		for(c=0;c<k;c++) s[c] *= f;
+		for(i=j;i<m;i++){
+			f = d[i][j];
+			for(c=0;c<k;c++) W[i][c] += f*s[c];
+		}
+	}
+	// RX = W
+	for(j=n-1;j>=0;j--){
+		row = X->d[j];
+		memcpy(row, W[j], k*sizeof(double));
+		for(i=j+1;i<n;i++){
+			f = d[j][i];
+			for(c=0;c<k;c++) row[c] -= f*X->d[i][c];
+		}
+		f = 1.0/qr->Rdiag.d[j];
+		for(c=0;c<k;c++) row[c] *= f;
+	}
+	return 0;
+}
+
+
+int rc_algebra_qr_free(rc_algebra_qr_t* qr)
+{
+	rc_algebra_qr_t new = RC_ALGEBRA_QR_INITIALIZER;
+	if(unlikely(qr==NULL)){
+		fprintf(stderr,"ERROR in rc_algebra_qr_free, received NULL pointer\n");
+		return -1;
+	}
+	rc_matrix_free(&qr->QR);
+	rc_vector_free(&qr->Rdiag);
+	rc_vector_free(&qr->work);
+	rc_matrix_free(&qr->work_multi);
+	*qr = new;
 	return 0;
 }
 
@@ -590,3 +980,152 @@ int rc_algebra_fit_ellipsoid(rc_matrix_t pts, rc_vector_t* ctr, rc_vector_t* len
 	rc_vector_free(&f);
 	return 0;
 }
+
+
+rc_ellipsoid_fit_t rc_ellipsoid_fit_empty(void)
+{
+	rc_ellipsoid_fit_t out = RC_ELLIPSOID_FIT_INITIALIZER;
+	return out;
+}
+
+
+int rc_ellipsoid_fit_init(rc_ellipsoid_fit_t* e, double forget)
+{
+	if(unlikely(e==NULL)){
+		fprintf(stderr,"ERROR in rc_ellipsoid_fit_init, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(forget<=0.0 || forget>1.0)){
+		fprintf(stderr,"ERROR in rc_ellipsoid_fit_init, forget must be in (0,1]\n");
+		return -1;
+	}
+	*e = rc_ellipsoid_fit_empty();
+	e->forget = forget;
+	e->initialized = 1;
+	return 0;
+}
+
+
+int rc_ellipsoid_fit_reset(rc_ellipsoid_fit_t* e)
+{
+	if(unlikely(e==NULL)){
+		fprintf(stderr,"ERROR in rc_ellipsoid_fit_reset, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!e->initialized)){
+		fprintf(stderr,"ERROR in rc_ellipsoid_fit_reset, fit not initialized\n");
+		return -1;
+	}
+	memset(e->ata, 0, sizeof(e->ata));
+	memset(e->atb, 0, sizeof(e->atb));
+	e->weight = 0.0;
+	e->n = 0;
+	return 0;
+}
+
+
+int rc_ellipsoid_fit_add_point(rc_ellipsoid_fit_t* e, const double p[3])
+{
+	int i,j;
+	double a[6];
+	if(unlikely(e==NULL || p==NULL)){
+		fprintf(stderr,"ERROR in rc_ellipsoid_fit_add_point, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!e->initialized)){
+		fprintf(stderr,"ERROR in rc_ellipsoid_fit_add_point, fit not initialized\n");
+		return -1;
+	}
+	// same row as rc_algebra_fit_ellipsoid puts in A, b is always 1
+	a[0] = p[0]*p[0];
+	a[1] = p[0];
+	a[2] = p[1]*p[1];
+	a[3] = p[1];
+	a[4] = p[2]*p[2];
+	a[5] = p[2];
+	for(i=0;i<6;i++){
+		for(j=i;j<6;j++){
+			e->ata[i][j] = e->forget*e->ata[i][j] + a[i]*a[j];
+		}
+		e->atb[i] = e->forget*e->atb[i] + a[i];
+	}
+	e->weight = e->forget*e->weight + 1.0;
+	e->n++;
+	return 0;
+}
+
+
+int rc_ellipsoid_fit_solve(rc_ellipsoid_fit_t* e, double center[3], double lengths[3])
+{
+	int i,j,k;
+	double L[6][6], y[6], f[6], A[3][3], b[3], det, l[3], sum, max_diag;
+
+	if(unlikely(e==NULL || center==NULL || lengths==NULL)){
+		fprintf(stderr,"ERROR in rc_ellipsoid_fit_solve, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!e->initialized)){
+		fprintf(stderr,"ERROR in rc_ellipsoid_fit_solve, fit not initialized\n");
+		return -1;
+	}
+	if(e->n<6) return -1;
+
+	// Cholesky factorization of the normal equations A'A = LL'. A pivot that
+	// collapses relative to the largest diagonal means the points don't
+	// cover enough directions yet
+	max_diag = 0.0;
+	for(i=0;i<6;i++) if(e->ata[i][i]>max_diag) max_diag = e->ata[i][i];
+	for(j=0;j<6;j++){
+		sum = e->ata[j][j];
+		for(k=0;k<j;k++) sum -= L[j][k]*L[j][k];
+		if(sum <= zero_tolerance*max_diag) return -1;
+		L[j][j] = sqrt(sum);
+		for(i=j+1;i<6;i++){
+			sum = e->ata[j][i];
+			for(k=0;k<j;k++) sum -= L[i][k]*L[j][k];
+			L[i][j] = sum/L[j][j];
+		}
+	}
+	// forward then back substitution
+	for(i=0;i<6;i++){
+		sum = e->atb[i];
+		for(k=0;k<i;k++) sum -= L[i][k]*y[k];
+		y[i] = sum/L[i][i];
+	}
+	for(i=5;i>=0;i--){
+		sum = y[i];
+		for(k=i+1;k<6;k++) sum -= L[k][i]*f[k];
+		f[i] = sum/L[i][i];
+	}
+
+	// center and lengths exactly as in rc_algebra_fit_ellipsoid
+	center[0] = -f[1]/(2.0*f[0]);
+	center[1] = -f[3]/(2.0*f[2]);
+	center[2] = -f[5]/(2.0*f[4]);
+	for(i=0;i<3;i++){
+		for(j=0;j<3;j++){
+			A[i][j] = f[2*i]*center[j]*center[j];
+		}
+		A[i][i] += 1.0;
+		b[i] = f[2*i];
+	}
+	// 3x3 solve by Cramer's rule
+	det =	A[0][0]*(A[1][1]*A[2][2]-A[1][2]*A[2][1]) -
+		A[0][1]*(A[1][0]*A[2][2]-A[1][2]*A[2][0]) +
+		A[0][2]*(A[1][0]*A[2][1]-A[1][1]*A[2][0]);
+	if(fabs(det)<zero_tolerance) return -1;
+	l[0] = (b[0]*(A[1][1]*A[2][2]-A[1][2]*A[2][1]) -
+		A[0][1]*(b[1]*A[2][2]-A[1][2]*b[2]) +
+		A[0][2]*(b[1]*A[2][1]-A[1][1]*b[2]))/det;
+	l[1] = (A[0][0]*(b[1]*A[2][2]-A[1][2]*b[2]) -
+		b[0]*(A[1][0]*A[2][2]-A[1][2]*A[2][0]) +
+		A[0][2]*(A[1][0]*b[2]-b[1]*A[2][0]))/det;
+	l[2] = (A[0][0]*(A[1][1]*b[2]-b[1]*A[2][1]) -
+		A[0][1]*(A[1][0]*b[2]-b[1]*A[2][0]) +
+		b[0]*(A[1][0]*A[2][1]-A[1][1]*A[2][0]))/det;
+	for(i=0;i<3;i++){
+		if(l[i]<=0.0) return -1;
+		lengths[i] = 1.0/sqrt(l[i]);
+	}
+	return 0;
+}
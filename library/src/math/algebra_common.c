@@ -4,6 +4,7 @@
  * see algebra_common.h
  **/
 
+#include <math.h>
 #include "algebra_common.h"
 
 double __vectorized_mult_accumulate(double * __restrict__ a, double * __restrict__ b, int n)
@@ -25,4 +26,61 @@ double __vectorized_square_accumulate(double * __restrict__ a, int n)
 		sum+=a[i]*a[i];
 	}
 	return sum;
-}
\ No newline at end of file
+}
+
+void __vectorized_quaternion_normalize(double * __restrict__ w, double * __restrict__ i,
+		double * __restrict__ j, double * __restrict__ k, int n)
+{
+	int m;
+	double len2, inv;
+	for(m=0;m<n;m++){
+		len2 = w[m]*w[m] + i[m]*i[m] + j[m]*j[m] + k[m]*k[m];
+		// select rather than branch so zero length becomes zero
+		inv = len2>0.0 ? 1.0/sqrt(len2) : 0.0;
+		w[m] *= inv;
+		i[m] *= inv;
+		j[m] *= inv;
+		k[m] *= inv;
+	}
+	return;
+}
+
+
+void __vectorized_quaternion_multiply(const double * __restrict__ aw, const double * __restrict__ ai,
+		const double * __restrict__ aj, const double * __restrict__ ak,
+		const double * __restrict__ bw, const double * __restrict__ bi,
+		const double * __restrict__ bj, const double * __restrict__ bk,
+		double * __restrict__ cw, double * __restrict__ ci,
+		double * __restrict__ cj, double * __restrict__ ck, int n)
+{
+	int m;
+	// same products as rc_quaternion_multiply_array
+	for(m=0;m<n;m++){
+		cw[m] = aw[m]*bw[m] - ai[m]*bi[m] - aj[m]*bj[m] - ak[m]*bk[m];
+		ci[m] = ai[m]*bw[m] + aw[m]*bi[m] - ak[m]*bj[m] + aj[m]*bk[m];
+		cj[m] = aj[m]*bw[m] + ak[m]*bi[m] + aw[m]*bj[m] - ai[m]*bk[m];
+		ck[m] = ak[m]*bw[m] - aj[m]*bi[m] + ai[m]*bj[m] + aw[m]*bk[m];
+	}
+	return;
+}
+
+
+void __vectorized_quaternion_rotate_vector(double * __restrict__ x, double * __restrict__ y,
+		double * __restrict__ z, const double * __restrict__ qw,
+		const double * __restrict__ qi, const double * __restrict__ qj,
+		const double * __restrict__ qk, int n)
+{
+	int m;
+	double tx, ty, tz;
+	for(m=0;m<n;m++){
+		// t = 2 u x v
+		tx = 2.0*(qj[m]*z[m] - qk[m]*y[m]);
+		ty = 2.0*(qk[m]*x[m] - qi[m]*z[m]);
+		tz = 2.0*(qi[m]*y[m] - qj[m]*x[m]);
+		// v' = v + w t + u x t
+		x[m] += qw[m]*tx + qj[m]*tz - qk[m]*ty;
+		y[m] += qw[m]*ty + qk[m]*tx - qi[m]*tz;
+		z[m] += qw[m]*tz + qi[m]*ty - qj[m]*tx;
+	}
+	return;
+}
@@ -35,4 +35,23 @@ double __vectorized_mult_accumulate(double * __restrict__ a, double * __restrict
  */
 double __vectorized_square_accumulate(double * __restrict__ a, int n);
 
+/*
+ * Batch quaternion kernels over structure of arrays, see the *_batch functions
+ * in quaternion.c which check the arguments before calling these. They are
+ * kept in this separate file like the functions above since GCC stops
+ * vectorizing them once they are inlined into the callers.
+ */
+void __vectorized_quaternion_normalize(double * __restrict__ w, double * __restrict__ i,
+		double * __restrict__ j, double * __restrict__ k, int n);
+void __vectorized_quaternion_multiply(const double * __restrict__ aw, const double * __restrict__ ai,
+		const double * __restrict__ aj, const double * __restrict__ ak,
+		const double * __restrict__ bw, const double * __restrict__ bi,
+		const double * __restrict__ bj, const double * __restrict__ bk,
+		double * __restrict__ cw, double * __restrict__ ci,
+		double * __restrict__ cj, double * __restrict__ ck, int n);
+void __vectorized_quaternion_rotate_vector(double * __restrict__ x, double * __restrict__ y,
+		double * __restrict__ z, const double * __restrict__ qw,
+		const double * __restrict__ qi, const double * __restrict__ qj,
+		const double * __restrict__ qk, int n);
+
 #endif // RC_ALGEBRA_COMMON_H
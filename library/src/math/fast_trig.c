@@ -0,0 +1,159 @@
+/**
+ * @file fast_trig.c
+ *
+ * @brief      Polynomial approximations of atan2, asin, sin and cos.
+ *
+ * atan uses the degree 17 odd minimax polynomial from Abramowitz and Stegun
+ * 4.4.49 on [0,1] and the identity atan(x) = pi/2 - atan(1/x) outside of it.
+ * sin and cos reduce the angle to [-pi/4,pi/4] with a two part pi/2 so no
+ * precision is lost in the subtraction, then evaluate short Taylor series
+ * whose truncation error there is below 3.2e-7.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <math.h>
+#include <rc/math/fast_trig.h>
+
+#define PI		3.14159265358979323846
+#define PI_2		1.57079632679489661923
+#define TWO_PI		6.28318530717958647692
+#define TWO_OVER_PI	0.63661977236758134308
+// pi/2 split into a 33 bit head so k*PIO2_HI is exact and the remainder
+#define PIO2_HI		1.57079632673412561417e+00
+#define PIO2_LO		6.07710050650619224932e-11
+
+
+/**
+ * atan of a value in [0,1], Abramowitz and Stegun 4.4.49, |error| < 2e-8
+ */
+static inline double __atan_unit(double x)
+{
+	double x2 = x*x;
+	return x*(1.0 + x2*(-0.3333314528 + x2*(0.1999355085 + x2*(-0.1420889944
+		+ x2*(0.1065626393 + x2*(-0.0752896400 + x2*(0.0429096138
+		+ x2*(-0.0161657367 + x2*0.0028662257))))))));
+}
+
+
+/**
+ * sin and cos of r in [-pi/4,pi/4]
+ */
+static inline double __sin_kernel(double r)
+{
+	double r2 = r*r;
+	return r*(1.0 + r2*(-1.0/6.0 + r2*(1.0/120.0 + r2*(-1.0/5040.0))));
+}
+
+static inline double __cos_kernel(double r)
+{
+	double r2 = r*r;
+	return 1.0 + r2*(-0.5 + r2*(1.0/24.0 + r2*(-1.0/720.0 + r2*(1.0/40320.0))));
+}
+
+
+/**
+ * reduces x to r in [-pi/4,pi/4] and returns the quadrant k so that
+ * x = r + k*pi/2. x must be within RC_FAST_TRIG_MAX_INPUT so that k fits in a
+ * long even when long is 32 bits.
+ */
+static inline long __reduce(double x, double* r)
+{
+	long k = (long)(x*TWO_OVER_PI + (x<0.0 ? -0.5 : 0.5));
+	*r = (x - (double)k*PIO2_HI) - (double)k*PIO2_LO;
+	return k;
+}
+
+
+double rc_fast_atan(double x)
+{
+	if(x>1.0) return PI_2 - __atan_unit(1.0/x);
+	if(x<-1.0) return -PI_2 + __atan_unit(-1.0/x);
+	if(x<0.0) return -__atan_unit(-x);
+	return __atan_unit(x);
+}
+
+
+double rc_fast_atan2(double y, double x)
+{
+	double ax = fabs(x);
+	double ay = fabs(y);
+	double r;
+
+	if(ax<=0.0 && ay<=0.0) return 0.0;
+	// one division with the smaller over the larger keeps the ratio in [0,1]
+	if(ay>ax) r = PI_2 - __atan_unit(ax/ay);
+	else r = __atan_unit(ay/ax);
+	if(x<0.0) r = PI - r;
+	if(y<0.0) r = -r;
+	return r;
+}
+
+
+double rc_fast_asin(double x)
+{
+	if(x>=1.0) return PI_2;
+	if(x<=-1.0) return -PI_2;
+	return rc_fast_atan2(x, sqrt((1.0-x)*(1.0+x)));
+}
+
+
+/**
+ * The quadrant is applied with selects and a sign multiply rather than a
+ * switch since it is effectively random and branches would mispredict.
+ */
+void rc_fast_sincos(double x, double* s, double* c)
+{
+	double r, sr, cr, ss, cs;
+	long k;
+	// also catches NAN since every comparison with it is false, the cast to
+	// long in __reduce would be undefined for either
+	if(!(fabs(x)<=RC_FAST_TRIG_MAX_INPUT)){
+		*s = NAN;
+		*c = NAN;
+		return;
+	}
+	k = __reduce(x, &r);
+	sr = __sin_kernel(r);
+	cr = __cos_kernel(r);
+	// sin is negated in quadrants 2,3 and cos in 1,2
+	ss = (k&2) ? -1.0 : 1.0;
+	cs = ((k+1)&2) ? -1.0 : 1.0;
+	if(k&1){
+		*s = ss*cr;
+		*c = cs*sr;
+	}
+	else{
+		*s = ss*sr;
+		*c = cs*cr;
+	}
+	return;
+}
+
+
+double rc_fast_sin(double x)
+{
+	double s, c;
+	rc_fast_sincos(x, &s, &c);
+	return s;
+}
+
+
+double rc_fast_cos(double x)
+{
+	double s, c;
+	rc_fast_sincos(x, &s, &c);
+	return c;
+}
+
+
+double rc_fast_wrap_pi(double x)
+{
+	double n;
+	if(x>=-PI && x<=PI) return x;
+	if(!(fabs(x)<=RC_FAST_TRIG_MAX_INPUT)) return NAN;
+	// round to the nearest number of whole turns
+	n = (double)(long)(x/TWO_PI + (x<0.0 ? -0.5 : 0.5));
+	return x - n*TWO_PI;
+}
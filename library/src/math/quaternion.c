@@ -10,11 +10,19 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>	// for posix_memalign, free
 #include <math.h>
 
 #include <rc/math/quaternion.h>
 #include "algebra_common.h"
 
+// batch component arrays start on this boundary so SIMD loads are aligned
+#define BATCH_ALIGN	32
+
+// set by rc_quaternion_set_fast_trig
+static int fast_trig = 0;
+
+
 double rc_quaternion_norm(rc_vector_t q)
 {
 	if(unlikely(q.len!=4)){
@@ -95,6 +103,13 @@ int rc_quaternion_to_tb(rc_vector_t q, rc_vector_t* tb)
 }
 
 
+void rc_quaternion_set_fast_trig(int enable)
+{
+	fast_trig = enable ? 1 : 0;
+	return;
+}
+
+
 int rc_quaternion_to_tb_array(double q[4], double tb[3])
 {
 	if(unlikely(q==NULL||tb==NULL)){
@@ -104,6 +119,7 @@ int rc_quaternion_to_tb_array(double q[4], double tb[3])
 	// these functions are done with double precision since they cannot be
 	// accelerated by the NEON unit and the VFP computes doubles at the same
 	// speed as single-precision doubles
+	if(fast_trig) return rc_quaternion_to_tb_array_fast(q, tb);
 	tb[1] = asin(2.0*(q[0]*q[2] - q[1]*q[3]));
 	tb[0] = atan2(2.0*(q[2]*q[3] + q[0]*q[1]),
 		1.0 - 2.0*(q[1]*q[1] + q[2]*q[2]));
@@ -113,6 +129,21 @@ int rc_quaternion_to_tb_array(double q[4], double tb[3])
 }
 
 
+int rc_quaternion_to_tb_array_fast(double q[4], double tb[3])
+{
+	if(unlikely(q==NULL||tb==NULL)){
+		fprintf(stderr,"ERROR: in rc_quaternion_to_tb_array_fast, received NULL pointer\n");
+		return -1;
+	}
+	tb[1] = rc_fast_asin(2.0*(q[0]*q[2] - q[1]*q[3]));
+	tb[0] = rc_fast_atan2(2.0*(q[2]*q[3] + q[0]*q[1]),
+		1.0 - 2.0*(q[1]*q[1] + q[2]*q[2]));
+	tb[2] = rc_fast_atan2(2.0*(q[1]*q[2] + q[0]*q[3]),
+		1.0 - 2.0*(q[2]*q[2] + q[3]*q[3]));
+	return 0;
+}
+
+
 int rc_quaternion_from_tb(rc_vector_t tb, rc_vector_t* q)
 {
 	if(unlikely(!tb.initialized)){
@@ -132,29 +163,44 @@ int rc_quaternion_from_tb(rc_vector_t tb, rc_vector_t* q)
 }
 
 
+/**
+ * quaternion from the sines and cosines of the half angles, shared by the libm
+ * and fast versions of rc_quaternion_from_tb_array
+ */
+static int __quaternion_from_half_angles(double sinX2, double cosX2,
+			double sinY2, double cosY2, double sinZ2, double cosZ2, double q[4])
+{
+	q[0] = cosX2*cosY2*cosZ2 + sinX2*sinY2*sinZ2;
+	q[1] = sinX2*cosY2*cosZ2 - cosX2*sinY2*sinZ2;
+	q[2] = cosX2*sinY2*cosZ2 + sinX2*cosY2*sinZ2;
+	q[3] = cosX2*cosY2*sinZ2 - sinX2*sinY2*cosZ2;
+	return rc_normalize_quaternion_array(q);
+}
+
+
 int rc_quaternion_from_tb_array(double tb[3], double q[4])
 {
-	if(unlikely(q==NULL||q==NULL)){
+	if(unlikely(tb==NULL||q==NULL)){
 		fprintf(stderr,"ERROR: in rc_quaternion_from_tb_array, received NULL pointer\n");
 		return -1;
 	}
+	if(fast_trig) return rc_quaternion_from_tb_array_fast(tb, q);
+	return __quaternion_from_half_angles(sin(tb[0]/2.0), cos(tb[0]/2.0),
+		sin(tb[1]/2.0), cos(tb[1]/2.0), sin(tb[2]/2.0), cos(tb[2]/2.0), q);
+}
 
-	double tbt[3];
-	tbt[0]=tb[0]/2.0;
-	tbt[1]=tb[1]/2.0;
-	tbt[2]=tb[2]/2.0;
-	double cosX2 = cos(tbt[0]);
-	double sinX2 = sin(tbt[0]);
-	double cosY2 = cos(tbt[1]);
-	double sinY2 = sin(tbt[1]);
-	double cosZ2 = cos(tbt[2]);
-	double sinZ2 = sin(tbt[2]);
-	q[0] = cosX2*cosY2*cosZ2 + sinX2*sinY2*sinZ2;
-	q[1] = sinX2*cosY2*cosZ2 - cosX2*sinY2*sinZ2;
-	q[2] = cosX2*sinY2*cosZ2 + sinX2*cosY2*sinZ2;
-	q[3] = cosX2*cosY2*sinZ2 - sinX2*sinY2*cosZ2;
-	rc_normalize_quaternion_array(q);
-	return 0;
+
+int rc_quaternion_from_tb_array_fast(double tb[3], double q[4])
+{
+	double cosX2, sinX2, cosY2, sinY2, cosZ2, sinZ2;
+	if(unlikely(tb==NULL||q==NULL)){
+		fprintf(stderr,"ERROR: in rc_quaternion_from_tb_array_fast, received NULL pointer\n");
+		return -1;
+	}
+	rc_fast_sincos(tb[0]/2.0, &sinX2, &cosX2);
+	rc_fast_sincos(tb[1]/2.0, &sinY2, &cosY2);
+	rc_fast_sincos(tb[2]/2.0, &sinZ2, &cosZ2);
+	return __quaternion_from_half_angles(sinX2, cosX2, sinY2, cosY2, sinZ2, cosZ2, q);
 }
 
 
@@ -479,3 +525,234 @@ int rc_quaternion_to_rotation_matrix(rc_vector_t q, rc_matrix_t* m)
 	m->d[2][1] = 2.0 * (q.d[2]*q.d[3] + q.d[0]*q.d[1]);
 	return 0;
 }
+
+
+/**
+ * Allocates one aligned block holding count component arrays of n doubles,
+ * each padded to a multiple of the alignment, and points arr[] into it.
+ */
+static int __batch_alloc(double** arr, int count, int n)
+{
+	int i, stride;
+	void* ptr;
+	stride = (n*sizeof(double)+BATCH_ALIGN-1)/BATCH_ALIGN*BATCH_ALIGN/sizeof(double);
+	if(unlikely(posix_memalign(&ptr, BATCH_ALIGN, count*stride*sizeof(double)))){
+		return -1;
+	}
+	for(i=0;i<count;i++) arr[i] = (double*)ptr + i*stride;
+	return 0;
+}
+
+
+rc_quaternion_batch_t rc_quaternion_batch_empty(void)
+{
+	rc_quaternion_batch_t b = RC_QUATERNION_BATCH_INITIALIZER;
+	return b;
+}
+
+
+int rc_quaternion_batch_alloc(rc_quaternion_batch_t* b, int n)
+{
+	double* arr[4];
+	// sanity checks
+	if(unlikely(b==NULL)){
+		fprintf(stderr,"ERROR in rc_quaternion_batch_alloc, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(n<1)){
+		fprintf(stderr,"ERROR in rc_quaternion_batch_alloc, n must be >=1\n");
+		return -1;
+	}
+	// if b is already allocated and of the right size, nothing to do!
+	if(b->initialized && b->n==n) return 0;
+	rc_quaternion_batch_free(b);
+	if(unlikely(__batch_alloc(arr, 4, n))){
+		fprintf(stderr,"ERROR in rc_quaternion_batch_alloc, failed to allocate memory\n");
+		return -1;
+	}
+	b->w = arr[0];
+	b->i = arr[1];
+	b->j = arr[2];
+	b->k = arr[3];
+	b->n = n;
+	b->initialized = 1;
+	return 0;
+}
+
+
+int rc_quaternion_batch_free(rc_quaternion_batch_t* b)
+{
+	rc_quaternion_batch_t new = RC_QUATERNION_BATCH_INITIALIZER;
+	if(unlikely(b==NULL)){
+		fprintf(stderr,"ERROR in rc_quaternion_batch_free, received NULL pointer\n");
+		return -1;
+	}
+	// all components share the block starting at w
+	if(b->initialized) free(b->w);
+	*b = new;
+	return 0;
+}
+
+
+rc_quaternion_vec_batch_t rc_quaternion_vec_batch_empty(void)
+{
+	rc_quaternion_vec_batch_t v = RC_QUATERNION_VEC_BATCH_INITIALIZER;
+	return v;
+}
+
+
+int rc_quaternion_vec_batch_alloc(rc_quaternion_vec_batch_t* v, int n)
+{
+	double* arr[3];
+	// sanity checks
+	if(unlikely(v==NULL)){
+		fprintf(stderr,"ERROR in rc_quaternion_vec_batch_alloc, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(n<1)){
+		fprintf(stderr,"ERROR in rc_quaternion_vec_batch_alloc, n must be >=1\n");
+		return -1;
+	}
+	// if v is already allocated and of the right size, nothing to do!
+	if(v->initialized && v->n==n) return 0;
+	rc_quaternion_vec_batch_free(v);
+	if(unlikely(__batch_alloc(arr, 3, n))){
+		fprintf(stderr,"ERROR in rc_quaternion_vec_batch_alloc, failed to allocate memory\n");
+		return -1;
+	}
+	v->x = arr[0];
+	v->y = arr[1];
+	v->z = arr[2];
+	v->n = n;
+	v->initialized = 1;
+	return 0;
+}
+
+
+int rc_quaternion_vec_batch_free(rc_quaternion_vec_batch_t* v)
+{
+	rc_quaternion_vec_batch_t new = RC_QUATERNION_VEC_BATCH_INITIALIZER;
+	if(unlikely(v==NULL)){
+		fprintf(stderr,"ERROR in rc_quaternion_vec_batch_free, received NULL pointer\n");
+		return -1;
+	}
+	// all components share the block starting at x
+	if(v->initialized) free(v->x);
+	*v = new;
+	return 0;
+}
+
+
+/*
+ * The batch functions check their arguments once and then hand the component
+ * arrays to the __vectorized_quaternion_* kernels in algebra_common.c, which
+ * live in their own translation unit with restrict qualified arguments so the
+ * compiler can vectorize them.
+ */
+
+int rc_quaternion_normalize_batch(rc_quaternion_batch_t* q)
+{
+	// sanity checks
+	if(unlikely(q==NULL)){
+		fprintf(stderr,"ERROR in rc_quaternion_normalize_batch, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!q->initialized)){
+		fprintf(stderr,"ERROR in rc_quaternion_normalize_batch, batch uninitialized\n");
+		return -1;
+	}
+	__vectorized_quaternion_normalize(q->w, q->i, q->j, q->k, q->n);
+	return 0;
+}
+
+
+int rc_quaternion_multiply_batch(rc_quaternion_batch_t a, rc_quaternion_batch_t b, rc_quaternion_batch_t* c)
+{
+	// sanity checks
+	if(unlikely(c==NULL)){
+		fprintf(stderr,"ERROR in rc_quaternion_multiply_batch, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!a.initialized || !b.initialized)){
+		fprintf(stderr,"ERROR in rc_quaternion_multiply_batch, batch uninitialized\n");
+		return -1;
+	}
+	if(unlikely(a.n!=b.n)){
+		fprintf(stderr,"ERROR in rc_quaternion_multiply_batch, batches must be the same size\n");
+		return -1;
+	}
+	if(unlikely(c->initialized && (c->w==a.w || c->w==b.w))){
+		fprintf(stderr,"ERROR in rc_quaternion_multiply_batch, c must not be the same batch as a or b\n");
+		return -1;
+	}
+	if(unlikely(rc_quaternion_batch_alloc(c,a.n))){
+		fprintf(stderr,"ERROR in rc_quaternion_multiply_batch, failed to alloc batch\n");
+		return -1;
+	}
+	__vectorized_quaternion_multiply(a.w, a.i, a.j, a.k, b.w, b.i, b.j, b.k,
+					c->w, c->i, c->j, c->k, a.n);
+	return 0;
+}
+
+
+int rc_quaternion_rotate_vector_batch(rc_quaternion_vec_batch_t* v, rc_quaternion_batch_t q)
+{
+	// sanity checks
+	if(unlikely(v==NULL)){
+		fprintf(stderr,"ERROR in rc_quaternion_rotate_vector_batch, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!v->initialized || !q.initialized)){
+		fprintf(stderr,"ERROR in rc_quaternion_rotate_vector_batch, batch uninitialized\n");
+		return -1;
+	}
+	if(unlikely(v->n!=q.n)){
+		fprintf(stderr,"ERROR in rc_quaternion_rotate_vector_batch, batches must be the same size\n");
+		return -1;
+	}
+	__vectorized_quaternion_rotate_vector(v->x, v->y, v->z, q.w, q.i, q.j, q.k, q.n);
+	return 0;
+}
+
+
+int rc_quaternion_to_tb_batch(rc_quaternion_batch_t q, rc_quaternion_vec_batch_t* tb)
+{
+	int n;
+	double s;
+	// sanity checks
+	if(unlikely(tb==NULL)){
+		fprintf(stderr,"ERROR in rc_quaternion_to_tb_batch, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!q.initialized)){
+		fprintf(stderr,"ERROR in rc_quaternion_to_tb_batch, batch uninitialized\n");
+		return -1;
+	}
+	if(unlikely(rc_quaternion_vec_batch_alloc(tb,q.n))){
+		fprintf(stderr,"ERROR in rc_quaternion_to_tb_batch, failed to alloc batch\n");
+		return -1;
+	}
+	// same as rc_quaternion_to_tb_array but with the asin argument clamped
+	// so rounding at +-90 degrees pitch can't produce NaN. This is dominated
+	// by the trig functions so is left scalar.
+	if(fast_trig){
+		for(n=0;n<q.n;n++){
+			tb->y[n] = rc_fast_asin(2.0*(q.w[n]*q.j[n] - q.i[n]*q.k[n]));
+			tb->x[n] = rc_fast_atan2(2.0*(q.j[n]*q.k[n] + q.w[n]*q.i[n]),
+				1.0 - 2.0*(q.i[n]*q.i[n] + q.j[n]*q.j[n]));
+			tb->z[n] = rc_fast_atan2(2.0*(q.i[n]*q.j[n] + q.w[n]*q.k[n]),
+				1.0 - 2.0*(q.j[n]*q.j[n] + q.k[n]*q.k[n]));
+		}
+		return 0;
+	}
+	for(n=0;n<q.n;n++){
+		s = 2.0*(q.w[n]*q.j[n] - q.i[n]*q.k[n]);
+		s = fmin(fmax(s,-1.0),1.0);
+		tb->y[n] = asin(s);
+		tb->x[n] = atan2(2.0*(q.j[n]*q.k[n] + q.w[n]*q.i[n]),
+			1.0 - 2.0*(q.i[n]*q.i[n] + q.j[n]*q.j[n]));
+		tb->z[n] = atan2(2.0*(q.i[n]*q.j[n] + q.w[n]*q.k[n]),
+			1.0 - 2.0*(q.j[n]*q.j[n] + q.k[n]*q.k[n]));
+	}
+	return 0;
+}
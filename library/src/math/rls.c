@@ -0,0 +1,187 @@
+/**
+ * @file rls.c
+ *
+ * @brief      Recursive least squares estimator.
+ *
+ * The update works directly on the rc_matrix_t and rc_vector_t data arrays
+ * allocated by rc_rls_alloc() instead of calling the rc_matrix functions,
+ * which would allocate their results, so an update never touches the heap.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <math.h>
+
+#include <rc/math/rls.h>
+#include "algebra_common.h"
+
+
+rc_rls_t rc_rls_empty(void)
+{
+	rc_rls_t rls = RC_RLS_INITIALIZER;
+	return rls;
+}
+
+
+int rc_rls_alloc(rc_rls_t* rls, int n, double lambda, double delta)
+{
+	// sanity checks
+	if(rls==NULL){
+		fprintf(stderr, "ERROR in rc_rls_alloc, received NULL pointer\n");
+		return -1;
+	}
+	if(n<1){
+		fprintf(stderr, "ERROR in rc_rls_alloc, n must be >= 1\n");
+		return -1;
+	}
+	if(lambda<=0.0 || lambda>1.0){
+		fprintf(stderr, "ERROR in rc_rls_alloc, lambda must be in (0,1]\n");
+		return -1;
+	}
+	if(delta<=0.0){
+		fprintf(stderr, "ERROR in rc_rls_alloc, delta must be > 0\n");
+		return -1;
+	}
+
+	// free existing memory, this also zero's out the struct
+	if(rc_rls_free(rls)==-1) return -1;
+
+	if(rc_vector_zeros(&rls->theta, n)==-1 ||
+	   rc_vector_zeros(&rls->Pphi, n)==-1 ||
+	   rc_matrix_zeros(&rls->P, n, n)==-1){
+		fprintf(stderr, "ERROR in rc_rls_alloc, failed to allocate memory\n");
+		rc_rls_free(rls);
+		return -1;
+	}
+	rls->n = n;
+	rls->lambda = lambda;
+	rls->delta = delta;
+	rls->initialized = 1;
+	return rc_rls_reset(rls);
+}
+
+
+int rc_rls_free(rc_rls_t* rls)
+{
+	rc_rls_t new = RC_RLS_INITIALIZER;
+	// sanity checks
+	if(rls==NULL){
+		fprintf(stderr, "ERROR in rc_rls_free, received NULL pointer\n");
+		return -1;
+	}
+	rc_vector_free(&rls->theta);
+	rc_vector_free(&rls->Pphi);
+	rc_matrix_free(&rls->P);
+	*rls = new;
+	return 0;
+}
+
+
+int rc_rls_reset(rc_rls_t* rls)
+{
+	int i, j;
+	// sanity checks
+	if(unlikely(rls==NULL)){
+		fprintf(stderr, "ERROR in rc_rls_reset, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(rls->initialized!=1)){
+		fprintf(stderr, "ERROR in rc_rls_reset, rls uninitialized\n");
+		return -1;
+	}
+	for(i=0;i<rls->n;i++){
+		rls->theta.d[i] = 0.0;
+		for(j=0;j<rls->n;j++) rls->P.d[i][j] = 0.0;
+		rls->P.d[i][i] = rls->delta;
+	}
+	rls->error = 0.0;
+	rls->step = 0;
+	return 0;
+}
+
+
+int rc_rls_update(rc_rls_t* rls, rc_vector_t phi, double y)
+{
+	int i, j, n;
+	double denom, e, scale, trace;
+	double* Pphi;
+	double** P;
+
+	// sanity checks
+	if(unlikely(rls==NULL)){
+		fprintf(stderr, "ERROR in rc_rls_update, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(rls->initialized!=1)){
+		fprintf(stderr, "ERROR in rc_rls_update, rls uninitialized\n");
+		return -1;
+	}
+	if(unlikely(phi.initialized!=1 || phi.len!=rls->n)){
+		fprintf(stderr, "ERROR in rc_rls_update, phi must be initialized and of length n\n");
+		return -1;
+	}
+	n = rls->n;
+	P = rls->P.d;
+	Pphi = rls->Pphi.d;
+
+	// Pphi = P*phi, denom = lambda + phi'*P*phi, e = y - phi'*theta
+	denom = rls->lambda;
+	e = y;
+	for(i=0;i<n;i++){
+		Pphi[i] = 0.0;
+		for(j=0;j<n;j++) Pphi[i] += P[i][j]*phi.d[j];
+		denom += phi.d[i]*Pphi[i];
+		e -= phi.d[i]*rls->theta.d[i];
+	}
+	if(unlikely(!(denom>0.0))){
+		fprintf(stderr, "ERROR in rc_rls_update, covariance lost positive definiteness\n");
+		return -1;
+	}
+
+	// theta += k*e with gain k = Pphi/denom
+	for(i=0;i<n;i++) rls->theta.d[i] += Pphi[i]*e/denom;
+
+	// only forget while P is no bigger than it started, otherwise a
+	// regressor without new information lets P grow without bound
+	trace = 0.0;
+	for(i=0;i<n;i++) trace += P[i][i] - Pphi[i]*Pphi[i]/denom;
+	if(trace > n*rls->delta) scale = 1.0;
+	else scale = 1.0/rls->lambda;
+
+	// P = (P - Pphi*Pphi'/denom)/lambda, upper triangle mirrored to keep
+	// P exactly symmetric
+	for(i=0;i<n;i++){
+		for(j=i;j<n;j++){
+			P[i][j] = (P[i][j] - Pphi[i]*Pphi[j]/denom)*scale;
+			P[j][i] = P[i][j];
+		}
+	}
+
+	rls->error = e;
+	rls->step++;
+	return 0;
+}
+
+
+int rc_rls_predict(rc_rls_t* rls, rc_vector_t phi, double* y)
+{
+	int i;
+	// sanity checks
+	if(unlikely(rls==NULL || y==NULL)){
+		fprintf(stderr, "ERROR in rc_rls_predict, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(rls->initialized!=1)){
+		fprintf(stderr, "ERROR in rc_rls_predict, rls uninitialized\n");
+		return -1;
+	}
+	if(unlikely(phi.initialized!=1 || phi.len!=rls->n)){
+		fprintf(stderr, "ERROR in rc_rls_predict, phi must be initialized and of length n\n");
+		return -1;
+	}
+	*y = 0.0;
+	for(i=0;i<rls->n;i++) *y += phi.d[i]*rls->theta.d[i];
+	return 0;
+}
@@ -10,6 +10,7 @@
 #include <string.h>
 #include <stdlib.h> // for system()
 #include <rc/model.h>
+#include <rc/sim.h>
 
 #define MODEL_DIR "/proc/device-tree/model"
 #define BUF_SIZE 128
@@ -156,6 +157,8 @@ static void __check_model(void)
 
 rc_model_t rc_model(void)
 {
+	// the simulated devices are laid out like a BeagleBone Blue
+	if(rc_sim_is_enabled()==1) return MODEL_BB_BLUE;
 	if(has_checked) return current_model;
 
 	__check_model();
@@ -165,6 +168,7 @@ rc_model_t rc_model(void)
 
 rc_model_category_t rc_model_category(void)
 {
+	if(rc_sim_is_enabled()==1) return CATEGORY_BEAGLEBONE;
 	if(has_checked) return current_category;
 
 	__check_model();
@@ -5,6 +5,7 @@
  */
 
 #include <stdio.h>
+#include <string.h> // for memset
 #include <rc/motor.h>
 #include <rc/model.h>
 #include <rc/gpio.h>
@@ -46,6 +47,7 @@
 
 #define CHANNELS		4
 #define CHANNELS_POCKET		2
+#define DIR_GROUPS		(CHANNELS*2) // worst case every direction pin on its own chip
 
 
 // polarity of the motor connections
@@ -61,6 +63,67 @@ static int pwmss[CHANNELS];
 static int pwmch[CHANNELS];
 static int channels = 0;
 
+// direction pins are requested as one gpio group per chip so every pin of a
+// chip changes in the same write
+static rc_gpio_group_t dir_group[DIR_GROUPS];
+static int dir_groups = 0;
+static int dirA_group[CHANNELS];
+static int dirA_bit[CHANNELS];
+static int dirB_group[CHANNELS];
+static int dirB_bit[CHANNELS];
+
+
+/**
+ * adds a direction pin to the list for its chip, starting a new list for a
+ * chip not seen yet, and records which group and line it will be
+ */
+static void __assign_dir_pin(int chip, int pin, int pins[][CHANNELS*2], int* lines, int* group, int* bit)
+{
+	int g;
+	for(g=0;g<dir_groups;g++) if(dir_group[g].chip==chip) break;
+	if(g==dir_groups){
+		dir_group[g].chip = chip;
+		lines[g] = 0;
+		dir_groups++;
+	}
+	pins[g][lines[g]] = pin;
+	*group = g;
+	*bit = lines[g];
+	lines[g]++;
+	return;
+}
+
+
+/**
+ * Writes the H-bridge direction pins of one motor, or every motor if motor is
+ * 0, from a and b which are indexed by motor-1. Costs one ioctl per gpio chip
+ * involved rather than two per motor.
+ */
+static int __write_bridges(int motor, const int* a, const int* b)
+{
+	int i, g, first, last;
+	uint64_t mask[DIR_GROUPS], val[DIR_GROUPS];
+
+	first = motor ? motor-1 : 0;
+	last = motor ? motor : channels;
+	memset(mask, 0, sizeof(mask));
+	memset(val, 0, sizeof(val));
+	for(i=first;i<last;i++){
+		mask[dirA_group[i]] |= 1ULL<<dirA_bit[i];
+		if(a[i]) val[dirA_group[i]] |= 1ULL<<dirA_bit[i];
+		mask[dirB_group[i]] |= 1ULL<<dirB_bit[i];
+		if(b[i]) val[dirB_group[i]] |= 1ULL<<dirB_bit[i];
+	}
+	for(g=0;g<dir_groups;g++){
+		if(mask[g]==0) continue;
+		if(unlikely(rc_gpio_group_set_values(&dir_group[g], mask[g], val[g]))){
+			fprintf(stderr,"ERROR in rc_motor, failed to write to gpio chip %d\n", dir_group[g].chip);
+			return -1;
+		}
+	}
+	return 0;
+}
+
 
 
 int rc_motor_init(void)
@@ -71,7 +134,9 @@ int rc_motor_init(void)
 
 int rc_motor_init_freq(int pwm_frequency_hz)
 {
-	int i;
+	int i, g;
+	int pins[DIR_GROUPS][CHANNELS*2];
+	int lines[DIR_GROUPS];
 
 	if(rc_model()==MODEL_BB_POCKET){
 		channels = CHANNELS_POCKET;
@@ -159,14 +224,15 @@ int rc_motor_init_freq(int pwm_frequency_hz)
 		fprintf(stderr,"ERROR in rc_motor_init, failed to set up gpio %d,%d\n", MOT_STBY);
 		return -1;
 	}
+	dir_groups = 0;
 	for(i=0;i<channels;i++){
-		if(unlikely(rc_gpio_init(dirA_chip[i],dirA_pin[i], GPIOHANDLE_REQUEST_OUTPUT))){
-			fprintf(stderr,"ERROR in rc_motor_init, failed to set up gpio %d,%d\n", dirA_chip[i],dirA_pin[i]);
-			return -1;
-		}
-		if(unlikely(rc_gpio_init(dirB_chip[i],dirB_pin[i], GPIOHANDLE_REQUEST_OUTPUT))){
-			fprintf(stderr,"ERROR in rc_motor_init, failed to set up gpio %d,%d\n", dirB_chip[i],dirB_pin[i]);
-			return -1;
+		__assign_dir_pin(dirA_chip[i], dirA_pin[i], pins, lines, &dirA_group[i], &dirA_bit[i]);
+		__assign_dir_pin(dirB_chip[i], dirB_pin[i], pins, lines, &dirB_group[i], &dirB_bit[i]);
+	}
+	for(g=0;g<dir_groups;g++){
+		if(unlikely(rc_gpio_group_init(&dir_group[g], dir_group[g].chip, pins[g], lines[g], GPIOHANDLE_REQUEST_OUTPUT))){
+			fprintf(stderr,"ERROR in rc_motor_init, failed to set up direction pins on gpio chip %d\n", dir_group[g].chip);
+			goto gpio_fail;
 		}
 	}
 
@@ -175,18 +241,25 @@ int rc_motor_init_freq(int pwm_frequency_hz)
 	init_flag = 1;
 	if(unlikely(rc_motor_free_spin(0))){
 		fprintf(stderr,"ERROR in rc_motor_init\n");
-		init_flag = 0;
-		return -1;
+		goto gpio_fail;
 	}
 
 	// make sure standby is off since most users won't use it
 	if(unlikely(rc_gpio_set_value(MOT_STBY,1))){
 		fprintf(stderr,"ERROR in rc_motor_init, can't write to gpio %d,%d\n",MOT_STBY);
-		return -1;
+		goto gpio_fail;
 	}
 	stby_state = 0;
 	init_flag = 1;
 	return 0;
+
+gpio_fail:
+	// give back whatever was requested so a retry can claim the pins again
+	for(i=0;i<g;i++) rc_gpio_group_cleanup(&dir_group[i]);
+	rc_gpio_cleanup(MOT_STBY);
+	dir_groups = 0;
+	init_flag = 0;
+	return -1;
 }
 
 
@@ -200,10 +273,7 @@ int rc_motor_cleanup(void)
 	rc_pwm_cleanup(1);
 	rc_pwm_cleanup(2);
 	rc_gpio_cleanup(MOT_STBY);
-	for(i=0;i<channels;i++){
-		rc_gpio_cleanup(dirA_chip[i],dirA_pin[i]);
-		rc_gpio_cleanup(dirB_chip[i],dirB_pin[i]);
-	}
+	for(i=0;i<dir_groups;i++) rc_gpio_group_cleanup(&dir_group[i]);
 	return 0;
 }
 
@@ -237,7 +307,9 @@ int rc_motor_standby(int standby_en)
 
 int rc_motor_set(int motor, double duty)
 {
-	int a,b,i;
+	int i, first, last;
+	int a[CHANNELS], b[CHANNELS];
+	double d[CHANNELS];
 
 	// sanity checks
 	if(unlikely(motor<0 || motor>channels)){
@@ -253,30 +325,27 @@ int rc_motor_set(int motor, double duty)
 	if	(duty > 1.0)	duty = 1.0;
 	else if	(duty <-1.0)	duty =-1.0;
 
-	if(motor==0){
-		for(i=1;i<=channels;i++){
-			if(rc_motor_set(i,duty)==-1) return -1;
-		}
-		return 0;
+	// determine the direction pins to H-bridge for each motor being set
+	memset(a, 0, sizeof(a));
+	memset(b, 0, sizeof(b));
+	first = motor ? motor-1 : 0;
+	last = motor ? motor : channels;
+	for(i=first;i<last;i++){
+		d[i]=duty*polarity[i];
+		if(d[i]>=0.0){	a[i]=1; b[i]=0;}
+		else{		a[i]=0; b[i]=1; d[i]=-d[i];}
 	}
 
-	// determine the direction pins to H-bridge
-	duty=duty*polarity[motor-1];
-	if(duty>=0.0){	a=1; b=0;}
-	else{		a=0; b=1; duty=-duty;}
-
-	// set gpio and pwm for that motor
-	if(unlikely(rc_gpio_set_value(dirA_chip[motor-1],dirA_pin[motor-1], a))){
-		fprintf(stderr,"ERROR in rc_motor_set, failed to write to gpio pin %d,%d\n",dirA_chip[motor-1],dirA_pin[motor-1]);
+	// set gpio and pwm for those motors
+	if(unlikely(__write_bridges(motor, a, b))){
+		fprintf(stderr,"ERROR in rc_motor_set, failed to set direction pins\n");
 		return -1;
 	}
-	if(unlikely(rc_gpio_set_value(dirB_chip[motor-1],dirB_pin[motor-1], b))){
-		fprintf(stderr,"ERROR in rc_motor_set, failed to write to gpio pin %d,%d\n",dirB_chip[motor-1],dirB_pin[motor-1]);
-		return -1;
-	}
-	if(unlikely(rc_pwm_set_duty(pwmss[motor-1], pwmch[motor-1], duty))){
-		fprintf(stderr,"ERROR in rc_motor_set, failed to write to pwm %d%c\n",pwmss[motor-1], pwmch[motor-1]);
-		return -1;
+	for(i=first;i<last;i++){
+		if(unlikely(rc_pwm_set_duty(pwmss[i], pwmch[i], d[i]))){
+			fprintf(stderr,"ERROR in rc_motor_set, failed to write to pwm %d%c\n",pwmss[i], pwmch[i]);
+			return -1;
+		}
 	}
 	return 0;
 }
@@ -284,7 +353,8 @@ int rc_motor_set(int motor, double duty)
 
 int rc_motor_free_spin(int motor)
 {
-	int i;
+	int i, first, last;
+	int val[CHANNELS];
 
 	// sanity checks
 	if(unlikely(motor<0 || motor>channels)){
@@ -296,26 +366,19 @@ int rc_motor_free_spin(int motor)
 		return -1;
 	}
 
-	// case for all channels
-	if(motor==0){
-		for(i=1;i<=channels;i++){
-			if(rc_motor_free_spin(i)==-1) return -1;
-		}
-		return 0;
-	}
-
-	// set gpio and pwm for that motor
-	if(unlikely(rc_gpio_set_value(dirA_chip[motor-1],dirA_pin[motor-1], 0))){
-		fprintf(stderr,"ERROR in rc_motor_free_spin, failed to write to gpio pin %d,%d\n",dirA_chip[motor-1],dirA_pin[motor-1]);
-		return -1;
-	}
-	if(unlikely(rc_gpio_set_value(dirB_chip[motor-1],dirB_pin[motor-1], 0))){
-		fprintf(stderr,"ERROR in rc_motor_free_spin, failed to write to gpio pin %d,%d\n",dirB_chip[motor-1],dirB_pin[motor-1]);
+	// set gpio and pwm for one or all motors
+	first = motor ? motor-1 : 0;
+	last = motor ? motor : channels;
+	for(i=0;i<CHANNELS;i++) val[i]=0;
+	if(unlikely(__write_bridges(motor, val, val))){
+		fprintf(stderr,"ERROR in rc_motor_free_spin, failed to set direction pins\n");
 		return -1;
 	}
-	if(unlikely(rc_pwm_set_duty(pwmss[motor-1], pwmch[motor-1], 0.0))){
-		fprintf(stderr,"ERROR in rc_motor_free_spin, failed to write to pwm %d%c\n",pwmss[motor-1], pwmch[motor-1]);
-		return -1;
+	for(i=first;i<last;i++){
+		if(unlikely(rc_pwm_set_duty(pwmss[i], pwmch[i], 0.0))){
+			fprintf(stderr,"ERROR in rc_motor_free_spin, failed to write to pwm %d%c\n",pwmss[i], pwmch[i]);
+			return -1;
+		}
 	}
 	return 0;
 }
@@ -323,7 +386,8 @@ int rc_motor_free_spin(int motor)
 
 int rc_motor_brake(int motor)
 {
-	int i;
+	int i, first, last;
+	int val[CHANNELS];
 
 	// sanity checks
 	if(unlikely(motor<0 || motor>channels)){
@@ -335,26 +399,19 @@ int rc_motor_brake(int motor)
 		return -1;
 	}
 
-	// case for all channels
-	if(motor==0){
-		for(i=1;i<=channels;i++){
-			if(rc_motor_brake(i)==-1) return -1;
-		}
-		return 0;
-	}
-
-	// set gpio and pwm for that motor
-	if(unlikely(rc_gpio_set_value(dirA_chip[motor-1],dirA_pin[motor-1], 1))){
-		fprintf(stderr,"ERROR in rc_motor_brake, failed to write to gpio pin %d,%d\n",dirA_chip[motor-1],dirA_pin[motor-1]);
-		return -1;
-	}
-	if(unlikely(rc_gpio_set_value(dirB_chip[motor-1],dirB_pin[motor-1], 1))){
-		fprintf(stderr,"ERROR in rc_motor_brake, failed to write to gpio pin %d,%d\n",dirB_chip[motor-1],dirB_pin[motor-1]);
+	// set gpio and pwm for one or all motors
+	first = motor ? motor-1 : 0;
+	last = motor ? motor : channels;
+	for(i=0;i<CHANNELS;i++) val[i]=1;
+	if(unlikely(__write_bridges(motor, val, val))){
+		fprintf(stderr,"ERROR in rc_motor_brake, failed to set direction pins\n");
 		return -1;
 	}
-	if(unlikely(rc_pwm_set_duty(pwmss[motor-1], pwmch[motor-1], 0.0))){
-		fprintf(stderr,"ERROR in rc_motor_brake, failed to write to pwm %d%c\n",pwmss[motor-1], pwmch[motor-1]);
-		return -1;
+	for(i=first;i<last;i++){
+		if(unlikely(rc_pwm_set_duty(pwmss[i], pwmch[i], 0.0))){
+			fprintf(stderr,"ERROR in rc_motor_brake, failed to write to pwm %d%c\n",pwmss[i], pwmch[i]);
+			return -1;
+		}
 	}
 	return 0;
 }
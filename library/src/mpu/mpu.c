@@ -25,8 +25,10 @@
 #include <rc/math/vector.h>
 #include <rc/math/matrix.h>
 #include <rc/math/quaternion.h>
+#include <rc/math/fast_trig.h>
 #include <rc/math/filter.h>
 #include <rc/math/algebra.h>
+#include <rc/math/ahrs.h>
 #include <rc/time.h>
 #include <rc/gpio.h>
 #include <rc/i2c.h>
@@ -75,81 +77,184 @@
 #define ACCEL_CAL_THRESH	100	// std dev below which to consider still
 #define GYRO_OFFSET_THRESH	500
 
-// Thread control
-static pthread_mutex_t read_mutex	= PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t  read_condition	= PTHREAD_COND_INITIALIZER;
-static pthread_mutex_t tap_mutex	= PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t  tap_condition	= PTHREAD_COND_INITIALIZER;
+/**
+ * One entry in the subscriber registry, see rc_mpu_subscribe. Queued
+ * subscribers have a ring buffer of samples and their own thread, inline ones
+ * only use func, ctx, conf, and stats.
+ */
+typedef struct __subscriber_t{
+	int state;			// SUB_FREE, SUB_ACTIVE, or SUB_CLOSING
+	int busy;			// inline func is running, the slot can't be freed
+	int release;			// unsubscribed from inside its own inline func
+	rc_mpu_subscriber_func_t func;
+	void* ctx;
+	rc_mpu_subscriber_config_t conf;
+	rc_mpu_subscriber_stats_t stats;
+	rc_mpu_data_t* queue;
+	int head;			// index of oldest queued sample
+	int count;			// number of queued samples
+	int running;			// cleared to stop the subscriber thread
+	pthread_t thread;
+	pthread_mutex_t mutex;		// protects queue and stats of queued subscribers
+	pthread_cond_t cond;
+} __subscriber_t;
+
+#define SUB_FREE	0
+#define SUB_ACTIVE	1
+#define SUB_CLOSING	2
 
 /**
-*	Local variables
-**/
-static rc_mpu_config_t config;
-static int bypass_en;
-static int dmp_en=0;
-static int packet_len;
-static pthread_t imu_interrupt_thread;
-static int thread_running_flag;
-static void (*dmp_callback_func)()=NULL;
-static void (*tap_callback_func)(int dir, int cnt)=NULL;
-static double mag_factory_adjust[3];
-static double mag_offsets[3];
-static double mag_scales[3];
-static double accel_lengths[3];
-static int last_read_successful;
-static uint64_t last_interrupt_timestamp_nanos;
-static uint64_t last_tap_timestamp_nanos;
-static rc_mpu_data_t* data_ptr;
-static int imu_shutdown_flag = 0;
-static rc_filter_t low_pass, high_pass; // for magnetometer Yaw filtering
-static int was_last_steady = 0;
-static double startMagYaw = 0.0;
+ * All state for one MPU. The legacy API without an instance argument operates
+ * on default_mpu so existing programs behave exactly as before.
+ */
+struct rc_mpu_t{
+	rc_mpu_config_t config;
+	int bypass_en;
+	int mag_i2c_master_en;
+	int dmp_en;
+	int ahrs_en;
+	int packet_len;
+	pthread_t imu_interrupt_thread;
+	int thread_running_flag;
+	void (*dmp_callback_func)(void);
+	void (*tap_callback_func)(int dir, int cnt);
+	double mag_factory_adjust[3];
+	double mag_offsets[3];
+	double mag_scales[3];
+	double accel_lengths[3];
+	double accel_center[3];		// offsets loaded from the calibration file (G)
+	int last_read_successful;
+	uint64_t last_interrupt_timestamp_nanos;
+	uint64_t last_tap_timestamp_nanos;
+	rc_mpu_data_t* data_ptr;
+	int imu_shutdown_flag;
+	rc_filter_t low_pass, high_pass;	// for magnetometer Yaw filtering
+	int was_last_steady;
+	double startMagYaw;
+	// yaw unwrapping state for __data_fusion
+	double newMagYaw;
+	double newDMPYaw;
+	int dmp_spin_counter;
+	int mag_spin_counter;
+	int fusion_first_run;
+	int fifo_first_run;
+	// software orientation filters for AHRS mode, 6 and 9 axis
+	rc_ahrs_t ahrs_imu;
+	rc_ahrs_t ahrs_marg;
+	// calibration file paths, see __set_cal_file_paths
+	char gyro_cal_file[128];
+	char accel_cal_file[128];
+	char mag_cal_file[128];
+	rc_mpu_data_t published_data;		// seqlock protected copy of data_ptr
+	volatile uint32_t published_seq;	// odd while published_data is being written
+	rc_mpu_init_timing_t init_timing;	// phase durations of the last initialization
+	// subscriber registry, sub_mutex protects the state of every slot and
+	// the stats of inline subscribers. Inline functions are called without
+	// it, sub_cond is signalled each time one returns.
+	__subscriber_t subscribers[RC_MPU_MAX_SUBSCRIBERS];
+	pthread_mutex_t sub_mutex;
+	pthread_cond_t sub_cond;
+	pthread_t dispatch_thread;
+	// background calibration fits, cal_mutex protects these and the
+	// magnetometer offsets and scales while mag_online_cal is enabled
+	rc_ellipsoid_fit_t mag_fit;
+	rc_ellipsoid_fit_t accel_fit;
+	double mag_fit_last[3];
+	double accel_fit_last[3];
+	pthread_mutex_t cal_mutex;
+	// Thread control
+	pthread_mutex_t read_mutex;
+	pthread_cond_t  read_condition;
+	pthread_mutex_t tap_mutex;
+	pthread_cond_t  tap_condition;
+};
+
+#define RC_MPU_INSTANCE_INITIALIZER {\
+	.dmp_en = 0,\
+	.ahrs_en = 0,\
+	.ahrs_imu = RC_AHRS_INITIALIZER,\
+	.ahrs_marg = RC_AHRS_INITIALIZER,\
+	.mag_i2c_master_en = 0,\
+	.imu_shutdown_flag = 0,\
+	.dmp_callback_func = NULL,\
+	.tap_callback_func = NULL,\
+	.low_pass = RC_FILTER_INITIALIZER,\
+	.high_pass = RC_FILTER_INITIALIZER,\
+	.fusion_first_run = 1,\
+	.fifo_first_run = 1,\
+	.read_mutex = PTHREAD_MUTEX_INITIALIZER,\
+	.read_condition = PTHREAD_COND_INITIALIZER,\
+	.tap_mutex = PTHREAD_MUTEX_INITIALIZER,\
+	.tap_condition = PTHREAD_COND_INITIALIZER,\
+	.sub_mutex = PTHREAD_MUTEX_INITIALIZER,\
+	.sub_cond = PTHREAD_COND_INITIALIZER,\
+	.mag_fit = RC_ELLIPSOID_FIT_INITIALIZER,\
+	.accel_fit = RC_ELLIPSOID_FIT_INITIALIZER,\
+	.cal_mutex = PTHREAD_MUTEX_INITIALIZER}
+
+static rc_mpu_t default_mpu = RC_MPU_INSTANCE_INITIALIZER;
 
 /**
 * functions for internal use only
 **/
-static int __reset_mpu(void);
-static int __check_who_am_i(void);
-static int __set_gyro_fsr(rc_mpu_gyro_fsr_t fsr, rc_mpu_data_t* data);
-static int __set_accel_fsr(rc_mpu_accel_fsr_t, rc_mpu_data_t* data);
-static int __set_gyro_dlpf(rc_mpu_gyro_dlpf_t dlpf);
-static int __set_accel_dlpf(rc_mpu_accel_dlpf_t dlpf);
-static int __init_magnetometer(int cal_mode);
-static int __power_off_magnetometer(void);
-static int __mpu_set_bypass(unsigned char bypass_on);
-static int __mpu_write_mem(unsigned short mem_addr, unsigned short length, unsigned char *data);
-static int __mpu_read_mem(unsigned short mem_addr, unsigned short length, unsigned char *data);
-static int __dmp_load_motion_driver_firmware(void);
-static int __dmp_set_orientation(unsigned short orient);
-static int __dmp_enable_gyro_cal(unsigned char enable);
-static int __dmp_enable_lp_quat(unsigned char enable);
-static int __dmp_enable_6x_lp_quat(unsigned char enable);
-static int __dmp_set_tap_thresh(unsigned char axis, unsigned short thresh);
-static int __dmp_set_tap_axes(unsigned char axis);
-static int __dmp_set_tap_count(unsigned char min_taps);
-static int __dmp_set_tap_time(unsigned short time);
-static int __dmp_set_tap_time_multi(unsigned short time);
-static int __dmp_set_shake_reject_thresh(long sf, unsigned short thresh);
-static int __dmp_set_shake_reject_time(unsigned short time);
-static int __dmp_set_shake_reject_timeout(unsigned short time);
-static int __collect_accel_samples(int* avg_raw);
-static int __mpu_reset_fifo(void);
-static int __mpu_set_sample_rate(int rate);
-static int __dmp_set_fifo_rate(unsigned short rate);
-static int __dmp_enable_feature(unsigned short mask);
-static int __mpu_set_dmp_state(unsigned char enable);
-static int __set_int_enable(unsigned char enable);
-static int __dmp_set_interrupt_mode(unsigned char mode);
-static int __load_gyro_calibration(void);
-static int __load_mag_calibration(void);
-static int __load_accel_calibration(void);
-static int __write_gyro_cal_to_disk(int16_t offsets[3]);
-static int __write_mag_cal_to_disk(double offsets[3], double scale[3]);
-static int __write_accel_cal_to_disk(double* center, double* lengths);
+static int __reset_mpu(rc_mpu_t* mpu);
+static int __check_who_am_i(rc_mpu_t* mpu);
+static int __set_gyro_fsr(rc_mpu_t* mpu, rc_mpu_gyro_fsr_t fsr, rc_mpu_data_t* data);
+static int __set_accel_fsr(rc_mpu_t* mpu, rc_mpu_accel_fsr_t, rc_mpu_data_t* data);
+static int __set_gyro_dlpf(rc_mpu_t* mpu, rc_mpu_gyro_dlpf_t dlpf);
+static int __set_accel_dlpf(rc_mpu_t* mpu, rc_mpu_accel_dlpf_t dlpf);
+static int __init_magnetometer(rc_mpu_t* mpu, int cal_mode);
+static int __power_off_magnetometer(rc_mpu_t* mpu);
+static int __mag_enable_i2c_master(rc_mpu_t* mpu);
+static int __mag_disable_i2c_master(rc_mpu_t* mpu);
+static int __mag_parse_raw(rc_mpu_t* mpu, uint8_t st1, uint8_t raw[7], rc_mpu_data_t* data);
+static int __mpu_set_bypass(rc_mpu_t* mpu, unsigned char bypass_on);
+static int __mpu_write_mem(rc_mpu_t* mpu, unsigned short mem_addr, unsigned short length, unsigned char *data);
+static int __mpu_read_mem(rc_mpu_t* mpu, unsigned short mem_addr, unsigned short length, unsigned char *data);
+static int __dmp_load_motion_driver_firmware(rc_mpu_t* mpu);
+static int __dmp_set_orientation(rc_mpu_t* mpu, unsigned short orient);
+static int __dmp_enable_gyro_cal(rc_mpu_t* mpu, unsigned char enable);
+static int __dmp_enable_lp_quat(rc_mpu_t* mpu, unsigned char enable);
+static int __dmp_enable_6x_lp_quat(rc_mpu_t* mpu, unsigned char enable);
+static int __dmp_set_tap_thresh(rc_mpu_t* mpu, unsigned char axis, unsigned short thresh);
+static int __dmp_set_tap_axes(rc_mpu_t* mpu, unsigned char axis);
+static int __dmp_set_tap_count(rc_mpu_t* mpu, unsigned char min_taps);
+static int __dmp_set_tap_time(rc_mpu_t* mpu, unsigned short time);
+static int __dmp_set_tap_time_multi(rc_mpu_t* mpu, unsigned short time);
+static int __dmp_set_shake_reject_thresh(rc_mpu_t* mpu, long sf, unsigned short thresh);
+static int __dmp_set_shake_reject_time(rc_mpu_t* mpu, unsigned short time);
+static int __dmp_set_shake_reject_timeout(rc_mpu_t* mpu, unsigned short time);
+static int __collect_accel_samples(rc_mpu_t* mpu, int* avg_raw);
+static int __mpu_reset_fifo(rc_mpu_t* mpu);
+static int __mpu_set_sample_rate(rc_mpu_t* mpu, int rate);
+static int __dmp_set_fifo_rate(rc_mpu_t* mpu, unsigned short rate);
+static int __dmp_enable_feature(rc_mpu_t* mpu, unsigned short mask);
+static int __mpu_set_dmp_state(rc_mpu_t* mpu, unsigned char enable);
+static int __set_int_enable(rc_mpu_t* mpu, unsigned char enable);
+static int __dmp_set_interrupt_mode(rc_mpu_t* mpu, unsigned char mode);
+static int __load_gyro_calibration(rc_mpu_t* mpu);
+static int __load_mag_calibration(rc_mpu_t* mpu);
+static int __load_accel_calibration(rc_mpu_t* mpu);
+static int __write_gyro_cal_to_disk(rc_mpu_t* mpu, int16_t offsets[3]);
+static int __write_mag_cal_to_disk(rc_mpu_t* mpu, double offsets[3], double scale[3]);
+static int __write_accel_cal_to_disk(rc_mpu_t* mpu, double* center, double* lengths);
 static void* __dmp_interrupt_handler(void* ptr);
-static int __read_dmp_fifo(rc_mpu_data_t* data);
-static int __data_fusion(rc_mpu_data_t* data);
-static int __mag_correct_orientation(double mag_vec[3]);
+static int __read_dmp_fifo(rc_mpu_t* mpu, rc_mpu_data_t* data, int read_mag);
+static void __quat_to_tb(rc_mpu_t* mpu, double q[4], double tb[3]);
+static void __tb_to_quat(rc_mpu_t* mpu, double tb[3], double q[4]);
+static int __data_fusion(rc_mpu_t* mpu, rc_mpu_data_t* data);
+static int __correct_orientation(rc_mpu_t* mpu, double in[3], double out[3]);
+static int __read_ahrs_sample(rc_mpu_t* mpu, rc_mpu_data_t* data, int read_mag);
+static void __publish_data(rc_mpu_t* mpu, rc_mpu_data_t* data);
+static void __set_cal_file_paths(rc_mpu_t* mpu);
+static void __dispatch_subscribers(rc_mpu_t* mpu, rc_mpu_data_t* data);
+static void __online_cal_init(rc_mpu_t* mpu);
+static void __online_cal_add(rc_ellipsoid_fit_t* fit, double last[3], const double p[3], double spacing);
+static void __online_cal_accel(rc_mpu_t* mpu, rc_mpu_data_t* data);
+static void* __subscriber_thread(void* ptr);
+static int __poll_bits_clear(rc_mpu_t* mpu, uint8_t reg, uint8_t mask, int timeout_us);
+static int __mag_wait_ready(rc_mpu_t* mpu);
+static int __dmp_load_firmware_fast(rc_mpu_t* mpu);
 
 
 rc_mpu_config_t rc_mpu_default_config(void)
@@ -162,6 +267,7 @@ rc_mpu_config_t rc_mpu_default_config(void)
 	conf.i2c_bus = RC_IMU_BUS;
 	conf.i2c_addr = RC_MPU_DEFAULT_I2C_ADDR;
 	conf.show_warnings = 0;
+	conf.fast_start = 0;
 
 	// general stuff
 	conf.accel_fsr	= ACCEL_FSR_8G;
@@ -169,6 +275,10 @@ rc_mpu_config_t rc_mpu_default_config(void)
 	conf.accel_dlpf	= ACCEL_DLPF_184;
 	conf.gyro_dlpf	= GYRO_DLPF_184;
 	conf.enable_magnetometer = 0;
+	conf.mag_use_i2c_master = 0;
+	conf.mag_online_cal = 0;
+	conf.accel_online_cal = 0;
+	conf.fast_trig = 0;
 
 	// DMP stuff
 	conf.dmp_sample_rate = 100;
@@ -182,6 +292,13 @@ rc_mpu_config_t rc_mpu_default_config(void)
 	conf.mag_sample_rate_div = 4;
 	conf.tap_threshold=210;
 
+	// AHRS stuff
+	conf.ahrs_type = RC_AHRS_MAHONY;
+	conf.ahrs_sample_rate = 500;
+	conf.ahrs_kp = 1.0;
+	conf.ahrs_ki = 0.0;
+	conf.ahrs_beta = 0.1;
+
 	return conf;
 }
 
@@ -193,106 +310,279 @@ int rc_mpu_set_config_to_default(rc_mpu_config_t *conf)
 }
 
 
-int rc_mpu_initialize(rc_mpu_data_t *data, rc_mpu_config_t conf)
+rc_mpu_t* rc_mpu_instance_create(void)
 {
-	// update local copy of config struct with new values
-	config=conf;
+	rc_mpu_t* mpu;
+	mpu = calloc(1, sizeof(rc_mpu_t));
+	if(mpu==NULL){
+		perror("ERROR in rc_mpu_instance_create, failed to allocate memory");
+		return NULL;
+	}
+	mpu->low_pass = rc_filter_empty();
+	mpu->high_pass = rc_filter_empty();
+	mpu->fusion_first_run = 1;
+	mpu->fifo_first_run = 1;
+	pthread_mutex_init(&mpu->read_mutex, NULL);
+	pthread_cond_init(&mpu->read_condition, NULL);
+	pthread_mutex_init(&mpu->tap_mutex, NULL);
+	pthread_cond_init(&mpu->tap_condition, NULL);
+	pthread_mutex_init(&mpu->sub_mutex, NULL);
+	pthread_cond_init(&mpu->sub_cond, NULL);
+	pthread_mutex_init(&mpu->cal_mutex, NULL);
+	return mpu;
+}
+
 
-	// make sure the bus is not currently in use by another thread
-	// do not proceed to prevent interfering with that process
-	if(rc_i2c_get_lock(config.i2c_bus)){
-		printf("i2c bus claimed by another process\n");
-		printf("Continuing with rc_mpu_initialize() anyway.\n");
+int rc_mpu_instance_destroy(rc_mpu_t* mpu)
+{
+	if(mpu==NULL){
+		fprintf(stderr,"ERROR in rc_mpu_instance_destroy, received NULL pointer\n");
+		return -1;
+	}
+	if(mpu==&default_mpu){
+		fprintf(stderr,"ERROR in rc_mpu_instance_destroy, can't destroy the default instance\n");
+		return -1;
 	}
+	if(mpu->thread_running_flag) rc_mpu_instance_power_off(mpu);
+	rc_filter_free(&mpu->low_pass);
+	rc_filter_free(&mpu->high_pass);
+	pthread_mutex_destroy(&mpu->read_mutex);
+	pthread_cond_destroy(&mpu->read_condition);
+	pthread_mutex_destroy(&mpu->tap_mutex);
+	pthread_cond_destroy(&mpu->tap_condition);
+	pthread_mutex_destroy(&mpu->sub_mutex);
+	pthread_cond_destroy(&mpu->sub_cond);
+	pthread_mutex_destroy(&mpu->cal_mutex);
+	free(mpu);
+	return 0;
+}
+
+
+rc_mpu_t* rc_mpu_default_instance(void)
+{
+	return &default_mpu;
+}
+
+
+int rc_mpu_initialize(rc_mpu_data_t *data, rc_mpu_config_t conf)
+{
+	return rc_mpu_instance_initialize(&default_mpu, data, conf);
+}
+
+
+int rc_mpu_read_accel(rc_mpu_data_t *data)
+{
+	return rc_mpu_instance_read_accel(&default_mpu, data);
+}
+
+
+int rc_mpu_read_gyro(rc_mpu_data_t *data)
+{
+	return rc_mpu_instance_read_gyro(&default_mpu, data);
+}
+
+
+int rc_mpu_read_mag(rc_mpu_data_t* data)
+{
+	return rc_mpu_instance_read_mag(&default_mpu, data);
+}
+
+
+int rc_mpu_read_temp(rc_mpu_data_t* data)
+{
+	return rc_mpu_instance_read_temp(&default_mpu, data);
+}
+
+
+int rc_mpu_power_off(void)
+{
+	return rc_mpu_instance_power_off(&default_mpu);
+}
+
+
+int rc_mpu_get_init_timing(rc_mpu_init_timing_t* timing)
+{
+	return rc_mpu_instance_get_init_timing(&default_mpu, timing);
+}
+
+
+int rc_mpu_initialize_dmp(rc_mpu_data_t *data, rc_mpu_config_t conf)
+{
+	return rc_mpu_instance_initialize_dmp(&default_mpu, data, conf);
+}
+
+
+int rc_mpu_initialize_ahrs(rc_mpu_data_t *data, rc_mpu_config_t conf)
+{
+	return rc_mpu_instance_initialize_ahrs(&default_mpu, data, conf);
+}
+
+
+int rc_mpu_set_dmp_callback(void (*func)(void))
+{
+	return rc_mpu_instance_set_dmp_callback(&default_mpu, func);
+}
+
+
+int rc_mpu_set_tap_callback(void (*func)(int dir, int cnt))
+{
+	return rc_mpu_instance_set_tap_callback(&default_mpu, func);
+}
+
+
+int rc_mpu_block_until_dmp_data(void)
+{
+	return rc_mpu_instance_block_until_dmp_data(&default_mpu);
+}
+
+
+int64_t rc_mpu_nanos_since_last_dmp_interrupt(void)
+{
+	return rc_mpu_instance_nanos_since_last_dmp_interrupt(&default_mpu);
+}
+
+
+int rc_mpu_get_latest(rc_mpu_data_t* out)
+{
+	return rc_mpu_instance_get_latest(&default_mpu, out);
+}
+
+
+int rc_mpu_subscribe(rc_mpu_subscriber_func_t func, void* ctx, rc_mpu_subscriber_config_t conf)
+{
+	return rc_mpu_instance_subscribe(&default_mpu, func, ctx, conf);
+}
+
+
+int rc_mpu_unsubscribe(int id)
+{
+	return rc_mpu_instance_unsubscribe(&default_mpu, id);
+}
+
+
+int rc_mpu_get_subscriber_stats(int id, rc_mpu_subscriber_stats_t* stats)
+{
+	return rc_mpu_instance_get_subscriber_stats(&default_mpu, id, stats);
+}
+
+
+int rc_mpu_block_until_tap(void)
+{
+	return rc_mpu_instance_block_until_tap(&default_mpu);
+}
+
 
-	// if it is not claimed, start the i2c bus
-	if(rc_i2c_init(config.i2c_bus, config.i2c_addr)<0){
+int64_t rc_mpu_nanos_since_last_tap(void)
+{
+	return rc_mpu_instance_nanos_since_last_tap(&default_mpu);
+}
+
+
+int rc_mpu_get_online_calibration(rc_mpu_online_cal_t* cal)
+{
+	return rc_mpu_instance_get_online_calibration(&default_mpu, cal);
+}
+
+
+int rc_mpu_save_online_calibration(void)
+{
+	return rc_mpu_instance_save_online_calibration(&default_mpu);
+}
+
+
+int rc_mpu_instance_initialize(rc_mpu_t* mpu, rc_mpu_data_t *data, rc_mpu_config_t conf)
+{
+	// update local copy of config struct with new values
+	mpu->config=conf;
+	__set_cal_file_paths(mpu);
+	__online_cal_init(mpu);
+
+	// start the i2c bus
+	if(rc_i2c_init(mpu->config.i2c_bus, mpu->config.i2c_addr)<0){
 		fprintf(stderr,"failed to initialize i2c bus\n");
 		return -1;
 	}
-	// claiming the bus does no guarantee other code will not interfere
-	// with this process, but best to claim it so other code can check
-	// like we did above
-	rc_i2c_lock_bus(config.i2c_bus);
+	// claim the bus, this waits for other threads and processes to finish
+	// with it, then make sure the address is still ours
+	rc_i2c_lock_bus(mpu->config.i2c_bus);
+	rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
 
 	// restart the device so we start with clean registers
-	if(__reset_mpu()<0){
+	if(__reset_mpu(mpu)<0){
 		fprintf(stderr,"ERROR: failed to reset_mpu9250\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
-	if(__check_who_am_i()){
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+	if(__check_who_am_i(mpu)){
+		goto unlock_fail;
 	}
 
 	// load in gyro calibration offsets from disk
-	if(__load_gyro_calibration()<0){
+	if(__load_gyro_calibration(mpu)<0){
 		fprintf(stderr,"ERROR: failed to load gyro calibration offsets\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
-	if(__load_accel_calibration()<0){
+	if(__load_accel_calibration(mpu)<0){
 		fprintf(stderr,"ERROR: failed to load accel calibration offsets\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
 
 	// Set sample rate = 1000/(1 + SMPLRT_DIV)
 	// here we use a divider of 0 for 1khz sample
-	if(rc_i2c_write_byte(config.i2c_bus, SMPLRT_DIV, 0x00)){
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, SMPLRT_DIV, 0x00)){
 		fprintf(stderr,"I2C bus write error\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
 
 	// set full scale ranges and filter constants
-	if(__set_gyro_fsr(conf.gyro_fsr, data)){
+	if(__set_gyro_fsr(mpu, conf.gyro_fsr, data)){
 		fprintf(stderr,"failed to set gyro fsr\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
-	if(__set_accel_fsr(conf.accel_fsr, data)){
+	if(__set_accel_fsr(mpu, conf.accel_fsr, data)){
 		fprintf(stderr,"failed to set accel fsr\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
-	if(__set_gyro_dlpf(conf.gyro_dlpf)){
+	if(__set_gyro_dlpf(mpu, conf.gyro_dlpf)){
 		fprintf(stderr,"failed to set gyro dlpf\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
-	if(__set_accel_dlpf(conf.accel_dlpf)){
+	if(__set_accel_dlpf(mpu, conf.accel_dlpf)){
 		fprintf(stderr,"failed to set accel_dlpf\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
 
 	// initialize the magnetometer too if requested in config
 	if(conf.enable_magnetometer){
 		// start magnetometer NOT in cal mode (0)
-		if(__init_magnetometer(0)){
+		if(__init_magnetometer(mpu, 0)){
 			fprintf(stderr,"failed to initialize magnetometer\n");
-			rc_i2c_unlock_bus(config.i2c_bus);
-			return -1;
+			goto unlock_fail;
+		}
+		if(conf.mag_use_i2c_master && __mag_enable_i2c_master(mpu)){
+			fprintf(stderr,"failed to start magnetometer i2c master sampling\n");
+			goto unlock_fail;
 		}
 	}
-	else __power_off_magnetometer();
+	else __power_off_magnetometer(mpu);
 
 	// all done!!
-	rc_i2c_unlock_bus(config.i2c_bus);
+	rc_i2c_unlock_bus(mpu->config.i2c_bus);
 	return 0;
+
+unlock_fail:
+	rc_i2c_unlock_bus(mpu->config.i2c_bus);
+	return -1;
 }
 
 
-int rc_mpu_read_accel(rc_mpu_data_t *data)
+int rc_mpu_instance_read_accel(rc_mpu_t* mpu, rc_mpu_data_t *data)
 {
 	// new register data stored here
 	uint8_t raw[6];
 	// set the device address
-	rc_i2c_set_device_address(config.i2c_bus, config.i2c_addr);
+	rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
 	// Read the six raw data registers into data array
-	if(rc_i2c_read_bytes(config.i2c_bus, ACCEL_XOUT_H, 6, &raw[0])<0){
+	if(rc_i2c_read_bytes(mpu->config.i2c_bus, ACCEL_XOUT_H, 6, &raw[0])<0){
 		return -1;
 	}
 	// Turn the MSB and LSB into a signed 16-bit value
@@ -300,21 +590,21 @@ int rc_mpu_read_accel(rc_mpu_data_t *data)
 	data->raw_accel[1] = (int16_t)(((uint16_t)raw[2]<<8)|raw[3]);
 	data->raw_accel[2] = (int16_t)(((uint16_t)raw[4]<<8)|raw[5]);
 	// Fill in real unit values and apply calibration
-	data->accel[0] = data->raw_accel[0] * data->accel_to_ms2 / accel_lengths[0];
-	data->accel[1] = data->raw_accel[1] * data->accel_to_ms2 / accel_lengths[1];
-	data->accel[2] = data->raw_accel[2] * data->accel_to_ms2 / accel_lengths[2];
+	data->accel[0] = data->raw_accel[0] * data->accel_to_ms2 / mpu->accel_lengths[0];
+	data->accel[1] = data->raw_accel[1] * data->accel_to_ms2 / mpu->accel_lengths[1];
+	data->accel[2] = data->raw_accel[2] * data->accel_to_ms2 / mpu->accel_lengths[2];
 	return 0;
 }
 
 
-int rc_mpu_read_gyro(rc_mpu_data_t *data)
+int rc_mpu_instance_read_gyro(rc_mpu_t* mpu, rc_mpu_data_t *data)
 {
 	// new register data stored here
 	uint8_t raw[6];
 	// set the device address
-	rc_i2c_set_device_address(config.i2c_bus, config.i2c_addr);
+	rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
 	// Read the six raw data registers into data array
-	if(rc_i2c_read_bytes(config.i2c_bus, GYRO_XOUT_H, 6, &raw[0])<0){
+	if(rc_i2c_read_bytes(mpu->config.i2c_bus, GYRO_XOUT_H, 6, &raw[0])<0){
 		return -1;
 	}
 	// Turn the MSB and LSB into a signed 16-bit value
@@ -329,48 +619,69 @@ int rc_mpu_read_gyro(rc_mpu_data_t *data)
 }
 
 
-int rc_mpu_read_mag(rc_mpu_data_t* data)
+int rc_mpu_instance_read_mag(rc_mpu_t* mpu, rc_mpu_data_t* data)
 {
-	uint8_t raw[7];
-	int16_t adc[3];
-	double factory_cal_data[3];
-	if(!config.enable_magnetometer){
+	uint8_t raw[8];
+	rc_i2c_read_t reads[1];
+	if(!mpu->config.enable_magnetometer){
 		fprintf(stderr,"ERROR: can't read magnetometer unless it is enabled in \n");
 		fprintf(stderr,"rc_mpu_config_t struct before calling rc_mpu_initialize\n");
 		return -1;
 	}
+	// with the internal i2c master running, ST1 through ST2 have already been
+	// copied into EXT_SENS_DATA_00-07 so grab them all in one burst from
+	// the MPU itself without touching the slave address
+	if(mpu->mag_i2c_master_en){
+		if(unlikely(rc_i2c_read_bytes(mpu->config.i2c_bus, EXT_SENS_DATA_00, 8, &raw[0])<0)){
+			fprintf(stderr,"ERROR: rc_mpu_read_mag failed to read EXT_SENS_DATA registers\n");
+			return -1;
+		}
+		return __mag_parse_raw(mpu, raw[0], &raw[1], data);
+	}
 	// magnetometer is actually a separate device with its
 	// own address inside the mpu9250
-	// MPU9250 was put into passthrough mode
-	if(unlikely(rc_i2c_set_device_address(config.i2c_bus, AK8963_ADDR))){
-		fprintf(stderr,"ERROR: in rc_mpu_read_mag, failed to set i2c address\n");
-		return -1;
-	}
-	// don't worry about checking data ready bit, not worth thet time
-	// read the data ready bit to see if there is new data
-	uint8_t st1;
-	if(unlikely(rc_i2c_read_byte(config.i2c_bus, AK8963_ST1, &st1)<0)){
+	// MPU9250 was put into passthrough mode. ST1 through ST2 are contiguous
+	// so read them in one burst, addressed directly so the bus stays
+	// pointed at the MPU
+	reads[0].devAddr = AK8963_ADDR;
+	reads[0].regAddr = AK8963_ST1;
+	reads[0].count = 8;
+	reads[0].data = &raw[0];
+	if(unlikely(rc_i2c_read_multi(mpu->config.i2c_bus, reads, 1))){
 		fprintf(stderr,"ERROR reading Magnetometer, i2c_bypass is probably not set\n");
 		return -1;
 	}
 	#ifdef DEBUG
-	printf("st1: %d", st1);
+	printf("st1: %d", raw[0]);
 	#endif
+	return __mag_parse_raw(mpu, raw[0], &raw[1], data);
+}
+
+
+/**
+ * Converts the 7 bytes from AK8963_XOUT_L through AK8963_ST2 into calibrated
+ * magnetometer data. Shared by the bypass and i2c master read paths.
+ *
+ * @param[in]  st1   contents of the AK8963_ST1 register
+ * @param[in]  raw   XOUT_L through ST2, may be NULL if st1 shows no new data
+ * @param      data  user's data struct
+ *
+ * @return     0 on success or if no new data was ready, -1 if saturated
+ */
+static int __mag_parse_raw(rc_mpu_t* mpu, uint8_t st1, uint8_t raw[7], rc_mpu_data_t* data)
+{
+	int16_t adc[3];
+	double factory_cal_data[3];
 	if(!(st1&MAG_DATA_READY)){
-		if(config.show_warnings){
+		if(mpu->config.show_warnings){
 			printf("no new magnetometer data ready, skipping read\n");
 		}
 		return 0;
 	}
-	// Read the six raw data regs into data array
-	if(unlikely(rc_i2c_read_bytes(config.i2c_bus,AK8963_XOUT_L,7,&raw[0])<0)){
-		fprintf(stderr,"ERROR: rc_mpu_read_mag failed to read data register\n");
-		return -1;
-	}
 	// check if the readings saturated such as because
 	// of a local field source, discard data if so
 	if(raw[6]&MAGNETOMETER_SATURATION){
-		if(config.show_warnings){
+		if(mpu->config.show_warnings){
 			printf("WARNING: magnetometer saturated, discarding data\n");
 		}
 		return -1;
@@ -388,26 +699,34 @@ int rc_mpu_read_mag(rc_mpu_data_t* data)
 	// Teslas. Also correct the coordinate system as someone in invensense
 	// thought it would be bright idea to have the magnetometer coordinate
 	// system aligned differently than the accelerometer and gyro.... -__-
-	factory_cal_data[0] = adc[1] * mag_factory_adjust[1] * MAG_RAW_TO_uT;
-	factory_cal_data[1] = adc[0] * mag_factory_adjust[0] * MAG_RAW_TO_uT;
-	factory_cal_data[2] = -adc[2] * mag_factory_adjust[2] * MAG_RAW_TO_uT;
+	factory_cal_data[0] = adc[1] * mpu->mag_factory_adjust[1] * MAG_RAW_TO_uT;
+	factory_cal_data[1] = adc[0] * mpu->mag_factory_adjust[0] * MAG_RAW_TO_uT;
+	factory_cal_data[2] = -adc[2] * mpu->mag_factory_adjust[2] * MAG_RAW_TO_uT;
+
+	// the background fit works on the same factory corrected data as
+	// rc_mpu_calibrate_mag_routine and may replace the calibration below
+	if(mpu->config.mag_online_cal){
+		pthread_mutex_lock(&mpu->cal_mutex);
+		__online_cal_add(&mpu->mag_fit, mpu->mag_fit_last, factory_cal_data, MAG_CAL_SPACING);
+	}
 
 	// now apply out own calibration,
-	data->mag[0] = (factory_cal_data[0]-mag_offsets[0])*mag_scales[0];
-	data->mag[1] = (factory_cal_data[1]-mag_offsets[1])*mag_scales[1];
-	data->mag[2] = (factory_cal_data[2]-mag_offsets[2])*mag_scales[2];
+	data->mag[0] = (factory_cal_data[0]-mpu->mag_offsets[0])*mpu->mag_scales[0];
+	data->mag[1] = (factory_cal_data[1]-mpu->mag_offsets[1])*mpu->mag_scales[1];
+	data->mag[2] = (factory_cal_data[2]-mpu->mag_offsets[2])*mpu->mag_scales[2];
+	if(mpu->config.mag_online_cal) pthread_mutex_unlock(&mpu->cal_mutex);
 
 	return 0;
 }
 
 
-int rc_mpu_read_temp(rc_mpu_data_t* data)
+int rc_mpu_instance_read_temp(rc_mpu_t* mpu, rc_mpu_data_t* data)
 {
 	uint16_t adc;
 	// set device address
-	rc_i2c_set_device_address(config.i2c_bus, config.i2c_addr);
+	rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
 	// Read the two raw data registers
-	if(rc_i2c_read_word(config.i2c_bus, TEMP_OUT_H, &adc)<0){
+	if(rc_i2c_read_word(mpu->config.i2c_bus, TEMP_OUT_H, &adc)<0){
 		fprintf(stderr,"failed to read IMU temperature registers\n");
 		return -1;
 	}
@@ -417,34 +736,43 @@ int rc_mpu_read_temp(rc_mpu_data_t* data)
 }
 
 
-int __reset_mpu(void)
+int __reset_mpu(rc_mpu_t* mpu)
 {
 	// disable the interrupt to prevent it from doing things while we reset
-	imu_shutdown_flag = 1;
+	mpu->imu_shutdown_flag = 1;
 	// set the device address
-	if(rc_i2c_set_device_address(config.i2c_bus, config.i2c_addr)==-1){
+	if(rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr)==-1){
 		fprintf(stderr,"ERROR resetting MPU, failed to set i2c device adddress\n");
 		return -1;
 	}
 	// write the reset bit
-	if(rc_i2c_write_byte(config.i2c_bus, PWR_MGMT_1, H_RESET)==-1){
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, PWR_MGMT_1, H_RESET)==-1){
 		// wait and try again
 		rc_usleep(10000);
-		if(rc_i2c_write_byte(config.i2c_bus, PWR_MGMT_1, H_RESET)==-1){
+		if(rc_i2c_write_byte(mpu->config.i2c_bus, PWR_MGMT_1, H_RESET)==-1){
 			fprintf(stderr,"ERROR resetting MPU, I2C write to reset bit failed\n");
 			return -1;
 		}
 	}
-	rc_usleep(10000);
+	// the reset bit clears itself once the registers are back to defaults
+	if(mpu->config.fast_start){
+		if(__poll_bits_clear(mpu, PWR_MGMT_1, H_RESET, RESET_TIMEOUT_US)){
+			fprintf(stderr,"ERROR resetting MPU, timeout waiting for reset to finish\n");
+			return -1;
+		}
+	}
+	else rc_usleep(10000);
+	// reset also clears the i2c master slave configuration
+	mpu->mag_i2c_master_en = 0;
 	return 0;
 }
 
 
-int __check_who_am_i(void)
+int __check_who_am_i(rc_mpu_t* mpu)
 {
 	uint8_t c;
 	//check the who am i register to make sure the chip is alive
-	if(rc_i2c_read_byte(config.i2c_bus, WHO_AM_I_MPU9250, &c)<0){
+	if(rc_i2c_read_byte(mpu->config.i2c_bus, WHO_AM_I_MPU9250, &c)<0){
 		fprintf(stderr,"i2c_read_byte failed reading who_am_i register\n");
 		return -1;
 	}
@@ -460,7 +788,7 @@ int __check_who_am_i(void)
 }
 
 
-int __set_accel_fsr(rc_mpu_accel_fsr_t fsr, rc_mpu_data_t* data)
+int __set_accel_fsr(rc_mpu_t* mpu, rc_mpu_accel_fsr_t fsr, rc_mpu_data_t* data)
 {
 	uint8_t c;
 	switch(fsr){
@@ -484,12 +812,12 @@ int __set_accel_fsr(rc_mpu_accel_fsr_t fsr, rc_mpu_data_t* data)
 		fprintf(stderr,"invalid accel fsr\n");
 		return -1;
 	}
-	return rc_i2c_write_byte(config.i2c_bus, ACCEL_CONFIG, c);
+	return rc_i2c_write_byte(mpu->config.i2c_bus, ACCEL_CONFIG, c);
 }
 
 
 
-int __set_gyro_fsr(rc_mpu_gyro_fsr_t fsr, rc_mpu_data_t* data)
+int __set_gyro_fsr(rc_mpu_t* mpu, rc_mpu_gyro_fsr_t fsr, rc_mpu_data_t* data)
 {
 	uint8_t c;
 	switch(fsr){
@@ -513,11 +841,11 @@ int __set_gyro_fsr(rc_mpu_gyro_fsr_t fsr, rc_mpu_data_t* data)
 		fprintf(stderr,"invalid gyro fsr\n");
 		return -1;
 	}
-	return rc_i2c_write_byte(config.i2c_bus, GYRO_CONFIG, c);
+	return rc_i2c_write_byte(mpu->config.i2c_bus, GYRO_CONFIG, c);
 }
 
 
-int __set_accel_dlpf(rc_mpu_accel_dlpf_t dlpf)
+int __set_accel_dlpf(rc_mpu_t* mpu, rc_mpu_accel_dlpf_t dlpf)
 {
 	uint8_t c = ACCEL_FCHOICE_1KHZ | BIT_FIFO_SIZE_1024;
 	switch(dlpf){
@@ -549,11 +877,11 @@ int __set_accel_dlpf(rc_mpu_accel_dlpf_t dlpf)
 		fprintf(stderr,"invalid config.accel_dlpf\n");
 		return -1;
 	}
-	return rc_i2c_write_byte(config.i2c_bus, ACCEL_CONFIG_2, c);
+	return rc_i2c_write_byte(mpu->config.i2c_bus, ACCEL_CONFIG_2, c);
 }
 
 
-int __set_gyro_dlpf(rc_mpu_gyro_dlpf_t dlpf)
+int __set_gyro_dlpf(rc_mpu_t* mpu, rc_mpu_gyro_dlpf_t dlpf)
 {
 	uint8_t c = FIFO_MODE_REPLACE_OLD;
 	switch(dlpf){
@@ -585,50 +913,51 @@ int __set_gyro_dlpf(rc_mpu_gyro_dlpf_t dlpf)
 		fprintf(stderr,"invalid gyro_dlpf\n");
 		return -1;
 	}
-	return rc_i2c_write_byte(config.i2c_bus, CONFIG, c);
+	return rc_i2c_write_byte(mpu->config.i2c_bus, CONFIG, c);
 }
 
 
-int __init_magnetometer(int cal_mode)
+int __init_magnetometer(rc_mpu_t* mpu, int cal_mode)
 {
 	uint8_t raw[3];	// calibration data stored here
 
 	// Enable i2c bypass to allow talking to magnetometer
-	if(__mpu_set_bypass(1)){
+	if(__mpu_set_bypass(mpu, 1)){
 		fprintf(stderr,"failed to set mpu9250 into bypass i2c mode\n");
 		return -1;
 	}
 	// magnetometer is actually a separate device with its
 	// own address inside the mpu9250
-	if(rc_i2c_set_device_address(config.i2c_bus, AK8963_ADDR)){
+	if(rc_i2c_set_device_address(mpu->config.i2c_bus, AK8963_ADDR)){
 		fprintf(stderr, "ERROR: in __init_magnetometer, failed to set i2c device address\n");
 		return -1;
 	}
 	// Power down magnetometer
-	if(rc_i2c_write_byte(config.i2c_bus, AK8963_CNTL, MAG_POWER_DN)<0){
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, AK8963_CNTL, MAG_POWER_DN)<0){
 		fprintf(stderr, "ERROR: in __init_magnetometer, failed to write to AK8963_CNTL register to power down\n");
 		return -1;
 	}
-	rc_usleep(1000);
+	// AK8963 needs 100us between mode changes
+	rc_usleep(mpu->config.fast_start ? 100 : 1000);
 	// Enter Fuse ROM access mode
-	if(rc_i2c_write_byte(config.i2c_bus, AK8963_CNTL, MAG_FUSE_ROM)){
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, AK8963_CNTL, MAG_FUSE_ROM)){
 		fprintf(stderr, "ERROR: in __init_magnetometer, failed to write to AK8963_CNTL register\n");
 		return -1;
 	}
-	rc_usleep(1000);
+	rc_usleep(mpu->config.fast_start ? 100 : 1000);
 	// Read the xyz sensitivity adjustment values
-	if(rc_i2c_read_bytes(config.i2c_bus, AK8963_ASAX, 3, &raw[0])<0){
+	if(rc_i2c_read_bytes(mpu->config.i2c_bus, AK8963_ASAX, 3, &raw[0])<0){
 		fprintf(stderr,"failed to read magnetometer adjustment register\n");
-		rc_i2c_set_device_address(config.i2c_bus, config.i2c_addr);
+		rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
 		//__mpu_set_bypass(0);
 		return -1;
 	}
 	// Return sensitivity adjustment values
-	mag_factory_adjust[0] = (raw[0]-128)/256.0 + 1.0;
-	mag_factory_adjust[1] = (raw[1]-128)/256.0 + 1.0;
-	mag_factory_adjust[2] = (raw[2]-128)/256.0 + 1.0;
+	mpu->mag_factory_adjust[0] = (raw[0]-128)/256.0 + 1.0;
+	mpu->mag_factory_adjust[1] = (raw[1]-128)/256.0 + 1.0;
+	mpu->mag_factory_adjust[2] = (raw[2]-128)/256.0 + 1.0;
 	// Power down magnetometer again
-	if(rc_i2c_write_byte(config.i2c_bus, AK8963_CNTL, MAG_POWER_DN)){
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, AK8963_CNTL, MAG_POWER_DN)){
 		fprintf(stderr, "ERROR: in __init_magnetometer, failed to write to AK8963_CNTL register to power on\n");
 		return -1;
 	}
@@ -636,95 +965,187 @@ int __init_magnetometer(int cal_mode)
 	// Configure the magnetometer for 16 bit resolution
 	// and continuous sampling mode 2 (100hz)
 	uint8_t c = MSCALE_16|MAG_CONT_MES_2;
-	if(rc_i2c_write_byte(config.i2c_bus, AK8963_CNTL, c)){
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, AK8963_CNTL, c)){
 		fprintf(stderr, "ERROR: in __init_magnetometer, failed to write to AK8963_CNTL register to set sampling mode\n");
 		return -1;
 	}
 	rc_usleep(100);
 	// go back to configuring the IMU, leave bypass on
-	rc_i2c_set_device_address(config.i2c_bus,config.i2c_addr);
+	rc_i2c_set_device_address(mpu->config.i2c_bus,mpu->config.i2c_addr);
 	// load in magnetometer calibration
 	if(!cal_mode){
-		__load_mag_calibration();
+		__load_mag_calibration(mpu);
 	}
 	return 0;
 }
 
 
-int __power_off_magnetometer(void)
+int __power_off_magnetometer(rc_mpu_t* mpu)
 {
-	rc_i2c_set_device_address(config.i2c_bus, config.i2c_addr);
+	rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
+	// stop the internal i2c master from polling the AK8963 before
+	// we go talk to it directly
+	if(mpu->mag_i2c_master_en) __mag_disable_i2c_master(mpu);
 	// Enable i2c bypass to allow talking to magnetometer
-	if(__mpu_set_bypass(1)){
+	if(__mpu_set_bypass(mpu, 1)){
 		fprintf(stderr,"failed to set mpu9250 into bypass i2c mode\n");
 		return -1;
 	}
 	// magnetometer is actually a separate device with its
 	// own address inside the mpu9250
-	rc_i2c_set_device_address(config.i2c_bus, AK8963_ADDR);
+	rc_i2c_set_device_address(mpu->config.i2c_bus, AK8963_ADDR);
 	// Power down magnetometer
-	if(rc_i2c_write_byte(config.i2c_bus, AK8963_CNTL, MAG_POWER_DN)<0){
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, AK8963_CNTL, MAG_POWER_DN)<0){
 		fprintf(stderr,"failed to write to magnetometer\n");
 		return -1;
 	}
-	rc_i2c_set_device_address(config.i2c_bus, config.i2c_addr);
+	rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
 	return 0;
 }
 
 
-int rc_mpu_power_off(void)
+/**
+ * Configures the MPU's internal i2c master to read AK8963_ST1 through
+ * AK8963_ST2 into EXT_SENS_DATA_00-07 on its own every sample. This must be
+ * called after __init_magnetometer() has put the AK8963 into continuous
+ * measurement mode and read the factory adjustment values. Bypass is turned
+ * off since the MPU now owns the auxiliary bus. config.mag_sample_rate_div is
+ * reused as the i2c master delay so the AK8963 is not polled faster than
+ * needed.
+ *
+ * @return     0 on success, -1 on failure
+ */
+static int __mag_enable_i2c_master(rc_mpu_t* mpu)
 {
-	imu_shutdown_flag = 1;
+	uint8_t dly;
+	rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
+	// 400khz aux bus, stop between slave reads, and hold off the data ready
+	// interrupt until external sensor data has been loaded
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, I2C_MST_CTRL, BIT_WAIT_FOR_ES|BIT_I2C_MST_P_NSR|I2C_MST_CLK_400)){
+		fprintf(stderr,"ERROR: in __mag_enable_i2c_master, failed to write I2C_MST_CTRL\n");
+		return -1;
+	}
+	// slave 0 reads 8 bytes starting at ST1, reading ST2 at the end
+	// releases the AK8963 data latch for the next measurement
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, I2C_SLV0_ADDR, AK8963_ADDR|BIT_I2C_READ)){
+		fprintf(stderr,"ERROR: in __mag_enable_i2c_master, failed to write I2C_SLV0_ADDR\n");
+		return -1;
+	}
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, I2C_SLV0_REG, AK8963_ST1)){
+		fprintf(stderr,"ERROR: in __mag_enable_i2c_master, failed to write I2C_SLV0_REG\n");
+		return -1;
+	}
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, I2C_SLV0_CTRL, BIT_SLAVE_EN|8)){
+		fprintf(stderr,"ERROR: in __mag_enable_i2c_master, failed to write I2C_SLV0_CTRL\n");
+		return -1;
+	}
+	// only access slave 0 every (1+dly) samples
+	dly = 0;
+	if(mpu->config.mag_sample_rate_div>1){
+		dly = (mpu->config.mag_sample_rate_div-1) & BITS_I2C_MASTER_DLY;
+	}
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, I2C_SLV4_CTRL, dly)){
+		fprintf(stderr,"ERROR: in __mag_enable_i2c_master, failed to write I2C_SLV4_CTRL\n");
+		return -1;
+	}
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, I2C_MST_DELAY_CTRL, dly?BIT_S0_DELAY_EN:0)){
+		fprintf(stderr,"ERROR: in __mag_enable_i2c_master, failed to write I2C_MST_DELAY_CTRL\n");
+		return -1;
+	}
+	// turn off bypass which also sets I2C_MST_EN in USER_CTRL
+	mpu->mag_i2c_master_en = 1;
+	if(__mpu_set_bypass(mpu, 0)){
+		fprintf(stderr,"ERROR: in __mag_enable_i2c_master, failed to disable bypass\n");
+		mpu->mag_i2c_master_en = 0;
+		return -1;
+	}
+	return 0;
+}
+
+
+/**
+ * Stops the internal i2c master from sampling the magnetometer and puts the
+ * MPU back into bypass mode.
+ *
+ * @return     0 on success, -1 on failure
+ */
+static int __mag_disable_i2c_master(rc_mpu_t* mpu)
+{
+	rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
+	mpu->mag_i2c_master_en = 0;
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, I2C_SLV0_CTRL, 0)){
+		fprintf(stderr,"ERROR: in __mag_disable_i2c_master, failed to write I2C_SLV0_CTRL\n");
+		return -1;
+	}
+	if(__mpu_set_bypass(mpu, 1)){
+		fprintf(stderr,"ERROR: in __mag_disable_i2c_master, failed to enable bypass\n");
+		return -1;
+	}
+	return 0;
+}
+
+
+int rc_mpu_instance_power_off(rc_mpu_t* mpu)
+{
+	int i;
+	mpu->imu_shutdown_flag = 1;
 	// wait for the interrupt thread to exit if it hasn't already
 	//allow up to 1 second for thread cleanup
-	if(thread_running_flag){
+	if(mpu->thread_running_flag){
 
-		if(rc_pthread_timed_join(imu_interrupt_thread, NULL, 1.0)==1){
+		if(rc_pthread_timed_join(mpu->imu_interrupt_thread, NULL, 1.0)==1){
 			fprintf(stderr,"WARNING: mpu interrupt thread exit timeout\n");
 		}
-		// cleanup mutexes
-		pthread_cond_destroy(&read_condition);
-		pthread_mutex_destroy(&read_mutex);
-		pthread_cond_destroy(&tap_condition);
-		pthread_mutex_destroy(&tap_mutex);
+		// the mutexes and conditions live as long as the instance and
+		// are destroyed in rc_mpu_instance_destroy so it can be
+		// initialized again
+	}
+	// stop subscriber threads now that nothing will feed them
+	for(i=0;i<RC_MPU_MAX_SUBSCRIBERS;i++){
+		if(mpu->subscribers[i].state==SUB_ACTIVE){
+			rc_mpu_instance_unsubscribe(mpu, i);
+		}
 	}
 	// shutdown magnetometer first if on since that requires
 	// the imu to the on for bypass to work
-	if(config.enable_magnetometer) __power_off_magnetometer();
+	if(mpu->config.enable_magnetometer) __power_off_magnetometer(mpu);
 	// set the device address to write the shutdown register
-	rc_i2c_set_device_address(config.i2c_bus, config.i2c_addr);
+	rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
 	// write the reset bit
-	if(rc_i2c_write_byte(config.i2c_bus, PWR_MGMT_1, H_RESET)){
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, PWR_MGMT_1, H_RESET)){
 		//wait and try again
 		rc_usleep(1000);
-		if(rc_i2c_write_byte(config.i2c_bus, PWR_MGMT_1, H_RESET)){
+		if(rc_i2c_write_byte(mpu->config.i2c_bus, PWR_MGMT_1, H_RESET)){
 			fprintf(stderr,"I2C write to MPU9250 Failed\n");
 			return -1;
 		}
 	}
 	// write the sleep bit
-	if(rc_i2c_write_byte(config.i2c_bus, PWR_MGMT_1, MPU_SLEEP)){
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, PWR_MGMT_1, MPU_SLEEP)){
 		//wait and try again
 		rc_usleep(1000);
-		if(rc_i2c_write_byte(config.i2c_bus, PWR_MGMT_1, MPU_SLEEP)){
+		if(rc_i2c_write_byte(mpu->config.i2c_bus, PWR_MGMT_1, MPU_SLEEP)){
 			fprintf(stderr,"I2C write to MPU9250 Failed\n");
 			return -1;
 		}
 	}
 
-	// if in dmp mode, also unexport the interrupt pin
-	if(dmp_en){
-		rc_gpio_cleanup(config.gpio_interrupt_pin_chip ,config.gpio_interrupt_pin);
+	// if in dmp or ahrs mode, also unexport the interrupt pin
+	if(mpu->dmp_en || mpu->ahrs_en){
+		rc_gpio_cleanup(mpu->config.gpio_interrupt_pin_chip ,mpu->config.gpio_interrupt_pin);
 	}
 
 	return 0;
 }
 
 
-int rc_mpu_initialize_dmp(rc_mpu_data_t *data, rc_mpu_config_t conf)
+int rc_mpu_instance_initialize_dmp(rc_mpu_t* mpu, rc_mpu_data_t *data, rc_mpu_config_t conf)
 {
-	int i;
+	int i, n_mag;
 	uint8_t tmp;
+	uint64_t t_start, t_phase;
+	t_start = rc_nanos_since_boot();
+	memset(&mpu->init_timing, 0, sizeof(mpu->init_timing));
 	// range check
 	if(conf.dmp_sample_rate>DMP_MAX_RATE || conf.dmp_sample_rate<DMP_MIN_RATE){
 		fprintf(stderr,"ERROR:dmp_sample_rate must be between %d & %d\n", \
@@ -744,8 +1165,10 @@ int rc_mpu_initialize_dmp(rc_mpu_data_t *data, rc_mpu_config_t conf)
 	}
 
 	// update local copy of config and data struct with new values
-	config = conf;
-	data_ptr = data;
+	mpu->config = conf;
+	__set_cal_file_paths(mpu);
+	__online_cal_init(mpu);
+	mpu->data_ptr = data;
 
 	// check dlpf
 	if(conf.gyro_dlpf==GYRO_DLPF_OFF || conf.gyro_dlpf==GYRO_DLPF_250){
@@ -762,129 +1185,132 @@ int rc_mpu_initialize_dmp(rc_mpu_data_t *data, rc_mpu_config_t conf)
 	if(conf.gyro_fsr!=GYRO_FSR_2000DPS){
 		fprintf(stderr,"WARNING, gyro FSR must be GYRO_FSR_2000DPS in DMP mode\n");
 		fprintf(stderr,"setting to 2000DPS automatically\n");
-		config.gyro_fsr = GYRO_FSR_2000DPS;
+		mpu->config.gyro_fsr = GYRO_FSR_2000DPS;
 	}
 	if(conf.accel_fsr!=ACCEL_FSR_8G){
 		fprintf(stderr,"WARNING, accel FSR must be ACCEL_FSR_8G in DMP mode\n");
 		fprintf(stderr,"setting to ACCEL_FSR_8G automatically\n");
-		config.accel_fsr = ACCEL_FSR_8G;
+		mpu->config.accel_fsr = ACCEL_FSR_8G;
 	}
 
 	// start the i2c bus
-	if(rc_i2c_init(config.i2c_bus, config.i2c_addr)){
+	if(rc_i2c_init(mpu->config.i2c_bus, mpu->config.i2c_addr)){
 		fprintf(stderr,"rc_mpu_initialize_dmp failed at rc_i2c_init\n");
 		return -1;
 	}
 	// configure the gpio interrupt pin
-	if(rc_gpio_init_event(config.gpio_interrupt_pin_chip, config.gpio_interrupt_pin, 0, GPIOEVENT_REQUEST_FALLING_EDGE)==-1){
+	if(rc_gpio_init_event(mpu->config.gpio_interrupt_pin_chip, mpu->config.gpio_interrupt_pin, 0, GPIOEVENT_REQUEST_FALLING_EDGE)==-1){
 		fprintf(stderr,"ERROR: in rc_mpu_initialize_dmp, failed to initialize GPIO\n");
 		fprintf(stderr,"probably insufficient privileges\n");
 		return -1;
 	}
 
-	// claiming the bus does no guarantee other code will not interfere
-	// with this process, but best to claim it so other code can check
-	rc_i2c_lock_bus(config.i2c_bus);
+	// claim the bus, this waits for other threads and processes to finish
+	// with it, then make sure the address is still ours
+	rc_i2c_lock_bus(mpu->config.i2c_bus);
+	rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
+	t_phase = rc_nanos_since_boot();
 	// restart the device so we start with clean registers
-	if(__reset_mpu()<0){
+	if(__reset_mpu(mpu)<0){
 		fprintf(stderr,"failed to __reset_mpu()\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
-	if(__check_who_am_i()){
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+	if(__check_who_am_i(mpu)){
+		goto unlock_fail;
 	}
+	mpu->init_timing.reset_ns = rc_nanos_since_boot() - t_phase;
+	t_phase = rc_nanos_since_boot();
 	// MPU6500 shares 4kB of memory between the DMP and the FIFO. Since the
 	//first 3kB are needed by the DMP, we'll use the last 1kB for the FIFO.
 	// this is also set in set_accel_dlpf but we set here early on
 	tmp = BIT_FIFO_SIZE_1024 | 0x8;
-	if(rc_i2c_write_byte(config.i2c_bus, ACCEL_CONFIG_2, tmp)){
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, ACCEL_CONFIG_2, tmp)){
 		fprintf(stderr,"ERROR: in rc_mpu_initialize_dmp, failed to write to ACCEL_CONFIG_2 register\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
 	// load in calibration offsets from disk
-	if(__load_gyro_calibration()<0){
+	if(__load_gyro_calibration(mpu)<0){
 		fprintf(stderr,"ERROR: failed to load gyro calibration offsets\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
-	if(__load_accel_calibration()<0){
+	if(__load_accel_calibration(mpu)<0){
 		fprintf(stderr,"ERROR: failed to load accel calibration offsets\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
 
 	// set full scale ranges. It seems the DMP only scales the gyro properly
 	// at 2000DPS. I'll assume the same is true for accel and use 2G like their
 	// example
-	if(__set_gyro_fsr(config.gyro_fsr, data_ptr)==-1){
+	if(__set_gyro_fsr(mpu, mpu->config.gyro_fsr, mpu->data_ptr)==-1){
 		fprintf(stderr, "ERROR in rc_mpu_initialize_dmp, failed to set gyro_fsr register\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
-	if(__set_accel_fsr(config.accel_fsr, data_ptr)==-1){
+	if(__set_accel_fsr(mpu, mpu->config.accel_fsr, mpu->data_ptr)==-1){
 		fprintf(stderr, "ERROR in rc_mpu_initialize_dmp, failed to set accel_fsr register\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
 
 	// set dlpf, these values already checked for bounds above
-	if(__set_gyro_dlpf(conf.gyro_dlpf)){
+	if(__set_gyro_dlpf(mpu, conf.gyro_dlpf)){
 		fprintf(stderr,"failed to set gyro dlpf\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
-	if(__set_accel_dlpf(conf.accel_dlpf)){
+	if(__set_accel_dlpf(mpu, conf.accel_dlpf)){
 		fprintf(stderr,"failed to set accel_dlpf\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
 
 	// This actually sets the rate of accel/gyro sampling which should always be
 	// 200 as the dmp filters at that rate
-	if(__mpu_set_sample_rate(200)<0){
+	if(__mpu_set_sample_rate(mpu, 200)<0){
 	//if(__mpu_set_sample_rate(config.dmp_sample_rate)<0){
 		fprintf(stderr,"ERROR: setting IMU sample rate\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
 
 	// enable bypass, more importantly this also configures the interrupt pin behavior
-	if(__mpu_set_bypass(1)){
+	if(__mpu_set_bypass(mpu, 1)){
 		fprintf(stderr, "failed to run __mpu_set_bypass\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
 
+	mpu->init_timing.sensor_config_ns = rc_nanos_since_boot() - t_phase;
+	t_phase = rc_nanos_since_boot();
+
 	// initialize the magnetometer too if requested in config
 	if(conf.enable_magnetometer){
-		if(__init_magnetometer(0)){
+		if(__init_magnetometer(mpu, 0)){
 			fprintf(stderr,"ERROR: failed to initialize_magnetometer\n");
-			rc_i2c_unlock_bus(config.i2c_bus);
-			return -1;
+			goto unlock_fail;
+		}
+		if(conf.mag_use_i2c_master && __mag_enable_i2c_master(mpu)){
+			fprintf(stderr,"ERROR: failed to start magnetometer i2c master sampling\n");
+			goto unlock_fail;
 		}
-		if(rc_mpu_read_mag(data)==-1){
+		if(rc_mpu_instance_read_mag(mpu, data)==-1){
 			fprintf(stderr,"ERROR: failed to initialize_magnetometer\n");
-			rc_i2c_unlock_bus(config.i2c_bus);
-			return -1;
+			goto unlock_fail;
 		}
-		// collect some mag data to get a starting heading
+		// collect some mag data to get a starting heading. fast start
+		// takes fewer samples and reads each as soon as it is ready
 		double x_sum = 0.0;
 		double y_sum = 0.0;
 		double mag_vec[3];
-		for(i=0;i<20;i++){
-			rc_mpu_read_mag(data);
+		n_mag = mpu->config.fast_start ? FAST_MAG_SAMPLES : 20;
+		for(i=0;i<n_mag;i++){
+			if(mpu->config.fast_start) __mag_wait_ready(mpu);
+			rc_mpu_instance_read_mag(mpu, data);
 			// correct for orientation and put data into mag_vec
-			if(__mag_correct_orientation(mag_vec)) return -1;
+			if(__correct_orientation(mpu, mpu->data_ptr->mag, mag_vec)) goto unlock_fail;
 			x_sum += mag_vec[0];
 			y_sum += mag_vec[1];
-			rc_usleep(10000);
+			if(!mpu->config.fast_start) rc_usleep(10000);
 		}
-		startMagYaw = -atan2(y_sum, x_sum);
+		mpu->startMagYaw = -atan2(y_sum, x_sum);
 	}
-	else __power_off_magnetometer();
+	else __power_off_magnetometer(mpu);
+	mpu->init_timing.mag_init_ns = rc_nanos_since_boot() - t_phase;
+	t_phase = rc_nanos_since_boot();
 
 
 	// set up the DMP, order is important, from motiondrive_tutorial.pdf:
@@ -895,18 +1321,28 @@ int rc_mpu_initialize_dmp(rc_mpu_data_t *data, rc_mpu_config_t conf)
 	// 5) set fifo rate
 	// 6) set any feature-specific control functions
 	// 7) turn dmp on
-	dmp_en = 1; // log locally that the dmp will be running
-	if(__dmp_load_motion_driver_firmware()<0){
-		fprintf(stderr,"failed to load DMP motion driver\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+	mpu->dmp_en = 1; // log locally that the dmp will be running
+	mpu->ahrs_en = 0;
+	if(mpu->config.fast_start){
+		if(__dmp_load_firmware_fast(mpu)<0){
+			fprintf(stderr,"failed to load DMP motion driver\n");
+			goto unlock_fail;
+		}
 	}
+	else{
+		if(__dmp_load_motion_driver_firmware(mpu)<0){
+			fprintf(stderr,"failed to load DMP motion driver\n");
+			goto unlock_fail;
+		}
+		// the slow path verifies as it goes
+		mpu->init_timing.firmware_load_ns = rc_nanos_since_boot() - t_phase;
+	}
+	t_phase = rc_nanos_since_boot();
 
 	// set the orientation of dmp quaternion
-	if(__dmp_set_orientation((unsigned short)conf.orient)<0){
+	if(__dmp_set_orientation(mpu, (unsigned short)conf.orient)<0){
 		fprintf(stderr,"ERROR: failed to set dmp orientation\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
 
 	/// enbale quaternion feature and accel/gyro if requested
@@ -915,62 +1351,238 @@ int rc_mpu_initialize_dmp(rc_mpu_data_t *data, rc_mpu_config_t conf)
 	unsigned short feature_mask = DMP_FEATURE_6X_LP_QUAT|DMP_FEATURE_TAP;
 
 	// enable gyro calibration is requested
-	if(config.dmp_auto_calibrate_gyro){
+	if(mpu->config.dmp_auto_calibrate_gyro){
 		feature_mask|=DMP_FEATURE_GYRO_CAL;
 	}
 	// enable reading accel/gyro is requested
-	if(config.dmp_fetch_accel_gyro){
+	if(mpu->config.dmp_fetch_accel_gyro){
 		feature_mask|=DMP_FEATURE_SEND_RAW_ACCEL|DMP_FEATURE_SEND_ANY_GYRO;
 	}
-	if(__dmp_enable_feature(feature_mask)<0){
+	if(__dmp_enable_feature(mpu, feature_mask)<0){
 		fprintf(stderr,"ERROR: failed to enable DMP features\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
 
 	// this changes the rate new dmp data is put in the fifo
 	// fixing at 200 causes gyro scaling issues at lower mpu sample rates
-	if(__dmp_set_fifo_rate(config.dmp_sample_rate)<0){
+	if(__dmp_set_fifo_rate(mpu, mpu->config.dmp_sample_rate)<0){
 		fprintf(stderr,"ERROR: failed to set DMP fifo rate\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
 
 	// turn the dmp on
-	if(__mpu_set_dmp_state(1)<0) {
+	if(__mpu_set_dmp_state(mpu, 1)<0) {
 		fprintf(stderr,"ERROR: __mpu_set_dmp_state(1) failed\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
 
 	// set interrupt mode to continuous as opposed to GESTURE
-	if(__dmp_set_interrupt_mode(DMP_INT_CONTINUOUS)<0){
+	if(__dmp_set_interrupt_mode(mpu, DMP_INT_CONTINUOUS)<0){
 		fprintf(stderr,"ERROR: failed to set DMP interrupt mode to continuous\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
 
 	// done writing to bus for now
-	rc_i2c_unlock_bus(config.i2c_bus);
+	rc_i2c_unlock_bus(mpu->config.i2c_bus);
+	mpu->init_timing.dmp_config_ns = rc_nanos_since_boot() - t_phase;
 
 	// get ready to start the interrupt handler thread
-	data_ptr->tap_detected=0;
-	imu_shutdown_flag = 0;
-	dmp_callback_func=NULL;
-	tap_callback_func=NULL;
+	mpu->data_ptr->tap_detected=0;
+	mpu->imu_shutdown_flag = 0;
+	mpu->dmp_callback_func=NULL;
+	mpu->tap_callback_func=NULL;
+	mpu->published_seq = 0;
+	mpu->fifo_first_run = 1;
+	mpu->fusion_first_run = 1;
 
 	// start the thread
-	if(rc_pthread_create(&imu_interrupt_thread, __dmp_interrupt_handler,NULL,
-					config.dmp_interrupt_sched_policy,
-					config.dmp_interrupt_priority)<0){
+	if(rc_pthread_create(&mpu->imu_interrupt_thread, __dmp_interrupt_handler,mpu,
+					mpu->config.dmp_interrupt_sched_policy,
+					mpu->config.dmp_interrupt_priority)<0){
 		fprintf(stderr,"ERROR failed to start dmp handler thread\n");
 		return -1;
 	}
-	thread_running_flag = 1;
+	mpu->thread_running_flag = 1;
+
+	// sleep for a ms so the thread can start predictably
+	rc_usleep(1000);
+	mpu->init_timing.total_ns = rc_nanos_since_boot() - t_start;
+	return 0;
+
+unlock_fail:
+	rc_i2c_unlock_bus(mpu->config.i2c_bus);
+	return -1;
+}
+
+int rc_mpu_instance_initialize_ahrs(rc_mpu_t* mpu, rc_mpu_data_t *data, rc_mpu_config_t conf)
+{
+	uint64_t t_start, t_phase;
+	t_start = rc_nanos_since_boot();
+	memset(&mpu->init_timing, 0, sizeof(mpu->init_timing));
+	// range check
+	if(conf.ahrs_sample_rate>AHRS_MAX_RATE || conf.ahrs_sample_rate<AHRS_MIN_RATE){
+		fprintf(stderr,"ERROR: ahrs_sample_rate must be between %d & %d\n", \
+						AHRS_MIN_RATE, AHRS_MAX_RATE);
+		return -1;
+	}
+	// SMPLRT_DIV divides the 1khz internal rate, anything else would give
+	// a different rate than the one the filters integrate with
+	if(AHRS_MAX_RATE%conf.ahrs_sample_rate != 0){
+		fprintf(stderr,"ERROR: ahrs_sample_rate must be a divisor of %d\n", AHRS_MAX_RATE);
+		fprintf(stderr,"acceptable values: 1000,500,250,200,125,100,50,40,25,20,10,8,5,4 (HZ)\n");
+		return -1;
+	}
+	// the gyro runs at 8khz or more with these and SMPLRT_DIV is ignored
+	if(conf.gyro_dlpf==GYRO_DLPF_OFF || conf.gyro_dlpf==GYRO_DLPF_250){
+		fprintf(stderr,"ERROR: gyro dlpf bandwidth must be <= 184hz in AHRS mode\n");
+		return -1;
+	}
+	if(conf.enable_magnetometer && conf.mag_sample_rate_div<1){
+		fprintf(stderr,"ERROR: mag_sample_rate_div must be >= 1\n");
+		return -1;
+	}
+
+	// update local copy of config and data struct with new values
+	mpu->config = conf;
+	__set_cal_file_paths(mpu);
+	__online_cal_init(mpu);
+	mpu->data_ptr = data;
+
+	// set up the filters first so a bad gain fails before touching hardware
+	switch(conf.ahrs_type){
+	case RC_AHRS_MAHONY:
+		if(rc_ahrs_mahony_init(&mpu->ahrs_imu, (float)conf.ahrs_kp, (float)conf.ahrs_ki)) return -1;
+		break;
+	case RC_AHRS_MADGWICK:
+		if(rc_ahrs_madgwick_init(&mpu->ahrs_imu, (float)conf.ahrs_beta)) return -1;
+		break;
+	default:
+		fprintf(stderr,"ERROR in rc_mpu_initialize_ahrs, invalid ahrs_type\n");
+		return -1;
+	}
+	mpu->ahrs_marg = mpu->ahrs_imu;
+
+	// start the i2c bus
+	if(rc_i2c_init(mpu->config.i2c_bus, mpu->config.i2c_addr)){
+		fprintf(stderr,"rc_mpu_initialize_ahrs failed at rc_i2c_init\n");
+		return -1;
+	}
+	// configure the gpio interrupt pin
+	if(rc_gpio_init_event(mpu->config.gpio_interrupt_pin_chip, mpu->config.gpio_interrupt_pin, 0, GPIOEVENT_REQUEST_FALLING_EDGE)==-1){
+		fprintf(stderr,"ERROR: in rc_mpu_initialize_ahrs, failed to initialize GPIO\n");
+		fprintf(stderr,"probably insufficient privileges\n");
+		return -1;
+	}
+
+	// claim the bus, this waits for other threads and processes to finish
+	// with it, then make sure the address is still ours
+	rc_i2c_lock_bus(mpu->config.i2c_bus);
+	rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
+	t_phase = rc_nanos_since_boot();
+	// restart the device so we start with clean registers
+	if(__reset_mpu(mpu)<0){
+		fprintf(stderr,"failed to __reset_mpu()\n");
+		goto unlock_fail;
+	}
+	if(__check_who_am_i(mpu)){
+		goto unlock_fail;
+	}
+	mpu->init_timing.reset_ns = rc_nanos_since_boot() - t_phase;
+	t_phase = rc_nanos_since_boot();
+	// no DMP firmware in this mode, just raw registers
+	mpu->dmp_en = 0;
+	mpu->ahrs_en = 1;
+
+	// load in calibration offsets from disk
+	if(__load_gyro_calibration(mpu)<0){
+		fprintf(stderr,"ERROR: failed to load gyro calibration offsets\n");
+		goto unlock_fail;
+	}
+	if(__load_accel_calibration(mpu)<0){
+		fprintf(stderr,"ERROR: failed to load accel calibration offsets\n");
+		goto unlock_fail;
+	}
+	// unlike the DMP, any full scale range and filter bandwidth works here
+	if(__set_gyro_fsr(mpu, conf.gyro_fsr, mpu->data_ptr)==-1){
+		fprintf(stderr, "ERROR in rc_mpu_initialize_ahrs, failed to set gyro_fsr register\n");
+		goto unlock_fail;
+	}
+	if(__set_accel_fsr(mpu, conf.accel_fsr, mpu->data_ptr)==-1){
+		fprintf(stderr, "ERROR in rc_mpu_initialize_ahrs, failed to set accel_fsr register\n");
+		goto unlock_fail;
+	}
+	if(__set_gyro_dlpf(mpu, conf.gyro_dlpf)){
+		fprintf(stderr,"failed to set gyro dlpf\n");
+		goto unlock_fail;
+	}
+	if(__set_accel_dlpf(mpu, conf.accel_dlpf)){
+		fprintf(stderr,"failed to set accel_dlpf\n");
+		goto unlock_fail;
+	}
+	// the data ready interrupt fires at this rate
+	if(__mpu_set_sample_rate(mpu, conf.ahrs_sample_rate)<0){
+		fprintf(stderr,"ERROR: setting IMU sample rate\n");
+		goto unlock_fail;
+	}
+	// enable bypass, more importantly this also configures the interrupt pin behavior
+	if(__mpu_set_bypass(mpu, 1)){
+		fprintf(stderr, "failed to run __mpu_set_bypass\n");
+		goto unlock_fail;
+	}
+
+	mpu->init_timing.sensor_config_ns = rc_nanos_since_boot() - t_phase;
+	t_phase = rc_nanos_since_boot();
+
+	// initialize the magnetometer too if requested in config
+	if(conf.enable_magnetometer){
+		if(__init_magnetometer(mpu, 0)){
+			fprintf(stderr,"ERROR: failed to initialize_magnetometer\n");
+			goto unlock_fail;
+		}
+		if(conf.mag_use_i2c_master && __mag_enable_i2c_master(mpu)){
+			fprintf(stderr,"ERROR: failed to start magnetometer i2c master sampling\n");
+			goto unlock_fail;
+		}
+	}
+	else __power_off_magnetometer(mpu);
+	mpu->init_timing.mag_init_ns = rc_nanos_since_boot() - t_phase;
+
+	// interrupt on every new raw sample, nothing goes through the FIFO
+	rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, FIFO_EN, 0) || \
+	   rc_i2c_write_byte(mpu->config.i2c_bus, INT_ENABLE, BIT_DATA_RDY_EN)){
+		fprintf(stderr,"ERROR: in rc_mpu_initialize_ahrs, failed to enable data ready interrupt\n");
+		goto unlock_fail;
+	}
+
+	// done writing to bus for now
+	rc_i2c_unlock_bus(mpu->config.i2c_bus);
+
+	// get ready to start the interrupt handler thread
+	memset(mpu->data_ptr->mag, 0, sizeof(mpu->data_ptr->mag));
+	mpu->data_ptr->tap_detected=0;
+	mpu->imu_shutdown_flag = 0;
+	mpu->dmp_callback_func=NULL;
+	mpu->tap_callback_func=NULL;
+	mpu->published_seq = 0;
+
+	// start the thread
+	if(rc_pthread_create(&mpu->imu_interrupt_thread, __dmp_interrupt_handler,mpu,
+					mpu->config.dmp_interrupt_sched_policy,
+					mpu->config.dmp_interrupt_priority)<0){
+		fprintf(stderr,"ERROR failed to start ahrs handler thread\n");
+		return -1;
+	}
+	mpu->thread_running_flag = 1;
 
 	// sleep for a ms so the thread can start predictably
 	rc_usleep(1000);
+	mpu->init_timing.total_ns = rc_nanos_since_boot() - t_start;
 	return 0;
+
+unlock_fail:
+	rc_i2c_unlock_bus(mpu->config.i2c_bus);
+	return -1;
 }
 
 /**
@@ -982,7 +1594,7 @@ int rc_mpu_initialize_dmp(rc_mpu_data_t *data, rc_mpu_config_t conf)
  *  @param[in]  data        Bytes to write to memory.
  *  @return     0 if successful.
 **/
-int __mpu_write_mem(unsigned short mem_addr, unsigned short length, unsigned char *data)
+int __mpu_write_mem(rc_mpu_t* mpu, unsigned short mem_addr, unsigned short length, unsigned char *data)
 {
 	unsigned char tmp[2];
 	if (!data){
@@ -996,9 +1608,9 @@ int __mpu_write_mem(unsigned short mem_addr, unsigned short length, unsigned cha
 		fprintf(stderr,"mpu_write_mem exceeds bank size\n");
 		return -1;
 	}
-	if (rc_i2c_write_bytes(config.i2c_bus,MPU6500_BANK_SEL, 2, tmp))
+	if (rc_i2c_write_bytes(mpu->config.i2c_bus,MPU6500_BANK_SEL, 2, tmp))
 		return -1;
-	if (rc_i2c_write_bytes(config.i2c_bus,MPU6500_MEM_R_W, length, data))
+	if (rc_i2c_write_bytes(mpu->config.i2c_bus,MPU6500_MEM_R_W, length, data))
 		return -1;
 	return 0;
 }
@@ -1012,7 +1624,7 @@ int __mpu_write_mem(unsigned short mem_addr, unsigned short length, unsigned cha
  *  @param[out] data        Bytes read from memory.
  *  @return     0 if successful.
 **/
-int __mpu_read_mem(unsigned short mem_addr, unsigned short length, unsigned char *data)
+int __mpu_read_mem(rc_mpu_t* mpu, unsigned short mem_addr, unsigned short length, unsigned char *data)
 {
 	unsigned char tmp[2];
 	if (!data){
@@ -1026,9 +1638,9 @@ int __mpu_read_mem(unsigned short mem_addr, unsigned short length, unsigned char
 		printf("mpu_read_mem exceeds bank size\n");
 		return -1;
 	}
-	if (rc_i2c_write_bytes(config.i2c_bus,MPU6500_BANK_SEL, 2, tmp))
+	if (rc_i2c_write_bytes(mpu->config.i2c_bus,MPU6500_BANK_SEL, 2, tmp))
 		return -1;
-	if (rc_i2c_read_bytes(config.i2c_bus,MPU6500_MEM_R_W, length, data)!=length)
+	if (rc_i2c_read_bytes(mpu->config.i2c_bus,MPU6500_MEM_R_W, length, data)!=length)
 		return -1;
 	return 0;
 }
@@ -1038,22 +1650,22 @@ int __mpu_read_mem(unsigned short mem_addr, unsigned short length, unsigned char
 *
 * loads pre-compiled firmware binary from invensense onto dmp
 **/
-int __dmp_load_motion_driver_firmware(void)
+int __dmp_load_motion_driver_firmware(rc_mpu_t* mpu)
 {
 	unsigned short ii;
 	unsigned short this_write;
 	// Must divide evenly into st.hw->bank_size to avoid bank crossings.
 	unsigned char cur[DMP_LOAD_CHUNK], tmp[2];
 	// make sure the address is set correctly
-	rc_i2c_set_device_address(config.i2c_bus, config.i2c_addr);
+	rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
 	// loop through 16 bytes at a time and check each write for corruption
 	for (ii=0; ii<DMP_CODE_SIZE; ii+=this_write) {
 		this_write = min(DMP_LOAD_CHUNK, DMP_CODE_SIZE - ii);
-		if (__mpu_write_mem(ii, this_write, (uint8_t*)&dmp_firmware[ii])){
+		if (__mpu_write_mem(mpu, ii, this_write, (uint8_t*)&dmp_firmware[ii])){
 			fprintf(stderr,"dmp firmware write failed\n");
 			return -1;
 		}
-		if (__mpu_read_mem(ii, this_write, cur)){
+		if (__mpu_read_mem(mpu, ii, this_write, cur)){
 			fprintf(stderr,"dmp firmware read failed\n");
 			return -1;
 		}
@@ -1065,13 +1677,72 @@ int __dmp_load_motion_driver_firmware(void)
 	// Set program start address.
 	tmp[0] = dmp_start_addr >> 8;
 	tmp[1] = dmp_start_addr & 0xFF;
-	if (rc_i2c_write_bytes(config.i2c_bus, MPU6500_PRGM_START_H, 2, tmp)){
+	if (rc_i2c_write_bytes(mpu->config.i2c_bus, MPU6500_PRGM_START_H, 2, tmp)){
 		fprintf(stderr,"ERROR writing to MPU6500_PRGM_START register\n");
 		return -1;
 	}
 	return 0;
 }
 
+/**
+ * Fast start version of __dmp_load_motion_driver_firmware. Each 256 byte bank
+ * is written in a single transfer, then the whole image is read back one bank
+ * at a time and compared by checksum in one pass instead of verifying every
+ * 16 byte chunk as it is written. Records the load and verify times in
+ * mpu->init_timing.
+ *
+ * @return     0 on success, -1 on i2c failure, -2 on checksum mismatch
+ */
+static int __dmp_load_firmware_fast(rc_mpu_t* mpu)
+{
+	unsigned short ii;
+	unsigned short this_write;
+	unsigned char cur[MPU6500_BANK_SIZE], tmp[2];
+	uint32_t expect = 2166136261u; // FNV-1a offset basis
+	uint32_t got = 2166136261u;
+	uint64_t t;
+	int j;
+
+	rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
+	t = rc_nanos_since_boot();
+	for (ii=0; ii<DMP_CODE_SIZE; ii+=this_write) {
+		this_write = min(MPU6500_BANK_SIZE, DMP_CODE_SIZE - ii);
+		if (__mpu_write_mem(mpu, ii, this_write, (uint8_t*)&dmp_firmware[ii])){
+			fprintf(stderr,"dmp firmware write failed\n");
+			return -1;
+		}
+	}
+	mpu->init_timing.firmware_load_ns = rc_nanos_since_boot() - t;
+
+	t = rc_nanos_since_boot();
+	for (ii=0; ii<DMP_CODE_SIZE; ii+=this_write) {
+		this_write = min(MPU6500_BANK_SIZE, DMP_CODE_SIZE - ii);
+		if (__mpu_read_mem(mpu, ii, this_write, cur)){
+			fprintf(stderr,"dmp firmware read failed\n");
+			return -1;
+		}
+		for(j=0;j<this_write;j++){
+			expect = (expect ^ dmp_firmware[ii+j]) * 16777619u;
+			got = (got ^ cur[j]) * 16777619u;
+		}
+	}
+	mpu->init_timing.firmware_verify_ns = rc_nanos_since_boot() - t;
+	if(got != expect){
+		fprintf(stderr,"dmp firmware write corrupted\n");
+		return -2;
+	}
+
+	// Set program start address.
+	tmp[0] = dmp_start_addr >> 8;
+	tmp[1] = dmp_start_addr & 0xFF;
+	if (rc_i2c_write_bytes(mpu->config.i2c_bus, MPU6500_PRGM_START_H, 2, tmp)){
+		fprintf(stderr,"ERROR writing to MPU6500_PRGM_START register\n");
+		return -1;
+	}
+	return 0;
+}
+
+
 /**
  *  @brief      Push gyro and accel orientation to the DMP.
  *  The orientation is represented here as the output of
@@ -1079,7 +1750,7 @@ int __dmp_load_motion_driver_firmware(void)
  *  @param[in]  orient  Gyro and accel orientation in body frame.
  *  @return     0 if successful.
 **/
-int __dmp_set_orientation(unsigned short orient)
+int __dmp_set_orientation(rc_mpu_t* mpu, unsigned short orient)
 {
 	unsigned char gyro_regs[3], accel_regs[3];
 	const unsigned char gyro_axes[3] = {DINA4C, DINACD, DINA6C};
@@ -1094,11 +1765,11 @@ int __dmp_set_orientation(unsigned short orient)
 	accel_regs[1] = accel_axes[(orient >> 3) & 3];
 	accel_regs[2] = accel_axes[(orient >> 6) & 3];
 	// Chip-to-body, axes only.
-	if (__mpu_write_mem(FCFG_1, 3, gyro_regs)){
+	if (__mpu_write_mem(mpu, FCFG_1, 3, gyro_regs)){
 		fprintf(stderr, "ERROR: in dmp_set_orientation, failed to write dmp mem\n");
 		return -1;
 	}
-	if (__mpu_write_mem(FCFG_2, 3, accel_regs)){
+	if (__mpu_write_mem(mpu, FCFG_2, 3, accel_regs)){
 		fprintf(stderr, "ERROR: in dmp_set_orientation, failed to write dmp mem\n");
 		return -1;
 	}
@@ -1117,11 +1788,11 @@ int __dmp_set_orientation(unsigned short orient)
 		accel_regs[2] |= 1;
 	}
 	// Chip-to-body, sign only.
-	if(__mpu_write_mem(FCFG_3, 3, gyro_regs)){
+	if(__mpu_write_mem(mpu, FCFG_3, 3, gyro_regs)){
 		fprintf(stderr, "ERROR: in dmp_set_orientation, failed to write dmp mem\n");
 		return -1;
 	}
-	if(__mpu_write_mem(FCFG_7, 3, accel_regs)){
+	if(__mpu_write_mem(mpu, FCFG_7, 3, accel_regs)){
 		fprintf(stderr, "ERROR: in dmp_set_orientation, failed to write dmp mem\n");
 		return -1;
 	}
@@ -1134,7 +1805,7 @@ int __dmp_set_orientation(unsigned short orient)
  *  @param[in]  rate    Desired fifo rate (Hz).
  *  @return     0 if successful.
 **/
-int __dmp_set_fifo_rate(unsigned short rate)
+int __dmp_set_fifo_rate(rc_mpu_t* mpu, unsigned short rate)
 {
 	const unsigned char regs_end[12] = {DINAFE, DINAF2, DINAAB,
 		0xc4, DINAAA, DINAF1, DINADF, DINADF, 0xBB, 0xAF, DINADF, DINADF};
@@ -1147,11 +1818,11 @@ int __dmp_set_fifo_rate(unsigned short rate)
 	div = DMP_MAX_RATE / rate - 1;
 	tmp[0] = (unsigned char)((div >> 8) & 0xFF);
 	tmp[1] = (unsigned char)(div & 0xFF);
-	if (__mpu_write_mem(D_0_22, 2, tmp)){
+	if (__mpu_write_mem(mpu, D_0_22, 2, tmp)){
 		fprintf(stderr,"ERROR: writing dmp sample rate reg");
 		return -1;
 	}
-	if (__mpu_write_mem(CFG_6, 12, (unsigned char*)regs_end)){
+	if (__mpu_write_mem(mpu, CFG_6, 12, (unsigned char*)regs_end)){
 		fprintf(stderr,"ERROR: writing dmp regs_end");
 		return -1;
 	}
@@ -1168,38 +1839,41 @@ int __dmp_set_fifo_rate(unsigned short rate)
 * USER_CTRL - based on global variable dsp_en
 * INT_PIN_CFG based on requested bypass state
 **/
-int __mpu_set_bypass(uint8_t bypass_on)
+int __mpu_set_bypass(rc_mpu_t* mpu, uint8_t bypass_on)
 {
 	uint8_t tmp = 0;
-	rc_i2c_set_device_address(config.i2c_bus, config.i2c_addr);
+	rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
 	// set up USER_CTRL first
 	// DONT USE FIFO_EN_BIT in DMP mode, or the MPU will generate lots of
 	// unwanted interruptss
-	if(dmp_en){
+	if(mpu->dmp_en){
 		tmp |= FIFO_EN_BIT; // enable fifo for dsp mode
 	}
 	if(!bypass_on){
 		tmp |= I2C_MST_EN; // i2c master mode when not in bypass
 	}
-	if (rc_i2c_write_byte(config.i2c_bus, USER_CTRL, tmp)){
+	if (rc_i2c_write_byte(mpu->config.i2c_bus, USER_CTRL, tmp)){
 		fprintf(stderr,"ERROR in mpu_set_bypass, failed to write USER_CTRL register\n");
 		return -1;
 	}
-	rc_usleep(3000);
+	// the i2c master needs a moment to finish any slave transaction in
+	// flight, fast start only waits long enough for one 400khz transfer
+	if(mpu->config.fast_start) rc_usleep(FAST_POLL_US);
+	else rc_usleep(3000);
 	// INT_PIN_CFG settings
 	tmp = LATCH_INT_EN | INT_ANYRD_CLEAR | ACTL_ACTIVE_LOW; // latching
 	//tmp =  ACTL_ACTIVE_LOW;	// non-latching
 	if(bypass_on)
 		tmp |= BYPASS_EN;
-	if (rc_i2c_write_byte(config.i2c_bus, INT_PIN_CFG, tmp)){
+	if (rc_i2c_write_byte(mpu->config.i2c_bus, INT_PIN_CFG, tmp)){
 		fprintf(stderr,"ERROR in mpu_set_bypass, failed to write INT_PIN_CFG register\n");
 		return -1;
 	}
 	if(bypass_on){
-		bypass_en = 1;
+		mpu->bypass_en = 1;
 	}
 	else{
-		bypass_en = 0;
+		mpu->bypass_en = 0;
 	}
 	return 0;
 }
@@ -1212,15 +1886,15 @@ int __mpu_set_bypass(uint8_t bypass_on)
 * but annoying in control systems we do not use it here and instead ask users
 * to run our own gyro_calibration routine.
 **/
-int __dmp_enable_gyro_cal(unsigned char enable)
+int __dmp_enable_gyro_cal(rc_mpu_t* mpu, unsigned char enable)
 {
 	if(enable){
 		unsigned char regs[9] = {0xb8, 0xaa, 0xb3, 0x8d, 0xb4, 0x98, 0x0d, 0x35, 0x5d};
-		return __mpu_write_mem(CFG_MOTION_BIAS, 9, regs);
+		return __mpu_write_mem(mpu, CFG_MOTION_BIAS, 9, regs);
 	}
 	else{
 		unsigned char regs[9] = {0xb8, 0xaa, 0xaa, 0xaa, 0xb0, 0x88, 0xc3, 0xc5, 0xc7};
-		return __mpu_write_mem(CFG_MOTION_BIAS, 9, regs);
+		return __mpu_write_mem(mpu, CFG_MOTION_BIAS, 9, regs);
 	}
 }
 
@@ -1230,7 +1904,7 @@ int __dmp_enable_gyro_cal(unsigned char enable)
 * Taken straight from the Invensense DMP code. This enabled quaternion filtering
 * with accelerometer and gyro filtering.
 **/
-int __dmp_enable_6x_lp_quat(unsigned char enable)
+int __dmp_enable_6x_lp_quat(rc_mpu_t* mpu, unsigned char enable)
 {
 	unsigned char regs[4];
 	if(enable){
@@ -1242,7 +1916,7 @@ int __dmp_enable_6x_lp_quat(unsigned char enable)
 	else{
 		memset(regs, 0xA3, 4);
 	}
-	__mpu_write_mem(CFG_8, 4, regs);
+	__mpu_write_mem(mpu, CFG_8, 4, regs);
 	return 0;
 }
 
@@ -1252,7 +1926,7 @@ int __dmp_enable_6x_lp_quat(unsigned char enable)
 * sets the DMP to do gyro-only quaternion filtering. This is not actually used
 * here but remains as a vestige of the Invensense DMP code.
 **/
-int __dmp_enable_lp_quat(unsigned char enable)
+int __dmp_enable_lp_quat(rc_mpu_t* mpu, unsigned char enable)
 {
 	unsigned char regs[4];
 	if(enable){
@@ -1264,7 +1938,7 @@ int __dmp_enable_lp_quat(unsigned char enable)
 	else{
 		memset(regs, 0x8B, 4);
 	}
-	__mpu_write_mem(CFG_LP_QUAT, 4, regs);
+	__mpu_write_mem(mpu, CFG_LP_QUAT, 4, regs);
 	return 0;
 }
 
@@ -1276,37 +1950,42 @@ int __dmp_enable_lp_quat(unsigned char enable)
 * interrupt, resets fifo and DMP, then starts them again. Used once while
 * initializing (probably no necessary) then again if the fifo gets too full.
 **/
-int __mpu_reset_fifo(void)
+int __mpu_reset_fifo(rc_mpu_t* mpu)
 {
 	uint8_t data;
 	// make sure the i2c address is set correctly.
 	// this shouldn't take any time at all if already set
-	rc_i2c_set_device_address(config.i2c_bus, config.i2c_addr);
+	rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
 	// turn off interrupts, fifo, and usr_ctrl which is where the dmp fifo is enabled
 	data = 0;
-	if (rc_i2c_write_byte(config.i2c_bus, INT_ENABLE, data)) return -1;
-	if (rc_i2c_write_byte(config.i2c_bus, FIFO_EN, data)) return -1;
-	if (rc_i2c_write_byte(config.i2c_bus, USER_CTRL, data)) return -1;
+	if (rc_i2c_write_byte(mpu->config.i2c_bus, INT_ENABLE, data)) return -1;
+	if (rc_i2c_write_byte(mpu->config.i2c_bus, FIFO_EN, data)) return -1;
+	if (rc_i2c_write_byte(mpu->config.i2c_bus, USER_CTRL, data)) return -1;
 
 	// reset fifo and wait
 	data = BIT_FIFO_RST | BIT_DMP_RST;
-	if (rc_i2c_write_byte(config.i2c_bus, USER_CTRL, data)) return -1;
+	if (rc_i2c_write_byte(mpu->config.i2c_bus, USER_CTRL, data)) return -1;
 	//rc_usleep(1000); // how I had it
-	rc_usleep(50000); // invensense standard
+	if(mpu->config.fast_start){
+		if(__poll_bits_clear(mpu, USER_CTRL, BIT_FIFO_RST|BIT_DMP_RST, FIFO_RST_TIMEOUT_US)) return -1;
+	}
+	else rc_usleep(50000); // invensense standard
 
 	// enable the fifo and DMP fifo flags again
 	// enabling DMP but NOT BIT_FIFO_EN gives quat out of bounds
 	// but also no empty interrupts
 	data = BIT_DMP_EN | BIT_FIFO_EN;
-	if(rc_i2c_write_byte(config.i2c_bus, USER_CTRL, data)){
+	// keep the internal i2c master running if it samples the magnetometer
+	if(mpu->mag_i2c_master_en) data |= I2C_MST_EN;
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, USER_CTRL, data)){
 		return -1;
 	}
 
 	// turn on dmp interrupt enable bit again
 	data = BIT_DMP_INT_EN;
-	if (rc_i2c_write_byte(config.i2c_bus, INT_ENABLE, data)) return -1;
+	if (rc_i2c_write_byte(mpu->config.i2c_bus, INT_ENABLE, data)) return -1;
 	data = 0;
-	if (rc_i2c_write_byte(config.i2c_bus, FIFO_EN, data)) return -1;
+	if (rc_i2c_write_byte(mpu->config.i2c_bus, FIFO_EN, data)) return -1;
 
 	return 0;
 }
@@ -1322,7 +2001,7 @@ int __mpu_reset_fifo(void)
  *
  * @return     { description_of_the_return_value }
  */
-int __dmp_set_interrupt_mode(unsigned char mode)
+int __dmp_set_interrupt_mode(rc_mpu_t* mpu, unsigned char mode)
 {
 	const unsigned char regs_continuous[11] =
 		{0xd8, 0xb1, 0xb9, 0xf3, 0x8b, 0xa3, 0x91, 0xb6, 0x09, 0xb4, 0xd9};
@@ -1330,9 +2009,9 @@ int __dmp_set_interrupt_mode(unsigned char mode)
 		{0xda, 0xb1, 0xb9, 0xf3, 0x8b, 0xa3, 0x91, 0xb6, 0xda, 0xb4, 0xda};
 	switch(mode){
 	case DMP_INT_CONTINUOUS:
-		return __mpu_write_mem(CFG_FIFO_ON_EVENT, 11, (unsigned char*)regs_continuous);
+		return __mpu_write_mem(mpu, CFG_FIFO_ON_EVENT, 11, (unsigned char*)regs_continuous);
 	case DMP_INT_GESTURE:
-		return __mpu_write_mem(CFG_FIFO_ON_EVENT, 11, (unsigned char*)regs_gesture);
+		return __mpu_write_mem(mpu, CFG_FIFO_ON_EVENT, 11, (unsigned char*)regs_gesture);
 	default:
 		return -1;
 	}
@@ -1344,7 +2023,7 @@ int __dmp_set_interrupt_mode(unsigned char mode)
  *  @param[in]  thresh  Tap threshold, in mg/ms.
  *  @return     0 if successful.
  */
-int __dmp_set_tap_thresh(unsigned char axis, unsigned short thresh)
+int __dmp_set_tap_thresh(rc_mpu_t* mpu, unsigned char axis, unsigned short thresh)
 {
 	unsigned char tmp[4];
 	double scaled_thresh;
@@ -1354,7 +2033,7 @@ int __dmp_set_tap_thresh(unsigned char axis, unsigned short thresh)
 
 	scaled_thresh = (double)thresh / DMP_SAMPLE_RATE;
 
-	switch (config.accel_fsr) {
+	switch (mpu->config.accel_fsr) {
 	case ACCEL_FSR_2G:
 		dmp_thresh = (unsigned short)(scaled_thresh * 16384);
 		/* dmp_thresh * 0.75 */
@@ -1384,21 +2063,21 @@ int __dmp_set_tap_thresh(unsigned char axis, unsigned short thresh)
 	tmp[3] = (unsigned char)(dmp_thresh_2 & 0xFF);
 
 	if (axis & TAP_X) {
-		if (__mpu_write_mem(DMP_TAP_THX, 2, tmp))
+		if (__mpu_write_mem(mpu, DMP_TAP_THX, 2, tmp))
 			return -1;
-		if (__mpu_write_mem(D_1_36, 2, tmp+2))
+		if (__mpu_write_mem(mpu, D_1_36, 2, tmp+2))
 			return -1;
 	}
 	if (axis & TAP_Y) {
-		if (__mpu_write_mem(DMP_TAP_THY, 2, tmp))
+		if (__mpu_write_mem(mpu, DMP_TAP_THY, 2, tmp))
 			return -1;
-		if (__mpu_write_mem(D_1_40, 2, tmp+2))
+		if (__mpu_write_mem(mpu, D_1_40, 2, tmp+2))
 			return -1;
 	}
 	if (axis & TAP_Z) {
-		if (__mpu_write_mem(DMP_TAP_THZ, 2, tmp))
+		if (__mpu_write_mem(mpu, DMP_TAP_THZ, 2, tmp))
 			return -1;
-		if (__mpu_write_mem(D_1_44, 2, tmp+2))
+		if (__mpu_write_mem(mpu, D_1_44, 2, tmp+2))
 			return -1;
 	}
 	return 0;
@@ -1409,7 +2088,7 @@ int __dmp_set_tap_thresh(unsigned char axis, unsigned short thresh)
  *  @param[in]  axis    1, 2, and 4 for XYZ, respectively.
  *  @return     0 if successful.
  */
-int __dmp_set_tap_axes(unsigned char axis)
+int __dmp_set_tap_axes(rc_mpu_t* mpu, unsigned char axis)
 {
 	unsigned char tmp = 0;
 
@@ -1419,7 +2098,7 @@ int __dmp_set_tap_axes(unsigned char axis)
 	tmp |= 0x0C;
 	if (axis & TAP_Z)
 	tmp |= 0x03;
-	return __mpu_write_mem(D_1_72, 1, &tmp);
+	return __mpu_write_mem(mpu, D_1_72, 1, &tmp);
 }
 
 /**
@@ -1427,7 +2106,7 @@ int __dmp_set_tap_axes(unsigned char axis)
  *  @param[in]  min_taps    Minimum consecutive taps (1-4).
  *  @return     0 if successful.
  */
-int __dmp_set_tap_count(unsigned char min_taps)
+int __dmp_set_tap_count(rc_mpu_t* mpu, unsigned char min_taps)
 {
 	unsigned char tmp;
 
@@ -1437,7 +2116,7 @@ int __dmp_set_tap_count(unsigned char min_taps)
 	min_taps = 4;
 
 	tmp = min_taps - 1;
-	return __mpu_write_mem(D_1_79, 1, &tmp);
+	return __mpu_write_mem(mpu, D_1_79, 1, &tmp);
 }
 
 /**
@@ -1445,7 +2124,7 @@ int __dmp_set_tap_count(unsigned char min_taps)
  *  @param[in]  time    Milliseconds between taps.
  *  @return     0 if successful.
  */
-int __dmp_set_tap_time(unsigned short time)
+int __dmp_set_tap_time(rc_mpu_t* mpu, unsigned short time)
 {
 	unsigned short dmp_time;
 	unsigned char tmp[2];
@@ -1453,7 +2132,7 @@ int __dmp_set_tap_time(unsigned short time)
 	dmp_time = time / (1000 / DMP_SAMPLE_RATE);
 	tmp[0] = (unsigned char)(dmp_time >> 8);
 	tmp[1] = (unsigned char)(dmp_time & 0xFF);
-	return __mpu_write_mem(DMP_TAPW_MIN, 2, tmp);
+	return __mpu_write_mem(mpu, DMP_TAPW_MIN, 2, tmp);
 }
 
 /**
@@ -1461,7 +2140,7 @@ int __dmp_set_tap_time(unsigned short time)
  *  @param[in]  time    Max milliseconds between taps.
  *  @return     0 if successful.
  */
-int __dmp_set_tap_time_multi(unsigned short time)
+int __dmp_set_tap_time_multi(rc_mpu_t* mpu, unsigned short time)
 {
 	unsigned short dmp_time;
 	unsigned char tmp[2];
@@ -1469,7 +2148,7 @@ int __dmp_set_tap_time_multi(unsigned short time)
 	dmp_time = time / (1000 / DMP_SAMPLE_RATE);
 	tmp[0] = (unsigned char)(dmp_time >> 8);
 	tmp[1] = (unsigned char)(dmp_time & 0xFF);
-	return __mpu_write_mem(D_1_218, 2, tmp);
+	return __mpu_write_mem(mpu, D_1_218, 2, tmp);
 }
 
 /**
@@ -1479,7 +2158,7 @@ int __dmp_set_tap_time_multi(unsigned short time)
  *  @param[in]  thresh  Gyro threshold in dps.
  *  @return     0 if successful.
  */
-int __dmp_set_shake_reject_thresh(long sf, unsigned short thresh)
+int __dmp_set_shake_reject_thresh(rc_mpu_t* mpu, long sf, unsigned short thresh)
 {
 	unsigned char tmp[4];
 	long thresh_scaled = sf / 1000 * thresh;
@@ -1487,7 +2166,7 @@ int __dmp_set_shake_reject_thresh(long sf, unsigned short thresh)
 	tmp[1] = (unsigned char)(((long)thresh_scaled >> 16) & 0xFF);
 	tmp[2] = (unsigned char)(((long)thresh_scaled >> 8) & 0xFF);
 	tmp[3] = (unsigned char)((long)thresh_scaled & 0xFF);
-	return __mpu_write_mem(D_1_92, 4, tmp);
+	return __mpu_write_mem(mpu, D_1_92, 4, tmp);
 }
 
 /**
@@ -1498,14 +2177,14 @@ int __dmp_set_shake_reject_thresh(long sf, unsigned short thresh)
  *  @param[in]  time    Time in milliseconds.
  *  @return     0 if successful.
  */
-int __dmp_set_shake_reject_time(unsigned short time)
+int __dmp_set_shake_reject_time(rc_mpu_t* mpu, unsigned short time)
 {
 	unsigned char tmp[2];
 
 	time /= (1000 / DMP_SAMPLE_RATE);
 	tmp[0] = time >> 8;
 	tmp[1] = time & 0xFF;
-	return __mpu_write_mem(D_1_90,2,tmp);
+	return __mpu_write_mem(mpu, D_1_90,2,tmp);
 }
 
 /**
@@ -1516,14 +2195,14 @@ int __dmp_set_shake_reject_time(unsigned short time)
  *  @param[in]  time    Time in milliseconds.
  *  @return     0 if successful.
  */
-int __dmp_set_shake_reject_timeout(unsigned short time)
+int __dmp_set_shake_reject_timeout(rc_mpu_t* mpu, unsigned short time)
 {
 	unsigned char tmp[2];
 
 	time /= (1000 / DMP_SAMPLE_RATE);
 	tmp[0] = time >> 8;
 	tmp[1] = time & 0xFF;
-	return __mpu_write_mem(D_1_88,2,tmp);
+	return __mpu_write_mem(mpu, D_1_88,2,tmp);
 }
 
 /**
@@ -1539,7 +2218,7 @@ int __dmp_set_shake_reject_timeout(unsigned short time)
  *
  * @return     0 on success, -1 on failure
  */
-int __dmp_enable_feature(unsigned short mask)
+int __dmp_enable_feature(rc_mpu_t* mpu, unsigned short mask)
 {
 	unsigned char tmp[10];
 	// Set integration scale factor.
@@ -1547,7 +2226,7 @@ int __dmp_enable_feature(unsigned short mask)
 	tmp[1] = (unsigned char)((GYRO_SF >> 16) & 0xFF);
 	tmp[2] = (unsigned char)((GYRO_SF >> 8) & 0xFF);
 	tmp[3] = (unsigned char)(GYRO_SF & 0xFF);
-	if(__mpu_write_mem(D_0_104, 4, tmp)<0){
+	if(__mpu_write_mem(mpu, D_0_104, 4, tmp)<0){
 		fprintf(stderr, "ERROR: in dmp_enable_feature, failed to write mpu mem\n");
 		return -1;
 	}
@@ -1574,7 +2253,7 @@ int __dmp_enable_feature(unsigned short mask)
 	tmp[7] = 0xA3;
 	tmp[8] = 0xA3;
 	tmp[9] = 0xA3;
-	if(__mpu_write_mem(CFG_15,10,tmp)<0){
+	if(__mpu_write_mem(mpu, CFG_15,10,tmp)<0){
 		fprintf(stderr, "ERROR: in dmp_enable_feature, failed to write mpu mem\n");
 		return -1;
 	}
@@ -1585,13 +2264,13 @@ int __dmp_enable_feature(unsigned short mask)
 	else{
 		tmp[0] = 0xD8;
 	}
-	if(__mpu_write_mem(CFG_27,1,tmp)){
+	if(__mpu_write_mem(mpu, CFG_27,1,tmp)){
 		fprintf(stderr, "ERROR: in dmp_enable_feature, failed to write mpu mem\n");
 		return -1;
 	}
 
-	if(mask & DMP_FEATURE_GYRO_CAL) __dmp_enable_gyro_cal(1);
-	else __dmp_enable_gyro_cal(0);
+	if(mask & DMP_FEATURE_GYRO_CAL) __dmp_enable_gyro_cal(mpu, 1);
+	else __dmp_enable_gyro_cal(mpu, 0);
 
 	if (mask & DMP_FEATURE_SEND_ANY_GYRO) {
 		if (mask & DMP_FEATURE_SEND_CAL_GYRO) {
@@ -1605,28 +2284,28 @@ int __dmp_enable_feature(unsigned short mask)
 			tmp[2] = DINAC2;
 			tmp[3] = DINA90;
 		}
-		__mpu_write_mem(CFG_GYRO_RAW_DATA, 4, tmp);
+		__mpu_write_mem(mpu, CFG_GYRO_RAW_DATA, 4, tmp);
 	}
 
 	// configure tap feature
 	if (mask & DMP_FEATURE_TAP) {
 		/* Enable tap. */
 		tmp[0] = 0xF8;
-		__mpu_write_mem(CFG_20, 1, tmp);
-		__dmp_set_tap_thresh(TAP_XYZ, config.tap_threshold);
-		__dmp_set_tap_axes(TAP_XYZ);
-		__dmp_set_tap_count(1); //minimum number of taps needed for an interrupt (1-4)
-		__dmp_set_tap_time(100); // ms between taps (factory default 100)
-		__dmp_set_tap_time_multi(600); // max time between taps for multitap detection (factory default 500)
+		__mpu_write_mem(mpu, CFG_20, 1, tmp);
+		__dmp_set_tap_thresh(mpu, TAP_XYZ, mpu->config.tap_threshold);
+		__dmp_set_tap_axes(mpu, TAP_XYZ);
+		__dmp_set_tap_count(mpu, 1); //minimum number of taps needed for an interrupt (1-4)
+		__dmp_set_tap_time(mpu, 100); // ms between taps (factory default 100)
+		__dmp_set_tap_time_multi(mpu, 600); // max time between taps for multitap detection (factory default 500)
 
 		// shake rejection ignores taps when system is moving, set threshold
 		// high so this doesn't happen too often
-		__dmp_set_shake_reject_thresh(GYRO_SF, 300); // default was 200
-		__dmp_set_shake_reject_time(80);
-		__dmp_set_shake_reject_timeout(100);
+		__dmp_set_shake_reject_thresh(mpu, GYRO_SF, 300); // default was 200
+		__dmp_set_shake_reject_time(mpu, 80);
+		__dmp_set_shake_reject_timeout(mpu, 100);
 	} else {
 		tmp[0] = 0xD8;
-		__mpu_write_mem(CFG_20, 1, tmp);
+		__mpu_write_mem(mpu, CFG_20, 1, tmp);
 	}
 
 
@@ -1634,33 +2313,33 @@ int __dmp_enable_feature(unsigned short mask)
 		tmp[0] = 0xD9;
 	} else
 		tmp[0] = 0xD8;
-	__mpu_write_mem(CFG_ANDROID_ORIENT_INT, 1, tmp);
+	__mpu_write_mem(mpu, CFG_ANDROID_ORIENT_INT, 1, tmp);
 
 	if (mask & DMP_FEATURE_LP_QUAT){
-		__dmp_enable_lp_quat(1);
+		__dmp_enable_lp_quat(mpu, 1);
 	}
 	else{
-		__dmp_enable_lp_quat(0);
+		__dmp_enable_lp_quat(mpu, 0);
 	}
 	if (mask & DMP_FEATURE_6X_LP_QUAT){
-		__dmp_enable_6x_lp_quat(1);
+		__dmp_enable_6x_lp_quat(mpu, 1);
 	}
 	else{
-		__dmp_enable_6x_lp_quat(0);
+		__dmp_enable_6x_lp_quat(mpu, 0);
 	}
-	__mpu_reset_fifo();
-	packet_len = 0;
+	__mpu_reset_fifo(mpu);
+	mpu->packet_len = 0;
 	if(mask & DMP_FEATURE_SEND_RAW_ACCEL){
-		packet_len += 6;
+		mpu->packet_len += 6;
 	}
 	if(mask & DMP_FEATURE_SEND_ANY_GYRO){
-		packet_len += 6;
+		mpu->packet_len += 6;
 	}
 	if(mask & (DMP_FEATURE_LP_QUAT | DMP_FEATURE_6X_LP_QUAT)){
-		packet_len += 16;
+		mpu->packet_len += 16;
 	}
 	if(mask & (DMP_FEATURE_TAP | DMP_FEATURE_ANDROID_ORIENT)){
-		packet_len += 4;
+		mpu->packet_len += 4;
 	}
 	return 0;
 }
@@ -1672,7 +2351,7 @@ int __dmp_enable_feature(unsigned short mask)
  *
  * @return     0 on success, -1 on failure
  */
-int __set_int_enable(unsigned char enable)
+int __set_int_enable(rc_mpu_t* mpu, unsigned char enable)
 {
 	unsigned char tmp;
 	if (enable){
@@ -1681,12 +2360,12 @@ int __set_int_enable(unsigned char enable)
 	else{
 		tmp = 0x00;
 	}
-	if(rc_i2c_write_byte(config.i2c_bus, INT_ENABLE, tmp)){
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, INT_ENABLE, tmp)){
 		fprintf(stderr, "ERROR: in set_int_enable, failed to write INT_ENABLE register\n");
 		return -1;
 	}
 	// disable all other FIFO features leaving just DMP
-	if (rc_i2c_write_byte(config.i2c_bus, FIFO_EN, 0)){
+	if (rc_i2c_write_byte(mpu->config.i2c_bus, FIFO_EN, 0)){
 		fprintf(stderr, "ERROR: in set_int_enable, failed to write FIFO_EN register\n");
 		return -1;
 	}
@@ -1700,7 +2379,7 @@ int __set_int_enable(unsigned char enable)
  *
  * @return     0 on success, -1 on failure
  */
-int __mpu_set_sample_rate(int rate)
+int __mpu_set_sample_rate(rc_mpu_t* mpu, int rate)
 {
 	if(rate>1000 || rate<4){
 		fprintf(stderr,"ERROR: sample rate must be between 4 & 1000\n");
@@ -1711,7 +2390,7 @@ int __mpu_set_sample_rate(int rate)
 	#ifdef DEBUG
 	printf("setting divider to %d\n", div);
 	#endif
-	if(rc_i2c_write_byte(config.i2c_bus, SMPLRT_DIV, div)){
+	if(rc_i2c_write_byte(mpu->config.i2c_bus, SMPLRT_DIV, div)){
 		fprintf(stderr,"ERROR: in mpu_set_sample_rate, failed to write SMPLRT_DIV register\n");
 		return -1;
 	}
@@ -1727,25 +2406,26 @@ int __mpu_set_sample_rate(int rate)
  *
  * @return     0 on success, -1 on failure
  */
-int __mpu_set_dmp_state(unsigned char enable)
+int __mpu_set_dmp_state(rc_mpu_t* mpu, unsigned char enable)
 {
 	if (enable) {
 		// Disable data ready interrupt.
-		__set_int_enable(0);
-		// make sure bypass mode is enabled
-		__mpu_set_bypass(1);
+		__set_int_enable(mpu, 0);
+		// make sure bypass mode is enabled unless the internal i2c master
+		// is busy sampling the magnetometer
+		__mpu_set_bypass(mpu, !mpu->mag_i2c_master_en);
 		// Remove FIFO elements.
-		rc_i2c_write_byte(config.i2c_bus, FIFO_EN , 0);
+		rc_i2c_write_byte(mpu->config.i2c_bus, FIFO_EN , 0);
 		// Enable DMP interrupt.
-		__set_int_enable(1);
-		__mpu_reset_fifo();
+		__set_int_enable(mpu, 1);
+		__mpu_reset_fifo(mpu);
 	}
 	else {
 		// Disable DMP interrupt.
-		__set_int_enable(0);
+		__set_int_enable(mpu, 0);
 		// Restore FIFO settings.
-		rc_i2c_write_byte(config.i2c_bus, FIFO_EN , 0);
-		__mpu_reset_fifo();
+		rc_i2c_write_byte(mpu->config.i2c_bus, FIFO_EN , 0);
+		__mpu_reset_fifo(mpu);
 	}
 	return 0;
 }
@@ -1759,149 +2439,467 @@ int __mpu_set_dmp_state(unsigned char enable)
  *
  * @return     0 on success, -1 on failure
  */
-void* __dmp_interrupt_handler(__attribute__ ((unused)) void* ptr)
+void* __dmp_interrupt_handler(void* ptr)
 {
+	rc_mpu_t* mpu = (rc_mpu_t*)ptr;
 	//struct pollfd fdset[1];
 	int ret;
 	// start magnetometer read divider at the end of the counter
 	// so it reads on the first run
-	int mag_div_step = config.mag_sample_rate_div;
+	int mag_div_step = mpu->config.mag_sample_rate_div;
 	//char buf[64];
 	int first_run = 1;
-	__mpu_reset_fifo();
+	int read_mag;
+	if(!mpu->ahrs_en) __mpu_reset_fifo(mpu);
 
-	while(!imu_shutdown_flag){
+	while(!mpu->imu_shutdown_flag){
 		// system hangs here until IMU FIFO interrupt
-		ret = rc_gpio_poll(	config.gpio_interrupt_pin_chip,
-					config.gpio_interrupt_pin,
+		ret = rc_gpio_poll(	mpu->config.gpio_interrupt_pin_chip,
+					mpu->config.gpio_interrupt_pin,
 					IMU_POLL_TIMEOUT,
-					&last_interrupt_timestamp_nanos);
+					&mpu->last_interrupt_timestamp_nanos);
 		// check for bad things that may have happened
-		if(imu_shutdown_flag) break;
+		if(mpu->imu_shutdown_flag) break;
 		if(ret == RC_GPIOEVENT_ERROR){
 			fprintf(stderr, "ERROR in IMU interrupt handler calling poll\n");
 			continue;
 		}
 		if(ret == RC_GPIOEVENT_TIMEOUT){
-			if(config.show_warnings){
+			if(mpu->config.show_warnings){
 				fprintf(stderr, "WARNING, gpio poll timeout\n");
 			}
 			continue;
 		}
 
-		// try to load fifo no matter the claim bus state
-		if(rc_i2c_get_lock(config.i2c_bus)){
-			fprintf(stderr,"WARNING: Something has claimed the I2C bus when an\n");
-			fprintf(stderr,"IMU interrupt was received. Reading IMU anyway.\n");
+		// aquires bus at high priority so we are next in line behind any
+		// transaction already in progress, another instance may have left
+		// a different address
+		rc_i2c_lock_bus_priority(mpu->config.i2c_bus, RC_I2C_PRIORITY_HIGH);
+		rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
+		// read data, in AHRS mode and with the i2c master sampling the
+		// magnetometer its data comes in the same transaction as the
+		// sample so it is ready before the filters run
+		read_mag = 0;
+		if(mpu->config.enable_magnetometer && (mpu->ahrs_en || mpu->mag_i2c_master_en)){
+			if(mag_div_step>=mpu->config.mag_sample_rate_div){
+				read_mag = 1;
+				mag_div_step=1;
+			}
+			else mag_div_step++;
 		}
-		// aquires bus
-		rc_i2c_lock_bus(config.i2c_bus);
-		// aquires mutex
-		pthread_mutex_lock( &read_mutex );
-		pthread_mutex_lock( &tap_mutex );
-		// read data
-		ret = __read_dmp_fifo(data_ptr);
-		rc_i2c_unlock_bus(config.i2c_bus);
+		if(mpu->ahrs_en) ret = __read_ahrs_sample(mpu, mpu->data_ptr, read_mag);
+		else ret = __read_dmp_fifo(mpu, mpu->data_ptr, read_mag);
 		// record if it was successful or not
 		if(ret==0){
-			last_read_successful=1;
-			if(data_ptr->tap_detected){
-				last_tap_timestamp_nanos = last_interrupt_timestamp_nanos;
+			mpu->last_read_successful=1;
+			if(mpu->data_ptr->tap_detected){
+				mpu->last_tap_timestamp_nanos = mpu->last_interrupt_timestamp_nanos;
+			}
+		}
+		else{
+			mpu->last_read_successful=0;
+		}
+		// if reading mag before callback in bypass mode, check divider and
+		// do it now, the other modes already read it with the sample
+		if(mpu->config.enable_magnetometer && !mpu->ahrs_en && !mpu->mag_i2c_master_en && !mpu->config.read_mag_after_callback){
+			if(mag_div_step>=mpu->config.mag_sample_rate_div){
+				#ifdef DEBUG
+				printf("reading mag before callback\n");
+				#endif
+				rc_mpu_instance_read_mag(mpu, mpu->data_ptr);
+				mag_div_step=1;
+			}
+			else mag_div_step++;
+		}
+		// releases bus
+		rc_i2c_unlock_bus(mpu->config.i2c_bus);
+		// call the user function if not the first run
+		if(first_run == 1){
+			first_run = 0;
+		}
+		else if(mpu->last_read_successful){
+			// publish a consistent copy for rc_mpu_get_latest before
+			// anyone is told there is new data
+			__publish_data(mpu, mpu->data_ptr);
+			// signals that a measurement is available to blocking function
+			pthread_mutex_lock(&mpu->read_mutex);
+			pthread_cond_broadcast(&mpu->read_condition);
+			pthread_mutex_unlock(&mpu->read_mutex);
+			if(mpu->data_ptr->tap_detected){
+				pthread_mutex_lock(&mpu->tap_mutex);
+				pthread_cond_broadcast(&mpu->tap_condition);
+				pthread_mutex_unlock(&mpu->tap_mutex);
 			}
+			// user callbacks run outside of the mutexes so a slow callback
+			// or a waiting reader can never stall the other
+			if(mpu->dmp_callback_func!=NULL) mpu->dmp_callback_func();
+			__dispatch_subscribers(mpu, mpu->data_ptr);
+			__online_cal_accel(mpu, mpu->data_ptr);
+			// additionally call tap callback if one was received
+			if(mpu->data_ptr->tap_detected){
+				if(mpu->tap_callback_func!=NULL) mpu->tap_callback_func(mpu->data_ptr->last_tap_direction, mpu->data_ptr->last_tap_count);
+			}
+		}
+
+		// if reading mag after interrupt, check divider and do it now
+		if(mpu->config.enable_magnetometer && mpu->config.read_mag_after_callback && !mpu->mag_i2c_master_en && !mpu->ahrs_en){
+			if(mag_div_step>=mpu->config.mag_sample_rate_div){
+				#ifdef DEBUG
+				printf("reading mag after ISR\n");
+				#endif
+				rc_i2c_lock_bus_priority(mpu->config.i2c_bus, RC_I2C_PRIORITY_HIGH);
+				rc_mpu_instance_read_mag(mpu, mpu->data_ptr);
+				rc_i2c_unlock_bus(mpu->config.i2c_bus);
+				mag_div_step=1;
+			}
+			else mag_div_step++;
+		}
+	}
+
+	// shutting down now, do some cleanup
+	// aquires mutex
+	pthread_mutex_lock( &mpu->read_mutex );
+	// /releases other threads
+	pthread_cond_broadcast( &mpu->read_condition );
+	// releases mutex
+	pthread_mutex_unlock( &mpu->read_mutex );
+	mpu->thread_running_flag = 0;
+	return 0;
+}
+
+/**
+ * sets a user function to be called when new data is read
+ *
+ * @param[in]  func  The function
+ *
+ * @return     0 on success, -1 on failure
+ */
+int rc_mpu_instance_set_dmp_callback(rc_mpu_t* mpu, void (*func)(void))
+{
+	if(func==NULL){
+		fprintf(stderr,"ERROR: trying to assign NULL pointer to dmp_callback_func\n");
+		return -1;
+	}
+	mpu->dmp_callback_func = func;
+	return 0;
+}
+
+int rc_mpu_instance_set_tap_callback(rc_mpu_t* mpu, void (*func)(int dir, int cnt))
+{
+	if(func==NULL){
+		fprintf(stderr,"ERROR: trying to assign NULL pointer to tap_callback_func\n");
+		return -1;
+	}
+	mpu->tap_callback_func = func;
+	return 0;
+}
+
+rc_mpu_subscriber_config_t rc_mpu_subscriber_default_config(void)
+{
+	rc_mpu_subscriber_config_t conf;
+	conf.queue_len = 0;
+	conf.sched_policy = SCHED_OTHER;
+	conf.priority = 0;
+	conf.budget_ns = 0;
+	return conf;
+}
+
+
+/**
+ * Records one callback duration in a subscriber's stats. Caller must hold
+ * whichever mutex protects the stats.
+ */
+static void __record_call(__subscriber_t* sub, uint64_t ns)
+{
+	sub->stats.calls++;
+	sub->stats.last_ns = ns;
+	sub->stats.total_ns += ns;
+	if(ns > sub->stats.max_ns) sub->stats.max_ns = ns;
+	if(sub->conf.budget_ns && ns > sub->conf.budget_ns) sub->stats.overruns++;
+	return;
+}
+
+
+/**
+ * Runs inline subscribers and pushes a copy of the sample onto the queue of
+ * each queued subscriber. Called by the interrupt thread after every sample.
+ *
+ * Inline functions run without sub_mutex held so they may call the other
+ * subscriber functions. The busy flag keeps the slot from being freed under
+ * them, an unsubscribe from another thread waits on sub_cond for it to clear.
+ */
+static void __dispatch_subscribers(rc_mpu_t* mpu, rc_mpu_data_t* data)
+{
+	int i, tail;
+	uint64_t t, dt;
+	__subscriber_t* sub;
+
+	// inline subscribers first, one at a time
+	for(i=0;i<RC_MPU_MAX_SUBSCRIBERS;i++){
+		sub = &mpu->subscribers[i];
+		pthread_mutex_lock(&mpu->sub_mutex);
+		if(sub->state!=SUB_ACTIVE || sub->conf.queue_len!=0){
+			pthread_mutex_unlock(&mpu->sub_mutex);
+			continue;
 		}
-		else{
-			last_read_successful=0;
+		sub->busy = 1;
+		mpu->dispatch_thread = pthread_self();
+		pthread_mutex_unlock(&mpu->sub_mutex);
+
+		t = rc_nanos_since_boot();
+		sub->func(data, sub->ctx);
+		dt = rc_nanos_since_boot()-t;
+
+		pthread_mutex_lock(&mpu->sub_mutex);
+		__record_call(sub, dt);
+		sub->busy = 0;
+		if(sub->release){
+			sub->release = 0;
+			sub->state = SUB_FREE;
 		}
-		// if reading mag before callback, check divider and do it now
-		if(config.enable_magnetometer && !config.read_mag_after_callback){
-			if(mag_div_step>=config.mag_sample_rate_div){
-				#ifdef DEBUG
-				printf("reading mag before callback\n");
-				#endif
-				rc_mpu_read_mag(data_ptr);
-				// reset address back for next read
-				rc_i2c_set_device_address(config.i2c_bus,config.i2c_addr);
-				mag_div_step=1;
-			}
-			else mag_div_step++;
+		pthread_cond_broadcast(&mpu->sub_cond);
+		pthread_mutex_unlock(&mpu->sub_mutex);
+	}
+
+	// then copy the sample to each queue
+	pthread_mutex_lock(&mpu->sub_mutex);
+	for(i=0;i<RC_MPU_MAX_SUBSCRIBERS;i++){
+		sub = &mpu->subscribers[i];
+		if(sub->state!=SUB_ACTIVE || sub->conf.queue_len==0) continue;
+		pthread_mutex_lock(&sub->mutex);
+		if(sub->count==sub->conf.queue_len){
+			// full, drop the oldest so the subscriber catches up
+			sub->head = (sub->head+1) % sub->conf.queue_len;
+			sub->count--;
+			sub->stats.dropped++;
 		}
-		// releases bus
-		rc_i2c_unlock_bus(config.i2c_bus);
-		// call the user function if not the first run
-		if(first_run == 1){
-			first_run = 0;
+		tail = (sub->head+sub->count) % sub->conf.queue_len;
+		sub->queue[tail] = *data;
+		sub->count++;
+		if(sub->count > sub->stats.max_queue_depth) sub->stats.max_queue_depth = sub->count;
+		pthread_cond_signal(&sub->cond);
+		pthread_mutex_unlock(&sub->mutex);
+	}
+	pthread_mutex_unlock(&mpu->sub_mutex);
+	return;
+}
+
+
+/**
+ * Thread for one queued subscriber, pops samples and calls the user's
+ * function outside of the queue mutex.
+ */
+static void* __subscriber_thread(void* ptr)
+{
+	__subscriber_t* sub = (__subscriber_t*)ptr;
+	rc_mpu_data_t sample;
+	uint64_t t, dt;
+
+	pthread_mutex_lock(&sub->mutex);
+	while(1){
+		while(sub->running && sub->count==0){
+			pthread_cond_wait(&sub->cond, &sub->mutex);
 		}
-		else if(last_read_successful){
-			if(dmp_callback_func!=NULL) dmp_callback_func();
-			// signals that a measurement is available to blocking function
-			pthread_cond_broadcast(&read_condition);
-			// additionally call tap callback if one was received
-			if(data_ptr->tap_detected){
-				if(tap_callback_func!=NULL) tap_callback_func(data_ptr->last_tap_direction, data_ptr->last_tap_count);
-				pthread_cond_broadcast(&tap_condition);
-			}
+		if(!sub->running) break;
+		sample = sub->queue[sub->head];
+		sub->head = (sub->head+1) % sub->conf.queue_len;
+		sub->count--;
+		pthread_mutex_unlock(&sub->mutex);
+
+		t = rc_nanos_since_boot();
+		sub->func(&sample, sub->ctx);
+		dt = rc_nanos_since_boot()-t;
+
+		pthread_mutex_lock(&sub->mutex);
+		__record_call(sub, dt);
+	}
+	pthread_mutex_unlock(&sub->mutex);
+	return NULL;
+}
+
+
+int rc_mpu_instance_subscribe(rc_mpu_t* mpu, rc_mpu_subscriber_func_t func, void* ctx, rc_mpu_subscriber_config_t conf)
+{
+	int i, id = -1;
+	__subscriber_t* sub;
+
+	if(mpu==NULL || func==NULL){
+		fprintf(stderr,"ERROR: in rc_mpu_subscribe, received NULL pointer\n");
+		return -1;
+	}
+	if(conf.queue_len<0){
+		fprintf(stderr,"ERROR: in rc_mpu_subscribe, queue_len must be >= 0\n");
+		return -1;
+	}
+	// reserve a free slot
+	pthread_mutex_lock(&mpu->sub_mutex);
+	for(i=0;i<RC_MPU_MAX_SUBSCRIBERS;i++){
+		if(mpu->subscribers[i].state==SUB_FREE){
+			id = i;
+			mpu->subscribers[i].state = SUB_CLOSING;
+			break;
 		}
+	}
+	pthread_mutex_unlock(&mpu->sub_mutex);
+	if(id<0){
+		fprintf(stderr,"ERROR: in rc_mpu_subscribe, already %d subscribers\n", RC_MPU_MAX_SUBSCRIBERS);
+		return -1;
+	}
 
-		// releases mutex
-		pthread_mutex_unlock(&read_mutex);
-		pthread_mutex_unlock(&tap_mutex);
+	sub = &mpu->subscribers[id];
+	sub->func = func;
+	sub->ctx = ctx;
+	sub->conf = conf;
+	memset(&sub->stats, 0, sizeof(sub->stats));
+	sub->queue = NULL;
+	sub->head = 0;
+	sub->count = 0;
+	sub->busy = 0;
+	sub->release = 0;
 
-		// if reading mag after interrupt, check divider and do it now
-		if(config.enable_magnetometer && config.read_mag_after_callback){
-			if(mag_div_step>=config.mag_sample_rate_div){
-				#ifdef DEBUG
-				printf("reading mag after ISR\n");
-				#endif
-				rc_i2c_lock_bus(config.i2c_bus);
-				rc_mpu_read_mag(data_ptr);
-				rc_i2c_unlock_bus(config.i2c_bus);
-				// reset address back for next read
-				rc_i2c_set_device_address(config.i2c_bus,config.i2c_addr);
-				mag_div_step=1;
-			}
-			else mag_div_step++;
+	if(conf.queue_len>0){
+		sub->queue = malloc(conf.queue_len*sizeof(rc_mpu_data_t));
+		if(sub->queue==NULL){
+			perror("ERROR in rc_mpu_subscribe, failed to allocate memory for queue");
+			sub->state = SUB_FREE;
+			return -1;
+		}
+		pthread_mutex_init(&sub->mutex, NULL);
+		pthread_cond_init(&sub->cond, NULL);
+		sub->running = 1;
+		if(rc_pthread_create(&sub->thread, __subscriber_thread, sub,
+					conf.sched_policy, conf.priority)<0){
+			fprintf(stderr,"ERROR: in rc_mpu_subscribe, failed to start subscriber thread\n");
+			pthread_cond_destroy(&sub->cond);
+			pthread_mutex_destroy(&sub->mutex);
+			free(sub->queue);
+			sub->queue = NULL;
+			sub->state = SUB_FREE;
+			return -1;
 		}
 	}
 
-	// shutting down now, do some cleanup
-	// aquires mutex
-	pthread_mutex_lock( &read_mutex );
-	// /releases other threads
-	pthread_cond_broadcast( &read_condition );
-	// releases mutex
-	pthread_mutex_unlock( &read_mutex );
-	thread_running_flag = 0;
-	return 0;
+	// publish to the interrupt thread
+	pthread_mutex_lock(&mpu->sub_mutex);
+	sub->state = SUB_ACTIVE;
+	pthread_mutex_unlock(&mpu->sub_mutex);
+	return id;
 }
 
-/**
- * sets a user function to be called when new data is read
- *
- * @param[in]  func  The function
- *
- * @return     0 on success, -1 on failure
- */
-int rc_mpu_set_dmp_callback(void (*func)(void))
+
+int rc_mpu_instance_unsubscribe(rc_mpu_t* mpu, int id)
 {
-	if(func==NULL){
-		fprintf(stderr,"ERROR: trying to assign NULL pointer to dmp_callback_func\n");
+	__subscriber_t* sub;
+
+	if(mpu==NULL){
+		fprintf(stderr,"ERROR: in rc_mpu_unsubscribe, received NULL pointer\n");
+		return -1;
+	}
+	if(id<0 || id>=RC_MPU_MAX_SUBSCRIBERS){
+		fprintf(stderr,"ERROR: in rc_mpu_unsubscribe, invalid id\n");
+		return -1;
+	}
+	sub = &mpu->subscribers[id];
+	// after this the interrupt thread no longer touches the slot
+	pthread_mutex_lock(&mpu->sub_mutex);
+	if(sub->state!=SUB_ACTIVE){
+		pthread_mutex_unlock(&mpu->sub_mutex);
+		fprintf(stderr,"ERROR: in rc_mpu_unsubscribe, id %d not subscribed\n", id);
 		return -1;
 	}
-	dmp_callback_func = func;
+	sub->state = SUB_CLOSING;
+	if(sub->conf.queue_len==0){
+		if(sub->busy){
+			// from inside its own function the dispatcher frees the
+			// slot once it returns, otherwise wait for it to return
+			if(pthread_equal(pthread_self(), mpu->dispatch_thread)){
+				sub->release = 1;
+				pthread_mutex_unlock(&mpu->sub_mutex);
+				return 0;
+			}
+			while(sub->busy) pthread_cond_wait(&mpu->sub_cond, &mpu->sub_mutex);
+		}
+		sub->state = SUB_FREE;
+		pthread_mutex_unlock(&mpu->sub_mutex);
+		return 0;
+	}
+	pthread_mutex_unlock(&mpu->sub_mutex);
+
+	// queued subscriber, stop its thread
+	pthread_mutex_lock(&sub->mutex);
+	sub->running = 0;
+	pthread_cond_signal(&sub->cond);
+	pthread_mutex_unlock(&sub->mutex);
+	if(rc_pthread_timed_join(sub->thread, NULL, 1.0)==1){
+		fprintf(stderr,"WARNING: in rc_mpu_unsubscribe, subscriber thread exit timeout\n");
+	}
+	pthread_cond_destroy(&sub->cond);
+	pthread_mutex_destroy(&sub->mutex);
+	free(sub->queue);
+	sub->queue = NULL;
+
+	pthread_mutex_lock(&mpu->sub_mutex);
+	sub->state = SUB_FREE;
+	pthread_mutex_unlock(&mpu->sub_mutex);
 	return 0;
 }
 
-int rc_mpu_set_tap_callback(void (*func)(int dir, int cnt))
+
+int rc_mpu_instance_get_subscriber_stats(rc_mpu_t* mpu, int id, rc_mpu_subscriber_stats_t* stats)
 {
-	if(func==NULL){
-		fprintf(stderr,"ERROR: trying to assign NULL pointer to tap_callback_func\n");
+	__subscriber_t* sub;
+
+	if(mpu==NULL || stats==NULL){
+		fprintf(stderr,"ERROR: in rc_mpu_get_subscriber_stats, received NULL pointer\n");
+		return -1;
+	}
+	if(id<0 || id>=RC_MPU_MAX_SUBSCRIBERS){
+		fprintf(stderr,"ERROR: in rc_mpu_get_subscriber_stats, invalid id\n");
+		return -1;
+	}
+	sub = &mpu->subscribers[id];
+	pthread_mutex_lock(&mpu->sub_mutex);
+	if(sub->state!=SUB_ACTIVE){
+		pthread_mutex_unlock(&mpu->sub_mutex);
+		fprintf(stderr,"ERROR: in rc_mpu_get_subscriber_stats, id %d not subscribed\n", id);
 		return -1;
 	}
-	tap_callback_func = func;
+	if(sub->conf.queue_len>0){
+		pthread_mutex_lock(&sub->mutex);
+		*stats = sub->stats;
+		pthread_mutex_unlock(&sub->mutex);
+	}
+	else *stats = sub->stats;
+	pthread_mutex_unlock(&mpu->sub_mutex);
 	return 0;
 }
 
 
+
+/**
+ * Tait-Bryan angles from a quaternion. With config.fast_trig this uses the
+ * polynomial approximations for this instance only, otherwise it follows
+ * rc_quaternion_to_tb_array() and whatever the user chose for it.
+ */
+static void __quat_to_tb(rc_mpu_t* mpu, double q[4], double tb[3])
+{
+	if(mpu->config.fast_trig) rc_quaternion_to_tb_array_fast(q, tb);
+	else rc_quaternion_to_tb_array(q, tb);
+	return;
+}
+
+
+/**
+ * quaternion from Tait-Bryan angles, the inverse of __quat_to_tb
+ */
+static void __tb_to_quat(rc_mpu_t* mpu, double tb[3], double q[4])
+{
+	if(mpu->config.fast_trig) rc_quaternion_from_tb_array_fast(tb, q);
+	else rc_quaternion_from_tb_array(tb, q);
+	return;
+}
+
+
 /**
  * Reads the FIFO buffer and populates the data struct. Here is where we see
  * bad/empty/double packets due to i2c bus errors and the IMU failing to have
@@ -1910,42 +2908,45 @@ int rc_mpu_set_tap_callback(void (*func)(int dir, int cnt))
  * errors are detected then this function tries some i2c transfers a second
  * time.
  *
- * @param      data  The data pointer
+ * @param      data      The data pointer
+ * @param[in]  read_mag  1 to also read the magnetometer from EXT_SENS_DATA when
+ * the i2c master is sampling it
  *
  * @return     0 on success, -1 on failure
  */
-int __read_dmp_fifo(rc_mpu_data_t* data)
+int __read_dmp_fifo(rc_mpu_t* mpu, rc_mpu_data_t* data, int read_mag)
 {
 	unsigned char raw[MAX_FIFO_BUFFER];
+	uint8_t mag_raw[8];
+	rc_i2c_read_t reads[2];
 	int32_t quat_q14[4], quat[4], quat_mag_sq;
 	uint16_t fifo_count;
 	int ret;
 	int i = 0; // position of beginning of quaternion
 	int j = 0; // position of beginning of accel/gyro data
-	static int first_run = 1; // set to 0 after first call
 	double q_tmp[4];
 	double sum,qlen;
 
-	if(!dmp_en){
+	if(!mpu->dmp_en){
 		printf("only use mpu_read_fifo in dmp mode\n");
 		return -1;
 	}
 
 	// if the fifo packet_len variable not set up yet, this function must
 	// have been called prematurely
-	if(packet_len!=FIFO_LEN_QUAT_ACCEL_GYRO_TAP && packet_len!=FIFO_LEN_QUAT_TAP){
+	if(mpu->packet_len!=FIFO_LEN_QUAT_ACCEL_GYRO_TAP && mpu->packet_len!=FIFO_LEN_QUAT_TAP){
 		fprintf(stderr,"ERROR: packet_len is set incorrectly for read_dmp_fifo\n");
 		return -1;
 	}
 
 	// make sure the i2c address is set correctly.
 	// this shouldn't take any time at all if already set
-	rc_i2c_set_device_address(config.i2c_bus, config.i2c_addr);
+	rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
 	int is_new_dmp_data = 0;
 
 	// check fifo count register to make sure new data is there
-	if(rc_i2c_read_word(config.i2c_bus, FIFO_COUNTH, &fifo_count)<0){
-		if(config.show_warnings){
+	if(rc_i2c_read_word(mpu->config.i2c_bus, FIFO_COUNTH, &fifo_count)<0){
+		if(mpu->config.show_warnings){
 			printf("fifo_count i2c error: %s\n",strerror(errno));
 		}
 		return -1;
@@ -1960,48 +2961,48 @@ int __read_dmp_fifo(rc_mpu_data_t* data)
 
 	// if empty FIFO, just return, nothing else to do
 	if(fifo_count==0){
-		if(config.show_warnings && first_run!=1){
+		if(mpu->config.show_warnings && mpu->fifo_first_run!=1){
 			printf("WARNING: empty fifo\n");
 		}
 		return -1;
 	}
 	// one packet, perfect!
-	else if(fifo_count==packet_len){
+	else if(fifo_count==mpu->packet_len){
 		i = 0; // set quaternion offset to 0
 	}
 	// if exactly 2 or 3 packets are there we just missed some (whoops)
 	// read both in and set the offset i to one packet length
 	// the last packet data will be read normally
-	else if(fifo_count==2*packet_len){
-		if(config.show_warnings&& first_run!=1){
+	else if(fifo_count==2*mpu->packet_len){
+		if(mpu->config.show_warnings&& mpu->fifo_first_run!=1){
 			printf("warning: imu fifo contains two packets\n");
 		}
-		i=packet_len;
+		i=mpu->packet_len;
 	}
-	else if(fifo_count==3*packet_len){
-		if(config.show_warnings&& first_run!=1){
+	else if(fifo_count==3*mpu->packet_len){
+		if(mpu->config.show_warnings&& mpu->fifo_first_run!=1){
 			printf("warning: imu fifo contains three packets\n");
 		}
-		i=2*packet_len;
+		i=2*mpu->packet_len;
 	}
-	else if(fifo_count==4*packet_len){
-		if(config.show_warnings&& first_run!=1){
+	else if(fifo_count==4*mpu->packet_len){
+		if(mpu->config.show_warnings&& mpu->fifo_first_run!=1){
 			printf("warning: imu fifo contains four packets\n");
 		}
-		i=2*packet_len;
+		i=2*mpu->packet_len;
 	}
-	else if(fifo_count==5*packet_len){
-		if(config.show_warnings&& first_run!=1){
+	else if(fifo_count==5*mpu->packet_len){
+		if(mpu->config.show_warnings&& mpu->fifo_first_run!=1){
 			printf("warning: imu fifo contains five packets\n");
 		}
-		i=2*packet_len;
+		i=2*mpu->packet_len;
 	}
 	// finally, if we got a weird packet length, reset the fifo
 	else{
-		if(config.show_warnings && first_run!=1){
-			printf("warning: %d bytes in FIFO, expected %d\n", fifo_count,packet_len);
+		if(mpu->config.show_warnings && mpu->fifo_first_run!=1){
+			printf("warning: %d bytes in FIFO, expected %d\n", fifo_count,mpu->packet_len);
 		}
-		__mpu_reset_fifo();
+		__mpu_reset_fifo(mpu);
 		return -1;
 	}
 
@@ -2009,16 +3010,35 @@ int __read_dmp_fifo(rc_mpu_data_t* data)
 	* read in the fifo
 	******************\\\**************************************************/
 	memset(raw,0,MAX_FIFO_BUFFER);
-	// read it in!
-	ret = rc_i2c_read_bytes(config.i2c_bus, FIFO_R_W, fifo_count, &raw[0]);
-	if(ret<0){
-		// if i2c_read returned -1 there was an error, try again
-		ret = rc_i2c_read_bytes(config.i2c_bus, FIFO_R_W, fifo_count, &raw[0]);
+	// with the i2c master sampling the magnetometer ST1 through ST2 sit in
+	// EXT_SENS_DATA_00-07, read them in the same transaction as the FIFO
+	if(read_mag && mpu->mag_i2c_master_en){
+		reads[0].devAddr = mpu->config.i2c_addr;
+		reads[0].regAddr = FIFO_R_W;
+		reads[0].count = fifo_count;
+		reads[0].data = &raw[0];
+		reads[1].devAddr = mpu->config.i2c_addr;
+		reads[1].regAddr = EXT_SENS_DATA_00;
+		reads[1].count = 8;
+		reads[1].data = &mag_raw[0];
+		ret = rc_i2c_read_multi(mpu->config.i2c_bus, reads, 2);
+		// try again on error like below
+		if(ret) ret = rc_i2c_read_multi(mpu->config.i2c_bus, reads, 2);
+		ret = ret ? -1 : fifo_count;
+		if(ret==fifo_count) __mag_parse_raw(mpu, mag_raw[0], &mag_raw[1], data);
+	}
+	else{
+		// read it in!
+		ret = rc_i2c_read_bytes(mpu->config.i2c_bus, FIFO_R_W, fifo_count, &raw[0]);
+		if(ret<0){
+			// if i2c_read returned -1 there was an error, try again
+			ret = rc_i2c_read_bytes(mpu->config.i2c_bus, FIFO_R_W, fifo_count, &raw[0]);
+		}
 	}
 	if(ret!=fifo_count){
-		if(config.show_warnings){
+		if(mpu->config.show_warnings){
 			fprintf(stderr,"ERROR: failed to read fifo buffer register\n");
-			printf("read %d bytes, expected %d\n", ret, packet_len);
+			printf("read %d bytes, expected %d\n", ret, mpu->packet_len);
 		}
 		return -1;
 	}
@@ -2046,10 +3066,10 @@ int __read_dmp_fifo(rc_mpu_data_t* data)
 	quat_mag_sq = quat_q14[0] * quat_q14[0] + quat_q14[1] * quat_q14[1] + \
 		quat_q14[2] * quat_q14[2] + quat_q14[3] * quat_q14[3];
 	if ((quat_mag_sq < QUAT_MAG_SQ_MIN)||(quat_mag_sq > QUAT_MAG_SQ_MAX)){
-		if(config.show_warnings){
+		if(mpu->config.show_warnings){
 			printf("warning: Quaternion out of bounds, fifo_count: %d\n", fifo_count);
 		}
-		__mpu_reset_fifo();
+		__mpu_reset_fifo(mpu);
 		return -1;
 	}
 
@@ -2064,11 +3084,11 @@ int __read_dmp_fifo(rc_mpu_data_t* data)
 	for(j=0;j<4;j++) data->dmp_quat[j]=(double)q_tmp[j];
 
 	// fill in tait-bryan angles to the data struct
-	rc_quaternion_to_tb_array(data->dmp_quat, data->dmp_TaitBryan);
+	__quat_to_tb(mpu, data->dmp_quat, data->dmp_TaitBryan);
 	is_new_dmp_data=1;
 
 
-	if(packet_len==FIFO_LEN_QUAT_ACCEL_GYRO_TAP){
+	if(mpu->packet_len==FIFO_LEN_QUAT_ACCEL_GYRO_TAP){
 		// Read Accel values and load into imu_data struct
 		// Turn the MSB and LSB into a signed 16-bit value
 		data->raw_accel[0] = (int16_t)(((uint16_t)raw[i+0]<<8)|raw[i+1]);
@@ -2076,9 +3096,9 @@ int __read_dmp_fifo(rc_mpu_data_t* data)
 		data->raw_accel[2] = (int16_t)(((uint16_t)raw[i+4]<<8)|raw[i+5]);
 		i+=6;
 		// Fill in real unit values
-		data->accel[0] = data->raw_accel[0] * data->accel_to_ms2 / accel_lengths[0];
-		data->accel[1] = data->raw_accel[1] * data->accel_to_ms2 / accel_lengths[1];
-		data->accel[2] = data->raw_accel[2] * data->accel_to_ms2 / accel_lengths[2];
+		data->accel[0] = data->raw_accel[0] * data->accel_to_ms2 / mpu->accel_lengths[0];
+		data->accel[1] = data->raw_accel[1] * data->accel_to_ms2 / mpu->accel_lengths[1];
+		data->accel[2] = data->raw_accel[2] * data->accel_to_ms2 / mpu->accel_lengths[2];
 
 		// Read gyro values and load into imu_data struct
 		// Turn the MSB and LSB into a signed 16-bit value
@@ -2102,22 +3122,22 @@ int __read_dmp_fifo(rc_mpu_data_t* data)
 		unsigned char direction, count;
 		direction = tap >> 3;
 		count = (tap % 8) + 1;
-		data_ptr->last_tap_direction = direction;
-		data_ptr->last_tap_count = count;
-		data_ptr->tap_detected=1;
+		mpu->data_ptr->last_tap_direction = direction;
+		mpu->data_ptr->last_tap_count = count;
+		mpu->data_ptr->tap_detected=1;
 	}
-	else data_ptr->tap_detected=0;
+	else mpu->data_ptr->tap_detected=0;
 
 	// run data_fusion to filter yaw with compass
-	if(is_new_dmp_data && config.enable_magnetometer){
+	if(is_new_dmp_data && mpu->config.enable_magnetometer){
 		#ifdef DEBUG
 		printf("running data_fusion\n");
 		#endif
-		__data_fusion(data);
+		__data_fusion(mpu, data);
 	}
 
 	// if we finally got dmp data, turn off the first run flag
-	if(is_new_dmp_data) first_run=0;
+	if(is_new_dmp_data) mpu->fifo_first_run=0;
 
 	// finally, our return value is based on the presence of DMP data only
 	// even if new magnetometer data was read, the expected timing must come
@@ -2126,6 +3146,100 @@ int __read_dmp_fifo(rc_mpu_data_t* data)
 	else return -1;
 }
 
+/**
+ * Reads one raw sample in AHRS mode and marches the software orientation
+ * filters. ACCEL_XOUT_H through GYRO_ZOUT_L are contiguous so accel, temp,
+ * and gyro come in a single 14 byte burst which also clears the latched data
+ * ready interrupt.
+ *
+ * @param      data      The data pointer
+ * @param[in]  read_mag  set to 1 to also read the magnetometer this sample
+ *
+ * @return     0 on success, -1 on failure
+ */
+int __read_ahrs_sample(rc_mpu_t* mpu, rc_mpu_data_t* data, int read_mag)
+{
+	uint8_t raw[22], mag_raw[8];
+	int i, n_reads;
+	int16_t temp_adc;
+	double accel_vec[3], gyro_vec[3], mag_vec[3], tilt_tb[3], tilt_q[4];
+	float a[3], g[3], m[3];
+	rc_i2c_read_t reads[2];
+	// exact since the rate is checked to divide the 1khz internal rate
+	const float dt = 1.0f/(float)mpu->config.ahrs_sample_rate;
+
+	// in bypass mode the magnetometer ST1 through ST2 registers are read in
+	// the same transaction as the accel/temp/gyro block. With the i2c master
+	// they are copied into EXT_SENS_DATA_00-07 which directly follow
+	// GYRO_ZOUT_L, so the accel/temp/gyro burst just runs 8 bytes longer.
+	reads[0].devAddr = mpu->config.i2c_addr;
+	reads[0].regAddr = ACCEL_XOUT_H;
+	reads[0].count = (read_mag && mpu->mag_i2c_master_en) ? 22 : 14;
+	reads[0].data = &raw[0];
+	reads[1].devAddr = AK8963_ADDR;
+	reads[1].regAddr = AK8963_ST1;
+	reads[1].count = 8;
+	reads[1].data = &mag_raw[0];
+	n_reads = (read_mag && !mpu->mag_i2c_master_en) ? 2 : 1;
+	if(unlikely(rc_i2c_read_multi(mpu->config.i2c_bus, reads, n_reads))){
+		if(mpu->config.show_warnings){
+			fprintf(stderr,"WARNING: failed to read raw IMU data in AHRS mode\n");
+		}
+		return -1;
+	}
+	for(i=0;i<3;i++){
+		data->raw_accel[i] = (int16_t)(((uint16_t)raw[2*i]<<8)|raw[2*i+1]);
+		data->raw_gyro[i] = (int16_t)(((uint16_t)raw[8+2*i]<<8)|raw[9+2*i]);
+		data->accel[i] = data->raw_accel[i] * data->accel_to_ms2 / mpu->accel_lengths[i];
+		data->gyro[i] = data->raw_gyro[i] * data->gyro_to_degs;
+	}
+	temp_adc = (int16_t)(((uint16_t)raw[6]<<8)|raw[7]);
+	data->temp = 21.0 + temp_adc/TEMP_SENSITIVITY;
+
+	// grab new magnetometer data if it's time
+	if(read_mag){
+		if(n_reads==2) __mag_parse_raw(mpu, mag_raw[0], &mag_raw[1], data);
+		else __mag_parse_raw(mpu, raw[14], &raw[15], data);
+	}
+
+	// rotate everything into the configured orientation and march the 6 axis
+	// filter which stands in for the DMP quaternion
+	if(__correct_orientation(mpu, data->accel, accel_vec)) return -1;
+	if(__correct_orientation(mpu, data->gyro, gyro_vec)) return -1;
+	for(i=0;i<3;i++){
+		a[i] = (float)accel_vec[i];
+		g[i] = (float)(gyro_vec[i]*DEG_TO_RAD);
+	}
+	rc_ahrs_update(&mpu->ahrs_imu, g, a, NULL, dt);
+	rc_ahrs_get_quaternion(&mpu->ahrs_imu, data->dmp_quat);
+	__quat_to_tb(mpu, data->dmp_quat, data->dmp_TaitBryan);
+	if(!mpu->config.enable_magnetometer) return 0;
+
+	// 9 axis filter for the fused orientation, the latest magnetometer
+	// reading is reused between magnetometer samples
+	if(__correct_orientation(mpu, data->mag, mag_vec)) return -1;
+	// hold off until the first magnetometer sample arrives so the initial
+	// alignment includes a heading
+	if(mpu->ahrs_marg.step==0 && (mag_vec[0]*mag_vec[0] + mag_vec[1]*mag_vec[1] + mag_vec[2]*mag_vec[2]) <= 0.0) return 0;
+	for(i=0;i<3;i++) m[i] = (float)mag_vec[i];
+	rc_ahrs_update(&mpu->ahrs_marg, g, a, m, dt);
+	rc_ahrs_get_quaternion(&mpu->ahrs_marg, data->fused_quat);
+	__quat_to_tb(mpu, data->fused_quat, data->fused_TaitBryan);
+	data->compass_heading = data->fused_TaitBryan[TB_YAW_Z];
+
+	// unfiltered heading from the tilt compensated magnetometer
+	if(read_mag){
+		tilt_tb[0] = data->fused_TaitBryan[TB_PITCH_X];
+		tilt_tb[1] = data->fused_TaitBryan[TB_ROLL_Y];
+		tilt_tb[2] = 0.0;
+		__tb_to_quat(mpu, tilt_tb, tilt_q);
+		rc_quaternion_rotate_vector_array(mag_vec, tilt_q);
+		if(mpu->config.fast_trig) data->compass_heading_raw = -rc_fast_atan2(mag_vec[1], mag_vec[0]);
+		else data->compass_heading_raw = -atan2(mag_vec[1], mag_vec[0]);
+	}
+	return 0;
+}
+
 /**
  * This fuses the magnetometer data with the quaternion straight from the DMP to
  * correct the yaw heading to a compass heading. Much thanks to Pansenti for
@@ -2139,15 +3253,10 @@ int __read_dmp_fifo(rc_mpu_data_t* data)
  *
  * @return     0 on success, -1 on failure
  */
-int __data_fusion(rc_mpu_data_t* data)
+int __data_fusion(rc_mpu_t* mpu, rc_mpu_data_t* data)
 {
 	double tilt_tb[3], tilt_q[4], mag_vec[3];
-	static double newMagYaw = 0;
-	static double newDMPYaw = 0;
 	double lastDMPYaw, lastMagYaw, newYaw;
-	static int dmp_spin_counter = 0;
-	static int mag_spin_counter = 0;
-	static int first_run = 1; // set to 0 after first call to this function
 
 
 	// start by filling in the roll/pitch components of the fused euler
@@ -2158,64 +3267,68 @@ int __data_fusion(rc_mpu_data_t* data)
 	tilt_tb[2] = 0.0;
 
 	// generate a quaternion rotation of just roll/pitch
-	rc_quaternion_from_tb_array(tilt_tb,tilt_q);
+	__tb_to_quat(mpu, tilt_tb, tilt_q);
 
 	// correct for orientation and put data into
-	if(__mag_correct_orientation(mag_vec)) return -1;
+	if(__correct_orientation(mpu, mpu->data_ptr->mag, mag_vec)) return -1;
 
 	// tilt that vector by the roll/pitch of the IMU to align magnetic field
 	// vector such that Z points vertically
 	rc_quaternion_rotate_vector_array(mag_vec,tilt_q);
 	// from the aligned magnetic field vector, find a yaw heading
 	// check for validity and make sure the heading is positive
-	lastMagYaw = newMagYaw; // save from last loop
-	newMagYaw = -atan2(mag_vec[1], mag_vec[0]);
+	lastMagYaw = mpu->newMagYaw; // save from last loop
+	if(mpu->config.fast_trig) mpu->newMagYaw = -rc_fast_atan2(mag_vec[1], mag_vec[0]);
+	else mpu->newMagYaw = -atan2(mag_vec[1], mag_vec[0]);
 
-	if (isnan(newMagYaw)) {
+	if (isnan(mpu->newMagYaw)) {
 		#ifdef WARNINGS
-		printf("newMagYaw NAN\n");
+		printf("mpu->newMagYaw NAN\n");
 		#endif
 		return -1;
 	}
-	data->compass_heading_raw = newMagYaw;
-	// save DMP last from time and record newDMPYaw for this time
-	lastDMPYaw = newDMPYaw;
-	newDMPYaw = data->dmp_TaitBryan[TB_YAW_Z];
+	data->compass_heading_raw = mpu->newMagYaw;
+	// save DMP last from time and record mpu->newDMPYaw for this time
+	lastDMPYaw = mpu->newDMPYaw;
+	mpu->newDMPYaw = data->dmp_TaitBryan[TB_YAW_Z];
 
 	// the outputs from atan2 and dmp are between -PI and PI.
 	// for our filters to run smoothly, we can't have them jump between -PI
 	// to PI when doing a complete spin. Therefore we check for a skip and
 	// increment or decrement the spin counter
-	if(newMagYaw-lastMagYaw < -PI) mag_spin_counter++;
-	else if (newMagYaw-lastMagYaw > PI) mag_spin_counter--;
-	if(newDMPYaw-lastDMPYaw < -PI) dmp_spin_counter++;
-	else if (newDMPYaw-lastDMPYaw > PI) dmp_spin_counter--;
+	if(mpu->newMagYaw-lastMagYaw < -PI) mpu->mag_spin_counter++;
+	else if (mpu->newMagYaw-lastMagYaw > PI) mpu->mag_spin_counter--;
+	if(mpu->newDMPYaw-lastDMPYaw < -PI) mpu->dmp_spin_counter++;
+	else if (mpu->newDMPYaw-lastDMPYaw > PI) mpu->dmp_spin_counter--;
 
 	// if this is the first run, set up filters
-	if(first_run){
-		lastMagYaw = newMagYaw;
-		lastDMPYaw = newDMPYaw;
-		mag_spin_counter = 0;
-		dmp_spin_counter = 0;
+	if(mpu->fusion_first_run){
+		lastMagYaw = mpu->newMagYaw;
+		lastDMPYaw = mpu->newDMPYaw;
+		mpu->mag_spin_counter = 0;
+		mpu->dmp_spin_counter = 0;
 		// generate complementary filters
-		double dt = 1.0/config.dmp_sample_rate;
-		rc_filter_first_order_lowpass(&low_pass,dt,config.compass_time_constant);
-		rc_filter_first_order_highpass(&high_pass,dt,config.compass_time_constant);
-		rc_filter_prefill_inputs(&low_pass,startMagYaw);
-		rc_filter_prefill_outputs(&low_pass,startMagYaw);
-		rc_filter_prefill_inputs(&high_pass,newDMPYaw);
-		rc_filter_prefill_outputs(&high_pass,0);
-		first_run = 0;
+		double dt = 1.0/mpu->config.dmp_sample_rate;
+		rc_filter_first_order_lowpass(&mpu->low_pass,dt,mpu->config.compass_time_constant);
+		rc_filter_first_order_highpass(&mpu->high_pass,dt,mpu->config.compass_time_constant);
+		rc_filter_prefill_inputs(&mpu->low_pass,mpu->startMagYaw);
+		rc_filter_prefill_outputs(&mpu->low_pass,mpu->startMagYaw);
+		rc_filter_prefill_inputs(&mpu->high_pass,mpu->newDMPYaw);
+		rc_filter_prefill_outputs(&mpu->high_pass,0);
+		mpu->fusion_first_run = 0;
 	}
 
 	// new Yaw is the sum of low and high pass complementary filters.
-	double lp = rc_filter_march(&low_pass,newMagYaw+(TWO_PI*mag_spin_counter));
-	double hp = rc_filter_march(&high_pass,newDMPYaw+(TWO_PI*dmp_spin_counter));
+	double lp = rc_filter_march(&mpu->low_pass,mpu->newMagYaw+(TWO_PI*mpu->mag_spin_counter));
+	double hp = rc_filter_march(&mpu->high_pass,mpu->newDMPYaw+(TWO_PI*mpu->dmp_spin_counter));
 	newYaw =  lp+hp;
 
-	newYaw = fmod(newYaw,TWO_PI); // remove the effect of the spins
-	if (newYaw > PI) newYaw -= TWO_PI; // bound between +- PI
-	else if (newYaw < -PI) newYaw += TWO_PI; // bound between +- PI
+	if(mpu->config.fast_trig) newYaw = rc_fast_wrap_pi(newYaw);
+	else{
+		newYaw = fmod(newYaw,TWO_PI); // remove the effect of the spins
+		if (newYaw > PI) newYaw -= TWO_PI; // bound between +- PI
+		else if (newYaw < -PI) newYaw += TWO_PI; // bound between +- PI
+	}
 
 	// TB angles expect a yaw between -pi to pi so slide it again and
 	// store in the user-accessible fused tb angle
@@ -2225,25 +3338,51 @@ int __data_fusion(rc_mpu_data_t* data)
 	data->fused_TaitBryan[1] = data->dmp_TaitBryan[1];
 
 	// Also generate a new quaternion from the filtered tb angles
-	rc_quaternion_from_tb_array(data->fused_TaitBryan, data->fused_quat);
+	__tb_to_quat(mpu, data->fused_TaitBryan, data->fused_quat);
 	return 0;
 }
 
 
 
+/**
+ * Fills in the calibration file paths for an instance. The MPU on the default
+ * bus and address keeps the original file names so existing calibrations
+ * still apply, any other MPU gets its own files tagged with bus and address
+ * such as gyro_1_69.cal so two IMUs never share calibration data.
+ *
+ * @param      mpu   instance whose config.i2c_bus and config.i2c_addr are set
+ */
+static void __set_cal_file_paths(rc_mpu_t* mpu)
+{
+	if(mpu->config.i2c_bus==RC_IMU_BUS && mpu->config.i2c_addr==RC_MPU_DEFAULT_I2C_ADDR){
+		snprintf(mpu->gyro_cal_file, sizeof(mpu->gyro_cal_file), CALIBRATION_DIR GYRO_CAL_FILE);
+		snprintf(mpu->accel_cal_file, sizeof(mpu->accel_cal_file), CALIBRATION_DIR ACCEL_CAL_FILE);
+		snprintf(mpu->mag_cal_file, sizeof(mpu->mag_cal_file), CALIBRATION_DIR MAG_CAL_FILE);
+		return;
+	}
+	snprintf(mpu->gyro_cal_file, sizeof(mpu->gyro_cal_file), CALIBRATION_DIR "gyro_%d_%02x.cal",
+					mpu->config.i2c_bus, mpu->config.i2c_addr);
+	snprintf(mpu->accel_cal_file, sizeof(mpu->accel_cal_file), CALIBRATION_DIR "accel_%d_%02x.cal",
+					mpu->config.i2c_bus, mpu->config.i2c_addr);
+	snprintf(mpu->mag_cal_file, sizeof(mpu->mag_cal_file), CALIBRATION_DIR "mag_%d_%02x.cal",
+					mpu->config.i2c_bus, mpu->config.i2c_addr);
+	return;
+}
+
+
 /**
  * Loads steady state gyro offsets from the disk and puts them in the IMU's gyro
  * offset register. If no calibration file exists then make a new one.
  *
  * @return     0 on success, -1 on failure
  */
-int __load_gyro_calibration(void)
+int __load_gyro_calibration(rc_mpu_t* mpu)
 {
 	FILE* fd;
 	uint8_t data[6];
 	int x,y,z;
 
-	fd = fopen(CALIBRATION_DIR GYRO_CAL_FILE, "r");
+	fd = fopen(mpu->gyro_cal_file, "r");
 
 	if(fd==NULL){
 		// calibration file doesn't exist yet
@@ -2283,7 +3422,7 @@ int __load_gyro_calibration(void)
 	data[5] = (-z/4)       & 0xFF;
 
 	// Push gyro biases to hardware registers
-	if(rc_i2c_write_bytes(config.i2c_bus, XG_OFFSET_H, 6, &data[0])){
+	if(rc_i2c_write_bytes(mpu->config.i2c_bus, XG_OFFSET_H, 6, &data[0])){
 		fprintf(stderr,"ERROR: failed to load gyro offsets into IMU register\n");
 		return -1;
 	}
@@ -2296,12 +3435,12 @@ int __load_gyro_calibration(void)
  *
  * @return     0 on success, -1 on failure
  */
-int __load_mag_calibration(void)
+int __load_mag_calibration(rc_mpu_t* mpu)
 {
 	FILE *fd;
 	double x,y,z,sx,sy,sz;
 
-	fd = fopen(CALIBRATION_DIR MAG_CAL_FILE, "r");
+	fd = fopen(mpu->mag_cal_file, "r");
 	if(fd==NULL){
 		// calibration file doesn't exist yet
 		fprintf(stderr,"WARNING: no magnetometer calibration data found\n");
@@ -2333,12 +3472,12 @@ int __load_mag_calibration(void)
 	#endif
 
 	// write to global variables for use by rc_mpu_read_mag
-	mag_offsets[0]=x;
-	mag_offsets[1]=y;
-	mag_offsets[2]=z;
-	mag_scales[0]=sx;
-	mag_scales[1]=sy;
-	mag_scales[2]=sz;
+	mpu->mag_offsets[0]=x;
+	mpu->mag_offsets[1]=y;
+	mpu->mag_offsets[2]=z;
+	mpu->mag_scales[0]=sx;
+	mpu->mag_scales[1]=sy;
+	mpu->mag_scales[2]=sz;
 
 	return 0;
 }
@@ -2349,23 +3488,26 @@ int __load_mag_calibration(void)
  *
  * @return     0 on success, -1 on failure
  */
-int __load_accel_calibration(void)
+int __load_accel_calibration(rc_mpu_t* mpu)
 {
 	FILE* fd;
 	uint8_t raw[6] = {0,0,0,0,0,0};
 	double x,y,z,sx,sy,sz; // offsets and scales in xyz
 	int16_t bias[3], factory[3];
 
-	fd = fopen(CALIBRATION_DIR ACCEL_CAL_FILE, "r");
+	fd = fopen(mpu->accel_cal_file, "r");
 
 	if(fd==NULL){
 		// calibration file doesn't exist yet
 		fprintf(stderr,"WARNING: no accelerometer calibration data found\n");
 		fprintf(stderr,"Please run rc_calibrate_accel\n\n");
 		// use zero offsets
-		accel_lengths[0]=1.0;
-		accel_lengths[1]=1.0;
-		accel_lengths[2]=1.0;
+		mpu->accel_lengths[0]=1.0;
+		mpu->accel_lengths[1]=1.0;
+		mpu->accel_lengths[2]=1.0;
+		mpu->accel_center[0]=0.0;
+		mpu->accel_center[1]=0.0;
+		mpu->accel_center[2]=0.0;
 		return 0;
 	}
 	// read in data
@@ -2374,9 +3516,12 @@ int __load_accel_calibration(void)
 		fprintf(stderr,"please run rc_calibrate_accel to make a new calibration file\n");
 		fprintf(stderr,"using default offsets for now\n");
 		// use zero offsets
-		accel_lengths[0]=1.0;
-		accel_lengths[1]=1.0;
-		accel_lengths[2]=1.0;
+		mpu->accel_lengths[0]=1.0;
+		mpu->accel_lengths[1]=1.0;
+		mpu->accel_lengths[2]=1.0;
+		mpu->accel_center[0]=0.0;
+		mpu->accel_center[1]=0.0;
+		mpu->accel_center[2]=0.0;
 		return 0;
 	}
 	fclose(fd);
@@ -2388,18 +3533,21 @@ int __load_accel_calibration(void)
 	#endif
 
 	// save scales globally
-	accel_lengths[0]=sx;
-	accel_lengths[1]=sy;
-	accel_lengths[2]=sz;
+	mpu->accel_lengths[0]=sx;
+	mpu->accel_lengths[1]=sy;
+	mpu->accel_lengths[2]=sz;
+	mpu->accel_center[0]=x;
+	mpu->accel_center[1]=y;
+	mpu->accel_center[2]=z;
 
 	// read factory bias
-	if(rc_i2c_read_bytes(config.i2c_bus, XA_OFFSET_H, 2, &raw[0])<0){
+	if(rc_i2c_read_bytes(mpu->config.i2c_bus, XA_OFFSET_H, 2, &raw[0])<0){
 		return -1;
 	}
-	if(rc_i2c_read_bytes(config.i2c_bus, YA_OFFSET_H, 2, &raw[2])<0){
+	if(rc_i2c_read_bytes(mpu->config.i2c_bus, YA_OFFSET_H, 2, &raw[2])<0){
 		return -1;
 	}
-	if(rc_i2c_read_bytes(config.i2c_bus, ZA_OFFSET_H, 2, &raw[4])<0){
+	if(rc_i2c_read_bytes(mpu->config.i2c_bus, ZA_OFFSET_H, 2, &raw[4])<0){
 		return -1;
 	}
 	// Turn the MSB and LSB into a signed 16-bit value
@@ -2421,15 +3569,15 @@ int __load_accel_calibration(void)
 	raw[5] = (bias[2] << 1) & 0xFF;
 
 	// Push accel biases to hardware registers
-	if(rc_i2c_write_bytes(config.i2c_bus, XA_OFFSET_H, 2, &raw[0])<0){
+	if(rc_i2c_write_bytes(mpu->config.i2c_bus, XA_OFFSET_H, 2, &raw[0])<0){
 		fprintf(stderr,"ERROR: failed to write X accel offsets into IMU register\n");
 		return -1;
 	}
-	if(rc_i2c_write_bytes(config.i2c_bus, YA_OFFSET_H, 2, &raw[2])<0){
+	if(rc_i2c_write_bytes(mpu->config.i2c_bus, YA_OFFSET_H, 2, &raw[2])<0){
 		fprintf(stderr,"ERROR: failed to write Y accel offsets into IMU register\n");
 		return -1;
 	}
-	if(rc_i2c_write_bytes(config.i2c_bus, ZA_OFFSET_H, 2, &raw[4])<0){
+	if(rc_i2c_write_bytes(mpu->config.i2c_bus, ZA_OFFSET_H, 2, &raw[4])<0){
 		fprintf(stderr,"ERROR: failed to write Z accel offsets into IMU register\n");
 		return -1;
 	}
@@ -2446,7 +3594,7 @@ int __load_accel_calibration(void)
  *
  * @return     0 on success, -1 on failure
  */
-int __write_gyro_cal_to_disk(int16_t offsets[3])
+int __write_gyro_cal_to_disk(rc_mpu_t* mpu, int16_t offsets[3])
 {
 	FILE* fd;
 	int ret;
@@ -2460,9 +3608,9 @@ int __write_gyro_cal_to_disk(int16_t offsets[3])
 	}
 
 	// remove old file
-	remove(CALIBRATION_DIR GYRO_CAL_FILE);
+	remove(mpu->gyro_cal_file);
 
-	fd = fopen(CALIBRATION_DIR GYRO_CAL_FILE, "w");
+	fd = fopen(mpu->gyro_cal_file, "w");
 	if(fd==NULL){
 		perror("ERROR in rc_calibrate_gyro_routine opening calibration file for writing");
 		fprintf(stderr, "most likely you ran this as root in the past and are now\n");
@@ -2483,7 +3631,7 @@ int __write_gyro_cal_to_disk(int16_t offsets[3])
 	fclose(fd);
 
 	// now give proper permissions
-	if(chmod(CALIBRATION_DIR GYRO_CAL_FILE, S_IRWXU | S_IRWXG | S_IRWXO)==-1){
+	if(chmod(mpu->gyro_cal_file, S_IRWXU | S_IRWXG | S_IRWXO)==-1){
 		perror("ERROR in rc_calibrate_gyro_routine setting correct permissions for file\n");
 		fprintf(stderr, "writing file anyway, will probably still work\n");
 		fprintf(stderr, "most likely you ran this as root in the past and are now\n");
@@ -2502,7 +3650,7 @@ int __write_gyro_cal_to_disk(int16_t offsets[3])
  *
  * @return     0 on success, -1 on failure
  */
-int __write_mag_cal_to_disk(double offsets[3], double scale[3])
+int __write_mag_cal_to_disk(rc_mpu_t* mpu, double offsets[3], double scale[3])
 {
 	FILE* fd;
 	int ret;
@@ -2515,9 +3663,9 @@ int __write_mag_cal_to_disk(double offsets[3], double scale[3])
 		return -1;
 	}
 	// remove old file
-	remove(CALIBRATION_DIR MAG_CAL_FILE);
+	remove(mpu->mag_cal_file);
 
-	fd = fopen(CALIBRATION_DIR MAG_CAL_FILE, "w");
+	fd = fopen(mpu->mag_cal_file, "w");
 	if(fd==NULL){
 		perror("ERROR in rc_calibrate_mag_routine opening calibration file for writing");
 		fprintf(stderr, "most likely you ran this as root in the past and are now\n");
@@ -2542,7 +3690,7 @@ int __write_mag_cal_to_disk(double offsets[3], double scale[3])
 	fclose(fd);
 
 	// now give proper permissions
-	if(chmod(CALIBRATION_DIR MAG_CAL_FILE, S_IRWXU | S_IRWXG | S_IRWXO)==-1){
+	if(chmod(mpu->mag_cal_file, S_IRWXU | S_IRWXG | S_IRWXO)==-1){
 		perror("ERROR in rc_calibrate_mag_routine setting correct permissions for file\n");
 		fprintf(stderr, "writing file anyway, will probably still work\n");
 		fprintf(stderr, "most likely you ran this as root in the past and are now\n");
@@ -2562,7 +3710,7 @@ int __write_mag_cal_to_disk(double offsets[3], double scale[3])
  *
  * @return     0 on success, -1 on failure
  */
-int __write_accel_cal_to_disk(double* center, double* lengths)
+int __write_accel_cal_to_disk(rc_mpu_t* mpu, double* center, double* lengths)
 {
 	FILE* fd;
 	int ret;
@@ -2575,9 +3723,9 @@ int __write_accel_cal_to_disk(double* center, double* lengths)
 		return -1;
 	}
 	// remove old file
-	remove(CALIBRATION_DIR ACCEL_CAL_FILE);
+	remove(mpu->accel_cal_file);
 
-	fd = fopen(CALIBRATION_DIR ACCEL_CAL_FILE, "w");
+	fd = fopen(mpu->accel_cal_file, "w");
 	if(fd==NULL){
 		perror("ERROR in rc_mpu_calibrate_accel_routine opening calibration file for writing");
 		fprintf(stderr, "most likely you ran this as root in the past and are now\n");
@@ -2602,7 +3750,7 @@ int __write_accel_cal_to_disk(double* center, double* lengths)
 	fclose(fd);
 
 	// now give proper permissions
-	if(chmod(CALIBRATION_DIR ACCEL_CAL_FILE, S_IRWXU | S_IRWXG | S_IRWXO)==-1){
+	if(chmod(mpu->accel_cal_file, S_IRWXU | S_IRWXG | S_IRWXO)==-1){
 		perror("WARNING in rc_calibrate_accel_routine setting correct permissions for file\n");
 		fprintf(stderr, "writing file anyway, will probably still work\n");
 		fprintf(stderr, "most likely you ran this as root in the past and are now\n");
@@ -2616,38 +3764,33 @@ int __write_accel_cal_to_disk(double* center, double* lengths)
 
 int rc_mpu_calibrate_gyro_routine(rc_mpu_config_t conf)
 {
+	rc_mpu_t cal_mpu = RC_MPU_INSTANCE_INITIALIZER;
+	rc_mpu_t* mpu = &cal_mpu;
 	uint8_t c, data[6];
 	int32_t gyro_sum[3] = {0, 0, 0};
 	int16_t offsets[3];
-	was_last_steady = 1;
+	mpu->was_last_steady = 1;
 
-	// save bus and address globally for other functions to use
-	config.i2c_bus = conf.i2c_bus;
-	config.i2c_addr = conf.i2c_addr;
+	// calibration runs on its own instance with the user's bus and address
+	mpu->config = rc_mpu_default_config();
+	mpu->config.i2c_bus = conf.i2c_bus;
+	mpu->config.i2c_addr = conf.i2c_addr;
+	__set_cal_file_paths(mpu);
 
-	// make sure the bus is not currently in use by another thread
-	// do not proceed to prevent interfering with that process
-	if(rc_i2c_get_lock(conf.i2c_bus)){
-		fprintf(stderr,"i2c bus claimed by another process\n");
-		fprintf(stderr,"aborting gyro calibration()\n");
-		return -1;
-	}
-
-	// if it is not claimed, start the i2c bus
+	// start the i2c bus
 	if(rc_i2c_init(conf.i2c_bus, conf.i2c_addr)==-1){
 		fprintf(stderr,"ERROR in rc_mpu_calibrate_gyro_routine, failed to init i2c bus\n");
 		return -1;
 	}
 
-	// claiming the bus does no guarantee other code will not interfere
-	// with this process, but best to claim it so other code can check
-	// like we did above
+	// claim the bus, this waits for other threads and processes to finish
+	// with it
 	rc_i2c_lock_bus(conf.i2c_bus);
 
 	// reset device, reset all registers
-	if(__reset_mpu()==-1){
+	if(__reset_mpu(mpu)==-1){
 		fprintf(stderr,"ERROR in rc_mpu_calibrate_gyro_routine, failed to reset MPU9250\n");
-		return -1;
+		goto unlock_fail;
 	}
 
 	// set up the IMU specifically for calibration.
@@ -2716,7 +3859,10 @@ COLLECT_DATA:
 		// read data for averaging
 		if(rc_i2c_read_bytes(conf.i2c_bus, FIFO_R_W, 6, data)<0){
 			fprintf(stderr,"ERROR: failed to read FIFO\n");
-			return -1;
+			rc_vector_free(&vx);
+			rc_vector_free(&vy);
+			rc_vector_free(&vz);
+			goto unlock_fail;
 		}
 		x = (int16_t)(((int16_t)data[0] << 8) | data[1]) ;
 		y = (int16_t)(((int16_t)data[2] << 8) | data[3]) ;
@@ -2744,13 +3890,13 @@ COLLECT_DATA:
 	if(dev_x>GYRO_CAL_THRESH||dev_y>GYRO_CAL_THRESH||dev_z>GYRO_CAL_THRESH){
 		printf("Gyro data too noisy, put me down on a solid surface!\n");
 		printf("trying again\n");
-		was_last_steady = 0;
+		mpu->was_last_steady = 0;
 		goto COLLECT_DATA;
 	}
 	// this skips the first steady reading after a noisy reading
 	// to make sure IMU has settled after being picked up.
-	if(was_last_steady == 0){
-		was_last_steady = 1;
+	if(mpu->was_last_steady == 0){
+		mpu->was_last_steady = 1;
 		goto COLLECT_DATA;
 	}
 	// average out the samples
@@ -2771,15 +3917,21 @@ COLLECT_DATA:
 	printf("offsets: %d %d %d\n", offsets[0], offsets[1], offsets[2]);
 	#endif
 	// write to disk
-	if(__write_gyro_cal_to_disk(offsets)<0){
+	if(__write_gyro_cal_to_disk(mpu, offsets)<0){
 		fprintf(stderr,"ERROR in rc_calibrate_gyro_routine, failed to write to disk\n");
 		return -1;
 	}
 	return 0;
+
+unlock_fail:
+	rc_i2c_unlock_bus(conf.i2c_bus);
+	return -1;
 }
 
 int rc_mpu_calibrate_mag_routine(rc_mpu_config_t conf)
 {
+	rc_mpu_t cal_mpu = RC_MPU_INSTANCE_INITIALIZER;
+	rc_mpu_t* mpu = &cal_mpu;
 	int i;
 	double new_scale[3];
 	const int samples = 200;
@@ -2792,63 +3944,53 @@ int rc_mpu_calibrate_mag_routine(rc_mpu_config_t conf)
 	rc_vector_t lengths = rc_vector_empty();
 	rc_mpu_data_t imu_data; // to collect magnetometer data
 	// wipe it with defaults to avoid problems
-	config = rc_mpu_default_config();
+	mpu->config = rc_mpu_default_config();
 	// configure with user's i2c bus info
-	config.enable_magnetometer = 1;
-	config.i2c_bus = conf.i2c_bus;
-	config.i2c_addr = conf.i2c_addr;
+	mpu->config.enable_magnetometer = 1;
+	mpu->config.i2c_bus = conf.i2c_bus;
+	mpu->config.i2c_addr = conf.i2c_addr;
+	__set_cal_file_paths(mpu);
 
-	// make sure the bus is not currently in use by another thread
-	// do not proceed to prevent interfering with that process
-	if(rc_i2c_get_lock(config.i2c_bus)){
-		fprintf(stderr,"i2c bus claimed by another process\n");
-		fprintf(stderr,"aborting magnetometer calibration()\n");
-		return -1;
-	}
-
-	// if it is not claimed, start the i2c bus
-	if(rc_i2c_init(config.i2c_bus, config.i2c_addr)){
+	// start the i2c bus
+	if(rc_i2c_init(mpu->config.i2c_bus, mpu->config.i2c_addr)){
 		fprintf(stderr,"ERROR rc_calibrate_mag_routine failed at rc_i2c_init\n");
 		return -1;
 	}
 
-	// claiming the bus does no guarantee other code will not interfere
-	// with this process, but best to claim it so other code can check
-	// like we did above
-	rc_i2c_lock_bus(config.i2c_bus);
+	// claim the bus, this waits for other threads and processes to finish
+	// with it
+	rc_i2c_lock_bus(mpu->config.i2c_bus);
 
 	// reset device, reset all registers
-	if(__reset_mpu()<0){
+	if(__reset_mpu(mpu)<0){
 		fprintf(stderr,"ERROR: failed to reset MPU9250\n");
-		return -1;
+		goto unlock_fail;
 	}
 	//check the who am i register to make sure the chip is alive
-	if(__check_who_am_i()){
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+	if(__check_who_am_i(mpu)){
+		goto unlock_fail;
 	}
-	if(__init_magnetometer(1)){
+	if(__init_magnetometer(mpu, 1)){
 		fprintf(stderr,"ERROR: failed to initialize_magnetometer\n");
-		rc_i2c_unlock_bus(config.i2c_bus);
-		return -1;
+		goto unlock_fail;
 	}
 
 	// set local calibration to initial values and prepare variables
-	mag_offsets[0] = 0.0;
-	mag_offsets[1] = 0.0;
-	mag_offsets[2] = 0.0;
-	mag_scales[0]  = 1.0;
-	mag_scales[1]  = 1.0;
-	mag_scales[2]  = 1.0;
+	mpu->mag_offsets[0] = 0.0;
+	mpu->mag_offsets[1] = 0.0;
+	mpu->mag_offsets[2] = 0.0;
+	mpu->mag_scales[0]  = 1.0;
+	mpu->mag_scales[1]  = 1.0;
+	mpu->mag_scales[2]  = 1.0;
 	if(rc_matrix_alloc(&A,samples,3)){
 		fprintf(stderr,"ERROR: in rc_calibrate_mag_routine, failed to alloc data matrix\n");
-		return -1;
+		goto unlock_fail;
 	}
 
 	// sample data
 	i = 0;
 	while(i<samples){
-		if(rc_mpu_read_mag(&imu_data)<0){
+		if(rc_mpu_instance_read_mag(mpu, &imu_data)<0){
 			fprintf(stderr,"ERROR: failed to read magnetometer\n");
 			break;
 		}
@@ -2877,8 +4019,8 @@ int rc_mpu_calibrate_mag_routine(rc_mpu_config_t conf)
 		rc_usleep(loop_wait_us);
 	}
 	// done with I2C for now
-	rc_mpu_power_off();
-	rc_i2c_unlock_bus(config.i2c_bus);
+	rc_mpu_instance_power_off(mpu);
+	rc_i2c_unlock_bus(mpu->config.i2c_bus);
 
 	printf("\n\nOkay Stop!\n");
 	printf("Calculating calibration constants.....\n");
@@ -2927,7 +4069,7 @@ int rc_mpu_calibrate_mag_routine(rc_mpu_config_t conf)
 							new_scale[1],\
 							new_scale[2]);
 	// write to disk
-	if(__write_mag_cal_to_disk(center.d,new_scale)<0){
+	if(__write_mag_cal_to_disk(mpu, center.d,new_scale)<0){
 		rc_vector_free(&center);
 		rc_vector_free(&lengths);
 		return -1;
@@ -2935,6 +4077,10 @@ int rc_mpu_calibrate_mag_routine(rc_mpu_config_t conf)
 	rc_vector_free(&center);
 	rc_vector_free(&lengths);
 	return 0;
+
+unlock_fail:
+	rc_i2c_unlock_bus(mpu->config.i2c_bus);
+	return -1;
 }
 
 /**
@@ -2944,7 +4090,7 @@ int rc_mpu_calibrate_mag_routine(rc_mpu_config_t conf)
  *
  * @return     0 on success, -1 on error, 1 if data was just too noisy
  */
-int __collect_accel_samples(int* avg_raw)
+int __collect_accel_samples(rc_mpu_t* mpu, int* avg_raw)
 {
 	uint8_t data[6];
 	int32_t sum[3];
@@ -2956,16 +4102,16 @@ int __collect_accel_samples(int* avg_raw)
 	rc_vector_t vz = rc_vector_empty();
 
 	// Configure FIFO to capture gyro data for bias calculation
-	rc_i2c_write_byte(config.i2c_bus, USER_CTRL, 0x40);   // Enable FIFO
+	rc_i2c_write_byte(mpu->config.i2c_bus, USER_CTRL, 0x40);   // Enable FIFO
 	// Enable accel sensors for FIFO (max size 512 bytes in MPU-9250)
-	rc_i2c_write_byte(config.i2c_bus, FIFO_EN, FIFO_ACCEL_EN);
+	rc_i2c_write_byte(mpu->config.i2c_bus, FIFO_EN, FIFO_ACCEL_EN);
 	// 6 bytes per sample. 200hz. wait 0.4 seconds
 	rc_usleep(400000);
 
 	// At end of sample accumulation, turn off FIFO sensor read
-	rc_i2c_write_byte(config.i2c_bus, FIFO_EN, 0x00);
+	rc_i2c_write_byte(mpu->config.i2c_bus, FIFO_EN, 0x00);
 	// read FIFO sample count and log number of samples
-	rc_i2c_read_bytes(config.i2c_bus, FIFO_COUNTH, 2, &data[0]);
+	rc_i2c_read_bytes(mpu->config.i2c_bus, FIFO_COUNTH, 2, &data[0]);
 	fifo_count = ((uint16_t)data[0] << 8) | data[1];
 	samples = fifo_count/6;
 
@@ -2982,7 +4128,7 @@ int __collect_accel_samples(int* avg_raw)
 	sum[2] = 0;
 	for (i=0; i<samples; i++) {
 		// read data for averaging
-		if(rc_i2c_read_bytes(config.i2c_bus, FIFO_R_W, 6, data)<0){
+		if(rc_i2c_read_bytes(mpu->config.i2c_bus, FIFO_R_W, 6, data)<0){
 			fprintf(stderr,"ERROR in rc_mpu_calibrate_accel_routine, failed to read FIFO\n");
 			return -1;
 		}
@@ -3010,14 +4156,14 @@ int __collect_accel_samples(int* avg_raw)
 
 	// try again if standard deviation is too high
 	if(dev_x>ACCEL_CAL_THRESH||dev_y>ACCEL_CAL_THRESH||dev_z>ACCEL_CAL_THRESH){
-		was_last_steady = 0;
+		mpu->was_last_steady = 0;
 		printf("data too noisy, please hold me still\n");
 		return 1;
 	}
 	// this skips the first steady reading after a noisy reading
 	// to make sure IMU has settled after being picked up.
-	if(was_last_steady == 0){
-		was_last_steady = 1;
+	if(mpu->was_last_steady == 0){
+		mpu->was_last_steady = 1;
 		return 1;
 	}
 	// average out the samples
@@ -3034,55 +4180,51 @@ int __collect_accel_samples(int* avg_raw)
 
 int rc_mpu_calibrate_accel_routine(rc_mpu_config_t conf)
 {
+	rc_mpu_t cal_mpu = RC_MPU_INSTANCE_INITIALIZER;
+	rc_mpu_t* mpu = &cal_mpu;
 	int ret, i, j;
 	int avg_raw[6][3];
 
-	// save bus and address globally for other functions to use
-	config.i2c_bus = conf.i2c_bus;
-	config.i2c_addr = conf.i2c_addr;
-
-	// make sure the bus is not currently in use by another thread
-	// do not proceed to prevent interfering with that process
-	if(rc_i2c_get_lock(config.i2c_bus)){
-		fprintf(stderr,"ERROR in rc_mpu_calibrate_accel_routine, i2c bus claimed by another process\n");
-		return -1;
-	}
+	// calibration runs on its own instance with the user's bus and address
+	mpu->config = rc_mpu_default_config();
+	mpu->config.i2c_bus = conf.i2c_bus;
+	mpu->config.i2c_addr = conf.i2c_addr;
+	__set_cal_file_paths(mpu);
 
-	// if it is not claimed, start the i2c bus
-	if(rc_i2c_init(config.i2c_bus, config.i2c_addr)){
+	// start the i2c bus
+	if(rc_i2c_init(mpu->config.i2c_bus, mpu->config.i2c_addr)){
 		fprintf(stderr,"ERROR in rc_mpu_calibrate_accel_routine, failed at rc_i2c_init\n");
 		return -1;
 	}
 
-	// claiming the bus does no guarantee other code will not interfere
-	// with this process, but best to claim it so other code can check
-	// like we did above
-	rc_i2c_lock_bus(config.i2c_bus);
+	// claim the bus, this waits for other threads and processes to finish
+	// with it
+	rc_i2c_lock_bus(mpu->config.i2c_bus);
 
 	// reset device, reset all registers
-	if(__reset_mpu()<0){
+	if(__reset_mpu(mpu)<0){
 		fprintf(stderr,"ERROR in rc_mpu_calibrate_accel_routine failed to reset MPU9250\n");
-		return -1;
+		goto unlock_fail;
 	}
 
 	// set up the IMU specifically for calibration.
-	rc_i2c_write_byte(config.i2c_bus, PWR_MGMT_1, 0x01);
-	rc_i2c_write_byte(config.i2c_bus, PWR_MGMT_2, 0x00);
+	rc_i2c_write_byte(mpu->config.i2c_bus, PWR_MGMT_1, 0x01);
+	rc_i2c_write_byte(mpu->config.i2c_bus, PWR_MGMT_2, 0x00);
 	rc_usleep(200000);
 
-	rc_i2c_write_byte(config.i2c_bus, INT_ENABLE, 0x00);	// Disable all interrupts
-	rc_i2c_write_byte(config.i2c_bus, FIFO_EN, 0x00);	// Disable FIFO
-	rc_i2c_write_byte(config.i2c_bus, PWR_MGMT_1, 0x00);	// Turn on internal clock source
-	rc_i2c_write_byte(config.i2c_bus, I2C_MST_CTRL, 0x00);	// Disable I2C master
-	rc_i2c_write_byte(config.i2c_bus, USER_CTRL, 0x00);	// Disable FIFO and I2C master
-	rc_i2c_write_byte(config.i2c_bus, USER_CTRL, 0x0C);	// Reset FIFO and DMP
+	rc_i2c_write_byte(mpu->config.i2c_bus, INT_ENABLE, 0x00);	// Disable all interrupts
+	rc_i2c_write_byte(mpu->config.i2c_bus, FIFO_EN, 0x00);	// Disable FIFO
+	rc_i2c_write_byte(mpu->config.i2c_bus, PWR_MGMT_1, 0x00);	// Turn on internal clock source
+	rc_i2c_write_byte(mpu->config.i2c_bus, I2C_MST_CTRL, 0x00);	// Disable I2C master
+	rc_i2c_write_byte(mpu->config.i2c_bus, USER_CTRL, 0x00);	// Disable FIFO and I2C master
+	rc_i2c_write_byte(mpu->config.i2c_bus, USER_CTRL, 0x0C);	// Reset FIFO and DMP
 	rc_usleep(15000);
 
 	// Configure MPU9250 gyro and accelerometer for bias calculation
-	rc_i2c_write_byte(config.i2c_bus, CONFIG, 0x01);	// Set low-pass filter to 188 Hz
-	rc_i2c_write_byte(config.i2c_bus, SMPLRT_DIV, 0x04);	// Set sample rate to 200hz
-	rc_i2c_write_byte(config.i2c_bus, GYRO_CONFIG, 0x00);	// set G FSR to 250dps
-	rc_i2c_write_byte(config.i2c_bus, ACCEL_CONFIG, 0x00);	// set A FSR to 2G
+	rc_i2c_write_byte(mpu->config.i2c_bus, CONFIG, 0x01);	// Set low-pass filter to 188 Hz
+	rc_i2c_write_byte(mpu->config.i2c_bus, SMPLRT_DIV, 0x04);	// Set sample rate to 200hz
+	rc_i2c_write_byte(mpu->config.i2c_bus, GYRO_CONFIG, 0x00);	// set G FSR to 250dps
+	rc_i2c_write_byte(mpu->config.i2c_bus, ACCEL_CONFIG, 0x00);	// set A FSR to 2G
 
 
 	// collect an orientation
@@ -3090,10 +4232,10 @@ int rc_mpu_calibrate_accel_routine(rc_mpu_config_t conf)
 	printf("When ready, press any key to sample accelerometer\n");
 	getchar();
 	ret = 1;
-	was_last_steady=0;
+	mpu->was_last_steady=0;
 	while(ret){
-		ret=__collect_accel_samples(avg_raw[0]);
-		if(ret==-1) return -1;
+		ret=__collect_accel_samples(mpu, avg_raw[0]);
+		if(ret==-1) goto unlock_fail;
 	}
 	printf("success\n");
 	// collect an orientation
@@ -3101,10 +4243,10 @@ int rc_mpu_calibrate_accel_routine(rc_mpu_config_t conf)
 	printf("When ready, press any key to sample accelerometer\n");
 	getchar();
 	ret = 1;
-	was_last_steady=0;
+	mpu->was_last_steady=0;
 	while(ret){
-		ret=__collect_accel_samples(avg_raw[1]);
-		if(ret==-1) return -1;
+		ret=__collect_accel_samples(mpu, avg_raw[1]);
+		if(ret==-1) goto unlock_fail;
 	}
 	printf("success\n");
 	// collect an orientation
@@ -3112,10 +4254,10 @@ int rc_mpu_calibrate_accel_routine(rc_mpu_config_t conf)
 	printf("When ready, press any key to sample accelerometer\n");
 	getchar();
 	ret = 1;
-	was_last_steady=0;
+	mpu->was_last_steady=0;
 	while(ret){
-		ret=__collect_accel_samples(avg_raw[2]);
-		if(ret==-1) return -1;
+		ret=__collect_accel_samples(mpu, avg_raw[2]);
+		if(ret==-1) goto unlock_fail;
 	}
 	printf("success\n");
 	// collect an orientation
@@ -3123,10 +4265,10 @@ int rc_mpu_calibrate_accel_routine(rc_mpu_config_t conf)
 	printf("When ready, press any key to sample accelerometer\n");
 	getchar();
 	ret = 1;
-	was_last_steady=0;
+	mpu->was_last_steady=0;
 	while(ret){
-		ret=__collect_accel_samples(avg_raw[3]);
-		if(ret==-1) return -1;
+		ret=__collect_accel_samples(mpu, avg_raw[3]);
+		if(ret==-1) goto unlock_fail;
 	}
 	printf("success\n");
 	// collect an orientation
@@ -3134,10 +4276,10 @@ int rc_mpu_calibrate_accel_routine(rc_mpu_config_t conf)
 	printf("When ready, press any key to sample accelerometer\n");
 	getchar();
 	ret = 1;
-	was_last_steady=0;
+	mpu->was_last_steady=0;
 	while(ret){
-		ret=__collect_accel_samples(avg_raw[4]);
-		if(ret==-1) return -1;
+		ret=__collect_accel_samples(mpu, avg_raw[4]);
+		if(ret==-1) goto unlock_fail;
 	}
 	printf("success\n");
 	// collect an orientation
@@ -3145,16 +4287,16 @@ int rc_mpu_calibrate_accel_routine(rc_mpu_config_t conf)
 	printf("When ready, press any key to sample accelerometer\n");
 	getchar();
 	ret = 1;
-	was_last_steady=0;
+	mpu->was_last_steady=0;
 	while(ret){
-		ret=__collect_accel_samples(avg_raw[5]);
-		if(ret==-1) return -1;
+		ret=__collect_accel_samples(mpu, avg_raw[5]);
+		if(ret==-1) goto unlock_fail;
 	}
 	printf("success\n");
 
 	// done with I2C for now
-	rc_mpu_power_off();
-	rc_i2c_unlock_bus(config.i2c_bus);
+	rc_mpu_instance_power_off(mpu);
+	rc_i2c_unlock_bus(mpu->config.i2c_bus);
 
 	// fit the ellipse
 	rc_matrix_t A = rc_matrix_empty();
@@ -3216,13 +4358,17 @@ int rc_mpu_calibrate_accel_routine(rc_mpu_config_t conf)
 							lengths.d[2]);
 
 	// write to disk
-	if(__write_accel_cal_to_disk(center.d, lengths.d)==-1){
+	if(__write_accel_cal_to_disk(mpu, center.d, lengths.d)==-1){
 		fprintf(stderr,"ERROR in rc_mpu_calibrate_accel_routine, failed to write to disk\n");
 		return -1;
 	}
 	rc_vector_free(&center);
 	rc_vector_free(&lengths);
 	return 0;
+
+unlock_fail:
+	rc_i2c_unlock_bus(mpu->config.i2c_bus);
+	return -1;
 }
 
 
@@ -3245,110 +4391,383 @@ int rc_mpu_is_accel_calibrated(void)
 }
 
 
+/**
+ * Clears both background calibration fits, called at the start of each
+ * initialization.
+ *
+ * @param      mpu   The mpu
+ */
+static void __online_cal_init(rc_mpu_t* mpu)
+{
+	pthread_mutex_lock(&mpu->cal_mutex);
+	rc_ellipsoid_fit_init(&mpu->mag_fit, ONLINE_CAL_FORGET);
+	rc_ellipsoid_fit_init(&mpu->accel_fit, ONLINE_CAL_FORGET);
+	pthread_mutex_unlock(&mpu->cal_mutex);
+	return;
+}
+
+
+/**
+ * Adds a point to a background fit if it is at least spacing away from the
+ * last point accepted, otherwise a sensor sitting still would fill the fit
+ * with one point and forget everything else. Caller must hold cal_mutex.
+ *
+ * @param      fit      The fit
+ * @param      last     The last point accepted into the fit
+ * @param[in]  p        The new point
+ * @param[in]  spacing  The minimum distance between points
+ */
+static void __online_cal_add(rc_ellipsoid_fit_t* fit, double last[3], const double p[3], double spacing)
+{
+	int i;
+	double d, dist2 = 0.0;
+	if(fit->n!=0){
+		for(i=0;i<3;i++){
+			d = p[i]-last[i];
+			dist2 += d*d;
+		}
+		if(dist2 < spacing*spacing) return;
+	}
+	if(rc_ellipsoid_fit_add_point(fit, p)<0) return;
+	for(i=0;i<3;i++) last[i]=p[i];
+	return;
+}
+
 
-int64_t rc_mpu_nanos_since_last_dmp_interrupt(void)
+/**
+ * Feeds the background accelerometer fit from the interrupt thread. Only
+ * samples taken while the gyro reads close to zero are used so the
+ * accelerometer measures gravity alone. The fit is of the raw data in G which
+ * already has the offsets from the calibration file removed in hardware.
+ *
+ * @param      mpu   The mpu
+ * @param      data  The data just read
+ */
+static void __online_cal_accel(rc_mpu_t* mpu, rc_mpu_data_t* data)
 {
-	if(last_interrupt_timestamp_nanos==0) return -1;
-	return rc_nanos_since_epoch() - last_interrupt_timestamp_nanos;
+	int i;
+	double g[3], rate2 = 0.0;
+	if(!mpu->config.accel_online_cal) return;
+	// raw accel and gyro are only read by the DMP when asked to
+	if(mpu->dmp_en && !mpu->config.dmp_fetch_accel_gyro) return;
+	for(i=0;i<3;i++) rate2 += data->gyro[i]*data->gyro[i];
+	if(rate2 > ACCEL_CAL_STILL_DPS*ACCEL_CAL_STILL_DPS) return;
+	for(i=0;i<3;i++) g[i] = data->raw_accel[i]*data->accel_to_ms2/G_TO_MS2;
+	pthread_mutex_lock(&mpu->cal_mutex);
+	__online_cal_add(&mpu->accel_fit, mpu->accel_fit_last, g, ACCEL_CAL_SPACING);
+	pthread_mutex_unlock(&mpu->cal_mutex);
+	return;
 }
 
-int64_t rc_mpu_nanos_since_last_tap(void)
+
+int rc_mpu_instance_get_online_calibration(rc_mpu_t* mpu, rc_mpu_online_cal_t* cal)
 {
-	if(last_tap_timestamp_nanos==0) return -1;
-	return rc_nanos_since_epoch() - last_tap_timestamp_nanos;
+	int i;
+	rc_ellipsoid_fit_t mag_fit, accel_fit;
+	double center[3], lengths[3];
+
+	if(unlikely(cal==NULL)){
+		fprintf(stderr,"ERROR in rc_mpu_get_online_calibration, received NULL pointer\n");
+		return -1;
+	}
+	// solve copies of the fits so the interrupt thread isn't held up
+	pthread_mutex_lock(&mpu->cal_mutex);
+	mag_fit = mpu->mag_fit;
+	accel_fit = mpu->accel_fit;
+	pthread_mutex_unlock(&mpu->cal_mutex);
+
+	memset(cal, 0, sizeof(rc_mpu_online_cal_t));
+	cal->mag_points = mag_fit.n;
+	cal->accel_points = accel_fit.n;
+
+	// same sanity checks as rc_mpu_calibrate_mag_routine, then map the
+	// ellipsoid to a sphere of radius 70uT
+	if(mag_fit.n>=ONLINE_CAL_MIN_POINTS && \
+			rc_ellipsoid_fit_solve(&mag_fit, center, lengths)==0){
+		cal->mag_valid = 1;
+		for(i=0;i<3;i++){
+			if(isnan(center[i]) || isnan(lengths[i]) || fabs(center[i])>200.0 || \
+					lengths[i]>200.0 || lengths[i]<5.0){
+				cal->mag_valid = 0;
+				break;
+			}
+			cal->mag_offsets[i] = center[i];
+			cal->mag_scales[i] = 70.0/lengths[i];
+		}
+	}
+
+	// the accel fit is relative to the offsets already in hardware
+	if(accel_fit.n>=ONLINE_CAL_MIN_POINTS && \
+			rc_ellipsoid_fit_solve(&accel_fit, center, lengths)==0){
+		cal->accel_valid = 1;
+		for(i=0;i<3;i++){
+			cal->accel_center[i] = mpu->accel_center[i] + center[i];
+			cal->accel_lengths[i] = lengths[i];
+			if(isnan(cal->accel_center[i]) || isnan(lengths[i]) || \
+					fabs(cal->accel_center[i])>0.3 || \
+					lengths[i]>1.3 || lengths[i]<0.7){
+				cal->accel_valid = 0;
+				break;
+			}
+		}
+	}
+	if(!cal->mag_valid){
+		memset(cal->mag_offsets, 0, sizeof(cal->mag_offsets));
+		memset(cal->mag_scales, 0, sizeof(cal->mag_scales));
+	}
+	if(!cal->accel_valid){
+		memset(cal->accel_center, 0, sizeof(cal->accel_center));
+		memset(cal->accel_lengths, 0, sizeof(cal->accel_lengths));
+	}
+	return 0;
 }
 
-int rc_mpu_block_until_dmp_data(void)
+
+int rc_mpu_instance_save_online_calibration(rc_mpu_t* mpu)
+{
+	int i;
+	rc_mpu_online_cal_t cal;
+
+	if(rc_mpu_instance_get_online_calibration(mpu, &cal)<0) return -1;
+	if(!cal.mag_valid && !cal.accel_valid) return 1;
+
+	if(cal.mag_valid){
+		if(__write_mag_cal_to_disk(mpu, cal.mag_offsets, cal.mag_scales)<0){
+			fprintf(stderr,"ERROR in rc_mpu_save_online_calibration, failed to write magnetometer calibration\n");
+			return -1;
+		}
+		// start using it right away, the factory corrected data the fit
+		// works on is unaffected so the fit carries on as before
+		pthread_mutex_lock(&mpu->cal_mutex);
+		for(i=0;i<3;i++){
+			mpu->mag_offsets[i] = cal.mag_offsets[i];
+			mpu->mag_scales[i] = cal.mag_scales[i];
+		}
+		pthread_mutex_unlock(&mpu->cal_mutex);
+	}
+	// accel offsets are written to hardware registers during initialization
+	// so these take effect next time the MPU is started
+	if(cal.accel_valid){
+		if(__write_accel_cal_to_disk(mpu, cal.accel_center, cal.accel_lengths)<0){
+			fprintf(stderr,"ERROR in rc_mpu_save_online_calibration, failed to write accelerometer calibration\n");
+			return -1;
+		}
+	}
+	return 0;
+}
+
+
+
+int64_t rc_mpu_instance_nanos_since_last_dmp_interrupt(rc_mpu_t* mpu)
+{
+	if(mpu->last_interrupt_timestamp_nanos==0) return -1;
+	return rc_nanos_since_epoch() - mpu->last_interrupt_timestamp_nanos;
+}
+
+int64_t rc_mpu_instance_nanos_since_last_tap(rc_mpu_t* mpu)
+{
+	if(mpu->last_tap_timestamp_nanos==0) return -1;
+	return rc_nanos_since_epoch() - mpu->last_tap_timestamp_nanos;
+}
+
+int rc_mpu_instance_block_until_dmp_data(rc_mpu_t* mpu)
 {
-	if(imu_shutdown_flag!=0){
+	if(mpu->imu_shutdown_flag!=0){
 		fprintf(stderr,"ERROR: call to rc_mpu_block_until_dmp_data after shutting down mpu\n");
 		return -1;
 	}
-	if(!thread_running_flag){
+	if(!mpu->thread_running_flag){
 		fprintf(stderr,"ERROR: call to rc_mpu_block_until_dmp_data when DMP handler not running\n");
 		return -1;
 	}
 	// wait for condition signal which unlocks mutex
-	pthread_mutex_lock(&read_mutex);
-	pthread_cond_wait(&read_condition, &read_mutex);
-	pthread_mutex_unlock(&read_mutex);
+	pthread_mutex_lock(&mpu->read_mutex);
+	pthread_cond_wait(&mpu->read_condition, &mpu->read_mutex);
+	pthread_mutex_unlock(&mpu->read_mutex);
 	// check if condition was broadcast due to shutdown
-	if(imu_shutdown_flag) return 1;
+	if(mpu->imu_shutdown_flag) return 1;
 	// otherwise return 0 on actual button press
 	return 0;
 }
 
-int rc_mpu_block_until_tap(void)
+/**
+ * Writer side of the seqlock around published_data. Only the interrupt thread
+ * ever calls this so there is no writer-writer contention, readers simply
+ * retry if they catch the sequence number odd or changed.
+ *
+ * @param      data  freshly read data to publish
+ */
+static void __publish_data(rc_mpu_t* mpu, rc_mpu_data_t* data)
+{
+	__atomic_store_n(&mpu->published_seq, mpu->published_seq+1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	mpu->published_data = *data;
+	__atomic_store_n(&mpu->published_seq, mpu->published_seq+1, __ATOMIC_RELEASE);
+}
+
+
+int rc_mpu_instance_get_latest(rc_mpu_t* mpu, rc_mpu_data_t* out)
+{
+	uint32_t seq1, seq2 = 0;
+	if(unlikely(out==NULL)){
+		fprintf(stderr,"ERROR: in rc_mpu_get_latest, received NULL pointer\n");
+		return -1;
+	}
+	if(!mpu->thread_running_flag){
+		fprintf(stderr,"ERROR: call to rc_mpu_get_latest when DMP handler not running\n");
+		return -1;
+	}
+	do{
+		seq1 = __atomic_load_n(&mpu->published_seq, __ATOMIC_ACQUIRE);
+		if(seq1==0) return 1; // nothing published yet
+		if(seq1&1) continue;  // writer in progress
+		*out = mpu->published_data;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		seq2 = __atomic_load_n(&mpu->published_seq, __ATOMIC_RELAXED);
+	}while((seq1&1) || seq1!=seq2);
+	return 0;
+}
+
+
+int rc_mpu_instance_block_until_tap(rc_mpu_t* mpu)
 {
-	if(imu_shutdown_flag!=0){
+	if(mpu->imu_shutdown_flag!=0){
 		fprintf(stderr,"ERROR: call to rc_mpu_block_until_tap after shutting down mpu\n");
 		return -1;
 	}
-	if(!thread_running_flag){
+	if(!mpu->thread_running_flag){
 		fprintf(stderr,"ERROR: call to rc_mpu_block_until_tap when DMP handler not running\n");
 		return -1;
 	}
 	// wait for condition signal which unlocks mutex
-	pthread_mutex_lock(&tap_mutex);
-	pthread_cond_wait(&tap_condition, &tap_mutex);
-	pthread_mutex_unlock(&tap_mutex);
+	pthread_mutex_lock(&mpu->tap_mutex);
+	pthread_cond_wait(&mpu->tap_condition, &mpu->tap_mutex);
+	pthread_mutex_unlock(&mpu->tap_mutex);
 	// check if condition was broadcast due to shutdown
-	if(imu_shutdown_flag) return 1;
+	if(mpu->imu_shutdown_flag) return 1;
 	// otherwise return 0 on actual button press
 	return 0;
 }
 
-static int __mag_correct_orientation(double mag_vec[3])
+static int __correct_orientation(rc_mpu_t* mpu, double in[3], double out[3])
 {
-	// create a quaternion vector from the current magnetic field vector
-	// in IMU body coordinate frame. Since the DMP quaternion is aligned with
-	// a particular orientation, we must be careful to orient the magnetometer
-	// data to match.
-	switch(config.orient){
+	// rotate a vector in IMU body coordinate frame such as the magnetic
+	// field. Since the DMP quaternion is aligned with a particular
+	// orientation, we must be careful to orient the sensor data to match.
+	switch(mpu->config.orient){
 	case ORIENTATION_Z_UP:
-		mag_vec[0] = data_ptr->mag[TB_PITCH_X];
-		mag_vec[1] = data_ptr->mag[TB_ROLL_Y];
-		mag_vec[2] = data_ptr->mag[TB_YAW_Z];
+		out[0] = in[TB_PITCH_X];
+		out[1] = in[TB_ROLL_Y];
+		out[2] = in[TB_YAW_Z];
 		break;
 	case ORIENTATION_Z_DOWN:
-		mag_vec[0] = -data_ptr->mag[TB_PITCH_X];
-		mag_vec[1] = data_ptr->mag[TB_ROLL_Y];
-		mag_vec[2] = -data_ptr->mag[TB_YAW_Z];
+		out[0] = -in[TB_PITCH_X];
+		out[1] = in[TB_ROLL_Y];
+		out[2] = -in[TB_YAW_Z];
 		break;
 	case ORIENTATION_X_UP:
-		mag_vec[0] = -data_ptr->mag[TB_YAW_Z];
-		mag_vec[1] = data_ptr->mag[TB_ROLL_Y];
-		mag_vec[2] = data_ptr->mag[TB_PITCH_X];
+		out[0] = -in[TB_YAW_Z];
+		out[1] = in[TB_ROLL_Y];
+		out[2] = in[TB_PITCH_X];
 		break;
 	case ORIENTATION_X_DOWN:
-		mag_vec[0] = data_ptr->mag[TB_YAW_Z];
-		mag_vec[1] = data_ptr->mag[TB_ROLL_Y];
-		mag_vec[2] = -data_ptr->mag[TB_PITCH_X];
+		out[0] = in[TB_YAW_Z];
+		out[1] = in[TB_ROLL_Y];
+		out[2] = -in[TB_PITCH_X];
 		break;
 	case ORIENTATION_Y_UP:
-		mag_vec[0] = data_ptr->mag[TB_PITCH_X];
-		mag_vec[1] = -data_ptr->mag[TB_YAW_Z];
-		mag_vec[2] = data_ptr->mag[TB_ROLL_Y];
+		out[0] = in[TB_PITCH_X];
+		out[1] = -in[TB_YAW_Z];
+		out[2] = in[TB_ROLL_Y];
 		break;
 	case ORIENTATION_Y_DOWN:
-		mag_vec[0] = data_ptr->mag[TB_PITCH_X];
-		mag_vec[1] = data_ptr->mag[TB_YAW_Z];
-		mag_vec[2] = -data_ptr->mag[TB_ROLL_Y];
+		out[0] = in[TB_PITCH_X];
+		out[1] = in[TB_YAW_Z];
+		out[2] = -in[TB_ROLL_Y];
 		break;
 	case ORIENTATION_X_FORWARD:
-		mag_vec[0] = -data_ptr->mag[TB_ROLL_Y];
-		mag_vec[1] = data_ptr->mag[TB_PITCH_X];
-		mag_vec[2] = data_ptr->mag[TB_YAW_Z];
+		out[0] = -in[TB_ROLL_Y];
+		out[1] = in[TB_PITCH_X];
+		out[2] = in[TB_YAW_Z];
 		break;
 	case ORIENTATION_X_BACK:
-		mag_vec[0] = data_ptr->mag[TB_ROLL_Y];
-		mag_vec[1] = -data_ptr->mag[TB_PITCH_X];
-		mag_vec[2] = data_ptr->mag[TB_YAW_Z];
+		out[0] = in[TB_ROLL_Y];
+		out[1] = -in[TB_PITCH_X];
+		out[2] = in[TB_YAW_Z];
 		break;
 	default:
-		fprintf(stderr,"ERROR: reading magnetometer, invalid orientation\n");
+		fprintf(stderr,"ERROR: in __correct_orientation, invalid orientation\n");
+		return -1;
+	}
+	return 0;
+}
+/**
+ * Polls a register until all bits in mask read back as 0, used by fast_start
+ * in place of fixed sleeps. Reads go straight to the file descriptor so the
+ * NACKs expected while the device is busy resetting don't print errors.
+ *
+ * @param[in]  reg         register to poll
+ * @param[in]  mask        bits to wait on
+ * @param[in]  timeout_us  how long to keep trying
+ *
+ * @return     0 once the bits clear, -1 on timeout
+ */
+static int __poll_bits_clear(rc_mpu_t* mpu, uint8_t reg, uint8_t mask, int timeout_us)
+{
+	uint8_t val;
+	uint64_t deadline = rc_nanos_since_boot() + (uint64_t)timeout_us*1000;
+	do{
+		rc_usleep(FAST_POLL_US);
+		// the chip doesn't answer for part of a reset, so failed reads
+		// are expected here and shouldn't print
+		if(rc_i2c_read_byte_quiet(mpu->config.i2c_bus, reg, &val)==1 && !(val&mask)){
+			return 0;
+		}
+	}while(rc_nanos_since_boot() < deadline);
+	return -1;
+}
+
+
+/**
+ * Waits for the magnetometer data ready bit instead of sleeping a full
+ * measurement period. Reads ST1 directly in bypass mode or the copy in
+ * EXT_SENS_DATA_00 when the i2c master is sampling it. Leaves the device
+ * address on the MPU either way.
+ *
+ * @return     0 when data is ready, -1 on timeout
+ */
+static int __mag_wait_ready(rc_mpu_t* mpu)
+{
+	uint8_t st1;
+	int ret = -1;
+	uint64_t deadline = rc_nanos_since_boot() + (uint64_t)MAG_DRDY_TIMEOUT_US*1000;
+	if(!mpu->mag_i2c_master_en){
+		rc_i2c_set_device_address(mpu->config.i2c_bus, AK8963_ADDR);
+	}
+	do{
+		if(mpu->mag_i2c_master_en){
+			if(rc_i2c_read_byte(mpu->config.i2c_bus, EXT_SENS_DATA_00, &st1)<0) break;
+		}
+		else if(rc_i2c_read_byte(mpu->config.i2c_bus, AK8963_ST1, &st1)<0) break;
+		if(st1&MAG_DATA_READY){
+			ret = 0;
+			break;
+		}
+		rc_usleep(FAST_POLL_US);
+	}while(rc_nanos_since_boot() < deadline);
+	rc_i2c_set_device_address(mpu->config.i2c_bus, mpu->config.i2c_addr);
+	return ret;
+}
+
+
+int rc_mpu_instance_get_init_timing(rc_mpu_t* mpu, rc_mpu_init_timing_t* timing)
+{
+	if(mpu==NULL || timing==NULL){
+		fprintf(stderr,"ERROR: in rc_mpu_get_init_timing, received NULL pointer\n");
 		return -1;
 	}
+	*timing = mpu->init_timing;
 	return 0;
 }
+
 // Phew, that was a lot of code....
@@ -12,6 +12,21 @@ identical but the latter has a different register map
 // internal DMP sample rate limits
 #define DMP_MAX_RATE		200
 #define DMP_MIN_RATE		4
+// raw sample rate limits for the software AHRS
+#define AHRS_MAX_RATE		1000
+#define AHRS_MIN_RATE		4
+// register polling used by the fast_start config option
+#define FAST_POLL_US		200	// microseconds between status polls
+#define RESET_TIMEOUT_US	100000
+#define FIFO_RST_TIMEOUT_US	50000
+#define MAG_DRDY_TIMEOUT_US	20000
+#define FAST_MAG_SAMPLES	4	// samples averaged for the starting heading
+// background calibration, see rc_mpu_get_online_calibration
+#define ONLINE_CAL_FORGET	0.999	// remembers roughly the last 1000 points
+#define MAG_CAL_SPACING		3.0	// uT between accepted magnetometer points
+#define ACCEL_CAL_SPACING	0.1	// G between accepted accelerometer points
+#define ACCEL_CAL_STILL_DPS	3.0	// gyro magnitude below which to consider still
+#define ONLINE_CAL_MIN_POINTS	50	// points before a fit can be valid
 #define IMU_POLL_TIMEOUT	300 // milliseconds
 
 
@@ -317,6 +332,9 @@ identical but the latter has a different register map
 #define BIT_SLAVE_EN		(0x80)
 #define BIT_I2C_READ		(0x80)
 #define BITS_I2C_MASTER_DLY	(0x1F)
+#define BIT_WAIT_FOR_ES		(0x40)
+#define BIT_I2C_MST_P_NSR	(0x10)
+#define I2C_MST_CLK_400		(0x0D)
 #define BIT_AUX_IF_EN		(0x20)
 #define BIT_ACTL		(0x80)
 #define BIT_LATCH_EN		(0x20)
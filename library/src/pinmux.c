@@ -11,6 +11,7 @@
 #include <unistd.h> // for close
 #include <rc/pinmux.h>
 #include <rc/model.h>
+#include <rc/sim.h>
 
 // preposessor macros
 #define unlikely(x)	__builtin_expect (!!(x), 0)
@@ -278,6 +279,9 @@ int rc_pinmux_set(int pin, rc_pinmux_mode_t mode)
 		return -1;
 	}
 
+	// nothing to mux on simulated hardware
+	if(rc_sim_is_enabled()==1) return 0;
+
 	// open pin state fd
 	errno=0;
 	fd = open(path, O_WRONLY);
@@ -11,6 +11,7 @@
 #include <rc/pru.h>
 #include <rc/time.h>
 #include <rc/encoder_pru.h>
+#include "../sim/sim_common.h"
 
 #define ENCODER_PRU_CH		0 // PRU0
 #define ENCODER_PRU_FW		"am335x-pru0-rc-encoder-fw"
@@ -19,15 +20,18 @@
 // pru shared memory pointer
 static volatile unsigned int* shared_mem_32bit_ptr = NULL;
 static int init_flag=0;
+static const rc_encoder_ops_t* ops; // hardware or simulated, picked by rc_encoder_pru_init
 
-int rc_encoder_pru_init(void)
+/**
+ * starts the PRU encoder firmware and waits for it to zero the counter
+ */
+static int __hw_init(void)
 {
 	int i;
 	// map memory
 	shared_mem_32bit_ptr = rc_pru_shared_mem_ptr();
 	if(shared_mem_32bit_ptr==NULL){
 		fprintf(stderr, "ERROR in rc_encoder_pru_init, failed to map shared memory pointer\n");
-		init_flag=0;
 		return -1;
 	}
 	// set first channel to be nonzero, PRU binary will zero this out later
@@ -41,22 +45,18 @@ int rc_encoder_pru_init(void)
 
 	// make sure memory actually got zero'd out
 	for(i=0;i<40;i++){
-		if(shared_mem_32bit_ptr[ENCODER_MEM_OFFSET]==0){
-			init_flag=1;
-			return 0;
-		}
+		if(shared_mem_32bit_ptr[ENCODER_MEM_OFFSET]==0) return 0;
 		rc_usleep(100000);
 	}
 
 	fprintf(stderr, "ERROR in rc_encoder_pru_init, %s failed to load\n", ENCODER_PRU_FW);
 	fprintf(stderr, "attempting to stop PRU%d\n", ENCODER_PRU_CH);
 	rc_pru_stop(ENCODER_PRU_CH);
-	init_flag=0;
 	return -1;
 }
 
 
-void rc_encoder_pru_cleanup(void)
+static void __hw_cleanup(void)
 {
 	// zero out shared memory
 	if(shared_mem_32bit_ptr != NULL){
@@ -64,6 +64,47 @@ void rc_encoder_pru_cleanup(void)
 	}
 	rc_pru_stop(ENCODER_PRU_CH);
 	shared_mem_32bit_ptr = NULL;
+	return;
+}
+
+
+static int __hw_read(__attribute__ ((unused)) int ch)
+{
+	return (int) shared_mem_32bit_ptr[ENCODER_MEM_OFFSET];
+}
+
+
+static int __hw_write(__attribute__ ((unused)) int ch, int pos)
+{
+	shared_mem_32bit_ptr[ENCODER_MEM_OFFSET] = pos;
+	return 0;
+}
+
+
+static const rc_encoder_ops_t hw_ops = {
+	.init		= __hw_init,
+	.cleanup	= __hw_cleanup,
+	.read		= __hw_read,
+	.write		= __hw_write,
+};
+
+
+int rc_encoder_pru_init(void)
+{
+	init_flag=0;
+	ops = __sim_pick_ops(&hw_ops, &__sim_encoder_pru_ops);
+	if(ops==NULL) return -1;
+	if(ops->init()) return -1;
+	init_flag=1;
+	return 0;
+}
+
+
+void rc_encoder_pru_cleanup(void)
+{
+	// the PRU is stopped even if init failed part way
+	if(ops==NULL) ops = &hw_ops;
+	ops->cleanup();
 	init_flag=0;
 	return;
 }
@@ -71,20 +112,19 @@ void rc_encoder_pru_cleanup(void)
 
 int rc_encoder_pru_read(void)
 {
-	if(shared_mem_32bit_ptr==NULL || init_flag==0){
+	if(init_flag==0){
 		fprintf(stderr, "ERROR in rc_encoder_pru_read, call rc_encoder_pru_init first\n");
 		return -1;
 	}
-	return (int) shared_mem_32bit_ptr[ENCODER_MEM_OFFSET];
+	return ops->read(4);
 }
 
 
 int rc_encoder_pru_write(int pos)
 {
-	if(shared_mem_32bit_ptr==NULL || init_flag==0){
+	if(init_flag==0){
 		fprintf(stderr, "ERROR in rc_encoder_pru_write, call rc_encoder_pru_init first\n");
 		return -1;
 	}
-	shared_mem_32bit_ptr[ENCODER_MEM_OFFSET] = pos;
-	return 0;
+	return ops->write(4, pos);
 }
@@ -13,6 +13,7 @@
 #include <rc/gpio.h>
 #include <rc/servo.h>
 #include <rc/time.h>
+#include "../sim/sim_common.h"
 
 #define TOL		0.01	// acceptable tolerance on doubleing point bounds
 #define GPIO_POWER_PIN	2,16	//gpio2.16 P8.36
@@ -23,24 +24,21 @@
 // pru shared memory pointer
 static volatile unsigned int* shared_mem_32bit_ptr = NULL;
 static int init_flag=0;
+static const rc_servo_ops_t* ops; // hardware or simulated, picked by rc_servo_init
 
 static int esc_max_us =  RC_ESC_DEFAULT_MAX_US;
 static int esc_min_us =  RC_ESC_DEFAULT_MIN_US;
 
-int rc_servo_init(void)
+/**
+ * starts the PRU servo firmware and waits for it to zero the channels
+ */
+static int __hw_start(void)
 {
 	int i;
-	// start gpio power rail pin
-	if(rc_gpio_init(GPIO_POWER_PIN, GPIOHANDLE_REQUEST_OUTPUT)==-1){
-		fprintf(stderr, "ERROR in rc_servo_init, failed to set up power rail GPIO pin\n");
-		init_flag=0;
-		return -1;
-	}
 	// map memory
 	shared_mem_32bit_ptr = rc_pru_shared_mem_ptr();
 	if(shared_mem_32bit_ptr == NULL){
 		fprintf(stderr, "ERROR in rc_servo_init, failed to map shared memory pointer\n");
-		init_flag=0;
 		return -1;
 	}
 	// set channels to be nonzero, PRU binary will zero this out later
@@ -57,34 +55,101 @@ int rc_servo_init(void)
 
 	// make sure memory actually got zero'd out
 	for(i=0;i<40;i++){
-		if(shared_mem_32bit_ptr[0]==0){
-			init_flag=1;
-			return 0;
-		}
+		if(shared_mem_32bit_ptr[0]==0) return 0;
 		rc_usleep(100000);
 	}
 
 	fprintf(stderr, "ERROR in rc_servo_init, %s failed to load\n", SERVO_PRU_FW);
 	fprintf(stderr, "attempting to stop PRU1\n");
 	rc_pru_stop(SERVO_PRU_CH);
-	init_flag=0;
 	return -1;
 }
 
 
-void rc_servo_cleanup(void)
+static void __hw_stop(void)
 {
 	int i;
 	// zero out shared memory
 	if(shared_mem_32bit_ptr != NULL){
 		for(i=0;i<RC_SERVO_CH_MAX;i++) shared_mem_32bit_ptr[i]=0;
 	}
+	rc_pru_stop(SERVO_PRU_CH);
+	shared_mem_32bit_ptr = NULL;
+	return;
+}
+
+
+static int __hw_send_pulse_us(int ch, int us)
+{
+	int i, ret;
+	uint32_t num_loops;
+
+	// calculate what to write to pru shared memory to set pulse width
+	num_loops = ((us*200.0)/PRU_SERVO_LOOP_INSTRUCTIONS);
+
+	// for single channel requests, write once
+	if(ch!=0){
+		// first check to make sure no pulse is currently being sent
+		if(shared_mem_32bit_ptr[ch-1] != 0){
+			fprintf(stderr,"ERROR: in rc_servo_send_pulse_us, tried to start a new pulse amidst another\n");
+			fprintf(stderr,"PRU may need more time to start up before sending pulses\n");;
+			return -1;
+		}
+		// write to PRU shared memory
+		shared_mem_32bit_ptr[ch-1] = num_loops;
+		return 0;
+	}
+
+	// if all channels are requested, loop through them
+	ret=0;
+	for(i=RC_SERVO_CH_MIN;i<=RC_SERVO_CH_MAX;i++){
+		// first check to make sure no pulse is currently being sent
+		if(shared_mem_32bit_ptr[i-1] != 0){
+			fprintf(stderr,"ERROR: in rc_servo_send_pulse_us, tried to start a new pulse amidst another on channel %d\n", i);
+			fprintf(stderr,"current val:%d\n", shared_mem_32bit_ptr[i-1]);
+			fprintf(stderr,"this either means you are sending pulses too fast, or the PRU binary didn't load properly\n");
+			ret = -1;
+			continue;
+		}
+		// write to PRU shared memory
+		shared_mem_32bit_ptr[i-1] = num_loops;
+	}
+	return ret;
+}
+
+
+static const rc_servo_ops_t hw_ops = {
+	.start		= __hw_start,
+	.stop		= __hw_stop,
+	.send_pulse_us	= __hw_send_pulse_us,
+};
+
+
+int rc_servo_init(void)
+{
+	init_flag=0;
+	ops = __sim_pick_ops(&hw_ops, &__sim_servo_ops);
+	if(ops==NULL) return -1;
+	// start gpio power rail pin
+	if(rc_gpio_init(GPIO_POWER_PIN, GPIOHANDLE_REQUEST_OUTPUT)==-1){
+		fprintf(stderr, "ERROR in rc_servo_init, failed to set up power rail GPIO pin\n");
+		return -1;
+	}
+	if(ops->start()) return -1;
+	init_flag=1;
+	return 0;
+}
+
+
+void rc_servo_cleanup(void)
+{
 	if(init_flag!=0){
 		rc_gpio_set_value(GPIO_POWER_PIN,0);
 		rc_gpio_cleanup(GPIO_POWER_PIN);
 	}
-	rc_pru_stop(SERVO_PRU_CH);
-	shared_mem_32bit_ptr = NULL;
+	// the PRU is stopped even if init failed part way
+	if(ops==NULL) ops = &hw_ops;
+	ops->stop();
 	init_flag=0;
 	return;
 }
@@ -121,8 +186,6 @@ int rc_servo_set_esc_range(int min, int max)
 
 int rc_servo_send_pulse_us(int ch, int us)
 {
-	int i, ret;
-	uint32_t num_loops;
 	// Sanity Checks
 	if(ch<0 || ch>RC_SERVO_CH_MAX){
 		fprintf(stderr,"ERROR: in rc_servo_send_pulse_us, channel argument must be between 0&%d\n", RC_SERVO_CH_MAX);
@@ -132,39 +195,7 @@ int rc_servo_send_pulse_us(int ch, int us)
 		fprintf(stderr,"ERROR: in rc_servo_send_pulse_us, call rc_servo_init first\n");
 		return -1;
 	}
-
-
-	// calculate what to write to pru shared memory to set pulse width
-	num_loops = ((us*200.0)/PRU_SERVO_LOOP_INSTRUCTIONS);
-
-	// for single channel requests, write once
-	if(ch!=0){
-		// first check to make sure no pulse is currently being sent
-		if(shared_mem_32bit_ptr[ch-1] != 0){
-			fprintf(stderr,"ERROR: in rc_servo_send_pulse_us, tried to start a new pulse amidst another\n");
-			fprintf(stderr,"PRU may need more time to start up before sending pulses\n");;
-			return -1;
-		}
-		// write to PRU shared memory
-		shared_mem_32bit_ptr[ch-1] = num_loops;
-		return 0;
-	}
-
-	// if all channels are requested, loop through them
-	ret=0;
-	for(i=RC_SERVO_CH_MIN;i<=RC_SERVO_CH_MAX;i++){
-		// first check to make sure no pulse is currently being sent
-		if(shared_mem_32bit_ptr[i-1] != 0){
-			fprintf(stderr,"ERROR: in rc_servo_send_pulse_us, tried to start a new pulse amidst another on channel %d\n", i);
-			fprintf(stderr,"current val:%d\n", shared_mem_32bit_ptr[i-1]);
-			fprintf(stderr,"this either means you are sending pulses too fast, or the PRU binary didn't load properly\n");
-			ret = -1;
-			continue;
-		}
-		// write to PRU shared memory
-		shared_mem_32bit_ptr[i-1] = num_loops;
-	}
-	return ret;
+	return ops->send_pulse_us(ch, us);
 }
 
 
@@ -0,0 +1,363 @@
+/**
+ * @file rc_input.c
+ *
+ * @brief      SBUS and CRSF byte stream decoders
+ *
+ * Both are decoded one byte at a time into a buffer holding the frame being
+ * received. After each byte the buffer is checked as far as it goes, and as
+ * soon as it can't be the start of a valid frame its first byte is dropped and
+ * the rest checked again. A corrupted frame therefore never costs more than
+ * its own bytes, framing picks up again at the next valid header inside it.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <rc/rc_input.h>
+
+// preposessor macros
+#define unlikely(x)	__builtin_expect (!!(x), 0)
+
+// SBUS frame: header, 22 bytes of channels, flags, footer
+#define SBUS_FRAME		25
+#define SBUS_HEADER		0x0F
+#define SBUS_FLAGS		23
+#define SBUS_FLAG_LOST		0x04
+#define SBUS_FLAG_FAILSAFE	0x08
+#define SBUS_BYTE_NS		120000	// 12 bits at 100000 baud
+#define SBUS_GAP_NS		2000000	// slack beyond the bytes' own time that means a quiet line
+
+// CRSF frame: address, length of what follows, type, payload, crc
+#define CRSF_ADDR_FC		0xC8
+#define CRSF_ADDR_HANDSET	0xEA
+#define CRSF_ADDR_RX		0xEC
+#define CRSF_ADDR_TX		0xEE
+#define CRSF_MIN_LEN		2	// type and crc
+#define CRSF_MAX_LEN		(RC_INPUT_MAX_FRAME-2)
+#define CRSF_TYPE_LINK_STATS	0x14
+#define CRSF_TYPE_CHANNELS	0x16
+#define CRSF_LINK_STATS_LEN	10
+#define CRSF_CHANNELS_LEN	22
+#define CRC8_POLY_DVB_S2	0xD5
+
+// both send 16 channels of 11 bits, 172 to 1811 is 988us to 2012us
+#define PACKED_CHANNELS		16
+#define PACKED_LEN		22
+#define TICKS_CENTER		992
+#define US_CENTER		1500
+
+static const int crsf_power_mw[] = {0, 10, 25, 100, 500, 1000, 2000, 250, 50};
+#define CRSF_POWER_LEVELS	((int)(sizeof(crsf_power_mw)/sizeof(crsf_power_mw[0])))
+
+
+/**
+ * divides rounding to nearest, halves away from zero
+ */
+static int __div_round(int num, int den)
+{
+	if(num<0) return -((-num+den/2)/den);
+	return (num+den/2)/den;
+}
+
+
+static int __ticks_to_us(int ticks)
+{
+	return US_CENTER + __div_round((ticks-TICKS_CENTER)*5, 8);
+}
+
+
+static int __us_to_ticks(int us)
+{
+	int ticks = TICKS_CENTER + __div_round((us-US_CENTER)*8, 5);
+	if(ticks<0) return 0;
+	if(ticks>0x7FF) return 0x7FF;
+	return ticks;
+}
+
+
+/**
+ * unpacks 16 little endian 11 bit channels
+ */
+static void __unpack(const uint8_t* in, rc_input_channels_t* ch)
+{
+	uint32_t bits = 0;
+	int i, nbits = 0, n = 0;
+	for(i=0;i<PACKED_LEN;i++){
+		bits |= (uint32_t)in[i] << nbits;
+		nbits += 8;
+		while(nbits>=11 && n<PACKED_CHANNELS){
+			ch->raw[n++] = __ticks_to_us(bits & 0x7FF);
+			bits >>= 11;
+			nbits -= 11;
+		}
+	}
+	ch->channels = PACKED_CHANNELS;
+	return;
+}
+
+
+static void __pack(uint8_t* out, const int* raw, int channels)
+{
+	uint32_t bits = 0;
+	int i, nbits = 0, n = 0;
+	for(i=0;i<PACKED_CHANNELS;i++){
+		bits |= (uint32_t)__us_to_ticks(i<channels ? raw[i] : US_CENTER) << nbits;
+		nbits += 11;
+		while(nbits>=8){
+			out[n++] = bits & 0xFF;
+			bits >>= 8;
+			nbits -= 8;
+		}
+	}
+	return;
+}
+
+
+static uint8_t __crc8(const uint8_t* data, size_t len)
+{
+	size_t i;
+	int j;
+	uint8_t crc = 0;
+	for(i=0;i<len;i++){
+		crc ^= data[i];
+		for(j=0;j<8;j++){
+			if(crc&0x80) crc = (crc<<1) ^ CRC8_POLY_DVB_S2;
+			else crc <<= 1;
+		}
+	}
+	return crc;
+}
+
+
+/**
+ * checks the SBUS frame in the buffer so far
+ *
+ * @return     1 if a frame was completed, 0 if more bytes are needed, -1 if the
+ * buffer can't start with a frame
+ */
+static int __check_sbus(rc_input_decoder_t* dec, uint64_t rx_ns)
+{
+	rc_input_channels_t ch;
+	uint8_t flags, footer;
+
+	if(dec->buf[0]!=SBUS_HEADER) return -1;
+	if(dec->len<SBUS_FRAME) return 0;
+
+	// footer is 0 for SBUS, SBUS2 cycles its upper nibble
+	flags = dec->buf[SBUS_FLAGS];
+	footer = dec->buf[SBUS_FRAME-1];
+	if((flags&0xF0) || (footer!=0x00 && (footer&0x0F)!=0x04)){
+		dec->stats.errors++;
+		return -1;
+	}
+
+	memset(&ch, 0, sizeof(ch));
+	__unpack(dec->buf+1, &ch);
+	ch.frame_lost = (flags&SBUS_FLAG_LOST) ? 1 : 0;
+	ch.failsafe = (flags&SBUS_FLAG_FAILSAFE) ? 1 : 0;
+	ch.timestamp_ns = rx_ns;
+	dec->stats.frames++;
+	dec->len = 0;
+	if(dec->channels_callback) dec->channels_callback(&ch, dec->ctx);
+	return 1;
+}
+
+
+static void __crsf_link_stats(rc_input_decoder_t* dec, const uint8_t* p, uint64_t rx_ns)
+{
+	rc_input_link_stats_t s;
+	s.uplink_rssi_1 = -(int)p[0];
+	s.uplink_rssi_2 = -(int)p[1];
+	s.uplink_link_quality = p[2];
+	s.uplink_snr = (int8_t)p[3];
+	s.active_antenna = p[4];
+	s.rf_mode = p[5];
+	s.uplink_tx_power_mw = p[6]<CRSF_POWER_LEVELS ? crsf_power_mw[p[6]] : 0;
+	s.downlink_rssi = -(int)p[7];
+	s.downlink_link_quality = p[8];
+	s.downlink_snr = (int8_t)p[9];
+	s.timestamp_ns = rx_ns;
+	if(dec->link_stats_callback) dec->link_stats_callback(&s, dec->ctx);
+	return;
+}
+
+
+/**
+ * checks the CRSF frame in the buffer so far, same returns as __check_sbus()
+ */
+static int __check_crsf(rc_input_decoder_t* dec, uint64_t rx_ns)
+{
+	rc_input_channels_t ch;
+	uint8_t addr = dec->buf[0];
+	size_t total;
+	const uint8_t* payload;
+
+	if(addr!=CRSF_ADDR_FC && addr!=CRSF_ADDR_HANDSET && addr!=CRSF_ADDR_RX && addr!=CRSF_ADDR_TX){
+		return -1;
+	}
+	if(dec->len<2) return 0;
+	if(dec->buf[1]<CRSF_MIN_LEN || dec->buf[1]>CRSF_MAX_LEN) return -1;
+	total = dec->buf[1]+2;
+	if(dec->len<total) return 0;
+
+	// crc covers the type and payload
+	if(__crc8(dec->buf+2, total-3)!=dec->buf[total-1]){
+		dec->stats.errors++;
+		return -1;
+	}
+
+	dec->stats.frames++;
+	dec->len = 0;
+	payload = dec->buf+3;
+	switch(dec->buf[2]){
+	case CRSF_TYPE_CHANNELS:
+		if(total-4!=CRSF_CHANNELS_LEN) break;
+		memset(&ch, 0, sizeof(ch));
+		__unpack(payload, &ch);
+		ch.timestamp_ns = rx_ns;
+		if(dec->channels_callback) dec->channels_callback(&ch, dec->ctx);
+		break;
+	case CRSF_TYPE_LINK_STATS:
+		if(total-4!=CRSF_LINK_STATS_LEN) break;
+		__crsf_link_stats(dec, payload, rx_ns);
+		break;
+	default:
+		// telemetry for other devices on the bus
+		break;
+	}
+	return 1;
+}
+
+
+int rc_input_decoder_init(rc_input_decoder_t* dec, rc_input_protocol_t protocol)
+{
+	if(unlikely(dec==NULL)){
+		fprintf(stderr,"ERROR in rc_input_decoder_init, received NULL pointer\n");
+		return -1;
+	}
+	if(protocol!=RC_INPUT_SBUS && protocol!=RC_INPUT_CRSF){
+		fprintf(stderr,"ERROR in rc_input_decoder_init, protocol must be RC_INPUT_SBUS or RC_INPUT_CRSF\n");
+		return -1;
+	}
+	memset(dec, 0, sizeof(rc_input_decoder_t));
+	dec->protocol = protocol;
+	return 0;
+}
+
+
+int rc_input_decoder_feed(rc_input_decoder_t* dec, const uint8_t* data, size_t len, uint64_t rx_ns)
+{
+	size_t i;
+	int ret, frames = 0;
+
+	if(unlikely(dec==NULL || (data==NULL && len))){
+		fprintf(stderr,"ERROR in rc_input_decoder_feed, received NULL pointer\n");
+		return -1;
+	}
+
+	// SBUS receivers go quiet between frames, bytes that took much longer
+	// to arrive than they need mean the frame under way lost its end
+	if(dec->protocol==RC_INPUT_SBUS && dec->len && rx_ns && dec->last_ns &&
+			rx_ns-dec->last_ns > len*SBUS_BYTE_NS+SBUS_GAP_NS){
+		dec->stats.errors++;
+		dec->stats.skipped += dec->len;
+		dec->len = 0;
+	}
+	if(rx_ns) dec->last_ns = rx_ns;
+
+	for(i=0;i<len;i++){
+		dec->buf[dec->len++] = data[i];
+		do{
+			if(dec->protocol==RC_INPUT_SBUS) ret = __check_sbus(dec, rx_ns);
+			else ret = __check_crsf(dec, rx_ns);
+			if(ret==1) frames++;
+			else if(ret==-1){
+				// not a frame from here, try from the next byte
+				dec->len--;
+				memmove(dec->buf, dec->buf+1, dec->len);
+				dec->stats.skipped++;
+			}
+		}while(ret==-1 && dec->len);
+	}
+	return frames;
+}
+
+
+size_t rc_input_decoder_wanted(const rc_input_decoder_t* dec)
+{
+	if(dec->protocol==RC_INPUT_SBUS){
+		if(dec->len==0) return 1;
+		return SBUS_FRAME-dec->len;
+	}
+	if(dec->len<2) return 2-dec->len;
+	return dec->buf[1]+2-dec->len;
+}
+
+
+int rc_input_sbus_encode(uint8_t* frame, const int* raw, int channels, int failsafe)
+{
+	if(unlikely(frame==NULL || (raw==NULL && channels))){
+		fprintf(stderr,"ERROR in rc_input_sbus_encode, received NULL pointer\n");
+		return -1;
+	}
+	if(channels<0 || channels>PACKED_CHANNELS){
+		fprintf(stderr,"ERROR in rc_input_sbus_encode, channels must be between 0 and %d\n", PACKED_CHANNELS);
+		return -1;
+	}
+	frame[0] = SBUS_HEADER;
+	__pack(frame+1, raw, channels);
+	frame[SBUS_FLAGS] = failsafe ? SBUS_FLAG_FAILSAFE : 0;
+	frame[SBUS_FRAME-1] = 0x00;
+	return SBUS_FRAME;
+}
+
+
+int rc_input_crsf_encode_channels(uint8_t* frame, const int* raw, int channels)
+{
+	if(unlikely(frame==NULL || (raw==NULL && channels))){
+		fprintf(stderr,"ERROR in rc_input_crsf_encode_channels, received NULL pointer\n");
+		return -1;
+	}
+	if(channels<0 || channels>PACKED_CHANNELS){
+		fprintf(stderr,"ERROR in rc_input_crsf_encode_channels, channels must be between 0 and %d\n", PACKED_CHANNELS);
+		return -1;
+	}
+	frame[0] = CRSF_ADDR_FC;
+	frame[1] = CRSF_CHANNELS_LEN+2;
+	frame[2] = CRSF_TYPE_CHANNELS;
+	__pack(frame+3, raw, channels);
+	frame[CRSF_CHANNELS_LEN+3] = __crc8(frame+2, CRSF_CHANNELS_LEN+1);
+	return CRSF_CHANNELS_LEN+4;
+}
+
+
+int rc_input_crsf_encode_link_stats(uint8_t* frame, const rc_input_link_stats_t* s)
+{
+	int i, power = 0;
+
+	if(unlikely(frame==NULL || s==NULL)){
+		fprintf(stderr,"ERROR in rc_input_crsf_encode_link_stats, received NULL pointer\n");
+		return -1;
+	}
+	for(i=0;i<CRSF_POWER_LEVELS;i++){
+		if(crsf_power_mw[i]==s->uplink_tx_power_mw) power = i;
+	}
+	frame[0] = CRSF_ADDR_FC;
+	frame[1] = CRSF_LINK_STATS_LEN+2;
+	frame[2] = CRSF_TYPE_LINK_STATS;
+	frame[3] = -s->uplink_rssi_1;
+	frame[4] = -s->uplink_rssi_2;
+	frame[5] = s->uplink_link_quality;
+	frame[6] = (uint8_t)(int8_t)s->uplink_snr;
+	frame[7] = s->active_antenna;
+	frame[8] = s->rf_mode;
+	frame[9] = power;
+	frame[10] = -s->downlink_rssi;
+	frame[11] = s->downlink_link_quality;
+	frame[12] = (uint8_t)(int8_t)s->downlink_snr;
+	frame[CRSF_LINK_STATS_LEN+3] = __crc8(frame+2, CRSF_LINK_STATS_LEN+1);
+	return CRSF_LINK_STATS_LEN+4;
+}
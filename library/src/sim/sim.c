@@ -0,0 +1,1043 @@
+/**
+ * @file sim.c
+ *
+ * @brief      Core of the simulated hardware backend: the device tables the io
+ *             drivers route to, gpio lines, pwm sinks and pseudo terminal
+ *             uarts.
+ *
+ * The device models live in sim_mpu.c, sim_bmp.c and sim_dsm.c and use the
+ * same public functions a user's own models would.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#define _GNU_SOURCE // for ptsname_r and pipe2
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+
+#ifdef RC_AUTOPILOT_EXT
+#include "/usr/include/linux/gpio.h"
+#else
+#include <linux/gpio.h>
+#endif
+
+#include <rc/i2c.h>
+#include <rc/time.h>
+#include <rc/servo.h>
+#include <rc/sim.h>
+#include "sim_common.h"
+
+// preposessor macros
+#define unlikely(x)	__builtin_expect (!!(x), 0)
+#define likely(x)	__builtin_expect (!!(x), 1)
+
+#define I2C_BUSSES	(I2C_MAX_BUS+1)
+#define I2C_DEVICES	8	// per bus
+#define SPI_BUSSES	6	// same limits as spi.c
+#define SPI_SLAVES	12
+#define GPIO_CHIPS	6	// same limits as gpio.c
+#define GPIO_LINES	GPIOHANDLES_MAX
+#define UART_BUSSES	17	// same limit as uart.c
+#define PWM_SUBSYSTEMS	3
+#define ENCODERS	4	// 3 eQEP and 1 PRU
+
+// default BeagleBone Blue devices
+#define BLUE_IMU_BUS		2
+#define BLUE_IMU_ADDR		0x68
+#define BLUE_IMU_INT_CHIP	3	// gpio3.21
+#define BLUE_IMU_INT_PIN	21
+#define BLUE_BMP_ADDR		0x76
+#define BLUE_DSM_UART		4
+
+
+typedef struct sim_i2c_dev_t{
+	int used;
+	uint8_t addr;
+	rc_sim_i2c_write_func_t write;
+	rc_sim_i2c_read_func_t read;
+	void* ctx;
+} sim_i2c_dev_t;
+
+typedef struct sim_spi_dev_t{
+	rc_sim_spi_transfer_func_t transfer;
+	void* ctx;
+} sim_spi_dev_t;
+
+typedef struct sim_line_t{
+	int value;
+	int event_flags;	///< GPIOEVENT_REQUEST_* flags, 0 if no events requested
+	int event_fd;		///< write end of the event pipe, 0 if none
+	uint64_t polls;		///< times the program started waiting for an event
+} sim_line_t;
+
+static int enabled = -1; // -1 until RC_SIM has been checked
+static int env_failed = 0; // 1 if RC_SIM asked for the simulation and it failed
+static int attached = 0; // default devices attached so far by rc_sim_enable
+static pthread_mutex_t enable_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER; // protects everything below
+static pthread_cond_t poll_cond = PTHREAD_COND_INITIALIZER; // broadcast when a line is polled
+static sim_i2c_dev_t i2c_dev[I2C_BUSSES][I2C_DEVICES];
+static sim_spi_dev_t spi_dev[SPI_BUSSES][SPI_SLAVES];
+static sim_line_t line[GPIO_CHIPS][GPIO_LINES];
+static unsigned int pwm_duty_ns[PWM_SUBSYSTEMS][2];
+static unsigned int pwm_period_ns[PWM_SUBSYSTEMS];
+static int uart_master_fd[UART_BUSSES];
+static int encoder_pos[ENCODERS];
+static int servo_us[RC_SERVO_CH_MAX];
+static double time_scale = 1.0;
+static uint64_t sim_base_ns;	// simulated time at wall_base_ns
+static uint64_t wall_base_ns;	// rc_nanos_since_boot() when the scale last changed
+
+
+static int __check_line(int chip, int pin)
+{
+	if(unlikely(chip<0 || chip>=GPIO_CHIPS || pin<0 || pin>=GPIO_LINES)){
+		fprintf(stderr,"ERROR in rc_sim, gpio chip %d pin %d out of bounds\n", chip, pin);
+		return -1;
+	}
+	return 0;
+}
+
+
+static int __check_uart(int bus)
+{
+	if(unlikely(bus<0 || bus>=UART_BUSSES)){
+		fprintf(stderr,"ERROR in rc_sim, uart bus must be between 0 & %d\n", UART_BUSSES-1);
+		return -1;
+	}
+	return 0;
+}
+
+
+/**
+ * opens the pseudo terminal master for a uart if it isn't already, call with
+ * the mutex held
+ */
+static int __open_uart(int bus)
+{
+	int fd;
+	if(uart_master_fd[bus]) return 0;
+	fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if(fd==-1){
+		perror("ERROR in rc_sim, failed to open pseudo terminal");
+		return -1;
+	}
+	if(grantpt(fd) || unlockpt(fd)){
+		perror("ERROR in rc_sim, failed to unlock pseudo terminal");
+		close(fd);
+		return -1;
+	}
+	uart_master_fd[bus] = fd;
+	return 0;
+}
+
+
+int rc_sim_enable(void)
+{
+	pthread_mutex_lock(&enable_mutex);
+	if(enabled==1){
+		pthread_mutex_unlock(&enable_mutex);
+		return 0;
+	}
+	// drivers only switch over once every device is in place, a retry after
+	// a failure carries on from the device that failed
+	if(attached==0){
+		if(__sim_mpu_attach(BLUE_IMU_BUS, BLUE_IMU_ADDR, BLUE_IMU_INT_CHIP, BLUE_IMU_INT_PIN)) goto fail;
+		attached++;
+	}
+	if(attached==1){
+		if(__sim_bmp_attach(BLUE_IMU_BUS, BLUE_BMP_ADDR)) goto fail;
+		attached++;
+	}
+	if(attached==2){
+		if(__sim_dsm_attach(BLUE_DSM_UART)) goto fail;
+		attached++;
+	}
+	enabled = 1;
+	env_failed = 0;
+	pthread_mutex_unlock(&enable_mutex);
+	return 0;
+
+fail:
+	pthread_mutex_unlock(&enable_mutex);
+	fprintf(stderr,"ERROR in rc_sim_enable, failed to attach the default devices\n");
+	return -1;
+}
+
+
+int rc_sim_is_enabled(void)
+{
+	const char* env;
+	if(likely(enabled>=0)) return enabled;
+	if(env_failed) return -1;
+	env = getenv("RC_SIM");
+	if(env==NULL || strcmp(env, "0")==0){
+		enabled = 0;
+		return 0;
+	}
+	if(rc_sim_enable()){
+		fprintf(stderr,"ERROR in rc_sim_is_enabled, failed to enable simulation from RC_SIM\n");
+		env_failed = 1;
+		return -1;
+	}
+	return 1;
+}
+
+
+const void* __sim_pick_ops(const void* hw, const void* sim)
+{
+	switch(rc_sim_is_enabled()){
+	case 0:
+		return hw;
+	case 1:
+		return sim;
+	default:
+		fprintf(stderr,"ERROR: RC_SIM is set but the simulation could not be enabled\n");
+		return NULL;
+	}
+}
+
+
+int rc_sim_i2c_attach(int bus, uint8_t addr, rc_sim_i2c_write_func_t write, rc_sim_i2c_read_func_t read, void* ctx)
+{
+	int i, slot = -1;
+	if(bus<0 || bus>=I2C_BUSSES){
+		fprintf(stderr,"ERROR in rc_sim_i2c_attach, bus must be between 0 & %d\n", I2C_BUSSES-1);
+		return -1;
+	}
+	if(write==NULL || read==NULL){
+		fprintf(stderr,"ERROR in rc_sim_i2c_attach, received NULL pointer\n");
+		return -1;
+	}
+	pthread_mutex_lock(&mutex);
+	for(i=0;i<I2C_DEVICES;i++){
+		if(i2c_dev[bus][i].used && i2c_dev[bus][i].addr==addr){
+			pthread_mutex_unlock(&mutex);
+			fprintf(stderr,"ERROR in rc_sim_i2c_attach, address 0x%02x already in use on bus %d\n", addr, bus);
+			return -1;
+		}
+		if(!i2c_dev[bus][i].used && slot<0) slot = i;
+	}
+	if(slot<0){
+		pthread_mutex_unlock(&mutex);
+		fprintf(stderr,"ERROR in rc_sim_i2c_attach, no more than %d devices per bus\n", I2C_DEVICES);
+		return -1;
+	}
+	i2c_dev[bus][slot].addr = addr;
+	i2c_dev[bus][slot].write = write;
+	i2c_dev[bus][slot].read = read;
+	i2c_dev[bus][slot].ctx = ctx;
+	i2c_dev[bus][slot].used = 1;
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+
+int rc_sim_i2c_detach(int bus, uint8_t addr)
+{
+	int i;
+	if(bus<0 || bus>=I2C_BUSSES){
+		fprintf(stderr,"ERROR in rc_sim_i2c_detach, bus must be between 0 & %d\n", I2C_BUSSES-1);
+		return -1;
+	}
+	pthread_mutex_lock(&mutex);
+	for(i=0;i<I2C_DEVICES;i++){
+		if(i2c_dev[bus][i].used && i2c_dev[bus][i].addr==addr){
+			i2c_dev[bus][i].used = 0;
+			pthread_mutex_unlock(&mutex);
+			return 0;
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+	fprintf(stderr,"ERROR in rc_sim_i2c_detach, nothing attached at 0x%02x on bus %d\n", addr, bus);
+	return -1;
+}
+
+
+static int __i2c_transfer(int bus, uint8_t addr, int is_read, uint8_t* data, size_t len)
+{
+	int i;
+	sim_i2c_dev_t dev;
+	if(unlikely(bus<0 || bus>=I2C_BUSSES)) return -1;
+	// copy the entry out so the callback runs without the mutex
+	dev.used = 0;
+	pthread_mutex_lock(&mutex);
+	for(i=0;i<I2C_DEVICES;i++){
+		if(i2c_dev[bus][i].used && i2c_dev[bus][i].addr==addr){
+			dev = i2c_dev[bus][i];
+			break;
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+	if(!dev.used){
+		errno = ENXIO;
+		return -1;
+	}
+	if(is_read) return dev.read(dev.ctx, data, len);
+	return dev.write(dev.ctx, data, len);
+}
+
+
+/**
+ * every simulated device lives in this process so there is nothing to share
+ * with other processes, the descriptor only has to exist for rc_i2c_get_fd
+ */
+static int __i2c_open(__attribute__ ((unused)) int bus)
+{
+	int fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+	if(fd==-1) perror("ERROR in rc_sim, failed to open /dev/null");
+	return fd;
+}
+
+
+// each transfer carries the slave address so there is nothing to select
+static int __i2c_set_slave(__attribute__ ((unused)) int fd, __attribute__ ((unused)) uint8_t addr)
+{
+	return 0;
+}
+
+
+static int __i2c_rdwr(int bus, __attribute__ ((unused)) int fd, struct i2c_msg* msgs, int nmsgs)
+{
+	int i;
+	for(i=0;i<nmsgs;i++){
+		if(__i2c_transfer(bus, msgs[i].addr, msgs[i].flags&I2C_M_RD,
+					msgs[i].buf, msgs[i].len)) return -1;
+	}
+	return 0;
+}
+
+
+static int __i2c_write(int bus, __attribute__ ((unused)) int fd, uint8_t addr, uint8_t* data, size_t count)
+{
+	if(__i2c_transfer(bus, addr, 0, data, count)) return -1;
+	return count;
+}
+
+
+const rc_i2c_ops_t __sim_i2c_ops = {
+	.shared		= 0,
+	.open		= __i2c_open,
+	.set_slave	= __i2c_set_slave,
+	.rdwr		= __i2c_rdwr,
+	.write		= __i2c_write,
+};
+
+
+int rc_sim_spi_attach(int bus, int slave, rc_sim_spi_transfer_func_t transfer, void* ctx)
+{
+	if(bus<0 || bus>=SPI_BUSSES || slave<0 || slave>=SPI_SLAVES){
+		fprintf(stderr,"ERROR in rc_sim_spi_attach, bus or slave out of bounds\n");
+		return -1;
+	}
+	if(transfer==NULL){
+		fprintf(stderr,"ERROR in rc_sim_spi_attach, received NULL pointer\n");
+		return -1;
+	}
+	pthread_mutex_lock(&mutex);
+	spi_dev[bus][slave].transfer = transfer;
+	spi_dev[bus][slave].ctx = ctx;
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+
+int rc_sim_spi_detach(int bus, int slave)
+{
+	if(bus<0 || bus>=SPI_BUSSES || slave<0 || slave>=SPI_SLAVES){
+		fprintf(stderr,"ERROR in rc_sim_spi_detach, bus or slave out of bounds\n");
+		return -1;
+	}
+	pthread_mutex_lock(&mutex);
+	spi_dev[bus][slave].transfer = NULL;
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+
+static int __spi_transfer(int bus, int slave, const uint8_t* tx, uint8_t* rx, size_t len)
+{
+	sim_spi_dev_t dev;
+	if(unlikely(bus<0 || bus>=SPI_BUSSES || slave<0 || slave>=SPI_SLAVES)) return -1;
+	pthread_mutex_lock(&mutex);
+	dev = spi_dev[bus][slave];
+	pthread_mutex_unlock(&mutex);
+	// nothing attached reads back as a floating MISO line
+	if(dev.transfer==NULL){
+		if(rx!=NULL) memset(rx, 0xFF, len);
+		return 0;
+	}
+	return dev.transfer(dev.ctx, tx, rx, len);
+}
+
+
+// a descriptor so rc_spi_get_fd and close work
+static int __spi_open(__attribute__ ((unused)) int bus, __attribute__ ((unused)) int slave)
+{
+	int fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+	if(fd==-1) perror("ERROR in rc_sim, failed to open /dev/null");
+	return fd;
+}
+
+
+// nothing to configure on a simulated bus
+static int __spi_config(__attribute__ ((unused)) int fd, __attribute__ ((unused)) unsigned long request, __attribute__ ((unused)) void* arg)
+{
+	return 0;
+}
+
+
+// hands a simulated device transfers first through last as one, the way the
+// chip sees a run of transfers it stays selected for
+static int __spi_run(int bus, int slave, struct spi_ioc_transfer* xfer, int first, int last)
+{
+	int i, ret;
+	size_t len, pos;
+	uint8_t *tx, *rx;
+
+	len = 0;
+	for(i=first;i<=last;i++) len += xfer[i].len;
+	tx = calloc(len, 1);
+	rx = malloc(len);
+	if(tx==NULL || rx==NULL){
+		free(tx);
+		free(rx);
+		errno = ENOMEM;
+		return -1;
+	}
+	for(i=first,pos=0;i<=last;pos+=xfer[i].len,i++){
+		if(xfer[i].tx_buf) memcpy(tx+pos, (const void*)(uintptr_t)xfer[i].tx_buf, xfer[i].len);
+	}
+	ret = __spi_transfer(bus, slave, tx, rx, len);
+	for(i=first,pos=0;ret==0 && i<=last;pos+=xfer[i].len,i++){
+		if(xfer[i].rx_buf) memcpy((void*)(uintptr_t)xfer[i].rx_buf, rx+pos, xfer[i].len);
+	}
+	free(tx);
+	free(rx);
+	if(ret){
+		errno = EIO;
+		return -1;
+	}
+	return len;
+}
+
+
+static int __spi_message(int bus, int slave, __attribute__ ((unused)) int fd, struct spi_ioc_transfer* xfer, int n)
+{
+	int i, first, ret, total;
+	// a single transfer goes straight through without copying
+	if(n==1){
+		if(__spi_transfer(bus, slave, (const uint8_t*)(uintptr_t)xfer->tx_buf,
+				(uint8_t*)(uintptr_t)xfer->rx_buf, xfer->len)) return -1;
+		return xfer->len;
+	}
+	total = 0;
+	first = 0;
+	for(i=0;i<n;i++){
+		if(i<n-1 && xfer[i].cs_change==0) continue;
+		ret = __spi_run(bus, slave, xfer, first, i);
+		if(ret==-1) return -1;
+		total += ret;
+		first = i+1;
+	}
+	return total;
+}
+
+
+const rc_spi_ops_t __sim_spi_ops = {
+	.open		= __spi_open,
+	.config		= __spi_config,
+	.message	= __spi_message,
+};
+
+
+/**
+ * changes the level of a line and queues an event if one was requested for
+ * that edge, call with the mutex held
+ */
+static void __set_line(int chip, int pin, int value)
+{
+	struct gpioevent_data event;
+	sim_line_t* l = &line[chip][pin];
+	value = value ? 1 : 0;
+	if(value==l->value) return;
+	l->value = value;
+	if(l->event_fd==0) return;
+	if(value && !(l->event_flags&GPIOEVENT_REQUEST_RISING_EDGE)) return;
+	if(!value && !(l->event_flags&GPIOEVENT_REQUEST_FALLING_EDGE)) return;
+	// the BeagleBone kernels stamp events with the realtime clock, rc_mpu
+	// relies on that in rc_mpu_nanos_since_last_dmp_interrupt()
+	event.timestamp = rc_nanos_since_epoch();
+	event.id = value ? GPIOEVENT_EVENT_RISING_EDGE : GPIOEVENT_EVENT_FALLING_EDGE;
+	// the pipe is non-blocking, if nobody is reading the event is dropped
+	// just like the kernel does when its queue is full
+	if(write(l->event_fd, &event, sizeof(event))<0 && errno!=EAGAIN){
+		perror("WARNING in rc_sim, failed to queue gpio event");
+	}
+	return;
+}
+
+
+static int __gpio_request(int chip, int pin, int handle_flags)
+{
+	int fd;
+	if(__check_line(chip, pin)) return -1;
+	// a real descriptor so rc_gpio_cleanup can close it like any other
+	fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+	if(fd==-1){
+		perror("ERROR in rc_sim, failed to open /dev/null");
+		return -1;
+	}
+	pthread_mutex_lock(&mutex);
+	if(handle_flags&GPIOHANDLE_REQUEST_OUTPUT) __set_line(chip, pin, 0);
+	pthread_mutex_unlock(&mutex);
+	return fd;
+}
+
+
+static int __gpio_request_event(int chip, int pin, __attribute__ ((unused)) int handle_flags, int event_flags)
+{
+	int fds[2];
+	if(__check_line(chip, pin)) return -1;
+	if(pipe2(fds, O_CLOEXEC)==-1){
+		perror("ERROR in rc_sim, failed to create gpio event pipe");
+		return -1;
+	}
+	fcntl(fds[1], F_SETFL, O_NONBLOCK);
+	pthread_mutex_lock(&mutex);
+	if(line[chip][pin].event_fd) close(line[chip][pin].event_fd);
+	line[chip][pin].event_fd = fds[1];
+	line[chip][pin].event_flags = event_flags;
+	pthread_mutex_unlock(&mutex);
+	return fds[0];
+}
+
+
+static int __gpio_set(int chip, int pin, int value)
+{
+	if(__check_line(chip, pin)) return -1;
+	pthread_mutex_lock(&mutex);
+	__set_line(chip, pin, value);
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+
+static int __gpio_get(int chip, int pin)
+{
+	int value;
+	if(__check_line(chip, pin)) return -1;
+	pthread_mutex_lock(&mutex);
+	value = line[chip][pin].value;
+	pthread_mutex_unlock(&mutex);
+	return value;
+}
+
+
+static int __gpio_set_value(int chip, int pin, __attribute__ ((unused)) int fd, int value)
+{
+	return __gpio_set(chip, pin, value);
+}
+
+
+static int __gpio_get_value(int chip, int pin, __attribute__ ((unused)) int fd)
+{
+	return __gpio_get(chip, pin);
+}
+
+
+/**
+ * counts the wait so a device model pacing itself on this line can tell the
+ * program has finished with the last event, then polls the pipe
+ */
+static int __gpio_wait_event(int chip, int pin, int fd, int timeout_ms)
+{
+	struct pollfd poll_fds[1];
+	if(__check_line(chip, pin)) return -1;
+	pthread_mutex_lock(&mutex);
+	line[chip][pin].polls++;
+	pthread_cond_broadcast(&poll_cond);
+	pthread_mutex_unlock(&mutex);
+	poll_fds[0].fd = fd;
+	poll_fds[0].events = POLLIN | POLLPRI;
+	poll_fds[0].revents = 0;
+	return poll(poll_fds, 1, timeout_ms);
+}
+
+
+static void __gpio_release(int chip, int pin)
+{
+	if(__check_line(chip, pin)) return;
+	pthread_mutex_lock(&mutex);
+	if(line[chip][pin].event_fd) close(line[chip][pin].event_fd);
+	line[chip][pin].event_fd = 0;
+	line[chip][pin].event_flags = 0;
+	pthread_mutex_unlock(&mutex);
+	return;
+}
+
+
+static int __gpio_set_lines(rc_gpio_group_t* group, uint64_t values)
+{
+	int i;
+	for(i=0;i<group->lines;i++) if(__check_line(group->chip, group->pins[i])) return -1;
+	// one lock for the lot so the plant never sees half a write
+	pthread_mutex_lock(&mutex);
+	for(i=0;i<group->lines;i++) __set_line(group->chip, group->pins[i], (values>>i)&1);
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+
+static int __gpio_get_lines(rc_gpio_group_t* group, uint64_t* values)
+{
+	int i;
+	for(i=0;i<group->lines;i++) if(__check_line(group->chip, group->pins[i])) return -1;
+	*values = 0;
+	pthread_mutex_lock(&mutex);
+	for(i=0;i<group->lines;i++) if(line[group->chip][group->pins[i]].value) *values |= 1ULL<<i;
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+
+static int __gpio_request_lines(rc_gpio_group_t* group)
+{
+	int i, fd;
+	for(i=0;i<group->lines;i++) if(__check_line(group->chip, group->pins[i])) return -1;
+	fd = open("/dev/null", O_RDWR | O_CLOEXEC);
+	if(fd==-1){
+		perror("ERROR in rc_sim, failed to open /dev/null");
+		return -1;
+	}
+	if(group->handle_flags&GPIOHANDLE_REQUEST_OUTPUT) __gpio_set_lines(group, 0);
+	return fd;
+}
+
+
+const rc_gpio_ops_t __sim_gpio_ops = {
+	.request	= __gpio_request,
+	.request_event	= __gpio_request_event,
+	.set_value	= __gpio_set_value,
+	.get_value	= __gpio_get_value,
+	.wait_event	= __gpio_wait_event,
+	.release	= __gpio_release,
+	.request_lines	= __gpio_request_lines,
+	.set_lines	= __gpio_set_lines,
+	.get_lines	= __gpio_get_lines,
+};
+
+
+uint64_t __sim_gpio_polls(int chip, int pin)
+{
+	uint64_t polls;
+	if(__check_line(chip, pin)) return 0;
+	pthread_mutex_lock(&mutex);
+	polls = line[chip][pin].polls;
+	pthread_mutex_unlock(&mutex);
+	return polls;
+}
+
+
+void __sim_gpio_wait_polled(int chip, int pin, uint64_t seen, uint64_t timeout_ns)
+{
+	struct timespec deadline;
+	uint64_t ns;
+	if(__check_line(chip, pin)) return;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	ns = (uint64_t)deadline.tv_sec*1000000000ULL + deadline.tv_nsec + timeout_ns;
+	deadline.tv_sec = ns/1000000000ULL;
+	deadline.tv_nsec = ns%1000000000ULL;
+	pthread_mutex_lock(&mutex);
+	while(line[chip][pin].polls==seen){
+		if(pthread_cond_timedwait(&poll_cond, &mutex, &deadline)) break;
+	}
+	pthread_mutex_unlock(&mutex);
+	return;
+}
+
+
+int rc_sim_gpio_set(int chip, int pin, int value)
+{
+	return __gpio_set(chip, pin, value);
+}
+
+
+int rc_sim_gpio_get(int chip, int pin)
+{
+	return __gpio_get(chip, pin);
+}
+
+
+static int __check_pwm(int ss, char ch)
+{
+	if(ss<0 || ss>=PWM_SUBSYSTEMS){
+		fprintf(stderr,"ERROR in rc_sim, pwm subsystem must be between 0 and %d\n", PWM_SUBSYSTEMS-1);
+		return -1;
+	}
+	if(ch!='A' && ch!='B'){
+		fprintf(stderr,"ERROR in rc_sim, pwm channel must be 'A' or 'B'\n");
+		return -1;
+	}
+	return 0;
+}
+
+
+static int __pwm_init(int ss, unsigned int period_ns)
+{
+	if(__check_pwm(ss, 'A')) return -1;
+	pthread_mutex_lock(&mutex);
+	pwm_duty_ns[ss][0] = 0;
+	pwm_duty_ns[ss][1] = 0;
+	pwm_period_ns[ss] = period_ns;
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+
+static int __pwm_cleanup(int ss)
+{
+	if(__check_pwm(ss, 'A')) return -1;
+	pthread_mutex_lock(&mutex);
+	pwm_duty_ns[ss][0] = 0;
+	pwm_duty_ns[ss][1] = 0;
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+
+static int __pwm_set_duty_ns(int ss, char ch, unsigned int duty_ns)
+{
+	if(__check_pwm(ss, ch)) return -1;
+	pthread_mutex_lock(&mutex);
+	pwm_duty_ns[ss][ch-'A'] = duty_ns;
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+
+const rc_pwm_ops_t __sim_pwm_ops = {
+	.init		= __pwm_init,
+	.cleanup	= __pwm_cleanup,
+	.set_duty_ns	= __pwm_set_duty_ns,
+};
+
+
+int rc_sim_pwm_get_duty_ns(int ss, char ch)
+{
+	int ret;
+	if(ss<0 || ss>=PWM_SUBSYSTEMS || (ch!='A' && ch!='B')){
+		fprintf(stderr,"ERROR in rc_sim_pwm_get_duty_ns, invalid subsystem or channel\n");
+		return -1;
+	}
+	pthread_mutex_lock(&mutex);
+	ret = pwm_duty_ns[ss][ch-'A'];
+	pthread_mutex_unlock(&mutex);
+	return ret;
+}
+
+
+double rc_sim_pwm_get_duty(int ss, char ch)
+{
+	double ret = 0.0;
+	if(ss<0 || ss>=PWM_SUBSYSTEMS || (ch!='A' && ch!='B')){
+		fprintf(stderr,"ERROR in rc_sim_pwm_get_duty, invalid subsystem or channel\n");
+		return -1.0;
+	}
+	pthread_mutex_lock(&mutex);
+	if(pwm_period_ns[ss]) ret = (double)pwm_duty_ns[ss][ch-'A']/(double)pwm_period_ns[ss];
+	pthread_mutex_unlock(&mutex);
+	return ret;
+}
+
+
+static int __uart_path(int bus, char* path, size_t len)
+{
+	int ret;
+	if(__check_uart(bus)) return -1;
+	pthread_mutex_lock(&mutex);
+	ret = __open_uart(bus);
+	if(ret==0 && ptsname_r(uart_master_fd[bus], path, len)){
+		perror("ERROR in rc_sim, failed to get pseudo terminal name");
+		ret = -1;
+	}
+	pthread_mutex_unlock(&mutex);
+	return ret;
+}
+
+
+const rc_uart_ops_t __sim_uart_ops = {
+	.path		= __uart_path,
+};
+
+
+int rc_sim_uart_send(int bus, const uint8_t* data, size_t bytes)
+{
+	int fd;
+	ssize_t ret;
+	if(__check_uart(bus)) return -1;
+	pthread_mutex_lock(&mutex);
+	if(__open_uart(bus)){
+		pthread_mutex_unlock(&mutex);
+		return -1;
+	}
+	fd = uart_master_fd[bus];
+	pthread_mutex_unlock(&mutex);
+	ret = write(fd, data, bytes);
+	// a full buffer drops bytes like an overrun on a real uart
+	if(ret==-1 && errno==EAGAIN) return 0;
+	if(ret==-1){
+		perror("ERROR in rc_sim_uart_send");
+		return -1;
+	}
+	return ret;
+}
+
+
+int rc_sim_uart_receive(int bus, uint8_t* data, size_t bytes)
+{
+	int fd;
+	ssize_t ret;
+	if(__check_uart(bus)) return -1;
+	pthread_mutex_lock(&mutex);
+	if(__open_uart(bus)){
+		pthread_mutex_unlock(&mutex);
+		return -1;
+	}
+	fd = uart_master_fd[bus];
+	pthread_mutex_unlock(&mutex);
+	ret = read(fd, data, bytes);
+	// EIO means the library hasn't opened its end yet
+	if(ret==-1 && (errno==EAGAIN || errno==EIO)) return 0;
+	if(ret==-1){
+		perror("ERROR in rc_sim_uart_receive");
+		return -1;
+	}
+	return ret;
+}
+
+
+/**
+ * simulated time, follows the wall clock times the scale and in lockstep only
+ * moves when the mpu sample clock calls __sim_advance(). Caller holds mutex.
+ */
+static uint64_t __sim_nanos_locked(void)
+{
+	if(time_scale<=0.0) return sim_base_ns;
+	return sim_base_ns + (uint64_t)((double)(rc_nanos_since_boot()-wall_base_ns)*time_scale);
+}
+
+
+uint64_t __sim_nanos(void)
+{
+	uint64_t ns;
+	pthread_mutex_lock(&mutex);
+	ns = __sim_nanos_locked();
+	pthread_mutex_unlock(&mutex);
+	return ns;
+}
+
+
+void __sim_advance(uint64_t ns)
+{
+	pthread_mutex_lock(&mutex);
+	if(time_scale<=0.0) sim_base_ns += ns;
+	pthread_mutex_unlock(&mutex);
+	return;
+}
+
+
+int rc_sim_set_time_scale(double scale)
+{
+	if(scale<0.0){
+		fprintf(stderr,"ERROR in rc_sim_set_time_scale, scale must be >= 0\n");
+		return -1;
+	}
+	pthread_mutex_lock(&mutex);
+	// rebase so simulated time carries on from where it is
+	sim_base_ns = __sim_nanos_locked();
+	wall_base_ns = rc_nanos_since_boot();
+	time_scale = scale;
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+
+double __sim_time_scale(void)
+{
+	double scale;
+	pthread_mutex_lock(&mutex);
+	scale = time_scale;
+	pthread_mutex_unlock(&mutex);
+	return scale;
+}
+
+
+double __sim_uniform(uint64_t* state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return (double)((*state*2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+
+double __sim_gaussian(uint64_t* state, double std)
+{
+	double u1, u2;
+	if(std<=0.0) return 0.0;
+	u1 = __sim_uniform(state);
+	u2 = __sim_uniform(state);
+	if(u1<1e-300) u1 = 1e-300;
+	return std*sqrt(-2.0*log(u1))*cos(2.0*M_PI*u2);
+}
+
+
+static int __check_encoder(int ch)
+{
+	if(unlikely(ch<1 || ch>ENCODERS)){
+		fprintf(stderr,"ERROR in rc_sim, encoder channel must be between 1 & %d\n", ENCODERS);
+		return -1;
+	}
+	return 0;
+}
+
+
+static int __encoder_read(int ch)
+{
+	int pos;
+	if(__check_encoder(ch)) return -1;
+	pthread_mutex_lock(&mutex);
+	pos = encoder_pos[ch-1];
+	pthread_mutex_unlock(&mutex);
+	return pos;
+}
+
+
+static int __encoder_write(int ch, int pos)
+{
+	if(__check_encoder(ch)) return -1;
+	pthread_mutex_lock(&mutex);
+	encoder_pos[ch-1] = pos;
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+
+// the counters start at 0 like the real ones are zeroed by their drivers
+static int __encoder_eqep_init(void)
+{
+	__encoder_write(1, 0);
+	__encoder_write(2, 0);
+	__encoder_write(3, 0);
+	return 0;
+}
+
+
+// the PRU counter is channel 4
+static int __encoder_pru_init(void)
+{
+	return __encoder_write(4, 0);
+}
+
+
+static void __encoder_cleanup(void)
+{
+	return;
+}
+
+
+const rc_encoder_ops_t __sim_encoder_eqep_ops = {
+	.init		= __encoder_eqep_init,
+	.cleanup	= __encoder_cleanup,
+	.read		= __encoder_read,
+	.write		= __encoder_write,
+};
+
+
+const rc_encoder_ops_t __sim_encoder_pru_ops = {
+	.init		= __encoder_pru_init,
+	.cleanup	= __encoder_cleanup,
+	.read		= __encoder_read,
+	.write		= __encoder_write,
+};
+
+
+int __sim_encoder_add(int ch, int counts)
+{
+	if(__check_encoder(ch)) return -1;
+	pthread_mutex_lock(&mutex);
+	encoder_pos[ch-1] += counts;
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+
+int rc_sim_encoder_set(int ch, int pos)
+{
+	return __encoder_write(ch, pos);
+}
+
+
+int rc_sim_encoder_get(int ch)
+{
+	return __encoder_read(ch);
+}
+
+
+static int __servo_send_pulse_us(int ch, int us)
+{
+	int i;
+	if(unlikely(ch<0 || ch>RC_SERVO_CH_MAX)){
+		fprintf(stderr,"ERROR in rc_sim, servo channel must be between 0 & %d\n", RC_SERVO_CH_MAX);
+		return -1;
+	}
+	pthread_mutex_lock(&mutex);
+	if(ch==0) for(i=0;i<RC_SERVO_CH_MAX;i++) servo_us[i] = us;
+	else servo_us[ch-1] = us;
+	pthread_mutex_unlock(&mutex);
+	return 0;
+}
+
+
+static int __servo_start(void)
+{
+	return __servo_send_pulse_us(0, 0);
+}
+
+
+static void __servo_stop(void)
+{
+	__servo_send_pulse_us(0, 0);
+	return;
+}
+
+
+const rc_servo_ops_t __sim_servo_ops = {
+	.start		= __servo_start,
+	.stop		= __servo_stop,
+	.send_pulse_us	= __servo_send_pulse_us,
+};
+
+
+int rc_sim_servo_get_pulse_us(int ch)
+{
+	int us;
+	if(ch<RC_SERVO_CH_MIN || ch>RC_SERVO_CH_MAX){
+		fprintf(stderr,"ERROR in rc_sim_servo_get_pulse_us, channel must be between %d & %d\n", RC_SERVO_CH_MIN, RC_SERVO_CH_MAX);
+		return -1;
+	}
+	pthread_mutex_lock(&mutex);
+	us = servo_us[ch-1];
+	pthread_mutex_unlock(&mutex);
+	return us;
+}
@@ -0,0 +1,245 @@
+/**
+ * @file sim_bmp.c
+ *
+ * @brief      Register model of the BMP280 barometer.
+ *
+ * Uses the example calibration from the datasheet. Setting a pressure and
+ * temperature inverts the datasheet compensation formulas by bisection to
+ * find the raw readings the chip would report, so rc_bmp_read() sees exactly
+ * what a real BMP280 with this calibration would give.
+ *
+ * In normal mode the data registers update once per typical measurement
+ * time for the oversampling set in CTRL_MEAS, counted in simulated time so
+ * scaled and lockstep runs see the same cadence as real time. Each new
+ * measurement alternates the pressure reading by one LSB, about 0.2Pa, so
+ * that like a real sensor consecutive measurements are never identical.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <rc/sim.h>
+#include "sim_common.h"
+#include "../bmp/bmp_defs.h"
+
+#define REGS		256
+#define ADC_MAX		(1<<20)	// readings are 20 bits
+
+// calibration from section 3.12 of the datasheet
+static const uint16_t dig_T1 = 27504;
+static const int16_t dig_T2 = 26435;
+static const int16_t dig_T3 = -1000;
+static const uint16_t dig_P1 = 36477;
+static const int16_t dig_P2 = -10685;
+static const int16_t dig_P3 = 3024;
+static const int16_t dig_P4 = 2855;
+static const int16_t dig_P5 = 140;
+static const int16_t dig_P6 = -7;
+static const int16_t dig_P7 = 15500;
+static const int16_t dig_P8 = -14600;
+static const int16_t dig_P9 = 6000;
+
+typedef struct sim_bmp_t{
+	pthread_mutex_t mutex;		///< protects everything below
+	int attached;
+	uint8_t reg[REGS];
+	uint8_t ptr;
+	int32_t adc_P;
+	int32_t adc_T;
+	uint64_t next_meas_ns;		///< when the next measurement lands in the data registers
+	int dither;			///< alternates 0 and 1 with each measurement
+} sim_bmp_t;
+
+// raw readings for 100653Pa and 25.08C, the datasheet example
+static sim_bmp_t bmp = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.adc_P = 415148,
+	.adc_T = 519888,
+};
+
+
+/**
+ * datasheet temperature compensation, returns t_fine. Done in 64 bits so the
+ * bisection can't overflow at the ends of the range, in range the result is
+ * the same as the 32 bit original.
+ */
+static int32_t __t_fine(int32_t adc_T)
+{
+	int64_t var1, var2;
+	var1 = ((((int64_t)(adc_T>>3) - ((int64_t)dig_T1<<1))) * ((int64_t)dig_T2)) >> 11;
+	var2 = (((((adc_T>>4) - ((int64_t)dig_T1)) * ((adc_T>>4) - ((int64_t)dig_T1))) >> 12) *
+		((int64_t)dig_T3)) >> 14;
+	return (int32_t)(var1 + var2);
+}
+
+
+/**
+ * datasheet 64 bit pressure compensation, returns pressure in Pa in Q24.8
+ */
+static int64_t __pressure_q8(int32_t adc_P, int32_t t_fine)
+{
+	int64_t var1, var2, p;
+	var1 = ((int64_t)t_fine) - 128000;
+	var2 = var1 * var1 * (int64_t)dig_P6;
+	var2 = var2 + ((var1*(int64_t)dig_P5)<<17);
+	var2 = var2 + (((int64_t)dig_P4)<<35);
+	var1 = ((var1 * var1 * (int64_t)dig_P3)>>8) + ((var1 * (int64_t)dig_P2)<<12);
+	var1 = (((((int64_t)1)<<47)+var1))*((int64_t)dig_P1)>>33;
+	if(var1==0) return 0;
+	p = 1048576 - adc_P;
+	p = (((p<<31) - var2)*3125) / var1;
+	var1 = (((int64_t)dig_P9) * (p>>13) * (p>>13)) >> 25;
+	var2 = (((int64_t)dig_P8) * p) >> 19;
+	return ((p + var1 + var2) >> 8) + (((int64_t)dig_P7)<<4);
+}
+
+
+static void __put_le16(uint8_t* p, uint16_t v)
+{
+	p[0] = v & 0xFF;
+	p[1] = v >> 8;
+	return;
+}
+
+
+static void __reset(void)
+{
+	memset(bmp.reg, 0, REGS);
+	bmp.reg[BMP280_CHIP_ID_REG] = BMP280_CHIP_ID;
+	__put_le16(&bmp.reg[BMP280_DIG_T1], dig_T1);
+	__put_le16(&bmp.reg[BMP280_DIG_T2], dig_T2);
+	__put_le16(&bmp.reg[BMP280_DIG_T3], dig_T3);
+	__put_le16(&bmp.reg[BMP280_DIG_P1], dig_P1);
+	__put_le16(&bmp.reg[BMP280_DIG_P2], dig_P2);
+	__put_le16(&bmp.reg[BMP280_DIG_P3], dig_P3);
+	__put_le16(&bmp.reg[BMP280_DIG_P4], dig_P4);
+	__put_le16(&bmp.reg[BMP280_DIG_P5], dig_P5);
+	__put_le16(&bmp.reg[BMP280_DIG_P6], dig_P6);
+	__put_le16(&bmp.reg[BMP280_DIG_P7], dig_P7);
+	__put_le16(&bmp.reg[BMP280_DIG_P8], dig_P8);
+	__put_le16(&bmp.reg[BMP280_DIG_P9], dig_P9);
+	return;
+}
+
+
+static int __bmp_write(__attribute__ ((unused)) void* ctx, const uint8_t* data, size_t len)
+{
+	size_t i;
+	if(len==0) return 0;
+	pthread_mutex_lock(&bmp.mutex);
+	bmp.ptr = data[0];
+	for(i=1;i<len;i++,bmp.ptr++){
+		if(bmp.ptr==BMP280_RESET_REG){
+			if(data[i]==BMP280_RESET_WORD) __reset();
+		}
+		// only the control registers are writable
+		else if(bmp.ptr==BMP280_CTRL_MEAS || bmp.ptr==BMP280_CONFIG){
+			bmp.reg[bmp.ptr] = data[i];
+		}
+	}
+	pthread_mutex_unlock(&bmp.mutex);
+	return 0;
+}
+
+
+/**
+ * typical measurement time with 1x temperature oversampling from section 9
+ * of the datasheet plus the 0.5ms standby, the same as rc_bmp assumes
+ */
+static uint64_t __meas_period_ns(void)
+{
+	int osrs_p = (bmp.reg[BMP280_CTRL_MEAS]>>2) & 0x07;
+	double ms = 1.0 + 2.0 + 0.5 + 0.5;
+	if(osrs_p) ms += 2.0*(1<<(osrs_p-1));
+	return (uint64_t)(ms*1000000.0);
+}
+
+
+static int __bmp_read(__attribute__ ((unused)) void* ctx, uint8_t* data, size_t len)
+{
+	size_t i;
+	int32_t adc_P;
+	uint64_t now, period;
+	pthread_mutex_lock(&bmp.mutex);
+	// the chip measures on its own clock, sleep mode keeps the last result
+	now = __sim_nanos();
+	if((bmp.reg[BMP280_CTRL_MEAS]&BMP_MODE_NORMAL)!=BMP_MODE_SLEEP && now>=bmp.next_meas_ns){
+		period = __meas_period_ns();
+		bmp.next_meas_ns += ((now-bmp.next_meas_ns)/period + 1)*period;
+		bmp.dither ^= 1;
+		adc_P = bmp.adc_P + bmp.dither;
+		bmp.reg[BMP280_PRESSURE_MSB] = adc_P >> 12;
+		bmp.reg[BMP280_PRESSURE_LSB] = (adc_P >> 4) & 0xFF;
+		bmp.reg[BMP280_PRESSURE_XLSB] = (adc_P & 0x0F) << 4;
+		bmp.reg[BMP280_TEMPERATURE_MSB] = bmp.adc_T >> 12;
+		bmp.reg[BMP280_TEMPERATURE_LSB] = (bmp.adc_T >> 4) & 0xFF;
+		bmp.reg[BMP280_TEMPERATURE_XLSB] = (bmp.adc_T & 0x0F) << 4;
+	}
+	for(i=0;i<len;i++,bmp.ptr++) data[i] = bmp.reg[bmp.ptr];
+	pthread_mutex_unlock(&bmp.mutex);
+	return 0;
+}
+
+
+int __sim_bmp_attach(int bus, uint8_t addr)
+{
+	pthread_mutex_lock(&bmp.mutex);
+	if(bmp.attached){
+		pthread_mutex_unlock(&bmp.mutex);
+		fprintf(stderr,"ERROR in rc_sim, only one simulated BMP280 is supported\n");
+		return -1;
+	}
+	__reset();
+	bmp.attached = 1;
+	pthread_mutex_unlock(&bmp.mutex);
+	return rc_sim_i2c_attach(bus, addr, __bmp_write, __bmp_read, NULL);
+}
+
+
+int rc_sim_bmp_set(double pressure_pa, double temp_c)
+{
+	int32_t lo, hi, mid, adc_T, t_fine;
+	int64_t target;
+
+	if(!bmp.attached){
+		fprintf(stderr,"ERROR in rc_sim_bmp_set, simulation not enabled\n");
+		return -1;
+	}
+	if(pressure_pa<30000.0 || pressure_pa>110000.0 || temp_c<-40.0 || temp_c>85.0){
+		fprintf(stderr,"ERROR in rc_sim_bmp_set, pressure or temperature out of range\n");
+		return -1;
+	}
+
+	// temperature rises with adc_T, find the smallest reading that reaches
+	// the target in units of 0.01C
+	target = (int64_t)(temp_c*100.0);
+	lo = 0;
+	hi = ADC_MAX-1;
+	while(lo<hi){
+		mid = lo + (hi-lo)/2;
+		if(((__t_fine(mid)*5+128)>>8) < target) lo = mid+1;
+		else hi = mid;
+	}
+	adc_T = lo;
+	t_fine = __t_fine(adc_T);
+
+	// pressure falls as adc_P rises
+	target = (int64_t)(pressure_pa*256.0);
+	lo = 0;
+	hi = ADC_MAX-1;
+	while(lo<hi){
+		mid = lo + (hi-lo)/2;
+		if(__pressure_q8(mid, t_fine) > target) lo = mid+1;
+		else hi = mid;
+	}
+
+	pthread_mutex_lock(&bmp.mutex);
+	bmp.adc_T = adc_T;
+	bmp.adc_P = lo;
+	pthread_mutex_unlock(&bmp.mutex);
+	return 0;
+}
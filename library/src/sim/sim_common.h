@@ -0,0 +1,128 @@
+/**
+ * @file sim_common.h
+ *
+ * Backend ops tables for the io drivers and the hooks the simulated device
+ * models share. Not part of the public API, see <rc/sim.h> for that.
+ *
+ * Each driver keeps one table of the calls that differ between real hardware
+ * and the simulation. It picks the table once when it is initialized with
+ * __sim_pick_ops() and calls through it from then on, so the hot paths never
+ * ask which backend is in use. The hardware tables live in the drivers and
+ * the simulated ones in sim.c.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#ifndef RC_SIM_COMMON_H
+#define RC_SIM_COMMON_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <linux/i2c.h> // for struct i2c_msg
+#include <linux/spi/spidev.h> // for struct spi_ioc_transfer
+#include <rc/gpio.h>
+
+/**
+ * returns sim if the simulated backend is enabled, hw if not, or NULL if
+ * RC_SIM asked for the simulation and it could not be set up
+ */
+const void* __sim_pick_ops(const void* hw, const void* sim);
+
+// i2c, fd is the descriptor open returned and the arbiter only flocks it if
+// other processes can see the same bus
+typedef struct rc_i2c_ops_t{
+	int shared;
+	int (*open)(int bus);
+	int (*set_slave)(int fd, uint8_t addr);
+	int (*rdwr)(int bus, int fd, struct i2c_msg* msgs, int nmsgs);
+	int (*write)(int bus, int fd, uint8_t addr, uint8_t* data, size_t count);
+} rc_i2c_ops_t;
+
+// spi, message returns the number of bytes transferred like the ioctl
+typedef struct rc_spi_ops_t{
+	int (*open)(int bus, int slave);
+	int (*config)(int fd, unsigned long request, void* arg);
+	int (*message)(int bus, int slave, int fd, struct spi_ioc_transfer* xfer, int n);
+} rc_spi_ops_t;
+
+// gpio, the request functions return a file descriptor the driver owns and
+// closes, the event one is readable like a line event fd. wait_event polls it
+// like poll() does.
+typedef struct rc_gpio_ops_t{
+	int (*request)(int chip, int pin, int handle_flags);
+	int (*request_event)(int chip, int pin, int handle_flags, int event_flags);
+	int (*set_value)(int chip, int pin, int fd, int value);
+	int (*get_value)(int chip, int pin, int fd);
+	int (*wait_event)(int chip, int pin, int fd, int timeout_ms);
+	void (*release)(int chip, int pin);
+	int (*request_lines)(rc_gpio_group_t* group);
+	int (*set_lines)(rc_gpio_group_t* group, uint64_t values);
+	int (*get_lines)(rc_gpio_group_t* group, uint64_t* values);
+} rc_gpio_ops_t;
+
+// pwm, both channels of a subsystem start at 0 duty
+typedef struct rc_pwm_ops_t{
+	int (*init)(int ss, unsigned int period_ns);
+	int (*cleanup)(int ss);
+	int (*set_duty_ns)(int ss, char ch, unsigned int duty_ns);
+} rc_pwm_ops_t;
+
+// encoders, channels 1-4 like rc_encoder_read, init zeroes the counters
+typedef struct rc_encoder_ops_t{
+	int (*init)(void);
+	void (*cleanup)(void);
+	int (*read)(int ch);
+	int (*write)(int ch, int pos);
+} rc_encoder_ops_t;
+
+// servos, channel 0 sends to all of them like rc_servo_send_pulse_us
+typedef struct rc_servo_ops_t{
+	int (*start)(void);
+	void (*stop)(void);
+	int (*send_pulse_us)(int ch, int us);
+} rc_servo_ops_t;
+
+// uart, writes the path of the tty to open for the bus
+typedef struct rc_uart_ops_t{
+	int (*path)(int bus, char* path, size_t len);
+} rc_uart_ops_t;
+
+extern const rc_i2c_ops_t __sim_i2c_ops;
+extern const rc_spi_ops_t __sim_spi_ops;
+extern const rc_gpio_ops_t __sim_gpio_ops;
+extern const rc_pwm_ops_t __sim_pwm_ops;
+extern const rc_encoder_ops_t __sim_encoder_eqep_ops;
+extern const rc_encoder_ops_t __sim_encoder_pru_ops;
+extern const rc_servo_ops_t __sim_servo_ops;
+extern const rc_uart_ops_t __sim_uart_ops;
+
+// encoders, for the plants to turn the simulated wheels
+int __sim_encoder_add(int ch, int counts);
+
+// gpio, lets the interrupt line of a device model tell when the program is
+// waiting on it again, see __sim_gpio_wait_polled()
+uint64_t __sim_gpio_polls(int chip, int pin);
+void __sim_gpio_wait_polled(int chip, int pin, uint64_t seen, uint64_t timeout_ns);
+
+// sample clocks, see rc_sim_set_time_scale(). __sim_nanos() is simulated
+// time for device models, in lockstep it only moves when the mpu sample clock
+// calls __sim_advance() each period.
+double __sim_time_scale(void);
+uint64_t __sim_nanos(void);
+void __sim_advance(uint64_t ns);
+
+// noise for the device models and plants, xorshift64* so a given seed always
+// gives the same run, state must start nonzero
+double __sim_uniform(uint64_t* state);
+double __sim_gaussian(uint64_t* state, double std);
+
+// plant, advanced by the mpu sample clock before each sample is taken
+void __sim_plant_step(double dt);
+
+// default devices
+int __sim_mpu_attach(int bus, uint8_t addr, int int_chip, int int_pin);
+int __sim_bmp_attach(int bus, uint8_t addr);
+int __sim_dsm_attach(int bus);
+
+#endif // RC_SIM_COMMON_H
@@ -0,0 +1,176 @@
+/**
+ * @file sim_dsm.c
+ *
+ * @brief      Byte stream of a simulated DSM satellite receiver.
+ *
+ * Each 16 byte frame starts with a fades/system word followed by 7 channel
+ * words, unused ones set to 0xFFFF. In 2048 mode a word is 4 bits of channel
+ * id and 11 bits of value, in 1024 mode it's 5 bits of id and 10 of value,
+ * the same encoding rc_dsm decodes.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <rc/dsm.h>
+#include <rc/sim.h>
+#include "sim_common.h"
+
+#define FRAME_SIZE		16
+#define WORDS_PER_FRAME		7
+#define MIN_2048_CHANNELS	6
+#define MAX_CHANNELS		9	// most a DSM receiver sends
+#define PERIOD_2048_NS		11000000
+#define PERIOD_1024_NS		22000000
+#define SYSTEM_2048		0xB2	// DSMX 11ms
+#define SYSTEM_1024		0x01	// DSM2 22ms
+#define VALUE_OFFSET		989	// rc_dsm adds this to center on 1500
+#define MIN_US			VALUE_OFFSET
+#define MAX_US			(VALUE_OFFSET+1023)
+
+typedef struct sim_dsm_t{
+	pthread_mutex_t mutex;		///< protects everything below
+	pthread_cond_t cond;		///< signalled when channels go from 0 to some
+	pthread_t thread;
+	int attached;
+	int bus;
+	int channels;
+	int pulse_us[MAX_CHANNELS];
+	int drop;			///< bytes to leave off the next frame
+} sim_dsm_t;
+
+static sim_dsm_t dsm = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+
+/**
+ * fills in one frame carrying channels first to first+WORDS_PER_FRAME-1,
+ * call with the mutex held
+ *
+ * @return     index of the first channel not sent
+ */
+static int __build_frame(uint8_t frame[FRAME_SIZE], int first, int hi_res)
+{
+	int i, ch;
+	uint16_t word, value;
+
+	memset(frame, 0xFF, FRAME_SIZE);
+	frame[0] = 0;
+	frame[1] = hi_res ? SYSTEM_2048 : SYSTEM_1024;
+	for(i=0, ch=first; i<WORDS_PER_FRAME && ch<dsm.channels; i++, ch++){
+		value = dsm.pulse_us[ch]-VALUE_OFFSET;
+		if(hi_res) word = (ch<<11) | ((value*2) & 0x7FF);
+		else word = (ch<<10) | (value & 0x3FF);
+		frame[2+2*i] = word >> 8;
+		frame[3+2*i] = word & 0xFF;
+	}
+	return ch;
+}
+
+
+static void* __dsm_thread(__attribute__ ((unused)) void* ptr)
+{
+	struct timespec next;
+	uint8_t frame[FRAME_SIZE];
+	uint64_t period_ns, next_ns;
+	int hi_res, first = 0;
+	size_t len;
+
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	while(1){
+		pthread_mutex_lock(&dsm.mutex);
+		while(dsm.channels==0){
+			pthread_cond_wait(&dsm.cond, &dsm.mutex);
+			clock_gettime(CLOCK_MONOTONIC, &next);
+			first = 0;
+		}
+		hi_res = dsm.channels>=MIN_2048_CHANNELS;
+		if(first>=dsm.channels) first = 0;
+		first = __build_frame(frame, first, hi_res);
+		len = FRAME_SIZE-dsm.drop;
+		dsm.drop = 0;
+		pthread_mutex_unlock(&dsm.mutex);
+		rc_sim_uart_send(dsm.bus, frame, len);
+
+		period_ns = hi_res ? PERIOD_2048_NS : PERIOD_1024_NS;
+		next_ns = (uint64_t)next.tv_sec*1000000000ULL + next.tv_nsec + period_ns;
+		next.tv_sec = next_ns/1000000000ULL;
+		next.tv_nsec = next_ns%1000000000ULL;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+	}
+	return NULL;
+}
+
+
+int __sim_dsm_attach(int bus)
+{
+	pthread_mutex_lock(&dsm.mutex);
+	if(dsm.attached){
+		pthread_mutex_unlock(&dsm.mutex);
+		fprintf(stderr,"ERROR in rc_sim, only one simulated DSM receiver is supported\n");
+		return -1;
+	}
+	dsm.bus = bus;
+	dsm.attached = 1;
+	pthread_mutex_unlock(&dsm.mutex);
+	if(pthread_create(&dsm.thread, NULL, __dsm_thread, NULL)){
+		fprintf(stderr,"ERROR in rc_sim, failed to start DSM thread\n");
+		return -1;
+	}
+	pthread_detach(dsm.thread);
+	return 0;
+}
+
+
+int rc_sim_dsm_set_channels(const int* pulse_us, int channels)
+{
+	int i;
+	if(!dsm.attached){
+		fprintf(stderr,"ERROR in rc_sim_dsm_set_channels, simulation not enabled\n");
+		return -1;
+	}
+	if(channels!=0 && (channels<2 || channels>MAX_CHANNELS)){
+		fprintf(stderr,"ERROR in rc_sim_dsm_set_channels, channels must be 0 or between 2 and %d\n", MAX_CHANNELS);
+		return -1;
+	}
+	if(channels && pulse_us==NULL){
+		fprintf(stderr,"ERROR in rc_sim_dsm_set_channels, received NULL pointer\n");
+		return -1;
+	}
+	for(i=0;i<channels;i++){
+		if(pulse_us[i]<MIN_US || pulse_us[i]>MAX_US){
+			fprintf(stderr,"ERROR in rc_sim_dsm_set_channels, pulse width must be between %d and %d\n", MIN_US, MAX_US);
+			return -1;
+		}
+	}
+	pthread_mutex_lock(&dsm.mutex);
+	for(i=0;i<channels;i++) dsm.pulse_us[i] = pulse_us[i];
+	if(dsm.channels==0 && channels) pthread_cond_signal(&dsm.cond);
+	dsm.channels = channels;
+	pthread_mutex_unlock(&dsm.mutex);
+	return 0;
+}
+
+
+int rc_sim_dsm_drop_bytes(int bytes)
+{
+	if(!dsm.attached){
+		fprintf(stderr,"ERROR in rc_sim_dsm_drop_bytes, simulation not enabled\n");
+		return -1;
+	}
+	if(bytes<1 || bytes>=FRAME_SIZE){
+		fprintf(stderr,"ERROR in rc_sim_dsm_drop_bytes, bytes must be between 1 and %d\n", FRAME_SIZE-1);
+		return -1;
+	}
+	pthread_mutex_lock(&dsm.mutex);
+	dsm.drop = bytes;
+	pthread_mutex_unlock(&dsm.mutex);
+	return 0;
+}
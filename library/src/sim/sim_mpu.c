@@ -0,0 +1,658 @@
+/**
+ * @file sim_mpu.c
+ *
+ * @brief      Register model of the MPU-9250 and the AK8963 inside it.
+ *
+ * Covers what rc_mpu uses: reset, WHO_AM_I, the full scale ranges, the sensor
+ * data registers, DMP memory access through BANK_SEL/MEM_START_ADDR/MEM_R_W
+ * so the firmware load and verify pass, and the FIFO. A background thread
+ * plays the part of the sample clock. With the DMP running it pushes one
+ * packet per DMP period, laid out according to what rc_mpu configured in DMP
+ * memory, and pulses the interrupt line. With only the data ready interrupt
+ * enabled it pulses at the rate set by SMPLRT_DIV. The AK8963 answers at its
+ * own address while bypass is on, and is copied into EXT_SENS_DATA like the
+ * internal i2c master does when that is on instead.
+ *
+ * Each sample the true motion is read through a bias and white noise model.
+ * The DMP quaternion comes out of a 6-axis Mahony filter fed those readings,
+ * the way the DMP fuses them on the chip, so it carries the tilt error and
+ * heading drift a real one would instead of the true orientation.
+ *
+ * Before each interrupting sample the plant, if one is running, is advanced
+ * by one sample period. The period is divided by the time scale, and in
+ * lockstep the next sample waits until rc_mpu has finished with the last one
+ * and is waiting on the interrupt line again.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <rc/mpu.h>
+#include <rc/math/ahrs.h>
+#include <rc/math/quaternion.h>
+#include <rc/sim.h>
+#include "sim_common.h"
+#include "../mpu/mpu_defs.h"
+
+#define REGS		256
+#define DMP_MEM_SIZE	4096	// 16 banks of 256, more than the firmware uses
+#define FIFO_SIZE	512
+#define IDLE_PERIOD_NS	1000000	// how often the sample thread checks in when no interrupts are on
+#define LOCKSTEP_TIMEOUT_NS	100000000 // give up waiting on rc_mpu after this in lockstep
+#define RESET_BUSY_NS		1000000	// H_RESET reads back set for this long after a reset
+
+// DMP memory locations and register values rc_mpu writes to choose what goes
+// in each FIFO packet, from dmp_firmware.h and dmpKey.h which also carry the
+// firmware image so aren't included here
+#define MPU6500_BANK_SEL	0x6D
+#define MPU6500_MEM_START_ADDR	0x6E
+#define MPU6500_MEM_R_W		0x6F
+#define CFG_15			2727
+#define CFG_27			2742
+#define D_0_22			(22+512)
+#define CFG_15_SEND_ACCEL	0xC0	// at CFG_15+1
+#define CFG_15_SEND_GYRO	0xC4	// at CFG_15+4
+#define CFG_27_SEND_GESTURE	0x20	// DINA20
+
+#define WHO_AM_I_VALUE		0x71
+#define PWR_MGMT_1_RESET	0x01
+#define INT_STATUS_RAW_RDY	0x01
+#define INT_STATUS_DMP		0x02
+#define TEMP_C			25.0
+
+// gains of the filter standing in for the DMP's sensor fusion
+#define DMP_KP			1.0f
+#define DMP_KI			0.0f
+
+#define AK8963_REGS		32
+#define AK8963_WIA_VALUE	0x48
+#define AK8963_ASA_VALUE	128	// exactly no factory adjustment
+#define AK8963_MODE_MASK	0x0F
+#define AK8963_ST2_HOFL		0x08
+#define AK8963_ST2_BITM		0x10
+#define AK8963_MAX_RAW		32760
+
+
+typedef struct sim_mpu_t{
+	pthread_mutex_t mutex;		///< protects everything below
+	pthread_t thread;
+	int attached;
+	int int_chip;
+	int int_pin;
+	uint8_t reg[REGS];
+	uint8_t ptr;			///< register pointer
+	uint64_t reset_end_ns;		///< CLOCK_MONOTONIC time the reset in progress finishes
+	uint8_t mem[DMP_MEM_SIZE];
+	uint8_t fifo[FIFO_SIZE];
+	int fifo_head;			///< index of the oldest byte
+	int fifo_count;
+	double accel[3];		///< true specific force, m/s^2
+	double gyro[3];			///< true angular rate, deg/s
+	double accel_meas[3];		///< what the accelerometer reads this sample
+	double gyro_meas[3];		///< what the gyro reads this sample
+	rc_sim_mpu_noise_t noise;
+	uint64_t rng;
+	rc_ahrs_t dmp;			///< the DMP's sensor fusion
+	int dmp_running;		///< DMP was on last sample
+	double dmp_quat[4];		///< latest DMP output
+	double mag[3];			///< uT in the rc_mpu_data_t frame
+	uint8_t mag_reg[AK8963_REGS];
+	uint8_t mag_ptr;
+} sim_mpu_t;
+
+static sim_mpu_t mpu = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.accel = {0.0, 0.0, G_TO_MS2},
+	.accel_meas = {0.0, 0.0, G_TO_MS2},
+	.dmp_quat = {1.0, 0.0, 0.0, 0.0},
+	.mag = {22.0, 0.0, -42.0},
+};
+
+
+static int16_t __saturate(double x)
+{
+	if(x>32767.0) return 32767;
+	if(x<-32768.0) return -32768;
+	return (int16_t)lround(x);
+}
+
+
+static void __put_be16(uint8_t* p, int16_t v)
+{
+	p[0] = (uint16_t)v >> 8;
+	p[1] = (uint16_t)v & 0xFF;
+	return;
+}
+
+
+static void __raw_accel_gyro(int16_t accel[3], int16_t gyro[3])
+{
+	int i;
+	double accel_fsr_g = 2 << ((mpu.reg[ACCEL_CONFIG]>>3) & 3);
+	double gyro_fsr_dps = 250 << ((mpu.reg[GYRO_CONFIG]>>3) & 3);
+	for(i=0;i<3;i++){
+		accel[i] = __saturate(mpu.accel_meas[i]/G_TO_MS2 * 32768.0/accel_fsr_g);
+		gyro[i] = __saturate(mpu.gyro_meas[i] * 32768.0/gyro_fsr_dps);
+	}
+	return;
+}
+
+
+/**
+ * reads the true motion through the noise model, once per sample so every
+ * register read within a sample agrees
+ */
+static void __measure(void)
+{
+	int i;
+	for(i=0;i<3;i++){
+		mpu.accel_meas[i] = mpu.accel[i] + mpu.noise.accel_bias[i]
+				+ __sim_gaussian(&mpu.rng, mpu.noise.accel_noise);
+		mpu.gyro_meas[i] = mpu.gyro[i] + mpu.noise.gyro_bias[i]
+				+ __sim_gaussian(&mpu.rng, mpu.noise.gyro_noise);
+	}
+	return;
+}
+
+
+/**
+ * one step of the DMP's fusion. Like the chip it starts over from the
+ * accelerometer with the heading at zero every time the DMP is enabled.
+ */
+static void __dmp_update(double dt)
+{
+	float gyro[3], accel[3];
+	int i;
+	if(!mpu.dmp_running) rc_ahrs_reset(&mpu.dmp);
+	for(i=0;i<3;i++){
+		gyro[i] = mpu.gyro_meas[i]*DEG_TO_RAD;
+		accel[i] = mpu.accel_meas[i];
+	}
+	rc_ahrs_update(&mpu.dmp, gyro, accel, NULL, dt);
+	rc_ahrs_get_quaternion(&mpu.dmp, mpu.dmp_quat);
+	return;
+}
+
+
+/**
+ * refreshes ACCEL_XOUT_H through GYRO_ZOUT_L from the current motion
+ */
+static void __update_sensor_regs(void)
+{
+	int i;
+	int16_t accel[3], gyro[3];
+	__raw_accel_gyro(accel, gyro);
+	for(i=0;i<3;i++){
+		__put_be16(&mpu.reg[ACCEL_XOUT_H+2*i], accel[i]);
+		__put_be16(&mpu.reg[ACCEL_XOUT_H+8+2*i], gyro[i]);
+	}
+	__put_be16(&mpu.reg[TEMP_OUT_H], __saturate((TEMP_C-21.0)*TEMP_SENSITIVITY));
+	return;
+}
+
+
+/**
+ * refreshes the AK8963 status and data registers from the current field
+ */
+static void __update_mag_regs(void)
+{
+	int i;
+	double adc[3], scale;
+	int16_t raw;
+	uint8_t mode = mpu.mag_reg[AK8963_CNTL] & AK8963_MODE_MASK;
+
+	// rc_mpu reports x=adc[1], y=adc[0], z=-adc[2]
+	adc[0] = mpu.mag[1];
+	adc[1] = mpu.mag[0];
+	adc[2] = -mpu.mag[2];
+	scale = (mpu.mag_reg[AK8963_CNTL]&MSCALE_16) ? MAG_RAW_TO_uT : 4.0*MAG_RAW_TO_uT;
+	mpu.mag_reg[AK8963_ST2] = mpu.mag_reg[AK8963_CNTL]&MSCALE_16 ? AK8963_ST2_BITM : 0;
+	for(i=0;i<3;i++){
+		raw = __saturate(adc[i]/scale);
+		if(raw>AK8963_MAX_RAW || raw<-AK8963_MAX_RAW){
+			mpu.mag_reg[AK8963_ST2] |= AK8963_ST2_HOFL;
+		}
+		mpu.mag_reg[AK8963_XOUT_L+2*i] = (uint16_t)raw & 0xFF;
+		mpu.mag_reg[AK8963_XOUT_L+2*i+1] = (uint16_t)raw >> 8;
+	}
+	// any measurement mode always has fresh data
+	mpu.mag_reg[AK8963_ST1] = (mode!=MAG_POWER_DN && mode!=MAG_FUSE_ROM) ? MAG_DATA_READY : 0;
+	return;
+}
+
+
+static void __fifo_push(const uint8_t* data, int len)
+{
+	int i;
+	// a full FIFO drops the new packet, rc_mpu resets it when the count
+	// stops being a whole number of packets
+	if(mpu.fifo_count+len > FIFO_SIZE) return;
+	for(i=0;i<len;i++){
+		mpu.fifo[(mpu.fifo_head+mpu.fifo_count)%FIFO_SIZE] = data[i];
+		mpu.fifo_count++;
+	}
+	return;
+}
+
+
+static uint8_t __fifo_pop(void)
+{
+	uint8_t v;
+	if(mpu.fifo_count==0) return 0;
+	v = mpu.fifo[mpu.fifo_head];
+	mpu.fifo_head = (mpu.fifo_head+1)%FIFO_SIZE;
+	mpu.fifo_count--;
+	return v;
+}
+
+
+/**
+ * builds one DMP packet: quaternion in q30, then raw accel and gyro and the 4
+ * gesture bytes if rc_mpu enabled them
+ */
+static void __push_dmp_packet(void)
+{
+	int i, len = 0;
+	int32_t q;
+	int16_t accel[3], gyro[3];
+	uint8_t pkt[32];
+
+	for(i=0;i<4;i++){
+		q = (int32_t)lround(mpu.dmp_quat[i]*1073741824.0);
+		pkt[len++] = (uint32_t)q >> 24;
+		pkt[len++] = ((uint32_t)q >> 16) & 0xFF;
+		pkt[len++] = ((uint32_t)q >> 8) & 0xFF;
+		pkt[len++] = (uint32_t)q & 0xFF;
+	}
+	__raw_accel_gyro(accel, gyro);
+	if(mpu.mem[CFG_15+1]==CFG_15_SEND_ACCEL){
+		for(i=0;i<3;i++,len+=2) __put_be16(&pkt[len], accel[i]);
+	}
+	if(mpu.mem[CFG_15+4]==CFG_15_SEND_GYRO){
+		for(i=0;i<3;i++,len+=2) __put_be16(&pkt[len], gyro[i]);
+	}
+	if(mpu.mem[CFG_27]==CFG_27_SEND_GESTURE){
+		memset(&pkt[len], 0, 4);
+		len += 4;
+	}
+	__fifo_push(pkt, len);
+	return;
+}
+
+
+static uint64_t __now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+
+static void __reset(void)
+{
+	memset(mpu.reg, 0, REGS);
+	mpu.reg[PWR_MGMT_1] = PWR_MGMT_1_RESET;
+	mpu.reg[WHO_AM_I_MPU9250] = WHO_AM_I_VALUE;
+	mpu.fifo_head = 0;
+	mpu.fifo_count = 0;
+	return;
+}
+
+
+/**
+ * like the real chip, the H_RESET bit stays set while the reset is in progress
+ * and clears itself once it is over, so rc_mpu's fast start has to poll it
+ */
+static void __update_reset(void)
+{
+	if(mpu.reset_end_ns==0 || __now_ns()<mpu.reset_end_ns) return;
+	mpu.reset_end_ns = 0;
+	mpu.reg[PWR_MGMT_1] &= (uint8_t)~(H_RESET);
+	return;
+}
+
+
+static int __mem_addr(void)
+{
+	return ((mpu.reg[MPU6500_BANK_SEL]<<8) | mpu.reg[MPU6500_MEM_START_ADDR]) % DMP_MEM_SIZE;
+}
+
+
+static uint8_t __read_reg(void)
+{
+	uint8_t v;
+	switch(mpu.ptr){
+	case FIFO_COUNTH:
+		v = mpu.fifo_count >> 8;
+		break;
+	case FIFO_COUNTH+1:
+		v = mpu.fifo_count & 0xFF;
+		break;
+	case FIFO_R_W:
+		// burst reads keep hitting the same register
+		return __fifo_pop();
+	case MPU6500_MEM_R_W:
+		v = mpu.mem[__mem_addr()];
+		mpu.reg[MPU6500_MEM_START_ADDR]++;
+		return v;
+	case INT_STATUS:
+		v = mpu.reg[INT_STATUS];
+		mpu.reg[INT_STATUS] = 0;
+		break;
+	default:
+		v = mpu.reg[mpu.ptr];
+	}
+	mpu.ptr++;
+	return v;
+}
+
+
+static void __write_reg(uint8_t v)
+{
+	switch(mpu.ptr){
+	case PWR_MGMT_1:
+		if(v & H_RESET){
+			__reset();
+			mpu.reg[PWR_MGMT_1] |= H_RESET;
+			mpu.reset_end_ns = __now_ns() + RESET_BUSY_NS;
+			break;
+		}
+		mpu.reg[PWR_MGMT_1] = v;
+		break;
+	case USER_CTRL:
+		if(v & BIT_FIFO_RST){
+			mpu.fifo_head = 0;
+			mpu.fifo_count = 0;
+		}
+		// reset bits clear themselves immediately
+		mpu.reg[USER_CTRL] = v & ~(BIT_FIFO_RST|BIT_DMP_RST|I2C_MST_RST);
+		break;
+	case FIFO_R_W:
+		__fifo_push(&v, 1);
+		return;
+	case MPU6500_MEM_R_W:
+		mpu.mem[__mem_addr()] = v;
+		mpu.reg[MPU6500_MEM_START_ADDR]++;
+		return;
+	case WHO_AM_I_MPU9250:
+	case INT_STATUS:
+	case FIFO_COUNTH:
+	case FIFO_COUNTH+1:
+		break;
+	default:
+		mpu.reg[mpu.ptr] = v;
+	}
+	mpu.ptr++;
+	return;
+}
+
+
+static int __mpu_write(__attribute__ ((unused)) void* ctx, const uint8_t* data, size_t len)
+{
+	size_t i;
+	if(len==0) return 0;
+	pthread_mutex_lock(&mpu.mutex);
+	__update_reset();
+	mpu.ptr = data[0];
+	for(i=1;i<len;i++) __write_reg(data[i]);
+	pthread_mutex_unlock(&mpu.mutex);
+	return 0;
+}
+
+
+static int __mpu_read(__attribute__ ((unused)) void* ctx, uint8_t* data, size_t len)
+{
+	size_t i;
+	pthread_mutex_lock(&mpu.mutex);
+	__update_reset();
+	__update_sensor_regs();
+	for(i=0;i<len;i++) data[i] = __read_reg();
+	pthread_mutex_unlock(&mpu.mutex);
+	return 0;
+}
+
+
+/**
+ * the AK8963 is only reachable from outside while the MPU is in bypass mode
+ */
+static int __mag_reachable(void)
+{
+	return (mpu.reg[INT_PIN_CFG]&BYPASS_EN) && !(mpu.reg[USER_CTRL]&I2C_MST_EN);
+}
+
+
+static int __mag_write(__attribute__ ((unused)) void* ctx, const uint8_t* data, size_t len)
+{
+	size_t i;
+	if(len==0) return 0;
+	pthread_mutex_lock(&mpu.mutex);
+	if(!__mag_reachable()){
+		pthread_mutex_unlock(&mpu.mutex);
+		return -1;
+	}
+	mpu.mag_ptr = data[0];
+	for(i=1;i<len;i++,mpu.mag_ptr++){
+		// only the control registers are writable
+		if(mpu.mag_ptr>=AK8963_CNTL && mpu.mag_ptr<=AK8963_I2CDIS){
+			mpu.mag_reg[mpu.mag_ptr%AK8963_REGS] = data[i];
+		}
+	}
+	pthread_mutex_unlock(&mpu.mutex);
+	return 0;
+}
+
+
+static int __mag_read(__attribute__ ((unused)) void* ctx, uint8_t* data, size_t len)
+{
+	size_t i;
+	pthread_mutex_lock(&mpu.mutex);
+	if(!__mag_reachable()){
+		pthread_mutex_unlock(&mpu.mutex);
+		return -1;
+	}
+	__update_mag_regs();
+	for(i=0;i<len;i++,mpu.mag_ptr++) data[i] = mpu.mag_reg[mpu.mag_ptr%AK8963_REGS];
+	pthread_mutex_unlock(&mpu.mutex);
+	return 0;
+}
+
+
+/**
+ * The sample clock. Every period it does what the chip would at the end of a
+ * sample and then waits on an absolute deadline so the rate doesn't drift.
+ */
+static void* __sample_thread(__attribute__ ((unused)) void* ptr)
+{
+	struct timespec next, now;
+	uint64_t period_ns, next_ns, now_ns, seen;
+	unsigned int div;
+	int dmp, pulse;
+	double scale;
+
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	while(1){
+		pthread_mutex_lock(&mpu.mutex);
+		period_ns = IDLE_PERIOD_NS;
+		dmp = (mpu.reg[USER_CTRL]&BIT_DMP_EN) && (mpu.reg[INT_ENABLE]&BIT_DMP_INT_EN);
+		pulse = dmp || (mpu.reg[INT_ENABLE]&BIT_DATA_RDY_EN);
+		if(dmp){
+			div = (mpu.mem[D_0_22]<<8) | mpu.mem[D_0_22+1];
+			period_ns = 1000000000ULL*(div+1)/DMP_MAX_RATE;
+		}
+		else if(pulse) period_ns = 1000000ULL*(1+mpu.reg[SMPLRT_DIV]);
+		pthread_mutex_unlock(&mpu.mutex);
+
+		// move the plant to where it is at this sample, it sets the motion
+		// through the public functions so must be outside the mutex
+		if(pulse) __sim_plant_step(period_ns/1e9);
+		__sim_advance(period_ns);
+
+		pthread_mutex_lock(&mpu.mutex);
+		__measure();
+		if(dmp){
+			__dmp_update(period_ns/1e9);
+			if(mpu.reg[USER_CTRL]&BIT_FIFO_EN) __push_dmp_packet();
+			mpu.reg[INT_STATUS] |= INT_STATUS_DMP;
+		}
+		else if(pulse) mpu.reg[INT_STATUS] |= INT_STATUS_RAW_RDY;
+		mpu.dmp_running = dmp;
+		// the internal i2c master copies ST1 through ST2 every sample
+		if(mpu.reg[USER_CTRL]&I2C_MST_EN){
+			__update_mag_regs();
+			memcpy(&mpu.reg[EXT_SENS_DATA_00], &mpu.mag_reg[AK8963_ST1], 8);
+		}
+		pthread_mutex_unlock(&mpu.mutex);
+
+		// rc_mpu waits for the falling edge
+		seen = __sim_gpio_polls(mpu.int_chip, mpu.int_pin);
+		if(pulse){
+			rc_sim_gpio_set(mpu.int_chip, mpu.int_pin, 1);
+			rc_sim_gpio_set(mpu.int_chip, mpu.int_pin, 0);
+		}
+
+		scale = __sim_time_scale();
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		now_ns = (uint64_t)now.tv_sec*1000000000ULL + now.tv_nsec;
+		if(pulse && scale<=0.0){
+			// in lockstep wait for rc_mpu to come back for the next
+			// interrupt. Times out in case nothing is listening, the
+			// register level functions poll without ever taking it.
+			__sim_gpio_wait_polled(mpu.int_chip, mpu.int_pin, seen, LOCKSTEP_TIMEOUT_NS);
+			next = now;
+			continue;
+		}
+		if(scale>0.0) period_ns = period_ns/scale;
+		// if we fell more than a period behind, skip ahead rather than
+		// bursting to catch up
+		next_ns = (uint64_t)next.tv_sec*1000000000ULL + next.tv_nsec + period_ns;
+		if(next_ns+period_ns < now_ns) next_ns = now_ns;
+		next.tv_sec = next_ns/1000000000ULL;
+		next.tv_nsec = next_ns%1000000000ULL;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+	}
+	return NULL;
+}
+
+
+int __sim_mpu_attach(int bus, uint8_t addr, int int_chip, int int_pin)
+{
+	pthread_mutex_lock(&mpu.mutex);
+	if(mpu.attached){
+		pthread_mutex_unlock(&mpu.mutex);
+		fprintf(stderr,"ERROR in rc_sim, only one simulated MPU is supported\n");
+		return -1;
+	}
+	__reset();
+	mpu.int_chip = int_chip;
+	mpu.int_pin = int_pin;
+	mpu.mag_reg[WHO_AM_I_AK8963] = AK8963_WIA_VALUE;
+	mpu.mag_reg[AK8963_ASAX] = AK8963_ASA_VALUE;
+	mpu.mag_reg[AK8963_ASAY] = AK8963_ASA_VALUE;
+	mpu.mag_reg[AK8963_ASAZ] = AK8963_ASA_VALUE;
+	mpu.noise = rc_sim_mpu_default_noise();
+	mpu.rng = mpu.noise.seed;
+	mpu.dmp = rc_ahrs_empty();
+	rc_ahrs_mahony_init(&mpu.dmp, DMP_KP, DMP_KI);
+	__measure();
+	mpu.attached = 1;
+	pthread_mutex_unlock(&mpu.mutex);
+
+	if(rc_sim_i2c_attach(bus, addr, __mpu_write, __mpu_read, NULL)) return -1;
+	if(rc_sim_i2c_attach(bus, AK8963_ADDR, __mag_write, __mag_read, NULL)) return -1;
+	if(pthread_create(&mpu.thread, NULL, __sample_thread, NULL)){
+		fprintf(stderr,"ERROR in rc_sim, failed to start MPU sample thread\n");
+		return -1;
+	}
+	pthread_detach(mpu.thread);
+	return 0;
+}
+
+
+int rc_sim_mpu_set_motion(const double quat[4], const double accel[3], const double gyro[3])
+{
+	int i;
+	double len = 0.0;
+	double q[4], qc[4];
+	double g[3] = {0.0, 0.0, G_TO_MS2};
+	if(!mpu.attached){
+		fprintf(stderr,"ERROR in rc_sim_mpu_set_motion, simulation not enabled\n");
+		return -1;
+	}
+	if(quat!=NULL){
+		for(i=0;i<4;i++) len += quat[i]*quat[i];
+		if(len<=0.0){
+			fprintf(stderr,"ERROR in rc_sim_mpu_set_motion, quaternion has zero length\n");
+			return -1;
+		}
+		len = sqrt(len);
+		// held still, the accelerometer reads gravity in the sensor frame
+		if(accel==NULL){
+			for(i=0;i<4;i++) q[i] = quat[i]/len;
+			rc_quaternion_conjugate_array(q, qc);
+			rc_quaternion_rotate_vector_array(g, qc);
+			accel = g;
+		}
+	}
+	pthread_mutex_lock(&mpu.mutex);
+	if(accel!=NULL) for(i=0;i<3;i++) mpu.accel[i] = accel[i];
+	if(gyro!=NULL) for(i=0;i<3;i++) mpu.gyro[i] = gyro[i];
+	__measure();
+	pthread_mutex_unlock(&mpu.mutex);
+	return 0;
+}
+
+
+rc_sim_mpu_noise_t rc_sim_mpu_default_noise(void)
+{
+	rc_sim_mpu_noise_t noise = {
+		.gyro_bias	= {0.05, -0.03, 0.04},
+		.gyro_noise	= 0.1,
+		.accel_bias	= {0.02, -0.01, 0.02},
+		.accel_noise	= 0.03,
+		.seed		= 1,
+	};
+	return noise;
+}
+
+
+int rc_sim_mpu_set_noise(rc_sim_mpu_noise_t noise)
+{
+	if(!mpu.attached){
+		fprintf(stderr,"ERROR in rc_sim_mpu_set_noise, simulation not enabled\n");
+		return -1;
+	}
+	if(noise.gyro_noise<0.0 || noise.accel_noise<0.0){
+		fprintf(stderr,"ERROR in rc_sim_mpu_set_noise, noise can't be negative\n");
+		return -1;
+	}
+	pthread_mutex_lock(&mpu.mutex);
+	mpu.noise = noise;
+	mpu.rng = noise.seed ? noise.seed : 1;
+	__measure();
+	pthread_mutex_unlock(&mpu.mutex);
+	return 0;
+}
+
+
+int rc_sim_mpu_set_mag(const double mag[3])
+{
+	int i;
+	if(!mpu.attached){
+		fprintf(stderr,"ERROR in rc_sim_mpu_set_mag, simulation not enabled\n");
+		return -1;
+	}
+	if(mag==NULL){
+		fprintf(stderr,"ERROR in rc_sim_mpu_set_mag, received NULL pointer\n");
+		return -1;
+	}
+	pthread_mutex_lock(&mpu.mutex);
+	for(i=0;i<3;i++) mpu.mag[i] = mag[i];
+	pthread_mutex_unlock(&mpu.mutex);
+	return 0;
+}
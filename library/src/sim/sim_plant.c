@@ -0,0 +1,484 @@
+/**
+ * @file sim_plant.c
+ *
+ * @brief      Physics models closing the loop through the simulated devices.
+ *
+ * The MPU sample clock calls __sim_plant_step() before every sample. The
+ * running plant reads what the program last sent to the motor drivers or
+ * ESCs, integrates its dynamics over the sample period and writes the result
+ * back to the simulated IMU, barometer and encoders.
+ *
+ * The balance bot is the planar wheeled inverted pendulum with a separate
+ * yaw mode for the difference between the wheels. The vertical vehicle is a
+ * point mass with thrust, quadratic drag and the ground.
+ *
+ * @author     librobotcontrol contributors
+ * @date       10/17/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h> // for abs
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include <rc/math/quaternion.h>
+#include <rc/mpu.h>
+#include <rc/servo.h>
+#include <rc/sim.h>
+#include "sim_common.h"
+
+#define SUBSTEP_S	0.0005	// integration step, well under the motor time constant
+#define SEA_LEVEL_PA	101325.0
+#define MOTORS		4
+#define MOT_STBY	0,20	// same pins rc_motor uses on the Blue
+
+typedef enum plant_type_t{
+	PLANT_NONE,
+	PLANT_BALANCE,
+	PLANT_VERTICAL
+} plant_type_t;
+
+typedef enum bridge_mode_t{
+	BRIDGE_COAST,
+	BRIDGE_BRAKE,
+	BRIDGE_DRIVE
+} bridge_mode_t;
+
+// pwm and direction pins of the 4 motor drivers on the Blue, and how each
+// output is wired to the connector, rc_motor flips the same ones
+static const struct{
+	int ss;
+	char ch;
+	int a_chip, a_pin, b_chip, b_pin;
+	int polarity;
+} bridge[MOTORS] = {
+	{1, 'A', 2, 0,  0, 31,  1},
+	{1, 'B', 1, 16, 0, 10, -1},
+	{2, 'A', 2, 9,  2, 8,  -1},
+	{2, 'B', 2, 6,  2, 7,   1},
+};
+
+typedef struct sim_plant_t{
+	pthread_mutex_t mutex;		///< protects everything below
+	plant_type_t type;
+	rc_sim_balance_config_t bal_conf;
+	rc_sim_balance_state_t bal;
+	double wheel_l, wheel_r;	///< absolute wheel angles, rad
+	double wheel_l_dot, wheel_r_dot;
+	int counts_l, counts_r;		///< counts already added to the encoders
+	rc_sim_vertical_config_t vert_conf;
+	rc_sim_vertical_state_t vert;
+	uint64_t rng;
+} sim_plant_t;
+
+static sim_plant_t plant = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.type = PLANT_NONE,
+};
+
+
+/**
+ * works out what the H-bridge of a motor is doing from the simulated pwm and
+ * gpio, the same pins rc_motor_set drives
+ */
+static bridge_mode_t __read_bridge(int motor, double* duty)
+{
+	int a, b;
+	*duty = 0.0;
+	if(rc_sim_gpio_get(MOT_STBY)==0) return BRIDGE_COAST;
+	a = rc_sim_gpio_get(bridge[motor-1].a_chip, bridge[motor-1].a_pin);
+	b = rc_sim_gpio_get(bridge[motor-1].b_chip, bridge[motor-1].b_pin);
+	if(a && b) return BRIDGE_BRAKE;
+	if(!a && !b) return BRIDGE_COAST;
+	*duty = rc_sim_pwm_get_duty(bridge[motor-1].ss, bridge[motor-1].ch);
+	if(b) *duty = -*duty;
+	*duty *= bridge[motor-1].polarity;
+	return BRIDGE_DRIVE;
+}
+
+
+/**
+ * torque at a wheel, positive drives it forward
+ *
+ * @param[in]  speed  wheel speed relative to the body, forward positive
+ */
+static double __motor_torque(int motor, int polarity, double speed)
+{
+	const rc_sim_balance_config_t* c = &plant.bal_conf;
+	double duty, emf = c->stall_torque/c->free_speed;
+	switch(__read_bridge(motor, &duty)){
+	case BRIDGE_DRIVE:
+		return c->stall_torque*polarity*duty*c->battery_v/c->nominal_v - emf*speed;
+	case BRIDGE_BRAKE:
+		return -emf*speed;
+	default:
+		return 0.0;
+	}
+}
+
+
+/**
+ * writes the balance bot's state out to the encoders and IMU
+ */
+static void __balance_sensors(void)
+{
+	const rc_sim_balance_config_t* c = &plant.bal_conf;
+	rc_sim_balance_state_t* s = &plant.bal;
+	double counts, q[4], qc[4], tb[3], accel[3], gyro[3];
+	int new_l, new_r;
+
+	s->phi = (plant.wheel_l + plant.wheel_r)/2.0;
+	s->phi_dot = (plant.wheel_l_dot + plant.wheel_r_dot)/2.0;
+	s->x_m = s->phi*c->wheel_radius;
+	s->gamma = (plant.wheel_r - plant.wheel_l)*c->wheel_radius/c->track_width;
+	s->gamma_dot = (plant.wheel_r_dot - plant.wheel_l_dot)*c->wheel_radius/c->track_width;
+
+	// encoders measure the wheels relative to the body
+	counts = c->counts_per_rev/(2.0*M_PI);
+	new_l = (int)floor((plant.wheel_l - s->theta)*counts);
+	new_r = (int)floor((plant.wheel_r - s->theta)*counts);
+	__sim_encoder_add(c->encoder_l, c->encoder_polarity_l*(new_l - plant.counts_l));
+	__sim_encoder_add(c->encoder_r, c->encoder_polarity_r*(new_r - plant.counts_r));
+	plant.counts_l = new_l;
+	plant.counts_r = new_r;
+
+	// the IMU sees the body, offset by how the board is mounted
+	tb[TB_PITCH_X] = s->theta - c->mount_angle;
+	tb[TB_ROLL_Y] = 0.0;
+	tb[TB_YAW_Z] = s->gamma;
+	rc_quaternion_from_tb_array(tb, q);
+	rc_quaternion_conjugate_array(q, qc);
+	accel[0] = 0.0;
+	accel[1] = 0.0;
+	accel[2] = G_TO_MS2;
+	rc_quaternion_rotate_vector_array(accel, qc);
+	gyro[0] = s->theta_dot*RAD_TO_DEG;
+	gyro[1] = 0.0;
+	gyro[2] = s->gamma_dot*RAD_TO_DEG;
+	rc_sim_mpu_set_motion(q, accel, gyro);
+	return;
+}
+
+
+static void __balance_step(double dt)
+{
+	const rc_sim_balance_config_t* c = &plant.bal_conf;
+	rc_sim_balance_state_t* s = &plant.bal;
+	double t, n, h, tl, tr, a, b, cc, det, m11, m12, rhs1, rhs2, acc_th, acc_phi;
+	double jd, acc_d, phi_dot, d_dot;
+	int i, steps;
+
+	steps = (int)ceil(dt/SUBSTEP_S);
+	h = dt/steps;
+	a = c->wheel_inertia*2.0 + (c->body_mass + 2.0*c->wheel_mass)*c->wheel_radius*c->wheel_radius;
+	b = c->body_mass*c->wheel_radius*c->com_height;
+	cc = c->body_inertia + c->body_mass*c->com_height*c->com_height;
+	jd = (c->wheel_inertia + c->wheel_mass*c->wheel_radius*c->wheel_radius)/2.0
+		+ c->yaw_inertia*c->wheel_radius*c->wheel_radius/(c->track_width*c->track_width);
+
+	for(i=0;i<steps;i++){
+		tl = __motor_torque(c->motor_l, c->motor_polarity_l, plant.wheel_l_dot - s->theta_dot);
+		tr = __motor_torque(c->motor_r, c->motor_polarity_r, plant.wheel_r_dot - s->theta_dot);
+		t = tl + tr;
+		n = s->theta;
+		// pitch and mean wheel angle, M*[phi'' theta'']' = rhs
+		m11 = a;
+		m12 = b*cos(n);
+		rhs1 = t + b*sin(n)*s->theta_dot*s->theta_dot;
+		rhs2 = c->body_mass*G_TO_MS2*c->com_height*sin(n) - t;
+		if(s->fallen){
+			// lying on the ground, only the wheels move
+			acc_phi = rhs1/a;
+			acc_th = 0.0;
+		}
+		else{
+			det = m11*cc - m12*m12;
+			acc_phi = (cc*rhs1 - m12*rhs2)/det;
+			acc_th = (m11*rhs2 - m12*rhs1)/det;
+		}
+		// yaw from the difference between the wheels
+		acc_d = (tr - tl)/2.0/jd;
+
+		// semi-implicit euler
+		phi_dot = (plant.wheel_l_dot + plant.wheel_r_dot)/2.0 + acc_phi*h;
+		d_dot = (plant.wheel_r_dot - plant.wheel_l_dot) + acc_d*h;
+		plant.wheel_l_dot = phi_dot - d_dot/2.0;
+		plant.wheel_r_dot = phi_dot + d_dot/2.0;
+		plant.wheel_l += plant.wheel_l_dot*h;
+		plant.wheel_r += plant.wheel_r_dot*h;
+		s->theta_dot += acc_th*h;
+		s->theta += s->theta_dot*h;
+		if(fabs(s->theta)>=c->fall_angle){
+			s->theta = copysign(c->fall_angle, s->theta);
+			s->theta_dot = 0.0;
+			s->fallen = 1;
+		}
+	}
+
+	s->time_s += dt;
+	__balance_sensors();
+	return;
+}
+
+
+/**
+ * writes the vertical vehicle's state out to the IMU and barometer
+ */
+static void __vertical_sensors(void)
+{
+	const rc_sim_vertical_config_t* c = &plant.vert_conf;
+	rc_sim_vertical_state_t* s = &plant.vert;
+	double p;
+	double q[4] = {1.0, 0.0, 0.0, 0.0};
+	double accel[3] = {0.0, 0.0, 0.0};
+
+	// level vehicle, the accelerometer reads the specific force on Z
+	accel[2] = G_TO_MS2 + s->accel_ms2 + __sim_gaussian(&plant.rng, c->accel_noise_ms2);
+	rc_sim_mpu_set_motion(q, accel, NULL);
+
+	// barometric formula inverted from the one rc_bmp uses for altitude
+	p = c->ground_pressure_pa*pow(1.0 - s->alt_m/44330.0, 5.255) + __sim_gaussian(&plant.rng, c->baro_noise_pa);
+	rc_sim_bmp_set(p, c->temp_c);
+	return;
+}
+
+
+static void __vertical_step(double dt)
+{
+	const rc_sim_vertical_config_t* c = &plant.vert_conf;
+	rc_sim_vertical_state_t* s = &plant.vert;
+	double h, u, us, cmd, f;
+	int i, steps;
+
+	// mean throttle over the ESC channels, no pulses is no thrust
+	cmd = 0.0;
+	for(i=0;i<c->channels;i++){
+		us = rc_sim_servo_get_pulse_us(c->first_channel+i);
+		u = (us - c->esc_min_us)/(double)(c->esc_max_us - c->esc_min_us);
+		if(us<=0 || u<0.0) u = 0.0;
+		else if(u>1.0) u = 1.0;
+		cmd += u;
+	}
+	cmd = cmd*c->max_thrust_n/c->channels;
+
+	steps = (int)ceil(dt/SUBSTEP_S);
+	h = dt/steps;
+	for(i=0;i<steps;i++){
+		s->thrust_n += (cmd - s->thrust_n)*h/c->motor_tau_s;
+		f = s->thrust_n - c->mass_kg*G_TO_MS2 - c->drag*s->vel_ms*fabs(s->vel_ms);
+		s->accel_ms2 = f/c->mass_kg;
+		s->landed = 0;
+		if(s->alt_m<=0.0 && s->accel_ms2<=0.0 && s->vel_ms<=0.0){
+			// the ground holds it up
+			s->alt_m = 0.0;
+			s->vel_ms = 0.0;
+			s->accel_ms2 = 0.0;
+			s->landed = 1;
+			continue;
+		}
+		s->vel_ms += s->accel_ms2*h;
+		s->alt_m += s->vel_ms*h;
+	}
+	s->time_s += dt;
+	__vertical_sensors();
+	return;
+}
+
+
+void __sim_plant_step(double dt)
+{
+	pthread_mutex_lock(&plant.mutex);
+	switch(plant.type){
+	case PLANT_BALANCE:
+		__balance_step(dt);
+		break;
+	case PLANT_VERTICAL:
+		__vertical_step(dt);
+		break;
+	default:
+		break;
+	}
+	pthread_mutex_unlock(&plant.mutex);
+	return;
+}
+
+
+rc_sim_balance_config_t rc_sim_balance_default_config(void)
+{
+	rc_sim_balance_config_t conf;
+
+	// eduMiP, matching the settings in rc_balance_defs.h
+	conf.body_mass		= 0.180;
+	conf.body_inertia	= 2.63e-4;
+	conf.com_height		= 0.0477;
+	conf.wheel_mass		= 0.027;
+	conf.wheel_inertia	= 1.56e-5;
+	conf.wheel_radius	= 0.034;
+	conf.track_width	= 0.035;
+	conf.yaw_inertia	= 1.5e-4;
+	conf.stall_torque	= 0.003*35.577;
+	conf.free_speed		= 1760.0/35.577;
+	conf.battery_v		= 7.4;
+	conf.nominal_v		= 7.4;
+	conf.counts_per_rev	= 60.0*35.577;
+	conf.mount_angle	= 0.49;
+	conf.fall_angle		= M_PI/2.0;
+	conf.theta0		= 0.0;
+
+	conf.motor_l		= 3;
+	conf.motor_r		= 2;
+	conf.motor_polarity_l	= 1;
+	conf.motor_polarity_r	= -1;
+	conf.encoder_l		= 3;
+	conf.encoder_r		= 2;
+	conf.encoder_polarity_l	= 1;
+	conf.encoder_polarity_r	= -1;
+	return conf;
+}
+
+
+rc_sim_vertical_config_t rc_sim_vertical_default_config(void)
+{
+	rc_sim_vertical_config_t conf;
+
+	// small quadrotor hovering at half throttle
+	conf.mass_kg		= 1.0;
+	conf.max_thrust_n	= 2.0*G_TO_MS2;
+	conf.motor_tau_s	= 0.05;
+	conf.drag		= 0.1;
+	conf.first_channel	= 1;
+	conf.channels		= 4;
+	conf.esc_min_us		= RC_ESC_DEFAULT_MIN_US;
+	conf.esc_max_us		= RC_ESC_DEFAULT_MAX_US;
+	conf.ground_pressure_pa	= SEA_LEVEL_PA;
+	conf.temp_c		= 25.0;
+	conf.baro_noise_pa	= 0.0;
+	conf.accel_noise_ms2	= 0.0;
+	conf.seed		= 1;
+	return conf;
+}
+
+
+static int __check_channel(int ch, int max, const char* name)
+{
+	if(ch<1 || ch>max){
+		fprintf(stderr,"ERROR in rc_sim_balance_start, %s must be between 1 and %d\n", name, max);
+		return -1;
+	}
+	return 0;
+}
+
+
+int rc_sim_balance_start(rc_sim_balance_config_t conf)
+{
+	if(rc_sim_is_enabled()!=1){
+		fprintf(stderr,"ERROR in rc_sim_balance_start, simulation not enabled\n");
+		return -1;
+	}
+	if(conf.body_mass<=0.0 || conf.body_inertia<=0.0 || conf.com_height<=0.0 ||
+		conf.wheel_mass<=0.0 || conf.wheel_inertia<=0.0 || conf.wheel_radius<=0.0 ||
+		conf.track_width<=0.0 || conf.yaw_inertia<=0.0 || conf.free_speed<=0.0 ||
+		conf.nominal_v<=0.0 || conf.counts_per_rev<=0.0 || conf.fall_angle<=0.0){
+		fprintf(stderr,"ERROR in rc_sim_balance_start, physical parameters must be positive\n");
+		return -1;
+	}
+	if(__check_channel(conf.motor_l, MOTORS, "motor_l")) return -1;
+	if(__check_channel(conf.motor_r, MOTORS, "motor_r")) return -1;
+	if(__check_channel(conf.encoder_l, 4, "encoder_l")) return -1;
+	if(__check_channel(conf.encoder_r, 4, "encoder_r")) return -1;
+	if(abs(conf.motor_polarity_l)!=1 || abs(conf.motor_polarity_r)!=1 ||
+		abs(conf.encoder_polarity_l)!=1 || abs(conf.encoder_polarity_r)!=1){
+		fprintf(stderr,"ERROR in rc_sim_balance_start, polarities must be 1 or -1\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&plant.mutex);
+	plant.type = PLANT_BALANCE;
+	plant.bal_conf = conf;
+	memset(&plant.bal, 0, sizeof(plant.bal));
+	plant.bal.theta = conf.theta0;
+	plant.wheel_l = plant.wheel_r = 0.0;
+	plant.wheel_l_dot = plant.wheel_r_dot = 0.0;
+	plant.counts_l = plant.counts_r = 0;
+	__balance_sensors();
+	pthread_mutex_unlock(&plant.mutex);
+	return 0;
+}
+
+
+int rc_sim_balance_get_state(rc_sim_balance_state_t* state)
+{
+	if(state==NULL){
+		fprintf(stderr,"ERROR in rc_sim_balance_get_state, received NULL pointer\n");
+		return -1;
+	}
+	pthread_mutex_lock(&plant.mutex);
+	if(plant.type!=PLANT_BALANCE){
+		pthread_mutex_unlock(&plant.mutex);
+		fprintf(stderr,"ERROR in rc_sim_balance_get_state, balance plant not running\n");
+		return -1;
+	}
+	*state = plant.bal;
+	pthread_mutex_unlock(&plant.mutex);
+	return 0;
+}
+
+
+int rc_sim_vertical_start(rc_sim_vertical_config_t conf)
+{
+	if(rc_sim_is_enabled()!=1){
+		fprintf(stderr,"ERROR in rc_sim_vertical_start, simulation not enabled\n");
+		return -1;
+	}
+	if(conf.mass_kg<=0.0 || conf.max_thrust_n<=0.0 || conf.motor_tau_s<=0.0 || conf.drag<0.0){
+		fprintf(stderr,"ERROR in rc_sim_vertical_start, physical parameters must be positive\n");
+		return -1;
+	}
+	if(conf.channels<1 || conf.first_channel<RC_SERVO_CH_MIN ||
+		conf.first_channel+conf.channels-1>RC_SERVO_CH_MAX){
+		fprintf(stderr,"ERROR in rc_sim_vertical_start, ESC channels must be within %d to %d\n", RC_SERVO_CH_MIN, RC_SERVO_CH_MAX);
+		return -1;
+	}
+	if(conf.esc_max_us<=conf.esc_min_us){
+		fprintf(stderr,"ERROR in rc_sim_vertical_start, esc_max_us must be greater than esc_min_us\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&plant.mutex);
+	plant.type = PLANT_VERTICAL;
+	plant.vert_conf = conf;
+	memset(&plant.vert, 0, sizeof(plant.vert));
+	plant.vert.landed = 1;
+	plant.rng = conf.seed ? conf.seed : 1;
+	__vertical_sensors();
+	pthread_mutex_unlock(&plant.mutex);
+	return 0;
+}
+
+
+int rc_sim_vertical_get_state(rc_sim_vertical_state_t* state)
+{
+	if(state==NULL){
+		fprintf(stderr,"ERROR in rc_sim_vertical_get_state, received NULL pointer\n");
+		return -1;
+	}
+	pthread_mutex_lock(&plant.mutex);
+	if(plant.type!=PLANT_VERTICAL){
+		pthread_mutex_unlock(&plant.mutex);
+		fprintf(stderr,"ERROR in rc_sim_vertical_get_state, vertical plant not running\n");
+		return -1;
+	}
+	*state = plant.vert;
+	pthread_mutex_unlock(&plant.mutex);
+	return 0;
+}
+
+
+int rc_sim_plant_stop(void)
+{
+	pthread_mutex_lock(&plant.mutex);
+	plant.type = PLANT_NONE;
+	pthread_mutex_unlock(&plant.mutex);
+	return 0;
+}